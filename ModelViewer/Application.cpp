@@ -1,6 +1,7 @@
 #include "Application.h"
 
 #include <iostream>
+#include <filesystem>
 
 #include "Windows.h"
 
@@ -27,6 +28,18 @@
 #include "FrustumCuller.h"
 #include "TessellatedPlane.h"
 #include "Grass.h"
+#include "SceneBVH.h"
+#include "SpatialHash.h"
+#include "OcclusionCuller.h"
+#include "CullingBatch.h"
+#include "TemporalFrustumCuller.h"
+#include "LODSelector.h"
+#include "MultiViewCuller.h"
+#include "ThreadPool.h"
+#include "TransformStore.h"
+#include "ComponentRegistry.h"
+#include "SceneFile.h"
+#include "StressScene.h"
 
 Application* Application::m_Instance = nullptr;
 
@@ -63,6 +76,18 @@ bool Application::Initialise(int ScreenWidth, int ScreenHeight, HWND hWnd)
 	bResult = m_FrustumCuller->Init();
 	assert(bResult);
 
+	m_SceneBVH = std::make_unique<SceneBVH>();
+	m_SpatialHash = std::make_unique<SpatialHash>();
+	// spawns and despawns reach the spatial hash as they happen, anything already attached is added on the first update
+	ComponentRegistry<Model>::SetListeners([this](Model* pModel) { OnModelAdded(pModel); }, [this](Model* pModel) { OnModelRemoved(pModel); });
+	for (Model* pModel : ComponentRegistry<Model>::GetAll())
+	{
+		OnModelAdded(pModel);
+	}
+	m_OcclusionCuller = std::make_unique<OcclusionCuller>();
+	m_CullingBatch = std::make_unique<CullingBatch>();
+	m_InstanceGatherer = std::make_unique<InstanceGatherer>();
+
 	m_BoxRenderer = std::make_unique<BoxRenderer>();
 	bResult = m_BoxRenderer->Init();
 	assert(bResult);
@@ -86,12 +111,12 @@ bool Application::Initialise(int ScreenWidth, int ScreenHeight, HWND hWnd)
 	/*m_GameObjects.emplace_back(std::make_shared<GameObject>());
 	m_GameObjects.back()->SetPosition(0.f, 0.f, 0.f);
 	m_GameObjects.back()->SetName("Car_1");
-	m_GameObjects.back()->AddComponent(std::make_shared<Model>("Models/american_fullsize_73/scene.gltf", "Models/american_fullsize_73/"));
+	m_GameObjects.back()->AddComponent<Model>("Models/american_fullsize_73/scene.gltf", "Models/american_fullsize_73/");
 
 	m_GameObjects.emplace_back(std::make_shared<GameObject>());
 	m_GameObjects.back()->SetPosition(1.f, 1.f, 0.f);
 	m_GameObjects.back()->SetName("Car_2");
-	m_GameObjects.back()->AddComponent(std::make_shared<Model>("Models/american_fullsize_73/scene.gltf", "Models/american_fullsize_73/"));*/
+	m_GameObjects.back()->AddComponent<Model>("Models/american_fullsize_73/scene.gltf", "Models/american_fullsize_73/");*/
 
 	/*for (int i = 0; i < 16; i++)
 	{
@@ -99,26 +124,22 @@ bool Application::Initialise(int ScreenWidth, int ScreenHeight, HWND hWnd)
 		{
 			m_GameObjects.emplace_back(std::make_shared<GameObject>());
 			m_GameObjects.back()->SetPosition((float)i * 2.f, 15.f, (float)j * 2.f);
-			m_GameObjects.back()->AddComponent(std::make_shared<Model>("Models/fantasy_sword_stylized/scene.gltf", "Models/fantasy_sword_stylized/"));
+			m_GameObjects.back()->AddComponent<Model>("Models/fantasy_sword_stylized/scene.gltf", "Models/fantasy_sword_stylized/");
 		}
 	}*/
 
 	/*m_GameObjects.emplace_back(std::make_shared<GameObject>());
 	m_GameObjects.back()->SetPosition(1.7f, 2.5f, -1.7f);
 	m_GameObjects.back()->SetScale(0.1f, 0.1f, 0.1f);
-	m_GameObjects.back()->AddComponent(std::make_shared<Model>("Models/sphere.obj"));
-	m_GameObjects.back()->AddComponent(std::make_shared<PointLight>());*/
+	m_GameObjects.back()->AddComponent<Model>("Models/sphere.obj");
+	m_GameObjects.back()->AddComponent<PointLight>();*/
 
 	/*m_GameObjects.emplace_back(std::make_shared<GameObject>());
 	m_GameObjects.back()->SetName("Point Light");
 	m_GameObjects.back()->SetPosition(-2.f, 3.f, 0.f);
 	m_GameObjects.back()->SetScale(0.1f);
-	m_GameObjects.back()->AddComponent(std::make_shared<Model>("Models/sphere.obj"));
-	m_GameObjects.back()->AddComponent(std::make_shared<PointLight>());*/
-
-	m_GameObjects.emplace_back(std::make_shared<GameObject>());
-	m_GameObjects.back()->SetName("Directional Light");
-	m_GameObjects.back()->AddComponent(std::make_shared<DirectionalLight>());
+	m_GameObjects.back()->AddComponent<Model>("Models/sphere.obj");
+	m_GameObjects.back()->AddComponent<PointLight>();*/
 
 	m_TextureResourceView = static_cast<ID3D11ShaderResourceView*>(ResourceManager::GetSingletonPtr()->LoadTexture(m_QuadTexturePath));
 
@@ -136,6 +157,14 @@ bool Application::Initialise(int ScreenWidth, int ScreenHeight, HWND hWnd)
 	m_PostProcesses.emplace_back(std::make_unique<PostProcessColorCorrection>(1.f, 0.f, 1.15f));
 	m_PostProcesses.emplace_back(std::make_unique<PostProcessGammaCorrection>(2.2f));
 
+	// the saved scene replaces the hardcoded content when there is one
+	if (!LoadScene(DEFAULT_SCENE_PATH))
+	{
+		GameObject* pDirLightObject = GetGameObject(SpawnGameObject());
+		pDirLightObject->SetName("Directional Light");
+		pDirLightObject->AddComponent<DirectionalLight>();
+	}
+
 	return true;
 }
 
@@ -146,7 +175,10 @@ void Application::Shutdown()
 	
 	PostProcess::ShutdownStatics();
 	m_PostProcesses.clear();
+	// the spatial hash goes away with the rest below, no point keeping it in sync while the scene is torn down
+	ComponentRegistry<Model>::SetListeners(nullptr, nullptr);
 	m_GameObjects.clear();
+	m_GameObjectPool.Clear();
 
 	m_Skybox.reset();
 	m_InstancedShader.reset();
@@ -154,8 +186,20 @@ void Application::Shutdown()
 	m_ActiveCamera.reset();
 	m_Landscape.reset();
 	m_FrustumCuller.reset();
+	m_SceneBVH.reset();
+	m_SceneBVHModels.clear();
+	m_SceneBVHItemByTransform.clear();
+	m_SpatialHash.reset();
+	m_SpatialHashEntries.clear();
+	m_SpatialHashFreeEntries.clear();
+	m_SpatialHashPendingEntries.clear();
+	m_SpatialHashEntryByTransform.clear();
+	m_OcclusionCuller.reset();
+	m_CullingBatch.reset();
 	m_BoxRenderer.reset();
 
+	ThreadPool::GetSingletonPtr()->Shutdown();
+
 	ResourceManager::GetSingletonPtr()->Shutdown();
 
 	if (m_Graphics)
@@ -196,12 +240,118 @@ bool Application::Frame()
 	return true;
 }
 
+PoolHandle Application::SpawnGameObject()
+{
+	return m_GameObjectPool.Create();
+}
+
+bool Application::DestroyGameObject(PoolHandle Handle)
+{
+	return m_GameObjectPool.Destroy(Handle);
+}
+
+static void CreateParentDirectory(const std::string& Filepath)
+{
+	const std::filesystem::path Directory = std::filesystem::path(Filepath).parent_path();
+	if (!Directory.empty())
+	{
+		std::error_code Error;
+		std::filesystem::create_directories(Directory, Error);
+	}
+}
+
+bool Application::LoadScene(const std::string& Filepath)
+{
+	SceneFile Scene;
+	if (!Scene.Open(Filepath))
+	{
+		return false;
+	}
+
+	m_GameObjectPool.Clear();
+	Scene.Instantiate(m_GameObjectPool);
+
+	UINT CameraCount = 0u;
+	for (UINT i = 0u; i < Scene.GetNodeCount(); i++)
+	{
+		const SceneNodeRecord& Node = Scene.GetNode(i);
+		if (Node.Type != (UINT)SceneNodeType::Camera)
+			continue;
+
+		if (CameraCount == (UINT)m_Cameras.size())
+		{
+			m_Cameras.emplace_back(std::make_shared<Camera>(m_Graphics->GetProjectionMatrix()));
+			m_GameObjects.push_back(m_Cameras.back());
+		}
+
+		// through the camera's own SetRotation so its view follows
+		Camera* pCamera = m_Cameras[CameraCount].get();
+		pCamera->SetName(Scene.GetString(Node.Name));
+		pCamera->SetPosition(Node.Position.x, Node.Position.y, Node.Position.z);
+		pCamera->SetRotation(Node.Rotation.x, Node.Rotation.y, Node.Rotation.z);
+		CameraCount++;
+	}
+
+	for (UINT i = 0u; i < Scene.GetPostProcessCount(); i++)
+	{
+		const ScenePostProcessRecord& Record = Scene.GetPostProcess(i);
+		for (std::unique_ptr<PostProcess>& pPostProcess : m_PostProcesses)
+		{
+			if (pPostProcess->GetName() == Scene.GetString(Record.Name))
+				pPostProcess->GetIsActive() = Record.bActive != 0u;
+		}
+	}
+
+	return true;
+}
+
+bool Application::SaveScene(const std::string& Filepath) const
+{
+	SceneFile Scene;
+	for (const std::shared_ptr<Camera>& c : m_Cameras)
+	{
+		Scene.AddGameObject(c.get(), SceneNodeType::Camera);
+	}
+	for (GameObject* Object : m_GameObjectPool.GetObjects())
+	{
+		Scene.AddGameObject(Object);
+	}
+	for (const std::unique_ptr<PostProcess>& pPostProcess : m_PostProcesses)
+	{
+		Scene.AddPostProcess(pPostProcess->GetName(), pPostProcess->GetIsActive());
+	}
+
+	CreateParentDirectory(Filepath);
+	return Scene.Save(Filepath);
+}
+
+bool Application::LoadStressScene(const StressSceneParams& Params)
+{
+	StressScene Generator;
+	Generator.Generate(Params);
+
+	SceneFile Scene;
+	Generator.BuildSceneFile(Scene, {
+		{ "Models/fantasy_sword_stylized/scene.gltf", "Models/fantasy_sword_stylized/" },
+		{ "Models/sphere.obj", "" },
+		{ "Models/suzanne.obj", "" },
+		{ "Models/teapot.obj", "" } });
+
+	CreateParentDirectory(STRESS_SCENE_PATH);
+	return Scene.Save(STRESS_SCENE_PATH) && LoadScene(STRESS_SCENE_PATH);
+}
+
 void Application::SetActiveCamera(int ID)
 {
 	m_ActiveCameraID = ID;
 	m_ActiveCamera = m_Cameras[ID];
 }
 
+static double MillisecondsSince(const std::chrono::steady_clock::time_point& Start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+}
+
 bool Application::Render()
 {			
 	bool Result;
@@ -230,7 +380,9 @@ bool Application::Render()
 	m_Graphics->GetDeviceContext()->IASetIndexBuffer(PostProcess::GetQuadIndexBuffer().Get(), DXGI_FORMAT_R32_UINT, 0u);
 	m_Graphics->GetDeviceContext()->VSSetShader(PostProcess::GetQuadVertexShader(), nullptr, 0u);
 	m_Graphics->DisableDepthWriteAlwaysPass(); // simpler for now but might need to refactor when wanting to use depth data in post processes
+	auto PostProcessStart = std::chrono::steady_clock::now();
 	ApplyPostProcesses(CurrentRTV, SecondaryRTV, CurrentSRV, SecondarySRV, DrawingForward);
+	m_RenderStats.PhaseMilliseconds[(int)FramePhase::PostProcess] += MillisecondsSince(PostProcessStart);
 
 	// set back buffer as render target
 	m_Graphics->SetBackBufferRenderTarget();
@@ -268,12 +420,20 @@ bool Application::Render()
 
 		if (m_Landscape->GetShouldRenderBBoxes())
 		{
-			const DirectX::XMMATRIX& Scale = m_Landscape->GetChunkScaleMatrix();
-			const AABB& BBox = m_Landscape->GetBoundingBox();
-			for (const DirectX::XMFLOAT2& o : m_Landscape->GetChunkOffsets())
+			// the tight per chunk bounds the quadtree culls with
+			const LandscapeQuadtree& Quadtree = m_Landscape->GetQuadtree();
+			const std::vector<DirectX::XMFLOAT2>& ChunkOffsets = m_Landscape->GetChunkOffsets();
+			for (UINT ChunkID = 0u; ChunkID < (UINT)ChunkOffsets.size(); ChunkID++)
 			{
-				DirectX::XMMATRIX m = DirectX::XMMatrixMultiply(Scale, DirectX::XMMatrixTranslation(o.x, 0.f, o.y));
-				m_BoxRenderer->LoadBoxCorners(BBox, m);
+				const DirectX::XMFLOAT2& o = ChunkOffsets[ChunkID];
+				DirectX::XMFLOAT3 Center, Extent;
+				Quadtree.GetChunkBounds(ChunkID, m_Landscape->GetHeightDisplacement(), Center, Extent);
+
+				AABB ChunkBox;
+				ChunkBox.Min = { Center.x - Extent.x, Center.y - Extent.y, Center.z - Extent.z };
+				ChunkBox.Max = { Center.x + Extent.x, Center.y + Extent.y, Center.z + Extent.z };
+				ChunkBox.CalcCorners();
+				m_BoxRenderer->LoadBoxCorners(ChunkBox, DirectX::XMMatrixIdentity());
 
 				for (const DirectX::XMFLOAT2& GrassOffset : m_Landscape->GetGrassOffsets())
 				{
@@ -309,18 +469,22 @@ bool Application::RenderScene()
 	m_Graphics->EnableDepthWrite();
 	m_Graphics->GetDeviceContext()->OMSetRenderTargets(1u, m_Graphics->m_PostProcessRTVFirst.GetAddressOf(), m_Graphics->GetDepthStencilView());
 
-	RenderModels();
+	bool Result;
+	FALSE_IF_FAILED(RenderModels());
 
 	if (m_Landscape.get() && m_Landscape->ShouldRender())
 	{
+		auto PhaseStart = std::chrono::steady_clock::now();
 		m_Landscape->Render();
+		m_RenderStats.PhaseMilliseconds[(int)FramePhase::Landscape] += MillisecondsSince(PhaseStart);
 	}
 	
 	return true;
 }
 
-void Application::RenderModels()
+bool Application::RenderModels()
 {	
+	bool Result;
 	DirectX::XMMATRIX View, Proj, ViewProj;
 	m_ActiveCamera->GetViewMatrix(View);
 	m_ActiveCamera->GetProjMatrix(Proj);
@@ -328,6 +492,8 @@ void Application::RenderModels()
 
 	std::unordered_map<std::string, std::unique_ptr<Resource>>& Models = ResourceManager::GetSingletonPtr()->GetModelsMap();
 
+	std::unordered_map<ModelData*, UINT> GatherOutputIndices;
+	m_GatherOutputs.clear();
 	for (const auto& ModelPair : Models)
 	{
 		ModelData* pModelData = static_cast<ModelData*>(ModelPair.second->GetDataPtr());
@@ -335,63 +501,355 @@ void Application::RenderModels()
 			continue;
 
 		pModelData->GetTransforms().clear();
+		GatherOutputIndices[pModelData] = (UINT)m_GatherOutputs.size();
+		m_GatherOutputs.push_back(&pModelData->GetTransforms());
+	}
+
+	// every world matrix in one pass, sending and the BVH below only read them. Only what moved since the last frame is recomputed
+	TransformStore* Store = TransformStore::GetSingletonPtr();
+	auto PhaseStart = std::chrono::steady_clock::now();
+	Store->UpdateWorldMatrices();
+	UpdateSpatialHash();
+	m_RenderStats.PhaseMilliseconds[(int)FramePhase::TransformUpdate] += MillisecondsSince(PhaseStart);
+	m_RenderStats.SpatialHashModels = m_SpatialHash->GetCount();
+	m_RenderStats.SpatialHashCells = m_SpatialHash->GetCellCount();
+	m_RenderStats.TransformsUpdated = Store->GetCount();
+	m_RenderStats.WorldMatricesRecomputed = Store->GetLastRecomputedCount();
+	m_RenderStats.WorldMatricesReused = Store->GetLastReusedCount();
+
+	// with the BVH only models that are in the main camera frustum send their transforms, the per model backend still culls them after
+	PhaseStart = std::chrono::steady_clock::now();
+	if (m_bUseSceneBVH)
+	{
+		UpdateSceneBVH();
+
+		m_SceneBVHVisible.clear();
+		m_SceneBVH->QueryFrustum(Frustum(m_MainCamera->GetViewProjMatrix()), m_SceneBVHVisible);
+		m_RenderStats.SceneBVHNodesVisited = m_SceneBVH->GetLastNodesVisited();
+		m_RenderStats.SceneBVHItemsVisible = m_SceneBVHVisible.size();
+
+		m_GatherModels.clear();
+		for (UINT Item : m_SceneBVHVisible)
+		{
+			m_GatherModels.push_back(m_SceneBVHModels[Item]);
+		}
+	}
+	else
+	{
+		m_bSceneBVHStale = true;
 	}
+	m_RenderStats.PhaseMilliseconds[(int)FramePhase::Culling] += MillisecondsSince(PhaseStart);
 
+	// without the BVH every attached model in registry order, the gather keeps that order whatever the thread count
+	PhaseStart = std::chrono::steady_clock::now();
+	const std::vector<Model*>& GatherModels = m_bUseSceneBVH ? m_GatherModels : ComponentRegistry<Model>::GetAll();
+	m_GatherItems.clear();
+	for (Model* pModel : GatherModels)
+	{
+		auto Output = GatherOutputIndices.find(pModel->GetModelData());
+		if (pModel->GetShouldRender() && Output != GatherOutputIndices.end())
+			m_GatherItems.push_back({ Output->second, pModel->GetTransformID() });
+	}
+	m_InstanceGatherer->Gather(*Store, m_GatherItems, m_GatherOutputs);
+	m_RenderStats.PhaseMilliseconds[(int)FramePhase::Gather] += MillisecondsSince(PhaseStart);
+
+	// the registries only hold attached lights, so this is just the active check
+	PhaseStart = std::chrono::steady_clock::now();
 	std::vector<PointLight*> PointLights;
 	std::vector<DirectionalLight*> DirLights;
-	for (auto& Object : m_GameObjects)
+	for (PointLight* pPointLight : ComponentRegistry<PointLight>::GetAll())
+	{
+		if (!pPointLight->IsActive())
+			continue;
+
+		PointLights.push_back(pPointLight);
+		m_SpatialHashResults.clear();
+		// the same position the shader lights with
+		m_SpatialHash->QueryRadius(pPointLight->GetPosition(), pPointLight->GetRadius(), m_SpatialHashResults);
+		m_RenderStats.PointLightModelsInRange += m_SpatialHashResults.size();
+	}
+	for (DirectionalLight* pDirLight : ComponentRegistry<DirectionalLight>::GetAll())
+	{
+		if (pDirLight->IsActive())
+			DirLights.push_back(pDirLight);
+	}
+	m_RenderStats.PhaseMilliseconds[(int)FramePhase::Lights] += MillisecondsSince(PhaseStart);
+	
+	PhaseStart = std::chrono::steady_clock::now();
+	if (m_bUseOcclusionCulling)
+	{
+		CullOccludedInstances();
+	}
+
+	m_FrustumCuller->SetScreenSizeCulling(m_bUseScreenSizeCulling, m_MinPixelRadius);
+	m_FrustumCuller->GetClusterCuller().SetView(m_MainCamera->GetViewProjMatrix(), m_MainCamera->GetPosition());
+	m_FrustumCuller->GetClusterCuller().SetConeCulling(m_bUseConeCulling);
+	m_FrustumCuller->SetLODSelection(m_LODPixelError, m_LODHysteresis);
+
+	// GPU backend models are all culled in one dispatch, their visible counts only come back a few frames later for the stats
+	m_CullingBatch->Clear();
+	for (const auto& ModelPair : Models)
 	{
-		Object->SendTransformToModels();
-		for (auto& Comp : Object->GetComponents())
+		ModelData* pModelData = static_cast<ModelData*>(ModelPair.second->GetDataPtr());
+		if (!pModelData)
+			continue;
+
+		pModelData->ClearCullingBatch();
+		// models that would take the batch past what its instance, model or draw buffers hold are culled on their own instead
+		if (m_bUseBatchedCulling && pModelData->GetCullingBackend() == CullingBackend::GPU && !pModelData->GetTransforms().empty() &&
+			m_CullingBatch->GetInstanceCount() + pModelData->GetTransforms().size() <= m_FrustumCuller->GetMaxBatchInstances() &&
+			m_CullingBatch->GetModelCount() < MAX_BATCH_MODELS && m_CullingBatch->GetDrawCount() + pModelData->GetMeshCount() <= MAX_BATCH_DRAWS)
 		{
-			Light* pLight = dynamic_cast<Light*>(Comp.get());
-			if (pLight && pLight->IsActive())
-			{
-				PointLight* pPointLight = dynamic_cast<PointLight*>(pLight);
-				if (pPointLight)
-				{
-					PointLights.push_back(pPointLight);
-					continue;
-				}
+			pModelData->AddToCullingBatch(*m_CullingBatch);
+		}
+	}
 
-				DirectionalLight* pDirLight = dynamic_cast<DirectionalLight*>(pLight);
-				if (pDirLight)
-				{
-					DirLights.push_back(pDirLight);
-					continue;
-				}
-			}
+	if (!m_CullingBatch->IsEmpty())
+	{
+		FALSE_IF_FAILED(m_FrustumCuller->DispatchBatch(*m_CullingBatch, m_bValidateBatchedCulling));
+		for (const std::pair<std::string, UINT64>& Count : m_FrustumCuller->GetBatchInstanceCounts())
+		{
+			if (Count.second > 0u)
+				m_RenderStats.InstancesRendered.push_back(Count);
 		}
+		m_RenderStats.BatchValidationMismatches = m_FrustumCuller->GetBatchValidationMismatches();
 	}
-	
+
+	// CPU backend models are tested against every camera at once, only the main camera's list is drawn for now
+	std::vector<DirectX::XMMATRIX> CullingViews;
+	UINT PrimaryView = 0u;
+	if (m_bUseMultiViewCulling)
+	{
+		for (const std::shared_ptr<Camera>& c : m_Cameras)
+		{
+			if (CullingViews.size() == MultiViewCuller::MAX_VIEWS)
+				break;
+
+			if (c == m_MainCamera)
+				PrimaryView = (UINT)CullingViews.size();
+			CullingViews.push_back(c->GetViewProjMatrix());
+			m_RenderStats.MultiViewInstancesVisible.push_back(std::make_pair(c->GetName(), 0ull));
+		}
+	}
+	m_FrustumCuller->SetCullingViews(CullingViews, PrimaryView);
+	m_RenderStats.PhaseMilliseconds[(int)FramePhase::Culling] += MillisecondsSince(PhaseStart);
+
+	// per model culling below is taken out of the submission time and added to culling
+	auto SubmissionStart = std::chrono::steady_clock::now();
+	double PerModelCulling = 0.0;
+	m_InstancedShader->ActivateShader(m_Graphics->GetDeviceContext());
+	m_InstancedShader->SetShaderParameters(
+		m_Graphics->GetDeviceContext(),
+		View,
+		Proj,
+		m_ActiveCamera->GetPosition(),
+		PointLights,
+		DirLights,
+		m_Skybox->GetAverageSkyColor()
+	);
+
 	for (const auto& ModelPair : Models)
 	{		
 		ModelData* pModelData = static_cast<ModelData*>(ModelPair.second->GetDataPtr());
 		if (!pModelData || pModelData->GetTransforms().empty())
 			continue;
+
+		if (pModelData->IsInCullingBatch())
+		{
+			pModelData->Render();
+			continue;
+		}
 		
 		// AABB frustum culling on transforms
-		m_FrustumCuller->DispatchShader(pModelData->GetTransforms(), pModelData->GetBoundingBox().Corners);
-		
-		UINT InstanceCount = m_FrustumCuller->GetInstanceCounts()[0];
+		PhaseStart = std::chrono::steady_clock::now();
+		UINT InstanceCount;
+		if (pModelData->GetCullingBackend() == CullingBackend::CPU)
+		{
+			TemporalFrustumCuller* Temporal = nullptr;
+			if (m_bUseTemporalCulling)
+			{
+				Temporal = &pModelData->GetTemporalCuller();
+				Temporal->SetThresholds(m_TemporalTranslationThreshold, DirectX::XMConvertToRadians(m_TemporalRotationThreshold));
+			}
+
+			// ModelData::RenderMeshes draws per level under the same condition
+			LODSelector* LODs = m_bUseLODs && pModelData->GetLODCount() > 1u ? &pModelData->GetLODSelector() : nullptr;
+
+			FALSE_IF_FAILED(m_FrustumCuller->CullOnCPU(pModelData->GetTransforms(), pModelData->GetBoundingBox(), InstanceCount, Temporal, LODs));
+		}
+		else
+		{
+			FALSE_IF_FAILED(m_FrustumCuller->DispatchShader(pModelData->GetTransforms(), pModelData->GetBoundingBox().Corners));
+			InstanceCount = m_FrustumCuller->GetInstanceCounts()[0];
+		}
+		PerModelCulling += MillisecondsSince(PhaseStart);
 		if (InstanceCount == 0)
 			continue;
 
 		m_RenderStats.InstancesRendered.push_back(std::make_pair(pModelData->GetModelPath(), InstanceCount));
-		
-		m_InstancedShader->ActivateShader(m_Graphics->GetDeviceContext());
-		m_InstancedShader->SetShaderParameters(
-			m_Graphics->GetDeviceContext(),
-			View,
-			Proj,
-			m_ActiveCamera->GetPosition(),
-			PointLights,
-			DirLights,
-			m_Skybox->GetAverageSkyColor()
-		);
 
 		pModelData->Render();
 	}
+	m_RenderStats.PhaseMilliseconds[(int)FramePhase::Culling] += PerModelCulling;
+	m_RenderStats.PhaseMilliseconds[(int)FramePhase::DrawSubmission] += MillisecondsSince(SubmissionStart) - PerModelCulling;
+
+	m_RenderStats.InstanceBufferCapacity = m_FrustumCuller->GetInstanceBufferCapacity();
+	m_RenderStats.InstanceBufferHighWaterMark = m_FrustumCuller->GetInstanceBufferHighWaterMark();
+	return true;
+}
+
+void Application::CullOccludedInstances()
+{
+	std::unordered_map<std::string, std::unique_ptr<Resource>>& Models = ResourceManager::GetSingletonPtr()->GetModelsMap();
+
+	// all occluders go in before anything is tested, an occluder model can still hide other instances of itself
+	m_OcclusionCuller->BeginFrame(m_MainCamera->GetViewProjMatrix());
+	for (const auto& ModelPair : Models)
+	{
+		ModelData* pModelData = static_cast<ModelData*>(ModelPair.second->GetDataPtr());
+		if (pModelData && pModelData->IsOccluder())
+		{
+			pModelData->SubmitOccluders(*m_OcclusionCuller);
+		}
+	}
+	m_OcclusionCuller->RasterizeOccluders();
+	m_RenderStats.OccluderTriangles = m_OcclusionCuller->GetRasterizedTriangleCount();
+
+	for (const auto& ModelPair : Models)
+	{
+		ModelData* pModelData = static_cast<ModelData*>(ModelPair.second->GetDataPtr());
+		if (!pModelData || pModelData->GetTransforms().empty())
+			continue;
+
+		m_RenderStats.InstancesOccluded += m_OcclusionCuller->CullInstances(pModelData->GetBoundingBox(), pModelData->GetTransforms());
+	}
+}
+
+void Application::UpdateSceneBVH()
+{
+	// models were added or removed, or so much has moved that the SAH splits no longer mean much
+	if (m_bSceneBVHStale || m_SceneBVHRegistryVersion != ComponentRegistry<Model>::GetVersion() || m_SceneBVH->ShouldRebuild())
+	{
+		m_SceneBVHModels = ComponentRegistry<Model>::GetAll();
+		m_SceneBVHRegistryVersion = ComponentRegistry<Model>::GetVersion();
+		m_bSceneBVHStale = false;
+
+		std::vector<BVHBounds> Bounds(m_SceneBVHModels.size());
+		m_SceneBVHItemByTransform.assign(TransformStore::GetSingletonPtr()->GetCount(), TransformStore::INVALID_ID);
+		for (UINT i = 0u; i < (UINT)m_SceneBVHModels.size(); i++)
+		{
+			const Model* pModel = m_SceneBVHModels[i];
+			Bounds[i] = SceneBVH::TransformBounds(pModel->GetModelData()->GetBoundingBox(), pModel->GetAccumulatedWorldMatrix());
+
+			if (pModel->GetTransformID() >= (UINT)m_SceneBVHItemByTransform.size())
+				m_SceneBVHItemByTransform.resize(pModel->GetTransformID() + 1u, TransformStore::INVALID_ID);
+			m_SceneBVHItemByTransform[pModel->GetTransformID()] = i;
+		}
+		m_SceneBVH->Build(Bounds);
+		return;
+	}
+
+	// only the models whose world matrix was recomputed this frame, a still scene does no work at all
+	bool bAnyMoved = false;
+	for (UINT ID : TransformStore::GetSingletonPtr()->GetChangedIDs())
+	{
+		if (ID >= (UINT)m_SceneBVHItemByTransform.size() || m_SceneBVHItemByTransform[ID] == TransformStore::INVALID_ID)
+			continue;
+
+		const UINT Item = m_SceneBVHItemByTransform[ID];
+		const Model* pModel = m_SceneBVHModels[Item];
+		bAnyMoved |= m_SceneBVH->UpdateItem(Item, SceneBVH::TransformBounds(pModel->GetModelData()->GetBoundingBox(), pModel->GetAccumulatedWorldMatrix()));
+	}
+
+	if (bAnyMoved)
+		m_SceneBVH->Refit();
+}
+
+void Application::UpdateSpatialHash()
+{
+	// models added since the last update, their world matrices are valid now. An entry freed and reused in between is listed twice
+	for (UINT Entry : m_SpatialHashPendingEntries)
+	{
+		SpatialHashEntry& E = m_SpatialHashEntries[Entry];
+		if (!E.pModel || E.Proxy != SpatialHash::INVALID_PROXY)
+			continue;
+
+		E.Proxy = m_SpatialHash->Insert(SceneBVH::TransformBounds(E.pModel->GetModelData()->GetBoundingBox(), E.pModel->GetAccumulatedWorldMatrix()), Entry);
+	}
+	m_SpatialHashPendingEntries.clear();
+
+	// only the models whose world matrix was recomputed this frame, a still scene does no work at all
+	for (UINT ID : TransformStore::GetSingletonPtr()->GetChangedIDs())
+	{
+		if (ID >= (UINT)m_SpatialHashEntryByTransform.size() || m_SpatialHashEntryByTransform[ID] == TransformStore::INVALID_ID)
+			continue;
+
+		const SpatialHashEntry& E = m_SpatialHashEntries[m_SpatialHashEntryByTransform[ID]];
+		m_SpatialHash->Update(E.Proxy, SceneBVH::TransformBounds(E.pModel->GetModelData()->GetBoundingBox(), E.pModel->GetAccumulatedWorldMatrix()));
+	}
+}
+
+void Application::OnModelAdded(Model* pModel)
+{
+	UINT Entry = (UINT)m_SpatialHashEntries.size();
+	if (!m_SpatialHashFreeEntries.empty())
+	{
+		Entry = m_SpatialHashFreeEntries.back();
+		m_SpatialHashFreeEntries.pop_back();
+	}
+	else
+	{
+		m_SpatialHashEntries.emplace_back();
+	}
+
+	m_SpatialHashEntries[Entry] = { pModel, SpatialHash::INVALID_PROXY };
+	m_SpatialHashPendingEntries.push_back(Entry);
+
+	const UINT ID = pModel->GetTransformID();
+	if (ID >= (UINT)m_SpatialHashEntryByTransform.size())
+		m_SpatialHashEntryByTransform.resize(ID + 1u, TransformStore::INVALID_ID);
+	m_SpatialHashEntryByTransform[ID] = Entry;
+}
+
+void Application::OnModelRemoved(Model* pModel)
+{
+	const UINT ID = pModel->GetTransformID();
+	assert(ID < (UINT)m_SpatialHashEntryByTransform.size() && m_SpatialHashEntryByTransform[ID] != TransformStore::INVALID_ID);
+
+	const UINT Entry = m_SpatialHashEntryByTransform[ID];
+	SpatialHashEntry& E = m_SpatialHashEntries[Entry];
+	if (E.Proxy != SpatialHash::INVALID_PROXY)
+		m_SpatialHash->Remove(E.Proxy);
+
+	E = { nullptr, SpatialHash::INVALID_PROXY };
+	m_SpatialHashFreeEntries.push_back(Entry);
+	m_SpatialHashEntryByTransform[ID] = TransformStore::INVALID_ID;
+}
+
+GameObject* Application::PickGameObject(float NdcX, float NdcY) const
+{
+	// unproject the near and far plane points under the cursor
+	const DirectX::XMMATRIX InvViewProj = DirectX::XMMatrixInverse(nullptr, m_ActiveCamera->GetViewProjMatrix());
+	const DirectX::XMVECTOR Near = DirectX::XMVector3TransformCoord(DirectX::XMVectorSet(NdcX, NdcY, 0.f, 1.f), InvViewProj);
+	const DirectX::XMVECTOR Far = DirectX::XMVector3TransformCoord(DirectX::XMVectorSet(NdcX, NdcY, 1.f, 1.f), InvViewProj);
+	const DirectX::XMVECTOR Ray = DirectX::XMVectorSubtract(Far, Near);
+
+	DirectX::XMFLOAT3 Origin, Direction;
+	DirectX::XMStoreFloat3(&Origin, Near);
+	DirectX::XMStoreFloat3(&Direction, DirectX::XMVector3Normalize(Ray));
+
+	UINT Entry;
+	float Distance;
+	if (!m_SpatialHash->QueryRay(Origin, Direction, DirectX::XMVectorGetX(DirectX::XMVector3Length(Ray)), Entry, Distance))
+		return nullptr;
+
+	// the hit is a model, what gets selected is the object at the top of its hierarchy
+	Component* pOwner = m_SpatialHashEntries[Entry].pModel;
+	while (pOwner->GetOwner())
+	{
+		pOwner = pOwner->GetOwner();
+	}
+	return dynamic_cast<GameObject*>(pOwner);
 }
 
 bool Application::RenderTexture(Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> TextureView)
@@ -6,14 +6,19 @@
 #include <chrono>
 #include <vector>
 #include <memory>
+#include <unordered_map>
 
 #include "Graphics.h"
 #include "Common.h"
+#include "InstanceGatherer.h"
+#include "ObjectPool.h"
 
 const bool FULL_SCREEN = false;
 const bool VSYNC_ENABLED = false;
 const float SCREEN_DEPTH = 2000.f;
 const float SCREEN_NEAR = 0.1f;
+const char* const DEFAULT_SCENE_PATH = "Scenes/Default.mvscene";
+const char* const STRESS_SCENE_PATH = "Scenes/Stress.mvscene";
 
 class Shader;
 class InstancedShader;
@@ -28,6 +33,11 @@ class Landscape;
 class FrustumRenderer;
 class BoxRenderer;
 class FrustumCuller;
+class SceneBVH;
+class SpatialHash;
+class OcclusionCuller;
+class CullingBatch;
+struct StressSceneParams;
 
 class Application
 {
@@ -55,27 +65,64 @@ public:
 	HWND GetWindowHandle() const { return m_hWnd; }
 	Graphics* GetGraphics() const { return m_Graphics; }
 
-	std::shared_ptr<Camera> GetActiveCamera() { return m_ActiveCamera; }
-	std::shared_ptr<Camera> GetMainCamera() { return m_MainCamera; }
+	// by reference, a copy per call was a refcount round trip every time a system looked at the camera
+	const std::shared_ptr<Camera>& GetActiveCamera() const { return m_ActiveCamera; }
+	const std::shared_ptr<Camera>& GetMainCamera() const { return m_MainCamera; }
 	int GetActiveCameraID() { return m_ActiveCameraID; }
 
 	InstancedShader* GetInstancedShader() { return m_InstancedShader.get(); }
 	std::shared_ptr<FrustumCuller> GetFrustumCuller() { return m_FrustumCuller; }
 	std::shared_ptr<BoxRenderer> GetBoxRenderer() { return m_BoxRenderer; }
 
+	// cameras and the landscape, everything else is spawned into the pool
 	std::vector<std::shared_ptr<GameObject>>& GetGameObjects() { return m_GameObjects; }
+	PoolHandle SpawnGameObject();
+	bool DestroyGameObject(PoolHandle Handle);
+	GameObject* GetGameObject(PoolHandle Handle) const { return m_GameObjectPool.Get(Handle); }
+	const ObjectPool<GameObject>& GetGameObjectPool() const { return m_GameObjectPool; }
+
+	// replaces the pooled objects, reuses the existing cameras before adding new ones
+	bool LoadScene(const std::string& Filepath);
+	bool SaveScene(const std::string& Filepath) const;
+	// generated, written to STRESS_SCENE_PATH and loaded from there like any other scene
+	bool LoadStressScene(const StressSceneParams& Params);
+
+	// nearest object whose model bounds the ray through the given NDC point of the active camera hits, nullptr for none
+	GameObject* PickGameObject(float NdcX, float NdcY) const;
+	const SpatialHash* GetSpatialHash() const { return m_SpatialHash.get(); }
 	std::vector<std::shared_ptr<Camera>>& GetCameras() { return m_Cameras; }
 	std::vector<std::unique_ptr<PostProcess>>& GetPostProcesses() { return m_PostProcesses; }
 
 	double GetDeltaTime() const { return m_DeltaTime; }
 	double GetAppTime() const { return m_AppTime; }
 	RenderStats& GetRenderStatsRef() { return m_RenderStats; }
+	bool GetShowCursor() const { return m_bShowCursor; }
 	bool& GetShowBoundingBoxesRef() { return m_bShowBoundingBoxes; }
+	bool& GetUseSceneBVHRef() { return m_bUseSceneBVH; }
+	bool& GetUseOcclusionCullingRef() { return m_bUseOcclusionCulling; }
+	bool& GetUseBatchedCullingRef() { return m_bUseBatchedCulling; }
+	bool& GetValidateBatchedCullingRef() { return m_bValidateBatchedCulling; }
+	bool& GetUseTemporalCullingRef() { return m_bUseTemporalCulling; }
+	bool& GetUseMultiViewCullingRef() { return m_bUseMultiViewCulling; }
+	bool& GetUseScreenSizeCullingRef() { return m_bUseScreenSizeCulling; }
+	bool& GetUseClusterCullingRef() { return m_bUseClusterCulling; }
+	bool& GetUseConeCullingRef() { return m_bUseConeCulling; }
+	bool& GetUseLODsRef() { return m_bUseLODs; }
+	float& GetLODPixelErrorRef() { return m_LODPixelError; }
+	float& GetLODHysteresisRef() { return m_LODHysteresis; }
+	float& GetMinPixelRadiusRef() { return m_MinPixelRadius; }
+	float& GetTemporalTranslationThresholdRef() { return m_TemporalTranslationThreshold; }
+	float& GetTemporalRotationThresholdRef() { return m_TemporalRotationThreshold; }
 
 private:
 	bool Render();
 	bool RenderScene();
-	void RenderModels();
+	bool RenderModels();
+	void UpdateSceneBVH();
+	void UpdateSpatialHash();
+	void OnModelAdded(Model* pModel);
+	void OnModelRemoved(Model* pModel);
+	void CullOccludedInstances();
 	bool RenderTexture(Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> TextureView);
 
 	void RenderImGui();
@@ -98,14 +145,45 @@ private:
 	std::unique_ptr<Skybox> m_Skybox;
 	std::shared_ptr<BoxRenderer> m_BoxRenderer;
 	std::shared_ptr<FrustumCuller> m_FrustumCuller;
+	std::unique_ptr<SceneBVH> m_SceneBVH;
+	std::unique_ptr<SpatialHash> m_SpatialHash;
+	std::unique_ptr<OcclusionCuller> m_OcclusionCuller;
+	std::unique_ptr<CullingBatch> m_CullingBatch;
+	std::unique_ptr<InstanceGatherer> m_InstanceGatherer;
 	std::shared_ptr<Landscape> m_Landscape;
 	std::shared_ptr<Camera> m_ActiveCamera;
 	std::shared_ptr<Camera> m_MainCamera;
 
 	std::vector<std::shared_ptr<GameObject>> m_GameObjects;
+	ObjectPool<GameObject> m_GameObjectPool;
 	std::vector<std::shared_ptr<Camera>> m_Cameras;
 	std::vector<std::unique_ptr<PostProcess>> m_PostProcesses;
 
+	// BVH items index into this, rebuilt whenever the set of models in the scene changes
+	std::vector<Model*> m_SceneBVHModels;
+	std::vector<UINT> m_SceneBVHItemByTransform;	// transform id to BVH item, INVALID_ID for transforms that are not models
+	std::vector<UINT> m_SceneBVHVisible;
+	UINT64 m_SceneBVHRegistryVersion = 0u;
+	bool m_bSceneBVHStale = true;			// set while the BVH is off, the changed transforms of those frames were never applied
+
+	// spatial hash user data indexes the entries. The Model registry listeners add and free them, a new entry has no proxy until the
+	// next UpdateSpatialHash because the world matrix of the model is not known before then
+	struct SpatialHashEntry
+	{
+		Model* pModel;
+		UINT Proxy;
+	};
+	std::vector<SpatialHashEntry> m_SpatialHashEntries;
+	std::vector<UINT> m_SpatialHashFreeEntries;
+	std::vector<UINT> m_SpatialHashPendingEntries;
+	std::vector<UINT> m_SpatialHashEntryByTransform;	// transform id to entry, INVALID_ID for transforms that are not models
+	std::vector<UINT> m_SpatialHashResults;
+
+	// rebuilt every frame, outputs are the ModelData transform lists
+	std::vector<Model*> m_GatherModels;
+	std::vector<InstanceGatherer::Item> m_GatherItems;
+	std::vector<std::vector<DirectX::XMMATRIX>*> m_GatherOutputs;
+
 	std::chrono::steady_clock::time_point m_LastUpdate;
 	double m_AppTime;
 	double m_DeltaTime; // in seconds
@@ -116,6 +194,21 @@ private:
 	bool m_bShowCursor = false;
 	bool m_bCursorToggleReleased = true;
 	bool m_bShowBoundingBoxes = false;
+	bool m_bUseSceneBVH = false;
+	bool m_bUseOcclusionCulling = false;
+	bool m_bUseBatchedCulling = true;
+	bool m_bValidateBatchedCulling = false;
+	bool m_bUseTemporalCulling = false;
+	bool m_bUseMultiViewCulling = false;
+	bool m_bUseScreenSizeCulling = false;
+	bool m_bUseClusterCulling = false;
+	bool m_bUseConeCulling = true;
+	bool m_bUseLODs = true;
+	float m_LODPixelError = 1.f;
+	float m_LODHysteresis = 0.2f; // fraction of the pixel error
+	float m_MinPixelRadius = 2.f;
+	float m_TemporalTranslationThreshold = 1.f;
+	float m_TemporalRotationThreshold = 2.f; // in degrees
 
 	RenderStats m_RenderStats;
 
@@ -0,0 +1,4518 @@
+#include "Benchmarks.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <set>
+#include <tuple>
+#include <vector>
+
+#include "DirectXMath.h"
+
+#include "CPUFrustumCuller.h"
+#include "SceneBVH.h"
+#include "OcclusionCuller.h"
+#include "ThreadPool.h"
+#include "CullingBatch.h"
+#include "InstanceBufferManager.h"
+#include "TemporalFrustumCuller.h"
+#include "Frustum.h"
+#include "MultiViewCuller.h"
+#include "ScreenSizeCuller.h"
+#include "LandscapeQuadtree.h"
+#include "GrassTileCuller.h"
+#include "TransformStore.h"
+#include "InstanceGatherer.h"
+#include "Component.h"
+#include "ComponentRegistry.h"
+#include "GameObject.h"
+#include "Light.h"
+#include "ObjectPool.h"
+#include "ComponentPool.h"
+#include "SceneFile.h"
+#include "StressScene.h"
+#include "SpatialHash.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "VertexCompression.h"
+#include "MeshletBuilder.h"
+#include "ClusterCuller.h"
+#include "stb_image.h"
+#include "MeshSimplifier.h"
+#include "LODSelector.h"
+#include "ModelData.h"
+#include "Common.h"
+
+// how many timed runs each case gets, the fastest one is reported to keep noise from other processes out
+static const int BENCHMARK_ITERATIONS = 20;
+
+// rolling hills on one half and a flat plain on the other, the plain is where the old 0 to displacement bounds were loosest
+static std::vector<float> GenerateTestHeightmap(UINT MapSize)
+{
+	std::vector<float> Heights(MapSize * MapSize);
+	for (UINT y = 0u; y < MapSize; y++)
+	{
+		for (UINT x = 0u; x < MapSize; x++)
+		{
+			const float Hills = 0.5f + 0.25f * sinf((float)x * 0.031f) * cosf((float)y * 0.023f) + 0.2f * sinf((float)(x + y) * 0.007f);
+			Heights[y * MapSize + x] = x < MapSize / 2u ? 0.1f : Hills;
+		}
+	}
+	return Heights;
+}
+
+// bilinear with clamped addressing, the way the landscape shaders read the heightmap
+static float SampleTestHeightmap(const std::vector<float>& Heights, UINT MapSize, float u, float v)
+{
+	const float tx = u * (float)MapSize - 0.5f;
+	const float ty = v * (float)MapSize - 0.5f;
+	const int x0 = (int)floorf(tx);
+	const int y0 = (int)floorf(ty);
+	const float fx = tx - (float)x0;
+	const float fy = ty - (float)y0;
+	auto Texel = [&](int x, int y)
+	{
+		x = x < 0 ? 0 : (x >= (int)MapSize ? (int)MapSize - 1 : x);
+		y = y < 0 ? 0 : (y >= (int)MapSize ? (int)MapSize - 1 : y);
+		return Heights[y * MapSize + x];
+	};
+	const float Top = Texel(x0, y0) + (Texel(x0 + 1, y0) - Texel(x0, y0)) * fx;
+	const float Bottom = Texel(x0, y0 + 1) + (Texel(x0 + 1, y0 + 1) - Texel(x0, y0 + 1)) * fx;
+	return Top + (Bottom - Top) * fy;
+}
+
+bool Benchmarks::Run(const std::string& OutputPath)
+{
+	std::ofstream Out(OutputPath, std::ios::out | std::ios::trunc);
+	if (!Out.is_open())
+		return false;
+
+	ms_ValidationFailures = 0u;
+	WriteHeader(Out);
+	RunCullingBenchmark(Out);
+	RunSceneBVHBenchmark(Out);
+	RunOcclusionBenchmark(Out);
+	RunThreadPoolBenchmark(Out);
+	RunCullingBatchBenchmark(Out);
+	RunInstanceBufferBenchmark(Out);
+	RunTemporalCullingBenchmark(Out);
+	RunFrustumBenchmark(Out);
+	RunMultiViewBenchmark(Out);
+	RunScreenSizeBenchmark(Out);
+	RunLandscapeQuadtreeBenchmark(Out);
+	RunGrassTileBenchmark(Out);
+	RunTransformStoreBenchmark(Out);
+	RunInstanceGatherBenchmark(Out);
+	RunComponentRegistryBenchmark(Out);
+	RunObjectPoolBenchmark(Out);
+	RunSceneFileBenchmark(Out);
+	RunStressSceneBenchmark(Out);
+	RunSpatialHashBenchmark(Out);
+	RunMeshCacheBenchmark(Out);
+	RunMeshOptimizerBenchmark(Out);
+	RunVertexCompressionBenchmark(Out);
+	RunClusterCullingBenchmark(Out);
+	RunMeshSimplifierBenchmark(Out);
+	RunParallelImportBenchmark(Out);
+
+	ThreadPool::GetSingletonPtr()->Shutdown();
+
+	if (ms_ValidationFailures > 0u)
+	{
+		std::cerr << ms_ValidationFailures << " validation rows failed, see " << OutputPath << "\n";
+		return false;
+	}
+
+	return true;
+}
+
+void Benchmarks::RunCullingBenchmark(std::ofstream& Out)
+{
+	const UINT InstanceCounts[] = { 1000u, 10000u, 100000u };
+	const CPUFrustumCuller::SIMDPath Paths[] = { CPUFrustumCuller::SIMDPath::Scalar, CPUFrustumCuller::SIMDPath::SSE, CPUFrustumCuller::SIMDPath::AVX };
+	const char* PathNames[] = { "Scalar", "SSE", "AVX" };
+
+	DirectX::XMMATRIX View = DirectX::XMMatrixLookAtLH(DirectX::XMVectorSet(0.f, 10.f, -250.f, 1.f), DirectX::XMVectorSet(0.f, 0.f, 0.f, 1.f), DirectX::XMVectorSet(0.f, 1.f, 0.f, 0.f));
+	DirectX::XMMATRIX Proj = DirectX::XMMatrixPerspectiveFovLH(DirectX::XMConvertToRadians(60.f), 16.f / 9.f, 0.1f, 2000.f);
+	DirectX::XMMATRIX ViewProj = View * Proj;
+
+	AABB BBox;
+	BBox.Min = { -1.f, 0.f, -1.f };
+	BBox.Max = { 1.f, 3.f, 1.f };
+
+	// fixed seed so every run culls the same scene
+	std::mt19937 Generator(1337u);
+	std::uniform_real_distribution<float> Position(-500.f, 500.f);
+	std::uniform_real_distribution<float> Rotation(0.f, DirectX::XM_2PI);
+	std::uniform_real_distribution<float> Scale(0.5f, 4.f);
+
+	std::vector<DirectX::XMMATRIX> Transforms;
+	std::vector<DirectX::XMMATRIX> Visible;
+	CPUFrustumCuller Culler;
+
+	for (UINT Count : InstanceCounts)
+	{
+		Transforms.clear();
+		Transforms.reserve(Count);
+		for (UINT i = 0u; i < Count; i++)
+		{
+			DirectX::XMMATRIX World = DirectX::XMMatrixScaling(Scale(Generator), Scale(Generator), Scale(Generator)) *
+				DirectX::XMMatrixRotationRollPitchYaw(Rotation(Generator), Rotation(Generator), Rotation(Generator)) *
+				DirectX::XMMatrixTranslation(Position(Generator), Position(Generator) * 0.1f, Position(Generator));
+			Transforms.push_back(DirectX::XMMatrixTranspose(World));
+		}
+
+		for (int p = 0; p < 3; p++)
+		{
+			if (Paths[p] == CPUFrustumCuller::SIMDPath::AVX && !CPUFrustumCuller::IsAVXSupported())
+				continue;
+
+			Culler.SetSIMDPath(Paths[p]);
+			UINT VisibleCount = Culler.Cull(Transforms, BBox, ViewProj, Visible);
+
+			double Best = DBL_MAX;
+			for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+			{
+				auto Start = std::chrono::high_resolution_clock::now();
+				VisibleCount = Culler.Cull(Transforms, BBox, ViewProj, Visible);
+				auto End = std::chrono::high_resolution_clock::now();
+
+				Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+			}
+
+			WriteRow(Out, "FrustumCullCPU", PathNames[p], Count, VisibleCount, Best);
+		}
+	}
+}
+
+void Benchmarks::RunSceneBVHBenchmark(std::ofstream& Out)
+{
+	const UINT InstanceCounts[] = { 10000u, 50000u, 100000u };
+	// fraction of items that move between frames for the refit case
+	const float MovedFraction = 0.01f;
+
+	DirectX::XMMATRIX View = DirectX::XMMatrixLookAtLH(DirectX::XMVectorSet(0.f, 10.f, -250.f, 1.f), DirectX::XMVectorSet(0.f, 0.f, 0.f, 1.f), DirectX::XMVectorSet(0.f, 1.f, 0.f, 0.f));
+	DirectX::XMMATRIX Proj = DirectX::XMMatrixPerspectiveFovLH(DirectX::XMConvertToRadians(60.f), 16.f / 9.f, 0.1f, 2000.f);
+	DirectX::XMMATRIX ViewProj = View * Proj;
+
+	const Frustum ViewFrustum(ViewProj);
+
+	AABB BBox;
+	BBox.Min = { -1.f, 0.f, -1.f };
+	BBox.Max = { 1.f, 3.f, 1.f };
+
+	std::mt19937 Generator(1337u);
+	std::uniform_real_distribution<float> Position(-2000.f, 2000.f);
+	std::uniform_real_distribution<float> Rotation(0.f, DirectX::XM_2PI);
+	std::uniform_real_distribution<float> Offset(-5.f, 5.f);
+
+	std::vector<DirectX::XMMATRIX> Transforms;
+	std::vector<DirectX::XMMATRIX> Visible;
+	std::vector<BVHBounds> Bounds;
+	std::vector<UINT> VisibleItems;
+	CPUFrustumCuller Culler;
+	SceneBVH BVH;
+
+	for (UINT Count : InstanceCounts)
+	{
+		Transforms.clear();
+		Bounds.clear();
+		for (UINT i = 0u; i < Count; i++)
+		{
+			DirectX::XMMATRIX World = DirectX::XMMatrixRotationY(Rotation(Generator)) * DirectX::XMMatrixTranslation(Position(Generator), 0.f, Position(Generator));
+			Transforms.push_back(DirectX::XMMatrixTranspose(World));
+			Bounds.push_back(SceneBVH::TransformBounds(BBox, World));
+		}
+
+		double Best = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+		{
+			auto Start = std::chrono::high_resolution_clock::now();
+			BVH.Build(Bounds);
+			auto End = std::chrono::high_resolution_clock::now();
+
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+		WriteRow(Out, "SceneBVH", "Build", Count, BVH.GetNodeCount(), Best);
+
+		const UINT MovedCount = (UINT)(Count * MovedFraction);
+		Best = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+		{
+			auto Start = std::chrono::high_resolution_clock::now();
+			for (UINT m = 0u; m < MovedCount; m++)
+			{
+				UINT Item = (UINT)(Generator() % Count);
+				BVHBounds Moved = BVH.GetItemBounds(Item);
+				float dx = Offset(Generator), dz = Offset(Generator);
+				Moved.Min.x += dx; Moved.Max.x += dx;
+				Moved.Min.z += dz; Moved.Max.z += dz;
+				BVH.UpdateItem(Item, Moved);
+			}
+			BVH.Refit();
+			auto End = std::chrono::high_resolution_clock::now();
+
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+		WriteRow(Out, "SceneBVH", "Refit1Pct", Count, MovedCount, Best);
+
+		Best = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+		{
+			VisibleItems.clear();
+			auto Start = std::chrono::high_resolution_clock::now();
+			BVH.QueryFrustum(ViewFrustum, VisibleItems);
+			auto End = std::chrono::high_resolution_clock::now();
+
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+		WriteRow(Out, "SceneBVH", "Query", Count, (UINT)VisibleItems.size(), Best);
+
+		// flat per instance culling over the same scene for comparison
+		UINT VisibleCount = 0u;
+		Best = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+		{
+			auto Start = std::chrono::high_resolution_clock::now();
+			VisibleCount = Culler.Cull(Transforms, BBox, ViewProj, Visible);
+			auto End = std::chrono::high_resolution_clock::now();
+
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+		WriteRow(Out, "SceneBVH", "FlatCull", Count, VisibleCount, Best);
+	}
+
+	// the per frame path of Application::UpdateSceneBVH: only the ids the TransformStore recomputed are updated, refit is skipped
+	// when none of them moved, and the query has to return exactly what a flat test of every current world bound does
+	const UINT ValidateCount = 50000u;
+	const UINT ValidateFrames = 8u;
+	const UINT GroupSize = 4u;
+	std::uniform_real_distribution<float> Yaw(0.f, 360.f);
+	TransformStore Store;
+	std::vector<UINT> IDs(ValidateCount);
+	for (UINT i = 0u; i < ValidateCount; i++)
+	{
+		IDs[i] = Store.Create();
+		Store.SetPosition(IDs[i], { Position(Generator), 0.f, Position(Generator) });
+		Store.SetRotation(IDs[i], { 0.f, Yaw(Generator), 0.f });
+		// moving a parent has to move the whole group in the BVH too
+		if (i % GroupSize != 0u)
+			Store.SetParent(IDs[i], IDs[i - 1u]);
+	}
+	Store.UpdateWorldMatrices();
+
+	std::vector<UINT> ItemByID(ValidateCount, TransformStore::INVALID_ID);
+	Bounds.clear();
+	for (UINT i = 0u; i < ValidateCount; i++)
+	{
+		ItemByID[IDs[i]] = i;
+		Bounds.push_back(SceneBVH::TransformBounds(BBox, Store.GetWorldMatrix(IDs[i])));
+	}
+	BVH.Build(Bounds);
+
+	UINT Mismatches = 0u;
+	UINT Refits = 0u;
+	double Best = DBL_MAX;
+	std::vector<UINT> FlatItems;
+	for (UINT Frame = 0u; Frame < ValidateFrames; Frame++)
+	{
+		// the last frame moves nothing and must not refit
+		const bool bStill = Frame == ValidateFrames - 1u;
+		if (!bStill)
+		{
+			for (UINT m = 0u; m < (UINT)(ValidateCount * MovedFraction); m++)
+			{
+				const UINT ID = IDs[Generator() % ValidateCount];
+				DirectX::XMFLOAT3 Moved = Store.GetPosition(ID);
+				Moved.x += Offset(Generator) * 20.f;
+				Moved.z += Offset(Generator) * 20.f;
+				Store.SetPosition(ID, Moved);
+			}
+		}
+		Store.UpdateWorldMatrices();
+
+		auto Start = std::chrono::high_resolution_clock::now();
+		bool bAnyMoved = false;
+		for (UINT ID : Store.GetChangedIDs())
+		{
+			const UINT Item = ItemByID[ID];
+			bAnyMoved |= BVH.UpdateItem(Item, SceneBVH::TransformBounds(BBox, Store.GetWorldMatrix(ID)));
+		}
+		if (bAnyMoved)
+		{
+			BVH.Refit();
+			Refits++;
+		}
+		auto End = std::chrono::high_resolution_clock::now();
+		if (!bStill)
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		if (bStill && (bAnyMoved || !Store.GetChangedIDs().empty()))
+			Mismatches++;
+
+		VisibleItems.clear();
+		BVH.QueryFrustum(ViewFrustum, VisibleItems);
+
+		FlatItems.clear();
+		for (UINT i = 0u; i < ValidateCount; i++)
+		{
+			const BVHBounds World = SceneBVH::TransformBounds(BBox, Store.GetWorldMatrix(IDs[i]));
+			const DirectX::XMFLOAT3 Center = { (World.Min.x + World.Max.x) * 0.5f, (World.Min.y + World.Max.y) * 0.5f, (World.Min.z + World.Max.z) * 0.5f };
+			const DirectX::XMFLOAT3 Extent = { (World.Max.x - World.Min.x) * 0.5f, (World.Max.y - World.Min.y) * 0.5f, (World.Max.z - World.Min.z) * 0.5f };
+			if (ViewFrustum.TestAABB(Center, Extent))
+				FlatItems.push_back(i);
+		}
+
+		std::sort(VisibleItems.begin(), VisibleItems.end());
+		std::vector<UINT> Difference;
+		std::set_symmetric_difference(VisibleItems.begin(), VisibleItems.end(), FlatItems.begin(), FlatItems.end(), std::back_inserter(Difference));
+		Mismatches += (UINT)Difference.size();
+	}
+	WriteRow(Out, "SceneBVH", "RefitChangedIDs", ValidateCount, Refits, Best);
+	WriteRow(Out, "SceneBVHValidate", "QueryVsFlat", ValidateCount, Mismatches, 0.0);
+}
+
+// unit cube with clockwise front faces when seen from outside, matching the raster state models are drawn with
+static void BuildBoxMesh(std::vector<DirectX::XMFLOAT3>& OutPositions, std::vector<UINT>& OutIndices)
+{
+	OutPositions.clear();
+	OutIndices.clear();
+	for (int i = 0; i < 8; i++)
+	{
+		OutPositions.push_back({ (i & 1) ? 0.5f : -0.5f, (i & 2) ? 0.5f : -0.5f, (i & 4) ? 0.5f : -0.5f });
+	}
+
+	const UINT Faces[6][4] = { { 0, 2, 3, 1 }, { 4, 5, 7, 6 }, { 0, 1, 5, 4 }, { 2, 6, 7, 3 }, { 0, 4, 6, 2 }, { 1, 3, 7, 5 } };
+	for (const UINT* Face : Faces)
+	{
+		DirectX::XMVECTOR p0 = DirectX::XMLoadFloat3(&OutPositions[Face[0]]);
+		DirectX::XMVECTOR p1 = DirectX::XMLoadFloat3(&OutPositions[Face[1]]);
+		DirectX::XMVECTOR p2 = DirectX::XMLoadFloat3(&OutPositions[Face[2]]);
+		DirectX::XMVECTOR Normal = DirectX::XMVector3Cross(DirectX::XMVectorSubtract(p1, p0), DirectX::XMVectorSubtract(p2, p0));
+		DirectX::XMVECTOR Outward = DirectX::XMVectorAdd(p0, p2);
+
+		if (DirectX::XMVectorGetX(DirectX::XMVector3Dot(Normal, Outward)) > 0.f)
+		{
+			OutIndices.insert(OutIndices.end(), { Face[0], Face[1], Face[2], Face[0], Face[2], Face[3] });
+		}
+		else
+		{
+			OutIndices.insert(OutIndices.end(), { Face[0], Face[2], Face[1], Face[0], Face[3], Face[2] });
+		}
+	}
+}
+
+void Benchmarks::RunOcclusionBenchmark(std::ofstream& Out)
+{
+	const UINT InstanceCount = 10000u;
+
+	DirectX::XMMATRIX View = DirectX::XMMatrixLookAtLH(DirectX::XMVectorSet(0.f, 0.f, -10.f, 1.f), DirectX::XMVectorSet(0.f, 0.f, 0.f, 1.f), DirectX::XMVectorSet(0.f, 1.f, 0.f, 0.f));
+	DirectX::XMMATRIX Proj = DirectX::XMMatrixPerspectiveFovLH(DirectX::XMConvertToRadians(60.f), 16.f / 9.f, 0.1f, 2000.f);
+	DirectX::XMMATRIX ViewProj = View * Proj;
+
+	std::vector<DirectX::XMFLOAT3> BoxPositions;
+	std::vector<UINT> BoxIndices;
+	BuildBoxMesh(BoxPositions, BoxIndices);
+
+	AABB BoxBounds;
+	BoxBounds.Min = { -0.5f, -0.5f, -0.5f };
+	BoxBounds.Max = { 0.5f, 0.5f, 0.5f };
+
+	// a wall of 4x4x1 boxes in front of a field of small boxes
+	std::vector<DirectX::XMMATRIX> Walls;
+	for (int x = -5; x < 5; x++)
+	{
+		for (int y = -3; y < 3; y++)
+		{
+			Walls.push_back(DirectX::XMMatrixScaling(4.f, 4.f, 1.f) * DirectX::XMMatrixTranslation(x * 4.f + 2.f, y * 4.f + 2.f, 20.f));
+		}
+	}
+
+	std::mt19937 Generator(1337u);
+	std::uniform_real_distribution<float> PositionX(-40.f, 40.f);
+	std::uniform_real_distribution<float> PositionY(-20.f, 20.f);
+	std::uniform_real_distribution<float> PositionZ(0.f, 100.f);
+
+	std::vector<DirectX::XMMATRIX> Instances;
+	for (UINT i = 0u; i < InstanceCount; i++)
+	{
+		Instances.push_back(DirectX::XMMatrixTranspose(DirectX::XMMatrixTranslation(PositionX(Generator), PositionY(Generator), PositionZ(Generator))));
+	}
+
+	OcclusionCuller Culler;
+	std::vector<float> ReferenceDepth;
+	const char* Variants[] = { "Reference", "SIMD" };
+	for (int v = 0; v < 2; v++)
+	{
+		Culler.SetUseReferenceRasterizer(v == 0);
+
+		double Best = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+		{
+			auto Start = std::chrono::high_resolution_clock::now();
+			Culler.BeginFrame(ViewProj);
+			for (const DirectX::XMMATRIX& Wall : Walls)
+			{
+				Culler.AddOccluder(BoxPositions.data(), sizeof(DirectX::XMFLOAT3), BoxIndices.data(), (UINT)BoxIndices.size(), Wall);
+			}
+			Culler.RasterizeOccluders();
+			auto End = std::chrono::high_resolution_clock::now();
+
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+
+		const std::vector<float>& Depth = Culler.GetDepthBuffer();
+		UINT Covered = (UINT)std::count_if(Depth.begin(), Depth.end(), [](float d) { return d < 1.f; });
+		WriteRow(Out, "OcclusionRaster", Variants[v], Culler.GetRasterizedTriangleCount(), Covered, Best);
+
+		if (v == 0)
+		{
+			ReferenceDepth = Depth;
+			continue;
+		}
+
+		// SIMD depth image against the scalar reference
+		UINT Mismatched = 0u;
+		for (size_t p = 0; p < Depth.size(); p++)
+		{
+			if (fabsf(Depth[p] - ReferenceDepth[p]) > 1e-6f)
+				Mismatched++;
+		}
+		WriteRow(Out, "OcclusionValidate", "SIMDvsReference", (UINT)Depth.size(), Mismatched, 0.0);
+	}
+
+	// a single plane facing the camera has the same depth everywhere, so the expected image is known exactly
+	{
+		const float PlaneZ = 50.f;
+		DirectX::XMFLOAT4 Expected;
+		DirectX::XMStoreFloat4(&Expected, DirectX::XMVector4Transform(DirectX::XMVectorSet(0.f, 0.f, PlaneZ, 1.f), ViewProj));
+		const float ExpectedDepth = Expected.z / Expected.w;
+
+		Culler.BeginFrame(ViewProj);
+		Culler.AddOccluder(BoxPositions.data(), sizeof(DirectX::XMFLOAT3), BoxIndices.data(), (UINT)BoxIndices.size(),
+			DirectX::XMMatrixScaling(1000.f, 1000.f, 1.f) * DirectX::XMMatrixTranslation(0.f, 0.f, PlaneZ + 0.5f));
+		Culler.RasterizeOccluders();
+
+		const std::vector<float>& Depth = Culler.GetDepthBuffer();
+		UINT Mismatched = (UINT)std::count_if(Depth.begin(), Depth.end(), [&](float d) { return fabsf(d - ExpectedDepth) > 1e-5f; });
+		WriteRow(Out, "OcclusionValidate", "PlaneDepth", (UINT)Depth.size(), Mismatched, 0.0);
+	}
+
+	Culler.BeginFrame(ViewProj);
+	for (const DirectX::XMMATRIX& Wall : Walls)
+	{
+		Culler.AddOccluder(BoxPositions.data(), sizeof(DirectX::XMFLOAT3), BoxIndices.data(), (UINT)BoxIndices.size(), Wall);
+	}
+	Culler.RasterizeOccluders();
+
+	UINT Occluded = 0u;
+	double Best = DBL_MAX;
+	std::vector<DirectX::XMMATRIX> Remaining;
+	for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+	{
+		Remaining = Instances;
+		auto Start = std::chrono::high_resolution_clock::now();
+		Occluded = Culler.CullInstances(BoxBounds, Remaining);
+		auto End = std::chrono::high_resolution_clock::now();
+
+		Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+	}
+	WriteRow(Out, "OcclusionTest", "HiZ", InstanceCount, Occluded, Best);
+
+	// nothing that is in front of the wall can be reported as occluded
+	UINT FalseOccluded = 0u;
+	for (const DirectX::XMMATRIX& Instance : Instances)
+	{
+		DirectX::XMFLOAT4X4 m;
+		DirectX::XMStoreFloat4x4(&m, Instance);
+		if (m.m[2][3] + 0.5f < 19.5f && Culler.IsOccluded(BoxBounds, Instance))
+			FalseOccluded++;
+	}
+	WriteRow(Out, "OcclusionValidate", "InFrontOfWall", InstanceCount, FalseOccluded, 0.0);
+}
+
+void Benchmarks::RunThreadPoolBenchmark(std::ofstream& Out)
+{
+	// small loops back to back are where a worker waking late for the last loop could run part of the next one or finish it early.
+	// Every index has to have run exactly once by the time ParallelFor returns
+	const UINT JobCount = 20000u;
+	const UINT MaxCount = 257u;
+	std::vector<std::atomic<UINT>> Runs(MaxCount);
+	UINT Mismatches = 0u;
+
+	auto Start = std::chrono::high_resolution_clock::now();
+	for (UINT j = 0u; j < JobCount; j++)
+	{
+		const UINT Count = 1u + (j * 37u) % MaxCount;
+		const UINT BatchSize = 1u + j % 8u;
+		for (UINT i = 0u; i < Count; i++)
+		{
+			Runs[i] = 0u;
+		}
+
+		ThreadPool::GetSingletonPtr()->ParallelFor(Count, BatchSize, [&](UINT Begin, UINT End)
+			{
+				for (UINT i = Begin; i < End; i++)
+				{
+					Runs[i]++;
+				}
+			});
+
+		for (UINT i = 0u; i < Count; i++)
+		{
+			Mismatches += Runs[i] == 1u ? 0u : 1u;
+		}
+	}
+	auto End = std::chrono::high_resolution_clock::now();
+
+	const double PerJob = std::chrono::duration<double, std::milli>(End - Start).count() / (double)JobCount;
+	WriteRow(Out, "ThreadPoolJob", "BackToBack", JobCount, ThreadPool::GetSingletonPtr()->GetWorkerCount() + 1u, PerJob);
+	WriteRow(Out, "ThreadPoolValidate", "BackToBack", JobCount, Mismatches, 0.0);
+
+	// a capped loop never has more threads inside it than the cap, the workers left out must not disturb the loops after it
+	const UINT Caps[] = { 1u, 2u, 4u, 16u };
+	for (UINT Cap : Caps)
+	{
+		const UINT CapJobCount = 2000u;
+		const UINT Count = 64u;
+		std::atomic<UINT> Inside = 0u;
+		std::atomic<UINT> Peak = 0u;
+		Mismatches = 0u;
+		for (UINT j = 0u; j < CapJobCount; j++)
+		{
+			for (UINT i = 0u; i < Count; i++)
+			{
+				Runs[i] = 0u;
+			}
+
+			ThreadPool::GetSingletonPtr()->ParallelFor(Count, 1u, [&](UINT Begin, UINT End)
+				{
+					const UINT Now = ++Inside;
+					UINT Seen = Peak;
+					while (Now > Seen && !Peak.compare_exchange_weak(Seen, Now))
+					{
+					}
+
+					for (UINT i = Begin; i < End; i++)
+					{
+						Runs[i]++;
+					}
+					Inside--;
+				}, Cap);
+
+			for (UINT i = 0u; i < Count; i++)
+			{
+				Mismatches += Runs[i] == 1u ? 0u : 1u;
+			}
+		}
+
+		const std::string Name = "Cap " + std::to_string(Cap);
+		WriteRow(Out, "ThreadPoolCapPeak", Name.c_str(), CapJobCount, Peak, 0.0);
+		WriteRow(Out, "ThreadPoolValidate", Name.c_str(), CapJobCount, Mismatches + (Peak > Cap ? 1u : 0u), 0.0);
+	}
+}
+
+void Benchmarks::RunCullingBatchBenchmark(std::ofstream& Out)
+{
+	// same instances split over more and more models, packing and culling should stay flat as the model count grows
+	const UINT TotalInstances = 65536u;
+	const UINT ModelCounts[] = { 1u, 16u, 256u, 1024u };
+	const UINT MeshesPerModel = 4u;
+
+	DirectX::XMMATRIX View = DirectX::XMMatrixLookAtLH(DirectX::XMVectorSet(0.f, 10.f, -250.f, 1.f), DirectX::XMVectorSet(0.f, 0.f, 0.f, 1.f), DirectX::XMVectorSet(0.f, 1.f, 0.f, 0.f));
+	DirectX::XMMATRIX Proj = DirectX::XMMatrixPerspectiveFovLH(DirectX::XMConvertToRadians(60.f), 16.f / 9.f, 0.1f, 2000.f);
+	DirectX::XMMATRIX ViewProj = View * Proj;
+
+	std::mt19937 Generator(1337u);
+	std::uniform_real_distribution<float> Position(-500.f, 500.f);
+	std::uniform_real_distribution<float> Size(0.5f, 4.f);
+
+	std::vector<DirectX::XMMATRIX> AllTransforms(TotalInstances);
+	for (DirectX::XMMATRIX& Transform : AllTransforms)
+	{
+		Transform = DirectX::XMMatrixTranspose(DirectX::XMMatrixTranslation(Position(Generator), Position(Generator) * 0.1f, Position(Generator)));
+	}
+
+	CullingBatch Batch;
+	CPUFrustumCuller Culler;
+	std::vector<DirectX::XMMATRIX> Culled;
+	std::vector<DirectX::XMMATRIX> Visible;
+	std::vector<CullingBatch::InstanceRange> Ranges;
+
+	for (UINT ModelCount : ModelCounts)
+	{
+		const UINT PerModel = TotalInstances / ModelCount;
+
+		std::vector<std::vector<DirectX::XMMATRIX>> ModelTransforms(ModelCount);
+		std::vector<AABB> ModelBounds(ModelCount);
+		for (UINT m = 0u; m < ModelCount; m++)
+		{
+			ModelTransforms[m].assign(AllTransforms.begin() + m * PerModel, AllTransforms.begin() + (m + 1u) * PerModel);
+
+			const float Extent = Size(Generator);
+			ModelBounds[m].Min = { -Extent, 0.f, -Extent };
+			ModelBounds[m].Max = { Extent, Extent * 2.f, Extent };
+		}
+
+		auto Pack = [&]()
+			{
+				Batch.Clear();
+				for (UINT m = 0u; m < ModelCount; m++)
+				{
+					UINT ModelIndex = Batch.AddModel("Model", ModelTransforms[m], ModelBounds[m]);
+					for (UINT d = 0u; d < MeshesPerModel; d++)
+						Batch.AddDraw(ModelIndex, 36u, d * 36u);
+				}
+			};
+
+		double BestPack = DBL_MAX;
+		double BestCull = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+		{
+			auto Start = std::chrono::high_resolution_clock::now();
+			Pack();
+			auto Mid = std::chrono::high_resolution_clock::now();
+			Batch.CullReference(ViewProj, Culled, Ranges);
+			auto End = std::chrono::high_resolution_clock::now();
+
+			BestPack = std::min(BestPack, std::chrono::duration<double, std::milli>(Mid - Start).count());
+			BestCull = std::min(BestCull, std::chrono::duration<double, std::milli>(End - Mid).count());
+		}
+
+		UINT VisibleCount = 0u;
+		for (const CullingBatch::InstanceRange& Range : Ranges)
+			VisibleCount += Range.Count;
+
+		WriteRow(Out, "CullingBatch", ("Pack" + std::to_string(ModelCount) + "Models").c_str(), TotalInstances, Batch.GetDrawCount(), BestPack);
+		WriteRow(Out, "CullingBatch", ("Reference" + std::to_string(ModelCount) + "Models").c_str(), TotalInstances, VisibleCount, BestCull);
+
+		// every range has to start at the model's input offset and hold exactly what culling the model on its own keeps, in order
+		UINT Mismatches = 0u;
+		for (UINT m = 0u; m < ModelCount; m++)
+		{
+			UINT Expected = Culler.Cull(ModelTransforms[m], ModelBounds[m], ViewProj, Visible);
+			if (Ranges[m].Offset != m * PerModel || Ranges[m].Count != Expected)
+			{
+				Mismatches++;
+				continue;
+			}
+
+			for (UINT v = 0u; v < Expected; v++)
+			{
+				if (memcmp(&Culled[Ranges[m].Offset + v], &Visible[v], sizeof(DirectX::XMMATRIX)) != 0)
+				{
+					Mismatches++;
+					break;
+				}
+			}
+		}
+
+		WriteRow(Out, "CullingBatchValidate", ("RangesVsPerModel" + std::to_string(ModelCount) + "Models").c_str(), ModelCount, Mismatches, 0.0);
+	}
+}
+
+void Benchmarks::RunInstanceBufferBenchmark(std::ofstream& Out)
+{
+	// instance count ramping up every frame to well past 100k, how often the buffers would get recreated along the way
+	const UINT RampTargets[] = { 10000u, 150000u, 3000000u };
+	const UINT RampFrames = 600u;
+
+	for (UINT Target : RampTargets)
+	{
+		InstanceBufferManager Manager;
+
+		auto Start = std::chrono::high_resolution_clock::now();
+		for (UINT Frame = 1u; Frame <= RampFrames; Frame++)
+		{
+			Manager.Reserve((UINT)((unsigned long long)Target * Frame / RampFrames));
+		}
+		auto End = std::chrono::high_resolution_clock::now();
+
+		// capacity has to cover the high water mark and stay within 2x of it (plus a page), or sit at the cap when that is further
+		UINT Errors = 0u;
+		const UINT Covered = std::min(Manager.GetHighWaterMark(), Manager.GetMaxCapacity());
+		if (Manager.GetCapacity() < Covered || Manager.GetCapacity() > Covered * 2u + InstanceBufferManager::PAGE_SIZE)
+			Errors++;
+		if (Manager.GetCapacity() % InstanceBufferManager::PAGE_SIZE != 0u)
+			Errors++;
+		// a buffer of transforms at that capacity has to be one D3D11 can create
+		if ((unsigned long long)Manager.GetCapacity() * sizeof(DirectX::XMMATRIX) > InstanceBufferManager::MAX_RESOURCE_BYTES)
+			Errors++;
+
+		WriteRow(Out, "InstanceBuffer", "GrowCount", Target, Manager.GetGrowCount(), std::chrono::duration<double, std::milli>(End - Start).count());
+		WriteRow(Out, "InstanceBufferValidate", "CapacityPolicy", Target, Errors, 0.0);
+	}
+
+	// chunks have to cover every instance exactly once, in order, and none may exceed a single dispatch
+	const UINT ChunkCounts[] = { 0u, 1u, 100000u, InstanceBufferManager::MAX_DISPATCH_INSTANCES, InstanceBufferManager::MAX_DISPATCH_INSTANCES + 1u, 5000000u };
+	std::vector<InstanceBufferManager::Chunk> Chunks;
+	for (UINT Count : ChunkCounts)
+	{
+		InstanceBufferManager::SplitIntoChunks(Count, InstanceBufferManager::MAX_DISPATCH_INSTANCES, Chunks);
+
+		UINT Errors = 0u;
+		UINT Expected = 0u;
+		for (const InstanceBufferManager::Chunk& Chunk : Chunks)
+		{
+			if (Chunk.Offset != Expected || Chunk.Count == 0u || Chunk.Count > InstanceBufferManager::MAX_DISPATCH_INSTANCES)
+				Errors++;
+			Expected = Chunk.Offset + Chunk.Count;
+		}
+		if (Expected != Count)
+			Errors++;
+
+		WriteRow(Out, "InstanceBufferValidate", ("Chunks" + std::to_string(Chunks.size())).c_str(), Count, Errors, 0.0);
+	}
+}
+
+void Benchmarks::RunTemporalCullingBenchmark(std::ofstream& Out)
+{
+	struct CameraPath
+	{
+		const char* Name;
+		float Speed;		// units per frame along the view direction
+		float YawSpeed;		// degrees per frame
+		float MovingFraction;	// instances that get a new transform every frame
+	};
+
+	// scripted stand ins for recorded paths, all start from the same spot and run the same number of frames
+	const CameraPath Paths[] = {
+		{ "Static", 0.f, 0.f, 0.f },
+		{ "Walk", 0.1f, 0.f, 0.f },
+		{ "SlowPan", 0.f, 0.1f, 0.f },
+		{ "WalkAndPan", 0.1f, 0.1f, 0.f },
+		{ "FastTurn", 0.f, 5.f, 0.f },
+		{ "WalkMoving1Pct", 0.1f, 0.f, 0.01f },
+	};
+	const UINT InstanceCount = 100000u;
+	const UINT FrameCount = 300u;
+
+	DirectX::XMMATRIX Proj = DirectX::XMMatrixPerspectiveFovLH(DirectX::XMConvertToRadians(60.f), 16.f / 9.f, 0.1f, 2000.f);
+
+	AABB BBox;
+	BBox.Min = { -1.f, 0.f, -1.f };
+	BBox.Max = { 1.f, 3.f, 1.f };
+
+	std::mt19937 Generator(1337u);
+	std::uniform_real_distribution<float> Position(-500.f, 500.f);
+	std::uniform_real_distribution<float> Unit(0.f, 1.f);
+
+	std::vector<DirectX::XMMATRIX> Initial(InstanceCount);
+	for (DirectX::XMMATRIX& Transform : Initial)
+	{
+		Transform = DirectX::XMMatrixTranspose(DirectX::XMMatrixTranslation(Position(Generator), Position(Generator) * 0.1f, Position(Generator)));
+	}
+
+	std::vector<DirectX::XMMATRIX> Transforms;
+	std::vector<unsigned char> ReferenceVisible(InstanceCount);
+	CPUFrustumCuller Reference;
+	Reference.SetSIMDPath(CPUFrustumCuller::SIMDPath::Scalar);
+
+	for (const CameraPath& Path : Paths)
+	{
+		Transforms = Initial;
+		TemporalFrustumCuller Temporal;
+		std::mt19937 MoveGenerator(7u);
+
+		unsigned long long TestsRun = 0ull;
+		unsigned long long TestsSkipped = 0ull;
+		UINT FalselyCulled = 0u;
+		UINT ExtraVisible = 0u;
+		double TemporalMs = 0.0;
+		double ReferenceMs = 0.0;
+
+		for (UINT Frame = 0u; Frame < FrameCount; Frame++)
+		{
+			const float Yaw = DirectX::XMConvertToRadians(Path.YawSpeed * (float)Frame);
+			const DirectX::XMVECTOR Forward = DirectX::XMVectorSet(sinf(Yaw), 0.f, cosf(Yaw), 0.f);
+			const DirectX::XMVECTOR Eye = DirectX::XMVectorSet(0.f, 10.f, -250.f + Path.Speed * (float)Frame, 1.f);
+			const DirectX::XMMATRIX View = DirectX::XMMatrixLookToLH(Eye, Forward, DirectX::XMVectorSet(0.f, 1.f, 0.f, 0.f));
+
+			const UINT MovingCount = (UINT)(Path.MovingFraction * (float)InstanceCount);
+			for (UINT m = 0u; m < MovingCount; m++)
+			{
+				UINT i = (UINT)(Unit(MoveGenerator) * (float)(InstanceCount - 1u));
+				Transforms[i] = DirectX::XMMatrixTranspose(DirectX::XMMatrixTranslation(Position(MoveGenerator), Position(MoveGenerator) * 0.1f, Position(MoveGenerator)));
+			}
+
+			auto Start = std::chrono::high_resolution_clock::now();
+			Temporal.Cull(Transforms.data(), InstanceCount, BBox, View, Proj);
+			auto Mid = std::chrono::high_resolution_clock::now();
+			Reference.Cull(Transforms.data(), InstanceCount, BBox, View * Proj);
+			auto End = std::chrono::high_resolution_clock::now();
+
+			TemporalMs += std::chrono::duration<double, std::milli>(Mid - Start).count();
+			ReferenceMs += std::chrono::duration<double, std::milli>(End - Mid).count();
+			TestsRun += Temporal.GetLastTestsRun();
+			TestsSkipped += Temporal.GetLastTestsSkipped();
+
+			// anything the reference keeps has to be kept, extra visible instances are allowed
+			std::fill(ReferenceVisible.begin(), ReferenceVisible.end(), (unsigned char)0u);
+			for (UINT i : Reference.GetVisibleIndices())
+				ReferenceVisible[i] = 1u;
+
+			UINT Matched = 0u;
+			for (UINT i : Temporal.GetVisibleIndices())
+				Matched += ReferenceVisible[i];
+
+			FalselyCulled += (UINT)Reference.GetVisibleIndices().size() - Matched;
+			ExtraVisible += (UINT)Temporal.GetVisibleIndices().size() - Matched;
+		}
+
+		const UINT SavedPercent = (UINT)(100ull * TestsSkipped / (TestsRun + TestsSkipped));
+		WriteRow(Out, "TemporalCulling", (std::string(Path.Name) + "TestsSavedPct").c_str(), InstanceCount, SavedPercent, TemporalMs / FrameCount);
+		WriteRow(Out, "TemporalCulling", (std::string(Path.Name) + "Reference").c_str(), InstanceCount, (UINT)Reference.GetVisibleIndices().size(), ReferenceMs / FrameCount);
+		WriteRow(Out, "TemporalCulling", (std::string(Path.Name) + "ExtraVisiblePerFrame").c_str(), InstanceCount, ExtraVisible / FrameCount, 0.0);
+		WriteRow(Out, "TemporalCullingValidate", (std::string(Path.Name) + "FalselyCulled").c_str(), InstanceCount, FalselyCulled, 0.0);
+	}
+}
+
+// strictly inside clip space with a small margin, so points that sit on a plane do not count against either side
+static bool IsInsideClipSpace(const DirectX::XMFLOAT3& Point, const DirectX::XMMATRIX& ViewProj, float Margin)
+{
+	DirectX::XMFLOAT4 Clip;
+	DirectX::XMStoreFloat4(&Clip, DirectX::XMVector4Transform(DirectX::XMVectorSet(Point.x, Point.y, Point.z, 1.f), ViewProj));
+	const float w = Clip.w * (1.f - Margin);
+	return Clip.w > 0.f && fabsf(Clip.x) < w && fabsf(Clip.y) < w && Clip.z > Clip.w * Margin && Clip.z < w;
+}
+
+void Benchmarks::RunFrustumBenchmark(std::ofstream& Out)
+{
+	const UINT ItemCount = 100003u;		// not a multiple of 4 so the tails of the batched tests get checked too
+	const UINT SampleCount = 5u;			// brute force samples per box axis for the conservativeness checks
+
+	std::mt19937 Generator(1337u);
+	std::uniform_real_distribution<float> Position(-600.f, 600.f);
+	std::uniform_real_distribution<float> Rotation(0.f, DirectX::XM_2PI);
+	std::uniform_real_distribution<float> Size(0.1f, 20.f);
+	std::uniform_real_distribution<float> Unit(0.f, 1.f);
+
+	// a few cameras looking in different directions, including straight down which breaks naive extraction
+	const DirectX::XMMATRIX Proj = DirectX::XMMatrixPerspectiveFovLH(DirectX::XMConvertToRadians(60.f), 16.f / 9.f, 0.1f, 1000.f);
+	const DirectX::XMMATRIX Views[] = {
+		DirectX::XMMatrixLookAtLH(DirectX::XMVectorSet(0.f, 10.f, -250.f, 1.f), DirectX::XMVectorSet(0.f, 0.f, 0.f, 1.f), DirectX::XMVectorSet(0.f, 1.f, 0.f, 0.f)),
+		DirectX::XMMatrixLookAtLH(DirectX::XMVectorSet(100.f, 300.f, 50.f, 1.f), DirectX::XMVectorSet(100.f, 0.f, 50.f, 1.f), DirectX::XMVectorSet(0.f, 0.f, 1.f, 0.f)),
+		DirectX::XMMatrixLookAtLH(DirectX::XMVectorSet(-200.f, 40.f, 200.f, 1.f), DirectX::XMVectorSet(300.f, -20.f, -100.f, 1.f), DirectX::XMVectorSet(0.f, 1.f, 0.f, 0.f)),
+	};
+	const char* ViewNames[] = { "Forward", "Down", "Diagonal" };
+
+	std::vector<float> CenterX(ItemCount), CenterY(ItemCount), CenterZ(ItemCount);
+	std::vector<float> ExtentX(ItemCount), ExtentY(ItemCount), ExtentZ(ItemCount), Radius(ItemCount);
+	std::vector<DirectX::XMMATRIX> Transforms(ItemCount);
+	for (UINT i = 0u; i < ItemCount; i++)
+	{
+		CenterX[i] = Position(Generator);
+		CenterY[i] = Position(Generator) * 0.2f;
+		CenterZ[i] = Position(Generator);
+		ExtentX[i] = Size(Generator);
+		ExtentY[i] = Size(Generator);
+		ExtentZ[i] = Size(Generator);
+		Radius[i] = Size(Generator);
+
+		DirectX::XMMATRIX World = DirectX::XMMatrixScaling(Size(Generator), Size(Generator), Size(Generator)) *
+			DirectX::XMMatrixRotationRollPitchYaw(Rotation(Generator), Rotation(Generator), Rotation(Generator)) *
+			DirectX::XMMatrixTranslation(CenterX[i], CenterY[i], CenterZ[i]);
+		Transforms[i] = DirectX::XMMatrixTranspose(World);
+	}
+
+	AABB LocalBounds;
+	LocalBounds.Min = { -1.f, 0.f, -1.f };
+	LocalBounds.Max = { 1.f, 3.f, 1.f };
+
+	std::vector<unsigned char> Visible(ItemCount);
+
+	for (int v = 0; v < 3; v++)
+	{
+		const DirectX::XMMATRIX ViewProj = Views[v] * Proj;
+		const Frustum ViewFrustum(ViewProj);
+		const std::string Name = ViewNames[v];
+
+		// points well inside or well outside clip space have to land on the same side of the extracted planes
+		UINT Errors = 0u;
+		for (UINT i = 0u; i < ItemCount; i++)
+		{
+			const DirectX::XMFLOAT3 Point = { CenterX[i], CenterY[i], CenterZ[i] };
+			const bool bInside = IsInsideClipSpace(Point, ViewProj, 0.001f);
+			const bool bOutside = !IsInsideClipSpace(Point, ViewProj, -0.001f);
+			if ((bInside && !ViewFrustum.TestPoint(Point)) || (bOutside && ViewFrustum.TestPoint(Point)))
+			{
+				Errors++;
+			}
+		}
+		WriteRow(Out, "FrustumValidate", (Name + "PlanesVsClipSpace").c_str(), ItemCount, Errors, 0.0);
+
+		// every corner lies on three planes and inside the other three
+		DirectX::XMFLOAT4 Corners[8];
+		ViewFrustum.GetCorners(Corners);
+		Errors = 0u;
+		for (int c = 0; c < 8; c++)
+		{
+			UINT OnPlane = 0u;
+			for (UINT p = 0u; p < Frustum::PlaneCount; p++)
+			{
+				const DirectX::XMFLOAT4& Plane = ViewFrustum.GetPlane(p);
+				const float Dist = Plane.x * Corners[c].x + Plane.y * Corners[c].y + Plane.z * Corners[c].z + Plane.w;
+				const float Tolerance = 1e-5f * (1.f + fabsf(Corners[c].x) + fabsf(Corners[c].y) + fabsf(Corners[c].z));
+				OnPlane += fabsf(Dist) < Tolerance ? 1u : 0u;
+				Errors += Dist < -Tolerance ? 1u : 0u;
+			}
+			Errors += OnPlane == 3u ? 0u : 1u;
+		}
+		WriteRow(Out, "FrustumValidate", (Name + "Corners").c_str(), 8u, Errors, 0.0);
+
+		// batched against scalar, has to be an exact match
+		Errors = 0u;
+		ViewFrustum.TestAABBs(CenterX.data(), CenterY.data(), CenterZ.data(), ExtentX.data(), ExtentY.data(), ExtentZ.data(), ItemCount, Visible.data());
+		for (UINT i = 0u; i < ItemCount; i++)
+		{
+			Errors += (Visible[i] != 0) != ViewFrustum.TestAABB({ CenterX[i], CenterY[i], CenterZ[i] }, { ExtentX[i], ExtentY[i], ExtentZ[i] }) ? 1u : 0u;
+		}
+		WriteRow(Out, "FrustumValidate", (Name + "AABBSIMDVsScalar").c_str(), ItemCount, Errors, 0.0);
+
+		Errors = 0u;
+		ViewFrustum.TestSpheres(CenterX.data(), CenterY.data(), CenterZ.data(), Radius.data(), ItemCount, Visible.data());
+		for (UINT i = 0u; i < ItemCount; i++)
+		{
+			Errors += (Visible[i] != 0) != ViewFrustum.TestSphere({ CenterX[i], CenterY[i], CenterZ[i] }, Radius[i]) ? 1u : 0u;
+		}
+		WriteRow(Out, "FrustumValidate", (Name + "SphereSIMDVsScalar").c_str(), ItemCount, Errors, 0.0);
+
+		Errors = 0u;
+		ViewFrustum.TestOBBs(LocalBounds, Transforms.data(), ItemCount, Visible.data());
+		for (UINT i = 0u; i < ItemCount; i++)
+		{
+			Errors += (Visible[i] != 0) != ViewFrustum.TestOBB(LocalBounds, Transforms[i]) ? 1u : 0u;
+		}
+		WriteRow(Out, "FrustumValidate", (Name + "OBBSIMDVsScalar").c_str(), ItemCount, Errors, 0.0);
+
+		// conservativeness, anything rejected must not have a single sample point inside the frustum
+		UINT FalselyCulledAABB = 0u;
+		UINT FalselyCulledOBB = 0u;
+		UINT FalselyCulledSphere = 0u;
+		UINT Rejected = 0u;
+		for (UINT i = 0u; i < ItemCount; i += 7u)
+		{
+			const DirectX::XMFLOAT3 Center = { CenterX[i], CenterY[i], CenterZ[i] };
+			const DirectX::XMFLOAT3 Extent = { ExtentX[i], ExtentY[i], ExtentZ[i] };
+			const bool bAABB = ViewFrustum.TestAABB(Center, Extent);
+			const bool bOBB = ViewFrustum.TestOBB(LocalBounds, Transforms[i]);
+			const bool bSphere = ViewFrustum.TestSphere(Center, Radius[i]);
+			Rejected += (bAABB ? 0u : 1u) + (bOBB ? 0u : 1u) + (bSphere ? 0u : 1u);
+
+			bool bAABBSampleInside = false;
+			bool bOBBSampleInside = false;
+			bool bSphereSampleInside = false;
+			for (UINT x = 0u; x < SampleCount; x++)
+			{
+				for (UINT y = 0u; y < SampleCount; y++)
+				{
+					for (UINT z = 0u; z < SampleCount; z++)
+					{
+						const float fx = (float)x / (SampleCount - 1u) * 2.f - 1.f;
+						const float fy = (float)y / (SampleCount - 1u) * 2.f - 1.f;
+						const float fz = (float)z / (SampleCount - 1u) * 2.f - 1.f;
+
+						bAABBSampleInside = bAABBSampleInside ||
+							IsInsideClipSpace({ Center.x + fx * Extent.x, Center.y + fy * Extent.y, Center.z + fz * Extent.z }, ViewProj, 0.f);
+
+						DirectX::XMFLOAT3 Local = { (LocalBounds.Min.x + LocalBounds.Max.x) * 0.5f + fx * (LocalBounds.Max.x - LocalBounds.Min.x) * 0.5f,
+							(LocalBounds.Min.y + LocalBounds.Max.y) * 0.5f + fy * (LocalBounds.Max.y - LocalBounds.Min.y) * 0.5f,
+							(LocalBounds.Min.z + LocalBounds.Max.z) * 0.5f + fz * (LocalBounds.Max.z - LocalBounds.Min.z) * 0.5f };
+						DirectX::XMFLOAT3 World;
+						DirectX::XMStoreFloat3(&World, DirectX::XMVector3Transform(DirectX::XMLoadFloat3(&Local), DirectX::XMMatrixTranspose(Transforms[i])));
+						bOBBSampleInside = bOBBSampleInside || IsInsideClipSpace(World, ViewProj, 0.f);
+
+						// samples inside the cube that are also inside the sphere
+						if (fx * fx + fy * fy + fz * fz <= 1.f)
+						{
+							bSphereSampleInside = bSphereSampleInside ||
+								IsInsideClipSpace({ Center.x + fx * Radius[i], Center.y + fy * Radius[i], Center.z + fz * Radius[i] }, ViewProj, 0.f);
+						}
+					}
+				}
+			}
+
+			FalselyCulledAABB += !bAABB && bAABBSampleInside ? 1u : 0u;
+			FalselyCulledOBB += !bOBB && bOBBSampleInside ? 1u : 0u;
+			FalselyCulledSphere += !bSphere && bSphereSampleInside ? 1u : 0u;
+		}
+		WriteRow(Out, "Frustum", (Name + "Rejected").c_str(), ItemCount / 7u * 3u, Rejected, 0.0);
+		WriteRow(Out, "FrustumValidate", (Name + "AABBFalselyCulled").c_str(), ItemCount / 7u, FalselyCulledAABB, 0.0);
+		WriteRow(Out, "FrustumValidate", (Name + "OBBFalselyCulled").c_str(), ItemCount / 7u, FalselyCulledOBB, 0.0);
+		WriteRow(Out, "FrustumValidate", (Name + "SphereFalselyCulled").c_str(), ItemCount / 7u, FalselyCulledSphere, 0.0);
+
+		// boxes much larger than the frustum with every corner outside of it, the old any corner inside test rejected these
+		Errors = 0u;
+		const UINT StraddleCount = 1000u;
+		for (UINT i = 0u; i < StraddleCount; i++)
+		{
+			const float Half = 1500.f + Unit(Generator) * 1000.f;
+			const DirectX::XMFLOAT3 Center = { Corners[0].x + (Unit(Generator) - 0.5f) * 200.f, Corners[0].y + (Unit(Generator) - 0.5f) * 200.f,
+				Corners[0].z + (Unit(Generator) - 0.5f) * 200.f };
+			Errors += ViewFrustum.TestAABB(Center, { Half, Half, Half }) ? 0u : 1u;
+			Errors += ViewFrustum.TestSphere(Center, Half) ? 0u : 1u;
+		}
+		WriteRow(Out, "FrustumValidate", (Name + "StraddlingRejected").c_str(), StraddleCount, Errors, 0.0);
+	}
+
+	// throughput, same scene for every variant
+	const Frustum ViewFrustum(Views[0] * Proj);
+	const char* Variants[] = { "AABBScalar", "AABBSIMD", "SphereScalar", "SphereSIMD", "OBBScalar", "OBBSIMD" };
+	for (int Variant = 0; Variant < 6; Variant++)
+	{
+		UINT VisibleCount = 0u;
+		double Best = DBL_MAX;
+		for (int Iteration = 0; Iteration < BENCHMARK_ITERATIONS; Iteration++)
+		{
+			auto Start = std::chrono::high_resolution_clock::now();
+			switch (Variant)
+			{
+			case 0:
+				for (UINT i = 0u; i < ItemCount; i++)
+					Visible[i] = ViewFrustum.TestAABB({ CenterX[i], CenterY[i], CenterZ[i] }, { ExtentX[i], ExtentY[i], ExtentZ[i] }) ? 1u : 0u;
+				break;
+			case 1:
+				ViewFrustum.TestAABBs(CenterX.data(), CenterY.data(), CenterZ.data(), ExtentX.data(), ExtentY.data(), ExtentZ.data(), ItemCount, Visible.data());
+				break;
+			case 2:
+				for (UINT i = 0u; i < ItemCount; i++)
+					Visible[i] = ViewFrustum.TestSphere({ CenterX[i], CenterY[i], CenterZ[i] }, Radius[i]) ? 1u : 0u;
+				break;
+			case 3:
+				ViewFrustum.TestSpheres(CenterX.data(), CenterY.data(), CenterZ.data(), Radius.data(), ItemCount, Visible.data());
+				break;
+			case 4:
+				for (UINT i = 0u; i < ItemCount; i++)
+					Visible[i] = ViewFrustum.TestOBB(LocalBounds, Transforms[i]) ? 1u : 0u;
+				break;
+			default:
+				ViewFrustum.TestOBBs(LocalBounds, Transforms.data(), ItemCount, Visible.data());
+				break;
+			}
+			auto End = std::chrono::high_resolution_clock::now();
+
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+
+		for (unsigned char bVisible : Visible)
+		{
+			VisibleCount += bVisible;
+		}
+		WriteRow(Out, "FrustumTest", Variants[Variant], ItemCount, VisibleCount, Best);
+	}
+}
+
+void Benchmarks::RunMultiViewBenchmark(std::ofstream& Out)
+{
+	const UINT ViewCounts[] = { 1u, 2u, 4u, 8u };
+	const UINT InstanceCount = 100000u;
+
+	const DirectX::XMMATRIX Proj = DirectX::XMMatrixPerspectiveFovLH(DirectX::XMConvertToRadians(60.f), 16.f / 9.f, 0.1f, 2000.f);
+
+	AABB BBox;
+	BBox.Min = { -1.f, 0.f, -1.f };
+	BBox.Max = { 1.f, 3.f, 1.f };
+
+	std::mt19937 Generator(1337u);
+	std::uniform_real_distribution<float> Position(-500.f, 500.f);
+	std::uniform_real_distribution<float> Rotation(0.f, DirectX::XM_2PI);
+
+	std::vector<DirectX::XMMATRIX> Transforms(InstanceCount);
+	for (DirectX::XMMATRIX& Transform : Transforms)
+	{
+		Transform = DirectX::XMMatrixTranspose(DirectX::XMMatrixRotationRollPitchYaw(0.f, Rotation(Generator), 0.f) *
+			DirectX::XMMatrixTranslation(Position(Generator), Position(Generator) * 0.1f, Position(Generator)));
+	}
+
+	// cameras spread around the scene looking inwards, standing in for a main view, picture in picture and debug views
+	std::vector<DirectX::XMMATRIX> ViewProjs;
+	for (UINT v = 0u; v < 8u; v++)
+	{
+		const float Angle = DirectX::XM_2PI * v / 8.f;
+		DirectX::XMVECTOR Eye = DirectX::XMVectorSet(cosf(Angle) * 300.f, 20.f + v * 10.f, sinf(Angle) * 300.f, 1.f);
+		ViewProjs.push_back(DirectX::XMMatrixLookAtLH(Eye, DirectX::XMVectorSet(0.f, 0.f, 0.f, 1.f), DirectX::XMVectorSet(0.f, 1.f, 0.f, 0.f)) * Proj);
+	}
+
+	MultiViewCuller MultiView;
+	MultiViewCuller Reference;
+	Reference.SetUseSIMD(false);
+	CPUFrustumCuller SingleView;
+	SingleView.SetSIMDPath(CPUFrustumCuller::SIMDPath::SSE);
+
+	for (UINT ViewCount : ViewCounts)
+	{
+		MultiView.SetViews(ViewProjs.data(), ViewCount);
+		Reference.SetViews(ViewProjs.data(), ViewCount);
+
+		UINT VisibleCount = 0u;
+		double BestMulti = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+		{
+			auto Start = std::chrono::high_resolution_clock::now();
+			VisibleCount = MultiView.Cull(Transforms.data(), InstanceCount, BBox);
+			auto End = std::chrono::high_resolution_clock::now();
+
+			BestMulti = std::min(BestMulti, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+
+		// the same views culled one after another, each pass rebuilds the world bounds from the transforms
+		UINT SeparateVisible = 0u;
+		double BestSeparate = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+		{
+			SeparateVisible = 0u;
+			auto Start = std::chrono::high_resolution_clock::now();
+			for (UINT v = 0u; v < ViewCount; v++)
+			{
+				SeparateVisible += SingleView.Cull(Transforms.data(), InstanceCount, BBox, ViewProjs[v]);
+			}
+			auto End = std::chrono::high_resolution_clock::now();
+
+			BestSeparate = std::min(BestSeparate, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+
+		const std::string Views = std::to_string(ViewCount) + "Views";
+		WriteRow(Out, "MultiView", ("SinglePass" + Views).c_str(), InstanceCount, VisibleCount, BestMulti);
+		WriteRow(Out, "MultiView", ("Separate" + Views).c_str(), InstanceCount, SeparateVisible, BestSeparate);
+
+		// every view's list has to match a separate scalar cull of that view, and the SIMD masks the scalar ones
+		UINT Mismatches = 0u;
+		Reference.Cull(Transforms.data(), InstanceCount, BBox);
+		SingleView.SetSIMDPath(CPUFrustumCuller::SIMDPath::Scalar);
+		for (UINT v = 0u; v < ViewCount; v++)
+		{
+			SingleView.Cull(Transforms.data(), InstanceCount, BBox, ViewProjs[v]);
+			Mismatches += SingleView.GetVisibleIndices() != MultiView.GetViewIndices(v) ? 1u : 0u;
+		}
+		SingleView.SetSIMDPath(CPUFrustumCuller::SIMDPath::SSE);
+
+		for (UINT i = 0u; i < InstanceCount; i++)
+		{
+			Mismatches += MultiView.GetMasks()[i] != Reference.GetMasks()[i] ? 1u : 0u;
+		}
+		WriteRow(Out, "MultiViewValidate", ("MasksVsSeparate" + Views).c_str(), InstanceCount, Mismatches, 0.0);
+	}
+}
+
+void Benchmarks::RunScreenSizeBenchmark(std::ofstream& Out)
+{
+	const float ViewportHeight = 1000.f;
+
+	// 90 degree vertical fov has a focal length of 1, so a pixel scale of exactly half the viewport height
+	const DirectX::XMMATRIX Proj = DirectX::XMMatrixPerspectiveFovLH(DirectX::XM_PIDIV2, 16.f / 9.f, 0.1f, 5000.f);
+	const DirectX::XMMATRIX View = DirectX::XMMatrixLookAtLH(DirectX::XMVectorSet(0.f, 0.f, 0.f, 1.f), DirectX::XMVectorSet(0.f, 0.f, 1.f, 1.f), DirectX::XMVectorSet(0.f, 1.f, 0.f, 0.f));
+	const DirectX::XMMATRIX ViewProj = View * Proj;
+	const float PixelScale = ScreenSizeCuller::ComputePixelScale(Proj, ViewportHeight);
+	WriteRow(Out, "ScreenSizeValidate", "PixelScale", 1u, fabsf(PixelScale - ViewportHeight * 0.5f) < 1e-3f ? 0u : 1u, 0.0);
+
+	// unit cube, bounding sphere radius sqrt(3)
+	AABB BBox;
+	BBox.Min = { -1.f, -1.f, -1.f };
+	BBox.Max = { 1.f, 1.f, 1.f };
+	const float SphereRadius = sqrtf(3.f);
+
+	ScreenSizeCuller Culler;
+	Culler.SetView({ 0.f, 0.f, 0.f }, PixelScale, 0.f);
+
+	// analytic cases on the view axis. The silhouette touches the sphere where the tangent from the eye does, projecting that point
+	// through the real view projection gives the expected radius without going through the culler's formula
+	struct AnalyticCase
+	{
+		float Distance;
+		DirectX::XMFLOAT3 Scale;
+	};
+	const AnalyticCase Cases[] = {
+		{ 10.f, { 1.f, 1.f, 1.f } },
+		{ 100.f, { 1.f, 1.f, 1.f } },
+		{ 1000.f, { 1.f, 1.f, 1.f } },
+		{ 3.f, { 1.f, 1.f, 1.f } },
+		{ 50.f, { 2.f, 2.f, 2.f } },
+		{ 50.f, { 1.f, 4.f, 0.5f } },		// non uniform, the largest scale bounds the sphere
+		{ 2000.f, { 0.1f, 0.1f, 0.1f } },
+	};
+
+	UINT Errors = 0u;
+	for (const AnalyticCase& Case : Cases)
+	{
+		const float MaxScale = Case.Scale.x > Case.Scale.y ? (Case.Scale.x > Case.Scale.z ? Case.Scale.x : Case.Scale.z) : (Case.Scale.y > Case.Scale.z ? Case.Scale.y : Case.Scale.z);
+		const float r = SphereRadius * MaxScale;
+		const float d = Case.Distance;
+
+		const DirectX::XMMATRIX Transform = DirectX::XMMatrixTranspose(DirectX::XMMatrixScaling(Case.Scale.x, Case.Scale.y, Case.Scale.z) *
+			DirectX::XMMatrixTranslation(0.f, 0.f, d));
+		std::vector<UINT> Indices = { 0u };
+		std::vector<UINT> Kept;
+		Culler.Cull(&Transform, BBox, Indices, Kept);
+
+		DirectX::XMFLOAT4 Clip;
+		DirectX::XMStoreFloat4(&Clip, DirectX::XMVector4Transform(DirectX::XMVectorSet(0.f, r * sqrtf(d * d - r * r) / d, d - r * r / d, 1.f), ViewProj));
+		const float Expected = Clip.y / Clip.w * ViewportHeight * 0.5f;
+
+		if (Kept.size() != 1u || fabsf(Culler.GetProjectedRadii()[0] - Expected) > Expected * 1e-3f)
+		{
+			Errors++;
+		}
+	}
+	WriteRow(Out, "ScreenSizeValidate", "AnalyticOnAxis", (UINT)(sizeof(Cases) / sizeof(Cases[0])), Errors, 0.0);
+
+	// camera inside the bounding sphere is always kept, whatever the threshold
+	{
+		Culler.SetView({ 0.f, 0.f, 0.f }, PixelScale, 1e6f);
+		const DirectX::XMMATRIX Transform = DirectX::XMMatrixTranspose(DirectX::XMMatrixTranslation(0.5f, 0.f, 0.5f));
+		std::vector<UINT> Indices = { 0u };
+		std::vector<UINT> Kept;
+		Culler.Cull(&Transform, BBox, Indices, Kept);
+		WriteRow(Out, "ScreenSizeValidate", "CameraInside", 1u, Kept.size() == 1u ? 0u : 1u, 0.0);
+	}
+
+	// instances walking away along the view axis have to switch from kept to dropped exactly where r / sqrt(d^2 - r^2) * scale = threshold
+	const float Thresholds[] = { 1.f, 2.f, 4.f, 8.f };
+	for (float Threshold : Thresholds)
+	{
+		const UINT Steps = 10000u;
+		std::vector<DirectX::XMMATRIX> Transforms(Steps);
+		std::vector<UINT> Indices(Steps);
+		for (UINT i = 0u; i < Steps; i++)
+		{
+			Transforms[i] = DirectX::XMMatrixTranspose(DirectX::XMMatrixTranslation(0.f, 0.f, 2.f + i * 0.5f));
+			Indices[i] = i;
+		}
+
+		Culler.SetView({ 0.f, 0.f, 0.f }, PixelScale, Threshold);
+		std::vector<UINT> Kept;
+		Culler.Cull(Transforms.data(), BBox, Indices, Kept);
+
+		const float Cutoff = sqrtf(SphereRadius * SphereRadius * PixelScale * PixelScale / (Threshold * Threshold) + SphereRadius * SphereRadius);
+		Errors = 0u;
+		UINT k = 0u;
+		for (UINT i = 0u; i < Steps; i++)
+		{
+			const float d = 2.f + i * 0.5f;
+			const bool bKept = k < Kept.size() && Kept[k] == i;
+			k += bKept ? 1u : 0u;
+			if (fabsf(d - Cutoff) < 1e-2f)
+				continue;
+
+			Errors += bKept != (d < Cutoff) ? 1u : 0u;
+		}
+		WriteRow(Out, "ScreenSizeValidate", ("Cutoff" + std::to_string((int)Threshold) + "px").c_str(), Steps, Errors, 0.0);
+	}
+
+	// cost on top of the frustum test for a scene of small scattered instances
+	const UINT InstanceCount = 100000u;
+	std::mt19937 Generator(1337u);
+	std::uniform_real_distribution<float> Position(-1500.f, 1500.f);
+	std::uniform_real_distribution<float> Scale(0.05f, 1.f);
+
+	std::vector<DirectX::XMMATRIX> Transforms(InstanceCount);
+	for (DirectX::XMMATRIX& Transform : Transforms)
+	{
+		const float s = Scale(Generator);
+		Transform = DirectX::XMMatrixTranspose(DirectX::XMMatrixScaling(s, s, s) *
+			DirectX::XMMatrixTranslation(Position(Generator), Position(Generator) * 0.05f, Position(Generator) + 1500.f));
+	}
+
+	CPUFrustumCuller FrustumCull;
+	FrustumCull.Cull(Transforms.data(), InstanceCount, BBox, ViewProj);
+	const std::vector<UINT> FrustumVisible = FrustumCull.GetVisibleIndices();
+	WriteRow(Out, "ScreenSize", "FrustumOnly", InstanceCount, (UINT)FrustumVisible.size(), 0.0);
+
+	for (float Threshold : Thresholds)
+	{
+		Culler.SetView({ 0.f, 0.f, 0.f }, PixelScale, Threshold);
+		std::vector<UINT> Kept;
+
+		double Best = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+		{
+			auto Start = std::chrono::high_resolution_clock::now();
+			Culler.Cull(Transforms.data(), BBox, FrustumVisible, Kept);
+			auto End = std::chrono::high_resolution_clock::now();
+
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+
+		WriteRow(Out, "ScreenSize", ("Min" + std::to_string((int)Threshold) + "px").c_str(), (UINT)FrustumVisible.size(), (UINT)Kept.size(), Best);
+	}
+}
+
+void Benchmarks::RunLandscapeQuadtreeBenchmark(std::ofstream& Out)
+{
+	const UINT MapSize = 512u;
+	const float ChunkSize = 25.f;
+	const float HeightDisplacement = 100.f;
+	const UINT ChunkDimensions[] = { 32u, 64u, 128u };
+
+	const std::vector<float> Heights = GenerateTestHeightmap(MapSize);
+
+	LandscapeQuadtree Quadtree;
+	std::vector<UINT> Visible;
+	std::vector<UINT> Reference;
+
+	for (UINT ChunkDimension : ChunkDimensions)
+	{
+		const UINT ChunkCount = ChunkDimension * ChunkDimension;
+		const float PlaneDimension = (float)ChunkDimension * ChunkSize;
+		const float HalfPlane = PlaneDimension * 0.5f;
+
+		double Best = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+		{
+			auto Start = std::chrono::high_resolution_clock::now();
+			Quadtree.Build(Heights.data(), MapSize, MapSize, ChunkDimension, ChunkSize);
+			auto End = std::chrono::high_resolution_clock::now();
+
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+		WriteRow(Out, "LandscapeQuadtree", "Build", ChunkCount, Quadtree.GetNodeCount(), Best);
+
+		// every surface point the shaders can produce inside a chunk has to be within its height range
+		UINT Errors = 0u;
+		const UINT SamplesPerAxis = 9u;
+		for (UINT ChunkID = 0u; ChunkID < ChunkCount; ChunkID++)
+		{
+			DirectX::XMFLOAT3 Center, Extent;
+			Quadtree.GetChunkBounds(ChunkID, HeightDisplacement, Center, Extent);
+			for (UINT sz = 0u; sz < SamplesPerAxis; sz++)
+			{
+				for (UINT sx = 0u; sx < SamplesPerAxis; sx++)
+				{
+					const float WorldX = Center.x - Extent.x + 2.f * Extent.x * (float)sx / (float)(SamplesPerAxis - 1u);
+					const float WorldZ = Center.z - Extent.z + 2.f * Extent.z * (float)sz / (float)(SamplesPerAxis - 1u);
+					const float y = SampleTestHeightmap(Heights, MapSize, (WorldX + HalfPlane) / PlaneDimension, 1.f - (WorldZ + HalfPlane) / PlaneDimension) * HeightDisplacement;
+					Errors += fabsf(y - Center.y) > Extent.y + 1e-3f ? 1u : 0u;
+				}
+			}
+		}
+		WriteRow(Out, "LandscapeQuadtreeValidate", "ChunkBounds", ChunkCount * SamplesPerAxis * SamplesPerAxis, Errors, 0.0);
+
+		// low camera on the plain edge looking across the landscape, turning around so some views look over the hills
+		const DirectX::XMMATRIX Proj = DirectX::XMMatrixPerspectiveFovLH(DirectX::XMConvertToRadians(60.f), 16.f / 9.f, 0.1f, PlaneDimension);
+		const float Yaws[] = { 0.f, 0.8f, 1.6f, 2.4f, 3.2f, 4.0f, 4.8f, 5.6f };
+
+		UINT Mismatches = 0u;
+		UINT NotTighter = 0u;
+		UINT QueryVisible = 0u, LooseVisible = 0u, NodesVisited = 0u;
+		double QueryBest = DBL_MAX, FlatBest = DBL_MAX;
+		for (float Yaw : Yaws)
+		{
+			const DirectX::XMVECTOR Eye = DirectX::XMVectorSet(-HalfPlane * 0.25f, 30.f, -HalfPlane * 0.25f, 1.f);
+			const DirectX::XMVECTOR Dir = DirectX::XMVectorSet(sinf(Yaw), -0.15f, cosf(Yaw), 0.f);
+			const DirectX::XMMATRIX View = DirectX::XMMatrixLookToLH(Eye, Dir, DirectX::XMVectorSet(0.f, 1.f, 0.f, 0.f));
+			const Frustum ViewFrustum(View * Proj);
+			DirectX::XMFLOAT3 ViewPos;
+			DirectX::XMStoreFloat3(&ViewPos, Eye);
+
+			double YawBest = DBL_MAX;
+			for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+			{
+				Visible.clear();
+				auto Start = std::chrono::high_resolution_clock::now();
+				Quadtree.Query(ViewFrustum, HeightDisplacement, ViewPos, Visible);
+				auto End = std::chrono::high_resolution_clock::now();
+
+				YawBest = std::min(YawBest, std::chrono::duration<double, std::milli>(End - Start).count());
+			}
+			QueryBest = std::min(QueryBest, YawBest);
+			QueryVisible += (UINT)Visible.size();
+			NodesVisited += Quadtree.GetLastNodesVisited();
+
+			// flat loop over the same tight bounds, the quadtree has to find exactly these
+			YawBest = DBL_MAX;
+			for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+			{
+				Reference.clear();
+				auto Start = std::chrono::high_resolution_clock::now();
+				for (UINT ChunkID = 0u; ChunkID < ChunkCount; ChunkID++)
+				{
+					DirectX::XMFLOAT3 Center, Extent;
+					Quadtree.GetChunkBounds(ChunkID, HeightDisplacement, Center, Extent);
+					if (ViewFrustum.TestAABB(Center, Extent))
+					{
+						Reference.push_back(ChunkID);
+					}
+				}
+				auto End = std::chrono::high_resolution_clock::now();
+
+				YawBest = std::min(YawBest, std::chrono::duration<double, std::milli>(End - Start).count());
+			}
+			FlatBest = std::min(FlatBest, YawBest);
+
+			std::vector<UINT> Sorted = Visible;
+			std::sort(Sorted.begin(), Sorted.end());
+			Mismatches += Sorted != Reference ? 1u : 0u;
+
+			// the old bounds, every chunk from 0 to the full displacement. Tight bounds must never keep a chunk these reject
+			for (UINT ChunkID : Sorted)
+			{
+				DirectX::XMFLOAT3 Center, Extent;
+				Quadtree.GetChunkBounds(ChunkID, HeightDisplacement, Center, Extent);
+				NotTighter += ViewFrustum.TestAABB({ Center.x, HeightDisplacement * 0.5f, Center.z }, { Extent.x, HeightDisplacement * 0.5f, Extent.z }) ? 0u : 1u;
+			}
+			for (UINT ChunkID = 0u; ChunkID < ChunkCount; ChunkID++)
+			{
+				DirectX::XMFLOAT3 Center, Extent;
+				Quadtree.GetChunkBounds(ChunkID, HeightDisplacement, Center, Extent);
+				LooseVisible += ViewFrustum.TestAABB({ Center.x, HeightDisplacement * 0.5f, Center.z }, { Extent.x, HeightDisplacement * 0.5f, Extent.z }) ? 1u : 0u;
+			}
+		}
+
+		const UINT ViewCount = (UINT)(sizeof(Yaws) / sizeof(Yaws[0]));
+		WriteRow(Out, "LandscapeQuadtreeValidate", "MatchesFlat", ChunkCount * ViewCount, Mismatches, 0.0);
+		WriteRow(Out, "LandscapeQuadtreeValidate", "InsideLooseBounds", QueryVisible, NotTighter, 0.0);
+		WriteRow(Out, "LandscapeQuadtree", "FlatLooseVisible", ChunkCount * ViewCount, LooseVisible, 0.0);
+		WriteRow(Out, "LandscapeQuadtree", "FlatTight", ChunkCount, QueryVisible / ViewCount, FlatBest);
+		WriteRow(Out, "LandscapeQuadtree", "Query", ChunkCount, QueryVisible / ViewCount, QueryBest);
+		WriteRow(Out, "LandscapeQuadtree", "NodesVisited", ChunkCount, NodesVisited / ViewCount, 0.0);
+	}
+}
+
+void Benchmarks::RunGrassTileBenchmark(std::ofstream& Out)
+{
+	const UINT MapSize = 512u;
+	const UINT ChunkDimension = 32u;
+	const float ChunkSize = 25.f;
+	const float HeightDisplacement = 100.f;
+	const UINT BladesPerAxis = 64u;
+	const UINT TileDimension = 8u;
+
+	const float PlaneDimension = (float)ChunkDimension * ChunkSize;
+	const float HalfPlane = PlaneDimension * 0.5f;
+	const std::vector<float> Heights = GenerateTestHeightmap(MapSize);
+
+	LandscapeQuadtree Quadtree;
+	Quadtree.Build(Heights.data(), MapSize, MapSize, ChunkDimension, ChunkSize);
+
+	// same grid as Landscape::GenerateChunkOffsets
+	std::vector<DirectX::XMFLOAT2> ChunkOffsets;
+	const float HalfCount = (float)ChunkDimension / 2.f;
+	for (UINT z = 0u; z < ChunkDimension; z++)
+	{
+		for (UINT x = 0u; x < ChunkDimension; x++)
+		{
+			ChunkOffsets.push_back({ ((int)x - HalfCount) * ChunkSize + ChunkSize * 0.5f, ((int)z - HalfCount) * ChunkSize + ChunkSize * 0.5f });
+		}
+	}
+
+	// same jittered layout as Landscape::GenerateGrassOffsets with a fixed seed
+	std::mt19937 Generator(1337u);
+	const float Spacing = ChunkSize / (float)BladesPerAxis;
+	std::uniform_real_distribution<float> Jitter(0.f, Spacing);
+	std::vector<DirectX::XMFLOAT2> GrassOffsets;
+	for (UINT x = 0u; x < BladesPerAxis; x++)
+	{
+		for (UINT z = 0u; z < BladesPerAxis; z++)
+		{
+			GrassOffsets.push_back({ -ChunkSize * 0.5f + x * Spacing + Jitter(Generator), -ChunkSize * 0.5f + z * Spacing + Jitter(Generator) });
+		}
+	}
+
+	// roughly the bounds Grass::GenerateAABB ends up with
+	AABB BladeBounds;
+	BladeBounds.Min = { -0.56f, 0.f, -0.56f };
+	BladeBounds.Max = { 0.56f, 2.f, 0.56f };
+	const DirectX::XMFLOAT3 BladeCenter = { 0.f, 1.f, 0.f };
+	const DirectX::XMFLOAT3 BladeExtent = { 0.56f, 1.f, 0.56f };
+
+	GrassTileCuller TileCuller;
+	double Best = DBL_MAX;
+	for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+	{
+		std::vector<DirectX::XMFLOAT2> Offsets = GrassOffsets;
+		auto Start = std::chrono::high_resolution_clock::now();
+		TileCuller.Build(Offsets, BladesPerAxis, TileDimension, BladeBounds, Heights.data(), MapSize, MapSize, ChunkDimension, ChunkSize);
+		auto End = std::chrono::high_resolution_clock::now();
+
+		Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+	}
+	TileCuller.Build(GrassOffsets, BladesPerAxis, TileDimension, BladeBounds, Heights.data(), MapSize, MapSize, ChunkDimension, ChunkSize);
+	const UINT TileCount = TileCuller.GetTileCount();
+	const UINT BladesPerChunk = (UINT)GrassOffsets.size();
+	WriteRow(Out, "GrassTiles", "Build", ChunkDimension * ChunkDimension * TileCount, TileCount, Best);
+
+	// the per blade test of FrustumCullGrass, heightmap sampled at the blade position
+	auto IsBladeVisible = [&](const Frustum& ViewFrustum, const DirectX::XMFLOAT2& ChunkOffset, const DirectX::XMFLOAT2& GrassOffset)
+	{
+		const float WorldX = ChunkOffset.x + GrassOffset.x;
+		const float WorldZ = ChunkOffset.y + GrassOffset.y;
+		const float y = SampleTestHeightmap(Heights, MapSize, (WorldX + HalfPlane) / PlaneDimension, 1.f - (WorldZ + HalfPlane) / PlaneDimension) * HeightDisplacement;
+		return ViewFrustum.TestAABB({ BladeCenter.x + WorldX, BladeCenter.y + y, BladeCenter.z + WorldZ }, BladeExtent);
+	};
+
+	// standing in the grass on the plain and on the hills, the grass draw distance is much shorter than the landscape's
+	const DirectX::XMMATRIX Proj = DirectX::XMMatrixPerspectiveFovLH(DirectX::XMConvertToRadians(60.f), 16.f / 9.f, 0.1f, 250.f);
+	const DirectX::XMFLOAT3 Eyes[] = { { -HalfPlane * 0.5f, 20.f, -HalfPlane * 0.25f }, { HalfPlane * 0.5f, 80.f, HalfPlane * 0.25f } };
+	const float Yaws[] = { 0.f, 1.2f, 2.4f, 3.6f, 4.8f };
+
+	std::vector<UINT> VisibleChunks;
+	std::vector<GrassTileCuller::TileEntry> Tiles;
+	std::vector<UINT> TileStates;
+	UINT Errors = 0u, Mismatches = 0u;
+	UINT BladesTotal = 0u, BladeTestsAvoided = 0u, VisibleBlades = 0u;
+	UINT TilesCulled = 0u, TilesInside = 0u, TilesPartial = 0u;
+	double FlatTotal = 0.0, TiledTotal = 0.0;
+	for (const DirectX::XMFLOAT3& EyePos : Eyes)
+	{
+		for (float Yaw : Yaws)
+		{
+			const DirectX::XMVECTOR Eye = DirectX::XMLoadFloat3(&EyePos);
+			const DirectX::XMVECTOR Dir = DirectX::XMVectorSet(sinf(Yaw), -0.2f, cosf(Yaw), 0.f);
+			const Frustum ViewFrustum(DirectX::XMMatrixLookToLH(Eye, Dir, DirectX::XMVectorSet(0.f, 1.f, 0.f, 0.f)) * Proj);
+
+			VisibleChunks.clear();
+			Quadtree.Query(ViewFrustum, HeightDisplacement, EyePos, VisibleChunks);
+			const UINT VisibleCount = (UINT)VisibleChunks.size();
+
+			// every blade of every visible chunk, what the GPU does without tiles
+			UINT FlatVisible = 0u;
+			double YawBest = DBL_MAX;
+			for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+			{
+				FlatVisible = 0u;
+				auto Start = std::chrono::high_resolution_clock::now();
+				for (UINT ChunkID : VisibleChunks)
+				{
+					for (const DirectX::XMFLOAT2& GrassOffset : GrassOffsets)
+					{
+						FlatVisible += IsBladeVisible(ViewFrustum, ChunkOffsets[ChunkID], GrassOffset) ? 1u : 0u;
+					}
+				}
+				auto End = std::chrono::high_resolution_clock::now();
+
+				YawBest = std::min(YawBest, std::chrono::duration<double, std::milli>(End - Start).count());
+			}
+			FlatTotal += YawBest;
+
+			// classify, then accept inside tiles whole and test only the blades of partial ones
+			UINT TiledVisible = 0u;
+			YawBest = DBL_MAX;
+			for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+			{
+				TiledVisible = 0u;
+				auto Start = std::chrono::high_resolution_clock::now();
+				TileCuller.Classify(ViewFrustum, VisibleChunks, VisibleCount, ChunkOffsets, HeightDisplacement, Tiles);
+				for (const GrassTileCuller::TileEntry& Tile : Tiles)
+				{
+					if (Tile.bFullyInside)
+					{
+						TiledVisible += Tile.BladeCount;
+						continue;
+					}
+
+					const DirectX::XMFLOAT2& ChunkOffset = ChunkOffsets[VisibleChunks[Tile.ChunkSlot]];
+					for (UINT b = Tile.FirstBlade; b < Tile.FirstBlade + Tile.BladeCount; b++)
+					{
+						TiledVisible += IsBladeVisible(ViewFrustum, ChunkOffset, GrassOffsets[b]) ? 1u : 0u;
+					}
+				}
+				auto End = std::chrono::high_resolution_clock::now();
+
+				YawBest = std::min(YawBest, std::chrono::duration<double, std::milli>(End - Start).count());
+			}
+			TiledTotal += YawBest;
+			Mismatches += FlatVisible != TiledVisible ? 1u : 0u;
+
+			// no blade of a culled tile may be visible and every blade of an inside tile has to be. 0 culled, 1 inside, 2 partial
+			TileStates.assign(VisibleCount * TileCount, 0u);
+			UINT ListIndex = 0u;
+			for (UINT Slot = 0u; Slot < VisibleCount; Slot++)
+			{
+				for (UINT t = 0u; t < TileCount; t++)
+				{
+					if (ListIndex < (UINT)Tiles.size() && Tiles[ListIndex].ChunkSlot == Slot && Tiles[ListIndex].FirstBlade == TileCuller.GetTileFirstBlade(t))
+					{
+						TileStates[Slot * TileCount + t] = Tiles[ListIndex].bFullyInside ? 1u : 2u;
+						ListIndex++;
+					}
+				}
+			}
+			for (UINT Slot = 0u; Slot < VisibleCount; Slot++)
+			{
+				const DirectX::XMFLOAT2& ChunkOffset = ChunkOffsets[VisibleChunks[Slot]];
+				for (UINT t = 0u; t < TileCount; t++)
+				{
+					const UINT State = TileStates[Slot * TileCount + t];
+					if (State == 2u)
+						continue;
+
+					for (UINT b = TileCuller.GetTileFirstBlade(t); b < TileCuller.GetTileFirstBlade(t) + TileCuller.GetTileBladeCount(t); b++)
+					{
+						Errors += IsBladeVisible(ViewFrustum, ChunkOffset, GrassOffsets[b]) != (State == 1u) ? 1u : 0u;
+					}
+				}
+			}
+
+			const GrassTileCuller::ClassifyStats& Stats = TileCuller.GetLastStats();
+			BladesTotal += VisibleCount * BladesPerChunk;
+			BladeTestsAvoided += Stats.BladeTestsAvoided;
+			VisibleBlades += TiledVisible;
+			TilesCulled += Stats.TilesCulled;
+			TilesInside += Stats.TilesInside;
+			TilesPartial += Stats.TilesPartial;
+		}
+	}
+
+	const UINT ViewCount = (UINT)(sizeof(Eyes) / sizeof(Eyes[0]) * sizeof(Yaws) / sizeof(Yaws[0]));
+	WriteRow(Out, "GrassTilesValidate", "TileMatchesBlades", BladesTotal, Errors, 0.0);
+	WriteRow(Out, "GrassTilesValidate", "MatchesPerBlade", ViewCount, Mismatches, 0.0);
+	WriteRow(Out, "GrassTiles", "PerBlade", BladesTotal / ViewCount, VisibleBlades / ViewCount, FlatTotal / ViewCount);
+	WriteRow(Out, "GrassTiles", "Tiled", BladesTotal / ViewCount, VisibleBlades / ViewCount, TiledTotal / ViewCount);
+	WriteRow(Out, "GrassTiles", "BladeTestsAvoided", BladesTotal / ViewCount, BladeTestsAvoided / ViewCount, 0.0);
+	WriteRow(Out, "GrassTiles", "TilesCulled", (TilesCulled + TilesInside + TilesPartial) / ViewCount, TilesCulled / ViewCount, 0.0);
+	WriteRow(Out, "GrassTiles", "TilesInside", (TilesCulled + TilesInside + TilesPartial) / ViewCount, TilesInside / ViewCount, 0.0);
+	WriteRow(Out, "GrassTiles", "TilesPartial", (TilesCulled + TilesInside + TilesPartial) / ViewCount, TilesPartial / ViewCount, 0.0);
+}
+
+// what Component::GetAccumulatedWorldMatrix did before the TransformStore, rebuilt from the root for every call
+struct RecursiveTransformNode
+{
+	Transform Local;
+	const RecursiveTransformNode* pOwner = nullptr;
+
+	DirectX::XMMATRIX GetAccumulatedWorldMatrix() const
+	{
+		if (pOwner == nullptr)
+		{
+			return TransformStore::ComposeLocalMatrix(Local.Position, Local.Rotation, Local.Scale);
+		}
+
+		DirectX::XMMATRIX Accumulated = pOwner->GetAccumulatedWorldMatrix();
+		Accumulated *= TransformStore::ComposeLocalMatrix(Local.Position, Local.Rotation, Local.Scale);
+		return Accumulated;
+	}
+};
+
+void Benchmarks::RunTransformStoreBenchmark(std::ofstream& Out)
+{
+	const UINT ObjectCounts[] = { 1000u, 10000u, 100000u };
+	// every group is a root with a chain of children under it, like a model with a couple of attached parts
+	const UINT GroupSize = 4u;
+
+	std::mt19937 Generator(1337u);
+	std::uniform_real_distribution<float> Position(-500.f, 500.f);
+	std::uniform_real_distribution<float> Rotation(0.f, 360.f);
+	std::uniform_real_distribution<float> Scale(0.5f, 2.f);
+
+	for (UINT Count : ObjectCounts)
+	{
+		std::vector<RecursiveTransformNode> Nodes(Count);
+		TransformStore Store;
+		std::vector<UINT> IDs(Count);
+
+		// created in a shuffled order so the store has to sort parents in front of their children
+		std::vector<UINT> CreateOrder(Count);
+		for (UINT i = 0u; i < Count; i++)
+		{
+			CreateOrder[i] = i;
+		}
+		std::shuffle(CreateOrder.begin(), CreateOrder.end(), Generator);
+		for (UINT i : CreateOrder)
+		{
+			IDs[i] = Store.Create();
+		}
+
+		for (UINT i = 0u; i < Count; i++)
+		{
+			Transform& Local = Nodes[i].Local;
+			Local.Position = { Position(Generator), Position(Generator) * 0.1f, Position(Generator) };
+			Local.Rotation = { Rotation(Generator), Rotation(Generator), Rotation(Generator) };
+			Local.Scale = { Scale(Generator), Scale(Generator), Scale(Generator) };
+
+			Store.SetPosition(IDs[i], Local.Position);
+			Store.SetRotation(IDs[i], Local.Rotation);
+			Store.SetScale(IDs[i], Local.Scale);
+			if (i % GroupSize != 0u)
+			{
+				Nodes[i].pOwner = &Nodes[i - 1u];
+				Store.SetParent(IDs[i], IDs[i - 1u]);
+			}
+		}
+
+		// the per frame gather, every object ends up transposed in an instance list like ModelData::m_Transforms
+		std::vector<DirectX::XMMATRIX> Reference;
+		Reference.reserve(Count);
+		double Best = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+		{
+			Reference.clear();
+			auto Start = std::chrono::high_resolution_clock::now();
+			for (const RecursiveTransformNode& Node : Nodes)
+			{
+				Reference.push_back(DirectX::XMMatrixTranspose(Node.GetAccumulatedWorldMatrix()));
+			}
+			auto End = std::chrono::high_resolution_clock::now();
+
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+		WriteRow(Out, "TransformStore", "Recursive", Count, Count, Best);
+
+		std::vector<DirectX::XMMATRIX> Gathered;
+		Gathered.reserve(Count);
+		const char* VariantNames[] = { "Linear", "Threaded" };
+		for (int Threaded = 0; Threaded < 2; Threaded++)
+		{
+			Store.SetUseThreads(Threaded == 1);
+			Store.UpdateWorldMatrices();
+
+			// everything dirty, the cost when the whole scene moves
+			double UpdateBest = DBL_MAX;
+			Best = DBL_MAX;
+			for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+			{
+				Gathered.clear();
+				Store.MarkAllDirty();
+				auto Start = std::chrono::high_resolution_clock::now();
+				Store.UpdateWorldMatrices();
+				auto Updated = std::chrono::high_resolution_clock::now();
+				for (UINT ID : IDs)
+				{
+					Gathered.push_back(DirectX::XMMatrixTranspose(Store.GetWorldMatrix(ID)));
+				}
+				auto End = std::chrono::high_resolution_clock::now();
+
+				UpdateBest = std::min(UpdateBest, std::chrono::duration<double, std::milli>(Updated - Start).count());
+				Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+			}
+			WriteRow(Out, "TransformStore", VariantNames[Threaded], Count, Store.GetDepthCount(), UpdateBest);
+			WriteRow(Out, "TransformStore", Threaded == 1 ? "ThreadedAndGather" : "LinearAndGather", Count, Count, Best);
+
+			// the closed form rotation and XMVectorSinCos only differ from the old path by rounding
+			UINT Errors = 0u;
+			for (UINT i = 0u; i < Count; i++)
+			{
+				const float* a = reinterpret_cast<const float*>(&Gathered[i]);
+				const float* b = reinterpret_cast<const float*>(&Reference[i]);
+				for (int e = 0; e < 16; e++)
+				{
+					if (fabsf(a[e] - b[e]) > 1e-3f * (1.f + fabsf(b[e])))
+					{
+						Errors++;
+						break;
+					}
+				}
+			}
+			WriteRow(Out, "TransformStoreValidate", VariantNames[Threaded], Count, Errors, 0.0);
+		}
+
+		// mostly static scene, a few percent of the transforms move every frame. Half of them are roots so their children follow
+		const UINT MovedCount = Count / 20u;
+		std::vector<UINT> Moved(MovedCount);
+		Store.SetUseThreads(true);
+		Store.UpdateWorldMatrices();
+
+		double UpdateBest = DBL_MAX;
+		UINT Recomputed = 0u;
+		for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+		{
+			for (UINT m = 0u; m < MovedCount; m++)
+			{
+				Moved[m] = (UINT)(Generator() % Count);
+				if (m % 2u == 0u)
+				{
+					Moved[m] -= Moved[m] % GroupSize;
+				}
+			}
+
+			for (UINT Index : Moved)
+			{
+				Transform& Local = Nodes[Index].Local;
+				Local.Position.y += 0.1f;
+				Local.Rotation.y = fmodf(Local.Rotation.y + 1.f, 360.f);
+				Store.SetPosition(IDs[Index], Local.Position);
+				Store.SetRotation(IDs[Index], Local.Rotation);
+			}
+
+			auto Start = std::chrono::high_resolution_clock::now();
+			Store.UpdateWorldMatrices();
+			auto End = std::chrono::high_resolution_clock::now();
+
+			UpdateBest = std::min(UpdateBest, std::chrono::duration<double, std::milli>(End - Start).count());
+			Recomputed = Store.GetLastRecomputedCount();
+		}
+		WriteRow(Out, "TransformStore", "Moved5Pct", Count, Recomputed, UpdateBest);
+
+		Best = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+		{
+			auto Start = std::chrono::high_resolution_clock::now();
+			Store.UpdateWorldMatrices();
+			auto End = std::chrono::high_resolution_clock::now();
+
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+		WriteRow(Out, "TransformStore", "NothingMoved", Count, Store.GetLastRecomputedCount(), Best);
+
+		// the cached matrices have to match a full recursive rebuild after all those partial updates, children of moved roots included
+		UINT Errors = 0u;
+		for (UINT i = 0u; i < Count; i++)
+		{
+			const DirectX::XMMATRIX Expected = DirectX::XMMatrixTranspose(Nodes[i].GetAccumulatedWorldMatrix());
+			const float* a = reinterpret_cast<const float*>(&Store.GetTransposedWorldMatrix(IDs[i]));
+			const float* b = reinterpret_cast<const float*>(&Expected);
+			for (int e = 0; e < 16; e++)
+			{
+				if (fabsf(a[e] - b[e]) > 1e-3f * (1.f + fabsf(b[e])))
+				{
+					Errors++;
+					break;
+				}
+			}
+		}
+		WriteRow(Out, "TransformStoreValidate", "DirtyPropagation", Count, Errors, 0.0);
+
+		// moving one child to another group forces a full re-sort before the update
+		Best = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+		{
+			const UINT Child = 1u + (UINT)(Generator() % (Count / GroupSize)) * GroupSize;
+			auto Start = std::chrono::high_resolution_clock::now();
+			Store.SetParent(IDs[Child], IDs[(Child + GroupSize) % Count]);
+			Store.UpdateWorldMatrices();
+			auto End = std::chrono::high_resolution_clock::now();
+			Store.SetParent(IDs[Child], IDs[Child - 1u]);
+
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+		WriteRow(Out, "TransformStore", "ReparentAndUpdate", Count, Store.GetDepthCount(), Best);
+	}
+
+	// releasing a parent turns its children into roots at their local transform, and whatever gets the id next must not adopt them
+	TransformStore Store;
+	const UINT Parent = Store.Create();
+	const UINT Children[] = { Store.Create(), Store.Create(), Store.Create() };
+	Store.SetPosition(Parent, { 100.f, 0.f, 0.f });
+	for (UINT c = 0u; c < 3u; c++)
+	{
+		Store.SetPosition(Children[c], { 0.f, (float)c, 0.f });
+		Store.SetParent(Children[c], Parent);
+	}
+	Store.UpdateWorldMatrices();
+
+	// the middle child goes first so the parent's child list has to have been unlinked around it
+	Store.Release(Children[1]);
+	Store.Release(Parent);
+	const UINT Reused = Store.Create();
+	Store.SetPosition(Reused, { -50.f, 0.f, 0.f });
+	Store.UpdateWorldMatrices();
+
+	UINT Errors = Reused == Parent ? 0u : 1u;
+	for (UINT c = 0u; c < 3u; c += 2u)
+	{
+		// translation row of the row-vector world matrix
+		const float* World = reinterpret_cast<const float*>(&Store.GetWorldMatrix(Children[c]));
+		if (Store.GetParent(Children[c]) != TransformStore::INVALID_ID || World[12] != 0.f || World[13] != (float)c || World[14] != 0.f)
+			Errors++;
+	}
+	WriteRow(Out, "TransformStoreValidate", "ReleasedParentOrphans", 2u, Errors, 0.0);
+}
+
+void Benchmarks::RunInstanceGatherBenchmark(std::ofstream& Out)
+{
+	const UINT ObjectCounts[] = { 10000u, 100000u };
+	const UINT ThreadCounts[] = { 1u, 2u, 4u, 8u, 16u };
+	const UINT ModelCount = 16u;
+
+	std::mt19937 Generator(1337u);
+	std::uniform_real_distribution<float> Position(-500.f, 500.f);
+	std::uniform_real_distribution<float> Rotation(0.f, 360.f);
+
+	for (UINT Count : ObjectCounts)
+	{
+		TransformStore Store;
+		std::vector<InstanceGatherer::Item> Items(Count);
+		for (UINT i = 0u; i < Count; i++)
+		{
+			const UINT ID = Store.Create();
+			Store.SetPosition(ID, { Position(Generator), 0.f, Position(Generator) });
+			Store.SetRotation(ID, { 0.f, Rotation(Generator), 0.f });
+
+			// models interleaved in scene order, the way objects of different models are mixed in m_GameObjects
+			Items[i] = { (UINT)(Generator() % ModelCount), ID };
+		}
+		Store.UpdateWorldMatrices();
+
+		// what Model::SendTransformToModel did, one push_back per object into its model's list
+		std::vector<std::vector<DirectX::XMMATRIX>> Reference(ModelCount);
+		double Best = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+		{
+			for (std::vector<DirectX::XMMATRIX>& List : Reference)
+			{
+				List.clear();
+			}
+
+			auto Start = std::chrono::high_resolution_clock::now();
+			for (const InstanceGatherer::Item& It : Items)
+			{
+				Reference[It.Output].push_back(Store.GetTransposedWorldMatrix(It.TransformID));
+			}
+			auto End = std::chrono::high_resolution_clock::now();
+
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+		WriteRow(Out, "InstanceGather", "Serial", Count, ModelCount, Best);
+
+		std::vector<std::vector<DirectX::XMMATRIX>> Lists(ModelCount);
+		std::vector<std::vector<DirectX::XMMATRIX>*> Outputs;
+		for (std::vector<DirectX::XMMATRIX>& List : Lists)
+		{
+			Outputs.push_back(&List);
+		}
+
+		InstanceGatherer Gatherer;
+		for (UINT ThreadCount : ThreadCounts)
+		{
+			Gatherer.SetThreadCount(ThreadCount);
+
+			Best = DBL_MAX;
+			for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+			{
+				for (std::vector<DirectX::XMMATRIX>& List : Lists)
+				{
+					List.clear();
+				}
+
+				auto Start = std::chrono::high_resolution_clock::now();
+				Gatherer.Gather(Store, Items, Outputs);
+				auto End = std::chrono::high_resolution_clock::now();
+
+				Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+			}
+
+			// has to be bit for bit the serial result, whatever the thread count
+			UINT Mismatches = 0u;
+			for (UINT m = 0u; m < ModelCount; m++)
+			{
+				const bool bSame = Lists[m].size() == Reference[m].size() &&
+					memcmp(Lists[m].data(), Reference[m].data(), sizeof(DirectX::XMMATRIX) * Lists[m].size()) == 0;
+				Mismatches += bSame ? 0u : 1u;
+			}
+
+			const std::string Variant = "Threads" + std::to_string(ThreadCount);
+			WriteRow(Out, "InstanceGather", Variant.c_str(), Count, Gatherer.GetLastPartitionCount(), Best);
+			WriteRow(Out, "InstanceGatherValidate", Variant.c_str(), ModelCount, Mismatches, 0.0);
+		}
+	}
+}
+
+// stands in for the components without a registry that lights sit between in a real scene
+class BenchmarkComponent : public Component
+{
+public:
+	virtual void RenderControls() override {}
+};
+
+void Benchmarks::RunComponentRegistryBenchmark(std::ofstream& Out)
+{
+	const UINT ObjectCounts[] = { 1000u, 10000u, 100000u };
+	const UINT ComponentsPerObject = 4u;
+
+	for (UINT Count : ObjectCounts)
+	{
+		// lights already attached elsewhere stay in the registries, only what this scene adds is compared
+		const UINT PointBase = (UINT)ComponentRegistry<PointLight>::GetAll().size();
+		const UINT DirBase = (UINT)ComponentRegistry<DirectionalLight>::GetAll().size();
+
+		std::vector<std::shared_ptr<GameObject>> Objects(Count);
+		for (UINT i = 0u; i < Count; i++)
+		{
+			Objects[i] = std::make_shared<GameObject>();
+			for (UINT c = 0u; c < ComponentsPerObject; c++)
+			{
+				Objects[i]->AddComponent<BenchmarkComponent>();
+			}
+			if (i % 8u == 0u)
+				Objects[i]->AddComponent<PointLight>();
+			if (i % 64u == 0u)
+				Objects[i]->AddComponent<DirectionalLight>();
+		}
+
+		// the loop RenderModels had, every component of every object through up to three dynamic_casts
+		std::vector<PointLight*> PointLights;
+		std::vector<DirectionalLight*> DirLights;
+		double Best = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+		{
+			PointLights.clear();
+			DirLights.clear();
+
+			auto Start = std::chrono::high_resolution_clock::now();
+			for (auto& Object : Objects)
+			{
+				for (Component* Comp : Object->GetComponents())
+				{
+					Light* pLight = dynamic_cast<Light*>(Comp);
+					if (pLight && pLight->IsActive())
+					{
+						if (PointLight* pPointLight = dynamic_cast<PointLight*>(pLight))
+						{
+							PointLights.push_back(pPointLight);
+							continue;
+						}
+						if (DirectionalLight* pDirLight = dynamic_cast<DirectionalLight*>(pLight))
+						{
+							DirLights.push_back(pDirLight);
+						}
+					}
+				}
+			}
+			auto End = std::chrono::high_resolution_clock::now();
+
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+		const UINT CastCount = (UINT)(PointLights.size() + DirLights.size());
+		WriteRow(Out, "ComponentRegistry", "DynamicCastWalk", Count, CastCount, Best);
+
+		std::vector<PointLight*> RegistryPointLights;
+		std::vector<DirectionalLight*> RegistryDirLights;
+		Best = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+		{
+			RegistryPointLights.clear();
+			RegistryDirLights.clear();
+
+			auto Start = std::chrono::high_resolution_clock::now();
+			for (PointLight* pPointLight : ComponentRegistry<PointLight>::GetAll())
+			{
+				if (pPointLight->IsActive())
+					RegistryPointLights.push_back(pPointLight);
+			}
+			for (DirectionalLight* pDirLight : ComponentRegistry<DirectionalLight>::GetAll())
+			{
+				if (pDirLight->IsActive())
+					RegistryDirLights.push_back(pDirLight);
+			}
+			auto End = std::chrono::high_resolution_clock::now();
+
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+		const UINT RegistryCount = (UINT)(RegistryPointLights.size() + RegistryDirLights.size()) - PointBase - DirBase;
+		WriteRow(Out, "ComponentRegistry", "Registry", Count, RegistryCount, Best);
+
+		// same lights either way, the registries in attach order with the pre-existing ones in front
+		UINT Mismatches = 0u;
+		Mismatches += RegistryPointLights.size() == PointBase + PointLights.size() ? 0u : 1u;
+		Mismatches += RegistryDirLights.size() == DirBase + DirLights.size() ? 0u : 1u;
+		for (size_t l = 0u; Mismatches == 0u && l < PointLights.size(); l++)
+		{
+			Mismatches += RegistryPointLights[PointBase + l] == PointLights[l] ? 0u : 1u;
+		}
+		for (size_t l = 0u; Mismatches == 0u && l < DirLights.size(); l++)
+		{
+			Mismatches += RegistryDirLights[DirBase + l] == DirLights[l] ? 0u : 1u;
+		}
+
+		// destroying the scene has to leave the registries as they were
+		Objects.clear();
+		Mismatches += ComponentRegistry<PointLight>::GetAll().size() == PointBase ? 0u : 1u;
+		Mismatches += ComponentRegistry<DirectionalLight>::GetAll().size() == DirBase ? 0u : 1u;
+		WriteRow(Out, "ComponentRegistryValidate", "SameLights", Count, Mismatches, 0.0);
+	}
+}
+
+void Benchmarks::RunObjectPoolBenchmark(std::ofstream& Out)
+{
+	const UINT ObjectCounts[] = { 1000u, 10000u, 50000u };
+	const UINT Frames = 60u;
+	// a tenth of the scene despawned and respawned every frame
+	const UINT ChurnDivisor = 10u;
+	const UINT ComponentsPerObject = 2u;
+
+	// how m_GameObjects and Component::m_Components used to hold them, a make_shared per object and component
+	struct SharedObject
+	{
+		std::shared_ptr<GameObject> Object;
+		std::vector<std::shared_ptr<Component>> Components;
+	};
+
+	for (UINT Count : ObjectCounts)
+	{
+		const UINT Churn = Count / ChurnDivisor;
+
+		// the same random victims for both, as indices into the live list
+		std::mt19937 Generator(1337u);
+		std::vector<UINT> Victims(Frames * Churn);
+		for (UINT& Victim : Victims)
+		{
+			Victim = Generator();
+		}
+
+		auto SpawnShared = [ComponentsPerObject]()
+			{
+				SharedObject Spawned = { std::make_shared<GameObject>(), {} };
+				for (UINT c = 0u; c < ComponentsPerObject; c++)
+				{
+					Spawned.Components.push_back(std::make_shared<BenchmarkComponent>());
+					Spawned.Components.back()->SetOwner(Spawned.Object.get());
+				}
+				return Spawned;
+			};
+
+		// a swap and pop per despawn, the cheapest erase a vector allows
+		size_t SharedUIDSum = 0u;
+		double Best = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS / 4; i++)
+		{
+			std::vector<SharedObject> Objects;
+			for (UINT o = 0u; o < Count; o++)
+			{
+				Objects.push_back(SpawnShared());
+			}
+
+			const size_t FirstUID = Objects.front().Object->GetUID();
+			SharedUIDSum = 0u;
+			auto Start = std::chrono::high_resolution_clock::now();
+			for (UINT f = 0u; f < Frames; f++)
+			{
+				for (UINT c = 0u; c < Churn; c++)
+				{
+					const UINT Victim = Victims[f * Churn + c] % (UINT)Objects.size();
+					Objects[Victim] = std::move(Objects.back());
+					Objects.pop_back();
+				}
+				for (UINT c = 0u; c < Churn; c++)
+				{
+					Objects.push_back(SpawnShared());
+				}
+				// a traversal per frame, down to the components
+				for (const SharedObject& Object : Objects)
+				{
+					SharedUIDSum += Object.Object->GetUID() - FirstUID;
+					for (const std::shared_ptr<Component>& Comp : Object.Components)
+					{
+						SharedUIDSum += Comp->GetOwner() == Object.Object.get() ? 1u : 0u;
+					}
+				}
+			}
+			auto End = std::chrono::high_resolution_clock::now();
+
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+		WriteRow(Out, "ObjectPool", "SharedPtrVector", Frames * Churn, Count, Best);
+
+		// components live in their ComponentPool and go with their owner
+		size_t PoolUIDSum = 0u;
+		UINT StaleResolved = 0u;
+		UINT ComponentsLeaked = 0u;
+		Best = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS / 4; i++)
+		{
+			const UINT ComponentBase = ComponentPool<BenchmarkComponent>::GetCount();
+			std::vector<PoolHandle> Destroyed;
+			std::vector<PoolHandle> DestroyedComponents;
+			{
+				ObjectPool<GameObject> Pool;
+				auto SpawnPooled = [&Pool, ComponentsPerObject]()
+					{
+						GameObject* Object = Pool.Get(Pool.Create());
+						for (UINT c = 0u; c < ComponentsPerObject; c++)
+						{
+							Object->AddComponent<BenchmarkComponent>();
+						}
+					};
+
+				for (UINT o = 0u; o < Count; o++)
+				{
+					SpawnPooled();
+				}
+
+				const size_t FirstUID = Pool.GetObjects().front()->GetUID();
+				PoolUIDSum = 0u;
+				Destroyed.reserve(Frames * Churn);
+				DestroyedComponents.reserve(Frames * Churn * ComponentsPerObject);
+				auto Start = std::chrono::high_resolution_clock::now();
+				for (UINT f = 0u; f < Frames; f++)
+				{
+					for (UINT c = 0u; c < Churn; c++)
+					{
+						const PoolHandle Victim = Pool.GetHandle(Victims[f * Churn + c] % Pool.GetCount());
+						for (Component* Comp : Pool.Get(Victim)->GetComponents())
+						{
+							DestroyedComponents.push_back(Comp->GetPoolHandle());
+						}
+						Pool.Destroy(Victim);
+						Destroyed.push_back(Victim);
+					}
+					for (UINT c = 0u; c < Churn; c++)
+					{
+						SpawnPooled();
+					}
+					for (GameObject* Object : Pool.GetObjects())
+					{
+						PoolUIDSum += Object->GetUID() - FirstUID;
+						for (Component* Comp : Object->GetComponents())
+						{
+							PoolUIDSum += Comp->GetOwner() == Object ? 1u : 0u;
+						}
+					}
+				}
+				auto End = std::chrono::high_resolution_clock::now();
+
+				Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+
+				// every slot was reused, none of the old handles may see the new objects or components
+				StaleResolved = 0u;
+				for (const PoolHandle& Handle : Destroyed)
+				{
+					StaleResolved += Pool.Get(Handle) ? 1u : 0u;
+				}
+				for (const PoolHandle& Handle : DestroyedComponents)
+				{
+					StaleResolved += ComponentPool<BenchmarkComponent>::Get(Handle) ? 1u : 0u;
+				}
+			}
+
+			// the object pool going away takes every component with it
+			ComponentsLeaked = ComponentPool<BenchmarkComponent>::GetCount() - ComponentBase;
+		}
+		WriteRow(Out, "ObjectPool", "Pool", Frames * Churn, Count, Best);
+
+		// both remove the same dense index every time, so the same objects are live in the same order
+		WriteRow(Out, "ObjectPoolValidate", "StaleHandles", Count, StaleResolved, 0.0);
+		WriteRow(Out, "ObjectPoolValidate", "SameTraversal", Count, SharedUIDSum == PoolUIDSum ? 0u : 1u, 0.0);
+		WriteRow(Out, "ObjectPoolValidate", "ComponentsDestroyedWithOwner", Count, ComponentsLeaked, 0.0);
+	}
+}
+
+void Benchmarks::RunSceneFileBenchmark(std::ofstream& Out)
+{
+	const UINT ObjectCounts[] = { 1000u, 10000u, 100000u };
+	const char* BinaryPath = "BenchmarkScene.mvscene";
+	const char* TextPath = "BenchmarkScene.txt";
+
+	std::mt19937 Generator(1337u);
+	std::uniform_real_distribution<float> Position(-500.f, 500.f);
+	std::uniform_real_distribution<float> Rotation(0.f, 360.f);
+	std::uniform_real_distribution<float> Unit(0.f, 1.f);
+
+	for (UINT Count : ObjectCounts)
+	{
+		// every object a named transform, every fourth one carries a point light. Models need the device and are left out
+		ObjectPool<GameObject> Source;
+		Source.Reserve(Count);
+		for (UINT i = 0u; i < Count; i++)
+		{
+			GameObject* Object = Source.Get(Source.Create());
+			Object->SetName("Object_" + std::to_string(i));
+			Object->SetPosition(Position(Generator), Position(Generator), Position(Generator));
+			Object->SetRotation(0.f, Rotation(Generator), 0.f);
+			if (i % 4u == 0u)
+			{
+				PointLight* pLight = Object->AddComponent<PointLight>();
+				pLight->SetDiffuseColor(Unit(Generator), Unit(Generator), Unit(Generator));
+				pLight->SetRadius(1.f + Unit(Generator) * 20.f);
+			}
+		}
+
+		SceneFile Writer;
+		for (GameObject* Object : Source.GetObjects())
+		{
+			Writer.AddGameObject(Object);
+		}
+
+		double Best = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS / 4; i++)
+		{
+			auto Start = std::chrono::high_resolution_clock::now();
+			Writer.Save(BinaryPath);
+			auto End = std::chrono::high_resolution_clock::now();
+
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+		WriteRow(Out, "SceneFile", "Save", Count, 0u, Best);
+
+		// the reference, the same records as text read back one field at a time
+		{
+			SceneFile Reader;
+			Reader.Open(BinaryPath);
+			std::ofstream Text(TextPath, std::ios::out | std::ios::trunc);
+			Text << Reader.GetNodeCount() << "\n";
+			for (UINT n = 0u; n < Reader.GetNodeCount(); n++)
+			{
+				const SceneNodeRecord& N = Reader.GetNode(n);
+				Text << N.Type << " " << (int)N.Parent << " " << Reader.GetString(N.Name) << "_ " << N.bActive << " " <<
+					N.Position.x << " " << N.Position.y << " " << N.Position.z << " " << N.Rotation.x << " " << N.Rotation.y << " " << N.Rotation.z << " " <<
+					N.Scale.x << " " << N.Scale.y << " " << N.Scale.z << " " << N.Color.x << " " << N.Color.y << " " << N.Color.z << " " <<
+					N.SpecularPower << " " << N.Radius << "\n";
+			}
+		}
+
+		std::vector<SceneNodeRecord> TextNodes;
+		std::vector<std::string> TextNames;
+		Best = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS / 4; i++)
+		{
+			TextNodes.clear();
+			TextNames.clear();
+
+			auto Start = std::chrono::high_resolution_clock::now();
+			std::ifstream Text(TextPath);
+			UINT NodeCount = 0u;
+			Text >> NodeCount;
+			TextNodes.resize(NodeCount);
+			TextNames.resize(NodeCount);
+			for (UINT n = 0u; n < NodeCount; n++)
+			{
+				SceneNodeRecord& N = TextNodes[n];
+				int Parent;
+				Text >> N.Type >> Parent >> TextNames[n] >> N.bActive >> N.Position.x >> N.Position.y >> N.Position.z >> N.Rotation.x >> N.Rotation.y >>
+					N.Rotation.z >> N.Scale.x >> N.Scale.y >> N.Scale.z >> N.Color.x >> N.Color.y >> N.Color.z >> N.SpecularPower >> N.Radius;
+				N.Parent = (UINT)Parent;
+			}
+			auto End = std::chrono::high_resolution_clock::now();
+
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+		WriteRow(Out, "SceneFile", "TextParse", Count, (UINT)TextNodes.size(), Best);
+
+		SceneFile Reader;
+		bool bOpened = false;
+		Best = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS / 4; i++)
+		{
+			auto Start = std::chrono::high_resolution_clock::now();
+			bOpened = Reader.Open(BinaryPath);
+			auto End = std::chrono::high_resolution_clock::now();
+
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+		WriteRow(Out, "SceneFile", "Open", Count, Reader.GetNodeCount(), Best);
+
+		// timed on its own, the text reference above stops at records and does not create anything
+		ObjectPool<GameObject> Loaded;
+		Best = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS / 4; i++)
+		{
+			Loaded.Clear();
+
+			auto Start = std::chrono::high_resolution_clock::now();
+			Reader.Instantiate(Loaded);
+			auto End = std::chrono::high_resolution_clock::now();
+
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+		WriteRow(Out, "SceneFile", "Instantiate", Count, Loaded.GetCount(), Best);
+
+		// a binary round trip has to give back exactly what was saved
+		UINT Mismatches = bOpened && Loaded.GetCount() == Count ? 0u : 1u;
+		for (UINT i = 0u; Mismatches == 0u && i < Count; i++)
+		{
+			const GameObject* A = Source.GetObjects()[i];
+			const GameObject* B = Loaded.GetObjects()[i];
+			const Transform TA = A->GetTransform();
+			const Transform TB = B->GetTransform();
+			bool bSame = A->GetName() == B->GetName() && memcmp(&TA, &TB, sizeof(Transform)) == 0 && A->GetComponents().size() == B->GetComponents().size();
+			for (size_t c = 0u; bSame && c < A->GetComponents().size(); c++)
+			{
+				const PointLight* LA = static_cast<const PointLight*>(A->GetComponents()[c]);
+				const PointLight* LB = static_cast<const PointLight*>(B->GetComponents()[c]);
+				const DirectX::XMFLOAT3 CA = LA->GetDiffuseColor();
+				const DirectX::XMFLOAT3 CB = LB->GetDiffuseColor();
+				bSame = B->GetComponents()[c]->GetType() == ComponentType::PointLight && LA->GetRadius() == LB->GetRadius() &&
+					memcmp(&CA, &CB, sizeof(DirectX::XMFLOAT3)) == 0;
+			}
+			Mismatches += bSame ? 0u : 1u;
+		}
+		WriteRow(Out, "SceneFileValidate", "RoundTrip", Count, Mismatches, 0.0);
+
+		Reader.Close();
+		std::remove(BinaryPath);
+		std::remove(TextPath);
+	}
+}
+
+void Benchmarks::RunStressSceneBenchmark(std::ofstream& Out)
+{
+	// one parameter changed at a time from the first row, so every column of the sweep is its own scaling curve
+	StressSceneParams Configs[8];
+	Configs[1].InstanceCount = 1000u;
+	Configs[2].InstanceCount = 100000u;
+	Configs[3].InstanceCount = 100000u;
+	Configs[3].ModelCount = 64u;
+	Configs[4].PointLightCount = 1024u;
+	Configs[5].ChunkDimension = 64u;
+	Configs[6].GrassBladesPerAxis = 96u;
+	Configs[7].MovingFraction = 0.5f;
+
+	const UINT Frames = 30u;
+	const UINT MapSize = 256u;
+	const float HeightDisplacement = 100.f;
+	const UINT MeshesPerModel = 3u;
+	const std::vector<float> Heights = GenerateTestHeightmap(MapSize);
+
+	for (const StressSceneParams& Params : Configs)
+	{
+		StressScene Scene;
+		Scene.Generate(Params);
+		const UINT ModelCount = Params.ModelCount;
+
+		TransformStore Store;
+		std::vector<UINT> IDs;
+		std::vector<InstanceGatherer::Item> Items;
+		for (const StressScene::Instance& I : Scene.GetInstances())
+		{
+			const UINT ID = Store.Create();
+			Store.SetPosition(ID, I.Position);
+			Store.SetRotation(ID, I.Rotation);
+			Store.SetScale(ID, I.Scale);
+			IDs.push_back(ID);
+			Items.push_back({ I.ModelIndex, ID });
+		}
+
+		std::vector<AABB> Bounds(ModelCount);
+		for (UINT m = 0u; m < ModelCount; m++)
+		{
+			const float e = 0.5f + 0.1f * (float)(m % 8u);
+			Bounds[m].Min = { -e, 0.f, -e };
+			Bounds[m].Max = { e, 2.f * e, e };
+		}
+
+		ObjectPool<GameObject> LightObjects;
+		for (const StressScene::PointLightDesc& L : Scene.GetPointLights())
+		{
+			GameObject* Object = LightObjects.Get(LightObjects.Create());
+			Object->SetPosition(L.Position.x, L.Position.y, L.Position.z);
+			PointLight* pLight = Object->AddComponent<PointLight>();
+			pLight->SetDiffuseColor(L.Color.x, L.Color.y, L.Color.z);
+			pLight->SetRadius(L.Radius);
+		}
+		for (const DirectX::XMFLOAT3& Dir : Scene.GetDirectionalLights())
+		{
+			DirectionalLight* pLight = LightObjects.Get(LightObjects.Create())->AddComponent<DirectionalLight>();
+			pLight->SetDirection(Dir.x, Dir.y, Dir.z);
+		}
+
+		LandscapeQuadtree Quadtree;
+		Quadtree.Build(Heights.data(), MapSize, MapSize, Params.ChunkDimension, Params.ChunkSize);
+		AABB BladeBounds;
+		BladeBounds.Min = { -0.56f, 0.f, -0.56f };
+		BladeBounds.Max = { 0.56f, 2.f, 0.56f };
+		std::vector<DirectX::XMFLOAT2> GrassOffsets = Scene.GetGrassOffsets();
+		GrassTileCuller TileCuller;
+		TileCuller.Build(GrassOffsets, Params.GrassBladesPerAxis > 1u ? Params.GrassBladesPerAxis : 1u, GRASS_TILE_DIMENSION, BladeBounds, Heights.data(), MapSize, MapSize,
+			Params.ChunkDimension, Params.ChunkSize);
+
+		std::vector<std::vector<DirectX::XMMATRIX>> Lists(ModelCount);
+		std::vector<std::vector<DirectX::XMMATRIX>*> Outputs;
+		for (std::vector<DirectX::XMMATRIX>& List : Lists)
+		{
+			Outputs.push_back(&List);
+		}
+		std::vector<std::vector<DirectX::XMMATRIX>> Visible(ModelCount);
+		std::vector<InstanceBufferManager> InstanceBuffers(ModelCount);
+		// created at the initial capacity like the real instance buffers, only regrown when Reserve says so
+		std::vector<std::vector<DirectX::XMMATRIX>> Mapped(ModelCount);
+		for (UINT m = 0u; m < ModelCount; m++)
+		{
+			Mapped[m].resize(InstanceBuffers[m].GetCapacity());
+		}
+		std::vector<InstanceBufferManager::Chunk> Chunks;
+		std::vector<std::pair<UINT, DirectX::XMFLOAT3>> Moves;
+		std::vector<UINT> VisibleChunks;
+		std::vector<GrassTileCuller::TileEntry> Tiles;
+		std::vector<PointLight*> PointLights;
+		std::vector<DirectionalLight*> DirLights;
+
+		InstanceGatherer Gatherer;
+		CPUFrustumCuller Culler;
+		const DirectX::XMMATRIX Proj = DirectX::XMMatrixPerspectiveFovLH(DirectX::XMConvertToRadians(60.f), 16.f / 9.f, 0.1f, 2000.f);
+
+		double PhaseMs[(int)FramePhase::Count] = {};
+		UINT64 PhaseResults[(int)FramePhase::Count] = {};
+		UINT GatherMismatches = 0u;
+		for (UINT Frame = 0u; Frame < Frames; Frame++)
+		{
+			// orbiting the middle of the landscape, a full turn over the run
+			const float Angle = DirectX::XM_2PI * (float)Frame / (float)Frames;
+			const float Radius = Scene.GetWorldSize() * 0.35f;
+			const DirectX::XMFLOAT3 Eye = { cosf(Angle) * Radius, 60.f, sinf(Angle) * Radius };
+			const DirectX::XMMATRIX View = DirectX::XMMatrixLookAtLH(DirectX::XMVectorSet(Eye.x, Eye.y, Eye.z, 1.f), DirectX::XMVectorSet(0.f, 0.f, 0.f, 1.f),
+				DirectX::XMVectorSet(0.f, 1.f, 0.f, 0.f));
+			const DirectX::XMMATRIX ViewProj = View * Proj;
+			const Frustum ViewFrustum(ViewProj);
+
+			Scene.GetFrameMoves(Frame, Moves);
+			auto Start = std::chrono::high_resolution_clock::now();
+			for (const std::pair<UINT, DirectX::XMFLOAT3>& Move : Moves)
+			{
+				Store.SetPosition(IDs[Move.first], Move.second);
+			}
+			Store.UpdateWorldMatrices();
+			auto End = std::chrono::high_resolution_clock::now();
+			PhaseMs[(int)FramePhase::TransformUpdate] += std::chrono::duration<double, std::milli>(End - Start).count();
+			PhaseResults[(int)FramePhase::TransformUpdate] += Store.GetLastRecomputedCount();
+
+			Start = std::chrono::high_resolution_clock::now();
+			for (std::vector<DirectX::XMMATRIX>& List : Lists)
+			{
+				List.clear();
+			}
+			Gatherer.Gather(Store, Items, Outputs);
+			End = std::chrono::high_resolution_clock::now();
+			PhaseMs[(int)FramePhase::Gather] += std::chrono::duration<double, std::milli>(End - Start).count();
+			UINT Gathered = 0u;
+			for (const std::vector<DirectX::XMMATRIX>& List : Lists)
+			{
+				Gathered += (UINT)List.size();
+			}
+			PhaseResults[(int)FramePhase::Gather] += Gathered;
+			GatherMismatches += Gathered == Params.InstanceCount ? 0u : 1u;
+
+			Start = std::chrono::high_resolution_clock::now();
+			UINT VisibleCount = 0u;
+			for (UINT m = 0u; m < ModelCount; m++)
+			{
+				VisibleCount += Culler.Cull(Lists[m], Bounds[m], ViewProj, Visible[m]);
+			}
+			End = std::chrono::high_resolution_clock::now();
+			PhaseMs[(int)FramePhase::Culling] += std::chrono::duration<double, std::milli>(End - Start).count();
+			PhaseResults[(int)FramePhase::Culling] += VisibleCount;
+
+			Start = std::chrono::high_resolution_clock::now();
+			VisibleChunks.clear();
+			Quadtree.Query(ViewFrustum, HeightDisplacement, Eye, VisibleChunks);
+			TileCuller.Classify(ViewFrustum, VisibleChunks, (UINT)VisibleChunks.size(), Scene.GetChunkOffsets(), HeightDisplacement, Tiles);
+			End = std::chrono::high_resolution_clock::now();
+			PhaseMs[(int)FramePhase::Landscape] += std::chrono::duration<double, std::milli>(End - Start).count();
+			PhaseResults[(int)FramePhase::Landscape] += Tiles.size();
+
+			Start = std::chrono::high_resolution_clock::now();
+			PointLights.clear();
+			DirLights.clear();
+			for (PointLight* pPointLight : ComponentRegistry<PointLight>::GetAll())
+			{
+				if (pPointLight->IsActive())
+					PointLights.push_back(pPointLight);
+			}
+			for (DirectionalLight* pDirLight : ComponentRegistry<DirectionalLight>::GetAll())
+			{
+				if (pDirLight->IsActive())
+					DirLights.push_back(pDirLight);
+			}
+			End = std::chrono::high_resolution_clock::now();
+			PhaseMs[(int)FramePhase::Lights] += std::chrono::duration<double, std::milli>(End - Start).count();
+			PhaseResults[(int)FramePhase::Lights] += PointLights.size() + DirLights.size();
+
+			// what CullOnCPU and ModelData::Render do on the CPU, the mapped instance buffer is a plain vector here
+			Start = std::chrono::high_resolution_clock::now();
+			UINT Draws = 0u;
+			for (UINT m = 0u; m < ModelCount; m++)
+			{
+				const UINT Count = std::min((UINT)Visible[m].size(), InstanceBuffers[m].GetMaxCapacity());
+				if (Count == 0u)
+					continue;
+
+				if (InstanceBuffers[m].Reserve(Count))
+				{
+					Mapped[m].resize(InstanceBuffers[m].GetCapacity());
+				}
+				memcpy(Mapped[m].data(), Visible[m].data(), sizeof(DirectX::XMMATRIX) * Count);
+				InstanceBufferManager::SplitIntoChunks(Count, InstanceBufferManager::MAX_DISPATCH_INSTANCES, Chunks);
+				Draws += (UINT)Chunks.size() * MeshesPerModel;
+			}
+			End = std::chrono::high_resolution_clock::now();
+			PhaseMs[(int)FramePhase::DrawSubmission] += std::chrono::duration<double, std::milli>(End - Start).count();
+			PhaseResults[(int)FramePhase::DrawSubmission] += Draws;
+		}
+
+		// averages per frame, post processing needs the device and is only timed in the application's stats
+		const std::string Bench = "StressScene.M" + std::to_string(ModelCount) + ".L" + std::to_string(Params.PointLightCount) + ".C" +
+			std::to_string(Params.ChunkDimension) + ".G" + std::to_string(Params.GrassBladesPerAxis) + ".Move" + std::to_string((UINT)(Params.MovingFraction * 100.f));
+		double Total = 0.0;
+		for (int p = 0; p < (int)FramePhase::Count; p++)
+		{
+			if (p == (int)FramePhase::PostProcess)
+				continue;
+
+			WriteRow(Out, Bench.c_str(), FramePhaseNames[p], Params.InstanceCount, (UINT)(PhaseResults[p] / Frames), PhaseMs[p] / Frames);
+			Total += PhaseMs[p] / Frames;
+		}
+		WriteRow(Out, Bench.c_str(), "Total", Params.InstanceCount, Frames, Total);
+		WriteRow(Out, "StressSceneValidate", "GatherComplete", Params.InstanceCount, GatherMismatches, 0.0);
+	}
+}
+
+void Benchmarks::RunSpatialHashBenchmark(std::ofstream& Out)
+{
+	const UINT InstanceCounts[] = { 10000u, 50000u, 100000u };
+	const float MovedFractions[] = { 0.01f, 0.1f, 1.f };
+	const UINT QueryCount = 256u;
+	const float CellSize = 8.f;
+
+	DirectX::XMMATRIX View = DirectX::XMMatrixLookAtLH(DirectX::XMVectorSet(0.f, 10.f, -250.f, 1.f), DirectX::XMVectorSet(0.f, 0.f, 0.f, 1.f), DirectX::XMVectorSet(0.f, 1.f, 0.f, 0.f));
+	DirectX::XMMATRIX Proj = DirectX::XMMatrixPerspectiveFovLH(DirectX::XMConvertToRadians(60.f), 16.f / 9.f, 0.1f, 500.f);
+	const Frustum ViewFrustum(View * Proj);
+
+	AABB BBox;
+	BBox.Min = { -1.f, 0.f, -1.f };
+	BBox.Max = { 1.f, 3.f, 1.f };
+
+	std::mt19937 Generator(1337u);
+	std::uniform_real_distribution<float> Position(-1000.f, 1000.f);
+	std::uniform_real_distribution<float> Rotation(0.f, DirectX::XM_2PI);
+	std::uniform_real_distribution<float> Offset(-5.f, 5.f);
+	std::uniform_real_distribution<float> Unit(-1.f, 1.f);
+
+	// the same queries for every count, ranges and spheres about the size of a point light, rays like picking from above the ground
+	std::vector<BVHBounds> Ranges(QueryCount);
+	std::vector<DirectX::XMFLOAT4> Spheres(QueryCount);
+	std::vector<DirectX::XMFLOAT3> RayOrigins(QueryCount);
+	std::vector<DirectX::XMFLOAT3> RayDirections(QueryCount);
+	const float RayLength = 500.f;
+	for (UINT q = 0u; q < QueryCount; q++)
+	{
+		const DirectX::XMFLOAT3 Center = { Position(Generator), 0.f, Position(Generator) };
+		Ranges[q].Min = { Center.x - 25.f, -5.f, Center.z - 25.f };
+		Ranges[q].Max = { Center.x + 25.f, 5.f, Center.z + 25.f };
+		Spheres[q] = { Center.x, 2.f, Center.z, 30.f };
+		RayOrigins[q] = { Center.x, 20.f, Center.z };
+		DirectX::XMStoreFloat3(&RayDirections[q], DirectX::XMVector3Normalize(DirectX::XMVectorSet(Unit(Generator), -0.1f - 0.2f * fabsf(Unit(Generator)), Unit(Generator), 0.f)));
+	}
+
+	auto TestFrustum = [&](const BVHBounds& Bounds)
+		{
+			const DirectX::XMFLOAT3 Center = Bounds.Center();
+			return ViewFrustum.TestAABB(Center, { (Bounds.Max.x - Bounds.Min.x) * 0.5f, (Bounds.Max.y - Bounds.Min.y) * 0.5f, (Bounds.Max.z - Bounds.Min.z) * 0.5f });
+		};
+
+	// nearest hit over every item, the slab test written out again so the flat scan does not share code with the hash
+	auto RayHitFlat = [&](const std::vector<BVHBounds>& Bounds, const DirectX::XMFLOAT3& Origin, const DirectX::XMFLOAT3& Direction, float& OutDistance)
+		{
+			bool bHit = false;
+			OutDistance = RayLength;
+			for (const BVHBounds& B : Bounds)
+			{
+				float Enter = 0.f, Exit = OutDistance;
+				const float o[3] = { Origin.x, Origin.y, Origin.z };
+				const float d[3] = { Direction.x, Direction.y, Direction.z };
+				const float Min[3] = { B.Min.x, B.Min.y, B.Min.z };
+				const float Max[3] = { B.Max.x, B.Max.y, B.Max.z };
+				bool bInside = true;
+				for (int a = 0; a < 3 && bInside; a++)
+				{
+					if (fabsf(d[a]) < 1e-12f)
+					{
+						bInside = o[a] >= Min[a] && o[a] <= Max[a];
+						continue;
+					}
+					float t0 = (Min[a] - o[a]) / d[a];
+					float t1 = (Max[a] - o[a]) / d[a];
+					if (t0 > t1)
+						std::swap(t0, t1);
+					Enter = std::max(Enter, t0);
+					Exit = std::min(Exit, t1);
+					bInside = Enter <= Exit;
+				}
+				if (bInside)
+				{
+					OutDistance = Enter;
+					bHit = true;
+				}
+			}
+			return bHit;
+		};
+
+	std::vector<BVHBounds> Bounds;
+	std::vector<UINT> Proxies;
+	std::vector<UINT> Results;
+	std::vector<UINT> Expected;
+	SpatialHash Hash(CellSize);
+	SceneBVH BVH;
+
+	for (UINT Count : InstanceCounts)
+	{
+		Bounds.clear();
+		for (UINT i = 0u; i < Count; i++)
+		{
+			DirectX::XMMATRIX World = DirectX::XMMatrixRotationY(Rotation(Generator)) * DirectX::XMMatrixTranslation(Position(Generator), 0.f, Position(Generator));
+			Bounds.push_back(SceneBVH::TransformBounds(BBox, World));
+		}
+
+		double Best = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+		{
+			auto Start = std::chrono::high_resolution_clock::now();
+			Hash.Clear(CellSize);
+			Proxies.resize(Count);
+			for (UINT Item = 0u; Item < Count; Item++)
+			{
+				Proxies[Item] = Hash.Insert(Bounds[Item], Item);
+			}
+			auto End = std::chrono::high_resolution_clock::now();
+
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+		WriteRow(Out, "SpatialHash", "Insert", Count, Hash.GetCellCount(), Best);
+		BVH.Build(Bounds);
+
+		// update cost under motion: the hash moves each item on its own, the BVH refits the leaves and walks up after all of them.
+		// The same random walk is replayed for both so they see identical motion
+		for (float Fraction : MovedFractions)
+		{
+			const UINT MovedCount = (UINT)(Count * Fraction);
+			const std::string Variant = std::to_string((UINT)(Fraction * 100.f)) + "Pct";
+			std::vector<std::pair<UINT, BVHBounds>> Moves(MovedCount);
+
+			double BestHash = DBL_MAX, BestBVH = DBL_MAX;
+			UINT CellChanges = 0u;
+			for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+			{
+				for (std::pair<UINT, BVHBounds>& Move : Moves)
+				{
+					Move.first = (UINT)(Generator() % Count);
+					Move.second = Bounds[Move.first];
+					const float dx = Offset(Generator), dz = Offset(Generator);
+					Move.second.Min.x += dx; Move.second.Max.x += dx;
+					Move.second.Min.z += dz; Move.second.Max.z += dz;
+					Bounds[Move.first] = Move.second;
+				}
+
+				CellChanges = 0u;
+				auto Start = std::chrono::high_resolution_clock::now();
+				for (const std::pair<UINT, BVHBounds>& Move : Moves)
+				{
+					CellChanges += Hash.Update(Proxies[Move.first], Move.second) ? 1u : 0u;
+				}
+				auto End = std::chrono::high_resolution_clock::now();
+				BestHash = std::min(BestHash, std::chrono::duration<double, std::milli>(End - Start).count());
+
+				Start = std::chrono::high_resolution_clock::now();
+				for (const std::pair<UINT, BVHBounds>& Move : Moves)
+				{
+					BVH.UpdateItem(Move.first, Move.second);
+				}
+				BVH.Refit();
+				End = std::chrono::high_resolution_clock::now();
+				BestBVH = std::min(BestBVH, std::chrono::duration<double, std::milli>(End - Start).count());
+			}
+			WriteRow(Out, "SpatialHash", ("Update" + Variant).c_str(), Count, CellChanges, BestHash);
+			WriteRow(Out, "SpatialHash", ("BVHRefit" + Variant).c_str(), Count, MovedCount, BestBVH);
+		}
+
+		// query throughput, every query set against the hash and against a flat scan over the same moved bounds
+		UINT HashHits = 0u, FlatHits = 0u;
+		Best = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+		{
+			Results.clear();
+			auto Start = std::chrono::high_resolution_clock::now();
+			for (const BVHBounds& Range : Ranges)
+			{
+				Hash.QueryRange(Range, Results);
+			}
+			auto End = std::chrono::high_resolution_clock::now();
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+		WriteRow(Out, "SpatialHash", "Range256", Count, (UINT)Results.size(), Best);
+
+		Best = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS / 4; i++)
+		{
+			FlatHits = 0u;
+			auto Start = std::chrono::high_resolution_clock::now();
+			for (const BVHBounds& Range : Ranges)
+			{
+				for (const BVHBounds& B : Bounds)
+				{
+					FlatHits += (B.Min.x <= Range.Max.x && B.Max.x >= Range.Min.x && B.Min.y <= Range.Max.y && B.Max.y >= Range.Min.y &&
+						B.Min.z <= Range.Max.z && B.Max.z >= Range.Min.z) ? 1u : 0u;
+				}
+			}
+			auto End = std::chrono::high_resolution_clock::now();
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+		WriteRow(Out, "SpatialHash", "Range256Flat", Count, FlatHits, Best);
+
+		auto InSphere = [](const BVHBounds& B, const DirectX::XMFLOAT4& S)
+			{
+				const float dx = std::max(std::max(B.Min.x - S.x, 0.f), S.x - B.Max.x);
+				const float dy = std::max(std::max(B.Min.y - S.y, 0.f), S.y - B.Max.y);
+				const float dz = std::max(std::max(B.Min.z - S.z, 0.f), S.z - B.Max.z);
+				return dx * dx + dy * dy + dz * dz <= S.w * S.w;
+			};
+
+		Best = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+		{
+			Results.clear();
+			auto Start = std::chrono::high_resolution_clock::now();
+			for (const DirectX::XMFLOAT4& S : Spheres)
+			{
+				Hash.QueryRadius({ S.x, S.y, S.z }, S.w, Results);
+			}
+			auto End = std::chrono::high_resolution_clock::now();
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+		WriteRow(Out, "SpatialHash", "Radius256", Count, (UINT)Results.size(), Best);
+
+		Best = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS / 4; i++)
+		{
+			FlatHits = 0u;
+			auto Start = std::chrono::high_resolution_clock::now();
+			for (const DirectX::XMFLOAT4& S : Spheres)
+			{
+				for (const BVHBounds& B : Bounds)
+				{
+					FlatHits += InSphere(B, S) ? 1u : 0u;
+				}
+			}
+			auto End = std::chrono::high_resolution_clock::now();
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+		WriteRow(Out, "SpatialHash", "Radius256Flat", Count, FlatHits, Best);
+
+		Best = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+		{
+			HashHits = 0u;
+			auto Start = std::chrono::high_resolution_clock::now();
+			for (UINT q = 0u; q < QueryCount; q++)
+			{
+				UINT Item;
+				float Distance;
+				HashHits += Hash.QueryRay(RayOrigins[q], RayDirections[q], RayLength, Item, Distance) ? 1u : 0u;
+			}
+			auto End = std::chrono::high_resolution_clock::now();
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+		WriteRow(Out, "SpatialHash", "Ray256", Count, HashHits, Best);
+
+		Best = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS / 4; i++)
+		{
+			FlatHits = 0u;
+			auto Start = std::chrono::high_resolution_clock::now();
+			for (UINT q = 0u; q < QueryCount; q++)
+			{
+				float Distance;
+				FlatHits += RayHitFlat(Bounds, RayOrigins[q], RayDirections[q], Distance) ? 1u : 0u;
+			}
+			auto End = std::chrono::high_resolution_clock::now();
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+		WriteRow(Out, "SpatialHash", "Ray256Flat", Count, FlatHits, Best);
+
+		Best = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+		{
+			Results.clear();
+			auto Start = std::chrono::high_resolution_clock::now();
+			Hash.QueryFrustum(ViewFrustum, Results);
+			auto End = std::chrono::high_resolution_clock::now();
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+		WriteRow(Out, "SpatialHash", "Frustum", Count, (UINT)Results.size(), Best);
+
+		Best = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+		{
+			Expected.clear();
+			auto Start = std::chrono::high_resolution_clock::now();
+			BVH.QueryFrustum(ViewFrustum, Expected);
+			auto End = std::chrono::high_resolution_clock::now();
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+		WriteRow(Out, "SpatialHash", "FrustumBVH", Count, (UINT)Expected.size(), Best);
+
+		// after all the motion above every query must still match the flat scan item for item, rays by nearest distance
+		UINT Mismatches = 0u;
+		auto Compare = [&]()
+			{
+				std::sort(Results.begin(), Results.end());
+				std::sort(Expected.begin(), Expected.end());
+				Mismatches += Results != Expected ? 1u : 0u;
+			};
+
+		for (UINT q = 0u; q < QueryCount; q++)
+		{
+			Results.clear();
+			Expected.clear();
+			Hash.QueryRange(Ranges[q], Results);
+			for (UINT Item = 0u; Item < Count; Item++)
+			{
+				const BVHBounds& B = Bounds[Item];
+				if (B.Min.x <= Ranges[q].Max.x && B.Max.x >= Ranges[q].Min.x && B.Min.y <= Ranges[q].Max.y && B.Max.y >= Ranges[q].Min.y &&
+					B.Min.z <= Ranges[q].Max.z && B.Max.z >= Ranges[q].Min.z)
+					Expected.push_back(Item);
+			}
+			Compare();
+
+			Results.clear();
+			Expected.clear();
+			Hash.QueryRadius({ Spheres[q].x, Spheres[q].y, Spheres[q].z }, Spheres[q].w, Results);
+			for (UINT Item = 0u; Item < Count; Item++)
+			{
+				if (InSphere(Bounds[Item], Spheres[q]))
+					Expected.push_back(Item);
+			}
+			Compare();
+
+			UINT Item;
+			float HashDistance, FlatDistance;
+			const bool bHashHit = Hash.QueryRay(RayOrigins[q], RayDirections[q], RayLength, Item, HashDistance);
+			const bool bFlatHit = RayHitFlat(Bounds, RayOrigins[q], RayDirections[q], FlatDistance);
+			Mismatches += (bHashHit != bFlatHit || (bHashHit && fabsf(HashDistance - FlatDistance) > 1e-3f)) ? 1u : 0u;
+		}
+
+		Results.clear();
+		Expected.clear();
+		Hash.QueryFrustum(ViewFrustum, Results);
+		for (UINT Item = 0u; Item < Count; Item++)
+		{
+			if (TestFrustum(Bounds[Item]))
+				Expected.push_back(Item);
+		}
+		Compare();
+
+		WriteRow(Out, "SpatialHashValidate", "MatchesFlat", Count, Mismatches, 0.0);
+	}
+
+	// the way Application keeps the hash in sync: spawned transforms are inserted after the update that gives them a world matrix,
+	// despawned ones are removed on the spot and everything else is only touched when its id is in the changed list. Releasing a
+	// group parent moves its orphaned children, the last frame moves nothing and must not update anything
+	const UINT ValidateCount = 50000u;
+	const UINT ValidateFrames = 8u;
+	const UINT GroupSize = 4u;
+	const UINT ChurnCount = 500u;
+	const float MovedFraction = 0.01f;
+	TransformStore Store;
+	std::vector<UINT> LiveIDs;
+	std::vector<UINT> PendingIDs;
+	std::vector<UINT> ProxyByID;
+	const UINT NoProxy = SpatialHash::INVALID_PROXY;
+	Hash.Clear(CellSize);
+
+	auto Spawn = [&](UINT ParentID)
+		{
+			const UINT ID = Store.Create();
+			Store.SetPosition(ID, { Position(Generator), 0.f, Position(Generator) });
+			if (ParentID != TransformStore::INVALID_ID)
+				Store.SetParent(ID, ParentID);
+			if (ID >= (UINT)ProxyByID.size())
+				ProxyByID.resize(ID + 1u, NoProxy);
+			LiveIDs.push_back(ID);
+			PendingIDs.push_back(ID);
+			return ID;
+		};
+
+	for (UINT i = 0u; i < ValidateCount; i++)
+	{
+		Spawn(i % GroupSize != 0u ? LiveIDs.back() : TransformStore::INVALID_ID);
+	}
+
+	UINT Mismatches = 0u;
+	UINT Updates = 0u;
+	double Best = DBL_MAX;
+	for (UINT Frame = 0u; Frame <= ValidateFrames; Frame++)
+	{
+		// frame 0 is the initial fill, the last one moves nothing
+		const bool bStill = Frame == ValidateFrames;
+		if (Frame != 0u && !bStill)
+		{
+			for (UINT c = 0u; c < ChurnCount; c++)
+			{
+				const UINT Slot = Generator() % (UINT)LiveIDs.size();
+				const UINT ID = LiveIDs[Slot];
+				// spawned this frame, only the pending insert has to go
+				if (ProxyByID[ID] != SpatialHash::INVALID_PROXY)
+					Hash.Remove(ProxyByID[ID]);
+				else
+					PendingIDs.erase(std::find(PendingIDs.begin(), PendingIDs.end(), ID));
+				ProxyByID[ID] = SpatialHash::INVALID_PROXY;
+				Store.Release(ID);
+				LiveIDs[Slot] = LiveIDs.back();
+				LiveIDs.pop_back();
+
+				Spawn(TransformStore::INVALID_ID);
+			}
+
+			for (UINT m = 0u; m < (UINT)(ValidateCount * MovedFraction); m++)
+			{
+				const UINT ID = LiveIDs[Generator() % (UINT)LiveIDs.size()];
+				DirectX::XMFLOAT3 Moved = Store.GetPosition(ID);
+				Moved.x += Offset(Generator) * 20.f;
+				Moved.z += Offset(Generator) * 20.f;
+				Store.SetPosition(ID, Moved);
+			}
+		}
+		Store.UpdateWorldMatrices();
+
+		auto Start = std::chrono::high_resolution_clock::now();
+		for (UINT ID : PendingIDs)
+		{
+			ProxyByID[ID] = Hash.Insert(SceneBVH::TransformBounds(BBox, Store.GetWorldMatrix(ID)), ID);
+		}
+		const bool bAnySpawned = !PendingIDs.empty();
+		PendingIDs.clear();
+
+		for (UINT ID : Store.GetChangedIDs())
+		{
+			Hash.Update(ProxyByID[ID], SceneBVH::TransformBounds(BBox, Store.GetWorldMatrix(ID)));
+			Updates++;
+		}
+		auto End = std::chrono::high_resolution_clock::now();
+		if (Frame != 0u && !bStill)
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		if (bStill && (bAnySpawned || !Store.GetChangedIDs().empty()))
+			Mismatches++;
+
+		Mismatches += Hash.GetCount() != (UINT)LiveIDs.size() ? 1u : 0u;
+		for (UINT q = 0u; q < QueryCount; q++)
+		{
+			Results.clear();
+			Expected.clear();
+			Hash.QueryRange(Ranges[q], Results);
+			for (UINT ID : LiveIDs)
+			{
+				const BVHBounds B = SceneBVH::TransformBounds(BBox, Store.GetWorldMatrix(ID));
+				if (B.Min.x <= Ranges[q].Max.x && B.Max.x >= Ranges[q].Min.x && B.Min.y <= Ranges[q].Max.y && B.Max.y >= Ranges[q].Min.y &&
+					B.Min.z <= Ranges[q].Max.z && B.Max.z >= Ranges[q].Min.z)
+					Expected.push_back(ID);
+			}
+			std::sort(Results.begin(), Results.end());
+			std::sort(Expected.begin(), Expected.end());
+			Mismatches += Results != Expected ? 1u : 0u;
+		}
+	}
+	WriteRow(Out, "SpatialHash", "UpdateChangedIDs", ValidateCount, Updates, Best);
+	WriteRow(Out, "SpatialHashValidate", "ChangedIDsMatchFlat", ValidateCount, Mismatches, 0.0);
+
+	// cells a multiple of 2^21 apart on every axis, which a key packed into 21 bits per axis would put in one cell. A range wider
+	// than the cell count walks the cell list and must still find each item at its own coordinates
+	const float FarStep = (float)(1 << 21) * CellSize;
+	const int FarSteps[] = { -2, -1, 1, 2 };
+	Hash.Clear(CellSize);
+	Hash.Insert({ { -1.f, -1.f, -1.f }, { 1.f, 1.f, 1.f } }, 0u);
+	for (UINT i = 0u; i < 4u; i++)
+	{
+		const float c = FarSteps[i] * FarStep;
+		Hash.Insert({ { c - 1.f, c - 1.f, c - 1.f }, { c + 1.f, c + 1.f, c + 1.f } }, i + 1u);
+	}
+
+	UINT FarMismatches = Hash.GetCellCount() != 5u ? 1u : 0u;
+	for (UINT i = 0u; i <= 4u; i++)
+	{
+		const float c = i == 0u ? 0.f : FarSteps[i - 1u] * FarStep;
+		Results.clear();
+		Hash.QueryRange({ { c - 10.f * CellSize, c - 10.f * CellSize, c - 10.f * CellSize }, { c + 10.f * CellSize, c + 10.f * CellSize, c + 10.f * CellSize } }, Results);
+		FarMismatches += (Results.size() != 1u || Results[0] != i) ? 1u : 0u;
+	}
+	WriteRow(Out, "SpatialHashValidate", "FarCellsDistinct", 5u, FarMismatches, 0.0);
+}
+
+// a flat grid of quads per mesh, every mesh its own node, enough to stand in for a large imported model
+// ThreadCount above 1 reserves every mesh first and fills them across the thread pool, the way the import does
+static void BuildTestMeshCache(UINT MeshCount, UINT QuadsPerSide, MeshCache& Out, UINT ThreadCount = 1u)
+{
+	MeshCacheMaterialDesc Desc;
+	Desc.Name = "Material";
+	Desc.DiffuseTexture = "textures/diffuse.png";
+	Desc.bOpaque = true;
+	Out.AddMaterial(Desc);
+
+	const UINT Root = Out.AddNode(INVALID_MESH_CACHE_NODE, "Root", DirectX::XMMatrixIdentity(), DirectX::XMMatrixIdentity());
+
+	// every mesh is the same grid, its clusters and levels are only built once
+	std::vector<Vertex> Vertices;
+	std::vector<UINT> Indices;
+	std::vector<Meshlet> Meshlets;
+	std::vector<MeshLOD> LODs;
+	std::vector<UINT> LODIndices;
+	const UINT Side = QuadsPerSide + 1u;
+	for (UINT y = 0u; y < Side; y++)
+	{
+		for (UINT x = 0u; x < Side; x++)
+		{
+			Vertex v;
+			v.Pos = DirectX::XMFLOAT3((float)x / (float)QuadsPerSide, 0.f, (float)y / (float)QuadsPerSide);
+			v.Normal = DirectX::XMFLOAT3(0.f, 1.f, 0.f);
+			v.TexCoord = DirectX::XMFLOAT2(v.Pos.x, v.Pos.z);
+			Vertices.push_back(v);
+		}
+	}
+	for (UINT y = 0u; y < QuadsPerSide; y++)
+	{
+		for (UINT x = 0u; x < QuadsPerSide; x++)
+		{
+			const UINT i = y * Side + x;
+			const UINT Quad[] = { i, i + Side, i + 1u, i + 1u, i + Side, i + Side + 1u };
+			Indices.insert(Indices.end(), Quad, Quad + 6);
+		}
+	}
+	MeshletBuilder::Build(Vertices.data(), (UINT)Vertices.size(), Indices.data(), (UINT)Indices.size(), Meshlets);
+	MeshSimplifier::GenerateLODs(Vertices, Indices, LODs, LODIndices);
+
+	if (ThreadCount > 1u)
+	{
+		Out.Reserve((UINT)Vertices.size() * MeshCount, (UINT)(Indices.size() + LODIndices.size()) * MeshCount, (UINT)Meshlets.size() * MeshCount, MeshCount);
+	}
+
+	std::vector<UINT> Meshes;
+	for (UINT m = 0u; m < MeshCount; m++)
+	{
+		const DirectX::XMMATRIX Local = DirectX::XMMatrixTranslation((float)m * 2.f, 0.f, 0.f);
+		const UINT Node = Out.AddNode(Root, "Node_" + std::to_string(m), Local, Local);
+
+		if (ThreadCount > 1u)
+		{
+			Meshes.push_back(Out.ReserveMesh("Mesh_" + std::to_string(m), Node, 0u, (UINT)Vertices.size(), (UINT)Indices.size(), {}, (UINT)Meshlets.size(),
+				LODs, (UINT)LODIndices.size()));
+		}
+		else
+		{
+			Out.AddMesh("Mesh_" + std::to_string(m), Node, 0u, Vertices, Indices, {}, Meshlets, LODs, LODIndices);
+		}
+	}
+
+	ThreadPool::GetSingletonPtr()->ParallelFor((UINT)Meshes.size(), 1u, [&](UINT Begin, UINT End)
+		{
+			for (UINT m = Begin; m < End; m++)
+			{
+				Out.FillMesh(Meshes[m], Vertices.data(), Indices.data(), Meshlets.data(), LODIndices.data(), (UINT)LODIndices.size());
+			}
+		}, ThreadCount);
+
+	Out.SetBounds(DirectX::XMFLOAT3(0.f, 0.f, 0.f), DirectX::XMFLOAT3((float)MeshCount * 2.f, 0.f, 1.f));
+}
+
+// every record and array of two caches, strings compared by content since their offsets may differ
+static UINT CompareMeshCaches(const MeshCache& A, const MeshCache& B)
+{
+	if (A.GetVertexCount() != B.GetVertexCount() || A.GetIndexCount() != B.GetIndexCount() || A.GetMeshCount() != B.GetMeshCount() ||
+		A.GetMeshletCount() != B.GetMeshletCount() || A.GetNodeCount() != B.GetNodeCount() || A.GetMaterialCount() != B.GetMaterialCount())
+		return 1u;
+
+	UINT Mismatches = 0u;
+	Mismatches += memcmp(A.GetVertices(), B.GetVertices(), sizeof(Vertex) * A.GetVertexCount()) == 0 ? 0u : 1u;
+	Mismatches += memcmp(A.GetIndices(), B.GetIndices(), sizeof(UINT) * A.GetIndexCount()) == 0 ? 0u : 1u;
+	Mismatches += memcmp(A.GetMeshlets(), B.GetMeshlets(), sizeof(Meshlet) * A.GetMeshletCount()) == 0 ? 0u : 1u;
+	for (UINT i = 0u; i < A.GetMeshCount(); i++)
+	{
+		const MeshCacheMesh& MA = A.GetMesh(i);
+		const MeshCacheMesh& MB = B.GetMesh(i);
+		const bool bSame = strcmp(A.GetString(MA.Name), B.GetString(MB.Name)) == 0 && MA.Node == MB.Node && MA.Material == MB.Material &&
+			MA.VerticesOffset == MB.VerticesOffset && MA.IndicesOffset == MB.IndicesOffset && MA.VertexCount == MB.VertexCount && MA.IndexCount == MB.IndexCount &&
+			MA.MeshletOffset == MB.MeshletOffset && MA.MeshletCount == MB.MeshletCount && MA.LODCount == MB.LODCount &&
+			memcmp(MA.LODs, MB.LODs, sizeof(MeshLOD) * MAX_MESH_LODS) == 0;
+		Mismatches += bSame ? 0u : 1u;
+	}
+	for (UINT i = 0u; i < A.GetNodeCount(); i++)
+	{
+		const MeshCacheNode& NA = A.GetNode(i);
+		const MeshCacheNode& NB = B.GetNode(i);
+		const bool bSame = strcmp(A.GetString(NA.Name), B.GetString(NB.Name)) == 0 && NA.Parent == NB.Parent &&
+			memcmp(&NA.LocalTransform, &NB.LocalTransform, sizeof(DirectX::XMFLOAT4X4)) == 0 &&
+			memcmp(&NA.AccumulatedTransform, &NB.AccumulatedTransform, sizeof(DirectX::XMFLOAT4X4)) == 0;
+		Mismatches += bSame ? 0u : 1u;
+	}
+	for (UINT i = 0u; i < A.GetMaterialCount(); i++)
+	{
+		const MeshCacheMaterial& MA = A.GetMaterial(i);
+		const MeshCacheMaterial& MB = B.GetMaterial(i);
+		const bool bSame = strcmp(A.GetString(MA.Name), B.GetString(MB.Name)) == 0 &&
+			strcmp(A.GetString(MA.DiffuseTexture), B.GetString(MB.DiffuseTexture)) == 0 &&
+			strcmp(A.GetString(MA.SpecularTexture), B.GetString(MB.SpecularTexture)) == 0 &&
+			memcmp(&MA.DiffuseColor, &MB.DiffuseColor, sizeof(DirectX::XMFLOAT3)) == 0 && memcmp(&MA.Specular, &MB.Specular, sizeof(DirectX::XMFLOAT3)) == 0 &&
+			MA.bTwoSided == MB.bTwoSided && MA.bOpaque == MB.bOpaque;
+		Mismatches += bSame ? 0u : 1u;
+	}
+	Mismatches += memcmp(&A.GetBoundsMin(), &B.GetBoundsMin(), sizeof(DirectX::XMFLOAT3)) == 0 ? 0u : 1u;
+	Mismatches += memcmp(&A.GetBoundsMax(), &B.GetBoundsMax(), sizeof(DirectX::XMFLOAT3)) == 0 ? 0u : 1u;
+
+	return Mismatches;
+}
+
+void Benchmarks::RunMeshCacheBenchmark(std::ofstream& Out)
+{
+	const char* CachePath = "BenchmarkMesh.mvcache";
+	const UINT ImportFlags = ModelData::GetImportFlags();
+
+	// warm loads are everything LoadModel does before touching the device: hash the source, map and check the cache, copy the arrays out
+	std::vector<Vertex> Vertices;
+	std::vector<UINT> Indices;
+	auto WarmLoad = [&](const std::string& SourcePath, const std::string& Path, MeshCache& Cache)
+		{
+			unsigned long long Hash = 0ull;
+			if (!MeshCache::HashFile(SourcePath, Hash) || !Cache.Open(Path, Hash, ImportFlags))
+				return false;
+
+			Vertices.assign(Cache.GetVertices(), Cache.GetVertices() + Cache.GetVertexCount());
+			Indices.assign(Cache.GetIndices(), Cache.GetIndices() + Cache.GetIndexCount());
+			return true;
+		};
+
+	// the real assets, skipped when they are not next to the executable. Cold is the Assimp import the cache replaces
+	const char* ModelPaths[] = {
+		"Models/sphere.obj",
+		"Models/suzanne.obj",
+		"Models/teapot.obj",
+		"Models/fantasy_sword_stylized/scene.gltf",
+		"Models/american_fullsize_73/scene.gltf",
+		"Models/sponza-atrium-3/Sponza.gltf" };
+
+	for (const char* ModelPath : ModelPaths)
+	{
+		unsigned long long SourceHash = 0ull;
+		if (!MeshCache::HashFile(ModelPath, SourceHash))
+			continue;
+
+		MeshCache Imported;
+		bool bImported = false;
+		double Best = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS / 4; i++)
+		{
+			MeshCache Import;
+			auto Start = std::chrono::high_resolution_clock::now();
+			bImported = ModelData::ImportToCache(ModelPath, Import);
+			auto End = std::chrono::high_resolution_clock::now();
+
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+		if (!bImported || !ModelData::ImportToCache(ModelPath, Imported))
+			continue;
+
+		const UINT Triangles = Imported.GetIndexCount() / 3u;
+		WriteRow(Out, "MeshCacheImport", ModelPath, Triangles, Imported.GetVertexCount(), Best);
+
+		Imported.SetSource(SourceHash, ImportFlags);
+		Imported.Save(CachePath);
+
+		MeshCache Cache;
+		bool bLoaded = false;
+		Best = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+		{
+			Cache.Close();
+			auto Start = std::chrono::high_resolution_clock::now();
+			bLoaded = WarmLoad(ModelPath, CachePath, Cache);
+			auto End = std::chrono::high_resolution_clock::now();
+
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+		WriteRow(Out, "MeshCacheWarmLoad", ModelPath, Triangles, (UINT)Vertices.size(), Best);
+
+		WriteRow(Out, "MeshCacheValidate", ModelPath, Triangles, bLoaded ? CompareMeshCaches(Imported, Cache) : 1u, 0.0);
+		Cache.Close();
+	}
+
+	// synthetic caches the same size as small, medium and large models, always available
+	const UINT MeshCounts[] = { 16u, 64u, 256u };
+	const UINT QuadsPerSide = 64u;
+	for (UINT MeshCount : MeshCounts)
+	{
+		MeshCache Written;
+		BuildTestMeshCache(MeshCount, QuadsPerSide, Written);
+		Written.SetSource(0x1234567812345678ull, ImportFlags);
+		const UINT Triangles = Written.GetIndexCount() / 3u;
+
+		double Best = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS / 4; i++)
+		{
+			auto Start = std::chrono::high_resolution_clock::now();
+			Written.Save(CachePath);
+			auto End = std::chrono::high_resolution_clock::now();
+
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+		WriteRow(Out, "MeshCache", "Save", Triangles, Written.GetVertexCount(), Best);
+
+		MeshCache Cache;
+		bool bOpened = false;
+		Best = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+		{
+			Cache.Close();
+			auto Start = std::chrono::high_resolution_clock::now();
+			bOpened = Cache.Open(CachePath, 0x1234567812345678ull, ImportFlags);
+			Vertices.assign(Cache.GetVertices(), Cache.GetVertices() + Cache.GetVertexCount());
+			Indices.assign(Cache.GetIndices(), Cache.GetIndices() + Cache.GetIndexCount());
+			auto End = std::chrono::high_resolution_clock::now();
+
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+		WriteRow(Out, "MeshCache", "OpenAndCopy", Triangles, (UINT)Vertices.size(), Best);
+
+		// exactly what was written comes back, and a cache for another source or other import flags is refused
+		UINT Mismatches = bOpened ? CompareMeshCaches(Written, Cache) : 1u;
+		Cache.Close();
+		MeshCache Stale;
+		Mismatches += Stale.Open(CachePath, 0x1234567812345679ull, ImportFlags) ? 1u : 0u;
+		Stale.Close();
+		Mismatches += Stale.Open(CachePath, 0x1234567812345678ull, ImportFlags ^ 1u) ? 1u : 0u;
+		Stale.Close();
+		WriteRow(Out, "MeshCacheValidate", "RoundTrip", Triangles, Mismatches, 0.0);
+
+		// a truncated file must fail validation rather than hand out arrays past its end
+		{
+			std::ifstream In(CachePath, std::ios::binary);
+			std::vector<char> Bytes((std::istreambuf_iterator<char>(In)), std::istreambuf_iterator<char>());
+			In.close();
+			std::ofstream Truncated(CachePath, std::ios::binary | std::ios::trunc);
+			Truncated.write(Bytes.data(), (std::streamsize)(Bytes.size() / 2u));
+		}
+		Mismatches = Stale.Open(CachePath, 0x1234567812345678ull, ImportFlags) ? 1u : 0u;
+		Stale.Close();
+		WriteRow(Out, "MeshCacheValidate", "Truncated", Triangles, Mismatches, 0.0);
+	}
+
+	std::remove(CachePath);
+}
+
+// every triangle as the attributes of its three corners, rotated so the smallest corner comes first without changing the winding
+static void GetCanonicalTriangles(const std::vector<Vertex>& Vertices, const std::vector<UINT>& Indices, std::vector<std::string>& OutTriangles)
+{
+	OutTriangles.clear();
+	for (size_t t = 0u; t + 2u < Indices.size(); t += 3u)
+	{
+		std::string Corners[3];
+		for (UINT k = 0u; k < 3u; k++)
+		{
+			Corners[k].assign(reinterpret_cast<const char*>(&Vertices[Indices[t + k]]), sizeof(Vertex));
+		}
+		UINT First = 0u;
+		for (UINT k = 1u; k < 3u; k++)
+		{
+			First = Corners[k] < Corners[First] ? k : First;
+		}
+		OutTriangles.push_back(Corners[First] + Corners[(First + 1u) % 3u] + Corners[(First + 2u) % 3u]);
+	}
+	std::sort(OutTriangles.begin(), OutTriangles.end());
+}
+
+void Benchmarks::RunMeshOptimizerBenchmark(std::ofstream& Out)
+{
+	// a regular grid and a UV sphere, both with their triangles shuffled the way a careless exporter leaves them, and the grid again
+	// with every triangle carrying its own copies of its vertices
+	enum class TestMesh { Grid, Sphere, UnweldedGrid };
+	const struct { TestMesh Type; const char* Name; UINT Size; } Meshes[] = {
+		{ TestMesh::Grid, "GridShuffled", 64u },
+		{ TestMesh::Grid, "GridShuffled", 256u },
+		{ TestMesh::Sphere, "SphereShuffled", 64u },
+		{ TestMesh::Sphere, "SphereShuffled", 256u },
+		{ TestMesh::UnweldedGrid, "GridUnwelded", 64u },
+		{ TestMesh::UnweldedGrid, "GridUnwelded", 256u } };
+
+	std::mt19937 Generator(1337u);
+
+	for (const auto& Desc : Meshes)
+	{
+		std::vector<Vertex> SourceVertices;
+		std::vector<UINT> SourceIndices;
+		const UINT Side = Desc.Size + 1u;
+		for (UINT y = 0u; y < Side; y++)
+		{
+			for (UINT x = 0u; x < Side; x++)
+			{
+				const float u = (float)x / (float)Desc.Size;
+				const float v = (float)y / (float)Desc.Size;
+				Vertex Vert;
+				if (Desc.Type == TestMesh::Sphere)
+				{
+					const float Theta = u * DirectX::XM_2PI;
+					const float Phi = v * DirectX::XM_PI;
+					Vert.Pos = DirectX::XMFLOAT3(sinf(Phi) * cosf(Theta), cosf(Phi), sinf(Phi) * sinf(Theta));
+					Vert.Normal = Vert.Pos;
+				}
+				else
+				{
+					Vert.Pos = DirectX::XMFLOAT3(u, 0.f, v);
+					Vert.Normal = DirectX::XMFLOAT3(0.f, 1.f, 0.f);
+				}
+				Vert.TexCoord = DirectX::XMFLOAT2(u, v);
+				SourceVertices.push_back(Vert);
+			}
+		}
+
+		std::vector<UINT> Triangles;
+		for (UINT y = 0u; y < Desc.Size; y++)
+		{
+			for (UINT x = 0u; x < Desc.Size; x++)
+			{
+				const UINT i = y * Side + x;
+				const UINT Quad[] = { i, i + Side, i + 1u, i + 1u, i + Side, i + Side + 1u };
+				SourceIndices.insert(SourceIndices.end(), Quad, Quad + 6);
+			}
+		}
+		for (UINT t = 0u; t < (UINT)SourceIndices.size() / 3u; t++)
+		{
+			Triangles.push_back(t);
+		}
+		std::shuffle(Triangles.begin(), Triangles.end(), Generator);
+
+		std::vector<UINT> ShuffledIndices;
+		for (UINT t : Triangles)
+		{
+			ShuffledIndices.insert(ShuffledIndices.end(), SourceIndices.begin() + t * 3u, SourceIndices.begin() + t * 3u + 3u);
+		}
+		SourceIndices.swap(ShuffledIndices);
+
+		if (Desc.Type == TestMesh::UnweldedGrid)
+		{
+			std::vector<Vertex> Unwelded;
+			for (UINT& Index : SourceIndices)
+			{
+				Unwelded.push_back(SourceVertices[Index]);
+				Index = (UINT)Unwelded.size() - 1u;
+			}
+			SourceVertices.swap(Unwelded);
+		}
+
+		const UINT TriangleCount = (UINT)SourceIndices.size() / 3u;
+		std::vector<Vertex> Vertices;
+		std::vector<UINT> Indices;
+		MeshOptimizeStats Stats;
+		double Best = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS / 4; i++)
+		{
+			Vertices = SourceVertices;
+			Indices = SourceIndices;
+
+			auto Start = std::chrono::high_resolution_clock::now();
+			Stats = MeshOptimizer::Optimize(Vertices, Indices);
+			auto End = std::chrono::high_resolution_clock::now();
+
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+		WriteRow(Out, "MeshOptimizer", Desc.Name, TriangleCount, Stats.VerticesAfter, Best);
+
+		// cache figures in thousandths, the result column only holds integers
+		WriteRow(Out, "MeshOptimizerACMRx1000", (std::string(Desc.Name) + "Before").c_str(), TriangleCount, (UINT)(Stats.Before.ACMR * 1000.f), 0.0);
+		WriteRow(Out, "MeshOptimizerACMRx1000", (std::string(Desc.Name) + "After").c_str(), TriangleCount, (UINT)(Stats.After.ACMR * 1000.f), 0.0);
+		WriteRow(Out, "MeshOptimizerATVRx1000", (std::string(Desc.Name) + "Before").c_str(), TriangleCount, (UINT)(Stats.Before.ATVR * 1000.f), 0.0);
+		WriteRow(Out, "MeshOptimizerATVRx1000", (std::string(Desc.Name) + "After").c_str(), TriangleCount, (UINT)(Stats.After.ATVR * 1000.f), 0.0);
+
+		// the same triangles with the same corners and winding, no vertex left unused, and the cache never worse than the input
+		std::vector<std::string> Expected;
+		std::vector<std::string> Actual;
+		GetCanonicalTriangles(SourceVertices, SourceIndices, Expected);
+		GetCanonicalTriangles(Vertices, Indices, Actual);
+		UINT Mismatches = Expected == Actual ? 0u : 1u;
+
+		std::vector<bool> Used(Vertices.size(), false);
+		for (UINT Index : Indices)
+		{
+			Mismatches += Index < Vertices.size() ? 0u : 1u;
+			if (Index < Vertices.size())
+				Used[Index] = true;
+		}
+		Mismatches += (UINT)std::count(Used.begin(), Used.end(), false);
+		Mismatches += Stats.After.ACMR <= Stats.Before.ACMR ? 0u : 1u;
+		Mismatches += Desc.Type != TestMesh::UnweldedGrid || Stats.VerticesAfter == Side * Side ? 0u : 1u;
+		WriteRow(Out, "MeshOptimizerValidate", Desc.Name, TriangleCount, Mismatches, 0.0);
+	}
+
+	// the real assets through the import, cache figures weighted by triangle count over all of a model's meshes
+	const char* ModelPaths[] = {
+		"Models/suzanne.obj",
+		"Models/teapot.obj",
+		"Models/fantasy_sword_stylized/scene.gltf",
+		"Models/sponza-atrium-3/Sponza.gltf" };
+
+	for (const char* ModelPath : ModelPaths)
+	{
+		MeshCache Imported;
+		if (!ModelData::ImportToCache(ModelPath, Imported))
+			continue;
+
+		float Before = 0.f;
+		float After = 0.f;
+		UINT Triangles = 0u;
+		for (UINT m = 0u; m < Imported.GetMeshCount(); m++)
+		{
+			const MeshCacheMesh& Mesh = Imported.GetMesh(m);
+			const float MeshTriangles = (float)(Mesh.IndexCount / 3u);
+			Before += Mesh.OptimizeStats.Before.ACMR * MeshTriangles;
+			After += Mesh.OptimizeStats.After.ACMR * MeshTriangles;
+			Triangles += Mesh.IndexCount / 3u;
+		}
+		if (Triangles == 0u)
+			continue;
+
+		WriteRow(Out, "MeshOptimizerModelACMRx1000", (std::string(ModelPath) + " Before").c_str(), Triangles, (UINT)(Before / (float)Triangles * 1000.f), 0.0);
+		WriteRow(Out, "MeshOptimizerModelACMRx1000", (std::string(ModelPath) + " After").c_str(), Triangles, (UINT)(After / (float)Triangles * 1000.f), 0.0);
+	}
+}
+
+void Benchmarks::RunVertexCompressionBenchmark(std::ofstream& Out)
+{
+	const UINT VertexCounts[] = { 10000u, 100000u, 1000000u };
+	// meshes from a few centimetres to a whole level across, the position bound scales with the extent
+	const float MeshSizes[] = { 0.05f, 2.f, 500.f };
+
+	std::mt19937 Generator(1337u);
+	std::uniform_real_distribution<float> Unit(0.f, 1.f);
+	std::uniform_real_distribution<float> Signed(-1.f, 1.f);
+	std::uniform_real_distribution<float> TiledUV(-8.f, 8.f);
+
+	for (UINT Count : VertexCounts)
+	{
+		for (float MeshSize : MeshSizes)
+		{
+			// off center so the offset matters, normals uniform on the sphere plus the axes and folds where octahedral is weakest
+			const DirectX::XMFLOAT3 Center = { MeshSize * 3.f, -MeshSize, MeshSize * 0.5f };
+			std::vector<Vertex> Vertices(Count);
+			for (UINT i = 0u; i < Count; i++)
+			{
+				Vertex& v = Vertices[i];
+				v.Pos = { Center.x + Signed(Generator) * MeshSize, Center.y + Signed(Generator) * MeshSize * 0.5f, Center.z + Signed(Generator) * MeshSize * 0.25f };
+
+				DirectX::XMFLOAT3 n;
+				switch (i % 16u)
+				{
+				case 0u: n = { 0.f, 0.f, -1.f }; break;
+				case 1u: n = { 1.f, 0.f, 0.f }; break;
+				case 2u: n = { 0.f, -1.f, 0.f }; break;
+				case 3u: n = { Signed(Generator), Signed(Generator), 0.f }; break;
+				default: n = { Signed(Generator), Signed(Generator), Signed(Generator) }; break;
+				}
+				DirectX::XMStoreFloat3(&v.Normal, DirectX::XMVector3Normalize(DirectX::XMLoadFloat3(&n)));
+				v.TexCoord = i % 2u == 0u ? DirectX::XMFLOAT2(Unit(Generator), Unit(Generator)) : DirectX::XMFLOAT2(TiledUV(Generator), TiledUV(Generator));
+			}
+
+			const VertexQuantization Quantization = VertexCompression::GetQuantization(Vertices.data(), Count);
+			std::vector<PackedVertex> Packed(Count);
+			std::vector<Vertex> Decoded(Count);
+
+			double Best = DBL_MAX;
+			for (int i = 0; i < BENCHMARK_ITERATIONS / 4; i++)
+			{
+				auto Start = std::chrono::high_resolution_clock::now();
+				for (UINT v = 0u; v < Count; v++)
+				{
+					Packed[v] = VertexCompression::Encode(Vertices[v], Quantization);
+				}
+				auto End = std::chrono::high_resolution_clock::now();
+
+				Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+			}
+			WriteRow(Out, "VertexCompression", "Encode", Count, (UINT)(sizeof(PackedVertex) * Count), Best);
+
+			Best = DBL_MAX;
+			for (int i = 0; i < BENCHMARK_ITERATIONS / 4; i++)
+			{
+				auto Start = std::chrono::high_resolution_clock::now();
+				for (UINT v = 0u; v < Count; v++)
+				{
+					Decoded[v] = VertexCompression::Decode(Packed[v], Quantization);
+				}
+				auto End = std::chrono::high_resolution_clock::now();
+
+				Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+			}
+			WriteRow(Out, "VertexCompression", "Decode", Count, (UINT)(sizeof(Vertex) * Count), Best);
+
+			// every decoded attribute inside its bound: half a quantisation step for positions, a hundredth of a degree for normals
+			// and half a unit in the last place of a half for texture coordinates
+			const float PositionBound = VertexCompression::GetPositionErrorBound(Quantization);
+			const float NormalBound = DirectX::XMConvertToRadians(0.01f);
+			UINT PositionErrors = 0u;
+			UINT NormalErrors = 0u;
+			UINT TexCoordErrors = 0u;
+			for (UINT v = 0u; v < Count; v++)
+			{
+				const Vertex& a = Vertices[v];
+				const Vertex& b = Decoded[v];
+				PositionErrors += (fabsf(a.Pos.x - b.Pos.x) > PositionBound || fabsf(a.Pos.y - b.Pos.y) > PositionBound || fabsf(a.Pos.z - b.Pos.z) > PositionBound) ? 1u : 0u;
+				// angle from the cross and dot products, a cosine is too flat near zero to resolve a hundredth of a degree in float
+				DirectX::XMVECTOR na = DirectX::XMLoadFloat3(&a.Normal);
+				DirectX::XMVECTOR nb = DirectX::XMLoadFloat3(&b.Normal);
+				const float Angle = atan2f(DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVector3Cross(na, nb))), DirectX::XMVectorGetX(DirectX::XMVector3Dot(na, nb)));
+				NormalErrors += Angle > NormalBound ? 1u : 0u;
+
+				auto TexCoordBound = [](float Value) { return fabsf(Value) * (1.f / 2048.f) + 2.98023224e-8f; };
+				TexCoordErrors += (fabsf(a.TexCoord.x - b.TexCoord.x) > TexCoordBound(a.TexCoord.x) || fabsf(a.TexCoord.y - b.TexCoord.y) > TexCoordBound(a.TexCoord.y)) ? 1u : 0u;
+			}
+			WriteRow(Out, "VertexCompressionValidate", "PositionBound", Count, PositionErrors, 0.0);
+			WriteRow(Out, "VertexCompressionValidate", "NormalBound", Count, NormalErrors, 0.0);
+			WriteRow(Out, "VertexCompressionValidate", "TexCoordBound", Count, TexCoordErrors, 0.0);
+		}
+	}
+
+	// every half survives a round trip through float unchanged, NaNs only have to stay NaN
+	UINT HalfMismatches = 0u;
+	for (UINT h = 0u; h < 0x10000u; h++)
+	{
+		const float Value = VertexCompression::HalfToFloat((unsigned short)h);
+		const unsigned short Back = VertexCompression::FloatToHalf(Value);
+		const bool bNaN = (h & 0x7C00u) == 0x7C00u && (h & 0x3FFu) != 0u;
+		HalfMismatches += bNaN ? (Value == Value ? 1u : 0u) : (Back == (unsigned short)h || ((h & 0x7FFFu) == 0x7C00u && (Back & 0x7FFFu) == 0x7BFFu) ? 0u : 1u);
+	}
+	// ties round to even, values past the largest half clamp to it
+	HalfMismatches += VertexCompression::FloatToHalf(1.f + 1.f / 2048.f) == 0x3C00u ? 0u : 1u;
+	HalfMismatches += VertexCompression::FloatToHalf(1.f + 3.f / 2048.f) == 0x3C02u ? 0u : 1u;
+	HalfMismatches += VertexCompression::FloatToHalf(1e6f) == 0x7BFFu ? 0u : 1u;
+	HalfMismatches += VertexCompression::FloatToHalf(-1e6f) == 0xFBFFu ? 0u : 1u;
+	HalfMismatches += VertexCompression::FloatToHalf(2.98023224e-8f) == 0x0000u ? 0u : 1u;
+	HalfMismatches += VertexCompression::FloatToHalf(5.96046448e-8f) == 0x0001u ? 0u : 1u;
+	WriteRow(Out, "VertexCompressionValidate", "HalfRoundTrip", 0x10000u, HalfMismatches, 0.0);
+
+	// geometry memory of a typical imported mesh, full vertices with 32 bit indices against packed ones with 16 bit indices
+	const UINT MeshVertices = 40000u;
+	const UINT MeshIndices = MeshVertices * 6u;
+	WriteRow(Out, "VertexCompressionBytes", "Full32", MeshVertices, (UINT)(sizeof(Vertex) * MeshVertices + sizeof(UINT) * MeshIndices), 0.0);
+	WriteRow(Out, "VertexCompressionBytes", "Packed16", MeshVertices, (UINT)(sizeof(PackedVertex) * MeshVertices + sizeof(unsigned short) * MeshIndices), 0.0);
+}
+
+// limits, contiguous coverage of every triangle in order, exact vertex counts and spheres that hold every vertex they should
+static UINT ValidateMeshlets(const std::vector<Vertex>& Vertices, const std::vector<UINT>& Indices, const std::vector<Meshlet>& Meshlets)
+{
+	UINT Errors = 0u;
+	UINT NextIndex = 0u;
+	std::vector<UINT> Unique;
+	for (const Meshlet& m : Meshlets)
+	{
+		Errors += m.IndexOffset == NextIndex ? 0u : 1u;
+		Errors += m.TriangleCount > 0u && m.TriangleCount <= MESHLET_MAX_TRIANGLES && m.VertexCount <= MESHLET_MAX_VERTICES ? 0u : 1u;
+		NextIndex = m.IndexOffset + m.TriangleCount * 3u;
+		if (NextIndex > (UINT)Indices.size())
+			return Errors + 1u;
+
+		Unique.assign(Indices.begin() + m.IndexOffset, Indices.begin() + NextIndex);
+		std::sort(Unique.begin(), Unique.end());
+		Errors += (UINT)(std::unique(Unique.begin(), Unique.end()) - Unique.begin()) == m.VertexCount ? 0u : 1u;
+
+		for (UINT i = m.IndexOffset; i < NextIndex; i++)
+		{
+			const DirectX::XMFLOAT3& Pos = Vertices[Indices[i]].Pos;
+			const float dx = Pos.x - m.Center.x, dy = Pos.y - m.Center.y, dz = Pos.z - m.Center.z;
+			Errors += sqrtf(dx * dx + dy * dy + dz * dz) <= m.Radius * (1.f + 1e-5f) + 1e-6f ? 0u : 1u;
+		}
+	}
+	Errors += NextIndex == (UINT)Indices.size() ? 0u : 1u;
+	return Errors;
+}
+
+// every triangle the ranges leave out has to be invisible anyway, fully behind one frustum plane or facing away from the camera when
+// cone culling is on. The ranges have to be in order, inside the mesh and not overlap
+static UINT ValidateClusterRanges(const std::vector<Vertex>& Vertices, const std::vector<UINT>& Indices, const DirectX::XMMATRIX& World, UINT FirstIndex,
+	const Frustum& View, const DirectX::XMFLOAT3& CameraPosition, bool bConeCulling, const std::vector<ClusterDrawRange>& Ranges)
+{
+	UINT Errors = 0u;
+	const UINT TriangleCount = (UINT)Indices.size() / 3u;
+	std::vector<unsigned char> Drawn(TriangleCount, 0u);
+	UINT End = FirstIndex;
+	for (const ClusterDrawRange& Range : Ranges)
+	{
+		if (Range.StartIndex < End || Range.IndexCount % 3u != 0u || Range.StartIndex + Range.IndexCount > FirstIndex + (UINT)Indices.size() || (Range.StartIndex - FirstIndex) % 3u != 0u)
+			return Errors + 1u;
+
+		End = Range.StartIndex + Range.IndexCount;
+		for (UINT i = Range.StartIndex; i < End; i += 3u)
+		{
+			Drawn[(i - FirstIndex) / 3u] = 1u;
+		}
+	}
+
+	const DirectX::XMVECTOR Camera = DirectX::XMLoadFloat3(&CameraPosition);
+	for (UINT t = 0u; t < TriangleCount; t++)
+	{
+		if (Drawn[t])
+			continue;
+
+		DirectX::XMVECTOR p[3];
+		for (UINT k = 0u; k < 3u; k++)
+		{
+			p[k] = DirectX::XMVector3Transform(DirectX::XMLoadFloat3(&Vertices[Indices[t * 3u + k]].Pos), World);
+		}
+
+		bool bOutside = false;
+		for (UINT Plane = 0u; Plane < Frustum::PlaneCount && !bOutside; Plane++)
+		{
+			const DirectX::XMVECTOR P = DirectX::XMLoadFloat4(&View.GetPlane(Plane));
+			bOutside = DirectX::XMVectorGetX(DirectX::XMPlaneDotCoord(P, p[0])) < 0.f && DirectX::XMVectorGetX(DirectX::XMPlaneDotCoord(P, p[1])) < 0.f &&
+				DirectX::XMVectorGetX(DirectX::XMPlaneDotCoord(P, p[2])) < 0.f;
+		}
+
+		// clockwise front faces, the camera on the back side of the plane or close enough to edge on that float cannot tell
+		const DirectX::XMVECTOR Normal = DirectX::XMVector3Cross(DirectX::XMVectorSubtract(p[1], p[0]), DirectX::XMVectorSubtract(p[2], p[0]));
+		const DirectX::XMVECTOR ToCamera = DirectX::XMVectorSubtract(Camera, p[0]);
+		const float Facing = DirectX::XMVectorGetX(DirectX::XMVector3Dot(ToCamera, Normal));
+		const float Tolerance = 1e-5f * DirectX::XMVectorGetX(DirectX::XMVector3Length(ToCamera)) * DirectX::XMVectorGetX(DirectX::XMVector3Length(Normal));
+		const bool bBackfacing = bConeCulling && Facing <= Tolerance;
+
+		Errors += bOutside || bBackfacing ? 0u : 1u;
+	}
+	return Errors;
+}
+
+void Benchmarks::RunClusterCullingBenchmark(std::ofstream& Out)
+{
+	// a closed sphere seen from outside, where about half of every view is backfacing, and a terrain seen from inside, where most of
+	// it is off screen. Both go through the import pipeline first: shuffled, optimised, then clustered
+	enum class TestMesh { Sphere, Terrain };
+	const struct { TestMesh Type; const char* Name; UINT Size; } Meshes[] = {
+		{ TestMesh::Sphere, "Sphere", 128u },
+		{ TestMesh::Sphere, "Sphere", 256u },
+		{ TestMesh::Terrain, "Terrain", 128u },
+		{ TestMesh::Terrain, "Terrain", 256u } };
+
+	const UINT MapSize = 256u;
+	const std::vector<float> Heights = GenerateTestHeightmap(MapSize);
+	const DirectX::XMMATRIX Proj = DirectX::XMMatrixPerspectiveFovLH(DirectX::XMConvertToRadians(60.f), 16.f / 9.f, 0.1f, 2000.f);
+	// meshes start somewhere in the index buffer, like every mesh but the first of a model
+	const UINT FirstIndex = 3000u;
+	const UINT FrameCount = 64u;
+
+	std::mt19937 Generator(1337u);
+
+	for (const auto& Desc : Meshes)
+	{
+		std::vector<Vertex> Vertices;
+		std::vector<UINT> Indices;
+		const UINT Side = Desc.Size + 1u;
+		for (UINT y = 0u; y < Side; y++)
+		{
+			for (UINT x = 0u; x < Side; x++)
+			{
+				const float u = (float)x / (float)Desc.Size;
+				const float v = (float)y / (float)Desc.Size;
+				Vertex Vert;
+				if (Desc.Type == TestMesh::Sphere)
+				{
+					const float Theta = u * DirectX::XM_2PI;
+					const float Phi = v * DirectX::XM_PI;
+					Vert.Pos = DirectX::XMFLOAT3(sinf(Phi) * cosf(Theta), cosf(Phi), sinf(Phi) * sinf(Theta));
+					Vert.Normal = Vert.Pos;
+				}
+				else
+				{
+					Vert.Pos = DirectX::XMFLOAT3(u, SampleTestHeightmap(Heights, MapSize, u, v), v);
+					Vert.Normal = DirectX::XMFLOAT3(0.f, 1.f, 0.f);
+				}
+				Vert.TexCoord = DirectX::XMFLOAT2(u, v);
+				Vertices.push_back(Vert);
+			}
+		}
+
+		// both wound clockwise seen from outside the sphere and from above the terrain
+		for (UINT y = 0u; y < Desc.Size; y++)
+		{
+			for (UINT x = 0u; x < Desc.Size; x++)
+			{
+				const UINT i = y * Side + x;
+				const UINT SphereQuad[] = { i, i + 1u, i + Side, i + 1u, i + Side + 1u, i + Side };
+				const UINT TerrainQuad[] = { i, i + Side, i + 1u, i + 1u, i + Side, i + Side + 1u };
+				const UINT* Quad = Desc.Type == TestMesh::Sphere ? SphereQuad : TerrainQuad;
+				Indices.insert(Indices.end(), Quad, Quad + 6);
+			}
+		}
+
+		std::vector<UINT> Triangles(Indices.size() / 3u);
+		for (UINT t = 0u; t < (UINT)Triangles.size(); t++)
+		{
+			Triangles[t] = t;
+		}
+		std::shuffle(Triangles.begin(), Triangles.end(), Generator);
+		std::vector<UINT> Shuffled;
+		for (UINT t : Triangles)
+		{
+			Shuffled.insert(Shuffled.end(), Indices.begin() + t * 3u, Indices.begin() + t * 3u + 3u);
+		}
+		Indices.swap(Shuffled);
+		MeshOptimizer::Optimize(Vertices, Indices);
+		const UINT TriangleCount = (UINT)Indices.size() / 3u;
+
+		std::vector<Meshlet> Meshlets;
+		double Best = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS / 4; i++)
+		{
+			auto Start = std::chrono::high_resolution_clock::now();
+			MeshletBuilder::Build(Vertices.data(), (UINT)Vertices.size(), Indices.data(), (UINT)Indices.size(), Meshlets);
+			auto End = std::chrono::high_resolution_clock::now();
+
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+		WriteRow(Out, "ClusterBuild", Desc.Name, TriangleCount, (UINT)Meshlets.size(), Best);
+		WriteRow(Out, "ClusterBuildValidate", Desc.Name, TriangleCount, ValidateMeshlets(Vertices, Indices, Meshlets), 0.0);
+
+		// squashed and turned so the local space camera has to undo a non uniform scale, cameras orbit outside the sphere and turn on
+		// the spot just above the terrain
+		const bool bSphere = Desc.Type == TestMesh::Sphere;
+		const DirectX::XMMATRIX World = bSphere ?
+			DirectX::XMMatrixScaling(40.f, 25.f, 40.f) * DirectX::XMMatrixRotationY(0.3f) * DirectX::XMMatrixTranslation(10.f, 5.f, -20.f) :
+			DirectX::XMMatrixScaling(400.f, 60.f, 400.f) * DirectX::XMMatrixTranslation(-200.f, 0.f, -200.f);
+		std::vector<DirectX::XMMATRIX> Views(FrameCount);
+		std::vector<DirectX::XMFLOAT3> Cameras(FrameCount);
+		for (UINT f = 0u; f < FrameCount; f++)
+		{
+			const float Angle = DirectX::XM_2PI * (float)f / (float)FrameCount;
+			const DirectX::XMVECTOR Eye = bSphere ? DirectX::XMVectorSet(10.f + 90.f * cosf(Angle), 5.f + 20.f * sinf(Angle * 3.f), -20.f + 90.f * sinf(Angle), 1.f) :
+				DirectX::XMVectorSet(0.f, 50.f, 0.f, 1.f);
+			const DirectX::XMVECTOR Target = bSphere ? DirectX::XMVectorSet(10.f, 5.f, -20.f, 1.f) :
+				DirectX::XMVectorAdd(Eye, DirectX::XMVectorSet(cosf(Angle), -0.2f, sinf(Angle), 0.f));
+			Views[f] = DirectX::XMMatrixLookAtLH(Eye, Target, DirectX::XMVectorSet(0.f, 1.f, 0.f, 0.f)) * Proj;
+			DirectX::XMStoreFloat3(&Cameras[f], Eye);
+		}
+
+		ClusterCuller Culler;
+		std::vector<ClusterDrawRange> Ranges;
+		for (bool bCone : { false, true })
+		{
+			Culler.SetConeCulling(bCone);
+			UINT64 Rejected = 0u;
+			UINT64 Draws = 0u;
+			Best = DBL_MAX;
+			for (int i = 0; i < BENCHMARK_ITERATIONS / 4; i++)
+			{
+				Rejected = 0u;
+				Draws = 0u;
+				auto Start = std::chrono::high_resolution_clock::now();
+				for (UINT f = 0u; f < FrameCount; f++)
+				{
+					Culler.SetView(Views[f], Cameras[f]);
+					Ranges.clear();
+					Rejected += Culler.Cull(Meshlets.data(), (UINT)Meshlets.size(), World, FirstIndex, Ranges);
+					Draws += Ranges.size();
+				}
+				auto End = std::chrono::high_resolution_clock::now();
+
+				Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count() / (double)FrameCount);
+			}
+			// triangles rejected and draw ranges per frame, out of TriangleCount
+			WriteRow(Out, "ClusterCullRejected", bCone ? (bSphere ? "SphereFrustumCone" : "TerrainFrustumCone") : (bSphere ? "SphereFrustum" : "TerrainFrustum"),
+				TriangleCount, (UINT)(Rejected / FrameCount), Best);
+			WriteRow(Out, "ClusterCullRanges", bCone ? (bSphere ? "SphereFrustumCone" : "TerrainFrustumCone") : (bSphere ? "SphereFrustum" : "TerrainFrustum"),
+				TriangleCount, (UINT)(Draws / FrameCount), 0.0);
+
+			// the benchmark frames plus random cameras all around and inside the mesh, where the cone apex is closest
+			UINT Errors = 0u;
+			std::uniform_real_distribution<float> Offset(-120.f, 120.f);
+			for (UINT f = 0u; f < FrameCount * 2u; f++)
+			{
+				DirectX::XMMATRIX ViewProj = f < FrameCount ? Views[f] : DirectX::XMMatrixIdentity();
+				DirectX::XMFLOAT3 Camera = f < FrameCount ? Cameras[f] : DirectX::XMFLOAT3(Offset(Generator), Offset(Generator) * 0.5f + 30.f, Offset(Generator));
+				if (f >= FrameCount)
+				{
+					const DirectX::XMVECTOR Eye = DirectX::XMLoadFloat3(&Camera);
+					const DirectX::XMVECTOR Target = DirectX::XMVectorSet(Offset(Generator), 0.f, Offset(Generator), 1.f);
+					ViewProj = DirectX::XMMatrixLookAtLH(Eye, Target, DirectX::XMVectorSet(0.f, 1.f, 0.f, 0.f)) * Proj;
+				}
+
+				Culler.SetView(ViewProj, Camera);
+				Ranges.clear();
+				Culler.Cull(Meshlets.data(), (UINT)Meshlets.size(), World, FirstIndex, Ranges);
+				Errors += ValidateClusterRanges(Vertices, Indices, World, FirstIndex, Frustum(ViewProj), Camera, bCone, Ranges);
+			}
+
+			// a mirrored instance flips the winding the rasterizer sees, the cone test must not reject anything the frustum keeps
+			const DirectX::XMMATRIX Mirrored = DirectX::XMMatrixScaling(-1.f, 1.f, 1.f) * World;
+			Culler.SetView(Views[0], Cameras[0]);
+			Ranges.clear();
+			Culler.Cull(Meshlets.data(), (UINT)Meshlets.size(), Mirrored, FirstIndex, Ranges);
+			Errors += ValidateClusterRanges(Vertices, Indices, Mirrored, FirstIndex, Frustum(Views[0]), Cameras[0], false, Ranges);
+
+			WriteRow(Out, "ClusterCullValidate", bCone ? (bSphere ? "SphereFrustumCone" : "TerrainFrustumCone") : (bSphere ? "SphereFrustum" : "TerrainFrustum"),
+				TriangleCount, Errors, 0.0);
+		}
+
+		// a field of instances, some mirrored, culled one at a time with a draw per range per instance against all at once with one
+		// instanced draw per range. Both have to draw exactly the same index ranges for every instance
+		const UINT InstanceSide = 8u;
+		const UINT InstanceCount = InstanceSide * InstanceSide;
+		const float Spacing = bSphere ? 60.f : 100.f;
+		std::vector<DirectX::XMMATRIX> Instances(InstanceCount);
+		for (UINT i = 0u; i < InstanceCount; i++)
+		{
+			const float x = ((float)(i % InstanceSide) - InstanceSide * 0.5f) * Spacing;
+			const float z = ((float)(i / InstanceSide) - InstanceSide * 0.5f) * Spacing;
+			const DirectX::XMMATRIX Mirror = i % 7u == 0u ? DirectX::XMMatrixScaling(-1.f, 1.f, 1.f) : DirectX::XMMatrixIdentity();
+			// stored transposed, the way the culled transforms are uploaded
+			Instances[i] = DirectX::XMMatrixTranspose(Mirror * World * DirectX::XMMatrixTranslation(x, 0.f, z));
+		}
+
+		Culler.SetConeCulling(true);
+		std::vector<UINT> InstanceList;
+		std::vector<ClusterInstancedRange> InstancedRanges;
+		UINT64 PerInstanceDraws = 0u;
+		UINT64 InstancedDraws = 0u;
+		double BestPerInstance = DBL_MAX;
+		double BestInstanced = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS / 4; i++)
+		{
+			PerInstanceDraws = 0u;
+			InstancedDraws = 0u;
+			auto Start = std::chrono::high_resolution_clock::now();
+			for (UINT f = 0u; f < FrameCount; f += 8u)
+			{
+				Culler.SetView(Views[f], Cameras[f]);
+				for (UINT Instance = 0u; Instance < InstanceCount; Instance++)
+				{
+					Ranges.clear();
+					Culler.Cull(Meshlets.data(), (UINT)Meshlets.size(), DirectX::XMMatrixTranspose(Instances[Instance]), FirstIndex, Ranges);
+					PerInstanceDraws += Ranges.size();
+				}
+			}
+			auto Mid = std::chrono::high_resolution_clock::now();
+			for (UINT f = 0u; f < FrameCount; f += 8u)
+			{
+				Culler.SetView(Views[f], Cameras[f]);
+				InstanceList.clear();
+				InstancedRanges.clear();
+				Culler.CullInstances(Meshlets.data(), (UINT)Meshlets.size(), DirectX::XMMatrixIdentity(), Instances.data(), InstanceCount, 0u, FirstIndex, InstanceList, InstancedRanges);
+				InstancedDraws += InstancedRanges.size();
+			}
+			auto End = std::chrono::high_resolution_clock::now();
+
+			BestPerInstance = std::min(BestPerInstance, std::chrono::duration<double, std::milli>(Mid - Start).count() / (double)(FrameCount / 8u));
+			BestInstanced = std::min(BestInstanced, std::chrono::duration<double, std::milli>(End - Mid).count() / (double)(FrameCount / 8u));
+		}
+		// draws per frame over the whole field
+		WriteRow(Out, "ClusterCullInstanced", bSphere ? "SpherePerInstance" : "TerrainPerInstance", InstanceCount, (UINT)(PerInstanceDraws / (FrameCount / 8u)), BestPerInstance);
+		WriteRow(Out, "ClusterCullInstanced", bSphere ? "SphereInstanced" : "TerrainInstanced", InstanceCount, (UINT)(InstancedDraws / (FrameCount / 8u)), BestInstanced);
+
+		// every instance's ranges from both, split back into one list per instance and merged where they touch
+		auto Normalize = [](std::vector<ClusterDrawRange>& List)
+			{
+				std::sort(List.begin(), List.end(), [](const ClusterDrawRange& a, const ClusterDrawRange& b) { return a.StartIndex < b.StartIndex; });
+				std::vector<ClusterDrawRange> Merged;
+				for (const ClusterDrawRange& r : List)
+				{
+					if (!Merged.empty() && Merged.back().StartIndex + Merged.back().IndexCount == r.StartIndex)
+						Merged.back().IndexCount += r.IndexCount;
+					else
+						Merged.push_back(r);
+				}
+				List.swap(Merged);
+			};
+
+		UINT InstancedErrors = 0u;
+		std::vector<std::vector<ClusterDrawRange>> Expected(InstanceCount);
+		std::vector<std::vector<ClusterDrawRange>> Actual(InstanceCount);
+		const UINT FirstInstance = 100u;
+		for (UINT f = 0u; f < FrameCount; f += 4u)
+		{
+			Culler.SetView(Views[f], Cameras[f]);
+			UINT ExpectedRejected = 0u;
+			for (UINT Instance = 0u; Instance < InstanceCount; Instance++)
+			{
+				Expected[Instance].clear();
+				ExpectedRejected += Culler.Cull(Meshlets.data(), (UINT)Meshlets.size(), DirectX::XMMatrixTranspose(Instances[Instance]), FirstIndex, Expected[Instance]);
+				Normalize(Expected[Instance]);
+				Actual[Instance].clear();
+			}
+
+			InstanceList.clear();
+			InstancedRanges.clear();
+			const UINT Rejected = Culler.CullInstances(Meshlets.data(), (UINT)Meshlets.size(), DirectX::XMMatrixIdentity(), Instances.data(), InstanceCount, FirstInstance, FirstIndex,
+				InstanceList, InstancedRanges);
+			InstancedErrors += Rejected != ExpectedRejected ? 1u : 0u;
+			for (const ClusterInstancedRange& r : InstancedRanges)
+			{
+				for (UINT i = r.FirstInstance; i < r.FirstInstance + r.InstanceCount; i++)
+				{
+					const UINT Instance = InstanceList[i] - FirstInstance;
+					// within a range instances are listed once each and in order
+					InstancedErrors += (Instance >= InstanceCount || (i > r.FirstInstance && InstanceList[i] <= InstanceList[i - 1u])) ? 1u : 0u;
+					if (Instance < InstanceCount)
+						Actual[Instance].push_back({ r.StartIndex, r.IndexCount });
+				}
+			}
+			for (UINT Instance = 0u; Instance < InstanceCount; Instance++)
+			{
+				Normalize(Actual[Instance]);
+				InstancedErrors += Actual[Instance].size() != Expected[Instance].size() ? 1u : 0u;
+				for (size_t r = 0u; r < std::min(Actual[Instance].size(), Expected[Instance].size()); r++)
+				{
+					InstancedErrors += (Actual[Instance][r].StartIndex != Expected[Instance][r].StartIndex || Actual[Instance][r].IndexCount != Expected[Instance][r].IndexCount) ? 1u : 0u;
+				}
+			}
+		}
+		WriteRow(Out, "ClusterCullValidate", bSphere ? "SphereInstanced" : "TerrainInstanced", InstanceCount, InstancedErrors, 0.0);
+	}
+}
+
+// half edges without their opposite. With bPositions vertices sharing a position count as one, so only the mesh's real boundary is
+// open, without it UV seams are open as well
+static void GetOpenEdges(const std::vector<Vertex>& Vertices, const UINT* Indices, UINT IndexCount, bool bPositions, std::vector<std::pair<UINT, UINT>>& OutEdges)
+{
+	std::map<std::tuple<float, float, float>, UINT> Positions;
+	std::vector<UINT> Remap(Vertices.size());
+	for (UINT v = 0u; v < (UINT)Vertices.size(); v++)
+	{
+		const std::tuple<float, float, float> Key(Vertices[v].Pos.x, Vertices[v].Pos.y, Vertices[v].Pos.z);
+		Remap[v] = bPositions ? Positions.emplace(Key, v).first->second : v;
+	}
+
+	std::set<std::pair<UINT, UINT>> HalfEdges;
+	for (UINT i = 0u; i < IndexCount; i++)
+	{
+		HalfEdges.emplace(Remap[Indices[i]], Remap[Indices[i - i % 3u + (i + 1u) % 3u]]);
+	}
+
+	OutEdges.clear();
+	for (UINT i = 0u; i < IndexCount; i++)
+	{
+		const UINT a = Indices[i];
+		const UINT b = Indices[i - i % 3u + (i + 1u) % 3u];
+		if (HalfEdges.count({ Remap[b], Remap[a] }) == 0u)
+			OutEdges.emplace_back(a, b);
+	}
+}
+
+void Benchmarks::RunMeshSimplifierBenchmark(std::ofstream& Out)
+{
+	// a UV sphere with its seam at u = 0 and 1 and every pole vertex split by u, a flat grid and a terrain whose borders have to stay
+	// put, and a flat grid split down the middle by a UV seam. All go through the import optimisation first
+	enum class TestMesh { Sphere, Grid, Terrain, SeamGrid };
+	const struct { TestMesh Type; const char* Name; UINT Size; } Meshes[] = {
+		{ TestMesh::Sphere, "Sphere", 64u },
+		{ TestMesh::Grid, "Grid", 128u },
+		{ TestMesh::Terrain, "Terrain", 128u },
+		{ TestMesh::SeamGrid, "SeamGrid", 128u } };
+
+	const UINT MapSize = 256u;
+	const std::vector<float> Heights = GenerateTestHeightmap(MapSize);
+
+	for (const auto& Desc : Meshes)
+	{
+		std::vector<Vertex> Vertices;
+		std::vector<UINT> Indices;
+		const UINT Side = Desc.Size + 1u;
+		const UINT Half = Desc.Size / 2u;
+		for (UINT y = 0u; y < Side; y++)
+		{
+			for (UINT x = 0u; x < Side; x++)
+			{
+				const float u = (float)x / (float)Desc.Size;
+				const float v = (float)y / (float)Desc.Size;
+				Vertex Vert;
+				Vert.Normal = DirectX::XMFLOAT3(0.f, 1.f, 0.f);
+				Vert.TexCoord = DirectX::XMFLOAT2(u, v);
+				if (Desc.Type == TestMesh::Sphere)
+				{
+					// the last column is the first one again, and the poles are one point, exactly
+					const float Theta = x == Desc.Size ? 0.f : u * DirectX::XM_2PI;
+					const float Phi = v * DirectX::XM_PI;
+					Vert.Pos = DirectX::XMFLOAT3(sinf(Phi) * cosf(Theta), cosf(Phi), sinf(Phi) * sinf(Theta));
+					Vert.Pos = y == 0u ? DirectX::XMFLOAT3(0.f, 1.f, 0.f) : (y == Desc.Size ? DirectX::XMFLOAT3(0.f, -1.f, 0.f) : Vert.Pos);
+					Vert.Normal = Vert.Pos;
+				}
+				else if (Desc.Type == TestMesh::Terrain)
+				{
+					Vert.Pos = DirectX::XMFLOAT3(u, SampleTestHeightmap(Heights, MapSize, u, v) * 0.2f, v);
+				}
+				else
+				{
+					Vert.Pos = DirectX::XMFLOAT3(u, 0.f, v);
+				}
+
+				// each half of the seam grid is mapped on its own, the middle column is the right half's u = 0 here
+				if (Desc.Type == TestMesh::SeamGrid)
+				{
+					Vert.TexCoord.x = x < Half ? u * 2.f : u * 2.f - 1.f;
+				}
+				Vertices.push_back(Vert);
+			}
+		}
+
+		// the left half's copy of the middle column, u = 1
+		std::vector<UINT> LeftSeam(Side);
+		if (Desc.Type == TestMesh::SeamGrid)
+		{
+			for (UINT y = 0u; y < Side; y++)
+			{
+				Vertex Vert = Vertices[y * Side + Half];
+				Vert.TexCoord.x = 1.f;
+				LeftSeam[y] = (UINT)Vertices.size();
+				Vertices.push_back(Vert);
+			}
+		}
+
+		// clockwise from outside the sphere and from above the grids
+		for (UINT y = 0u; y < Desc.Size; y++)
+		{
+			for (UINT x = 0u; x < Desc.Size; x++)
+			{
+				const UINT i = y * Side + x;
+				UINT SphereQuad[] = { i, i + 1u, i + Side, i + 1u, i + Side + 1u, i + Side };
+				UINT GridQuad[] = { i, i + Side, i + 1u, i + 1u, i + Side, i + Side + 1u };
+				if (Desc.Type == TestMesh::SeamGrid && x + 1u == Half)
+				{
+					GridQuad[2] = LeftSeam[y];
+					GridQuad[3] = LeftSeam[y];
+					GridQuad[5] = LeftSeam[y + 1u];
+				}
+				// the sphere's triangles with two corners on a pole would have no area
+				const bool bSphere = Desc.Type == TestMesh::Sphere;
+				const UINT* Quad = bSphere ? SphereQuad : GridQuad;
+				const UINT First = bSphere && y == 0u ? 3u : 0u;
+				const UINT Last = bSphere && y + 1u == Desc.Size ? 3u : 6u;
+				Indices.insert(Indices.end(), Quad + First, Quad + Last);
+			}
+		}
+
+		MeshOptimizer::Optimize(Vertices, Indices);
+		const UINT TriangleCount = (UINT)Indices.size() / 3u;
+
+		std::vector<MeshLOD> LODs;
+		std::vector<UINT> LODIndices;
+		double Best = DBL_MAX;
+		for (int i = 0; i < BENCHMARK_ITERATIONS / 4; i++)
+		{
+			auto Start = std::chrono::high_resolution_clock::now();
+			MeshSimplifier::GenerateLODs(Vertices, Indices, LODs, LODIndices);
+			auto End = std::chrono::high_resolution_clock::now();
+
+			Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+		}
+		WriteRow(Out, "MeshSimplifyLODs", Desc.Name, TriangleCount, (UINT)LODs.size(), Best);
+
+		// triangles and error of every level, the error in ten thousandths of the mesh's size
+		std::vector<UINT> AllIndices = Indices;
+		AllIndices.insert(AllIndices.end(), LODIndices.begin(), LODIndices.end());
+		const float Extent = Desc.Type == TestMesh::Sphere ? 2.f : 1.f;
+		for (UINT l = 0u; l < (UINT)LODs.size(); l++)
+		{
+			const std::string Variant = std::string(Desc.Name) + "/LOD" + std::to_string(l);
+			WriteRow(Out, "MeshSimplifyTriangles", Variant.c_str(), TriangleCount, LODs[l].IndexCount / 3u, 0.0);
+			WriteRow(Out, "MeshSimplifyError", Variant.c_str(), TriangleCount, (UINT)(LODs[l].Error / Extent * 10000.f + 0.5f), 0.0);
+		}
+
+		// the same input always gives the same levels
+		std::vector<MeshLOD> LODsAgain;
+		std::vector<UINT> LODIndicesAgain;
+		MeshSimplifier::GenerateLODs(Vertices, Indices, LODsAgain, LODIndicesAgain);
+		UINT Errors = LODs.size() == LODsAgain.size() && LODIndices == LODIndicesAgain ? 0u : 1u;
+		for (UINT l = 0u; l < (UINT)LODs.size() && l < (UINT)LODsAgain.size(); l++)
+		{
+			Errors += memcmp(&LODs[l], &LODsAgain[l], sizeof(MeshLOD)) == 0 ? 0u : 1u;
+		}
+		WriteRow(Out, "MeshSimplifyValidate", (std::string(Desc.Name) + "/Deterministic").c_str(), TriangleCount, Errors, 0.0);
+
+		// levels follow each other in the index array, shrink, get worse, stay within the error bound and never fold a triangle over
+		Errors = LODs.size() > 1u ? 0u : 1u;
+		for (UINT l = 0u; l < (UINT)LODs.size(); l++)
+		{
+			const MeshLOD& LOD = LODs[l];
+			const UINT ExpectedOffset = l == 0u ? 0u : LODs[l - 1u].IndexOffset + LODs[l - 1u].IndexCount;
+			Errors += LOD.IndexOffset == ExpectedOffset && LOD.IndexCount % 3u == 0u && LOD.IndexOffset + LOD.IndexCount <= (UINT)AllIndices.size() ? 0u : 1u;
+			Errors += l == 0u || ((float)LOD.IndexCount <= (float)LODs[l - 1u].IndexCount * LOD_MIN_REDUCTION && LOD.Error >= LODs[l - 1u].Error) ? 0u : 1u;
+			Errors += LOD.Error <= Extent * LOD_MAX_RELATIVE_ERROR ? 0u : 1u;
+			for (UINT t = LOD.IndexOffset; t + 2u < LOD.IndexOffset + LOD.IndexCount && t + 2u < (UINT)AllIndices.size(); t += 3u)
+			{
+				const UINT* Triangle = &AllIndices[t];
+				if (Triangle[0] >= Vertices.size() || Triangle[1] >= Vertices.size() || Triangle[2] >= Vertices.size())
+				{
+					Errors++;
+					continue;
+				}
+
+				const DirectX::XMVECTOR p0 = DirectX::XMLoadFloat3(&Vertices[Triangle[0]].Pos);
+				const DirectX::XMVECTOR p1 = DirectX::XMLoadFloat3(&Vertices[Triangle[1]].Pos);
+				const DirectX::XMVECTOR p2 = DirectX::XMLoadFloat3(&Vertices[Triangle[2]].Pos);
+				const DirectX::XMVECTOR Normal = DirectX::XMVector3Cross(DirectX::XMVectorSubtract(p1, p0), DirectX::XMVectorSubtract(p2, p0));
+				const bool bFlat = Desc.Type == TestMesh::Grid || Desc.Type == TestMesh::SeamGrid;
+				Errors += DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(Normal)) > 0.f && (!bFlat || DirectX::XMVectorGetY(Normal) > 0.f) ? 0u : 1u;
+			}
+		}
+		WriteRow(Out, "MeshSimplifyValidate", (std::string(Desc.Name) + "/Levels").c_str(), TriangleCount, Errors, 0.0);
+
+		std::vector<std::pair<UINT, UINT>> BorderEdges;
+		std::vector<std::pair<UINT, UINT>> OpenEdges;
+		if (Desc.Type != TestMesh::Sphere)
+		{
+			// every border edge stays on one side of the square, and the sides are still covered end to end
+			Errors = 0u;
+			for (const MeshLOD& LOD : LODs)
+			{
+				GetOpenEdges(Vertices, AllIndices.data() + LOD.IndexOffset, LOD.IndexCount, true, BorderEdges);
+				float Length = 0.f;
+				for (const std::pair<UINT, UINT>& Edge : BorderEdges)
+				{
+					const DirectX::XMFLOAT3& a = Vertices[Edge.first].Pos;
+					const DirectX::XMFLOAT3& b = Vertices[Edge.second].Pos;
+					const bool bOnSide = (a.x == 0.f && b.x == 0.f) || (a.x == 1.f && b.x == 1.f) || (a.z == 0.f && b.z == 0.f) || (a.z == 1.f && b.z == 1.f);
+					Errors += bOnSide ? 0u : 1u;
+					Length += sqrtf((a.x - b.x) * (a.x - b.x) + (a.z - b.z) * (a.z - b.z));
+				}
+				Errors += fabsf(Length - 4.f) < 1e-4f ? 0u : 1u;
+			}
+			WriteRow(Out, "MeshSimplifyValidate", (std::string(Desc.Name) + "/Border").c_str(), TriangleCount, Errors, 0.0);
+		}
+
+		if (Desc.Type == TestMesh::Sphere || Desc.Type == TestMesh::SeamGrid)
+		{
+			// edges open only because of their UVs stay on the seam, the seam stays whole, and no triangle picks up a vertex from the
+			// other side of it
+			const bool bSphere = Desc.Type == TestMesh::Sphere;
+			auto OnSeam = [&](const DirectX::XMFLOAT3& p) { return bSphere ? p.z == 0.f && p.x >= 0.f : p.x == 0.5f; };
+			// every sphere pole vertex has its own u, so the pole's edges are all open too and it never moves
+			auto OnPole = [&](const DirectX::XMFLOAT3& p) { return bSphere && fabsf(p.y) == 1.f; };
+			Errors = 0u;
+			for (const MeshLOD& LOD : LODs)
+			{
+				const UINT* LODTriangles = AllIndices.data() + LOD.IndexOffset;
+				GetOpenEdges(Vertices, LODTriangles, LOD.IndexCount, true, BorderEdges);
+				GetOpenEdges(Vertices, LODTriangles, LOD.IndexCount, false, OpenEdges);
+				Errors += BorderEdges.size() == (bSphere ? 0u : BorderEdges.size()) ? 0u : 1u;
+
+				float Length = 0.f;
+				for (const std::pair<UINT, UINT>& Edge : OpenEdges)
+				{
+					const DirectX::XMFLOAT3& a = Vertices[Edge.first].Pos;
+					const DirectX::XMFLOAT3& b = Vertices[Edge.second].Pos;
+					if (std::find(BorderEdges.begin(), BorderEdges.end(), Edge) != BorderEdges.end() || OnPole(a) || OnPole(b))
+						continue;
+
+					Errors += OnSeam(a) && OnSeam(b) ? 0u : 1u;
+					Length += sqrtf((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y) + (a.z - b.z) * (a.z - b.z));
+				}
+				// both sides of the seam, a straight one keeps its length exactly. The sphere's runs between the rings next to the poles,
+				// somewhere between the straight line and the meridian
+				Errors += bSphere ? (Length > 3.9f && Length <= 2.f * DirectX::XM_PI + 1e-3f ? 0u : 1u) : (fabsf(Length - 2.f) < 1e-4f ? 0u : 1u);
+
+				for (UINT t = 0u; t < LOD.IndexCount; t += 3u)
+				{
+					const DirectX::XMFLOAT3& p0 = Vertices[LODTriangles[t]].Pos;
+					const DirectX::XMFLOAT3& p1 = Vertices[LODTriangles[t + 1u]].Pos;
+					const DirectX::XMFLOAT3& p2 = Vertices[LODTriangles[t + 2u]].Pos;
+					const float Centroid = bSphere ? p0.z + p1.z + p2.z : (p0.x + p1.x + p2.x) / 3.f - 0.5f;
+					for (UINT k = 0u; k < 3u; k++)
+					{
+						const Vertex& Corner = Vertices[LODTriangles[t + k]];
+						if (!OnSeam(Corner.Pos) || OnPole(Corner.Pos))
+							continue;
+
+						// on the sphere u = 0 is the copy for positive z, on the grid u = 1 is the left half's copy
+						const bool bFirstSide = bSphere ? Corner.TexCoord.x == 0.f : Corner.TexCoord.x == 1.f;
+						Errors += (bSphere ? bFirstSide == (Centroid > 0.f) : bFirstSide == (Centroid < 0.f)) ? 0u : 1u;
+					}
+				}
+			}
+			WriteRow(Out, "MeshSimplifyValidate", (std::string(Desc.Name) + "/Seam").c_str(), TriangleCount, Errors, 0.0);
+		}
+	}
+
+	// selection for a model of unit size with three levels, instances on a line going away from the camera
+	const float Errors[] = { 0.f, 0.002f, 0.01f, 0.04f };
+	AABB BBox;
+	BBox.Min = DirectX::XMFLOAT3(-0.5f, -0.5f, -0.5f);
+	BBox.Max = DirectX::XMFLOAT3(0.5f, 0.5f, 0.5f);
+	const float PixelScale = ScreenSizeCuller::ComputePixelScale(DirectX::XMMatrixPerspectiveFovLH(DirectX::XMConvertToRadians(60.f), 16.f / 9.f, 0.1f, 2000.f), 1080.f);
+
+	const UINT InstanceCount = 100000u;
+	std::vector<DirectX::XMMATRIX> Transforms(InstanceCount);
+	std::vector<UINT> Visible(InstanceCount);
+	for (UINT i = 0u; i < InstanceCount; i++)
+	{
+		Transforms[i] = DirectX::XMMatrixTranspose(DirectX::XMMatrixTranslation(0.f, 0.f, 2.f + (float)i * 0.02f));
+		Visible[i] = i;
+	}
+
+	LODSelector Selector;
+	Selector.SetLevels(Errors, 4u);
+	Selector.SetView(DirectX::XMFLOAT3(0.f, 0.f, 0.f), PixelScale, 1.f, 0.2f);
+	std::vector<UINT> Grouped;
+	double Best = DBL_MAX;
+	for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+	{
+		Selector.Reset();
+		auto Start = std::chrono::high_resolution_clock::now();
+		Selector.Select(Transforms.data(), InstanceCount, BBox, Visible, Grouped);
+		auto End = std::chrono::high_resolution_clock::now();
+
+		Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+	}
+	for (UINT l = 0u; l < 4u; l++)
+	{
+		WriteRow(Out, "LODSelect", ("Level" + std::to_string(l)).c_str(), InstanceCount, Selector.GetLevelInstanceCount(l), l == 0u ? Best : 0.0);
+	}
+
+	// grouped by level, every instance once, in order inside a level, and further instances never get a finer level
+	UINT SelectErrors = (UINT)Grouped.size() == InstanceCount ? 0u : 1u;
+	for (UINT l = 0u; l < 4u; l++)
+	{
+		const UINT First = Selector.GetLevelFirstInstance(l);
+		for (UINT i = First; i < First + Selector.GetLevelInstanceCount(l) && i < (UINT)Grouped.size(); i++)
+		{
+			SelectErrors += Selector.GetInstanceLevel(Grouped[i]) == l ? 0u : 1u;
+			SelectErrors += i == First || Grouped[i] > Grouped[i - 1u] ? 0u : 1u;
+		}
+	}
+	for (UINT i = 1u; i < InstanceCount; i++)
+	{
+		SelectErrors += Selector.GetInstanceLevel(i) >= Selector.GetInstanceLevel(i - 1u) ? 0u : 1u;
+	}
+	WriteRow(Out, "LODSelectValidate", "Grouping", InstanceCount, SelectErrors, 0.0);
+
+	// one instance bobbing 5% either side of every switch distance: with hysteresis it settles on a level and stays, without it
+	// changes level every frame. The hysteresis row is the validation, the other shows what it prevents
+	const UINT FrameCount = 256u;
+	for (float Hysteresis : { 0.f, 0.2f })
+	{
+		UINT Changes = 0u;
+		for (UINT l = 1u; l < 4u; l++)
+		{
+			const float SwitchDistance = Errors[l] * PixelScale / 1.f + 0.866f;
+			Selector.Reset();
+			Selector.SetView(DirectX::XMFLOAT3(0.f, 0.f, 0.f), PixelScale, 1.f, Hysteresis);
+			UINT Previous = MAX_MESH_LODS;
+			for (UINT f = 0u; f < FrameCount; f++)
+			{
+				const DirectX::XMMATRIX Transform = DirectX::XMMatrixTranspose(DirectX::XMMatrixTranslation(0.f, 0.f, SwitchDistance * (f % 2u == 0u ? 0.95f : 1.05f)));
+				Selector.Select(&Transform, 1u, BBox, { 0u }, Grouped);
+				Changes += Previous != MAX_MESH_LODS && Selector.GetInstanceLevel(0u) != Previous ? 1u : 0u;
+				Previous = Selector.GetInstanceLevel(0u);
+			}
+		}
+		WriteRow(Out, Hysteresis > 0.f ? "LODSelectValidate" : "LODSelectFlicker", Hysteresis > 0.f ? "Hysteresis" : "NoHysteresis", FrameCount * 3u, Changes, 0.0);
+	}
+
+	// walking away then back, the level only ever goes coarser then only ever finer
+	SelectErrors = 0u;
+	Selector.Reset();
+	Selector.SetView(DirectX::XMFLOAT3(0.f, 0.f, 0.f), PixelScale, 1.f, 0.2f);
+	UINT Previous = 0u;
+	for (UINT f = 0u; f < FrameCount * 2u; f++)
+	{
+		const float Distance = 2.f + (float)(f < FrameCount ? f : FrameCount * 2u - 1u - f) * 0.5f;
+		const DirectX::XMMATRIX Transform = DirectX::XMMatrixTranspose(DirectX::XMMatrixTranslation(0.f, 0.f, Distance));
+		Selector.Select(&Transform, 1u, BBox, { 0u }, Grouped);
+		const UINT Level = Selector.GetInstanceLevel(0u);
+		SelectErrors += (f < FrameCount ? Level >= Previous : Level <= Previous) ? 0u : 1u;
+		Previous = Level;
+	}
+	SelectErrors += Previous == 0u ? 0u : 1u;
+	WriteRow(Out, "LODSelectValidate", "Monotonic", FrameCount * 2u, SelectErrors, 0.0);
+}
+
+void Benchmarks::RunParallelImportBenchmark(std::ofstream& Out)
+{
+	// the pool can't run more than its workers plus the caller, the rows say how many threads a count really got
+	const UINT ThreadCounts[] = { 1u, 4u, 16u };
+	const UINT PoolThreads = ThreadPool::GetSingletonPtr()->GetWorkerCount() + 1u;
+	auto Name = [&](const std::string& Prefix, UINT Threads)
+		{
+			return Prefix + " " + std::to_string(Threads) + " Threads (" + std::to_string(Threads < PoolThreads ? Threads : PoolThreads) + " Running)";
+		};
+
+	// reserving every mesh and filling them from several threads has to write exactly what adding them one by one writes
+	const UINT MeshCounts[] = { 16u, 256u };
+	for (UINT MeshCount : MeshCounts)
+	{
+		MeshCache Serial;
+		BuildTestMeshCache(MeshCount, 64u, Serial);
+		const UINT Triangles = Serial.GetIndexCount() / 3u;
+
+		for (UINT Threads : ThreadCounts)
+		{
+			MeshCache Parallel;
+			BuildTestMeshCache(MeshCount, 64u, Parallel, Threads);
+			WriteRow(Out, "ParallelImportValidate", Name("Fill " + std::to_string(MeshCount), Threads).c_str(), Triangles, CompareMeshCaches(Serial, Parallel), 0.0);
+		}
+	}
+
+	// the real import end to end, skipped when the assets are not next to the executable
+	const char* ModelPaths[] = {
+		"Models/fantasy_sword_stylized/scene.gltf",
+		"Models/sponza-atrium-3/Sponza.gltf" };
+
+	for (const char* ModelPath : ModelPaths)
+	{
+		MeshCache Reference;
+		if (!ModelData::ImportToCache(ModelPath, Reference, 1u))
+			continue;
+
+		const UINT Triangles = Reference.GetIndexCount() / 3u;
+		double SerialTime = 0.0;
+		for (UINT Threads : ThreadCounts)
+		{
+			MeshCache Imported;
+			double Best = DBL_MAX;
+			for (int i = 0; i < BENCHMARK_ITERATIONS / 8; i++)
+			{
+				MeshCache Import;
+				auto Start = std::chrono::high_resolution_clock::now();
+				ModelData::ImportToCache(ModelPath, Import, Threads);
+				auto End = std::chrono::high_resolution_clock::now();
+
+				Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+			}
+			SerialTime = Threads == 1u ? Best : SerialTime;
+
+			const std::string Row = Name(ModelPath, Threads);
+			WriteRow(Out, "ParallelImport", Row.c_str(), Triangles, Reference.GetMeshCount(), Best);
+			WriteRow(Out, "ParallelImportSpeedupx100", Row.c_str(), Triangles, (UINT)(SerialTime / Best * 100.0), 0.0);
+
+			const bool bImported = ModelData::ImportToCache(ModelPath, Imported, Threads);
+			WriteRow(Out, "ParallelImportValidate", Row.c_str(), Triangles, bImported ? CompareMeshCaches(Reference, Imported) : 1u, 0.0);
+		}
+
+		// decoding is what the texture fan out spreads over the threads, creating the textures needs a device the benchmark doesn't have
+		const std::string Directory = std::string(ModelPath).substr(0, std::string(ModelPath).find_last_of('/') + 1);
+		std::set<std::string> Unique;
+		std::vector<std::string> TexturePaths;
+		for (UINT m = 0u; m < Reference.GetMaterialCount(); m++)
+		{
+			for (UINT Texture : { Reference.GetMaterial(m).DiffuseTexture, Reference.GetMaterial(m).SpecularTexture })
+			{
+				if (Texture != 0u && Unique.insert(Directory + Reference.GetString(Texture)).second)
+				{
+					TexturePaths.push_back(Directory + Reference.GetString(Texture));
+				}
+			}
+		}
+		if (TexturePaths.empty())
+			continue;
+
+		SerialTime = 0.0;
+		for (UINT Threads : ThreadCounts)
+		{
+			std::atomic<UINT> Decoded = 0u;
+			double Best = DBL_MAX;
+			for (int i = 0; i < BENCHMARK_ITERATIONS / 16 + 1; i++)
+			{
+				Decoded = 0u;
+				auto Start = std::chrono::high_resolution_clock::now();
+				ThreadPool::GetSingletonPtr()->ParallelFor((UINT)TexturePaths.size(), 1u, [&](UINT Begin, UINT End)
+					{
+						for (UINT t = Begin; t < End; t++)
+						{
+							int Width, Height, Channels;
+							unsigned char* Data = stbi_load(TexturePaths[t].c_str(), &Width, &Height, &Channels, 0);
+							if (Data)
+							{
+								Decoded++;
+								stbi_image_free(Data);
+							}
+						}
+					}, Threads);
+				auto End = std::chrono::high_resolution_clock::now();
+
+				Best = std::min(Best, std::chrono::duration<double, std::milli>(End - Start).count());
+			}
+			SerialTime = Threads == 1u ? Best : SerialTime;
+
+			const std::string Row = Name(ModelPath, Threads);
+			WriteRow(Out, "ParallelImportTextures", Row.c_str(), (UINT)TexturePaths.size(), Decoded, Best);
+			WriteRow(Out, "ParallelImportTextureSpeedupx100", Row.c_str(), (UINT)TexturePaths.size(), (UINT)(SerialTime / Best * 100.0), 0.0);
+		}
+	}
+}
+
+void Benchmarks::WriteHeader(std::ofstream& Out)
+{
+	Out << "benchmark,variant,instances,result,ms,instances_per_ms\n";
+}
+
+void Benchmarks::WriteRow(std::ofstream& Out, const char* Benchmark, const char* Variant, unsigned int Instances, unsigned int Result, double Milliseconds)
+{
+	double PerMs = Milliseconds > 0.0 ? (double)Instances / Milliseconds : 0.0;
+	Out << Benchmark << "," << Variant << "," << Instances << "," << Result << "," << Milliseconds << "," << PerMs << "\n";
+	Out.flush();
+
+	const size_t NameLength = strlen(Benchmark);
+	const size_t SuffixLength = strlen("Validate");
+	if (Result != 0u && NameLength >= SuffixLength && strcmp(Benchmark + NameLength - SuffixLength, "Validate") == 0)
+	{
+		ms_ValidationFailures++;
+		std::cerr << "FAILED " << Benchmark << "," << Variant << ": " << Result << " errors\n";
+	}
+}
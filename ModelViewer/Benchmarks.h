@@ -0,0 +1,55 @@
+#pragma once
+
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include <string>
+#include <fstream>
+
+/*
+*	Headless benchmarks, run with the -benchmark command line argument. Nothing in here touches the device or the window,
+*	results are written as CSV (benchmark,variant,instances,result,ms,instances_per_ms) so runs can be compared between builds.
+*	Rows whose benchmark ends in Validate count errors in result, Run returns false if any of them is nonzero.
+*/
+
+class Benchmarks
+{
+public:
+	static bool Run(const std::string& OutputPath);
+
+private:
+	static void RunCullingBenchmark(std::ofstream& Out);
+	static void RunSceneBVHBenchmark(std::ofstream& Out);
+	static void RunOcclusionBenchmark(std::ofstream& Out);
+	static void RunThreadPoolBenchmark(std::ofstream& Out);
+	static void RunCullingBatchBenchmark(std::ofstream& Out);
+	static void RunInstanceBufferBenchmark(std::ofstream& Out);
+	static void RunTemporalCullingBenchmark(std::ofstream& Out);
+	static void RunFrustumBenchmark(std::ofstream& Out);
+	static void RunMultiViewBenchmark(std::ofstream& Out);
+	static void RunScreenSizeBenchmark(std::ofstream& Out);
+	static void RunLandscapeQuadtreeBenchmark(std::ofstream& Out);
+	static void RunGrassTileBenchmark(std::ofstream& Out);
+	static void RunTransformStoreBenchmark(std::ofstream& Out);
+	static void RunInstanceGatherBenchmark(std::ofstream& Out);
+	static void RunComponentRegistryBenchmark(std::ofstream& Out);
+	static void RunObjectPoolBenchmark(std::ofstream& Out);
+	static void RunSceneFileBenchmark(std::ofstream& Out);
+	static void RunStressSceneBenchmark(std::ofstream& Out);
+	static void RunSpatialHashBenchmark(std::ofstream& Out);
+	static void RunMeshCacheBenchmark(std::ofstream& Out);
+	static void RunMeshOptimizerBenchmark(std::ofstream& Out);
+	static void RunVertexCompressionBenchmark(std::ofstream& Out);
+	static void RunClusterCullingBenchmark(std::ofstream& Out);
+	static void RunMeshSimplifierBenchmark(std::ofstream& Out);
+	static void RunParallelImportBenchmark(std::ofstream& Out);
+
+	static void WriteHeader(std::ofstream& Out);
+	static void WriteRow(std::ofstream& Out, const char* Benchmark, const char* Variant, unsigned int Instances, unsigned int Result, double Milliseconds);
+
+	// the number of Validate rows written with a nonzero result since Run started
+	static inline unsigned int ms_ValidationFailures = 0u;
+
+};
+
+#endif
@@ -8,6 +8,7 @@
 #include "Camera.h"
 #include "Application.h"
 #include "AABB.h"
+#include "Frustum.h"
 #include "ResourceManager.h"
 
 const UINT BoxIndices[12][2] = {
@@ -217,28 +218,7 @@ void BoxRenderer::LoadBoxCorners(const AABB& BBox, const DirectX::XMMATRIX& Tran
 void BoxRenderer::LoadFrustumCorners(const std::shared_ptr<Camera>& pCamera)
 {
 	std::array<DirectX::XMFLOAT4, 8> Corners;
-	DirectX::XMMATRIX ViewProj = DirectX::XMMatrixMultiply(pCamera->GetViewMatrix(), pCamera->GetProjMatrix());
-	DirectX::XMMATRIX InvViewProj = DirectX::XMMatrixInverse(nullptr, ViewProj);
-
-	int i = 0;
-	for (int z = 0; z <= 1; ++z)
-	{
-		float ndcZ = z * 2.0f - 1.0f;
-		for (int y = 0; y <= 1; ++y)
-		{
-			float ndcY = y * 2.0f - 1.0f;
-			for (int x = 0; x <= 1; ++x)
-			{
-				float ndcX = x * 2.0f - 1.0f;
-
-				DirectX::XMVECTOR Corner = DirectX::XMVectorSet(ndcX, ndcY, ndcZ, 1.0f);
-				DirectX::XMVECTOR WorldCorner = DirectX::XMVector4Transform(Corner, InvViewProj);
-				WorldCorner = DirectX::XMVectorScale(WorldCorner, 1.0f / DirectX::XMVectorGetW(WorldCorner));
-
-				DirectX::XMStoreFloat4(&Corners[i++], WorldCorner);
-			}
-		}
-	}
+	Frustum(DirectX::XMMatrixMultiply(pCamera->GetViewMatrix(), pCamera->GetProjMatrix())).GetCorners(Corners.data());
 
 	m_Boxes.push_back(Corners);
 }
@@ -0,0 +1,261 @@
+#include <cmath>
+#include <intrin.h>
+#include <immintrin.h>
+
+#include "CPUFrustumCuller.h"
+
+CPUFrustumCuller::CPUFrustumCuller()
+{
+	m_SIMDPath = IsAVXSupported() ? SIMDPath::AVX : SIMDPath::SSE;
+}
+
+UINT CPUFrustumCuller::Cull(const std::vector<DirectX::XMMATRIX>& Transforms, const AABB& BBox, const DirectX::XMMATRIX& ViewProj, std::vector<DirectX::XMMATRIX>& OutVisible)
+{
+	OutVisible.clear();
+	if (Transforms.empty())
+	{
+		m_VisibleIndices.clear();
+		return 0u;
+	}
+
+	const UINT VisibleCount = Cull(Transforms.data(), (UINT)Transforms.size(), BBox, ViewProj);
+
+	OutVisible.resize(VisibleCount);
+	for (UINT i = 0u; i < VisibleCount; i++)
+	{
+		OutVisible[i] = Transforms[m_VisibleIndices[i]];
+	}
+
+	return VisibleCount;
+}
+
+UINT CPUFrustumCuller::Cull(const DirectX::XMMATRIX* Transforms, UINT Count, const AABB& BBox, const DirectX::XMMATRIX& ViewProj)
+{
+	m_VisibleIndices.clear();
+	if (Count == 0u)
+		return 0u;
+
+	m_Frustum.Extract(ViewProj);
+	BuildWorldBounds(Transforms, Count, BBox);
+
+	switch (m_SIMDPath)
+	{
+	case SIMDPath::AVX:
+		TestPlanesAVX(Count);
+		break;
+	case SIMDPath::SSE:
+		TestPlanesSSE(Count);
+		break;
+	default:
+		TestPlanesScalar(Count);
+		break;
+	}
+
+	return (UINT)m_VisibleIndices.size();
+}
+
+void CPUFrustumCuller::SetSIMDPath(SIMDPath Path)
+{
+	if (Path == SIMDPath::AVX && !IsAVXSupported())
+	{
+		Path = SIMDPath::SSE;
+	}
+	m_SIMDPath = Path;
+}
+
+bool CPUFrustumCuller::IsAVXSupported()
+{
+	static int s_Supported = -1;
+	if (s_Supported >= 0)
+		return s_Supported == 1;
+
+	int Info[4];
+	__cpuid(Info, 1);
+	bool bOSXSave = (Info[2] & (1 << 27)) != 0;
+	bool bAVX = (Info[2] & (1 << 28)) != 0;
+
+	// the OS also has to save the upper halves of the ymm registers on context switches
+	s_Supported = (bOSXSave && bAVX && (_xgetbv(0) & 0x6) == 0x6) ? 1 : 0;
+	return s_Supported == 1;
+}
+
+void CPUFrustumCuller::BuildWorldBounds(const DirectX::XMMATRIX* Transforms, UINT Count, const AABB& BBox)
+{
+	const UINT PaddedCount = (Count + 7u) & ~7u;
+
+	m_CenterX.resize(PaddedCount);
+	m_CenterY.resize(PaddedCount);
+	m_CenterZ.resize(PaddedCount);
+	m_ExtentX.resize(PaddedCount);
+	m_ExtentY.resize(PaddedCount);
+	m_ExtentZ.resize(PaddedCount);
+
+	const float cx = (BBox.Min.x + BBox.Max.x) * 0.5f;
+	const float cy = (BBox.Min.y + BBox.Max.y) * 0.5f;
+	const float cz = (BBox.Min.z + BBox.Max.z) * 0.5f;
+	const float ex = (BBox.Max.x - BBox.Min.x) * 0.5f;
+	const float ey = (BBox.Max.y - BBox.Min.y) * 0.5f;
+	const float ez = (BBox.Max.z - BBox.Min.z) * 0.5f;
+
+	UINT i = 0u;
+	if (m_SIMDPath != SIMDPath::Scalar)
+	{
+		const __m128 CX = _mm_set1_ps(cx), CY = _mm_set1_ps(cy), CZ = _mm_set1_ps(cz);
+		const __m128 EX = _mm_set1_ps(ex), EY = _mm_set1_ps(ey), EZ = _mm_set1_ps(ez);
+		const __m128 SignMask = _mm_set1_ps(-0.f);
+		float* Centers[3] = { m_CenterX.data(), m_CenterY.data(), m_CenterZ.data() };
+		float* Extents[3] = { m_ExtentX.data(), m_ExtentY.data(), m_ExtentZ.data() };
+
+		for (; i + 4u <= Count; i += 4u)
+		{
+			// transforms are stored transposed, so row n holds the coefficients for world axis n.
+			// transposing the same row of 4 instances gives one register per coefficient
+			for (int Axis = 0; Axis < 3; Axis++)
+			{
+				__m128 a = Transforms[i + 0u].r[Axis];
+				__m128 b = Transforms[i + 1u].r[Axis];
+				__m128 c = Transforms[i + 2u].r[Axis];
+				__m128 d = Transforms[i + 3u].r[Axis];
+				_MM_TRANSPOSE4_PS(a, b, c, d);
+
+				__m128 Center = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, CX), _mm_mul_ps(b, CY)), _mm_add_ps(_mm_mul_ps(c, CZ), d));
+				__m128 Extent = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(SignMask, a), EX), _mm_mul_ps(_mm_andnot_ps(SignMask, b), EY)),
+					_mm_mul_ps(_mm_andnot_ps(SignMask, c), EZ));
+
+				_mm_storeu_ps(Centers[Axis] + i, Center);
+				_mm_storeu_ps(Extents[Axis] + i, Extent);
+			}
+		}
+	}
+
+	for (; i < Count; i++)
+	{
+		DirectX::XMFLOAT4X4 m;
+		DirectX::XMStoreFloat4x4(&m, Transforms[i]);
+
+		m_CenterX[i] = m.m[0][0] * cx + m.m[0][1] * cy + m.m[0][2] * cz + m.m[0][3];
+		m_CenterY[i] = m.m[1][0] * cx + m.m[1][1] * cy + m.m[1][2] * cz + m.m[1][3];
+		m_CenterZ[i] = m.m[2][0] * cx + m.m[2][1] * cy + m.m[2][2] * cz + m.m[2][3];
+		m_ExtentX[i] = fabsf(m.m[0][0]) * ex + fabsf(m.m[0][1]) * ey + fabsf(m.m[0][2]) * ez;
+		m_ExtentY[i] = fabsf(m.m[1][0]) * ex + fabsf(m.m[1][1]) * ey + fabsf(m.m[1][2]) * ez;
+		m_ExtentZ[i] = fabsf(m.m[2][0]) * ex + fabsf(m.m[2][1]) * ey + fabsf(m.m[2][2]) * ez;
+	}
+
+	for (; i < PaddedCount; i++)
+	{
+		m_CenterX[i] = m_CenterY[i] = m_CenterZ[i] = 0.f;
+		m_ExtentX[i] = m_ExtentY[i] = m_ExtentZ[i] = 0.f;
+	}
+}
+
+void CPUFrustumCuller::TestPlanesScalar(UINT Count)
+{
+	for (UINT i = 0u; i < Count; i++)
+	{
+		bool bVisible = true;
+		for (int p = 0; p < 6 && bVisible; p++)
+		{
+			const DirectX::XMFLOAT4& Plane = m_Frustum.GetPlane(p);
+			float Dist = Plane.x * m_CenterX[i] + Plane.y * m_CenterY[i] + Plane.z * m_CenterZ[i] + Plane.w;
+			float Radius = fabsf(Plane.x) * m_ExtentX[i] + fabsf(Plane.y) * m_ExtentY[i] + fabsf(Plane.z) * m_ExtentZ[i];
+			bVisible = Dist + Radius >= 0.f;
+		}
+
+		if (bVisible)
+		{
+			m_VisibleIndices.push_back(i);
+		}
+	}
+}
+
+void CPUFrustumCuller::TestPlanesSSE(UINT Count)
+{
+	const DirectX::XMFLOAT4* Planes = m_Frustum.GetPlanes();
+	const __m128 Zero = _mm_setzero_ps();
+	const __m128 SignMask = _mm_set1_ps(-0.f);
+	__m128 PX[6], PY[6], PZ[6], PW[6], AX[6], AY[6], AZ[6];
+	for (int p = 0; p < 6; p++)
+	{
+		PX[p] = _mm_set1_ps(Planes[p].x);
+		PY[p] = _mm_set1_ps(Planes[p].y);
+		PZ[p] = _mm_set1_ps(Planes[p].z);
+		PW[p] = _mm_set1_ps(Planes[p].w);
+		AX[p] = _mm_andnot_ps(SignMask, PX[p]);
+		AY[p] = _mm_andnot_ps(SignMask, PY[p]);
+		AZ[p] = _mm_andnot_ps(SignMask, PZ[p]);
+	}
+
+	for (UINT i = 0u; i < Count; i += 4u)
+	{
+		const __m128 cx = _mm_loadu_ps(&m_CenterX[i]);
+		const __m128 cy = _mm_loadu_ps(&m_CenterY[i]);
+		const __m128 cz = _mm_loadu_ps(&m_CenterZ[i]);
+		const __m128 ex = _mm_loadu_ps(&m_ExtentX[i]);
+		const __m128 ey = _mm_loadu_ps(&m_ExtentY[i]);
+		const __m128 ez = _mm_loadu_ps(&m_ExtentZ[i]);
+
+		__m128 Visible = _mm_cmpeq_ps(Zero, Zero);
+		for (int p = 0; p < 6; p++)
+		{
+			__m128 Dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(PX[p], cx), _mm_mul_ps(PY[p], cy)), _mm_add_ps(_mm_mul_ps(PZ[p], cz), PW[p]));
+			__m128 Radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(AX[p], ex), _mm_mul_ps(AY[p], ey)), _mm_mul_ps(AZ[p], ez));
+			Visible = _mm_and_ps(Visible, _mm_cmpge_ps(_mm_add_ps(Dist, Radius), Zero));
+		}
+
+		int Mask = _mm_movemask_ps(Visible);
+		for (UINT Lane = 0u; Mask != 0 && Lane < 4u; Lane++, Mask >>= 1)
+		{
+			if ((Mask & 1) && i + Lane < Count)
+			{
+				m_VisibleIndices.push_back(i + Lane);
+			}
+		}
+	}
+}
+
+void CPUFrustumCuller::TestPlanesAVX(UINT Count)
+{
+	const DirectX::XMFLOAT4* Planes = m_Frustum.GetPlanes();
+	const __m256 Zero = _mm256_setzero_ps();
+	const __m256 SignMask = _mm256_set1_ps(-0.f);
+	__m256 PX[6], PY[6], PZ[6], PW[6], AX[6], AY[6], AZ[6];
+	for (int p = 0; p < 6; p++)
+	{
+		PX[p] = _mm256_set1_ps(Planes[p].x);
+		PY[p] = _mm256_set1_ps(Planes[p].y);
+		PZ[p] = _mm256_set1_ps(Planes[p].z);
+		PW[p] = _mm256_set1_ps(Planes[p].w);
+		AX[p] = _mm256_andnot_ps(SignMask, PX[p]);
+		AY[p] = _mm256_andnot_ps(SignMask, PY[p]);
+		AZ[p] = _mm256_andnot_ps(SignMask, PZ[p]);
+	}
+
+	for (UINT i = 0u; i < Count; i += 8u)
+	{
+		const __m256 cx = _mm256_loadu_ps(&m_CenterX[i]);
+		const __m256 cy = _mm256_loadu_ps(&m_CenterY[i]);
+		const __m256 cz = _mm256_loadu_ps(&m_CenterZ[i]);
+		const __m256 ex = _mm256_loadu_ps(&m_ExtentX[i]);
+		const __m256 ey = _mm256_loadu_ps(&m_ExtentY[i]);
+		const __m256 ez = _mm256_loadu_ps(&m_ExtentZ[i]);
+
+		__m256 Visible = _mm256_cmp_ps(Zero, Zero, _CMP_EQ_OQ);
+		for (int p = 0; p < 6; p++)
+		{
+			__m256 Dist = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(PX[p], cx), _mm256_mul_ps(PY[p], cy)), _mm256_add_ps(_mm256_mul_ps(PZ[p], cz), PW[p]));
+			__m256 Radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(AX[p], ex), _mm256_mul_ps(AY[p], ey)), _mm256_mul_ps(AZ[p], ez));
+			Visible = _mm256_and_ps(Visible, _mm256_cmp_ps(_mm256_add_ps(Dist, Radius), Zero, _CMP_GE_OQ));
+		}
+
+		int Mask = _mm256_movemask_ps(Visible);
+		for (UINT Lane = 0u; Mask != 0 && Lane < 8u; Lane++, Mask >>= 1)
+		{
+			if ((Mask & 1) && i + Lane < Count)
+			{
+				m_VisibleIndices.push_back(i + Lane);
+			}
+		}
+	}
+
+	_mm256_zeroupper();
+}
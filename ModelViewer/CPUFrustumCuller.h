@@ -0,0 +1,72 @@
+#pragma once
+
+#ifndef CPU_FRUSTUM_CULLER_H
+#define CPU_FRUSTUM_CULLER_H
+
+#include <vector>
+
+#include "DirectXMath.h"
+
+#include "AABB.h"
+#include "Frustum.h"
+
+typedef unsigned int UINT;
+
+/*
+*	CPU alternative to the FrustumCullingCS dispatch. Has no knowledge of the device so it can be run and benchmarked headless.
+*	Instance bounds are first transformed into world space and stored as structure-of-arrays (centers and extents), then
+*	tested against the six frustum planes 4 (SSE) or 8 (AVX) instances at a time.
+*/
+
+class CPUFrustumCuller
+{
+public:
+	enum class SIMDPath
+	{
+		Scalar,
+		SSE,
+		AVX
+	};
+
+public:
+	CPUFrustumCuller();
+
+	// Transforms are expected in the same (transposed) layout as ModelData::m_Transforms. Visible transforms are compacted into OutVisible.
+	UINT Cull(const std::vector<DirectX::XMMATRIX>& Transforms, const AABB& BBox, const DirectX::XMMATRIX& ViewProj, std::vector<DirectX::XMMATRIX>& OutVisible);
+	// only fills the visible indices (relative to Transforms), for callers that keep the transforms somewhere else
+	UINT Cull(const DirectX::XMMATRIX* Transforms, UINT Count, const AABB& BBox, const DirectX::XMMATRIX& ViewProj);
+
+	void SetSIMDPath(SIMDPath Path);
+	SIMDPath GetSIMDPath() const { return m_SIMDPath; }
+	const std::vector<UINT>& GetVisibleIndices() const { return m_VisibleIndices; }
+	const Frustum& GetFrustum() const { return m_Frustum; }
+
+	// world space bounds of every instance, padded with empty boxes up to a multiple of 8. Also used by MultiViewCuller
+	void BuildWorldBounds(const DirectX::XMMATRIX* Transforms, UINT Count, const AABB& BBox);
+	const float* GetWorldCenters(UINT Axis) const { return Axis == 0u ? m_CenterX.data() : Axis == 1u ? m_CenterY.data() : m_CenterZ.data(); }
+	const float* GetWorldExtents(UINT Axis) const { return Axis == 0u ? m_ExtentX.data() : Axis == 1u ? m_ExtentY.data() : m_ExtentZ.data(); }
+
+	static bool IsAVXSupported();
+
+private:
+	void TestPlanesScalar(UINT Count);
+	void TestPlanesSSE(UINT Count);
+	void TestPlanesAVX(UINT Count);
+
+private:
+	// world space bounds in SoA layout, padded up to a multiple of 8
+	std::vector<float> m_CenterX;
+	std::vector<float> m_CenterY;
+	std::vector<float> m_CenterZ;
+	std::vector<float> m_ExtentX;
+	std::vector<float> m_ExtentY;
+	std::vector<float> m_ExtentZ;
+
+	std::vector<UINT> m_VisibleIndices;
+	Frustum m_Frustum;
+
+	SIMDPath m_SIMDPath;
+
+};
+
+#endif
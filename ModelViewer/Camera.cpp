@@ -18,8 +18,13 @@ void Camera::RenderControls()
 {
 	ImGui::Text("Transform");
 
-	ImGui::DragFloat3("Position", reinterpret_cast<float*>(&m_Transform.Position), 0.1f);
-	ImGui::DragFloat2("Rotation", reinterpret_cast<float*>(&m_Transform.Rotation), 0.1f);
+	DirectX::XMFLOAT3 Position = GetPosition();
+	DirectX::XMFLOAT3 Rotation = GetRotation();
+
+	if (ImGui::DragFloat3("Position", reinterpret_cast<float*>(&Position), 0.1f))
+		SetPosition(Position.x, Position.y, Position.z);
+	if (ImGui::DragFloat2("Rotation", reinterpret_cast<float*>(&Rotation), 0.1f))
+		SetRotation(Rotation.x, Rotation.y, Rotation.z);
 
 	ImGui::Dummy(ImVec2(0.f, 10.f));
 
@@ -32,7 +37,7 @@ void Camera::SetRotation(float x, float y, float z)
 	y = std::fmod(y, 360.f);
 	z = 0.f;
 
-	m_Transform.Rotation = { x, y, z };
+	TransformStore::GetSingletonPtr()->SetRotation(m_TransformID, { x, y, z });
 }
 
 void Camera::SetLookDir(float x, float y, float z)
@@ -56,18 +61,21 @@ void Camera::CalcViewMatrix()
 
 	UpVector = DirectX::XMLoadFloat3(&Up);
 
-	PositionVector = DirectX::XMLoadFloat3(&m_Transform.Position);
+	const DirectX::XMFLOAT3 Position = GetPosition();
+	const DirectX::XMFLOAT3 Rotation = GetRotation();
+
+	PositionVector = DirectX::XMLoadFloat3(&Position);
 
-	ReversePosition.x = -m_Transform.Position.x;
-	ReversePosition.y = -m_Transform.Position.y;
-	ReversePosition.z = -m_Transform.Position.z;
+	ReversePosition.x = -Position.x;
+	ReversePosition.y = -Position.y;
+	ReversePosition.z = -Position.z;
 
 	ReversePositionVector = DirectX::XMLoadFloat3(&ReversePosition);
 
 	LookAtVector = DirectX::XMVector3Normalize(DirectX::XMLoadFloat3(&m_LookDir));
 
-	Pitch = DirectX::XMConvertToRadians(m_Transform.Rotation.x);
-	Yaw = DirectX::XMConvertToRadians(m_Transform.Rotation.y);
+	Pitch = DirectX::XMConvertToRadians(Rotation.x);
+	Yaw = DirectX::XMConvertToRadians(Rotation.y);
 	Roll = DirectX::XMConvertToRadians(0.f);
 
 	RotationMatrix = DirectX::XMMatrixRotationRollPitchYaw(Pitch, Yaw, Roll);
@@ -83,7 +91,8 @@ void Camera::CalcViewMatrix()
 DirectX::XMFLOAT3 Camera::GetRotatedLookDir() const
 {
 	DirectX::XMVECTOR LookVector = DirectX::XMVector3Normalize(DirectX::XMLoadFloat3(&m_LookDir));
-	DirectX::XMMATRIX RotationMatrix = DirectX::XMMatrixRotationRollPitchYaw(DirectX::XMConvertToRadians(m_Transform.Rotation.x), DirectX::XMConvertToRadians(m_Transform.Rotation.y), 0.f);
+	const DirectX::XMFLOAT3 Rotation = GetRotation();
+	DirectX::XMMATRIX RotationMatrix = DirectX::XMMatrixRotationRollPitchYaw(DirectX::XMConvertToRadians(Rotation.x), DirectX::XMConvertToRadians(Rotation.y), 0.f);
 	
 	LookVector = DirectX::XMVector3TransformCoord(LookVector, RotationMatrix);
 	LookVector = DirectX::XMVector3Normalize(LookVector);
@@ -96,7 +105,8 @@ DirectX::XMFLOAT3 Camera::GetRotatedLookDir() const
 DirectX::XMFLOAT3 Camera::GetRotatedLookRight() const
 {
 	DirectX::XMVECTOR LookVector = DirectX::XMVector3Normalize(DirectX::XMLoadFloat3(&m_LookDir));
-	DirectX::XMMATRIX RotationMatrix = DirectX::XMMatrixRotationRollPitchYaw(DirectX::XMConvertToRadians(m_Transform.Rotation.x), DirectX::XMConvertToRadians(m_Transform.Rotation.y), 0.f);
+	const DirectX::XMFLOAT3 Rotation = GetRotation();
+	DirectX::XMMATRIX RotationMatrix = DirectX::XMMatrixRotationRollPitchYaw(DirectX::XMConvertToRadians(Rotation.x), DirectX::XMConvertToRadians(Rotation.y), 0.f);
 
 	LookVector = DirectX::XMVector3TransformCoord(LookVector, RotationMatrix);
 	LookVector = DirectX::XMVector3Normalize(LookVector);
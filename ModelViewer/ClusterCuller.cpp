@@ -0,0 +1,154 @@
+#include <cmath>
+#include <algorithm>
+
+#include "ClusterCuller.h"
+
+void ClusterCuller::SetView(const DirectX::XMMATRIX& ViewProj, const DirectX::XMFLOAT3& CameraPosition)
+{
+	m_Frustum.Extract(ViewProj);
+	m_CameraPosition = CameraPosition;
+}
+
+UINT ClusterCuller::Cull(const Meshlet* Meshlets, UINT Count, const DirectX::XMMATRIX& World, UINT FirstIndex, std::vector<ClusterDrawRange>& OutRanges)
+{
+	m_LastClustersOutsideFrustum = 0u;
+	m_LastClustersBackfacing = 0u;
+
+	const InstanceView View = PrepareInstance(World);
+	UINT TrianglesRejected = 0u;
+	const size_t FirstRange = OutRanges.size();
+	for (UINT i = 0u; i < Count; i++)
+	{
+		const Meshlet& m = Meshlets[i];
+		const ClusterResult Result = TestCluster(m, View);
+		if (Result != ClusterResult::Visible)
+		{
+			m_LastClustersOutsideFrustum += Result == ClusterResult::OutsideFrustum ? 1u : 0u;
+			m_LastClustersBackfacing += Result == ClusterResult::Backfacing ? 1u : 0u;
+			TrianglesRejected += m.TriangleCount;
+			continue;
+		}
+
+		const UINT StartIndex = FirstIndex + m.IndexOffset;
+		if (OutRanges.size() > FirstRange && OutRanges.back().StartIndex + OutRanges.back().IndexCount == StartIndex)
+		{
+			OutRanges.back().IndexCount += m.TriangleCount * 3u;
+		}
+		else
+		{
+			OutRanges.push_back({ StartIndex, m.TriangleCount * 3u });
+		}
+	}
+
+	return TrianglesRejected;
+}
+
+UINT ClusterCuller::CullInstances(const Meshlet* Meshlets, UINT Count, const DirectX::XMMATRIX& MeshTransform, const DirectX::XMMATRIX* Transforms, UINT InstanceCount,
+	UINT FirstInstance, UINT FirstIndex, std::vector<UINT>& OutInstances, std::vector<ClusterInstancedRange>& OutRanges)
+{
+	m_LastClustersOutsideFrustum = 0u;
+	m_LastClustersBackfacing = 0u;
+
+	// instance by instance, since the per instance setup is the expensive part
+	UINT TrianglesRejected = 0u;
+	m_PairClusters.clear();
+	m_PairInstances.clear();
+	m_ClusterStarts.assign(Count + 1u, 0u);
+	for (UINT Instance = 0u; Instance < InstanceCount; Instance++)
+	{
+		const InstanceView View = PrepareInstance(MeshTransform * DirectX::XMMatrixTranspose(Transforms[Instance]));
+		for (UINT i = 0u; i < Count; i++)
+		{
+			const ClusterResult Result = TestCluster(Meshlets[i], View);
+			if (Result != ClusterResult::Visible)
+			{
+				m_LastClustersOutsideFrustum += Result == ClusterResult::OutsideFrustum ? 1u : 0u;
+				m_LastClustersBackfacing += Result == ClusterResult::Backfacing ? 1u : 0u;
+				TrianglesRejected += Meshlets[i].TriangleCount;
+				continue;
+			}
+
+			m_PairClusters.push_back(i);
+			m_PairInstances.push_back(FirstInstance + Instance);
+			m_ClusterStarts[i + 1u]++;
+		}
+	}
+
+	// counting sort by cluster, the pairs come in instance order so every bucket stays sorted
+	for (UINT i = 0u; i < Count; i++)
+	{
+		m_ClusterStarts[i + 1u] += m_ClusterStarts[i];
+	}
+	m_ClusterInstances.resize(m_PairInstances.size());
+	for (size_t p = 0u; p < m_PairInstances.size(); p++)
+	{
+		m_ClusterInstances[m_ClusterStarts[m_PairClusters[p]]++] = m_PairInstances[p];
+	}
+	// the scatter moved every start up to the next one, so cluster i now ends at m_ClusterStarts[i]
+	const size_t FirstRange = OutRanges.size();
+	UINT Begin = 0u;
+	for (UINT i = 0u; i < Count; i++)
+	{
+		const UINT End = m_ClusterStarts[i];
+		const UINT Seen = End - Begin;
+		if (Seen == 0u)
+			continue;
+
+		const Meshlet& m = Meshlets[i];
+		const UINT StartIndex = FirstIndex + m.IndexOffset;
+		if (OutRanges.size() > FirstRange)
+		{
+			ClusterInstancedRange& Last = OutRanges.back();
+			if (Last.StartIndex + Last.IndexCount == StartIndex && Last.InstanceCount == Seen &&
+				std::equal(m_ClusterInstances.begin() + Begin, m_ClusterInstances.begin() + End, OutInstances.begin() + Last.FirstInstance))
+			{
+				Last.IndexCount += m.TriangleCount * 3u;
+				Begin = End;
+				continue;
+			}
+		}
+
+		OutRanges.push_back({ StartIndex, m.TriangleCount * 3u, (UINT)OutInstances.size(), Seen });
+		OutInstances.insert(OutInstances.end(), m_ClusterInstances.begin() + Begin, m_ClusterInstances.begin() + End);
+		Begin = End;
+	}
+
+	return TrianglesRejected;
+}
+
+ClusterCuller::InstanceView ClusterCuller::PrepareInstance(const DirectX::XMMATRIX& World) const
+{
+	using namespace DirectX;
+
+	InstanceView View;
+	View.World = World;
+
+	// a sphere stays a sphere under the largest axis scale, the rows are the transformed axes
+	const float MaxScaleSq = fmaxf(XMVectorGetX(XMVector3LengthSq(World.r[0])), fmaxf(XMVectorGetX(XMVector3LengthSq(World.r[1])), XMVectorGetX(XMVector3LengthSq(World.r[2]))));
+	View.RadiusScale = sqrtf(MaxScaleSq);
+
+	XMVECTOR Determinant;
+	const XMMATRIX WorldToLocal = XMMatrixInverse(&Determinant, World);
+	View.bConeCulling = m_bConeCulling && XMVectorGetX(Determinant) > 0.f;
+	View.LocalCamera = XMVector3Transform(XMLoadFloat3(&m_CameraPosition), WorldToLocal);
+	return View;
+}
+
+ClusterCuller::ClusterResult ClusterCuller::TestCluster(const Meshlet& m, const InstanceView& View) const
+{
+	using namespace DirectX;
+
+	if (View.bConeCulling && m.ConeCutoff <= 1.f)
+	{
+		const XMVECTOR ToApex = XMVector3Normalize(XMVectorSubtract(XMLoadFloat3(&m.ConeApex), View.LocalCamera));
+		if (XMVectorGetX(XMVector3Dot(ToApex, XMLoadFloat3(&m.ConeAxis))) >= m.ConeCutoff)
+			return ClusterResult::Backfacing;
+	}
+
+	XMFLOAT3 Center;
+	XMStoreFloat3(&Center, XMVector3Transform(XMLoadFloat3(&m.Center), View.World));
+	if (!m_Frustum.TestSphere(Center, m.Radius * View.RadiusScale))
+		return ClusterResult::OutsideFrustum;
+
+	return ClusterResult::Visible;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#ifndef CLUSTER_CULLER_H
+#define CLUSTER_CULLER_H
+
+#include <vector>
+
+#include "DirectXMath.h"
+
+#include "Frustum.h"
+#include "MeshletBuilder.h"
+
+typedef unsigned int UINT;
+
+// a DrawIndexed worth of visible triangles, StartIndex already includes the mesh's offset into the index buffer
+struct ClusterDrawRange
+{
+	UINT StartIndex;
+	UINT IndexCount;
+};
+
+// IndexCount indices from StartIndex drawn once for each of the InstanceCount instances listed from FirstInstance on in the instance
+// list CullInstances fills
+struct ClusterInstancedRange
+{
+	UINT StartIndex;
+	UINT IndexCount;
+	UINT FirstInstance;
+	UINT InstanceCount;
+};
+
+/*
+*	Per instance culling of a mesh's meshlets, for large models where the whole model AABB is almost always partly visible. Each
+*	cluster's sphere is tested against the frustum in world space, and its normal cone against the camera moved into the mesh's
+*	local space, where backfacing is the same test whatever the instance's scale or shear. Instances with a mirroring transform skip
+*	the cone test since the rasterizer sees their winding flipped. Surviving clusters that follow each other in the index buffer are
+*	merged into one range. CullInstances tests many instances of one mesh and groups the survivors by cluster instead, so every
+*	cluster range is one instanced draw however many instances see it. Pure CPU, no device needed.
+*/
+
+class ClusterCuller
+{
+public:
+	// the frustum and camera every Cull call tests against until the next SetView
+	void SetView(const DirectX::XMMATRIX& ViewProj, const DirectX::XMFLOAT3& CameraPosition);
+	void SetConeCulling(bool bConeCulling) { m_bConeCulling = bConeCulling; }
+	bool GetConeCulling() const { return m_bConeCulling; }
+
+	// World is the row-vector mesh to world matrix (node transform times the transposed instance transform). Ranges are appended to
+	// OutRanges, FirstIndex is the mesh's offset into the index buffer. Returns the number of triangles rejected
+	UINT Cull(const Meshlet* Meshlets, UINT Count, const DirectX::XMMATRIX& World, UINT FirstIndex, std::vector<ClusterDrawRange>& OutRanges);
+	// the same test for InstanceCount instances at once. Instance i is MeshTransform times the transposed Transforms[i] and goes in
+	// OutInstances as FirstInstance + i, in increasing order within a range. Consecutive clusters seen by exactly the same instances
+	// share a range. Returns the number of triangles rejected over all the instances
+	UINT CullInstances(const Meshlet* Meshlets, UINT Count, const DirectX::XMMATRIX& MeshTransform, const DirectX::XMMATRIX* Transforms, UINT InstanceCount,
+		UINT FirstInstance, UINT FirstIndex, std::vector<UINT>& OutInstances, std::vector<ClusterInstancedRange>& OutRanges);
+
+	// what the last Cull or CullInstances call did, summed over every instance
+	UINT GetLastClustersOutsideFrustum() const { return m_LastClustersOutsideFrustum; }
+	UINT GetLastClustersBackfacing() const { return m_LastClustersBackfacing; }
+
+private:
+	enum class ClusterResult { Visible, OutsideFrustum, Backfacing };
+
+	// what testing a cluster of one instance needs, worked out once per instance
+	struct InstanceView
+	{
+		DirectX::XMMATRIX World;
+		DirectX::XMVECTOR LocalCamera;
+		float RadiusScale;
+		bool bConeCulling;
+	};
+
+	InstanceView PrepareInstance(const DirectX::XMMATRIX& World) const;
+	ClusterResult TestCluster(const Meshlet& m, const InstanceView& View) const;
+
+private:
+	Frustum m_Frustum;
+	DirectX::XMFLOAT3 m_CameraPosition = { 0.f, 0.f, 0.f };
+	bool m_bConeCulling = true;
+
+	UINT m_LastClustersOutsideFrustum = 0u;
+	UINT m_LastClustersBackfacing = 0u;
+
+	// CullInstances scratch, the visible (cluster, instance) pairs and then the instances bucketed by cluster
+	std::vector<UINT> m_PairClusters;
+	std::vector<UINT> m_PairInstances;
+	std::vector<UINT> m_ClusterStarts;
+	std::vector<UINT> m_ClusterInstances;
+
+};
+
+#endif
@@ -10,6 +10,19 @@
 #define MAX_GRASS_PER_CHUNK 10000
 #define MAX_INSTANCE_COUNT 1024
 #define MAX_GRASS_COUNT (MAX_PLANE_CHUNKS * MAX_GRASS_PER_CHUNK)
+#define GRASS_TILE_DIMENSION 8
+
+// batched model culling, all models share one packed input and one culled buffer
+#define MAX_BATCH_MODELS 1024
+#define MAX_BATCH_DRAWS 4096
+#define BATCH_READBACK_LATENCY 3
+
+// occluder selection per model, CPU only
+#define OCCLUDER_MIN_AREA_FRACTION 0.05f
+#define OCCLUDER_TRIANGLE_BUDGET 8192u
+
+// simplified levels generated per mesh at import, level 0 is the full mesh
+#define MAX_MESH_LODS 4
 
 #include <vector>
 #include <utility>
@@ -24,14 +37,81 @@ struct Vertex
 	DirectX::XMFLOAT2 TexCoord;
 };
 
+// half the size of Vertex, see VertexCompression for the encoding. The input layout reads Pos as R16G16B16A16_UNORM relative to
+// the mesh bounds, Normal as R16G16_SNORM octahedral and TexCoord as R16G16_FLOAT
+struct PackedVertex
+{
+	unsigned short Pos[4];
+	short Normal[2];
+	unsigned short TexCoord[2];
+};
+
 typedef unsigned long long UINT64;
 
+// what the model's vertex buffer holds, the CPU side arrays are always full Vertex
+enum class VertexFormat
+{
+	Full,
+	Packed
+};
+
+enum class CullingBackend
+{
+	GPU,
+	CPU
+};
+
+// CPU side of a frame, timed by Application every frame and by the headless stress benchmarks
+enum class FramePhase
+{
+	TransformUpdate,
+	Gather,
+	Culling,
+	Lights,
+	DrawSubmission,
+	Landscape,
+	PostProcess,
+	Count
+};
+
+inline const char* FramePhaseNames[(int)FramePhase::Count] = { "TransformUpdate", "Gather", "Culling", "Lights", "DrawSubmission", "Landscape", "PostProcess" };
+
 struct RenderStats
 {
 	std::vector<std::pair<std::string, UINT64>> TrianglesRendered;
 	std::vector<std::pair<std::string, UINT64>> InstancesRendered;
 	UINT64 DrawCalls;
 	UINT64 ComputeDispatches;
+	UINT64 SceneBVHNodesVisited;
+	UINT64 SceneBVHItemsVisible;
+	UINT64 OccluderTriangles;
+	UINT64 InstancesOccluded;
+	UINT64 BatchValidationMismatches;
+	UINT64 InstanceBufferCapacity;
+	UINT64 InstanceBufferHighWaterMark;
+	UINT64 InstancesOverBufferCapacity;
+	UINT64 TemporalTestsRun;
+	UINT64 TemporalTestsSkipped;
+	std::vector<std::pair<std::string, UINT64>> MultiViewInstancesVisible;
+	UINT64 InstancesTooSmall;
+	UINT64 ClustersOutsideFrustum;
+	UINT64 ClustersBackfacing;
+	UINT64 ClusterTrianglesRejected;
+	UINT64 LODInstances[MAX_MESH_LODS];
+	UINT64 LODTrianglesSaved;
+	UINT64 LandscapeNodesVisited;
+	UINT64 LandscapeChunksVisible;
+	UINT64 GrassTilesCulled;
+	UINT64 GrassTilesInside;
+	UINT64 GrassTilesPartial;
+	UINT64 GrassBladeTestsAvoided;
+	UINT64 TransformsUpdated;
+	UINT64 WorldMatricesRecomputed;
+	UINT64 WorldMatricesReused;
+	UINT64 SpatialHashModels;
+	UINT64 SpatialHashCells;
+	UINT64 PointLightModelsInRange;
+	double PhaseMilliseconds[(int)FramePhase::Count];
 	double FrameTime;
 	double FPS;
 };
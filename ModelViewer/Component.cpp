@@ -1,9 +1,28 @@
+#include <cassert>
+
 #include "Component.h"
 #include "Model.h"
 
+Component::Component()
+{
+	m_TransformID = TransformStore::GetSingletonPtr()->Create();
+}
+
+Component::~Component()
+{
+	// children are owned, each goes back to the ComponentPool of its own type
+	for (Component* Comp : m_Components)
+	{
+		assert(Comp->m_pPoolDestroy);
+		Comp->m_pPoolDestroy(Comp->m_PoolHandle);
+	}
+
+	TransformStore::GetSingletonPtr()->Release(m_TransformID);
+}
+
 void Component::SetPosition(float x, float y, float z)
 {
-	m_Transform.Position = DirectX::XMFLOAT3(x, y, z);
+	TransformStore::GetSingletonPtr()->SetPosition(m_TransformID, DirectX::XMFLOAT3(x, y, z));
 }
 
 void Component::SetRotation(float x, float y, float z)
@@ -15,37 +34,51 @@ void Component::SetRotation(float x, float y, float z)
 	z = fmodf(z, 360.f);
 	if (z < 0.f) z += 360.f;
 
-	m_Transform.Rotation = DirectX::XMFLOAT3(x, y, z);
+	TransformStore::GetSingletonPtr()->SetRotation(m_TransformID, DirectX::XMFLOAT3(x, y, z));
 }
 
 void Component::SetScale(float x, float y, float z)
 {
-	m_Transform.Scale = DirectX::XMFLOAT3(x, y, z);
+	TransformStore::GetSingletonPtr()->SetScale(m_TransformID, DirectX::XMFLOAT3(x, y, z));
 }
 
 void Component::SetScale(float xyz)
 {
-	m_Transform.Scale = { xyz, xyz, xyz };
+	TransformStore::GetSingletonPtr()->SetScale(m_TransformID, { xyz, xyz, xyz });
 }
 
 void Component::SetTransform(const Transform& NewTransform)
 {
-	m_Transform = NewTransform;
+	TransformStore* Store = TransformStore::GetSingletonPtr();
+	Store->SetPosition(m_TransformID, NewTransform.Position);
+	Store->SetRotation(m_TransformID, NewTransform.Rotation);
+	Store->SetScale(m_TransformID, NewTransform.Scale);
 }
 
-void Component::AddComponent(std::shared_ptr<Component> Comp)
+void Component::SetOwner(Component* pOwner)
 {
-	if (!Comp.get())
+	Component* pOldOwner = m_pOwner;
+	m_pOwner = pOwner;
+	TransformStore::GetSingletonPtr()->SetParent(m_TransformID, pOwner ? pOwner->m_TransformID : TransformStore::INVALID_ID);
+
+	if (pOwner && !pOldOwner)
 	{
-		return;
+		RegisterType();
 	}
+	else if (!pOwner && pOldOwner)
+	{
+		UnregisterType();
+	}
+}
 
+void Component::AttachComponent(Component* Comp)
+{
 	Comp->SetOwner(this);
 	m_Components.push_back(Comp);
 
-	if (Model* m = dynamic_cast<Model*>(Comp.get()))
+	if (Comp->GetType() == ComponentType::Model)
 	{
-		m_Models.push_back(m);
+		m_Models.push_back(static_cast<Model*>(Comp));
 	}
 }
 
@@ -57,33 +90,22 @@ void Component::SendTransformToModels()
 			m->SendTransformToModel();
 	}
 
-	for (std::shared_ptr<Component>& Comp : m_Components)
+	for (Component* Comp : m_Components)
 	{
 		Comp->SendTransformToModels();
 	}
 }
 
-const DirectX::XMMATRIX Component::GetWorldMatrix() const
+const Transform Component::GetTransform() const
 {
-	DirectX::XMMATRIX Matrix = DirectX::XMMatrixIdentity();
-	Matrix *= DirectX::XMMatrixScaling(m_Transform.Scale.x, m_Transform.Scale.y, m_Transform.Scale.z);
-	Matrix *= DirectX::XMMatrixRotationY(DirectX::XMConvertToRadians(m_Transform.Rotation.y));
-	Matrix *= DirectX::XMMatrixRotationX(DirectX::XMConvertToRadians(m_Transform.Rotation.x));
-	Matrix *= DirectX::XMMatrixRotationZ(DirectX::XMConvertToRadians(m_Transform.Rotation.z));
-	Matrix *= DirectX::XMMatrixTranslation(m_Transform.Position.x, m_Transform.Position.y, m_Transform.Position.z);
-
-	return Matrix;
+	Transform Current;
+	Current.Position = GetPosition();
+	Current.Rotation = GetRotation();
+	Current.Scale = GetScale();
+	return Current;
 }
 
-const DirectX::XMMATRIX Component::GetAccumulatedWorldMatrix() const
+const DirectX::XMMATRIX Component::GetWorldMatrix() const
 {
-	if (m_pOwner == nullptr)
-	{
-		return GetWorldMatrix();
-	}
-
-	DirectX::XMMATRIX Accumulated = m_pOwner->GetAccumulatedWorldMatrix();
-	Accumulated *= GetWorldMatrix();
-
-	return Accumulated;
+	return TransformStore::ComposeLocalMatrix(GetPosition(), GetRotation(), GetScale());
 }
@@ -6,8 +6,25 @@
 
 #include "DirectXMath.h"
 
+#include "TransformStore.h"
+#include "ComponentPool.h"
+
 class Model;
 
+template<typename T>
+class ComponentRegistry;
+
+const UINT INVALID_REGISTRY_SLOT = 0xFFFFFFFF;
+
+// set by the constructor of each concrete type, lets AddComponent sort children without a dynamic_cast
+enum class ComponentType
+{
+	Generic,
+	Model,
+	PointLight,
+	DirectionalLight
+};
+
 struct Transform
 {
 	DirectX::XMFLOAT3 Position = { 0.f, 0.f, 0.f };
@@ -15,10 +32,13 @@ struct Transform
 	DirectX::XMFLOAT3 Scale = { 1.f, 1.f, 1.f };
 };
 
+// the transform itself lives in the TransformStore, this is only used to pass one around
 class Component
 {
 public:
-	virtual ~Component() = default;
+	Component();
+	Component(const Component& Other) = delete;
+	virtual ~Component();
 
 	virtual void RenderControls() = 0;
 
@@ -28,32 +48,67 @@ public:
 	void SetScale(float xyz);
 	void SetTransform(const Transform& NewTransform);
 
-	void SetOwner(Component* pOwner) { m_pOwner = pOwner; }
+	void SetOwner(Component* pOwner);
 
-	void AddComponent(std::shared_ptr<Component> Comp);
+	// creates T in its ComponentPool and attaches it, the owner destroys it along with itself
+	template<typename T, typename... Args>
+	T* AddComponent(Args&&... Arguments);
 
 	void SendTransformToModels();
 
-	const DirectX::XMFLOAT3 GetPosition() const { return m_Transform.Position; }
-	const DirectX::XMFLOAT3 GetRotation() const { return m_Transform.Rotation; }
-	const DirectX::XMFLOAT3 GetScale() const { return m_Transform.Scale; }
-	const Transform& GetTransform() const { return m_Transform; }
-	Transform& GetTransformRef()  { return m_Transform; }
+	const DirectX::XMFLOAT3 GetPosition() const { return TransformStore::GetSingletonPtr()->GetPosition(m_TransformID); }
+	const DirectX::XMFLOAT3 GetRotation() const { return TransformStore::GetSingletonPtr()->GetRotation(m_TransformID); }
+	const DirectX::XMFLOAT3 GetScale() const { return TransformStore::GetSingletonPtr()->GetScale(m_TransformID); }
+	const Transform GetTransform() const;
 	const DirectX::XMMATRIX GetWorldMatrix() const;
-	const DirectX::XMMATRIX GetAccumulatedWorldMatrix() const;
+	// as of the last TransformStore::UpdateWorldMatrices
+	const DirectX::XMMATRIX& GetAccumulatedWorldMatrix() const { return TransformStore::GetSingletonPtr()->GetWorldMatrix(m_TransformID); }
+	UINT GetTransformID() const { return m_TransformID; }
 
 	Component* GetOwner() const { return m_pOwner; }
+	// resolves through ComponentPool<T>::Get for the concrete type, invalid for components that were not created by AddComponent
+	PoolHandle GetPoolHandle() const { return m_PoolHandle; }
 
-	const std::vector<std::shared_ptr<Component>>& GetComponents() const { return m_Components; }
+	const std::vector<Component*>& GetComponents() const { return m_Components; }
 	const std::vector<Model*>& GetModels() const { return m_Models; }
+	ComponentType GetType() const { return m_Type; }
+
+protected:
+	// adds the component to / removes it from the ComponentRegistry of its type. Called when it gets or loses an owner, types
+	// with a registry also unregister in their own destructor
+	virtual void RegisterType() {}
+	virtual void UnregisterType() {}
+
+	template<typename T>
+	friend class ComponentRegistry;
+	template<typename T>
+	friend class ComponentPool;
+
+private:
+	void AttachComponent(Component* Comp);
 
 protected:
 	Component* m_pOwner = nullptr;
-	Transform m_Transform;
+	UINT m_TransformID;
+	UINT m_RegistrySlot = INVALID_REGISTRY_SLOT;
+	ComponentType m_Type = ComponentType::Generic;
 	std::string m_ComponentName = "Component Name";
 
-	std::vector<std::shared_ptr<Component>> m_Components; // I think these should be unique_ptr??? refactor soon
+	// owned, every one lives in the ComponentPool of its type
+	std::vector<Component*> m_Components;
 	std::vector<Model*> m_Models;
 
+	// set by ComponentPool::Create, the destroy of the pool of the concrete type
+	PoolHandle m_PoolHandle;
+	bool (*m_pPoolDestroy)(PoolHandle Handle) = nullptr;
+
 };
 
+template<typename T, typename... Args>
+T* Component::AddComponent(Args&&... Arguments)
+{
+	T* Comp = ComponentPool<T>::Create(std::forward<Args>(Arguments)...);
+	AttachComponent(Comp);
+	return Comp;
+}
+
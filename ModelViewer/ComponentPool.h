@@ -0,0 +1,49 @@
+#pragma once
+
+#ifndef COMPONENT_POOL_H
+#define COMPONENT_POOL_H
+
+#include <vector>
+#include <utility>
+
+#include "ObjectPool.h"
+
+/*
+*	The ObjectPool every component of one type is created in. Component::AddComponent creates the component here and the owner
+*	destroys it through the pool along with itself, so attaching and detaching thousands of components a second never touches
+*	the heap once the blocks exist. A handle from GetPoolHandle resolves to nullptr once the component is gone. The pool is created
+*	on first use and never destroyed, nothing depends on the order statics go away in at exit. Pure CPU, no device needed.
+*/
+
+template<typename T>
+class ComponentPool
+{
+public:
+	template<typename... Args>
+	static T* Create(Args&&... Arguments)
+	{
+		const PoolHandle Handle = GetPool().Create(std::forward<Args>(Arguments)...);
+		T* Comp = GetPool().Get(Handle);
+		Comp->m_PoolHandle = Handle;
+		Comp->m_pPoolDestroy = &ComponentPool<T>::Destroy;
+		return Comp;
+	}
+
+	// returns false for a stale or invalid handle
+	static bool Destroy(PoolHandle Handle) { return GetPool().Destroy(Handle); }
+	static T* Get(PoolHandle Handle) { return GetPool().Get(Handle); }
+
+	static const std::vector<T*>& GetObjects() { return GetPool().GetObjects(); }
+	static UINT GetCount() { return GetPool().GetCount(); }
+	static UINT GetCapacity() { return GetPool().GetCapacity(); }
+
+private:
+	static ObjectPool<T>& GetPool()
+	{
+		static ObjectPool<T>* Pool = new ObjectPool<T>();
+		return *Pool;
+	}
+
+};
+
+#endif
@@ -0,0 +1,72 @@
+#pragma once
+
+#ifndef COMPONENT_REGISTRY_H
+#define COMPONENT_REGISTRY_H
+
+#include <vector>
+#include <functional>
+
+#include "Component.h"
+
+/*
+*	Dense list of every attached component of one type. Components add themselves from Component::RegisterType when they get an
+*	owner and remove themselves when they lose it or are destroyed, so systems iterate exactly the types they need instead of
+*	walking the scene and casting. Removal swaps the last entry into the hole, the order is the attach order until something goes.
+*	A system that keeps its own structure over one type can listen for the adds and removes instead of diffing the list every frame.
+*/
+
+template<typename T>
+class ComponentRegistry
+{
+public:
+	static void Register(T* Comp)
+	{
+		if (Comp->m_RegistrySlot != INVALID_REGISTRY_SLOT)
+			return;
+
+		Comp->m_RegistrySlot = (UINT)ms_Components.size();
+		ms_Components.push_back(Comp);
+		ms_Version++;
+
+		if (ms_OnAdded)
+			ms_OnAdded(Comp);
+	}
+
+	static void Unregister(T* Comp)
+	{
+		const UINT Slot = Comp->m_RegistrySlot;
+		if (Slot == INVALID_REGISTRY_SLOT)
+			return;
+
+		if (ms_OnRemoved)
+			ms_OnRemoved(Comp);
+
+		T* Moved = ms_Components.back();
+		ms_Components[Slot] = Moved;
+		Moved->m_RegistrySlot = Slot;
+		ms_Components.pop_back();
+
+		Comp->m_RegistrySlot = INVALID_REGISTRY_SLOT;
+		ms_Version++;
+	}
+
+	static const std::vector<T*>& GetAll() { return ms_Components; }
+	// bumped on every add and remove, lets systems notice membership changes without comparing the whole list
+	static unsigned long long GetVersion() { return ms_Version; }
+
+	// one listener per type, OnAdded runs right after a component is added and OnRemoved right before it goes. Empty to stop listening
+	static void SetListeners(std::function<void(T*)> OnAdded, std::function<void(T*)> OnRemoved)
+	{
+		ms_OnAdded = std::move(OnAdded);
+		ms_OnRemoved = std::move(OnRemoved);
+	}
+
+private:
+	static inline std::vector<T*> ms_Components;
+	static inline unsigned long long ms_Version = 0u;
+	static inline std::function<void(T*)> ms_OnAdded;
+	static inline std::function<void(T*)> ms_OnRemoved;
+
+};
+
+#endif
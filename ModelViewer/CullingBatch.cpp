@@ -0,0 +1,67 @@
+#include "CullingBatch.h"
+
+void CullingBatch::Clear()
+{
+	m_Transforms.clear();
+	m_ModelIDs.clear();
+	m_Models.clear();
+	m_Draws.clear();
+	m_ModelNames.clear();
+}
+
+UINT CullingBatch::AddModel(const std::string& Name, const std::vector<DirectX::XMMATRIX>& Transforms, const AABB& BBox)
+{
+	const UINT ModelIndex = (UINT)m_Models.size();
+
+	ModelEntry Entry = {};
+	Entry.BoundsCenter = { (BBox.Min.x + BBox.Max.x) * 0.5f, (BBox.Min.y + BBox.Max.y) * 0.5f, (BBox.Min.z + BBox.Max.z) * 0.5f, 1.f };
+	Entry.BoundsExtent = { (BBox.Max.x - BBox.Min.x) * 0.5f, (BBox.Max.y - BBox.Min.y) * 0.5f, (BBox.Max.z - BBox.Min.z) * 0.5f, 0.f };
+	Entry.InstanceOffset = (UINT)m_Transforms.size();
+	Entry.InstanceCount = (UINT)Transforms.size();
+
+	m_Models.push_back(Entry);
+	m_ModelNames.push_back(Name);
+	m_Transforms.insert(m_Transforms.end(), Transforms.begin(), Transforms.end());
+	m_ModelIDs.insert(m_ModelIDs.end(), Transforms.size(), ModelIndex);
+
+	return ModelIndex;
+}
+
+UINT CullingBatch::AddDraw(UINT ModelIndex, UINT IndexCount, UINT StartIndex, UINT BaseVertex)
+{
+	m_Draws.push_back({ ModelIndex, IndexCount, StartIndex, (int)BaseVertex });
+	return (UINT)m_Draws.size() - 1u;
+}
+
+void CullingBatch::CullReference(const DirectX::XMMATRIX& ViewProj, std::vector<DirectX::XMMATRIX>& OutCulled, std::vector<InstanceRange>& OutRanges,
+	ScreenSizeCuller* ScreenSize)
+{
+	OutCulled.resize(m_Transforms.size());
+	OutRanges.resize(m_Models.size());
+
+	for (size_t i = 0; i < m_Models.size(); i++)
+	{
+		const ModelEntry& Model = m_Models[i];
+
+		AABB BBox;
+		BBox.Min = { Model.BoundsCenter.x - Model.BoundsExtent.x, Model.BoundsCenter.y - Model.BoundsExtent.y, Model.BoundsCenter.z - Model.BoundsExtent.z };
+		BBox.Max = { Model.BoundsCenter.x + Model.BoundsExtent.x, Model.BoundsCenter.y + Model.BoundsExtent.y, Model.BoundsCenter.z + Model.BoundsExtent.z };
+
+		m_ReferenceCuller.Cull(m_Transforms.data() + Model.InstanceOffset, Model.InstanceCount, BBox, ViewProj);
+		const std::vector<UINT>* Visible = &m_ReferenceCuller.GetVisibleIndices();
+		if (ScreenSize)
+		{
+			ScreenSize->Cull(m_Transforms.data() + Model.InstanceOffset, BBox, *Visible, m_ReferenceIndices);
+			Visible = &m_ReferenceIndices;
+		}
+
+		const std::vector<UINT>& VisibleIndices = *Visible;
+		const UINT VisibleCount = (UINT)VisibleIndices.size();
+		for (UINT v = 0u; v < VisibleCount; v++)
+		{
+			OutCulled[Model.InstanceOffset + v] = m_Transforms[Model.InstanceOffset + VisibleIndices[v]];
+		}
+
+		OutRanges[i] = { Model.InstanceOffset, VisibleCount };
+	}
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#ifndef CULLING_BATCH_H
+#define CULLING_BATCH_H
+
+#include <string>
+#include <vector>
+
+#include "DirectXMath.h"
+
+#include "AABB.h"
+#include "CPUFrustumCuller.h"
+#include "ScreenSizeCuller.h"
+
+typedef unsigned int UINT;
+
+/*
+*	Packed input for culling every model in one dispatch. Transforms of all models are concatenated and each instance carries the
+*	index of the model it belongs to. Culled instances of model i are written to the same range they were sent in, so the output
+*	range of a model is (InstanceOffset, visible count) and is known before the counts come back. Draws list every mesh so one
+*	dispatch can fill all of the indirect args.
+*/
+
+class CullingBatch
+{
+public:
+	// layouts match BatchModelData and BatchDrawData in FrustumCullingCS.hlsl
+	struct ModelEntry
+	{
+		DirectX::XMFLOAT4 BoundsCenter;
+		DirectX::XMFLOAT4 BoundsExtent;
+		UINT InstanceOffset;
+		UINT InstanceCount;
+		UINT Padding[2];
+	};
+
+	struct DrawEntry
+	{
+		UINT ModelIndex;
+		UINT IndexCount;
+		UINT StartIndex;
+		int BaseVertex;
+	};
+
+	struct InstanceRange
+	{
+		UINT Offset;
+		UINT Count;
+
+		bool operator==(const InstanceRange& Other) const { return Offset == Other.Offset && Count == Other.Count; }
+	};
+
+public:
+	void Clear();
+
+	UINT AddModel(const std::string& Name, const std::vector<DirectX::XMMATRIX>& Transforms, const AABB& BBox);
+	UINT AddDraw(UINT ModelIndex, UINT IndexCount, UINT StartIndex, UINT BaseVertex = 0u);
+
+	// CPU version of FrustumCullBatch, same plane test and the same ranges. Order inside a range follows the input order here
+	// but is not guaranteed on the GPU. With ScreenSize the instances it drops are removed as well, like the shader does with MinPixelRadius
+	void CullReference(const DirectX::XMMATRIX& ViewProj, std::vector<DirectX::XMMATRIX>& OutCulled, std::vector<InstanceRange>& OutRanges,
+		ScreenSizeCuller* ScreenSize = nullptr);
+
+	const std::vector<DirectX::XMMATRIX>& GetTransforms() const { return m_Transforms; }
+	const std::vector<UINT>& GetModelIDs() const { return m_ModelIDs; }
+	const std::vector<ModelEntry>& GetModels() const { return m_Models; }
+	const std::vector<DrawEntry>& GetDraws() const { return m_Draws; }
+	const std::vector<std::string>& GetModelNames() const { return m_ModelNames; }
+
+	UINT GetInstanceCount() const { return (UINT)m_Transforms.size(); }
+	UINT GetModelCount() const { return (UINT)m_Models.size(); }
+	UINT GetDrawCount() const { return (UINT)m_Draws.size(); }
+	bool IsEmpty() const { return m_Transforms.empty(); }
+
+private:
+	std::vector<DirectX::XMMATRIX> m_Transforms;
+	std::vector<UINT> m_ModelIDs;
+	std::vector<ModelEntry> m_Models;
+	std::vector<DrawEntry> m_Draws;
+	std::vector<std::string> m_ModelNames;
+
+	CPUFrustumCuller m_ReferenceCuller;
+	std::vector<UINT> m_ReferenceIndices;
+
+};
+
+#endif
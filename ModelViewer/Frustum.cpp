@@ -0,0 +1,299 @@
+#include <cmath>
+#include <immintrin.h>
+
+#include "Frustum.h"
+
+namespace
+{
+	// 1 bit per lane that is still visible after all six planes. GetDistPlusRadius returns the signed plane distance plus the
+	// projected radius of 4 items for one plane
+	template<typename DistFunc>
+	int TestPlanes4(const DirectX::XMFLOAT4* Planes, DistFunc&& GetDistPlusRadius)
+	{
+		const __m128 Zero = _mm_setzero_ps();
+		__m128 Visible = _mm_cmpeq_ps(Zero, Zero);
+		for (int p = 0; p < Frustum::PlaneCount; p++)
+		{
+			Visible = _mm_and_ps(Visible, _mm_cmpge_ps(GetDistPlusRadius(Planes[p]), Zero));
+		}
+		return _mm_movemask_ps(Visible);
+	}
+
+	void StoreMask(int Mask, UINT First, UINT Count, unsigned char* OutVisible)
+	{
+		for (UINT Lane = 0u; Lane < 4u && First + Lane < Count; Lane++)
+		{
+			OutVisible[First + Lane] = (unsigned char)((Mask >> Lane) & 1);
+		}
+	}
+
+	// copies the tail of an array into a zero padded block of 4 so the last iteration can use full loads
+	__m128 LoadPartial(const float* Src, UINT First, UINT Count)
+	{
+		if (First + 4u <= Count)
+			return _mm_loadu_ps(Src + First);
+
+		float Block[4] = { 0.f, 0.f, 0.f, 0.f };
+		for (UINT i = 0u; First + i < Count; i++)
+		{
+			Block[i] = Src[First + i];
+		}
+		return _mm_loadu_ps(Block);
+	}
+}
+
+Frustum::Frustum()
+{
+	for (int i = 0; i < PlaneCount; i++)
+	{
+		m_Planes[i] = { 0.f, 0.f, 0.f, 0.f };
+	}
+}
+
+Frustum::Frustum(const DirectX::XMMATRIX& ViewProj)
+{
+	Extract(ViewProj);
+}
+
+void Frustum::Extract(const DirectX::XMMATRIX& ViewProj)
+{
+	// Gribb/Hartmann, rows of the transpose are the columns of the row-vector view projection
+	DirectX::XMMATRIX m = DirectX::XMMatrixTranspose(ViewProj);
+
+	DirectX::XMVECTOR Planes[PlaneCount];
+	Planes[Left] = DirectX::XMVectorAdd(m.r[3], m.r[0]);
+	Planes[Right] = DirectX::XMVectorSubtract(m.r[3], m.r[0]);
+	Planes[Bottom] = DirectX::XMVectorAdd(m.r[3], m.r[1]);
+	Planes[Top] = DirectX::XMVectorSubtract(m.r[3], m.r[1]);
+	Planes[Near] = m.r[2];													// D3D clip space z starts at 0
+	Planes[Far] = DirectX::XMVectorSubtract(m.r[3], m.r[2]);
+
+	for (int i = 0; i < PlaneCount; i++)
+	{
+		DirectX::XMStoreFloat4(&m_Planes[i], DirectX::XMPlaneNormalize(Planes[i]));
+	}
+}
+
+void Frustum::GetCorners(DirectX::XMFLOAT4* OutCorners) const
+{
+	// intersect the planes instead of going through the inverse view projection, with a small near plane the far corners lose most
+	// of their precision when unprojected from z = 1
+	int i = 0;
+	for (int z = 0; z <= 1; ++z)
+	{
+		for (int y = 0; y <= 1; ++y)
+		{
+			for (int x = 0; x <= 1; ++x)
+			{
+				DirectX::XMVECTOR a = DirectX::XMLoadFloat4(&m_Planes[x == 0 ? Left : Right]);
+				DirectX::XMVECTOR b = DirectX::XMLoadFloat4(&m_Planes[y == 0 ? Bottom : Top]);
+				DirectX::XMVECTOR c = DirectX::XMLoadFloat4(&m_Planes[z == 0 ? Near : Far]);
+
+				DirectX::XMVECTOR bc = DirectX::XMVector3Cross(b, c);
+				DirectX::XMVECTOR ca = DirectX::XMVector3Cross(c, a);
+				DirectX::XMVECTOR ab = DirectX::XMVector3Cross(a, b);
+				float Denom = DirectX::XMVectorGetX(DirectX::XMVector3Dot(a, bc));
+
+				DirectX::XMVECTOR Corner = DirectX::XMVectorAdd(DirectX::XMVectorAdd(DirectX::XMVectorScale(bc, DirectX::XMVectorGetW(a)),
+					DirectX::XMVectorScale(ca, DirectX::XMVectorGetW(b))), DirectX::XMVectorScale(ab, DirectX::XMVectorGetW(c)));
+				Corner = DirectX::XMVectorScale(Corner, -1.f / Denom);
+
+				DirectX::XMStoreFloat4(&OutCorners[i++], DirectX::XMVectorSetW(Corner, 1.f));
+			}
+		}
+	}
+}
+
+bool Frustum::TestPoint(const DirectX::XMFLOAT3& Point) const
+{
+	return TestSphere(Point, 0.f);
+}
+
+bool Frustum::TestAABB(const DirectX::XMFLOAT3& Center, const DirectX::XMFLOAT3& Extent) const
+{
+	for (int p = 0; p < PlaneCount; p++)
+	{
+		const DirectX::XMFLOAT4& Plane = m_Planes[p];
+		float Dist = Plane.x * Center.x + Plane.y * Center.y + Plane.z * Center.z + Plane.w;
+		float Radius = fabsf(Plane.x) * Extent.x + fabsf(Plane.y) * Extent.y + fabsf(Plane.z) * Extent.z;
+		if (Dist + Radius < 0.f)
+			return false;
+	}
+	return true;
+}
+
+bool Frustum::TestAABB(const DirectX::XMFLOAT3& Center, const DirectX::XMFLOAT3& Extent, UINT& PlaneMask) const
+{
+	for (int p = 0; p < PlaneCount; p++)
+	{
+		if (!(PlaneMask & (1u << p)))
+			continue;
+
+		const DirectX::XMFLOAT4& Plane = m_Planes[p];
+		float Dist = Plane.x * Center.x + Plane.y * Center.y + Plane.z * Center.z + Plane.w;
+		float Radius = fabsf(Plane.x) * Extent.x + fabsf(Plane.y) * Extent.y + fabsf(Plane.z) * Extent.z;
+		if (Dist + Radius < 0.f)
+			return false;
+
+		if (Dist - Radius >= 0.f)
+			PlaneMask &= ~(1u << p);
+	}
+	return true;
+}
+
+bool Frustum::TestSphere(const DirectX::XMFLOAT3& Center, float Radius) const
+{
+	for (int p = 0; p < PlaneCount; p++)
+	{
+		const DirectX::XMFLOAT4& Plane = m_Planes[p];
+		if (Plane.x * Center.x + Plane.y * Center.y + Plane.z * Center.z + Plane.w + Radius < 0.f)
+			return false;
+	}
+	return true;
+}
+
+bool Frustum::TestOBB(const DirectX::XMFLOAT3& Center, const DirectX::XMFLOAT3* HalfAxes) const
+{
+	for (int p = 0; p < PlaneCount; p++)
+	{
+		const DirectX::XMFLOAT4& Plane = m_Planes[p];
+		float Dist = Plane.x * Center.x + Plane.y * Center.y + Plane.z * Center.z + Plane.w;
+		float Radius = 0.f;
+		for (int Axis = 0; Axis < 3; Axis++)
+		{
+			Radius += fabsf(Plane.x * HalfAxes[Axis].x + Plane.y * HalfAxes[Axis].y + Plane.z * HalfAxes[Axis].z);
+		}
+		if (Dist + Radius < 0.f)
+			return false;
+	}
+	return true;
+}
+
+bool Frustum::TestOBB(const AABB& LocalBounds, const DirectX::XMMATRIX& Transform) const
+{
+	const float cx = (LocalBounds.Min.x + LocalBounds.Max.x) * 0.5f;
+	const float cy = (LocalBounds.Min.y + LocalBounds.Max.y) * 0.5f;
+	const float cz = (LocalBounds.Min.z + LocalBounds.Max.z) * 0.5f;
+	const float Extent[3] = { (LocalBounds.Max.x - LocalBounds.Min.x) * 0.5f, (LocalBounds.Max.y - LocalBounds.Min.y) * 0.5f,
+		(LocalBounds.Max.z - LocalBounds.Min.z) * 0.5f };
+
+	// transposed, so column i of m is the local axis i in world space
+	DirectX::XMFLOAT4X4 m;
+	DirectX::XMStoreFloat4x4(&m, Transform);
+
+	DirectX::XMFLOAT3 Center;
+	Center.x = m.m[0][0] * cx + m.m[0][1] * cy + m.m[0][2] * cz + m.m[0][3];
+	Center.y = m.m[1][0] * cx + m.m[1][1] * cy + m.m[1][2] * cz + m.m[1][3];
+	Center.z = m.m[2][0] * cx + m.m[2][1] * cy + m.m[2][2] * cz + m.m[2][3];
+
+	DirectX::XMFLOAT3 HalfAxes[3];
+	for (int Axis = 0; Axis < 3; Axis++)
+	{
+		HalfAxes[Axis] = { m.m[0][Axis] * Extent[Axis], m.m[1][Axis] * Extent[Axis], m.m[2][Axis] * Extent[Axis] };
+	}
+
+	return TestOBB(Center, HalfAxes);
+}
+
+void Frustum::TestAABBs(const float* CenterX, const float* CenterY, const float* CenterZ, const float* ExtentX, const float* ExtentY, const float* ExtentZ,
+	UINT Count, unsigned char* OutVisible) const
+{
+	const __m128 SignMask = _mm_set1_ps(-0.f);
+
+	for (UINT i = 0u; i < Count; i += 4u)
+	{
+		const __m128 cx = LoadPartial(CenterX, i, Count);
+		const __m128 cy = LoadPartial(CenterY, i, Count);
+		const __m128 cz = LoadPartial(CenterZ, i, Count);
+		const __m128 ex = LoadPartial(ExtentX, i, Count);
+		const __m128 ey = LoadPartial(ExtentY, i, Count);
+		const __m128 ez = LoadPartial(ExtentZ, i, Count);
+
+		int Mask = TestPlanes4(m_Planes, [&](const DirectX::XMFLOAT4& Plane)
+			{
+				const __m128 PX = _mm_set1_ps(Plane.x);
+				const __m128 PY = _mm_set1_ps(Plane.y);
+				const __m128 PZ = _mm_set1_ps(Plane.z);
+				__m128 Dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(PX, cx), _mm_mul_ps(PY, cy)), _mm_add_ps(_mm_mul_ps(PZ, cz), _mm_set1_ps(Plane.w)));
+				__m128 Radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(SignMask, PX), ex), _mm_mul_ps(_mm_andnot_ps(SignMask, PY), ey)),
+					_mm_mul_ps(_mm_andnot_ps(SignMask, PZ), ez));
+				return _mm_add_ps(Dist, Radius);
+			});
+
+		StoreMask(Mask, i, Count, OutVisible);
+	}
+}
+
+void Frustum::TestSpheres(const float* CenterX, const float* CenterY, const float* CenterZ, const float* Radius, UINT Count, unsigned char* OutVisible) const
+{
+	for (UINT i = 0u; i < Count; i += 4u)
+	{
+		const __m128 cx = LoadPartial(CenterX, i, Count);
+		const __m128 cy = LoadPartial(CenterY, i, Count);
+		const __m128 cz = LoadPartial(CenterZ, i, Count);
+		const __m128 r = LoadPartial(Radius, i, Count);
+
+		int Mask = TestPlanes4(m_Planes, [&](const DirectX::XMFLOAT4& Plane)
+			{
+				__m128 Dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(Plane.x), cx), _mm_mul_ps(_mm_set1_ps(Plane.y), cy)),
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(Plane.z), cz), _mm_set1_ps(Plane.w)));
+				return _mm_add_ps(Dist, r);
+			});
+
+		StoreMask(Mask, i, Count, OutVisible);
+	}
+}
+
+void Frustum::TestOBBs(const AABB& LocalBounds, const DirectX::XMMATRIX* Transforms, UINT Count, unsigned char* OutVisible) const
+{
+	const __m128 CX = _mm_set1_ps((LocalBounds.Min.x + LocalBounds.Max.x) * 0.5f);
+	const __m128 CY = _mm_set1_ps((LocalBounds.Min.y + LocalBounds.Max.y) * 0.5f);
+	const __m128 CZ = _mm_set1_ps((LocalBounds.Min.z + LocalBounds.Max.z) * 0.5f);
+	const __m128 EX = _mm_set1_ps((LocalBounds.Max.x - LocalBounds.Min.x) * 0.5f);
+	const __m128 EY = _mm_set1_ps((LocalBounds.Max.y - LocalBounds.Min.y) * 0.5f);
+	const __m128 EZ = _mm_set1_ps((LocalBounds.Max.z - LocalBounds.Min.z) * 0.5f);
+	const __m128 SignMask = _mm_set1_ps(-0.f);
+
+	UINT i = 0u;
+	for (; i + 4u <= Count; i += 4u)
+	{
+		// same trick as CPUFrustumCuller::BuildWorldBounds, transposing row n of 4 instances gives one register per coefficient of world axis n.
+		// Center[n] is the world center and HalfAxis[a][n] is component n of local axis a scaled by the extent along it
+		__m128 Center[3];
+		__m128 HalfAxis[3][3];
+		for (int Axis = 0; Axis < 3; Axis++)
+		{
+			__m128 a = Transforms[i + 0u].r[Axis];
+			__m128 b = Transforms[i + 1u].r[Axis];
+			__m128 c = Transforms[i + 2u].r[Axis];
+			__m128 d = Transforms[i + 3u].r[Axis];
+			_MM_TRANSPOSE4_PS(a, b, c, d);
+
+			Center[Axis] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, CX), _mm_mul_ps(b, CY)), _mm_add_ps(_mm_mul_ps(c, CZ), d));
+			HalfAxis[0][Axis] = _mm_mul_ps(a, EX);
+			HalfAxis[1][Axis] = _mm_mul_ps(b, EY);
+			HalfAxis[2][Axis] = _mm_mul_ps(c, EZ);
+		}
+
+		int Mask = TestPlanes4(m_Planes, [&](const DirectX::XMFLOAT4& Plane)
+			{
+				const __m128 PX = _mm_set1_ps(Plane.x);
+				const __m128 PY = _mm_set1_ps(Plane.y);
+				const __m128 PZ = _mm_set1_ps(Plane.z);
+				__m128 Sum = _mm_add_ps(_mm_add_ps(_mm_mul_ps(PX, Center[0]), _mm_mul_ps(PY, Center[1])), _mm_add_ps(_mm_mul_ps(PZ, Center[2]), _mm_set1_ps(Plane.w)));
+				for (int a = 0; a < 3; a++)
+				{
+					__m128 Proj = _mm_add_ps(_mm_add_ps(_mm_mul_ps(PX, HalfAxis[a][0]), _mm_mul_ps(PY, HalfAxis[a][1])), _mm_mul_ps(PZ, HalfAxis[a][2]));
+					Sum = _mm_add_ps(Sum, _mm_andnot_ps(SignMask, Proj));
+				}
+				return Sum;
+			});
+
+		StoreMask(Mask, i, Count, OutVisible);
+	}
+
+	for (; i < Count; i++)
+	{
+		OutVisible[i] = TestOBB(LocalBounds, Transforms[i]) ? 1u : 0u;
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include "DirectXMath.h"
+
+#include "AABB.h"
+
+typedef unsigned int UINT;
+
+/*
+*	View frustum as six normalized world space planes, extracted from a row-vector view projection matrix (Gribb/Hartmann) with
+*	D3D clip space depth in [0, 1]. Planes point inwards so a positive distance is inside. All tests are conservative: a volume is
+*	only rejected when it lies fully behind one plane, anything touching or straddling the frustum is reported visible.
+*	The batched tests take structure-of-arrays input and run 4 items at a time with SSE. Pure CPU, no device needed.
+*/
+
+class Frustum
+{
+public:
+	enum Plane
+	{
+		Left = 0,
+		Right,
+		Bottom,
+		Top,
+		Near,
+		Far,
+		PlaneCount
+	};
+
+public:
+	Frustum();
+	explicit Frustum(const DirectX::XMMATRIX& ViewProj);
+
+	void Extract(const DirectX::XMMATRIX& ViewProj);
+
+	const DirectX::XMFLOAT4* GetPlanes() const { return m_Planes; }
+	const DirectX::XMFLOAT4& GetPlane(UINT Index) const { return m_Planes[Index]; }
+	// world space corners, near plane first, in the same x, y, z order as AABB::CalcCorners. w is always 1
+	void GetCorners(DirectX::XMFLOAT4* OutCorners) const;
+
+	bool TestPoint(const DirectX::XMFLOAT3& Point) const;
+	bool TestAABB(const DirectX::XMFLOAT3& Center, const DirectX::XMFLOAT3& Extent) const;
+	// only tests the planes set in PlaneMask and clears the ones the box is fully inside of, so a hierarchy can pass the mask down and
+	// stop testing once it reaches 0
+	bool TestAABB(const DirectX::XMFLOAT3& Center, const DirectX::XMFLOAT3& Extent, UINT& PlaneMask) const;
+	bool TestSphere(const DirectX::XMFLOAT3& Center, float Radius) const;
+	// HalfAxes are the three box axes in world space, each scaled by the half size along it
+	bool TestOBB(const DirectX::XMFLOAT3& Center, const DirectX::XMFLOAT3* HalfAxes) const;
+	// Transform in the same (transposed) layout as ModelData::m_Transforms, tighter than testing the world AABB of the box
+	bool TestOBB(const AABB& LocalBounds, const DirectX::XMMATRIX& Transform) const;
+
+	// OutVisible receives 1 or 0 per item, the input arrays do not need any padding
+	void TestAABBs(const float* CenterX, const float* CenterY, const float* CenterZ, const float* ExtentX, const float* ExtentY, const float* ExtentZ,
+		UINT Count, unsigned char* OutVisible) const;
+	void TestSpheres(const float* CenterX, const float* CenterY, const float* CenterZ, const float* Radius, UINT Count, unsigned char* OutVisible) const;
+	void TestOBBs(const AABB& LocalBounds, const DirectX::XMMATRIX* Transforms, UINT Count, unsigned char* OutVisible) const;
+
+private:
+	DirectX::XMFLOAT4 m_Planes[PlaneCount];
+
+};
+
+#endif
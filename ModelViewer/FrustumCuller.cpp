@@ -3,6 +3,7 @@
 #include <cstring>
 #include <fstream>
 #include <array>
+#include <algorithm>
 
 #include "d3dcompiler.h"
 
@@ -13,6 +14,10 @@
 #include "Common.h"
 #include "ResourceManager.h"
 #include "Camera.h"
+#include "TemporalFrustumCuller.h"
+#include "LODSelector.h"
+
+static_assert(sizeof(DirectX::XMMATRIX) <= InstanceBufferManager::DEFAULT_ELEMENT_SIZE, "instance buffer capacity is capped for one transform per instance");
 
 FrustumCuller::~FrustumCuller()
 {
@@ -28,13 +33,20 @@ bool FrustumCuller::Init()
 	m_CullingShader							= ResourceManager::GetSingletonPtr()->LoadShader<ID3D11ComputeShader>(m_csFilename, "FrustumCull");
 	m_OffsetsCullingShader					= ResourceManager::GetSingletonPtr()->LoadShader<ID3D11ComputeShader>(m_csFilename, "FrustumCullOffsets");
 	m_GrassCullingShader					= ResourceManager::GetSingletonPtr()->LoadShader<ID3D11ComputeShader>(m_csFilename, "FrustumCullGrass");
+	m_GrassTileCullingShader				= ResourceManager::GetSingletonPtr()->LoadShader<ID3D11ComputeShader>(m_csFilename, "FrustumCullGrassTiles");
 	m_InstanceCountClearShader				= ResourceManager::GetSingletonPtr()->LoadShader<ID3D11ComputeShader>(m_csFilename, "ClearInstanceCount");
 	m_InstanceCountTransferShader			= ResourceManager::GetSingletonPtr()->LoadShader<ID3D11ComputeShader>(m_csFilename, "TransferInstanceCount");
 	m_GrassLODInstanceCountTransferShader	= ResourceManager::GetSingletonPtr()->LoadShader<ID3D11ComputeShader>(m_csFilename, "TransferGrassLODInstanceCount");
+	m_BatchCullingShader					= ResourceManager::GetSingletonPtr()->LoadShader<ID3D11ComputeShader>(m_csFilename, "FrustumCullBatch");
+	m_BatchArgsShader						= ResourceManager::GetSingletonPtr()->LoadShader<ID3D11ComputeShader>(m_csFilename, "BuildBatchArgs");
 
 	bool Result;
 	FALSE_IF_FAILED(CreateBuffers());
 	FALSE_IF_FAILED(CreateBufferViews());
+	FALSE_IF_FAILED(CreateModelInstanceBuffers());
+	FALSE_IF_FAILED(CreateCPUInstanceBuffers());
+	FALSE_IF_FAILED(CreateBatchInstanceBuffers());
+	FALSE_IF_FAILED(CreateClusterInstanceBuffer());
 
 	return true;
 }
@@ -44,9 +56,12 @@ void FrustumCuller::Shutdown()
 	ResourceManager::GetSingletonPtr()->UnloadShader<ID3D11ComputeShader>(m_csFilename, "FrustumCull");
 	ResourceManager::GetSingletonPtr()->UnloadShader<ID3D11ComputeShader>(m_csFilename, "FrustumCullOffsets");
 	ResourceManager::GetSingletonPtr()->UnloadShader<ID3D11ComputeShader>(m_csFilename, "FrustumCullGrass");
+	ResourceManager::GetSingletonPtr()->UnloadShader<ID3D11ComputeShader>(m_csFilename, "FrustumCullGrassTiles");
 	ResourceManager::GetSingletonPtr()->UnloadShader<ID3D11ComputeShader>(m_csFilename, "ClearInstanceCount");
 	ResourceManager::GetSingletonPtr()->UnloadShader<ID3D11ComputeShader>(m_csFilename, "TransferInstanceCount");
 	ResourceManager::GetSingletonPtr()->UnloadShader<ID3D11ComputeShader>(m_csFilename, "TransferGrassLODInstanceCount");
+	ResourceManager::GetSingletonPtr()->UnloadShader<ID3D11ComputeShader>(m_csFilename, "FrustumCullBatch");
+	ResourceManager::GetSingletonPtr()->UnloadShader<ID3D11ComputeShader>(m_csFilename, "BuildBatchArgs");
 }
 
 std::array<UINT, 2> FrustumCuller::GetInstanceCounts()
@@ -68,16 +83,33 @@ std::array<UINT, 2> FrustumCuller::GetInstanceCounts()
 	return InstanceCounts;
 }
 
-void FrustumCuller::DispatchShader(const std::vector<DirectX::XMMATRIX>& Transforms, const std::vector<DirectX::XMFLOAT4>& Corners,	const DirectX::XMMATRIX& ScaleMatrix)
+bool FrustumCuller::DispatchShader(const std::vector<DirectX::XMMATRIX>& Transforms, const std::vector<DirectX::XMFLOAT4>& Corners,	const DirectX::XMMATRIX& ScaleMatrix)
 {
 	ClearInstanceCount();
-	Graphics::GetSingletonPtr()->GetDeviceContext()->CSSetShader(m_CullingShader, nullptr, 0u);
 
-	// As each thread group will have 32 threads (as defined in shader), calculate how many thread groups we need using integer division
-	UINT ThreadGroupCount[3] = { (UINT(Transforms.size()) + 31) / 32u, 1u, 1u };
+	const UINT Count = std::min<UINT>((UINT)Transforms.size(), m_ModelInstances.GetMaxCapacity());
+	Application::GetSingletonPtr()->GetRenderStatsRef().InstancesOverBufferCapacity += Transforms.size() - Count;
 
-	UpdateBuffers(Transforms, Corners, ScaleMatrix, ThreadGroupCount, (UINT)Transforms.size());
-	DispatchShaderImpl(ThreadGroupCount);
+	if (m_ModelInstances.Reserve(Count) && !CreateModelInstanceBuffers())
+	{
+		m_ModelInstances.Invalidate();
+		return false;
+	}
+	UpdateBuffers(Transforms, Count);
+
+	// every chunk appends after the previous one, the instance count is only cleared once above
+	InstanceBufferManager::SplitIntoChunks(Count, InstanceBufferManager::MAX_DISPATCH_INSTANCES, m_Chunks);
+	for (size_t i = 0; i < m_Chunks.size(); i++)
+	{
+		Graphics::GetSingletonPtr()->GetDeviceContext()->CSSetShader(m_CullingShader, nullptr, 0u);
+
+		// As each thread group will have 32 threads (as defined in shader), calculate how many thread groups we need using integer division
+		UINT ThreadGroupCount[3] = { (m_Chunks[i].Count + 31) / 32u, 1u, 1u };
+
+		UpdateCBuffer(Corners, ScaleMatrix, ThreadGroupCount, m_Chunks[i].Count, 0u, 0u, 0.f, 0.f, 0u, m_Chunks[i].Offset);
+		DispatchShaderImpl(ThreadGroupCount, i == 0);
+	}
+	return true;
 }
 
 void FrustumCuller::DispatchShader(const std::vector<DirectX::XMFLOAT2>& Offsets, const std::vector<DirectX::XMFLOAT4>& Corners, const DirectX::XMMATRIX& ScaleMatrix)
@@ -121,8 +153,8 @@ void FrustumCuller::CullLandscape(ID3D11ShaderResourceView* ChunksOffsetsSRV, co
 	DeviceContext->CSSetShader(nullptr, nullptr, 0u);
 }
 
-void FrustumCuller::CullGrass(ID3D11ShaderResourceView* GrassOffsetsSRV, const std::vector<DirectX::XMFLOAT4>& Corners,	const UINT GrassPerChunk, const UINT VisibleChunkCount,
-	UINT PlaneDimension, float HeightDisplacement, float LODDistanceThreshold, ID3D11ShaderResourceView* Heightmap)
+void FrustumCuller::CullGrass(ID3D11ShaderResourceView* GrassOffsetsSRV, ID3D11ShaderResourceView* VisibleChunkOffsetsSRV, const std::vector<DirectX::XMFLOAT4>& Corners,
+	const UINT GrassPerChunk, const UINT VisibleChunkCount, UINT PlaneDimension, float HeightDisplacement, float LODDistanceThreshold, ID3D11ShaderResourceView* Heightmap)
 {
 	ID3D11DeviceContext* DeviceContext = Graphics::GetSingletonPtr()->GetDeviceContext();
 	const UINT InitialCount = 0u;
@@ -139,7 +171,7 @@ void FrustumCuller::CullGrass(ID3D11ShaderResourceView* GrassOffsetsSRV, const s
 
 	UpdateCBuffer(Corners, DirectX::XMMatrixIdentity(), ThreadGroupCount, VisibleChunkCount, GrassPerChunk, PlaneDimension, HeightDisplacement, LODDistanceThreshold);
 
-	ID3D11ShaderResourceView* SRVs[] = { GrassOffsetsSRV, m_CulledOffsetsSRV.Get(), Heightmap };
+	ID3D11ShaderResourceView* SRVs[] = { GrassOffsetsSRV, VisibleChunkOffsetsSRV, Heightmap };
 	DeviceContext->CSSetUnorderedAccessViews(2u, 1u, m_CulledGrassDataUAV.GetAddressOf(), &InitialCount);
 	DeviceContext->CSSetUnorderedAccessViews(3u, 1u, m_CulledGrassLODDataUAV.GetAddressOf(), &InitialCount);
 	DeviceContext->CSSetUnorderedAccessViews(4u, 1u, m_InstanceCountBufferUAV.GetAddressOf(), nullptr);
@@ -155,6 +187,316 @@ void FrustumCuller::CullGrass(ID3D11ShaderResourceView* GrassOffsetsSRV, const s
 	DeviceContext->CSSetShader(nullptr, nullptr, 0u);
 }
 
+void FrustumCuller::CullGrassTiles(ID3D11ShaderResourceView* GrassOffsetsSRV, ID3D11ShaderResourceView* VisibleChunkOffsetsSRV, ID3D11ShaderResourceView* TilesSRV, const UINT TileCount,
+	const std::vector<DirectX::XMFLOAT4>& Corners, UINT PlaneDimension, float HeightDisplacement, float LODDistanceThreshold, ID3D11ShaderResourceView* Heightmap)
+{
+	ID3D11DeviceContext* DeviceContext = Graphics::GetSingletonPtr()->GetDeviceContext();
+	const UINT InitialCount = 0u;
+
+	ClearInstanceCount();
+	DeviceContext->CSSetShader(m_GrassTileCullingShader, nullptr, 0u);
+	DeviceContext->CSSetSamplers(0u, 1u, Graphics::GetSingletonPtr()->GetSamplerState().GetAddressOf());
+
+	// one thread group per tile, wrapped into rows since a full landscape has more tiles than a dispatch dimension allows
+	const UINT MaxGroupsX = D3D11_CS_DISPATCH_MAX_THREAD_GROUPS_PER_DIMENSION;
+	const UINT DispatchX = TileCount < MaxGroupsX ? (TileCount > 0u ? TileCount : 1u) : MaxGroupsX;
+	const UINT DispatchY = (TileCount + DispatchX - 1) / DispatchX;
+	UINT ThreadGroupCount[3] = { DispatchX, DispatchY > 0u ? DispatchY : 1u, 1u };
+
+	UpdateCBuffer(Corners, DirectX::XMMatrixIdentity(), ThreadGroupCount, TileCount, 0u, PlaneDimension, HeightDisplacement, LODDistanceThreshold);
+
+	ID3D11ShaderResourceView* SRVs[] = { GrassOffsetsSRV, VisibleChunkOffsetsSRV, Heightmap };
+	DeviceContext->CSSetUnorderedAccessViews(2u, 1u, m_CulledGrassDataUAV.GetAddressOf(), &InitialCount);
+	DeviceContext->CSSetUnorderedAccessViews(3u, 1u, m_CulledGrassLODDataUAV.GetAddressOf(), &InitialCount);
+	DeviceContext->CSSetUnorderedAccessViews(4u, 1u, m_InstanceCountBufferUAV.GetAddressOf(), nullptr);
+	DeviceContext->CSSetShaderResources(1u, 3u, SRVs);
+	DeviceContext->CSSetShaderResources(7u, 1u, &TilesSRV);
+	DeviceContext->CSSetConstantBuffers(0u, 1u, m_CBuffer.GetAddressOf());
+
+	DeviceContext->Dispatch(ThreadGroupCount[0], ThreadGroupCount[1], ThreadGroupCount[2]);
+	Application::GetSingletonPtr()->GetRenderStatsRef().ComputeDispatches++;
+
+	DeviceContext->CSSetConstantBuffers(0u, 8u, NullBuffers);
+	DeviceContext->CSSetShaderResources(0u, 8u, NullSRVs);
+	DeviceContext->CSSetUnorderedAccessViews(0u, 8u, NullUAVs, nullptr);
+	DeviceContext->CSSetShader(nullptr, nullptr, 0u);
+}
+
+bool FrustumCuller::CullOnCPU(const std::vector<DirectX::XMMATRIX>& Transforms, const AABB& BBox, UINT& OutInstanceCount, TemporalFrustumCuller* Temporal, LODSelector* LODs)
+{
+	HRESULT hResult;
+	ID3D11DeviceContext* DeviceContext = Graphics::GetSingletonPtr()->GetDeviceContext();
+	D3D11_MAPPED_SUBRESOURCE MappedResource = {};
+
+	// cull against the main camera so the debug camera can inspect the culled result, same as the compute path
+	const std::shared_ptr<Camera>& MainCamera = Application::GetSingletonPtr()->GetMainCamera();
+	const std::vector<UINT>* VisibleIndices;
+	if (m_MultiViewCuller.GetViewCount() > 1u)
+	{
+		m_MultiViewCuller.Cull(Transforms.data(), (UINT)Transforms.size(), BBox);
+		VisibleIndices = &m_MultiViewCuller.GetViewIndices(m_PrimaryView);
+
+		std::vector<std::pair<std::string, UINT64>>& ViewCounts = Application::GetSingletonPtr()->GetRenderStatsRef().MultiViewInstancesVisible;
+		for (UINT v = 0u; v < m_MultiViewCuller.GetViewCount() && v < (UINT)ViewCounts.size(); v++)
+		{
+			ViewCounts[v].second += m_MultiViewCuller.GetViewIndices(v).size();
+		}
+	}
+	else if (Temporal)
+	{
+		Temporal->Cull(Transforms.data(), (UINT)Transforms.size(), BBox, MainCamera->GetViewMatrix(), MainCamera->GetProjMatrix());
+		VisibleIndices = &Temporal->GetVisibleIndices();
+
+		Application::GetSingletonPtr()->GetRenderStatsRef().TemporalTestsRun += Temporal->GetLastTestsRun();
+		Application::GetSingletonPtr()->GetRenderStatsRef().TemporalTestsSkipped += Temporal->GetLastTestsSkipped();
+	}
+	else
+	{
+		m_CPUCuller.Cull(Transforms.data(), (UINT)Transforms.size(), BBox, MainCamera->GetViewProjMatrix());
+		VisibleIndices = &m_CPUCuller.GetVisibleIndices();
+	}
+
+	if (m_bScreenSizeCulling)
+	{
+		Application::GetSingletonPtr()->GetRenderStatsRef().InstancesTooSmall += m_ScreenSizeCuller.Cull(Transforms.data(), BBox, *VisibleIndices, m_ScreenSizeIndices);
+		VisibleIndices = &m_ScreenSizeIndices;
+	}
+
+	// before the levels are picked so their ranges only cover what is uploaded
+	if ((UINT)VisibleIndices->size() > m_CPUInstances.GetMaxCapacity())
+	{
+		Application::GetSingletonPtr()->GetRenderStatsRef().InstancesOverBufferCapacity += VisibleIndices->size() - m_CPUInstances.GetMaxCapacity();
+		m_CapacityIndices.assign(VisibleIndices->begin(), VisibleIndices->begin() + m_CPUInstances.GetMaxCapacity());
+		VisibleIndices = &m_CapacityIndices;
+	}
+
+	if (LODs)
+	{
+		LODs->SetView(m_LODCameraPos, m_LODPixelScale, m_LODPixelError, m_LODHysteresis);
+		LODs->Select(Transforms.data(), (UINT)Transforms.size(), BBox, *VisibleIndices, m_LODIndices);
+		VisibleIndices = &m_LODIndices;
+
+		for (UINT l = 0u; l < LODs->GetLevelCount(); l++)
+		{
+			Application::GetSingletonPtr()->GetRenderStatsRef().LODInstances[l] += LODs->GetLevelInstanceCount(l);
+		}
+	}
+
+	m_CPUVisibleTransforms.clear();
+	for (UINT i : *VisibleIndices)
+	{
+		m_CPUVisibleTransforms.push_back(Transforms[i]);
+	}
+	m_CPUInstanceCount = (UINT)m_CPUVisibleTransforms.size();
+	OutInstanceCount = m_CPUInstanceCount;
+
+	if (m_CPUInstanceCount == 0u)
+		return true;
+
+	if (m_CPUInstances.Reserve(m_CPUInstanceCount) && !CreateCPUInstanceBuffers())
+	{
+		m_CPUInstances.Invalidate();
+		m_CPUInstanceCount = 0u;
+		OutInstanceCount = 0u;
+		return false;
+	}
+
+	ASSERT_NOT_FAILED(DeviceContext->Map(m_CPUCulledTransformsBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0u, &MappedResource));
+	memcpy(MappedResource.pData, m_CPUVisibleTransforms.data(), sizeof(DirectX::XMMATRIX) * m_CPUInstanceCount);
+	DeviceContext->Unmap(m_CPUCulledTransformsBuffer.Get(), 0u);
+
+	return true;
+}
+
+void FrustumCuller::SetScreenSizeCulling(bool bEnable, float MinPixelRadius)
+{
+	const std::shared_ptr<Camera>& MainCamera = Application::GetSingletonPtr()->GetMainCamera();
+	const float ViewportHeight = (float)Graphics::GetSingletonPtr()->GetRenderTargetDimensions().second;
+
+	m_bScreenSizeCulling = bEnable;
+	m_ScreenSizeCuller.SetView(MainCamera->GetPosition(), ScreenSizeCuller::ComputePixelScale(MainCamera->GetProjMatrix(), ViewportHeight), MinPixelRadius);
+}
+
+void FrustumCuller::SetLODSelection(float PixelError, float Hysteresis)
+{
+	const std::shared_ptr<Camera>& MainCamera = Application::GetSingletonPtr()->GetMainCamera();
+	const float ViewportHeight = (float)Graphics::GetSingletonPtr()->GetRenderTargetDimensions().second;
+
+	m_LODCameraPos = MainCamera->GetPosition();
+	m_LODPixelScale = ScreenSizeCuller::ComputePixelScale(MainCamera->GetProjMatrix(), ViewportHeight);
+	m_LODPixelError = PixelError;
+	m_LODHysteresis = Hysteresis;
+}
+
+void FrustumCuller::SetCullingViews(const std::vector<DirectX::XMMATRIX>& ViewProjs, UINT PrimaryView)
+{
+	assert(ViewProjs.empty() || PrimaryView < ViewProjs.size());
+
+	m_MultiViewCuller.SetViews(ViewProjs.data(), (UINT)ViewProjs.size());
+	m_PrimaryView = PrimaryView;
+}
+
+bool FrustumCuller::DispatchBatch(CullingBatch& Batch, bool bValidate)
+{
+	if (Batch.IsEmpty())
+		return true;
+
+	// the models and draws buffers are created at MAX_BATCH_MODELS and MAX_BATCH_DRAWS and never grow
+	if (Batch.GetModelCount() > MAX_BATCH_MODELS || Batch.GetDrawCount() > MAX_BATCH_DRAWS)
+		return false;
+
+	// the per model ranges cover every instance, a batch can not be cut short like a single model
+	if (Batch.GetInstanceCount() > m_BatchInstances.GetMaxCapacity())
+		return false;
+
+	if (m_BatchInstances.Reserve(Batch.GetInstanceCount()) && !CreateBatchInstanceBuffers())
+	{
+		m_BatchInstances.Invalidate();
+		return false;
+	}
+
+	HRESULT hResult;
+	ID3D11DeviceContext* DeviceContext = Graphics::GetSingletonPtr()->GetDeviceContext();
+	D3D11_MAPPED_SUBRESOURCE MappedResource = {};
+	const UINT Zeros[4] = { 0u, 0u, 0u, 0u };
+
+	ASSERT_NOT_FAILED(DeviceContext->Map(m_BatchTransformsBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0u, &MappedResource));
+	memcpy(MappedResource.pData, Batch.GetTransforms().data(), sizeof(DirectX::XMMATRIX) * Batch.GetInstanceCount());
+	DeviceContext->Unmap(m_BatchTransformsBuffer.Get(), 0u);
+
+	ASSERT_NOT_FAILED(DeviceContext->Map(m_BatchModelIDsBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0u, &MappedResource));
+	memcpy(MappedResource.pData, Batch.GetModelIDs().data(), sizeof(UINT) * Batch.GetInstanceCount());
+	DeviceContext->Unmap(m_BatchModelIDsBuffer.Get(), 0u);
+
+	ASSERT_NOT_FAILED(DeviceContext->Map(m_BatchModelsBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0u, &MappedResource));
+	memcpy(MappedResource.pData, Batch.GetModels().data(), sizeof(CullingBatch::ModelEntry) * Batch.GetModelCount());
+	DeviceContext->Unmap(m_BatchModelsBuffer.Get(), 0u);
+
+	ASSERT_NOT_FAILED(DeviceContext->Map(m_BatchDrawsBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0u, &MappedResource));
+	memcpy(MappedResource.pData, Batch.GetDraws().data(), sizeof(CullingBatch::DrawEntry) * Batch.GetDrawCount());
+	DeviceContext->Unmap(m_BatchDrawsBuffer.Get(), 0u);
+
+	DeviceContext->ClearUnorderedAccessViewUint(m_BatchInstanceCountsUAV.Get(), Zeros);
+
+	ID3D11ShaderResourceView* CullSRVs[] = { m_BatchModelIDsSRV.Get(), m_BatchModelsSRV.Get() };
+	ID3D11UnorderedAccessView* CullUAVs[] = { m_BatchCulledTransformsUAV.Get(), m_BatchInstanceCountsUAV.Get() };
+	DeviceContext->CSSetShader(m_BatchCullingShader, nullptr, 0u);
+	DeviceContext->CSSetShaderResources(0u, 1u, m_BatchTransformsSRV.GetAddressOf());
+	DeviceContext->CSSetShaderResources(4u, 2u, CullSRVs);
+	DeviceContext->CSSetUnorderedAccessViews(6u, 2u, CullUAVs, nullptr);
+	DeviceContext->CSSetConstantBuffers(0u, 1u, m_CBuffer.GetAddressOf());
+
+	// the per model counters keep counting across chunks so ranges stay the same no matter how the work is split
+	InstanceBufferManager::SplitIntoChunks(Batch.GetInstanceCount(), InstanceBufferManager::MAX_DISPATCH_INSTANCES, m_Chunks);
+	for (const InstanceBufferManager::Chunk& Chunk : m_Chunks)
+	{
+		UINT ThreadGroupCount[3] = { (Chunk.Count + 31) / 32u, 1u, 1u };
+		UpdateCBuffer({}, DirectX::XMMatrixIdentity(), ThreadGroupCount, Chunk.Count, 0u, 0u, 0.f, 0.f, Batch.GetDrawCount(), Chunk.Offset);
+
+		DeviceContext->Dispatch(ThreadGroupCount[0], ThreadGroupCount[1], ThreadGroupCount[2]);
+		Application::GetSingletonPtr()->GetRenderStatsRef().ComputeDispatches++;
+	}
+
+	ID3D11ShaderResourceView* ArgsSRVs[] = { m_BatchModelsSRV.Get(), m_BatchDrawsSRV.Get() };
+	DeviceContext->CSSetShader(m_BatchArgsShader, nullptr, 0u);
+	DeviceContext->CSSetShaderResources(5u, 2u, ArgsSRVs);
+	DeviceContext->CSSetUnorderedAccessViews(5u, 1u, m_BatchArgsUAV.GetAddressOf(), nullptr);
+
+	DeviceContext->Dispatch((Batch.GetDrawCount() + 63) / 64u, 1u, 1u);
+	Application::GetSingletonPtr()->GetRenderStatsRef().ComputeDispatches++;
+
+	DeviceContext->CSSetConstantBuffers(0u, 8u, NullBuffers);
+	DeviceContext->CSSetShaderResources(0u, 8u, NullSRVs);
+	DeviceContext->CSSetUnorderedAccessViews(0u, 8u, NullUAVs, nullptr);
+	DeviceContext->CSSetShader(nullptr, nullptr, 0u);
+
+	BatchReadback& Readback = m_BatchReadbacks[m_BatchFrame % BATCH_READBACK_LATENCY];
+	DeviceContext->CopyResource(Readback.StagingBuffer.Get(), m_BatchInstanceCountsBuffer.Get());
+	Readback.ModelNames = Batch.GetModelNames();
+	Readback.ReferenceCounts.clear();
+	if (bValidate)
+	{
+		Batch.CullReference(Application::GetSingletonPtr()->GetMainCamera()->GetViewProjMatrix(), m_BatchReferenceTransforms, m_BatchReferenceRanges,
+			m_bScreenSizeCulling ? &m_ScreenSizeCuller : nullptr);
+		for (const CullingBatch::InstanceRange& Range : m_BatchReferenceRanges)
+			Readback.ReferenceCounts.push_back(Range.Count);
+	}
+	Readback.bPending = true;
+	m_BatchFrame++;
+
+	ReadBackBatchCounts();
+	return true;
+}
+
+void FrustumCuller::SetInstanceOffset(UINT InstanceOffset)
+{
+	HRESULT hResult;
+	ID3D11DeviceContext* DeviceContext = Graphics::GetSingletonPtr()->GetDeviceContext();
+	D3D11_MAPPED_SUBRESOURCE MappedResource = {};
+
+	ASSERT_NOT_FAILED(DeviceContext->Map(m_InstanceOffsetCBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0u, &MappedResource));
+	InstanceOffsetBufferData* Data = (InstanceOffsetBufferData*)MappedResource.pData;
+	Data->InstanceOffset = InstanceOffset;
+	DeviceContext->Unmap(m_InstanceOffsetCBuffer.Get(), 0u);
+
+	DeviceContext->VSSetConstantBuffers(2u, 1u, m_InstanceOffsetCBuffer.GetAddressOf());
+}
+
+UINT FrustumCuller::SetClusterInstances(const std::vector<UINT>& Instances)
+{
+	HRESULT hResult;
+	ID3D11DeviceContext* DeviceContext = Graphics::GetSingletonPtr()->GetDeviceContext();
+	D3D11_MAPPED_SUBRESOURCE MappedResource = {};
+
+	if (Instances.empty())
+		return 0u;
+
+	if (m_ClusterInstances.Reserve((UINT)Instances.size()) && !CreateClusterInstanceBuffer())
+	{
+		m_ClusterInstances.Invalidate();
+		return 0u;
+	}
+
+	const UINT Count = std::min<UINT>((UINT)Instances.size(), m_ClusterInstances.GetCapacity());
+	Application::GetSingletonPtr()->GetRenderStatsRef().InstancesOverBufferCapacity += Instances.size() - Count;
+	ASSERT_NOT_FAILED(DeviceContext->Map(m_ClusterInstanceBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0u, &MappedResource));
+	memcpy(MappedResource.pData, Instances.data(), sizeof(UINT) * Count);
+	DeviceContext->Unmap(m_ClusterInstanceBuffer.Get(), 0u);
+
+	const UINT Stride = sizeof(UINT);
+	const UINT Offset = 0u;
+	DeviceContext->IASetVertexBuffers(1u, 1u, m_ClusterInstanceBuffer.GetAddressOf(), &Stride, &Offset);
+
+	return Count;
+}
+
+void FrustumCuller::ReadBackBatchCounts()
+{
+	ID3D11DeviceContext* DeviceContext = Graphics::GetSingletonPtr()->GetDeviceContext();
+	D3D11_MAPPED_SUBRESOURCE MappedResource = {};
+
+	// the oldest copy in the ring, written BATCH_READBACK_LATENCY - 1 frames ago
+	BatchReadback& Readback = m_BatchReadbacks[m_BatchFrame % BATCH_READBACK_LATENCY];
+	if (!Readback.bPending)
+		return;
+
+	if (DeviceContext->Map(Readback.StagingBuffer.Get(), 0u, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &MappedResource) != S_OK)
+		return;
+
+	const UINT* Counts = (const UINT*)MappedResource.pData;
+	m_BatchInstanceCounts.clear();
+	for (size_t i = 0; i < Readback.ModelNames.size(); i++)
+	{
+		m_BatchInstanceCounts.emplace_back(Readback.ModelNames[i], (UINT64)Counts[i]);
+
+		if (i < Readback.ReferenceCounts.size() && Readback.ReferenceCounts[i] != Counts[i])
+			m_BatchValidationMismatches++;
+	}
+	DeviceContext->Unmap(Readback.StagingBuffer.Get(), 0u);
+
+	Readback.bPending = false;
+}
+
 void FrustumCuller::ClearInstanceCount()
 {
 	Graphics::GetSingletonPtr()->GetDeviceContext()->CSSetShader(m_InstanceCountClearShader, nullptr, 0u);
@@ -200,23 +542,6 @@ bool FrustumCuller::CreateBuffers()
 	D3D11_BUFFER_DESC Desc = {};
 	ID3D11Device* Device = Graphics::GetSingletonPtr()->GetDevice();
 
-	Desc.Usage = D3D11_USAGE_DYNAMIC;
-	Desc.ByteWidth = (UINT)(sizeof(DirectX::XMMATRIX) * MAX_INSTANCE_COUNT);
-	Desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-	Desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-	Desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
-	Desc.StructureByteStride = sizeof(DirectX::XMMATRIX);
-
-	HFALSE_IF_FAILED(Device->CreateBuffer(&Desc, nullptr, &m_TransformsBuffer));
-	NAME_D3D_RESOURCE(m_TransformsBuffer, "Frustum culler transforms buffer");
-
-	Desc.CPUAccessFlags = 0;
-	Desc.Usage = D3D11_USAGE_DEFAULT;
-	Desc.BindFlags = D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_SHADER_RESOURCE;
-
-	HFALSE_IF_FAILED(Device->CreateBuffer(&Desc, nullptr, &m_CulledTransformsBuffer));
-	NAME_D3D_RESOURCE(m_CulledTransformsBuffer, "Frustum culler culled transforms buffer");
-
 	Desc.Usage = D3D11_USAGE_DYNAMIC;
 	Desc.ByteWidth = (UINT)(sizeof(DirectX::XMFLOAT2) * MAX_GRASS_PER_CHUNK);
 	Desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
@@ -274,6 +599,61 @@ bool FrustumCuller::CreateBuffers()
 	HFALSE_IF_FAILED(Device->CreateBuffer(&InstanceBufferDesc, nullptr, &m_InstanceCountBuffer));
 	NAME_D3D_RESOURCE(m_InstanceCountBuffer, "Frustum culler instance count buffer");
 
+	Desc = {};
+	Desc.Usage = D3D11_USAGE_DYNAMIC;
+	Desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	Desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	Desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	Desc.ByteWidth = (UINT)(sizeof(CullingBatch::ModelEntry) * MAX_BATCH_MODELS);
+	Desc.StructureByteStride = sizeof(CullingBatch::ModelEntry);
+
+	HFALSE_IF_FAILED(Device->CreateBuffer(&Desc, nullptr, &m_BatchModelsBuffer));
+	NAME_D3D_RESOURCE(m_BatchModelsBuffer, "Frustum culler batch models buffer");
+
+	Desc.ByteWidth = (UINT)(sizeof(CullingBatch::DrawEntry) * MAX_BATCH_DRAWS);
+	Desc.StructureByteStride = sizeof(CullingBatch::DrawEntry);
+
+	HFALSE_IF_FAILED(Device->CreateBuffer(&Desc, nullptr, &m_BatchDrawsBuffer));
+	NAME_D3D_RESOURCE(m_BatchDrawsBuffer, "Frustum culler batch draws buffer");
+
+	Desc.Usage = D3D11_USAGE_DEFAULT;
+	Desc.CPUAccessFlags = 0;
+	Desc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
+	Desc.ByteWidth = (UINT)(sizeof(UINT) * MAX_BATCH_MODELS);
+	Desc.StructureByteStride = sizeof(UINT);
+
+	HFALSE_IF_FAILED(Device->CreateBuffer(&Desc, nullptr, &m_BatchInstanceCountsBuffer));
+	NAME_D3D_RESOURCE(m_BatchInstanceCountsBuffer, "Frustum culler batch instance counts buffer");
+
+	Desc = {};
+	Desc.Usage = D3D11_USAGE_DEFAULT;
+	Desc.ByteWidth = (UINT)(sizeof(UINT) * 5 * MAX_BATCH_DRAWS);
+	Desc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
+	Desc.MiscFlags = D3D11_RESOURCE_MISC_DRAWINDIRECT_ARGS | D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
+
+	HFALSE_IF_FAILED(Device->CreateBuffer(&Desc, nullptr, &m_BatchArgsBuffer));
+	NAME_D3D_RESOURCE(m_BatchArgsBuffer, "Frustum culler batch args buffer");
+
+	Desc = {};
+	Desc.Usage = D3D11_USAGE_STAGING;
+	Desc.ByteWidth = (UINT)(sizeof(UINT) * MAX_BATCH_MODELS);
+	Desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+	for (UINT i = 0u; i < BATCH_READBACK_LATENCY; i++)
+	{
+		HFALSE_IF_FAILED(Device->CreateBuffer(&Desc, nullptr, &m_BatchReadbacks[i].StagingBuffer));
+		NAME_D3D_RESOURCE(m_BatchReadbacks[i].StagingBuffer, "Frustum culler batch readback buffer");
+	}
+
+	Desc = {};
+	Desc.Usage = D3D11_USAGE_DYNAMIC;
+	Desc.ByteWidth = sizeof(InstanceOffsetBufferData);
+	Desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	Desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+	HFALSE_IF_FAILED(Device->CreateBuffer(&Desc, nullptr, &m_InstanceOffsetCBuffer));
+	NAME_D3D_RESOURCE(m_InstanceOffsetCBuffer, "Frustum culler instance offset constant buffer");
+
 	return true;
 }
 
@@ -288,9 +668,6 @@ bool FrustumCuller::CreateBufferViews()
 	uavDesc.Buffer.NumElements = (UINT)MAX_INSTANCE_COUNT;
 	uavDesc.Buffer.Flags = D3D11_BUFFER_UAV_FLAG_APPEND;
 
-	HFALSE_IF_FAILED(Device->CreateUnorderedAccessView(m_CulledTransformsBuffer.Get(), &uavDesc, &m_CulledTransformsUAV));
-	NAME_D3D_RESOURCE(m_CulledTransformsUAV, "Frustum culler culled transforms buffer UAV");
-
 	HFALSE_IF_FAILED(Device->CreateUnorderedAccessView(m_CulledOffsetsBuffer.Get(), &uavDesc, &m_CulledOffsetsUAV));
 	NAME_D3D_RESOURCE(m_CulledOffsetsUAV, "Frustum culler culled offsets buffer UAV");
 
@@ -307,12 +684,6 @@ bool FrustumCuller::CreateBufferViews()
 	SRVDesc.Format = DXGI_FORMAT_UNKNOWN;
 	SRVDesc.Buffer.NumElements = (UINT)MAX_INSTANCE_COUNT;
 
-	HFALSE_IF_FAILED(Device->CreateShaderResourceView(m_TransformsBuffer.Get(), &SRVDesc, &m_TransformsSRV));
-	NAME_D3D_RESOURCE(m_TransformsSRV, "Frustum culler transforms buffer SRV");
-
-	HFALSE_IF_FAILED(Device->CreateShaderResourceView(m_CulledTransformsBuffer.Get(), &SRVDesc, &m_CulledTransformsSRV));
-	NAME_D3D_RESOURCE(m_CulledTransformsSRV, "Frustum culler culled transforms buffer SRV");
-
 	HFALSE_IF_FAILED(Device->CreateShaderResourceView(m_CulledOffsetsBuffer.Get(), &SRVDesc, &m_CulledOffsetsSRV));
 	NAME_D3D_RESOURCE(m_CulledOffsetsSRV, "Frustum culler culled offsets buffer SRV");
 
@@ -337,23 +708,204 @@ bool FrustumCuller::CreateBufferViews()
 	HFALSE_IF_FAILED(Device->CreateUnorderedAccessView(m_InstanceCountBuffer.Get(), &uavDesc, &m_InstanceCountBufferUAV));
 	NAME_D3D_RESOURCE(m_InstanceCountBufferUAV, "Frustum culler instance count buffer UAV");
 
+	uavDesc.Buffer.NumElements = (UINT)MAX_BATCH_MODELS;
+
+	HFALSE_IF_FAILED(Device->CreateUnorderedAccessView(m_BatchInstanceCountsBuffer.Get(), &uavDesc, &m_BatchInstanceCountsUAV));
+	NAME_D3D_RESOURCE(m_BatchInstanceCountsUAV, "Frustum culler batch instance counts buffer UAV");
+
+	uavDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+	uavDesc.Buffer.NumElements = 5 * MAX_BATCH_DRAWS;
+	uavDesc.Buffer.Flags = D3D11_BUFFER_UAV_FLAG_RAW;
+
+	HFALSE_IF_FAILED(Device->CreateUnorderedAccessView(m_BatchArgsBuffer.Get(), &uavDesc, &m_BatchArgsUAV));
+	NAME_D3D_RESOURCE(m_BatchArgsUAV, "Frustum culler batch args buffer UAV");
+
+	SRVDesc.Buffer.NumElements = (UINT)MAX_BATCH_MODELS;
+
+	HFALSE_IF_FAILED(Device->CreateShaderResourceView(m_BatchModelsBuffer.Get(), &SRVDesc, &m_BatchModelsSRV));
+	NAME_D3D_RESOURCE(m_BatchModelsSRV, "Frustum culler batch models buffer SRV");
+
+	SRVDesc.Buffer.NumElements = (UINT)MAX_BATCH_DRAWS;
+
+	HFALSE_IF_FAILED(Device->CreateShaderResourceView(m_BatchDrawsBuffer.Get(), &SRVDesc, &m_BatchDrawsSRV));
+	NAME_D3D_RESOURCE(m_BatchDrawsSRV, "Frustum culler batch draws buffer SRV");
+
 	return true;
 }
 
-void FrustumCuller::UpdateBuffers(const std::vector<DirectX::XMMATRIX>& Transforms, const std::vector<DirectX::XMFLOAT4>& Corners,	const DirectX::XMMATRIX& ScaleMatrix,
-	UINT* ThreadGroupCount, UINT SentInstanceCount, UINT GrassPerChunk, UINT PlaneDimension, float HeightDisplacement)
+bool FrustumCuller::CreateModelInstanceBuffers()
 {
-	assert(Transforms.size() <= MAX_INSTANCE_COUNT);
+	HRESULT hResult;
+	D3D11_BUFFER_DESC Desc = {};
+	ID3D11Device* Device = Graphics::GetSingletonPtr()->GetDevice();
+	const UINT Capacity = m_ModelInstances.GetCapacity();
+
+	Desc.Usage = D3D11_USAGE_DYNAMIC;
+	Desc.ByteWidth = (UINT)(sizeof(DirectX::XMMATRIX) * Capacity);
+	Desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	Desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	Desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	Desc.StructureByteStride = sizeof(DirectX::XMMATRIX);
+
+	HFALSE_IF_FAILED(Device->CreateBuffer(&Desc, nullptr, &m_TransformsBuffer));
+	NAME_D3D_RESOURCE(m_TransformsBuffer, "Frustum culler transforms buffer");
+
+	Desc.CPUAccessFlags = 0;
+	Desc.Usage = D3D11_USAGE_DEFAULT;
+	Desc.BindFlags = D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_SHADER_RESOURCE;
+
+	HFALSE_IF_FAILED(Device->CreateBuffer(&Desc, nullptr, &m_CulledTransformsBuffer));
+	NAME_D3D_RESOURCE(m_CulledTransformsBuffer, "Frustum culler culled transforms buffer");
+
+	D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+	uavDesc.Format = DXGI_FORMAT_UNKNOWN;
+	uavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+	uavDesc.Buffer.NumElements = Capacity;
+	uavDesc.Buffer.Flags = D3D11_BUFFER_UAV_FLAG_APPEND;
+
+	HFALSE_IF_FAILED(Device->CreateUnorderedAccessView(m_CulledTransformsBuffer.Get(), &uavDesc, &m_CulledTransformsUAV));
+	NAME_D3D_RESOURCE(m_CulledTransformsUAV, "Frustum culler culled transforms buffer UAV");
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC SRVDesc = {};
+	SRVDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+	SRVDesc.Format = DXGI_FORMAT_UNKNOWN;
+	SRVDesc.Buffer.NumElements = Capacity;
+
+	HFALSE_IF_FAILED(Device->CreateShaderResourceView(m_TransformsBuffer.Get(), &SRVDesc, &m_TransformsSRV));
+	NAME_D3D_RESOURCE(m_TransformsSRV, "Frustum culler transforms buffer SRV");
+
+	HFALSE_IF_FAILED(Device->CreateShaderResourceView(m_CulledTransformsBuffer.Get(), &SRVDesc, &m_CulledTransformsSRV));
+	NAME_D3D_RESOURCE(m_CulledTransformsSRV, "Frustum culler culled transforms buffer SRV");
+
+	return true;
+}
+
+bool FrustumCuller::CreateCPUInstanceBuffers()
+{
+	HRESULT hResult;
+	D3D11_BUFFER_DESC Desc = {};
+	ID3D11Device* Device = Graphics::GetSingletonPtr()->GetDevice();
+	const UINT Capacity = m_CPUInstances.GetCapacity();
+
+	Desc.Usage = D3D11_USAGE_DYNAMIC;
+	Desc.ByteWidth = (UINT)(sizeof(DirectX::XMMATRIX) * Capacity);
+	Desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	Desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	Desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	Desc.StructureByteStride = sizeof(DirectX::XMMATRIX);
+
+	HFALSE_IF_FAILED(Device->CreateBuffer(&Desc, nullptr, &m_CPUCulledTransformsBuffer));
+	NAME_D3D_RESOURCE(m_CPUCulledTransformsBuffer, "Frustum culler CPU culled transforms buffer");
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC SRVDesc = {};
+	SRVDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+	SRVDesc.Format = DXGI_FORMAT_UNKNOWN;
+	SRVDesc.Buffer.NumElements = Capacity;
+
+	HFALSE_IF_FAILED(Device->CreateShaderResourceView(m_CPUCulledTransformsBuffer.Get(), &SRVDesc, &m_CPUCulledTransformsSRV));
+	NAME_D3D_RESOURCE(m_CPUCulledTransformsSRV, "Frustum culler CPU culled transforms buffer SRV");
+
+	return true;
+}
+
+bool FrustumCuller::CreateClusterInstanceBuffer()
+{
+	HRESULT hResult;
+	D3D11_BUFFER_DESC Desc = {};
+	ID3D11Device* Device = Graphics::GetSingletonPtr()->GetDevice();
+
+	Desc.Usage = D3D11_USAGE_DYNAMIC;
+	Desc.ByteWidth = (UINT)(sizeof(UINT) * m_ClusterInstances.GetCapacity());
+	Desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	Desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+	HFALSE_IF_FAILED(Device->CreateBuffer(&Desc, nullptr, &m_ClusterInstanceBuffer));
+	NAME_D3D_RESOURCE(m_ClusterInstanceBuffer, "Frustum culler cluster instance buffer");
+
+	return true;
+}
+
+bool FrustumCuller::CreateBatchInstanceBuffers()
+{
+	HRESULT hResult;
+	D3D11_BUFFER_DESC Desc = {};
+	ID3D11Device* Device = Graphics::GetSingletonPtr()->GetDevice();
+	const UINT Capacity = m_BatchInstances.GetCapacity();
+
+	Desc.Usage = D3D11_USAGE_DYNAMIC;
+	Desc.ByteWidth = (UINT)(sizeof(DirectX::XMMATRIX) * Capacity);
+	Desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	Desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	Desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	Desc.StructureByteStride = sizeof(DirectX::XMMATRIX);
+
+	HFALSE_IF_FAILED(Device->CreateBuffer(&Desc, nullptr, &m_BatchTransformsBuffer));
+	NAME_D3D_RESOURCE(m_BatchTransformsBuffer, "Frustum culler batch transforms buffer");
+
+	Desc.ByteWidth = (UINT)(sizeof(UINT) * Capacity);
+	Desc.StructureByteStride = sizeof(UINT);
+
+	HFALSE_IF_FAILED(Device->CreateBuffer(&Desc, nullptr, &m_BatchModelIDsBuffer));
+	NAME_D3D_RESOURCE(m_BatchModelIDsBuffer, "Frustum culler batch model IDs buffer");
+
+	Desc.Usage = D3D11_USAGE_DEFAULT;
+	Desc.CPUAccessFlags = 0;
+	Desc.BindFlags = D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_SHADER_RESOURCE;
+	Desc.ByteWidth = (UINT)(sizeof(DirectX::XMMATRIX) * Capacity);
+	Desc.StructureByteStride = sizeof(DirectX::XMMATRIX);
+
+	HFALSE_IF_FAILED(Device->CreateBuffer(&Desc, nullptr, &m_BatchCulledTransformsBuffer));
+	NAME_D3D_RESOURCE(m_BatchCulledTransformsBuffer, "Frustum culler batch culled transforms buffer");
+
+	D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+	uavDesc.Format = DXGI_FORMAT_UNKNOWN;
+	uavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+	uavDesc.Buffer.NumElements = Capacity;
+
+	HFALSE_IF_FAILED(Device->CreateUnorderedAccessView(m_BatchCulledTransformsBuffer.Get(), &uavDesc, &m_BatchCulledTransformsUAV));
+	NAME_D3D_RESOURCE(m_BatchCulledTransformsUAV, "Frustum culler batch culled transforms buffer UAV");
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC SRVDesc = {};
+	SRVDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+	SRVDesc.Format = DXGI_FORMAT_UNKNOWN;
+	SRVDesc.Buffer.NumElements = Capacity;
+
+	HFALSE_IF_FAILED(Device->CreateShaderResourceView(m_BatchTransformsBuffer.Get(), &SRVDesc, &m_BatchTransformsSRV));
+	NAME_D3D_RESOURCE(m_BatchTransformsSRV, "Frustum culler batch transforms buffer SRV");
+
+	HFALSE_IF_FAILED(Device->CreateShaderResourceView(m_BatchModelIDsBuffer.Get(), &SRVDesc, &m_BatchModelIDsSRV));
+	NAME_D3D_RESOURCE(m_BatchModelIDsSRV, "Frustum culler batch model IDs buffer SRV");
+
+	HFALSE_IF_FAILED(Device->CreateShaderResourceView(m_BatchCulledTransformsBuffer.Get(), &SRVDesc, &m_BatchCulledTransformsSRV));
+	NAME_D3D_RESOURCE(m_BatchCulledTransformsSRV, "Frustum culler batch culled transforms buffer SRV");
+
+	return true;
+}
+
+UINT FrustumCuller::GetInstanceBufferCapacity() const
+{
+	return m_ModelInstances.GetCapacity() + m_CPUInstances.GetCapacity() + m_BatchInstances.GetCapacity();
+}
+
+UINT FrustumCuller::GetInstanceBufferHighWaterMark() const
+{
+	UINT HighWaterMark = m_ModelInstances.GetHighWaterMark();
+	HighWaterMark = m_CPUInstances.GetHighWaterMark() > HighWaterMark ? m_CPUInstances.GetHighWaterMark() : HighWaterMark;
+	HighWaterMark = m_BatchInstances.GetHighWaterMark() > HighWaterMark ? m_BatchInstances.GetHighWaterMark() : HighWaterMark;
+	return HighWaterMark;
+}
+
+void FrustumCuller::UpdateBuffers(const std::vector<DirectX::XMMATRIX>& Transforms, UINT Count)
+{
+	assert(Count <= Transforms.size() && Count <= m_ModelInstances.GetCapacity());
 
 	HRESULT hResult;
 	ID3D11DeviceContext* DeviceContext = Graphics::GetSingletonPtr()->GetDeviceContext();
 	D3D11_MAPPED_SUBRESOURCE MappedResource = {};
 
 	ASSERT_NOT_FAILED(DeviceContext->Map(m_TransformsBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0u, &MappedResource));
-	memcpy(MappedResource.pData, Transforms.data(), sizeof(DirectX::XMMATRIX) * Transforms.size());
+	memcpy(MappedResource.pData, Transforms.data(), sizeof(DirectX::XMMATRIX) * Count);
 	DeviceContext->Unmap(m_TransformsBuffer.Get(), 0u);
-
-	UpdateCBuffer(Corners, ScaleMatrix, ThreadGroupCount, SentInstanceCount, GrassPerChunk, PlaneDimension, HeightDisplacement);
 }
 
 void FrustumCuller::UpdateBuffers(const std::vector<DirectX::XMFLOAT2>& Offsets, const std::vector<DirectX::XMFLOAT4>& Corners,	const DirectX::XMMATRIX& ScaleMatrix,
@@ -373,7 +925,7 @@ void FrustumCuller::UpdateBuffers(const std::vector<DirectX::XMFLOAT2>& Offsets,
 }
 
 void FrustumCuller::UpdateCBuffer(const std::vector<DirectX::XMFLOAT4>& Corners,const DirectX::XMMATRIX& ScaleMatrix, UINT* ThreadGroupCount, UINT SentInstanceCount, UINT GrassPerChunk,
-	UINT PlaneDimension, float HeightDisplacement, float LODDistanceThreshold)
+	UINT PlaneDimension, float HeightDisplacement, float LODDistanceThreshold, UINT BatchDrawCount, UINT BaseInstance)
 {
 	HRESULT hResult;
 	CBufferData* CBufferDataPtr;
@@ -382,7 +934,7 @@ void FrustumCuller::UpdateCBuffer(const std::vector<DirectX::XMFLOAT4>& Corners,
 	
 	ASSERT_NOT_FAILED(DeviceContext->Map(m_CBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0u, &MappedResource));
 	CBufferDataPtr = (CBufferData*)MappedResource.pData;
-	memcpy(CBufferDataPtr->Corners, Corners.data(), sizeof(DirectX::XMFLOAT4) * 8);
+	memcpy(CBufferDataPtr->Corners, Corners.data(), sizeof(DirectX::XMFLOAT4) * std::min<size_t>(Corners.size(), 8));
 	memcpy(CBufferDataPtr->ThreadGroupCount, ThreadGroupCount, sizeof(UINT) * 3);
 	CBufferDataPtr->ViewProj = DirectX::XMMatrixTranspose(Application::GetSingletonPtr()->GetMainCamera()->GetViewProjMatrix());
 	CBufferDataPtr->ScaleMatrix = DirectX::XMMatrixTranspose(ScaleMatrix);
@@ -393,13 +945,20 @@ void FrustumCuller::UpdateCBuffer(const std::vector<DirectX::XMFLOAT4>& Corners,
 	CBufferDataPtr->LODDistanceThreshold = LODDistanceThreshold;
 	CBufferDataPtr->CameraPos = Application::GetSingletonPtr()->GetMainCamera()->GetPosition();
 	CBufferDataPtr->Padding = {};
+	memcpy(CBufferDataPtr->FrustumPlanes, Frustum(Application::GetSingletonPtr()->GetMainCamera()->GetViewProjMatrix()).GetPlanes(), sizeof(CBufferDataPtr->FrustumPlanes));
+	CBufferDataPtr->BatchDrawCount = BatchDrawCount;
+	CBufferDataPtr->BaseInstance = BaseInstance;
+	// a threshold of 0 turns the shader side test off
+	CBufferDataPtr->MinPixelRadius = m_bScreenSizeCulling ? m_ScreenSizeCuller.GetMinPixelRadius() : 0.f;
+	CBufferDataPtr->PixelScale = m_ScreenSizeCuller.GetPixelScale();
 	DeviceContext->Unmap(m_CBuffer.Get(), 0u);
 }
 
-void FrustumCuller::DispatchShaderImpl(UINT* ThreadGroupCount)
+void FrustumCuller::DispatchShaderImpl(UINT* ThreadGroupCount, bool bResetAppendCount)
 {	
 	ID3D11DeviceContext* DeviceContext = Graphics::GetSingletonPtr()->GetDeviceContext();
-	const UINT InitialCount = 0u;
+	// -1 keeps the hidden append counter where the previous dispatch left it
+	const UINT InitialCount = bResetAppendCount ? 0u : (UINT)-1;
 
 	DeviceContext->CSSetUnorderedAccessViews(0u, 1u, m_CulledTransformsUAV.GetAddressOf(), &InitialCount);
 	DeviceContext->CSSetUnorderedAccessViews(1u, 1u, m_CulledOffsetsUAV.GetAddressOf(), &InitialCount);
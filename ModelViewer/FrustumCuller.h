@@ -4,12 +4,25 @@
 #define FRUSTUM_CULLER_H
 
 #include <vector>
+#include <string>
+#include <utility>
 
 #include "DirectXMath.h"
 #include "d3d11.h"
 
 #include "wrl.h"
 
+#include "Common.h"
+#include "CPUFrustumCuller.h"
+#include "MultiViewCuller.h"
+#include "ScreenSizeCuller.h"
+#include "ClusterCuller.h"
+#include "CullingBatch.h"
+#include "InstanceBufferManager.h"
+
+class TemporalFrustumCuller;
+class LODSelector;
+
 class FrustumCuller
 {
 private:
@@ -26,6 +39,26 @@ private:
 		float LODDistanceThreshold;
 		DirectX::XMFLOAT3 CameraPos;
 		float Padding;
+		DirectX::XMFLOAT4 FrustumPlanes[6];
+		UINT BatchDrawCount;
+		UINT BaseInstance;
+		float MinPixelRadius;
+		float PixelScale;
+	};
+
+	struct InstanceOffsetBufferData
+	{
+		UINT InstanceOffset;
+		UINT Padding[3];
+	};
+
+	// counts are copied out every frame and read a few frames later so the CPU never waits on the GPU
+	struct BatchReadback
+	{
+		Microsoft::WRL::ComPtr<ID3D11Buffer> StagingBuffer;
+		std::vector<std::string> ModelNames;
+		std::vector<UINT> ReferenceCounts;
+		bool bPending = false;
 	};
 
 	struct InstanceCountMultiplierBufferData
@@ -48,12 +81,37 @@ public:
 	bool Init();
 	void Shutdown();
 
-	void DispatchShader(const std::vector<DirectX::XMMATRIX>& Transforms, const std::vector<DirectX::XMFLOAT4>& Corners, const DirectX::XMMATRIX& ScaleMatrix = DirectX::XMMatrixIdentity());
+	// instances past the largest buffer D3D11 allows are not culled or drawn, false if the instance buffers could not be grown
+	bool DispatchShader(const std::vector<DirectX::XMMATRIX>& Transforms, const std::vector<DirectX::XMFLOAT4>& Corners, const DirectX::XMMATRIX& ScaleMatrix = DirectX::XMMatrixIdentity());
 	void DispatchShader(const std::vector<DirectX::XMFLOAT2>& Offsets, const std::vector<DirectX::XMFLOAT4>& Corners, const DirectX::XMMATRIX& ScaleMatrix = DirectX::XMMatrixIdentity());
 	void CullLandscape(ID3D11ShaderResourceView* ChunksOffsetsSRV, const std::vector<DirectX::XMFLOAT4>& Corners, const DirectX::XMMATRIX& ScaleMatrix, const UINT NumChunks, UINT PlaneDimension,
 		float HeightDisplacement, ID3D11ShaderResourceView* Heightmap);
-	void CullGrass(ID3D11ShaderResourceView* GrassOffsetsSRV, const std::vector<DirectX::XMFLOAT4>& Corners, const UINT GrassPerChunk, const UINT VisibleChunkCount,
-		UINT PlaneDimension, float HeightDisplacement, float LODDistanceThreshold, ID3D11ShaderResourceView* Heightmap);
+	// VisibleChunkOffsetsSRV holds the world offset of every visible chunk, the first VisibleChunkCount are culled
+	void CullGrass(ID3D11ShaderResourceView* GrassOffsetsSRV, ID3D11ShaderResourceView* VisibleChunkOffsetsSRV, const std::vector<DirectX::XMFLOAT4>& Corners, const UINT GrassPerChunk,
+		const UINT VisibleChunkCount, UINT PlaneDimension, float HeightDisplacement, float LODDistanceThreshold, ID3D11ShaderResourceView* Heightmap);
+	// only the blades of the tiles in TilesSRV (GrassTileCuller::TileEntry) are culled, the ones in fully inside tiles without a bounds test
+	void CullGrassTiles(ID3D11ShaderResourceView* GrassOffsetsSRV, ID3D11ShaderResourceView* VisibleChunkOffsetsSRV, ID3D11ShaderResourceView* TilesSRV, const UINT TileCount,
+		const std::vector<DirectX::XMFLOAT4>& Corners, UINT PlaneDimension, float HeightDisplacement, float LODDistanceThreshold, ID3D11ShaderResourceView* Heightmap);
+	// with a TemporalFrustumCuller the per instance records in it are used to skip instances that can not have changed. With a
+	// LODSelector the visible instances are uploaded grouped by the level it picks, see its level ranges for what to draw. OutInstanceCount
+	// is how many were uploaded, false if the upload buffer could not be grown
+	bool CullOnCPU(const std::vector<DirectX::XMMATRIX>& Transforms, const AABB& BBox, UINT& OutInstanceCount, TemporalFrustumCuller* Temporal = nullptr,
+		LODSelector* LODs = nullptr);
+	// with more than one view CullOnCPU tests every instance against all of them in one pass, only PrimaryView is uploaded for drawing.
+	// An empty list goes back to culling against the main camera
+	void SetCullingViews(const std::vector<DirectX::XMMATRIX>& ViewProjs, UINT PrimaryView);
+	// drops instances whose projected size from the main camera is under MinPixelRadius, in CullOnCPU and in the per model and batch shaders
+	void SetScreenSizeCulling(bool bEnable, float MinPixelRadius);
+	// the main camera view and thresholds every LODSelector given to CullOnCPU picks levels with, PixelError in pixels
+	void SetLODSelection(float PixelError, float Hysteresis);
+	// culls every model in the batch and fills one indirect args entry per batch draw, without reading anything back this frame.
+	// With bValidate the CPU reference is run as well and compared against the GPU counts once they arrive
+	// false if the batch instance buffers could not be grown, the batch must fit in GetMaxBatchInstances(), MAX_BATCH_MODELS and MAX_BATCH_DRAWS
+	bool DispatchBatch(CullingBatch& Batch, bool bValidate = false);
+	void SetInstanceOffset(UINT InstanceOffset);
+	// uploads the instance list of ClusterCuller::CullInstances to vertex buffer slot 1 for the cluster vertex shaders. Returns how
+	// many entries were uploaded, anything past the largest buffer D3D11 allows is left out and 0 if the buffer could not be grown
+	UINT SetClusterInstances(const std::vector<UINT>& Instances);
 	void ClearInstanceCount();
 	void SendInstanceCount(Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> ArgsBufferUAV);
 	void SendGrassLODInstanceCount(Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> ArgsBufferUAV);
@@ -65,24 +123,51 @@ public:
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetCulledOffsetsSRV() const { return m_CulledOffsetsSRV; }
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetCulledGrassDataSRV() const { return m_CulledGrassDataSRV; }
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetCulledGrassLODDataSRV() const { return m_CulledGrassLODDataSRV; }
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetCPUCulledTransformsSRV() const { return m_CPUCulledTransformsSRV; }
+	UINT GetCPUInstanceCount() const { return m_CPUInstanceCount; }
+	// what the last CullOnCPU uploaded, in upload order
+	const std::vector<DirectX::XMMATRIX>& GetCPUVisibleTransforms() const { return m_CPUVisibleTransforms; }
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetBatchCulledTransformsSRV() const { return m_BatchCulledTransformsSRV; }
+	Microsoft::WRL::ComPtr<ID3D11Buffer> GetBatchArgsBuffer() const { return m_BatchArgsBuffer; }
+	// per model visible counts from BATCH_READBACK_LATENCY - 1 frames ago
+	const std::vector<std::pair<std::string, UINT64>>& GetBatchInstanceCounts() const { return m_BatchInstanceCounts; }
+	UINT64 GetBatchValidationMismatches() const { return m_BatchValidationMismatches; }
+
+	// capacity is summed over the per model, CPU and batch instance buffers, the high water mark is the largest single request
+	UINT GetInstanceBufferCapacity() const;
+	UINT GetInstanceBufferHighWaterMark() const;
+	// the most instances one buffer can hold under the D3D11 resource size limit, models that would push a batch past it go per model
+	UINT GetMaxBatchInstances() const { return m_BatchInstances.GetMaxCapacity(); }
+	CPUFrustumCuller& GetCPUCuller() { return m_CPUCuller; }
+	// meshlet culling of CPU backend instances, set up once a frame against the main camera
+	ClusterCuller& GetClusterCuller() { return m_ClusterCuller; }
+	const MultiViewCuller& GetMultiViewCuller() const { return m_MultiViewCuller; }
+	// projected radius in pixels of every instance the last CullOnCPU kept, in the order they were uploaded. Only kept up to date with screen size culling on
+	const std::vector<float>& GetCPUProjectedRadii() const { return m_ScreenSizeCuller.GetProjectedRadii(); }
 
 private:
 	bool CreateBuffers();
 	bool CreateBufferViews();
+	// (re)created at the capacity of their InstanceBufferManager whenever it grows
+	bool CreateModelInstanceBuffers();
+	bool CreateCPUInstanceBuffers();
+	bool CreateBatchInstanceBuffers();
+	bool CreateClusterInstanceBuffer();
 
-	void UpdateBuffers(const std::vector<DirectX::XMMATRIX>& Transforms, const std::vector<DirectX::XMFLOAT4>& Corners,const DirectX::XMMATRIX& ScaleMatrix, UINT* ThreadGroupCount,
-		UINT SentInstanceCount, UINT GrassPerChunk = 0u, UINT PlaneDimension = 0u, float HeightDisplacement = 0.f);
+	void UpdateBuffers(const std::vector<DirectX::XMMATRIX>& Transforms, UINT Count);
 	void UpdateBuffers(const std::vector<DirectX::XMFLOAT2>& Offsets, const std::vector<DirectX::XMFLOAT4>& Corners, const DirectX::XMMATRIX& ScaleMatrix, UINT* ThreadGroupCount,
 		UINT SentInstanceCount, UINT GrassPerChunk = 0u, UINT PlaneDimension = 0u, float HeightDisplacement = 0.f);
 	void UpdateCBuffer(const std::vector<DirectX::XMFLOAT4>& Corners, const DirectX::XMMATRIX& ScaleMatrix, UINT* ThreadGroupCount, UINT SentInstanceCount, UINT GrassPerChunk,
-		UINT PlaneDimension, float HeightDisplacement, float LODDistanceThreshold = 0.f);
+		UINT PlaneDimension, float HeightDisplacement, float LODDistanceThreshold = 0.f, UINT BatchDrawCount = 0u, UINT BaseInstance = 0u);
 
-	void DispatchShaderImpl(UINT* ThreadGroupCount);
+	void DispatchShaderImpl(UINT* ThreadGroupCount, bool bResetAppendCount = true);
+	void ReadBackBatchCounts();
 
 private:
 	ID3D11ComputeShader* m_CullingShader;
 	ID3D11ComputeShader* m_OffsetsCullingShader;
 	ID3D11ComputeShader* m_GrassCullingShader;
+	ID3D11ComputeShader* m_GrassTileCullingShader;
 	ID3D11ComputeShader* m_InstanceCountClearShader;
 	ID3D11ComputeShader* m_InstanceCountTransferShader;
 	ID3D11ComputeShader* m_GrassLODInstanceCountTransferShader;
@@ -107,6 +192,62 @@ private:
 	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> m_CulledGrassDataUAV;
 	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> m_CulledGrassLODDataUAV;
 
+	InstanceBufferManager m_ModelInstances;
+	InstanceBufferManager m_CPUInstances;
+	InstanceBufferManager m_BatchInstances;
+	std::vector<InstanceBufferManager::Chunk> m_Chunks;
+
+	// CPU backend, visible transforms are uploaded so the instanced VS can read them the same way as the GPU culled ones
+	CPUFrustumCuller m_CPUCuller;
+	std::vector<DirectX::XMMATRIX> m_CPUVisibleTransforms;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> m_CPUCulledTransformsBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_CPUCulledTransformsSRV;
+	UINT m_CPUInstanceCount = 0u;
+
+	MultiViewCuller m_MultiViewCuller;
+	UINT m_PrimaryView = 0u;
+
+	ScreenSizeCuller m_ScreenSizeCuller;
+	std::vector<UINT> m_ScreenSizeIndices;
+	bool m_bScreenSizeCulling = false;
+
+	std::vector<UINT> m_LODIndices;
+	std::vector<UINT> m_CapacityIndices;	// the visible instances that still fit in the upload buffer, only used when some do not
+	DirectX::XMFLOAT3 m_LODCameraPos = { 0.f, 0.f, 0.f };
+	float m_LODPixelScale = 1.f;
+	float m_LODPixelError = 1.f;
+	float m_LODHysteresis = 0.f;
+
+	ClusterCuller m_ClusterCuller;
+	// one index into the CPU culled transforms per instance of every cluster range, rewritten for every mesh drawn with clusters
+	InstanceBufferManager m_ClusterInstances = InstanceBufferManager(InstanceBufferManager::PAGE_SIZE, sizeof(UINT));
+	Microsoft::WRL::ComPtr<ID3D11Buffer> m_ClusterInstanceBuffer;
+
+	ID3D11ComputeShader* m_BatchCullingShader;
+	ID3D11ComputeShader* m_BatchArgsShader;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> m_BatchTransformsBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> m_BatchModelIDsBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> m_BatchModelsBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> m_BatchDrawsBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> m_BatchCulledTransformsBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> m_BatchInstanceCountsBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> m_BatchArgsBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> m_InstanceOffsetCBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_BatchTransformsSRV;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_BatchModelIDsSRV;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_BatchModelsSRV;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_BatchDrawsSRV;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_BatchCulledTransformsSRV;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> m_BatchCulledTransformsUAV;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> m_BatchInstanceCountsUAV;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> m_BatchArgsUAV;
+	BatchReadback m_BatchReadbacks[BATCH_READBACK_LATENCY];
+	UINT m_BatchFrame = 0u;
+	std::vector<std::pair<std::string, UINT64>> m_BatchInstanceCounts;
+	UINT64 m_BatchValidationMismatches = 0u;
+	std::vector<DirectX::XMMATRIX> m_BatchReferenceTransforms;
+	std::vector<CullingBatch::InstanceRange> m_BatchReferenceRanges;
+
 	const char* m_csFilename;
 	bool m_bGotInstanceCount;
 };
@@ -14,7 +14,14 @@ void GameObject::RenderControls()
 {
 	ImGui::Text(m_ComponentName.c_str());
 
-	ImGui::DragFloat3("Position", reinterpret_cast<float*>(&m_Transform.Position), 0.1f);
-	ImGui::DragFloat3("Rotation", reinterpret_cast<float*>(&m_Transform.Rotation), 0.1f);
-	ImGui::DragFloat3("Scale", reinterpret_cast<float*>(&m_Transform.Scale), 0.1f);
+	DirectX::XMFLOAT3 Position = GetPosition();
+	DirectX::XMFLOAT3 Rotation = GetRotation();
+	DirectX::XMFLOAT3 Scale = GetScale();
+
+	if (ImGui::DragFloat3("Position", reinterpret_cast<float*>(&Position), 0.1f))
+		SetPosition(Position.x, Position.y, Position.z);
+	if (ImGui::DragFloat3("Rotation", reinterpret_cast<float*>(&Rotation), 0.1f))
+		SetRotation(Rotation.x, Rotation.y, Rotation.z);
+	if (ImGui::DragFloat3("Scale", reinterpret_cast<float*>(&Scale), 0.1f))
+		SetScale(Scale.x, Scale.y, Scale.z);
 }
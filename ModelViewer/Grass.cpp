@@ -8,6 +8,8 @@
 #include "Landscape.h"
 #include "FrustumCuller.h"
 #include "Camera.h"
+#include "Common.h"
+#include "Frustum.h"
 
 typedef unsigned int UINT;
 
@@ -66,6 +68,7 @@ Grass::Grass()
 	m_WindStrength = 0.7f;
 	m_SwayExponent = 1.5f;
 	m_pLandscape = nullptr;
+	m_bUseTileCulling = true;
 }
 
 Grass::~Grass()
@@ -82,6 +85,11 @@ bool Grass::Init(Landscape* pLandscape, UINT GrassDimensionPerChunk)
 	m_GrassPerChunk = GrassDimensionPerChunk * GrassDimensionPerChunk;
 	assert(m_GrassPerChunk <= MAX_GRASS_PER_CHUNK);
 
+	// tiles need the blade bounds, and they reorder the offsets so have to be built before those are uploaded
+	GenerateAABB();
+	m_TileCuller.Build(m_pLandscape->GetGrassOffsets(), GrassDimensionPerChunk, GRASS_TILE_DIMENSION, m_BBox, m_pLandscape->m_Heights.data(),
+		m_pLandscape->m_HeightmapWidth, m_pLandscape->m_HeightmapHeight, m_pLandscape->GetChunkDimension(), m_pLandscape->m_ChunkSize);
+
 	FALSE_IF_FAILED(CreateBuffers());
 
 	m_vsFilepath = "Shaders/GrassVS.hlsl";
@@ -97,8 +105,6 @@ bool Grass::Init(Landscape* pLandscape, UINT GrassDimensionPerChunk)
 	HFALSE_IF_FAILED(Graphics::GetSingletonPtr()->GetDevice()->CreateInputLayout(LayoutDesc, _countof(LayoutDesc), vsBuffer->GetBufferPointer(), vsBuffer->GetBufferSize(), &m_InputLayout));
 	NAME_D3D_RESOURCE(m_InputLayout, "Grass input layout");
 
-	GenerateAABB();
-
 	return true;
 }
 
@@ -113,16 +119,47 @@ void Grass::Render()
 	Application* pApp = Application::GetSingletonPtr();
 	Graphics* pGraphics = Graphics::GetSingletonPtr();
 	ID3D11DeviceContext* pContext = pGraphics->GetDeviceContext();
-	pApp->GetFrustumCuller()->CullGrass(
-		m_GrassOffsetsSRV.Get(),
-		m_BBox.Corners,
-		m_GrassPerChunk,
-		m_pLandscape->GetChunkInstanceCount(),
-		m_pLandscape->GetChunkDimension(),
-		m_pLandscape->GetHeightDisplacement(),
-		m_LODDistanceThreshold,
-		m_pLandscape->GetHeightmapSRV()
-	);
+	// the culled grass buffers hold MAX_PLANE_CHUNKS chunks worth of grass, visible chunks come nearest first so any past that are the far ones
+	const UINT VisibleChunkCount = m_pLandscape->GetChunkInstanceCount() < MAX_PLANE_CHUNKS ? m_pLandscape->GetChunkInstanceCount() : MAX_PLANE_CHUNKS;
+	if (m_bUseTileCulling)
+	{
+		// same main camera the landscape chunks were culled with
+		m_TileCuller.Classify(Frustum(pApp->GetMainCamera()->GetViewProjMatrix()), m_pLandscape->GetVisibleChunks(), VisibleChunkCount, m_pLandscape->GetChunkOffsets(),
+			m_pLandscape->GetHeightDisplacement(), m_TileEntries);
+		UpdateTilesBuffer();
+
+		const GrassTileCuller::ClassifyStats& TileStats = m_TileCuller.GetLastStats();
+		pApp->GetRenderStatsRef().GrassTilesCulled = TileStats.TilesCulled;
+		pApp->GetRenderStatsRef().GrassTilesInside = TileStats.TilesInside;
+		pApp->GetRenderStatsRef().GrassTilesPartial = TileStats.TilesPartial;
+		pApp->GetRenderStatsRef().GrassBladeTestsAvoided = TileStats.BladeTestsAvoided;
+
+		pApp->GetFrustumCuller()->CullGrassTiles(
+			m_GrassOffsetsSRV.Get(),
+			m_pLandscape->m_VisibleOffsetsSRV.Get(),
+			m_TilesSRV.Get(),
+			(UINT)m_TileEntries.size(),
+			m_BBox.Corners,
+			(UINT)m_pLandscape->GetPlaneDimension(),
+			m_pLandscape->GetHeightDisplacement(),
+			m_LODDistanceThreshold,
+			m_pLandscape->GetHeightmapSRV()
+		);
+	}
+	else
+	{
+		pApp->GetFrustumCuller()->CullGrass(
+			m_GrassOffsetsSRV.Get(),
+			m_pLandscape->m_VisibleOffsetsSRV.Get(),
+			m_BBox.Corners,
+			m_GrassPerChunk,
+			VisibleChunkCount,
+			(UINT)m_pLandscape->GetPlaneDimension(),
+			m_pLandscape->GetHeightDisplacement(),
+			m_LODDistanceThreshold,
+			m_pLandscape->GetHeightmapSRV()
+		);
+	}
 	m_GrassInstanceCounts = pApp->GetFrustumCuller()->GetInstanceCounts();
 	
 	pGraphics->SetRasterStateBackFaceCull(false);
@@ -182,6 +219,7 @@ void Grass::RenderControls()
 {
 	ImGui::Text(GetName().c_str());
 	ImGui::Checkbox("Should Render Grass?", &m_bShouldRender);
+	ImGui::Checkbox("Tile Culling?", &m_bUseTileCulling);
 	ImGui::SliderFloat("LOD Distance Threshold", &m_LODDistanceThreshold, 0.f, 1000.f);
 
 	ImGui::Dummy(ImVec2(0.f, 10.f));
@@ -315,6 +353,21 @@ bool Grass::CreateBuffers()
 	HFALSE_IF_FAILED(Graphics::GetSingletonPtr()->GetDevice()->CreateShaderResourceView(m_GrassOffsetsBuffer.Get(), &SRVDesc, &m_GrassOffsetsSRV));
 	NAME_D3D_RESOURCE(m_GrassOffsetsSRV, "Grass offsets buffer SRV");
 
+	// enough for every tile of as many chunks as the culled grass buffers can hold
+	const UINT MaxTiles = MAX_PLANE_CHUNKS * m_TileCuller.GetTileCount();
+	Desc.Usage = D3D11_USAGE_DYNAMIC;
+	Desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	Desc.ByteWidth = sizeof(GrassTileCuller::TileEntry) * MaxTiles;
+	Desc.StructureByteStride = sizeof(GrassTileCuller::TileEntry);
+
+	HFALSE_IF_FAILED(Graphics::GetSingletonPtr()->GetDevice()->CreateBuffer(&Desc, nullptr, &m_TilesBuffer));
+	NAME_D3D_RESOURCE(m_TilesBuffer, "Grass tiles buffer");
+
+	SRVDesc.Buffer.NumElements = MaxTiles;
+
+	HFALSE_IF_FAILED(Graphics::GetSingletonPtr()->GetDevice()->CreateShaderResourceView(m_TilesBuffer.Get(), &SRVDesc, &m_TilesSRV));
+	NAME_D3D_RESOURCE(m_TilesSRV, "Grass tiles buffer SRV");
+
 	Desc = {};
 	Desc.ByteWidth = sizeof(D3D11_DRAW_INDEXED_INSTANCED_INDIRECT_ARGS);
 	Desc.Usage = D3D11_USAGE_DEFAULT;
@@ -376,6 +429,20 @@ void Grass::UpdateBuffers()
 	DeviceContext->Unmap(m_GrassCBuffer.Get(), 0u);
 }
 
+void Grass::UpdateTilesBuffer()
+{
+	HRESULT hResult;
+	D3D11_MAPPED_SUBRESOURCE MappedResource;
+	ID3D11DeviceContext* DeviceContext = Graphics::GetSingletonPtr()->GetDeviceContext();
+
+	if (m_TileEntries.empty())
+		return;
+
+	ASSERT_NOT_FAILED(DeviceContext->Map(m_TilesBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0, &MappedResource));
+	memcpy(MappedResource.pData, m_TileEntries.data(), sizeof(GrassTileCuller::TileEntry) * m_TileEntries.size());
+	DeviceContext->Unmap(m_TilesBuffer.Get(), 0u);
+}
+
 void Grass::SetWindDirection(DirectX::XMFLOAT2 WindDir)
 {
 	DirectX::XMVECTOR v = DirectX::XMLoadFloat2(&WindDir);
@@ -4,6 +4,7 @@
 #define GRASS_H
 
 #include <array>
+#include <vector>
 
 #include "d3d11.h"
 #include "DirectXMath.h"
@@ -12,6 +13,7 @@
 
 #include "GameObject.h"
 #include "AABB.h"
+#include "GrassTileCuller.h"
 
 class Landscape;
 
@@ -52,6 +54,7 @@ private:
 	void GenerateAABB();
 
 	void UpdateBuffers();
+	void UpdateTilesBuffer();
 	void SetWindDirection(DirectX::XMFLOAT2 WindDir);
 
 private:
@@ -66,10 +69,15 @@ private:
 	Microsoft::WRL::ComPtr<ID3D11Buffer> m_GrassOffsetsBuffer;
 	Microsoft::WRL::ComPtr<ID3D11Buffer> m_GrassCBuffer;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_GrassOffsetsSRV;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> m_TilesBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_TilesSRV;
 	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> m_ArgsBufferUAV;
 
 	Landscape* m_pLandscape;
 	AABB m_BBox;
+	GrassTileCuller m_TileCuller;
+	std::vector<GrassTileCuller::TileEntry> m_TileEntries;
+	bool m_bUseTileCulling;
 	UINT m_GrassPerChunk;
 	std::array<UINT, 2> m_GrassInstanceCounts;
 	bool m_bShouldRender;
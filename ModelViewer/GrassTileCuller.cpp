@@ -0,0 +1,156 @@
+#include <cassert>
+#include <cfloat>
+
+#include "GrassTileCuller.h"
+#include "LandscapeQuadtree.h"
+
+void GrassTileCuller::Build(std::vector<DirectX::XMFLOAT2>& Offsets, UINT BladesPerAxis, UINT TileDimension, const AABB& BladeBounds,
+	const float* Heights, UINT Width, UINT Height, UINT ChunkDimension, float ChunkSize)
+{
+	assert(BladesPerAxis * BladesPerAxis == (UINT)Offsets.size() && TileDimension > 0u);
+
+	m_Tiles.clear();
+	m_BladeBounds = BladeBounds;
+	m_ChunkOffsetMin = { FLT_MAX, FLT_MAX };
+	m_ChunkOffsetMax = { -FLT_MAX, -FLT_MAX };
+
+	// tile major order, the blades of a tile are then one contiguous range for the shader
+	const UINT TilesPerAxis = (BladesPerAxis + TileDimension - 1u) / TileDimension;
+	std::vector<DirectX::XMFLOAT2> Sorted;
+	Sorted.reserve(Offsets.size());
+	for (UINT tz = 0u; tz < TilesPerAxis; tz++)
+	{
+		for (UINT tx = 0u; tx < TilesPerAxis; tx++)
+		{
+			Tile T = { (UINT)Sorted.size(), 0u, { FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX } };
+			const UINT EndX = (tx + 1u) * TileDimension < BladesPerAxis ? (tx + 1u) * TileDimension : BladesPerAxis;
+			const UINT EndZ = (tz + 1u) * TileDimension < BladesPerAxis ? (tz + 1u) * TileDimension : BladesPerAxis;
+			for (UINT x = tx * TileDimension; x < EndX; x++)
+			{
+				for (UINT z = tz * TileDimension; z < EndZ; z++)
+				{
+					const DirectX::XMFLOAT2& o = Offsets[x * BladesPerAxis + z];
+					Sorted.push_back(o);
+					T.OffsetMin = { o.x < T.OffsetMin.x ? o.x : T.OffsetMin.x, o.y < T.OffsetMin.y ? o.y : T.OffsetMin.y };
+					T.OffsetMax = { o.x > T.OffsetMax.x ? o.x : T.OffsetMax.x, o.y > T.OffsetMax.y ? o.y : T.OffsetMax.y };
+				}
+			}
+			T.BladeCount = (UINT)Sorted.size() - T.FirstBlade;
+
+			m_ChunkOffsetMin = { T.OffsetMin.x < m_ChunkOffsetMin.x ? T.OffsetMin.x : m_ChunkOffsetMin.x, T.OffsetMin.y < m_ChunkOffsetMin.y ? T.OffsetMin.y : m_ChunkOffsetMin.y };
+			m_ChunkOffsetMax = { T.OffsetMax.x > m_ChunkOffsetMax.x ? T.OffsetMax.x : m_ChunkOffsetMax.x, T.OffsetMax.y > m_ChunkOffsetMax.y ? T.OffsetMax.y : m_ChunkOffsetMax.y };
+			m_Tiles.push_back(T);
+		}
+	}
+	Offsets.swap(Sorted);
+
+	// heights are read at the blade position only, the same UVs as GetHeightmapUV with v flipped
+	const UINT TileCount = (UINT)m_Tiles.size();
+	const float PlaneDimension = (float)ChunkDimension * ChunkSize;
+	const float HalfPlane = PlaneDimension * 0.5f;
+	const float HalfCount = (float)ChunkDimension / 2.f;
+	m_TileHeights.resize(ChunkDimension * ChunkDimension * TileCount);
+	m_ChunkHeights.resize(ChunkDimension * ChunkDimension);
+
+	for (UINT z = 0u; z < ChunkDimension; z++)
+	{
+		const float ChunkZ = ((int)z - HalfCount) * ChunkSize + ChunkSize * 0.5f;
+		for (UINT x = 0u; x < ChunkDimension; x++)
+		{
+			const float ChunkX = ((int)x - HalfCount) * ChunkSize + ChunkSize * 0.5f;
+			const UINT ChunkID = z * ChunkDimension + x;
+
+			DirectX::XMFLOAT2 ChunkRange = { FLT_MAX, -FLT_MAX };
+			for (UINT t = 0u; t < TileCount; t++)
+			{
+				const Tile& T = m_Tiles[t];
+				const DirectX::XMFLOAT2 Range = LandscapeQuadtree::ComputeHeightRange(Heights, Width, Height,
+					(ChunkX + T.OffsetMin.x + HalfPlane) / PlaneDimension, (ChunkX + T.OffsetMax.x + HalfPlane) / PlaneDimension,
+					1.f - (ChunkZ + T.OffsetMax.y + HalfPlane) / PlaneDimension, 1.f - (ChunkZ + T.OffsetMin.y + HalfPlane) / PlaneDimension);
+
+				m_TileHeights[ChunkID * TileCount + t] = Range;
+				ChunkRange = { Range.x < ChunkRange.x ? Range.x : ChunkRange.x, Range.y > ChunkRange.y ? Range.y : ChunkRange.y };
+			}
+			m_ChunkHeights[ChunkID] = ChunkRange;
+		}
+	}
+}
+
+void GrassTileCuller::Classify(const Frustum& ViewFrustum, const std::vector<UINT>& VisibleChunks, UINT VisibleCount, const std::vector<DirectX::XMFLOAT2>& ChunkOffsets,
+	float HeightDisplacement, std::vector<TileEntry>& OutTiles)
+{
+	OutTiles.clear();
+	m_LastStats = {};
+
+	const UINT TileCount = (UINT)m_Tiles.size();
+	UINT BladesPerChunk = 0u;
+	for (const Tile& T : m_Tiles)
+	{
+		BladesPerChunk += T.BladeCount;
+	}
+
+	for (UINT Slot = 0u; Slot < VisibleCount; Slot++)
+	{
+		const UINT ChunkID = VisibleChunks[Slot];
+		const DirectX::XMFLOAT2& ChunkOffset = ChunkOffsets[ChunkID];
+
+		// all the grass of the chunk first, its plane mask carries over to the tiles
+		DirectX::XMFLOAT3 Center, Extent;
+		GetBounds(m_ChunkOffsetMin, m_ChunkOffsetMax, m_ChunkHeights[ChunkID], ChunkOffset, HeightDisplacement, Center, Extent);
+		UINT ChunkMask = 0x3F;
+		if (!ViewFrustum.TestAABB(Center, Extent, ChunkMask))
+		{
+			m_LastStats.TilesCulled += TileCount;
+			m_LastStats.BladeTestsAvoided += BladesPerChunk;
+			continue;
+		}
+
+		for (UINT t = 0u; t < TileCount; t++)
+		{
+			const Tile& T = m_Tiles[t];
+			UINT Mask = ChunkMask;
+			if (Mask != 0u)
+			{
+				GetBounds(T.OffsetMin, T.OffsetMax, m_TileHeights[ChunkID * TileCount + t], ChunkOffset, HeightDisplacement, Center, Extent);
+				if (!ViewFrustum.TestAABB(Center, Extent, Mask))
+				{
+					m_LastStats.TilesCulled++;
+					m_LastStats.BladeTestsAvoided += T.BladeCount;
+					continue;
+				}
+			}
+
+			if (Mask == 0u)
+			{
+				m_LastStats.TilesInside++;
+				m_LastStats.BladeTestsAvoided += T.BladeCount;
+			}
+			else
+			{
+				m_LastStats.TilesPartial++;
+			}
+			OutTiles.push_back({ Slot, T.FirstBlade, T.BladeCount, Mask == 0u ? 1u : 0u });
+		}
+	}
+}
+
+void GrassTileCuller::GetTileBounds(UINT ChunkID, UINT TileIndex, const DirectX::XMFLOAT2& ChunkOffset, float HeightDisplacement, DirectX::XMFLOAT3& OutCenter,
+	DirectX::XMFLOAT3& OutExtent) const
+{
+	const Tile& T = m_Tiles[TileIndex];
+	GetBounds(T.OffsetMin, T.OffsetMax, m_TileHeights[ChunkID * (UINT)m_Tiles.size() + TileIndex], ChunkOffset, HeightDisplacement, OutCenter, OutExtent);
+}
+
+void GrassTileCuller::GetBounds(const DirectX::XMFLOAT2& OffsetMin, const DirectX::XMFLOAT2& OffsetMax, const DirectX::XMFLOAT2& HeightRange, const DirectX::XMFLOAT2& ChunkOffset,
+	float HeightDisplacement, DirectX::XMFLOAT3& OutCenter, DirectX::XMFLOAT3& OutExtent) const
+{
+	// union of the blade bounds moved to every offset and height in the ranges, what the per blade test in the shader uses
+	const float y0 = HeightRange.x * HeightDisplacement;
+	const float y1 = HeightRange.y * HeightDisplacement;
+
+	const DirectX::XMFLOAT3 Min = { ChunkOffset.x + OffsetMin.x + m_BladeBounds.Min.x, (y0 < y1 ? y0 : y1) + m_BladeBounds.Min.y, ChunkOffset.y + OffsetMin.y + m_BladeBounds.Min.z };
+	const DirectX::XMFLOAT3 Max = { ChunkOffset.x + OffsetMax.x + m_BladeBounds.Max.x, (y0 < y1 ? y1 : y0) + m_BladeBounds.Max.y, ChunkOffset.y + OffsetMax.y + m_BladeBounds.Max.z };
+
+	OutCenter = { (Min.x + Max.x) * 0.5f, (Min.y + Max.y) * 0.5f, (Min.z + Max.z) * 0.5f };
+	OutExtent = { (Max.x - Min.x) * 0.5f, (Max.y - Min.y) * 0.5f, (Max.z - Min.z) * 0.5f };
+}
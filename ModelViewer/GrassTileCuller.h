@@ -0,0 +1,86 @@
+#pragma once
+
+#ifndef GRASS_TILE_CULLER_H
+#define GRASS_TILE_CULLER_H
+
+#include <vector>
+
+#include "DirectXMath.h"
+
+#include "AABB.h"
+#include "Frustum.h"
+
+typedef unsigned int UINT;
+
+/*
+*	Groups the grass of a chunk into square tiles of blades and keeps the bounds of every tile, including the heightmap range under
+*	it for every chunk. Classify tests the grass bounds of each visible chunk and then its tiles: culled tiles are dropped, tiles fully
+*	inside the frustum are accepted as a whole and only the partially visible ones are left for per blade tests. A tile is culled or
+*	accepted only when every blade in it would be, so the per blade result is unchanged. Pure CPU, no device needed.
+*/
+
+class GrassTileCuller
+{
+public:
+	// same layout as the uint4 the tile culling shader reads
+	struct TileEntry
+	{
+		UINT ChunkSlot;		// index into the visible chunks passed to Classify
+		UINT FirstBlade;
+		UINT BladeCount;
+		UINT bFullyInside;
+	};
+
+	struct ClassifyStats
+	{
+		UINT TilesCulled = 0u;
+		UINT TilesInside = 0u;
+		UINT TilesPartial = 0u;
+		UINT BladeTestsAvoided = 0u;
+	};
+
+private:
+	struct Tile
+	{
+		UINT FirstBlade;
+		UINT BladeCount;
+		// range of the blade offsets in the tile, relative to the chunk center
+		DirectX::XMFLOAT2 OffsetMin;
+		DirectX::XMFLOAT2 OffsetMax;
+	};
+
+public:
+	// Offsets in the layout of Landscape::GenerateGrassOffsets (blade x * BladesPerAxis + z), reordered in place so the blades of each
+	// tile are contiguous. BladeBounds is the local bounds of one blade, Heights the normalized heightmap
+	void Build(std::vector<DirectX::XMFLOAT2>& Offsets, UINT BladesPerAxis, UINT TileDimension, const AABB& BladeBounds,
+		const float* Heights, UINT Width, UINT Height, UINT ChunkDimension, float ChunkSize);
+
+	// ChunkOffsets are the world offsets of every chunk, only the first VisibleCount chunks of VisibleChunks are classified
+	void Classify(const Frustum& ViewFrustum, const std::vector<UINT>& VisibleChunks, UINT VisibleCount, const std::vector<DirectX::XMFLOAT2>& ChunkOffsets,
+		float HeightDisplacement, std::vector<TileEntry>& OutTiles);
+
+	void GetTileBounds(UINT ChunkID, UINT TileIndex, const DirectX::XMFLOAT2& ChunkOffset, float HeightDisplacement, DirectX::XMFLOAT3& OutCenter,
+		DirectX::XMFLOAT3& OutExtent) const;
+
+	UINT GetTileCount() const { return (UINT)m_Tiles.size(); }
+	UINT GetTileFirstBlade(UINT TileIndex) const { return m_Tiles[TileIndex].FirstBlade; }
+	UINT GetTileBladeCount(UINT TileIndex) const { return m_Tiles[TileIndex].BladeCount; }
+	const ClassifyStats& GetLastStats() const { return m_LastStats; }
+
+private:
+	void GetBounds(const DirectX::XMFLOAT2& OffsetMin, const DirectX::XMFLOAT2& OffsetMax, const DirectX::XMFLOAT2& HeightRange, const DirectX::XMFLOAT2& ChunkOffset,
+		float HeightDisplacement, DirectX::XMFLOAT3& OutCenter, DirectX::XMFLOAT3& OutExtent) const;
+
+private:
+	std::vector<Tile> m_Tiles;
+	std::vector<DirectX::XMFLOAT2> m_TileHeights;		// normalized range per chunk and tile, ChunkID * tile count + tile
+	std::vector<DirectX::XMFLOAT2> m_ChunkHeights;		// union of the tiles of each chunk
+	DirectX::XMFLOAT2 m_ChunkOffsetMin = { 0.f, 0.f };
+	DirectX::XMFLOAT2 m_ChunkOffsetMax = { 0.f, 0.f };
+	AABB m_BladeBounds;
+
+	ClassifyStats m_LastStats;
+
+};
+
+#endif
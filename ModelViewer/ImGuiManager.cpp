@@ -6,8 +6,10 @@
 #include "PostProcess.h"
 #include "GameObject.h"
 #include "Graphics.h"
+#include "StressScene.h"
 
 static int s_SelectedId = -1;
+static StressSceneParams s_StressParams;
 
 ImGuiManager::ImGuiManager()
 {
@@ -51,10 +53,71 @@ void ImGuiManager::RenderPostProcessWindow()
 void ImGuiManager::RenderWorldHierarchyWindow()
 {
 	Application* pApp = Application::GetSingletonPtr();
-	auto& GameObjects = pApp->GetGameObjects();
+
+	// cameras and the landscape first, then the pooled objects in pool order
+	std::vector<GameObject*> GameObjects;
+	for (const auto& Object : pApp->GetGameObjects())
+	{
+		GameObjects.push_back(Object.get());
+	}
+	const std::vector<GameObject*>& Pooled = pApp->GetGameObjectPool().GetObjects();
+	GameObjects.insert(GameObjects.end(), Pooled.begin(), Pooled.end());
+	if (s_SelectedId >= (int)GameObjects.size())
+	{
+		s_SelectedId = -1;
+	}
+
+	// clicking into the scene while the cursor is free selects whatever is under it
+	const ImGuiIO& IO = ImGui::GetIO();
+	if (pApp->GetShowCursor() && !IO.WantCaptureMouse && ImGui::IsMouseClicked(ImGuiMouseButton_Left) && IO.DisplaySize.x > 0.f && IO.DisplaySize.y > 0.f)
+	{
+		const float NdcX = IO.MousePos.x / IO.DisplaySize.x * 2.f - 1.f;
+		const float NdcY = 1.f - IO.MousePos.y / IO.DisplaySize.y * 2.f;
+		GameObject* Picked = pApp->PickGameObject(NdcX, NdcY);
+		s_SelectedId = -1;
+		for (int i = 0; i < GameObjects.size(); i++)
+		{
+			if (GameObjects[i] == Picked)
+			{
+				s_SelectedId = i;
+				break;
+			}
+		}
+	}
 	
 	ImGui::Begin("World Hierarchy");
 
+	if (ImGui::Button("Save Scene"))
+	{
+		pApp->SaveScene(DEFAULT_SCENE_PATH);
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Load Scene"))
+	{
+		s_SelectedId = -1;
+		pApp->LoadScene(DEFAULT_SCENE_PATH);
+		ImGui::End();
+		return;
+	}
+
+	if (ImGui::TreeNode("Stress Scene"))
+	{
+		ImGui::InputScalar("Instances", ImGuiDataType_U32, &s_StressParams.InstanceCount);
+		ImGui::InputScalar("Models", ImGuiDataType_U32, &s_StressParams.ModelCount);
+		ImGui::InputScalar("Point Lights", ImGuiDataType_U32, &s_StressParams.PointLightCount);
+		ImGui::InputScalar("Directional Lights", ImGuiDataType_U32, &s_StressParams.DirectionalLightCount);
+		const bool bGenerate = ImGui::Button("Generate");
+		ImGui::TreePop();
+
+		if (bGenerate)
+		{
+			s_SelectedId = -1;
+			pApp->LoadStressScene(s_StressParams);
+			ImGui::End();
+			return;
+		}
+	}
+
 	ImGui::BeginChild("##", ImVec2(0, 250), ImGuiChildFlags_Border, ImGuiWindowFlags_HorizontalScrollbar);
 	for (int i = 0; i < GameObjects.size(); i++)
 	{
@@ -74,7 +137,7 @@ void ImGuiManager::RenderWorldHierarchyWindow()
 		ImGui::Separator();
 		ImGui::Dummy(ImVec2(0.f, 10.f));
 
-		for (auto& Comp : GameObjects[s_SelectedId]->GetComponents())
+		for (Component* Comp : GameObjects[s_SelectedId]->GetComponents())
 		{
 			Comp->RenderControls();
 			ImGui::Dummy(ImVec2(0.f, 5.f));
@@ -146,13 +209,119 @@ void ImGuiManager::RenderStatsWindow(const RenderStats& Stats)
 
 	ImGui::Text("Frame Time: %.3f ms/frame", Stats.FrameTime);
 	ImGui::Text("FPS: %.1f", Stats.FPS);
+	if (ImGui::TreeNode("CPU Phases"))
+	{
+		for (int i = 0; i < (int)FramePhase::Count; i++)
+		{
+			ImGui::Text("%s: %.3f ms", FramePhaseNames[i], Stats.PhaseMilliseconds[i]);
+		}
+		ImGui::TreePop();
+	}
 
 	ImGui::Checkbox("Show Bounding Boxes", &Application::GetSingletonPtr()->GetShowBoundingBoxesRef());
+	ImGui::Checkbox("Use Scene BVH", &Application::GetSingletonPtr()->GetUseSceneBVHRef());
+	ImGui::Checkbox("Use Occlusion Culling", &Application::GetSingletonPtr()->GetUseOcclusionCullingRef());
+	ImGui::Checkbox("Batched GPU Culling", &Application::GetSingletonPtr()->GetUseBatchedCullingRef());
+	if (Application::GetSingletonPtr()->GetUseBatchedCullingRef())
+	{
+		ImGui::Checkbox("Validate Batched Culling", &Application::GetSingletonPtr()->GetValidateBatchedCullingRef());
+	}
+	ImGui::Checkbox("Multi-View CPU Culling", &Application::GetSingletonPtr()->GetUseMultiViewCullingRef());
+	ImGui::Checkbox("Screen Size Culling", &Application::GetSingletonPtr()->GetUseScreenSizeCullingRef());
+	if (Application::GetSingletonPtr()->GetUseScreenSizeCullingRef())
+	{
+		ImGui::SliderFloat("Min Pixel Radius", &Application::GetSingletonPtr()->GetMinPixelRadiusRef(), 0.f, 20.f);
+	}
+	ImGui::Checkbox("Cluster CPU Culling", &Application::GetSingletonPtr()->GetUseClusterCullingRef());
+	if (Application::GetSingletonPtr()->GetUseClusterCullingRef())
+	{
+		ImGui::Checkbox("Backface Cone Culling", &Application::GetSingletonPtr()->GetUseConeCullingRef());
+	}
+	ImGui::Checkbox("CPU LOD Selection", &Application::GetSingletonPtr()->GetUseLODsRef());
+	if (Application::GetSingletonPtr()->GetUseLODsRef())
+	{
+		ImGui::SliderFloat("LOD Pixel Error", &Application::GetSingletonPtr()->GetLODPixelErrorRef(), 0.1f, 10.f);
+		ImGui::SliderFloat("LOD Hysteresis", &Application::GetSingletonPtr()->GetLODHysteresisRef(), 0.f, 0.9f);
+	}
+	ImGui::Checkbox("Temporal CPU Culling", &Application::GetSingletonPtr()->GetUseTemporalCullingRef());
+	if (Application::GetSingletonPtr()->GetUseTemporalCullingRef())
+	{
+		ImGui::SliderFloat("Camera Move Threshold", &Application::GetSingletonPtr()->GetTemporalTranslationThresholdRef(), 0.f, 10.f);
+		ImGui::SliderFloat("Camera Turn Threshold", &Application::GetSingletonPtr()->GetTemporalRotationThresholdRef(), 0.f, 20.f);
+	}
 
 	ImGui::Dummy(ImVec2(0.f, 10.f));
 
 	ImGui::Text("Draw Calls: %s", std::format(std::locale("en_US.UTF-8"), "{:L}", Stats.DrawCalls).c_str());
 	ImGui::Text("Compute Dispatches: %s", std::format(std::locale("en_US.UTF-8"), "{:L}", Stats.ComputeDispatches).c_str());
+	ImGui::Text("Instance Buffer Capacity: %s", std::format(std::locale("en_US.UTF-8"), "{:L}", Stats.InstanceBufferCapacity).c_str());
+	ImGui::Text("Instance Buffer High Water Mark: %s", std::format(std::locale("en_US.UTF-8"), "{:L}", Stats.InstanceBufferHighWaterMark).c_str());
+	ImGui::Text("Instances Over Buffer Capacity: %s", std::format(std::locale("en_US.UTF-8"), "{:L}", Stats.InstancesOverBufferCapacity).c_str());
+
+	ImGui::Text("Transforms Updated: %s", std::format(std::locale("en_US.UTF-8"), "{:L}", Stats.TransformsUpdated).c_str());
+	ImGui::Text("World Matrices Recomputed: %s", std::format(std::locale("en_US.UTF-8"), "{:L}", Stats.WorldMatricesRecomputed).c_str());
+	ImGui::Text("World Matrices Reused: %s", std::format(std::locale("en_US.UTF-8"), "{:L}", Stats.WorldMatricesReused).c_str());
+	ImGui::Text("Spatial Hash Models: %s", std::format(std::locale("en_US.UTF-8"), "{:L}", Stats.SpatialHashModels).c_str());
+	ImGui::Text("Spatial Hash Cells: %s", std::format(std::locale("en_US.UTF-8"), "{:L}", Stats.SpatialHashCells).c_str());
+	ImGui::Text("Point Light Models In Range: %s", std::format(std::locale("en_US.UTF-8"), "{:L}", Stats.PointLightModelsInRange).c_str());
+	ImGui::Text("Landscape Nodes Visited: %s", std::format(std::locale("en_US.UTF-8"), "{:L}", Stats.LandscapeNodesVisited).c_str());
+	ImGui::Text("Landscape Chunks Visible: %s", std::format(std::locale("en_US.UTF-8"), "{:L}", Stats.LandscapeChunksVisible).c_str());
+	ImGui::Text("Grass Tiles Culled: %s", std::format(std::locale("en_US.UTF-8"), "{:L}", Stats.GrassTilesCulled).c_str());
+	ImGui::Text("Grass Tiles Inside: %s", std::format(std::locale("en_US.UTF-8"), "{:L}", Stats.GrassTilesInside).c_str());
+	ImGui::Text("Grass Tiles Partial: %s", std::format(std::locale("en_US.UTF-8"), "{:L}", Stats.GrassTilesPartial).c_str());
+	ImGui::Text("Grass Blade Tests Avoided: %s", std::format(std::locale("en_US.UTF-8"), "{:L}", Stats.GrassBladeTestsAvoided).c_str());
+
+	if (Application::GetSingletonPtr()->GetUseSceneBVHRef())
+	{
+		ImGui::Text("Scene BVH Nodes Visited: %s", std::format(std::locale("en_US.UTF-8"), "{:L}", Stats.SceneBVHNodesVisited).c_str());
+		ImGui::Text("Scene BVH Models Visible: %s", std::format(std::locale("en_US.UTF-8"), "{:L}", Stats.SceneBVHItemsVisible).c_str());
+	}
+
+	if (Application::GetSingletonPtr()->GetUseOcclusionCullingRef())
+	{
+		ImGui::Text("Occluder Triangles: %s", std::format(std::locale("en_US.UTF-8"), "{:L}", Stats.OccluderTriangles).c_str());
+		ImGui::Text("Instances Occluded: %s", std::format(std::locale("en_US.UTF-8"), "{:L}", Stats.InstancesOccluded).c_str());
+	}
+
+	if (Application::GetSingletonPtr()->GetUseTemporalCullingRef())
+	{
+		ImGui::Text("Temporal Tests Run: %s", std::format(std::locale("en_US.UTF-8"), "{:L}", Stats.TemporalTestsRun).c_str());
+		ImGui::Text("Temporal Tests Skipped: %s", std::format(std::locale("en_US.UTF-8"), "{:L}", Stats.TemporalTestsSkipped).c_str());
+	}
+
+	if (Application::GetSingletonPtr()->GetUseScreenSizeCullingRef())
+	{
+		ImGui::Text("Instances Too Small (CPU): %s", std::format(std::locale("en_US.UTF-8"), "{:L}", Stats.InstancesTooSmall).c_str());
+	}
+
+	if (Application::GetSingletonPtr()->GetUseClusterCullingRef())
+	{
+		ImGui::Text("Clusters Outside Frustum: %s", std::format(std::locale("en_US.UTF-8"), "{:L}", Stats.ClustersOutsideFrustum).c_str());
+		ImGui::Text("Clusters Backfacing: %s", std::format(std::locale("en_US.UTF-8"), "{:L}", Stats.ClustersBackfacing).c_str());
+		ImGui::Text("Cluster Triangles Rejected: %s", std::format(std::locale("en_US.UTF-8"), "{:L}", Stats.ClusterTrianglesRejected).c_str());
+	}
+
+	if (Application::GetSingletonPtr()->GetUseLODsRef())
+	{
+		for (UINT l = 0u; l < MAX_MESH_LODS; l++)
+		{
+			ImGui::Text("LOD %u Instances: %s", l, std::format(std::locale("en_US.UTF-8"), "{:L}", Stats.LODInstances[l]).c_str());
+		}
+		ImGui::Text("LOD Triangles Saved: %s", std::format(std::locale("en_US.UTF-8"), "{:L}", Stats.LODTrianglesSaved).c_str());
+	}
+
+	if (Application::GetSingletonPtr()->GetUseMultiViewCullingRef())
+	{
+		for (const std::pair<std::string, UINT64>& View : Stats.MultiViewInstancesVisible)
+		{
+			ImGui::Text("Visible In %s: %s", View.first.c_str(), std::format(std::locale("en_US.UTF-8"), "{:L}", View.second).c_str());
+		}
+	}
+
+	if (Application::GetSingletonPtr()->GetUseBatchedCullingRef() && Application::GetSingletonPtr()->GetValidateBatchedCullingRef())
+	{
+		ImGui::Text("Batch Culling Mismatches: %s", std::format(std::locale("en_US.UTF-8"), "{:L}", Stats.BatchValidationMismatches).c_str());
+	}
 
 	ImGui::Dummy(ImVec2(0.f, 10.f));
 
@@ -0,0 +1,53 @@
+#include "InstanceBufferManager.h"
+
+#include <algorithm>
+#include <cassert>
+
+InstanceBufferManager::InstanceBufferManager(UINT InitialCapacity, UINT ElementSize)
+{
+	m_MaxCapacity = ComputeMaxCapacity(ElementSize);
+	m_Capacity = ComputeGrownCapacity(0u, std::max(InitialCapacity, 1u), m_MaxCapacity);
+	m_HighWaterMark = 0u;
+	m_GrowCount = 0u;
+}
+
+bool InstanceBufferManager::Reserve(UINT Required)
+{
+	m_HighWaterMark = std::max(m_HighWaterMark, Required);
+
+	Required = std::min(Required, m_MaxCapacity);
+	if (Required <= m_Capacity)
+		return false;
+
+	m_Capacity = ComputeGrownCapacity(m_Capacity, Required, m_MaxCapacity);
+	m_GrowCount++;
+	return true;
+}
+
+UINT InstanceBufferManager::ComputeGrownCapacity(UINT Current, UINT Required, UINT MaxCapacity)
+{
+	assert(MaxCapacity % PAGE_SIZE == 0u);
+
+	unsigned long long Capacity = std::max((unsigned long long)Current * 2ull, (unsigned long long)Required);
+	Capacity = (Capacity + PAGE_SIZE - 1ull) / PAGE_SIZE * PAGE_SIZE;
+
+	return (UINT)std::min(Capacity, (unsigned long long)MaxCapacity);
+}
+
+UINT InstanceBufferManager::ComputeMaxCapacity(UINT ElementSize)
+{
+	assert(ElementSize > 0u && ElementSize * PAGE_SIZE <= MAX_RESOURCE_BYTES);
+
+	return MAX_RESOURCE_BYTES / ElementSize / PAGE_SIZE * PAGE_SIZE;
+}
+
+void InstanceBufferManager::SplitIntoChunks(UINT Count, UINT ChunkSize, std::vector<Chunk>& OutChunks)
+{
+	assert(ChunkSize > 0u);
+
+	OutChunks.clear();
+	for (UINT Offset = 0u; Offset < Count; Offset += std::min(ChunkSize, Count - Offset))
+	{
+		OutChunks.push_back({ Offset, std::min(ChunkSize, Count - Offset) });
+	}
+}
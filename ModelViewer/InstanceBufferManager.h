@@ -0,0 +1,64 @@
+#pragma once
+
+#ifndef INSTANCE_BUFFER_MANAGER_H
+#define INSTANCE_BUFFER_MANAGER_H
+
+#include <vector>
+
+typedef unsigned int UINT;
+
+/*
+*	Capacity bookkeeping for a set of per instance buffers. Capacity grows geometrically in whole pages and never shrinks, so a scene
+*	that settles on a size stops reallocating after a few frames. Work too large for a single dispatch is split into chunks that the
+*	caller issues one after another. Capacity is capped so a buffer of ElementSize wide elements stays under the D3D11 per resource
+*	limit, requests past the cap are clamped and the owner has to drop or split what does not fit. Only decides sizes, creating the
+*	actual buffers is up to the owner (FrustumCuller), so this can be run without a device.
+*/
+
+class InstanceBufferManager
+{
+public:
+	struct Chunk
+	{
+		UINT Offset;
+		UINT Count;
+	};
+
+public:
+	static const UINT PAGE_SIZE = 1024u;
+	// D3D11_CS_DISPATCH_MAX_THREAD_GROUPS_PER_DIMENSION groups of the 32 thread culling kernels
+	static const UINT MAX_DISPATCH_INSTANCES = 65535u * 32u;
+	// D3D11_REQ_RESOURCE_SIZE_IN_MEGABYTES_EXPRESSION_A_TERM, the most a single buffer may take
+	static const UINT MAX_RESOURCE_BYTES = 128u * 1024u * 1024u;
+	// one transform per instance, the widest element any of the instance buffers hold
+	static const UINT DEFAULT_ELEMENT_SIZE = 64u;
+
+public:
+	InstanceBufferManager(UINT InitialCapacity = PAGE_SIZE, UINT ElementSize = DEFAULT_ELEMENT_SIZE);
+
+	// records the request and returns true if the capacity had to grow, the owner then recreates its buffers at GetCapacity().
+	// Anything past GetMaxCapacity() is clamped
+	bool Reserve(UINT Required);
+	// the owner could not create its buffers at the grown capacity, the next Reserve grows and tries again from nothing
+	void Invalidate() { m_Capacity = 0u; }
+
+	UINT GetCapacity() const { return m_Capacity; }
+	UINT GetMaxCapacity() const { return m_MaxCapacity; }
+	UINT GetHighWaterMark() const { return m_HighWaterMark; }
+	UINT GetGrowCount() const { return m_GrowCount; }
+
+	// double the current capacity or take the required one if that is bigger, rounded up to a whole page and clamped to MaxCapacity
+	static UINT ComputeGrownCapacity(UINT Current, UINT Required, UINT MaxCapacity);
+	// whole pages of ElementSize that fit in MAX_RESOURCE_BYTES
+	static UINT ComputeMaxCapacity(UINT ElementSize);
+	static void SplitIntoChunks(UINT Count, UINT ChunkSize, std::vector<Chunk>& OutChunks);
+
+private:
+	UINT m_Capacity;
+	UINT m_MaxCapacity;
+	UINT m_HighWaterMark;
+	UINT m_GrowCount;
+
+};
+
+#endif
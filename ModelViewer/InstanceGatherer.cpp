@@ -0,0 +1,83 @@
+#include "InstanceGatherer.h"
+#include "TransformStore.h"
+#include "ThreadPool.h"
+
+// below this many items per partition waking another thread costs more than the copies
+static const UINT MIN_ITEMS_PER_PARTITION = 2048u;
+
+InstanceGatherer::InstanceGatherer()
+{
+	m_ThreadCount = 0u;
+	m_LastPartitionCount = 0u;
+}
+
+void InstanceGatherer::Gather(const TransformStore& Store, const std::vector<Item>& Items, const std::vector<std::vector<DirectX::XMMATRIX>*>& Outputs)
+{
+	const UINT ItemCount = (UINT)Items.size();
+	const UINT OutputCount = (UINT)Outputs.size();
+	if (ItemCount == 0u || OutputCount == 0u)
+	{
+		m_LastPartitionCount = 0u;
+		return;
+	}
+
+	ThreadPool* Pool = ThreadPool::GetSingletonPtr();
+	UINT PartitionCount = m_ThreadCount > 0u ? m_ThreadCount : Pool->GetWorkerCount() + 1u;
+	const UINT MaxPartitions = (ItemCount + MIN_ITEMS_PER_PARTITION - 1u) / MIN_ITEMS_PER_PARTITION;
+	PartitionCount = PartitionCount < MaxPartitions ? PartitionCount : MaxPartitions;
+	m_LastPartitionCount = PartitionCount;
+
+	// nothing to split, appending directly skips the counting pass
+	if (PartitionCount == 1u)
+	{
+		for (const Item& It : Items)
+		{
+			Outputs[It.Output]->push_back(Store.GetTransposedWorldMatrix(It.TransformID));
+		}
+		return;
+	}
+
+	const UINT PartitionSize = (ItemCount + PartitionCount - 1u) / PartitionCount;
+	m_Offsets.assign(PartitionCount * OutputCount, 0u);
+
+	// one batch per partition, so a partition is always handled by a single thread
+	Pool->ParallelFor(PartitionCount, 1u, [&](UINT Begin, UINT End)
+		{
+			for (UINT p = Begin; p < End; p++)
+			{
+				UINT* Counts = &m_Offsets[p * OutputCount];
+				const UINT Last = (p + 1u) * PartitionSize < ItemCount ? (p + 1u) * PartitionSize : ItemCount;
+				for (UINT i = p * PartitionSize; i < Last; i++)
+				{
+					Counts[Items[i].Output]++;
+				}
+			}
+		});
+
+	// earlier partitions go first within each output, which keeps the serial order
+	for (UINT o = 0u; o < OutputCount; o++)
+	{
+		UINT Offset = (UINT)Outputs[o]->size();
+		for (UINT p = 0u; p < PartitionCount; p++)
+		{
+			const UINT Count = m_Offsets[p * OutputCount + o];
+			m_Offsets[p * OutputCount + o] = Offset;
+			Offset += Count;
+		}
+		Outputs[o]->resize(Offset);
+	}
+
+	Pool->ParallelFor(PartitionCount, 1u, [&](UINT Begin, UINT End)
+		{
+			for (UINT p = Begin; p < End; p++)
+			{
+				UINT* Cursors = &m_Offsets[p * OutputCount];
+				const UINT Last = (p + 1u) * PartitionSize < ItemCount ? (p + 1u) * PartitionSize : ItemCount;
+				for (UINT i = p * PartitionSize; i < Last; i++)
+				{
+					const Item& It = Items[i];
+					(*Outputs[It.Output])[Cursors[It.Output]++] = Store.GetTransposedWorldMatrix(It.TransformID);
+				}
+			}
+		});
+}
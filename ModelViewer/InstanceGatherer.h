@@ -0,0 +1,50 @@
+#pragma once
+
+#ifndef INSTANCE_GATHERER_H
+#define INSTANCE_GATHERER_H
+
+#include <vector>
+
+#include "DirectXMath.h"
+
+typedef unsigned int UINT;
+
+class TransformStore;
+
+/*
+*	Parallel replacement for pushing every model's world matrix into its ModelData one at a time. The items are split into contiguous
+*	partitions, one per thread. Each partition first counts its items per output, a prefix sum over those counts (partition by
+*	partition inside each output) gives every partition its own range in every output, and the partitions then copy their transposed
+*	world matrices straight into those ranges. No locks, and since the ranges follow the partition order the result is the same as a
+*	serial gather for any thread count. Pure CPU, no device needed.
+*/
+
+class InstanceGatherer
+{
+public:
+	struct Item
+	{
+		UINT Output;		// index into the outputs passed to Gather
+		UINT TransformID;
+	};
+
+public:
+	InstanceGatherer();
+
+	// appends the transposed world matrix of every item to its output, in item order
+	void Gather(const TransformStore& Store, const std::vector<Item>& Items, const std::vector<std::vector<DirectX::XMMATRIX>*>& Outputs);
+
+	// 0 uses every ThreadPool worker plus the calling thread
+	void SetThreadCount(UINT ThreadCount) { m_ThreadCount = ThreadCount; }
+	UINT GetThreadCount() const { return m_ThreadCount; }
+	UINT GetLastPartitionCount() const { return m_LastPartitionCount; }
+
+private:
+	std::vector<UINT> m_Offsets;	// partition * output count + output, counts first and write cursors after the prefix sum
+
+	UINT m_ThreadCount;
+	UINT m_LastPartitionCount;
+
+};
+
+#endif
@@ -23,6 +23,9 @@ bool InstancedShader::Initialise(ID3D11Device* Device)
 void InstancedShader::Shutdown()
 {
 	ResourceManager::GetSingletonPtr()->UnloadShader<ID3D11VertexShader>(m_vsFilename, "main");
+	ResourceManager::GetSingletonPtr()->UnloadShader<ID3D11VertexShader>(m_vsFilename, "PackedMain");
+	ResourceManager::GetSingletonPtr()->UnloadShader<ID3D11VertexShader>(m_vsFilename, "ClusterMain");
+	ResourceManager::GetSingletonPtr()->UnloadShader<ID3D11VertexShader>(m_vsFilename, "PackedClusterMain");
 	ResourceManager::GetSingletonPtr()->UnloadShader<ID3D11PixelShader>(m_psFilename, "main");
 }
 
@@ -30,12 +33,20 @@ bool InstancedShader::InitialiseShader(ID3D11Device* Device)
 {
 	HRESULT hResult;
 	Microsoft::WRL::ComPtr<ID3D10Blob> vsBuffer;
+	Microsoft::WRL::ComPtr<ID3D10Blob> PackedVSBuffer;
+	Microsoft::WRL::ComPtr<ID3D10Blob> ClusterVSBuffer;
+	Microsoft::WRL::ComPtr<ID3D10Blob> PackedClusterVSBuffer;
 	D3D11_BUFFER_DESC MatrixBufferDesc = {};
 	D3D11_BUFFER_DESC LightBufferDesc = {};
-	D3D11_INPUT_ELEMENT_DESC VertexLayout[3] = {};
+	// the last element is the cluster draws' instance stream, the plain layouts leave it out
+	D3D11_INPUT_ELEMENT_DESC VertexLayout[4] = {};
+	D3D11_INPUT_ELEMENT_DESC PackedVertexLayout[4] = {};
 	unsigned int NumElements;
 
 	m_VertexShader = ResourceManager::GetSingletonPtr()->LoadShader<ID3D11VertexShader>(m_vsFilename, "main", vsBuffer);
+	m_PackedVertexShader = ResourceManager::GetSingletonPtr()->LoadShader<ID3D11VertexShader>(m_vsFilename, "PackedMain", PackedVSBuffer);
+	m_ClusterVertexShader = ResourceManager::GetSingletonPtr()->LoadShader<ID3D11VertexShader>(m_vsFilename, "ClusterMain", ClusterVSBuffer);
+	m_PackedClusterVertexShader = ResourceManager::GetSingletonPtr()->LoadShader<ID3D11VertexShader>(m_vsFilename, "PackedClusterMain", PackedClusterVSBuffer);
 	m_PixelShader = ResourceManager::GetSingletonPtr()->LoadShader<ID3D11PixelShader>(m_psFilename, "main");
 
 	VertexLayout[0].Format = DXGI_FORMAT_R32G32B32_FLOAT;
@@ -62,11 +73,55 @@ bool InstancedShader::InitialiseShader(ID3D11Device* Device)
 	VertexLayout[2].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
 	VertexLayout[2].InstanceDataStepRate = 0;
 
-	NumElements = _countof(VertexLayout);
+	VertexLayout[3].Format = DXGI_FORMAT_R32_UINT;
+	VertexLayout[3].SemanticName = "INSTANCE";
+	VertexLayout[3].SemanticIndex = 0;
+	VertexLayout[3].InputSlot = 1;
+	VertexLayout[3].InputSlotClass = D3D11_INPUT_PER_INSTANCE_DATA;
+	VertexLayout[3].AlignedByteOffset = 0;
+	VertexLayout[3].InstanceDataStepRate = 1;
+
+	NumElements = _countof(VertexLayout) - 1u;
 
 	HFALSE_IF_FAILED(Device->CreateInputLayout(VertexLayout, NumElements, vsBuffer->GetBufferPointer(), vsBuffer->GetBufferSize(), &m_InputLayout));
 	NAME_D3D_RESOURCE(m_InputLayout, "Instanced shader input layout");
 
+	HFALSE_IF_FAILED(Device->CreateInputLayout(VertexLayout, _countof(VertexLayout), ClusterVSBuffer->GetBufferPointer(), ClusterVSBuffer->GetBufferSize(), &m_ClusterInputLayout));
+	NAME_D3D_RESOURCE(m_ClusterInputLayout, "Instanced shader cluster input layout");
+
+	// PackedVertex, the input assembler does the unorm, snorm and half conversions
+	PackedVertexLayout[0].Format = DXGI_FORMAT_R16G16B16A16_UNORM;
+	PackedVertexLayout[0].SemanticName = "POSITION";
+	PackedVertexLayout[0].SemanticIndex = 0;
+	PackedVertexLayout[0].InputSlot = 0;
+	PackedVertexLayout[0].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+	PackedVertexLayout[0].AlignedByteOffset = 0;
+	PackedVertexLayout[0].InstanceDataStepRate = 0;
+
+	PackedVertexLayout[1].Format = DXGI_FORMAT_R16G16_SNORM;
+	PackedVertexLayout[1].SemanticName = "NORMAL";
+	PackedVertexLayout[1].SemanticIndex = 0;
+	PackedVertexLayout[1].InputSlot = 0;
+	PackedVertexLayout[1].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+	PackedVertexLayout[1].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
+	PackedVertexLayout[1].InstanceDataStepRate = 0;
+
+	PackedVertexLayout[2].Format = DXGI_FORMAT_R16G16_FLOAT;
+	PackedVertexLayout[2].SemanticName = "TEXCOORD";
+	PackedVertexLayout[2].SemanticIndex = 0;
+	PackedVertexLayout[2].InputSlot = 0;
+	PackedVertexLayout[2].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+	PackedVertexLayout[2].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
+	PackedVertexLayout[2].InstanceDataStepRate = 0;
+
+	PackedVertexLayout[3] = VertexLayout[3];
+
+	HFALSE_IF_FAILED(Device->CreateInputLayout(PackedVertexLayout, _countof(PackedVertexLayout) - 1u, PackedVSBuffer->GetBufferPointer(), PackedVSBuffer->GetBufferSize(), &m_PackedInputLayout));
+	NAME_D3D_RESOURCE(m_PackedInputLayout, "Instanced shader packed input layout");
+
+	HFALSE_IF_FAILED(Device->CreateInputLayout(PackedVertexLayout, _countof(PackedVertexLayout), PackedClusterVSBuffer->GetBufferPointer(), PackedClusterVSBuffer->GetBufferSize(), &m_PackedClusterInputLayout));
+	NAME_D3D_RESOURCE(m_PackedClusterInputLayout, "Instanced shader packed cluster input layout");
+
 	MatrixBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
 	MatrixBufferDesc.ByteWidth = sizeof(MatrixBuffer);
 	MatrixBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
@@ -153,4 +208,26 @@ void InstancedShader::ActivateShader(ID3D11DeviceContext* DeviceContext)
 
 	DeviceContext->VSSetShader(m_VertexShader, NULL, 0u);
 	DeviceContext->PSSetShader(m_PixelShader, NULL, 0u);
+	m_ActiveVertexFormat = VertexFormat::Full;
+	m_bActiveInstanceStream = false;
+}
+
+void InstancedShader::SetVertexFormat(ID3D11DeviceContext* DeviceContext, VertexFormat Format, bool bInstanceStream)
+{
+	if (Format == m_ActiveVertexFormat && bInstanceStream == m_bActiveInstanceStream)
+		return;
+
+	const bool bPacked = Format == VertexFormat::Packed;
+	if (bInstanceStream)
+	{
+		DeviceContext->IASetInputLayout(bPacked ? m_PackedClusterInputLayout.Get() : m_ClusterInputLayout.Get());
+		DeviceContext->VSSetShader(bPacked ? m_PackedClusterVertexShader : m_ClusterVertexShader, NULL, 0u);
+	}
+	else
+	{
+		DeviceContext->IASetInputLayout(bPacked ? m_PackedInputLayout.Get() : m_InputLayout.Get());
+		DeviceContext->VSSetShader(bPacked ? m_PackedVertexShader : m_VertexShader, NULL, 0u);
+	}
+	m_ActiveVertexFormat = Format;
+	m_bActiveInstanceStream = bInstanceStream;
 }
@@ -59,6 +59,9 @@ public:
 	void Shutdown();
 
 	void ActivateShader(ID3D11DeviceContext* DeviceContext);
+	// swaps the vertex shader and input layout for a model's vertex buffer, ActivateShader starts with Full. With bInstanceStream the
+	// transform index of every instance comes from a UINT per instance in vertex buffer slot 1 instead of SV_InstanceID
+	void SetVertexFormat(ID3D11DeviceContext* DeviceContext, VertexFormat Format, bool bInstanceStream = false);
 	bool SetShaderParameters(ID3D11DeviceContext* DeviceContext, const DirectX::XMMATRIX& View, const DirectX::XMMATRIX& Projection, const DirectX::XMFLOAT3& CameraPos,
 		const std::vector<PointLight*>& PointLights, const std::vector<DirectionalLight*>& DirLights, const DirectX::XMFLOAT3& SkylightColor);
 
@@ -69,8 +72,16 @@ private:
 
 private:
 	ID3D11VertexShader* m_VertexShader;
+	ID3D11VertexShader* m_PackedVertexShader;
+	ID3D11VertexShader* m_ClusterVertexShader;
+	ID3D11VertexShader* m_PackedClusterVertexShader;
 	ID3D11PixelShader* m_PixelShader;
 	Microsoft::WRL::ComPtr<ID3D11InputLayout> m_InputLayout;
+	Microsoft::WRL::ComPtr<ID3D11InputLayout> m_PackedInputLayout;
+	Microsoft::WRL::ComPtr<ID3D11InputLayout> m_ClusterInputLayout;
+	Microsoft::WRL::ComPtr<ID3D11InputLayout> m_PackedClusterInputLayout;
+	VertexFormat m_ActiveVertexFormat = VertexFormat::Full;
+	bool m_bActiveInstanceStream = false;
 	Microsoft::WRL::ComPtr<ID3D11Buffer> m_MatrixBuffer;
 	Microsoft::WRL::ComPtr<ID3D11Buffer> m_LightingBuffer;
 
@@ -0,0 +1,128 @@
+#include <cmath>
+
+#include "LODSelector.h"
+#include "ScreenSizeCuller.h"
+
+LODSelector::LODSelector()
+{
+	m_Errors[0] = 0.f;
+	m_LevelCount = 1u;
+	m_CameraPos = { 0.f, 0.f, 0.f };
+	m_PixelScale = 1.f;
+	m_PixelError = 1.f;
+	m_Hysteresis = 0.f;
+
+	for (UINT l = 0u; l < MAX_MESH_LODS; l++)
+	{
+		m_LevelFirstInstance[l] = 0u;
+		m_LevelInstanceCounts[l] = 0u;
+	}
+}
+
+void LODSelector::SetLevels(const float* Errors, UINT LevelCount)
+{
+	m_LevelCount = LevelCount < MAX_MESH_LODS ? LevelCount : MAX_MESH_LODS;
+	m_LevelCount = m_LevelCount > 0u ? m_LevelCount : 1u;
+	m_Errors[0] = 0.f;
+	for (UINT l = 1u; l < m_LevelCount; l++)
+	{
+		m_Errors[l] = Errors[l];
+	}
+}
+
+void LODSelector::SetView(const DirectX::XMFLOAT3& CameraPos, float PixelScale, float PixelError, float Hysteresis)
+{
+	m_CameraPos = CameraPos;
+	m_PixelScale = PixelScale;
+	m_PixelError = PixelError;
+	m_Hysteresis = Hysteresis;
+}
+
+void LODSelector::Reset()
+{
+	m_InstanceLevels.clear();
+}
+
+UINT LODSelector::SelectLevel(float ErrorScale, UINT PreviousLevel) const
+{
+	// levels are sorted by error, so the coarsest level under a threshold is the last one under it
+	UINT Coarsest = 0u;
+	UINT Finest = 0u;
+	UINT Best = 0u;
+	for (UINT l = 1u; l < m_LevelCount; l++)
+	{
+		const float Pixels = m_Errors[l] * ErrorScale;
+		Coarsest = Pixels <= m_PixelError * (1.f - m_Hysteresis) ? l : Coarsest;
+		Best = Pixels <= m_PixelError ? l : Best;
+		Finest = Pixels <= m_PixelError * (1.f + m_Hysteresis) ? l : Finest;
+	}
+
+	if (PreviousLevel >= m_LevelCount)
+		return Best;
+
+	// anything between the two thresholds keeps the level it had
+	return PreviousLevel < Coarsest ? Coarsest : (PreviousLevel > Finest ? Finest : PreviousLevel);
+}
+
+void LODSelector::Select(const DirectX::XMMATRIX* Transforms, UINT Count, const AABB& BBox, const std::vector<UINT>& Indices, std::vector<UINT>& OutIndices)
+{
+	// instances were added or removed, their old levels no longer line up
+	if (m_InstanceLevels.size() != Count)
+	{
+		m_InstanceLevels.assign(Count, (unsigned char)MAX_MESH_LODS);
+	}
+
+	const float ex = (BBox.Max.x - BBox.Min.x) * 0.5f;
+	const float ey = (BBox.Max.y - BBox.Min.y) * 0.5f;
+	const float ez = (BBox.Max.z - BBox.Min.z) * 0.5f;
+	const float LocalRadius = sqrtf(ex * ex + ey * ey + ez * ez);
+
+	for (UINT l = 0u; l < MAX_MESH_LODS; l++)
+	{
+		m_LevelInstanceCounts[l] = 0u;
+	}
+
+	m_SelectedLevels.resize(Indices.size());
+	for (size_t i = 0; i < Indices.size(); i++)
+	{
+		DirectX::XMFLOAT3 Center;
+		float Radius;
+		ScreenSizeCuller::GetBoundingSphere(BBox, Transforms[Indices[i]], Center, Radius);
+
+		// the near side of the sphere is the closest any of the error can be, inside it only the full model will do
+		const float dx = Center.x - m_CameraPos.x;
+		const float dy = Center.y - m_CameraPos.y;
+		const float dz = Center.z - m_CameraPos.z;
+		const float Distance = sqrtf(dx * dx + dy * dy + dz * dz) - Radius;
+
+		UINT Level = 0u;
+		if (Distance > 0.f)
+		{
+			const float Scale = LocalRadius > 0.f ? Radius / LocalRadius : 1.f;
+			Level = SelectLevel(Scale * m_PixelScale / Distance, m_InstanceLevels[Indices[i]]);
+		}
+
+		m_InstanceLevels[Indices[i]] = (unsigned char)Level;
+		m_SelectedLevels[i] = Level;
+		m_LevelInstanceCounts[Level]++;
+	}
+
+	UINT First = 0u;
+	for (UINT l = 0u; l < MAX_MESH_LODS; l++)
+	{
+		m_LevelFirstInstance[l] = First;
+		First += m_LevelInstanceCounts[l];
+	}
+
+	// counting sort, stable so the culled order is kept inside each level
+	OutIndices.resize(Indices.size());
+	UINT Fill[MAX_MESH_LODS];
+	for (UINT l = 0u; l < MAX_MESH_LODS; l++)
+	{
+		Fill[l] = m_LevelFirstInstance[l];
+	}
+	for (size_t i = 0; i < Indices.size(); i++)
+	{
+		OutIndices[Fill[m_SelectedLevels[i]]++] = Indices[i];
+	}
+}
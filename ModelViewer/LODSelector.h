@@ -0,0 +1,66 @@
+#pragma once
+
+#ifndef LOD_SELECTOR_H
+#define LOD_SELECTOR_H
+
+#include <vector>
+
+#include "DirectXMath.h"
+
+#include "Common.h"
+#include "AABB.h"
+
+typedef unsigned int UINT;
+
+/*
+*	Per instance level of detail selection for one model. An instance gets the coarsest level whose geometric error, scaled by the
+*	instance's largest axis scale and projected at the distance from the camera to the near side of its bounding sphere, stays under
+*	the pixel threshold. The level each instance had last time is kept, an instance only goes coarser once the error is under the
+*	threshold by the hysteresis fraction and only goes finer once it is over by the same fraction, so an instance sitting at a switch
+*	distance does not flicker between levels. Instances are handed back grouped by level so every level is one instanced draw.
+*	Pure CPU, no device needed.
+*/
+
+class LODSelector
+{
+public:
+	LODSelector();
+
+	// Errors[0] is the full model and always 0, the rest have to be non decreasing, in the model's local units
+	void SetLevels(const float* Errors, UINT LevelCount);
+	// PixelScale turns error / distance into pixels, see ScreenSizeCuller::ComputePixelScale
+	void SetView(const DirectX::XMFLOAT3& CameraPos, float PixelScale, float PixelError, float Hysteresis);
+	// forgets every instance's last level, the next Select picks without hysteresis
+	void Reset();
+
+	// Transforms in the same (transposed) layout as ModelData::m_Transforms, Count of them, only the instances in Indices are looked
+	// at. OutIndices gets them grouped by level, finest first, in their original order within a level
+	void Select(const DirectX::XMMATRIX* Transforms, UINT Count, const AABB& BBox, const std::vector<UINT>& Indices, std::vector<UINT>& OutIndices);
+
+	UINT GetLevelCount() const { return m_LevelCount; }
+	// where each level's instances start in the last Select's OutIndices and how many there are
+	UINT GetLevelFirstInstance(UINT Level) const { return m_LevelFirstInstance[Level]; }
+	UINT GetLevelInstanceCount(UINT Level) const { return m_LevelInstanceCounts[Level]; }
+	// the level instance Index of the transforms got in the last Select, only meaningful for instances it was given
+	UINT GetInstanceLevel(UINT Index) const { return m_InstanceLevels[Index]; }
+
+	// ErrorScale is the pixels one unit of error covers for the instance, PreviousLevel is MAX_MESH_LODS for an instance without one
+	UINT SelectLevel(float ErrorScale, UINT PreviousLevel) const;
+
+private:
+	float m_Errors[MAX_MESH_LODS];
+	UINT m_LevelCount;
+
+	DirectX::XMFLOAT3 m_CameraPos;
+	float m_PixelScale;
+	float m_PixelError;
+	float m_Hysteresis;
+
+	std::vector<unsigned char> m_InstanceLevels;
+	std::vector<UINT> m_SelectedLevels;
+	UINT m_LevelFirstInstance[MAX_MESH_LODS];
+	UINT m_LevelInstanceCounts[MAX_MESH_LODS];
+
+};
+
+#endif
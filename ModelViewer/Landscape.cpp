@@ -12,6 +12,7 @@
 #include "Common.h"
 #include "Grass.h"
 #include "FrustumCuller.h"
+#include "Frustum.h"
 
 Landscape::Landscape(UINT ChunkDimension, float ChunkSize, float HeightDisplacement)
 	: m_ChunkDimension(ChunkDimension), m_ChunkSize(ChunkSize), m_NumChunks(ChunkDimension * ChunkDimension), m_HeightDisplacement(HeightDisplacement)
@@ -24,7 +25,8 @@ Landscape::Landscape(UINT ChunkDimension, float ChunkSize, float HeightDisplacem
 	m_bVisualiseChunks = false;
 	m_HeightmapSRV = nullptr;
 	m_ChunkInstanceCount = 0u;
-	assert(m_NumChunks >= 0 && m_NumChunks <= MAX_PLANE_CHUNKS);
+	m_HeightmapWidth = 0u;
+	m_HeightmapHeight = 0u;
 }
 
 Landscape::~Landscape()
@@ -39,6 +41,7 @@ bool Landscape::Init(const std::string& HeightMapFilepath, float TessellationSca
 	SetupAABB();
 	GenerateChunkOffsets();
 	GenerateGrassOffsets(GrassDimensionPerChunk);
+	FALSE_IF_FAILED(BuildQuadtree(HeightMapFilepath));
 
 	FALSE_IF_FAILED(CreateBuffers());
 
@@ -66,9 +69,15 @@ void Landscape::SetupAABB()
 void Landscape::Render()
 {	
 	Application* pApp = Application::GetSingletonPtr();
-	pApp->GetFrustumCuller()->DispatchShader(m_ChunkOffsets, m_BoundingBox.Corners, m_ChunkScaleMatrix);
-	m_ChunkInstanceCount = pApp->GetFrustumCuller()->GetInstanceCounts()[0];
-	
+
+	// cull against the main camera so the debug camera can inspect the culled result, the count is known here without a read back
+	const std::shared_ptr<Camera>& MainCamera = pApp->GetMainCamera();
+	m_VisibleChunks.clear();
+	m_Quadtree.Query(Frustum(MainCamera->GetViewProjMatrix()), m_HeightDisplacement, MainCamera->GetPosition(), m_VisibleChunks);
+	m_ChunkInstanceCount = (UINT)m_VisibleChunks.size();
+	pApp->GetRenderStatsRef().LandscapeNodesVisited = m_Quadtree.GetLastNodesVisited();
+	pApp->GetRenderStatsRef().LandscapeChunksVisible = m_ChunkInstanceCount;
+
 	if (m_ChunkInstanceCount == 0u)
 		return;
 
@@ -121,34 +130,44 @@ void Landscape::RenderControls()
 
 void Landscape::SetHeightDisplacement(float NewHeight)
 {
+	// the quadtree keeps normalized heights, nothing to rebuild
 	m_HeightDisplacement = NewHeight;
 	SetupAABB();
 }
 
+bool Landscape::BuildQuadtree(const std::string& HeightMapFilepath)
+{
+	if (!ResourceManager::GetSingletonPtr()->LoadHeightmapData(HeightMapFilepath, m_Heights, m_HeightmapWidth, m_HeightmapHeight))
+		return false;
+
+	m_Quadtree.Build(m_Heights.data(), m_HeightmapWidth, m_HeightmapHeight, m_ChunkDimension, m_ChunkSize);
+	m_VisibleChunks.reserve(m_NumChunks);
+	return true;
+}
+
 bool Landscape::CreateBuffers()
 {
 	HRESULT hResult;
 	D3D11_BUFFER_DESC Desc = {};
 
-	Desc.Usage = D3D11_USAGE_IMMUTABLE;
+	// written every frame with the offsets of the visible chunks only, sized for all of them being visible
+	Desc.Usage = D3D11_USAGE_DYNAMIC;
 	Desc.ByteWidth = sizeof(DirectX::XMFLOAT2) * m_NumChunks;
 	Desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	Desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 	Desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
 	Desc.StructureByteStride = sizeof(DirectX::XMFLOAT2);
 
-	D3D11_SUBRESOURCE_DATA Data = {};
-	Data.pSysMem = m_ChunkOffsets.data();
-
-	HFALSE_IF_FAILED(Graphics::GetSingletonPtr()->GetDevice()->CreateBuffer(&Desc, &Data, &m_ChunkOffsetsBuffer));
-	NAME_D3D_RESOURCE(m_ChunkOffsetsBuffer, "Landscape chunk offsets buffer");
+	HFALSE_IF_FAILED(Graphics::GetSingletonPtr()->GetDevice()->CreateBuffer(&Desc, nullptr, &m_VisibleOffsetsBuffer));
+	NAME_D3D_RESOURCE(m_VisibleOffsetsBuffer, "Landscape visible chunk offsets buffer");
 
 	D3D11_SHADER_RESOURCE_VIEW_DESC SRVDesc = {};
 	SRVDesc.Format = DXGI_FORMAT_UNKNOWN;
 	SRVDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
 	SRVDesc.Buffer.NumElements = m_NumChunks;
 
-	HFALSE_IF_FAILED(Graphics::GetSingletonPtr()->GetDevice()->CreateShaderResourceView(m_ChunkOffsetsBuffer.Get(), &SRVDesc, &m_ChunkOffsetsSRV));
-	NAME_D3D_RESOURCE(m_ChunkOffsetsSRV, "Chunk offsets buffer SRV");
+	HFALSE_IF_FAILED(Graphics::GetSingletonPtr()->GetDevice()->CreateShaderResourceView(m_VisibleOffsetsBuffer.Get(), &SRVDesc, &m_VisibleOffsetsSRV));
+	NAME_D3D_RESOURCE(m_VisibleOffsetsSRV, "Landscape visible chunk offsets buffer SRV");
 
 	Desc = {};
 	Desc.Usage = D3D11_USAGE_DYNAMIC;
@@ -180,7 +199,7 @@ void Landscape::UpdateBuffers()
 	LandscapeInfoCBuffer* LandscapeInfoCBufferPtr;
 	ID3D11DeviceContext* DeviceContext = Graphics::GetSingletonPtr()->GetDeviceContext();
 
-	std::shared_ptr<Camera> pCamera = Application::GetSingletonPtr()->GetActiveCamera();
+	const std::shared_ptr<Camera>& pCamera = Application::GetSingletonPtr()->GetActiveCamera();
 	DirectX::XMFLOAT3 CameraPos = pCamera->GetPosition();
 	DirectX::XMMATRIX View, Proj;
 	pCamera->GetViewMatrix(View);
@@ -191,6 +210,14 @@ void Landscape::UpdateBuffers()
 	CameraCBufferPtr->ViewProj = DirectX::XMMatrixTranspose(View * Proj);
 	DeviceContext->Unmap(m_CameraCBuffer.Get(), 0u);
 
+	ASSERT_NOT_FAILED(DeviceContext->Map(m_VisibleOffsetsBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0, &MappedResource));
+	DirectX::XMFLOAT2* OffsetsPtr = (DirectX::XMFLOAT2*)MappedResource.pData;
+	for (UINT i = 0u; i < m_ChunkInstanceCount; i++)
+	{
+		OffsetsPtr[i] = m_ChunkOffsets[m_VisibleChunks[i]];
+	}
+	DeviceContext->Unmap(m_VisibleOffsetsBuffer.Get(), 0u);
+
 	CullingCBuffer CullingBufferData = {};
 	PrepCullingBuffer(CullingBufferData);
 	ASSERT_NOT_FAILED(DeviceContext->Map(m_CullingCBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0, &MappedResource));
@@ -199,7 +226,7 @@ void Landscape::UpdateBuffers()
 
 	ASSERT_NOT_FAILED(DeviceContext->Map(m_LandscapeInfoCBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0, &MappedResource));
 	LandscapeInfoCBufferPtr = (LandscapeInfoCBuffer*)MappedResource.pData;
-	LandscapeInfoCBufferPtr->PlaneDimension = (float)m_ChunkDimension * m_ChunkSize;
+	LandscapeInfoCBufferPtr->PlaneDimension = GetPlaneDimension();
 	LandscapeInfoCBufferPtr->HeightDisplacement = m_HeightDisplacement;
 	LandscapeInfoCBufferPtr->bVisualiseChunks = m_bVisualiseChunks;
 	LandscapeInfoCBufferPtr->ChunkInstanceCount = m_ChunkInstanceCount;
@@ -266,34 +293,10 @@ void Landscape::GenerateGrassOffsets(UINT GrassCount)
 	}
 }
 
-void Landscape::PrepCullingBuffer(CullingCBuffer& CullingBufferData, bool bNormalise)
+void Landscape::PrepCullingBuffer(CullingCBuffer& CullingBufferData)
 {
-	CullingBufferData.FrustumCameraViewProj = DirectX::XMMatrixTranspose(Application::GetSingletonPtr()->GetMainCamera()->GetViewProjMatrix()); // Row-major access
-
-	// Each row of the matrix
-	DirectX::XMVECTOR row0 = CullingBufferData.FrustumCameraViewProj.r[0];
-	DirectX::XMVECTOR row1 = CullingBufferData.FrustumCameraViewProj.r[1];
-	DirectX::XMVECTOR row2 = CullingBufferData.FrustumCameraViewProj.r[2];
-	DirectX::XMVECTOR row3 = CullingBufferData.FrustumCameraViewProj.r[3];
-
-	DirectX::XMVECTOR FrustumPlanes[6];
-	FrustumPlanes[0] = DirectX::XMVectorAdd(row3, row0); // Left
-	FrustumPlanes[1] = DirectX::XMVectorAdd(row3, row0); // Right
-	FrustumPlanes[2] = DirectX::XMVectorAdd(row3, row1); // Bottom
-	FrustumPlanes[3] = DirectX::XMVectorAdd(row3, row1); // Top
-	FrustumPlanes[4] = DirectX::XMVectorAdd(row3, row2); // Near
-	FrustumPlanes[5] = DirectX::XMVectorAdd(row3, row2); // Far
-
-	if (bNormalise)
-	{
-		for (int i = 0; i < 6; ++i)
-		{
-			FrustumPlanes[i] = DirectX::XMPlaneNormalize(FrustumPlanes[i]);
-		}
-	}
+	const DirectX::XMMATRIX ViewProj = Application::GetSingletonPtr()->GetMainCamera()->GetViewProjMatrix();
+	CullingBufferData.FrustumCameraViewProj = DirectX::XMMatrixTranspose(ViewProj); // Row-major access
 
-	for (int i = 0; i < 6; ++i)
-	{
-		DirectX::XMStoreFloat4(&CullingBufferData.FrustumPlanes[i], FrustumPlanes[i]);
-	}
+	memcpy(CullingBufferData.FrustumPlanes, Frustum(ViewProj).GetPlanes(), sizeof(CullingBufferData.FrustumPlanes));
 }
@@ -10,6 +10,7 @@
 
 #include "GameObject.h"
 #include "AABB.h"
+#include "LandscapeQuadtree.h"
 
 class Landscape : public GameObject
 {
@@ -62,6 +63,10 @@ public:
 	const DirectX::XMMATRIX& GetChunkScaleMatrix() const { return m_ChunkScaleMatrix; }
 	UINT GetChunkInstanceCount() const { return m_ChunkInstanceCount; }
 	UINT GetChunkDimension() const { return m_ChunkDimension; }
+	float GetPlaneDimension() const { return (float)m_ChunkDimension * m_ChunkSize; }
+	// visible chunk ids from the last Render, nearest first
+	const std::vector<UINT>& GetVisibleChunks() const { return m_VisibleChunks; }
+	const LandscapeQuadtree& GetQuadtree() const { return m_Quadtree; }
 
 	std::shared_ptr<TessellatedPlane> GetPlane() { return m_Plane; }
 	std::shared_ptr<Grass> GetGrass() { return m_Grass; }
@@ -76,21 +81,29 @@ private:
 
 	void UpdateBuffers();
 
+	bool BuildQuadtree(const std::string& HeightMapFilepath);
 	void GenerateChunkOffsets();
 	void GenerateGrassOffsets(UINT GrassCount);
-	void PrepCullingBuffer(CullingCBuffer& CullingBufferData, bool bNormalise = true);
+	void PrepCullingBuffer(CullingCBuffer& CullingBufferData);
 
 private:
 	Microsoft::WRL::ComPtr<ID3D11Buffer> m_LandscapeInfoCBuffer;
 	Microsoft::WRL::ComPtr<ID3D11Buffer> m_CullingCBuffer;
 	Microsoft::WRL::ComPtr<ID3D11Buffer> m_CameraCBuffer;
-	Microsoft::WRL::ComPtr<ID3D11Buffer> m_ChunkOffsetsBuffer;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_ChunkOffsetsSRV;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> m_VisibleOffsetsBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_VisibleOffsetsSRV;
 
 	std::shared_ptr<TessellatedPlane> m_Plane;
 	std::shared_ptr<Grass> m_Grass;
 	std::vector<DirectX::XMFLOAT2> m_ChunkOffsets;
 	std::vector<DirectX::XMFLOAT2> m_GrassOffsets;
+	std::vector<UINT> m_VisibleChunks;
+
+	LandscapeQuadtree m_Quadtree;
+	// CPU copy of the heightmap, normalized like the shaders see it. The grass tiles are built from it as well
+	std::vector<float> m_Heights;
+	UINT m_HeightmapWidth;
+	UINT m_HeightmapHeight;
 
 	AABB m_BoundingBox;
 
@@ -0,0 +1,220 @@
+#include <cfloat>
+#include <cmath>
+
+#include "LandscapeQuadtree.h"
+
+// texels a bilinear sample anywhere in [Start, End] (normalized) can read from, clamped like the landscape sampler
+static void GetTexelRange(float Start, float End, UINT Size, UINT& OutFirst, UINT& OutLast)
+{
+	const int Last = (int)Size - 1;
+	int First = (int)floorf(Start * (float)Size - 0.5f);
+	int LastRead = (int)floorf(End * (float)Size - 0.5f) + 1;
+
+	First = First < 0 ? 0 : (First > Last ? Last : First);
+	LastRead = LastRead < 0 ? 0 : (LastRead > Last ? Last : LastRead);
+
+	OutFirst = (UINT)First;
+	OutLast = (UINT)LastRead;
+}
+
+void LandscapeQuadtree::Build(const float* Heights, UINT Width, UINT Height, UINT ChunkDimension, float ChunkSize)
+{
+	Clear();
+	if (ChunkDimension == 0u || Width == 0u || Height == 0u)
+		return;
+
+	m_ChunkDimension = ChunkDimension;
+	m_ChunkSize = ChunkSize;
+	m_ChunkHeights.resize(ChunkDimension * ChunkDimension);
+
+	// chunk x covers u in [x, x + 1] / ChunkDimension, v is flipped so chunk z covers [ChunkDimension - z - 1, ChunkDimension - z]
+	const float InvDimension = 1.f / (float)ChunkDimension;
+	for (UINT z = 0u; z < ChunkDimension; z++)
+	{
+		for (UINT x = 0u; x < ChunkDimension; x++)
+		{
+			m_ChunkHeights[z * ChunkDimension + x] = ComputeHeightRange(Heights, Width, Height, (float)x * InvDimension, (float)(x + 1u) * InvDimension,
+				(float)(ChunkDimension - z - 1u) * InvDimension, (float)(ChunkDimension - z) * InvDimension);
+		}
+	}
+
+	m_Nodes.reserve(ChunkDimension * ChunkDimension * 2u);
+	m_LeafChunks.reserve(ChunkDimension * ChunkDimension);
+	m_Nodes.push_back({ 0.f, 0.f, 0u, 0u, ChunkDimension, ChunkDimension, INVALID_NODE, 0u, 0u, 0u });
+	BuildNode(0u);
+}
+
+void LandscapeQuadtree::Clear()
+{
+	m_Nodes.clear();
+	m_LeafChunks.clear();
+	m_ChunkHeights.clear();
+	m_ChunkDimension = 0u;
+	m_LastNodesVisited = 0u;
+}
+
+void LandscapeQuadtree::BuildNode(UINT NodeIndex)
+{
+	// m_Nodes grows while the children are built, so only ever go through the index
+	const Node N = m_Nodes[NodeIndex];
+	m_Nodes[NodeIndex].FirstLeaf = (UINT)m_LeafChunks.size();
+
+	if (N.X1 - N.X0 == 1u && N.Z1 - N.Z0 == 1u)
+	{
+		const UINT ChunkID = N.Z0 * m_ChunkDimension + N.X0;
+		m_LeafChunks.push_back(ChunkID);
+
+		Node& Leaf = m_Nodes[NodeIndex];
+		Leaf.MinHeight = m_ChunkHeights[ChunkID].x;
+		Leaf.MaxHeight = m_ChunkHeights[ChunkID].y;
+		Leaf.LeafCount = 1u;
+		return;
+	}
+
+	// odd sizes leave one half empty along an axis of width 1, those children are skipped
+	const UINT MidX = N.X0 + (N.X1 - N.X0) / 2u;
+	const UINT MidZ = N.Z0 + (N.Z1 - N.Z0) / 2u;
+	const UINT XRanges[2][2] = { { N.X0, MidX }, { MidX, N.X1 } };
+	const UINT ZRanges[2][2] = { { N.Z0, MidZ }, { MidZ, N.Z1 } };
+
+	const UINT FirstChild = (UINT)m_Nodes.size();
+	for (int z = 0; z < 2; z++)
+	{
+		for (int x = 0; x < 2; x++)
+		{
+			if (XRanges[x][0] == XRanges[x][1] || ZRanges[z][0] == ZRanges[z][1])
+				continue;
+
+			m_Nodes.push_back({ 0.f, 0.f, XRanges[x][0], ZRanges[z][0], XRanges[x][1], ZRanges[z][1], INVALID_NODE, 0u, 0u, 0u });
+		}
+	}
+	const UINT ChildCount = (UINT)m_Nodes.size() - FirstChild;
+
+	float MinHeight = FLT_MAX;
+	float MaxHeight = -FLT_MAX;
+	for (UINT c = 0u; c < ChildCount; c++)
+	{
+		BuildNode(FirstChild + c);
+		MinHeight = m_Nodes[FirstChild + c].MinHeight < MinHeight ? m_Nodes[FirstChild + c].MinHeight : MinHeight;
+		MaxHeight = m_Nodes[FirstChild + c].MaxHeight > MaxHeight ? m_Nodes[FirstChild + c].MaxHeight : MaxHeight;
+	}
+
+	Node& Parent = m_Nodes[NodeIndex];
+	Parent.MinHeight = MinHeight;
+	Parent.MaxHeight = MaxHeight;
+	Parent.FirstChild = FirstChild;
+	Parent.ChildCount = ChildCount;
+	Parent.LeafCount = (UINT)m_LeafChunks.size() - Parent.FirstLeaf;
+}
+
+void LandscapeQuadtree::Query(const Frustum& ViewFrustum, float HeightDisplacement, const DirectX::XMFLOAT3& ViewPos, std::vector<UINT>& OutChunks) const
+{
+	m_LastNodesVisited = 0u;
+	if (m_Nodes.empty())
+		return;
+
+	struct StackEntry
+	{
+		UINT NodeIndex;
+		UINT PlaneMask;
+	};
+
+	std::vector<StackEntry> Stack;
+	Stack.reserve(64u);
+	Stack.push_back({ 0u, 0x3F });
+
+	while (!Stack.empty())
+	{
+		StackEntry Entry = Stack.back();
+		Stack.pop_back();
+		m_LastNodesVisited++;
+
+		const Node& N = m_Nodes[Entry.NodeIndex];
+		DirectX::XMFLOAT3 Center, Extent;
+		GetNodeBounds(N, HeightDisplacement, Center, Extent);
+		if (!ViewFrustum.TestAABB(Center, Extent, Entry.PlaneMask))
+			continue;
+
+		// fully inside or a single chunk, take the whole subtree
+		if (Entry.PlaneMask == 0u || N.IsLeaf())
+		{
+			OutChunks.insert(OutChunks.end(), m_LeafChunks.begin() + N.FirstLeaf, m_LeafChunks.begin() + N.FirstLeaf + N.LeafCount);
+			continue;
+		}
+
+		// sort the children by distance and push the nearest last so it is popped first
+		UINT Order[4];
+		float DistSq[4];
+		for (UINT c = 0u; c < N.ChildCount; c++)
+		{
+			DirectX::XMFLOAT3 ChildCenter, ChildExtent;
+			GetNodeBounds(m_Nodes[N.FirstChild + c], HeightDisplacement, ChildCenter, ChildExtent);
+			const float dx = ChildCenter.x - ViewPos.x;
+			const float dy = ChildCenter.y - ViewPos.y;
+			const float dz = ChildCenter.z - ViewPos.z;
+
+			UINT Slot = c;
+			const float d = dx * dx + dy * dy + dz * dz;
+			for (; Slot > 0u && DistSq[Slot - 1u] > d; Slot--)
+			{
+				DistSq[Slot] = DistSq[Slot - 1u];
+				Order[Slot] = Order[Slot - 1u];
+			}
+			DistSq[Slot] = d;
+			Order[Slot] = c;
+		}
+
+		for (UINT c = N.ChildCount; c > 0u; c--)
+		{
+			Stack.push_back({ N.FirstChild + Order[c - 1u], Entry.PlaneMask });
+		}
+	}
+}
+
+void LandscapeQuadtree::GetChunkBounds(UINT ChunkID, float HeightDisplacement, DirectX::XMFLOAT3& OutCenter, DirectX::XMFLOAT3& OutExtent) const
+{
+	const UINT x = ChunkID % m_ChunkDimension;
+	const UINT z = ChunkID / m_ChunkDimension;
+	const Node Chunk = { m_ChunkHeights[ChunkID].x, m_ChunkHeights[ChunkID].y, x, z, x + 1u, z + 1u, INVALID_NODE, 0u, 0u, 0u };
+	GetNodeBounds(Chunk, HeightDisplacement, OutCenter, OutExtent);
+}
+
+DirectX::XMFLOAT2 LandscapeQuadtree::ComputeHeightRange(const float* Heights, UINT Width, UINT Height, float U0, float U1, float V0, float V1)
+{
+	UINT Col0, Col1, Row0, Row1;
+	GetTexelRange(U0, U1, Width, Col0, Col1);
+	GetTexelRange(V0, V1, Height, Row0, Row1);
+
+	float MinHeight = Heights[Row0 * Width + Col0];
+	float MaxHeight = MinHeight;
+	for (UINT Row = Row0; Row <= Row1; Row++)
+	{
+		for (UINT Col = Col0; Col <= Col1; Col++)
+		{
+			const float h = Heights[Row * Width + Col];
+			MinHeight = h < MinHeight ? h : MinHeight;
+			MaxHeight = h > MaxHeight ? h : MaxHeight;
+		}
+	}
+
+	return { MinHeight, MaxHeight };
+}
+
+void LandscapeQuadtree::GetNodeBounds(const Node& N, float HeightDisplacement, DirectX::XMFLOAT3& OutCenter, DirectX::XMFLOAT3& OutExtent) const
+{
+	// same layout as Landscape::GenerateChunkOffsets, the grid is centered on the origin
+	const float Half = (float)m_ChunkDimension * 0.5f;
+	const float MinX = ((float)N.X0 - Half) * m_ChunkSize;
+	const float MaxX = ((float)N.X1 - Half) * m_ChunkSize;
+	const float MinZ = ((float)N.Z0 - Half) * m_ChunkSize;
+	const float MaxZ = ((float)N.Z1 - Half) * m_ChunkSize;
+
+	// a negative displacement flips the range
+	const float y0 = N.MinHeight * HeightDisplacement;
+	const float y1 = N.MaxHeight * HeightDisplacement;
+	const float MinY = y0 < y1 ? y0 : y1;
+	const float MaxY = y0 < y1 ? y1 : y0;
+
+	OutCenter = { (MinX + MaxX) * 0.5f, (MinY + MaxY) * 0.5f, (MinZ + MaxZ) * 0.5f };
+	OutExtent = { (MaxX - MinX) * 0.5f, (MaxY - MinY) * 0.5f, (MaxZ - MinZ) * 0.5f };
+}
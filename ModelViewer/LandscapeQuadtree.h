@@ -0,0 +1,76 @@
+#pragma once
+
+#ifndef LANDSCAPE_QUADTREE_H
+#define LANDSCAPE_QUADTREE_H
+
+#include <vector>
+
+#include "DirectXMath.h"
+
+#include "Frustum.h"
+
+typedef unsigned int UINT;
+
+/*
+*	Quadtree over the landscape chunk grid with the min and max heightmap value under every node. Chunk heights are taken from the
+*	texels the shaders can reach with bilinear filtering inside the chunk, so the bounds are tight but never too small. Heights are
+*	kept normalized and scaled by the displacement at query time, changing it does not need a rebuild. A query walks the tree with
+*	a plane mask, takes whole subtrees once they are fully inside and visits children nearest first, so the visible chunks come out
+*	roughly front to back. Pure CPU, no device needed.
+*/
+
+class LandscapeQuadtree
+{
+private:
+	struct Node
+	{
+		float MinHeight;
+		float MaxHeight;
+		UINT X0, Z0, X1, Z1;	// chunk range, end exclusive
+		UINT FirstChild;		// children are contiguous, INVALID_NODE for leaves
+		UINT ChildCount;
+		UINT FirstLeaf;			// chunks of the subtree are contiguous in m_LeafChunks
+		UINT LeafCount;
+
+		bool IsLeaf() const { return FirstChild == INVALID_NODE; }
+	};
+
+public:
+	static const UINT INVALID_NODE = 0xFFFFFFFF;
+
+public:
+	// Heights are row major with the first row at the far (+z) edge of the landscape, same as the heightmap texture
+	void Build(const float* Heights, UINT Width, UINT Height, UINT ChunkDimension, float ChunkSize);
+	void Clear();
+
+	// appends the visible chunk ids (z * ChunkDimension + x, the order of Landscape::GetChunkOffsets) to OutChunks
+	void Query(const Frustum& ViewFrustum, float HeightDisplacement, const DirectX::XMFLOAT3& ViewPos, std::vector<UINT>& OutChunks) const;
+
+	// normalized heightmap range under the chunk, x is the min and y the max
+	DirectX::XMFLOAT2 GetChunkHeightRange(UINT ChunkID) const { return m_ChunkHeights[ChunkID]; }
+	void GetChunkBounds(UINT ChunkID, float HeightDisplacement, DirectX::XMFLOAT3& OutCenter, DirectX::XMFLOAT3& OutExtent) const;
+
+	UINT GetNodeCount() const { return (UINT)m_Nodes.size(); }
+	UINT GetChunkCount() const { return (UINT)m_ChunkHeights.size(); }
+	UINT GetLastNodesVisited() const { return m_LastNodesVisited; }
+
+	// min (x) and max (y) of every heightmap value a bilinear sample inside the normalized rect [U0, U1] x [V0, V1] can return
+	static DirectX::XMFLOAT2 ComputeHeightRange(const float* Heights, UINT Width, UINT Height, float U0, float U1, float V0, float V1);
+
+private:
+	void BuildNode(UINT NodeIndex);
+	void GetNodeBounds(const Node& N, float HeightDisplacement, DirectX::XMFLOAT3& OutCenter, DirectX::XMFLOAT3& OutExtent) const;
+
+private:
+	std::vector<Node> m_Nodes;
+	std::vector<UINT> m_LeafChunks;
+	std::vector<DirectX::XMFLOAT2> m_ChunkHeights;
+
+	UINT m_ChunkDimension = 0u;
+	float m_ChunkSize = 0.f;
+
+	mutable UINT m_LastNodesVisited = 0u;
+
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include "Light.h"
+#include "ComponentRegistry.h"
 #include "ImGui/imgui.h"
 
 Light::Light()
@@ -37,6 +38,12 @@ PointLight::PointLight()
 	m_Radius = 10.f;
 
 	m_ComponentName = "Point Light";
+	m_Type = ComponentType::PointLight;
+}
+
+PointLight::~PointLight()
+{
+	UnregisterType();
 }
 
 void PointLight::RenderControls()
@@ -50,6 +57,16 @@ void PointLight::SetRadius(float Radius)
 	m_Radius = Radius;
 }
 
+void PointLight::RegisterType()
+{
+	ComponentRegistry<PointLight>::Register(this);
+}
+
+void PointLight::UnregisterType()
+{
+	ComponentRegistry<PointLight>::Unregister(this);
+}
+
 //////////////////////////////////////////////////////////////
 
 DirectionalLight::DirectionalLight()
@@ -57,6 +74,12 @@ DirectionalLight::DirectionalLight()
 	SetDirection(1.f, -1.f, 1.f);
 
 	m_ComponentName = "Directional Light";
+	m_Type = ComponentType::DirectionalLight;
+}
+
+DirectionalLight::~DirectionalLight()
+{
+	UnregisterType();
 }
 
 void DirectionalLight::RenderControls()
@@ -70,6 +93,16 @@ void DirectionalLight::RenderControls()
 	}
 }
 
+void DirectionalLight::RegisterType()
+{
+	ComponentRegistry<DirectionalLight>::Register(this);
+}
+
+void DirectionalLight::UnregisterType()
+{
+	ComponentRegistry<DirectionalLight>::Unregister(this);
+}
+
 void DirectionalLight::SetDirection(float x, float y, float z)
 {
 	DirectX::XMFLOAT3 Dir = { x, y, z };
@@ -19,6 +19,7 @@ public:
 
 	void SetDiffuseColor(float r, float g, float b);
 	void SetSpecularPower(float Power);
+	void SetActive(bool bActive) { m_bActive = bActive; }
 
 	const DirectX::XMFLOAT3 GetDiffuseColor() const { return m_DiffuseColor; }
 	float GetSpecularPower() const { return m_SpecularPower; }
@@ -35,6 +36,7 @@ class PointLight : public Light
 {
 public:
 	PointLight();
+	~PointLight();
 
 	virtual void RenderControls() override;
 
@@ -43,6 +45,10 @@ public:
 	DirectX::XMFLOAT3 GetPosition() const { return GetOwner()->GetPosition(); }
 	float GetRadius() const { return m_Radius; }
 
+protected:
+	virtual void RegisterType() override;
+	virtual void UnregisterType() override;
+
 private:
 	// DirectX::XMFLOAT3 m_Position; // can add this back when adding accumulated transform
 	float m_Radius;
@@ -53,6 +59,7 @@ class DirectionalLight : public Light
 {
 public:
 	DirectionalLight();
+	~DirectionalLight();
 
 	virtual void RenderControls() override;
 
@@ -60,6 +67,10 @@ public:
 
 	const DirectX::XMFLOAT3 GetDirection() const { return m_Dir; }
 
+protected:
+	virtual void RegisterType() override;
+	virtual void UnregisterType() override;
+
 private:
 	DirectX::XMFLOAT3 m_Dir;
 
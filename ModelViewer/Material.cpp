@@ -2,56 +2,44 @@
 #include "Graphics.h"
 #include "MyMacros.h"
 
-#include "assimp/material.h"
-
 #include "ResourceManager.h"
 #include "ModelData.h"
+#include "MeshCache.h"
 
 Material::Material(UINT Index, ModelData* pOwner) : m_uIndex(Index), m_pOwner(pOwner)
 {
 }
 
-void Material::LoadTextures(aiMaterial* MeshMat)
+void Material::LoadFromCache(const MeshCache& Cache, const MeshCacheMaterial& Record)
 {
-	m_Name = MeshMat->GetName().C_Str();
+	m_Name = Cache.GetString(Record.Name);
+	m_bTwoSided = Record.bTwoSided != 0u;
+	m_bOpaque = Record.bOpaque != 0u;
 
-	MeshMat->Get(AI_MATKEY_TWOSIDED, m_bTwoSided);
-	float Opacity = 0.f;
-	MeshMat->Get(AI_MATKEY_OPACITY, Opacity);
-	if (Opacity >= 1.f)
-	{
-		m_bOpaque = true;
-	}
-	
 	if (m_pOwner->GetTexturesPath().empty())
 	{
 		return;
 	}
 
-	aiString Path;
-	aiColor3D Color;
-	if (MeshMat->GetTexture(aiTextureType_DIFFUSE, 0, &Path) == AI_SUCCESS)
+	// the color is only used when there is no texture for the slot
+	const std::string DiffuseTexture = Cache.GetString(Record.DiffuseTexture);
+	if (!DiffuseTexture.empty())
 	{
-		std::string FullPath = m_pOwner->GetTexturesPath() + std::string(Path.C_Str());
-		LoadTexture(FullPath, m_DiffuseSRV);
+		LoadTexture(m_pOwner->GetTexturesPath() + DiffuseTexture, m_DiffuseSRV);
 	}
-	else if (MeshMat->Get(AI_MATKEY_COLOR_DIFFUSE, Color) == AI_SUCCESS)
+	else
 	{
-		m_DiffuseColor.x = Color.r;
-		m_DiffuseColor.y = Color.g;
-		m_DiffuseColor.z = Color.b;
+		m_DiffuseColor = Record.DiffuseColor;
 	}
 
-	if (MeshMat->GetTexture(aiTextureType_SPECULAR, 0, &Path) == AI_SUCCESS)
+	const std::string SpecularTexture = Cache.GetString(Record.SpecularTexture);
+	if (!SpecularTexture.empty())
 	{
-		std::string FullPath = m_pOwner->GetTexturesPath() + std::string(Path.C_Str());
-		LoadTexture(FullPath, m_SpecularSRV);
+		LoadTexture(m_pOwner->GetTexturesPath() + SpecularTexture, m_SpecularSRV);
 	}
-	else if (MeshMat->Get(AI_MATKEY_COLOR_SPECULAR, Color) == AI_SUCCESS)
+	else
 	{
-		m_Specular.x = Color.r;
-		m_Specular.y = Color.g;
-		m_Specular.z = Color.b;
+		m_Specular = Record.Specular;
 	}
 }
 
@@ -11,7 +11,9 @@
 
 #include "wrl.h"
 
-struct aiMaterial;
+class MeshCache;
+struct MeshCacheMaterial;
+class ModelData;
 
 struct MaterialData
 {
@@ -30,13 +32,14 @@ class Material
 public:
 	Material(UINT Index, ModelData* pOwner);
 
-	void LoadTextures(aiMaterial* MeshMat);
+	// texture paths in the record are relative to the owner's textures path, without one the material keeps its defaults
+	void LoadFromCache(const MeshCache& Cache, const MeshCacheMaterial& Record);
 	void LoadTexture(const std::string& Path, int& TextureIndex);
 	void CreateConstantBuffer();
 
 private:
-	DirectX::XMFLOAT3 m_DiffuseColor;
-	DirectX::XMFLOAT3 m_Specular;
+	DirectX::XMFLOAT3 m_DiffuseColor = { 1.f, 1.f, 1.f };
+	DirectX::XMFLOAT3 m_Specular = { 1.f, 1.f, 1.f };
 	int m_DiffuseSRV = -1;
 	int m_SpecularSRV = -1;
 	Microsoft::WRL::ComPtr<ID3D11Buffer> m_ConstantBuffer;
@@ -1,5 +1,3 @@
-#include "assimp/scene.h"
-
 #include "Mesh.h"
 #include "ModelData.h"
 #include "Node.h"
@@ -10,47 +8,22 @@ Mesh::Mesh(ModelData* pModel, Node* pNode) : m_pModel(pModel), m_pNode(pNode)
 {
 }
 
-void Mesh::ProcessMesh(aiMesh* SceneMesh)
+void Mesh::Initialise(const std::string& Name, std::shared_ptr<Material> pMaterial, UINT VerticesOffset, UINT IndicesOffset, UINT VertexCount, UINT IndexCount)
 {
-	// TODO: this is duplicating vertices, come back to this and optimise at some point
-	
-	m_Name = SceneMesh->mName.C_Str();
-	m_VerticesOffset = (UINT)m_pModel->GetVertices().size();
-	m_IndicesOffset = (UINT)m_pModel->GetIndices().size();
-	m_Material = m_pModel->GetMaterials()[SceneMesh->mMaterialIndex];
-
-	for (size_t i = 0; i < SceneMesh->mNumVertices; i++)
-	{
-		Vertex v;
-		v.Pos = DirectX::XMFLOAT3(SceneMesh->mVertices[i].x, SceneMesh->mVertices[i].y, SceneMesh->mVertices[i].z);
-		v.Normal = DirectX::XMFLOAT3(SceneMesh->mNormals[i].x, SceneMesh->mNormals[i].y, SceneMesh->mNormals[i].z);
+	m_Name = Name;
+	m_Material = pMaterial;
+	m_VerticesOffset = VerticesOffset;
+	m_IndicesOffset = IndicesOffset;
+	m_VertexCount = VertexCount;
+	m_IndexCount = IndexCount;
+	m_LODs[0] = { 0u, IndexCount, 0.f };
 
-		if (SceneMesh->mTextureCoords[0])
-		{
-			v.TexCoord = DirectX::XMFLOAT2(SceneMesh->mTextureCoords[0][i].x, SceneMesh->mTextureCoords[0][i].y);
-		}
-		else
-		{
-			v.TexCoord = DirectX::XMFLOAT2(0.f, 0.f);
-		}
-
-		UpdateBoundingBox(v.Pos);
-		m_pModel->GetVertices().push_back(v);
-	}
-	m_VertexCount = (UINT)m_pModel->GetVertices().size() - m_VerticesOffset;
-
-	for (size_t i = 0; i < SceneMesh->mNumFaces; i++)
-	{
-		aiFace Face = SceneMesh->mFaces[i];
-		for (size_t j = 0; j < Face.mNumIndices; j++)
-		{
-			m_pModel->GetIndices().push_back(Face.mIndices[j] + m_VerticesOffset);
-		}
-	}
-	m_IndexCount = (UINT)m_pModel->GetIndices().size() - m_IndicesOffset;
+	m_Quantization = VertexCompression::GetQuantization(m_pModel->GetVertices().data() + VerticesOffset, VertexCount);
 
 	bool bResult = CreateArgsBuffer();
 	assert(bResult);
+	bResult = CreateQuantizationBuffer();
+	assert(bResult);
 }
 
 bool Mesh::CreateArgsBuffer()
@@ -66,7 +39,7 @@ bool Mesh::CreateArgsBuffer()
 	ArgsData.IndexCountPerInstance = m_IndexCount;
 	ArgsData.InstanceCount = 0u;
 	ArgsData.StartIndexLocation = m_IndicesOffset;
-	ArgsData.BaseVertexLocation = 0;
+	ArgsData.BaseVertexLocation = (INT)m_VerticesOffset;
 	ArgsData.StartInstanceLocation = 0u;
 
 	D3D11_SUBRESOURCE_DATA Data = {};
@@ -87,14 +60,23 @@ bool Mesh::CreateArgsBuffer()
 	return true;
 }
 
-void Mesh::UpdateBoundingBox(DirectX::XMFLOAT3 Pos)
+bool Mesh::CreateQuantizationBuffer()
 {
-	AABB& BBox = m_pModel->GetBoundingBox();
+	HRESULT hResult;
+	DirectX::XMFLOAT4 QuantizationData[2] = {
+		{ m_Quantization.Offset.x, m_Quantization.Offset.y, m_Quantization.Offset.z, 0.f },
+		{ m_Quantization.Scale.x, m_Quantization.Scale.y, m_Quantization.Scale.z, 0.f } };
+
+	D3D11_BUFFER_DESC BufferDesc = {};
+	BufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	BufferDesc.ByteWidth = sizeof(QuantizationData);
+	BufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
 
-	DirectX::XMVECTOR PosVec = DirectX::XMVectorSet(Pos.x, Pos.y, Pos.z, 1.f);
-	PosVec = DirectX::XMVector3Transform(PosVec, m_pNode->GetAccumulatedTransform());
-	DirectX::XMFLOAT3 TransformedPos;
-	DirectX::XMStoreFloat3(&TransformedPos, PosVec);
+	D3D11_SUBRESOURCE_DATA Data = {};
+	Data.pSysMem = QuantizationData;
 
-	BBox.Expand(TransformedPos);
+	HFALSE_IF_FAILED(Graphics::GetSingletonPtr()->GetDevice()->CreateBuffer(&BufferDesc, &Data, &m_QuantizationBuffer));
+	NAME_D3D_RESOURCE(m_QuantizationBuffer, (m_pModel->GetModelPath() + " " + m_Name + " quantization buffer").c_str());
+
+	return true;
 }
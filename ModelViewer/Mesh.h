@@ -11,8 +11,13 @@
 
 #include "wrl.h"
 
-struct aiMesh;
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "VertexCompression.h"
+
 class Material;
+class ModelData;
+class Node;
 
 class Mesh
 {
@@ -22,27 +27,43 @@ class Mesh
 public:
 	Mesh(ModelData* pModel, Node* pNode);
 
-	void ProcessMesh(aiMesh* SceneMesh);
+	// a range of the model's shared vertex and index arrays, which are already filled
+	void Initialise(const std::string& Name, std::shared_ptr<Material> pMaterial, UINT VerticesOffset, UINT IndicesOffset, UINT VertexCount, UINT IndexCount);
 
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetArgsBuffer() const { return m_ArgsBuffer; }
 	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> GetArgsBufferUAV() const { return m_ArgsBufferUAV; }
+	const std::string& GetName() const { return m_Name; }
+	// what the import time optimisation did to this mesh's vertex cache behaviour
+	const MeshOptimizeStats& GetOptimizeStats() const { return m_OptimizeStats; }
+	const VertexQuantization& GetQuantization() const { return m_Quantization; }
+	UINT GetMeshletCount() const { return m_MeshletCount; }
+	// level 0 is the full mesh, index offsets are relative to the mesh's first index
+	UINT GetLODCount() const { return m_LODCount; }
+	const MeshLOD& GetLOD(UINT Level) const { return m_LODs[Level]; }
 
 private:
 	bool CreateArgsBuffer();
-
-	void UpdateBoundingBox(DirectX::XMFLOAT3 Pos);
+	// bounds of this mesh's vertices, what PackedMain decodes positions against
+	bool CreateQuantizationBuffer();
 
 private:
 	unsigned int m_VerticesOffset;
 	unsigned int m_IndicesOffset;
 	unsigned int m_VertexCount;
 	unsigned int m_IndexCount;
+	unsigned int m_MeshletOffset = 0u;
+	unsigned int m_MeshletCount = 0u;
+	MeshLOD m_LODs[MAX_MESH_LODS] = {};
+	unsigned int m_LODCount = 1u;
 
 	Microsoft::WRL::ComPtr<ID3D11Buffer> m_ArgsBuffer;
 	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> m_ArgsBufferUAV;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> m_QuantizationBuffer;
+	VertexQuantization m_Quantization;
 
 	std::shared_ptr<Material> m_Material;
 	std::string m_Name;
+	MeshOptimizeStats m_OptimizeStats;
 
 	ModelData* m_pModel;
 	Node* m_pNode;
@@ -0,0 +1,456 @@
+#include <fstream>
+#include <cstring>
+
+#include <Windows.h>
+
+#include "MeshCache.h"
+
+static_assert(sizeof(MeshCacheHeader) % 4 == 0 && sizeof(MeshCacheNode) % 4 == 0 && sizeof(MeshCacheMesh) % 4 == 0 &&
+	sizeof(MeshCacheMaterial) % 4 == 0 && sizeof(Meshlet) % 4 == 0 && sizeof(Vertex) % 4 == 0, "mesh cache records have to keep the sections 4 byte aligned");
+
+static const char MESH_CACHE_MAGIC[4] = { 'M', 'V', 'M', 'C' };
+static const char* const MESH_CACHE_EXTENSION = ".mvcache";
+
+static const unsigned long long HASH_OFFSET_BASIS = 0xcbf29ce484222325ull;
+static const unsigned long long HASH_PRIME = 0x100000001b3ull;
+
+MeshCache::MeshCache()
+{
+	m_FileHandle = INVALID_HANDLE_VALUE;
+	m_MappingHandle = nullptr;
+	m_View = nullptr;
+
+	// offset 0 is the empty string
+	m_WriteStrings.push_back('\0');
+	m_StringOffsets[""] = 0u;
+	BindWriteData();
+}
+
+MeshCache::~MeshCache()
+{
+	Close();
+}
+
+UINT MeshCache::AddString(const std::string& String)
+{
+	auto It = m_StringOffsets.find(String);
+	if (It != m_StringOffsets.end())
+		return It->second;
+
+	const UINT Offset = (UINT)m_WriteStrings.size();
+	m_WriteStrings.insert(m_WriteStrings.end(), String.begin(), String.end());
+	m_WriteStrings.push_back('\0');
+	m_StringOffsets.emplace(String, Offset);
+	return Offset;
+}
+
+void MeshCache::SetSource(unsigned long long SourceHash, UINT ImportFlags)
+{
+	m_WriteSourceHash = SourceHash;
+	m_WriteImportFlags = ImportFlags;
+}
+
+UINT MeshCache::AddNode(UINT Parent, const std::string& Name, const DirectX::XMMATRIX& LocalTransform, const DirectX::XMMATRIX& AccumulatedTransform)
+{
+	MeshCacheNode Node = {};
+	Node.Parent = Parent;
+	Node.Name = AddString(Name);
+	DirectX::XMStoreFloat4x4(&Node.LocalTransform, LocalTransform);
+	DirectX::XMStoreFloat4x4(&Node.AccumulatedTransform, AccumulatedTransform);
+	m_WriteNodes.push_back(Node);
+
+	BindWriteData();
+	return (UINT)m_WriteNodes.size() - 1u;
+}
+
+UINT MeshCache::AddMaterial(const MeshCacheMaterialDesc& Desc)
+{
+	MeshCacheMaterial Material = {};
+	Material.Name = AddString(Desc.Name);
+	Material.DiffuseTexture = AddString(Desc.DiffuseTexture);
+	Material.SpecularTexture = AddString(Desc.SpecularTexture);
+	Material.DiffuseColor = Desc.DiffuseColor;
+	Material.Specular = Desc.Specular;
+	Material.bTwoSided = Desc.bTwoSided ? 1u : 0u;
+	Material.bOpaque = Desc.bOpaque ? 1u : 0u;
+	m_WriteMaterials.push_back(Material);
+
+	BindWriteData();
+	return (UINT)m_WriteMaterials.size() - 1u;
+}
+
+UINT MeshCache::AddMesh(const std::string& Name, UINT Node, UINT Material, const std::vector<Vertex>& Vertices, const std::vector<UINT>& LocalIndices,
+	const MeshOptimizeStats& OptimizeStats, const std::vector<Meshlet>& Meshlets, const std::vector<MeshLOD>& LODs, const std::vector<UINT>& LODIndices)
+{
+	const UINT Mesh = ReserveMesh(Name, Node, Material, (UINT)Vertices.size(), (UINT)LocalIndices.size(), OptimizeStats, (UINT)Meshlets.size(), LODs,
+		(UINT)LODIndices.size());
+	FillMesh(Mesh, Vertices.data(), LocalIndices.data(), Meshlets.data(), LODIndices.data(), (UINT)LODIndices.size());
+	return Mesh;
+}
+
+UINT MeshCache::AddMeshInstance(UINT Mesh, UINT Node)
+{
+	MeshCacheMesh Instance = m_WriteMeshes[Mesh];
+	Instance.Node = Node;
+	m_WriteMeshes.push_back(Instance);
+
+	BindWriteData();
+	return (UINT)m_WriteMeshes.size() - 1u;
+}
+
+void MeshCache::Reserve(UINT VertexCount, UINT IndexCount, UINT MeshletCount, UINT MeshCount)
+{
+	m_WriteVertices.reserve(m_WriteVertices.size() + VertexCount);
+	m_WriteIndices.reserve(m_WriteIndices.size() + IndexCount);
+	m_WriteMeshlets.reserve(m_WriteMeshlets.size() + MeshletCount);
+	m_WriteMeshes.reserve(m_WriteMeshes.size() + MeshCount);
+}
+
+UINT MeshCache::ReserveMesh(const std::string& Name, UINT Node, UINT Material, UINT VertexCount, UINT IndexCount, const MeshOptimizeStats& OptimizeStats,
+	UINT MeshletCount, const std::vector<MeshLOD>& LODs, UINT LODIndexCount)
+{
+	MeshCacheMesh Mesh = {};
+	Mesh.Name = AddString(Name);
+	Mesh.Node = Node;
+	Mesh.Material = Material;
+	Mesh.VerticesOffset = (UINT)m_WriteVertices.size();
+	Mesh.IndicesOffset = (UINT)m_WriteIndices.size();
+	Mesh.VertexCount = VertexCount;
+	Mesh.IndexCount = IndexCount;
+	Mesh.MeshletOffset = (UINT)m_WriteMeshlets.size();
+	Mesh.MeshletCount = MeshletCount;
+	Mesh.LODCount = LODs.empty() ? 1u : (UINT)LODs.size();
+	Mesh.LODs[0] = { 0u, Mesh.IndexCount, 0.f };
+	for (UINT i = 1u; i < Mesh.LODCount && i < MAX_MESH_LODS; i++)
+	{
+		Mesh.LODs[i] = LODs[i];
+	}
+	Mesh.LODCount = Mesh.LODCount < MAX_MESH_LODS ? Mesh.LODCount : MAX_MESH_LODS;
+	Mesh.OptimizeStats = OptimizeStats;
+
+	// the ranges follow each other in reserve order, a running sum of every earlier mesh's sizes
+	m_WriteVertices.resize(m_WriteVertices.size() + VertexCount);
+	m_WriteIndices.resize(m_WriteIndices.size() + IndexCount + LODIndexCount);
+	m_WriteMeshlets.resize(m_WriteMeshlets.size() + MeshletCount);
+	m_WriteMeshes.push_back(Mesh);
+
+	BindWriteData();
+	return (UINT)m_WriteMeshes.size() - 1u;
+}
+
+void MeshCache::FillMesh(UINT Mesh, const Vertex* Vertices, const UINT* LocalIndices, const Meshlet* Meshlets, const UINT* LODIndices, UINT LODIndexCount)
+{
+	const MeshCacheMesh& Record = m_WriteMeshes[Mesh];
+	if (Record.VertexCount > 0u)
+	{
+		memcpy(&m_WriteVertices[Record.VerticesOffset], Vertices, sizeof(Vertex) * Record.VertexCount);
+	}
+	if (Record.MeshletCount > 0u)
+	{
+		memcpy(&m_WriteMeshlets[Record.MeshletOffset], Meshlets, sizeof(Meshlet) * Record.MeshletCount);
+	}
+
+	// the simplified levels' indices follow the full mesh's
+	UINT* Out = m_WriteIndices.data() + Record.IndicesOffset;
+	for (UINT i = 0u; i < Record.IndexCount; i++)
+	{
+		Out[i] = LocalIndices[i] + Record.VerticesOffset;
+	}
+
+	for (UINT i = 0u; i < LODIndexCount; i++)
+	{
+		Out[Record.IndexCount + i] = LODIndices[i] + Record.VerticesOffset;
+	}
+}
+
+void MeshCache::SetBounds(const DirectX::XMFLOAT3& Min, const DirectX::XMFLOAT3& Max)
+{
+	m_BoundsMin = Min;
+	m_BoundsMax = Max;
+}
+
+bool MeshCache::Save(const std::string& Filepath) const
+{
+	MeshCacheHeader Header = {};
+	memcpy(Header.Magic, MESH_CACHE_MAGIC, sizeof(Header.Magic));
+	Header.Version = MESH_CACHE_VERSION;
+	Header.SourceHash = m_WriteSourceHash;
+	Header.ImportFlags = m_WriteImportFlags;
+	Header.VertexStride = (UINT)sizeof(Vertex);
+	Header.VertexCount = (UINT)m_WriteVertices.size();
+	Header.VertexOffset = (UINT)sizeof(MeshCacheHeader);
+	Header.IndexCount = (UINT)m_WriteIndices.size();
+	Header.IndexOffset = Header.VertexOffset + Header.VertexCount * (UINT)sizeof(Vertex);
+	Header.MeshCount = (UINT)m_WriteMeshes.size();
+	Header.MeshOffset = Header.IndexOffset + Header.IndexCount * (UINT)sizeof(UINT);
+	Header.MeshletCount = (UINT)m_WriteMeshlets.size();
+	Header.MeshletOffset = Header.MeshOffset + Header.MeshCount * (UINT)sizeof(MeshCacheMesh);
+	Header.NodeCount = (UINT)m_WriteNodes.size();
+	Header.NodeOffset = Header.MeshletOffset + Header.MeshletCount * (UINT)sizeof(Meshlet);
+	Header.MaterialCount = (UINT)m_WriteMaterials.size();
+	Header.MaterialOffset = Header.NodeOffset + Header.NodeCount * (UINT)sizeof(MeshCacheNode);
+	Header.StringBytes = (UINT)m_WriteStrings.size();
+	Header.StringOffset = Header.MaterialOffset + Header.MaterialCount * (UINT)sizeof(MeshCacheMaterial);
+	Header.BoundsMin = m_BoundsMin;
+	Header.BoundsMax = m_BoundsMax;
+
+	// written to the side and moved over the old cache, a load that races the write never maps half a file
+	const std::string TempPath = Filepath + ".tmp";
+	{
+		std::ofstream File(TempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!File.is_open())
+			return false;
+
+		File.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+		File.write(reinterpret_cast<const char*>(m_WriteVertices.data()), sizeof(Vertex) * m_WriteVertices.size());
+		File.write(reinterpret_cast<const char*>(m_WriteIndices.data()), sizeof(UINT) * m_WriteIndices.size());
+		File.write(reinterpret_cast<const char*>(m_WriteMeshes.data()), sizeof(MeshCacheMesh) * m_WriteMeshes.size());
+		File.write(reinterpret_cast<const char*>(m_WriteMeshlets.data()), sizeof(Meshlet) * m_WriteMeshlets.size());
+		File.write(reinterpret_cast<const char*>(m_WriteNodes.data()), sizeof(MeshCacheNode) * m_WriteNodes.size());
+		File.write(reinterpret_cast<const char*>(m_WriteMaterials.data()), sizeof(MeshCacheMaterial) * m_WriteMaterials.size());
+		File.write(m_WriteStrings.data(), m_WriteStrings.size());
+		if (!File.good())
+			return false;
+	}
+
+	return MoveFileExA(TempPath.c_str(), Filepath.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+bool MeshCache::Open(const std::string& Filepath, unsigned long long SourceHash, UINT ImportFlags)
+{
+	Close();
+
+	HANDLE File = CreateFileA(Filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (File == INVALID_HANDLE_VALUE)
+		return false;
+	m_FileHandle = File;
+
+	LARGE_INTEGER Size;
+	if (!GetFileSizeEx(File, &Size) || Size.QuadPart < (LONGLONG)sizeof(MeshCacheHeader))
+	{
+		Close();
+		return false;
+	}
+
+	m_MappingHandle = CreateFileMappingA(File, nullptr, PAGE_READONLY, 0u, 0u, nullptr);
+	if (!m_MappingHandle)
+	{
+		Close();
+		return false;
+	}
+
+	m_View = MapViewOfFile(m_MappingHandle, FILE_MAP_READ, 0u, 0u, 0u);
+	if (!m_View || !Validate(static_cast<const unsigned char*>(m_View), (size_t)Size.QuadPart, SourceHash, ImportFlags))
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MeshCache::Close()
+{
+	m_Vertices = nullptr;
+	m_Indices = nullptr;
+	m_Meshes = nullptr;
+	m_Meshlets = nullptr;
+	m_Nodes = nullptr;
+	m_Materials = nullptr;
+	m_Strings = nullptr;
+	m_VertexCount = 0u;
+	m_IndexCount = 0u;
+	m_MeshCount = 0u;
+	m_MeshletCount = 0u;
+	m_NodeCount = 0u;
+	m_MaterialCount = 0u;
+
+	if (m_View)
+	{
+		UnmapViewOfFile(m_View);
+		m_View = nullptr;
+	}
+	if (m_MappingHandle)
+	{
+		CloseHandle(m_MappingHandle);
+		m_MappingHandle = nullptr;
+	}
+	if (m_FileHandle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_FileHandle);
+		m_FileHandle = INVALID_HANDLE_VALUE;
+	}
+}
+
+bool MeshCache::Validate(const unsigned char* Data, size_t Size, unsigned long long SourceHash, UINT ImportFlags)
+{
+	// a stale or foreign cache is just a miss, the caller imports the source again and overwrites it
+	const MeshCacheHeader* Header = reinterpret_cast<const MeshCacheHeader*>(Data);
+	if (memcmp(Header->Magic, MESH_CACHE_MAGIC, sizeof(Header->Magic)) != 0 || Header->Version != MESH_CACHE_VERSION ||
+		Header->SourceHash != SourceHash || Header->ImportFlags != ImportFlags || Header->VertexStride != (UINT)sizeof(Vertex))
+		return false;
+
+	auto SectionFits = [Size](UINT Offset, UINT Count, size_t Stride)
+	{
+		return Offset % 4u == 0u && (unsigned long long)Offset + (unsigned long long)Count * Stride <= (unsigned long long)Size;
+	};
+	if (!SectionFits(Header->VertexOffset, Header->VertexCount, sizeof(Vertex)) ||
+		!SectionFits(Header->IndexOffset, Header->IndexCount, sizeof(UINT)) ||
+		!SectionFits(Header->MeshOffset, Header->MeshCount, sizeof(MeshCacheMesh)) ||
+		!SectionFits(Header->MeshletOffset, Header->MeshletCount, sizeof(Meshlet)) ||
+		!SectionFits(Header->NodeOffset, Header->NodeCount, sizeof(MeshCacheNode)) ||
+		!SectionFits(Header->MaterialOffset, Header->MaterialCount, sizeof(MeshCacheMaterial)) ||
+		!SectionFits(Header->StringOffset, Header->StringBytes, 1u) || Header->StringBytes == 0u)
+		return false;
+
+	const char* Strings = reinterpret_cast<const char*>(Data + Header->StringOffset);
+	if (Strings[Header->StringBytes - 1u] != '\0')
+		return false;
+
+	const MeshCacheNode* Nodes = reinterpret_cast<const MeshCacheNode*>(Data + Header->NodeOffset);
+	for (UINT i = 0u; i < Header->NodeCount; i++)
+	{
+		// exactly one root, the first node
+		const bool bValidParent = i == 0u ? Nodes[i].Parent == INVALID_MESH_CACHE_NODE : Nodes[i].Parent < i;
+		if (!bValidParent || Nodes[i].Name >= Header->StringBytes)
+			return false;
+	}
+
+	const MeshCacheMaterial* Materials = reinterpret_cast<const MeshCacheMaterial*>(Data + Header->MaterialOffset);
+	for (UINT i = 0u; i < Header->MaterialCount; i++)
+	{
+		const MeshCacheMaterial& M = Materials[i];
+		if (M.Name >= Header->StringBytes || M.DiffuseTexture >= Header->StringBytes || M.SpecularTexture >= Header->StringBytes)
+			return false;
+	}
+
+	const UINT* Indices = reinterpret_cast<const UINT*>(Data + Header->IndexOffset);
+	const MeshCacheMesh* Meshes = reinterpret_cast<const MeshCacheMesh*>(Data + Header->MeshOffset);
+	const Meshlet* Meshlets = reinterpret_cast<const Meshlet*>(Data + Header->MeshletOffset);
+	for (UINT i = 0u; i < Header->MeshCount; i++)
+	{
+		const MeshCacheMesh& M = Meshes[i];
+		if (M.Name >= Header->StringBytes || M.Node >= Header->NodeCount || M.Material >= Header->MaterialCount ||
+			(unsigned long long)M.VerticesOffset + M.VertexCount > Header->VertexCount ||
+			(unsigned long long)M.IndicesOffset + M.IndexCount > Header->IndexCount ||
+			(unsigned long long)M.MeshletOffset + M.MeshletCount > Header->MeshletCount)
+			return false;
+
+		// the cluster culler draws these ranges as they are
+		for (UINT j = M.MeshletOffset; j < M.MeshletOffset + M.MeshletCount; j++)
+		{
+			if ((unsigned long long)Meshlets[j].IndexOffset + Meshlets[j].TriangleCount * 3ull > M.IndexCount)
+				return false;
+		}
+
+		// level 0 is the full mesh, every level is whole triangles inside the index section
+		if (M.LODCount == 0u || M.LODCount > MAX_MESH_LODS || M.LODs[0].IndexOffset != 0u || M.LODs[0].IndexCount != M.IndexCount)
+			return false;
+
+		UINT IndicesEnd = M.IndicesOffset + M.IndexCount;
+		for (UINT l = 1u; l < M.LODCount; l++)
+		{
+			const unsigned long long End = (unsigned long long)M.IndicesOffset + M.LODs[l].IndexOffset + M.LODs[l].IndexCount;
+			if (M.LODs[l].IndexCount % 3u != 0u || End > Header->IndexCount)
+				return false;
+			IndicesEnd = (UINT)End > IndicesEnd ? (UINT)End : IndicesEnd;
+		}
+
+		// every index has to stay inside its own mesh, the buffers are created straight from these. The levels follow the full mesh
+		for (UINT j = M.IndicesOffset; j < IndicesEnd; j++)
+		{
+			if (Indices[j] < M.VerticesOffset || Indices[j] >= M.VerticesOffset + M.VertexCount)
+				return false;
+		}
+	}
+
+	m_Vertices = reinterpret_cast<const Vertex*>(Data + Header->VertexOffset);
+	m_Indices = Indices;
+	m_Meshes = Meshes;
+	m_Meshlets = Meshlets;
+	m_Nodes = Nodes;
+	m_Materials = Materials;
+	m_Strings = Strings;
+	m_VertexCount = Header->VertexCount;
+	m_IndexCount = Header->IndexCount;
+	m_MeshCount = Header->MeshCount;
+	m_MeshletCount = Header->MeshletCount;
+	m_NodeCount = Header->NodeCount;
+	m_MaterialCount = Header->MaterialCount;
+	m_BoundsMin = Header->BoundsMin;
+	m_BoundsMax = Header->BoundsMax;
+	return true;
+}
+
+void MeshCache::BindWriteData()
+{
+	m_Vertices = m_WriteVertices.data();
+	m_Indices = m_WriteIndices.data();
+	m_Meshes = m_WriteMeshes.data();
+	m_Meshlets = m_WriteMeshlets.data();
+	m_Nodes = m_WriteNodes.data();
+	m_Materials = m_WriteMaterials.data();
+	m_Strings = m_WriteStrings.data();
+	m_VertexCount = (UINT)m_WriteVertices.size();
+	m_IndexCount = (UINT)m_WriteIndices.size();
+	m_MeshCount = (UINT)m_WriteMeshes.size();
+	m_MeshletCount = (UINT)m_WriteMeshlets.size();
+	m_NodeCount = (UINT)m_WriteNodes.size();
+	m_MaterialCount = (UINT)m_WriteMaterials.size();
+}
+
+std::string MeshCache::GetCachePath(const std::string& SourcePath)
+{
+	return SourcePath + MESH_CACHE_EXTENSION;
+}
+
+bool MeshCache::HashFile(const std::string& Filepath, unsigned long long& OutHash)
+{
+	HANDLE File = CreateFileA(Filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (File == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER Size;
+	if (!GetFileSizeEx(File, &Size))
+	{
+		CloseHandle(File);
+		return false;
+	}
+
+	// FNV-1a over 8 byte words, the tail byte by byte. The size goes in first so files that only differ in trailing zeros differ
+	unsigned long long Hash = (HASH_OFFSET_BASIS ^ (unsigned long long)Size.QuadPart) * HASH_PRIME;
+	if (Size.QuadPart == 0)
+	{
+		CloseHandle(File);
+		OutHash = Hash;
+		return true;
+	}
+
+	HANDLE Mapping = CreateFileMappingA(File, nullptr, PAGE_READONLY, 0u, 0u, nullptr);
+	const void* View = Mapping ? MapViewOfFile(Mapping, FILE_MAP_READ, 0u, 0u, 0u) : nullptr;
+	if (View)
+	{
+		const unsigned char* Bytes = static_cast<const unsigned char*>(View);
+		const size_t Count = (size_t)Size.QuadPart;
+		const size_t WordCount = Count / sizeof(unsigned long long);
+		for (size_t i = 0; i < WordCount; i++)
+		{
+			unsigned long long Word;
+			memcpy(&Word, Bytes + i * sizeof(unsigned long long), sizeof(Word));
+			Hash = (Hash ^ Word) * HASH_PRIME;
+		}
+		for (size_t i = WordCount * sizeof(unsigned long long); i < Count; i++)
+		{
+			Hash = (Hash ^ Bytes[i]) * HASH_PRIME;
+		}
+		UnmapViewOfFile(View);
+	}
+	if (Mapping)
+	{
+		CloseHandle(Mapping);
+	}
+	CloseHandle(File);
+
+	OutHash = Hash;
+	return View != nullptr;
+}
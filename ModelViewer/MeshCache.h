@@ -0,0 +1,204 @@
+#pragma once
+
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "DirectXMath.h"
+
+#include "Common.h"
+#include "MeshOptimizer.h"
+#include "MeshletBuilder.h"
+#include "MeshSimplifier.h"
+
+typedef unsigned int UINT;
+
+const UINT MESH_CACHE_VERSION = 4u;
+const UINT INVALID_MESH_CACHE_NODE = 0xFFFFFFFF;
+
+// every section starts at its offset from the start of the file, all offsets are 4 byte aligned
+struct MeshCacheHeader
+{
+	char Magic[4];
+	UINT Version;
+	unsigned long long SourceHash;
+	UINT ImportFlags;
+	UINT VertexStride;		// sizeof(Vertex) when written, a changed vertex layout invalidates the cache
+	UINT VertexCount;
+	UINT VertexOffset;
+	UINT IndexCount;
+	UINT IndexOffset;
+	UINT MeshCount;
+	UINT MeshOffset;
+	UINT MeshletCount;
+	UINT MeshletOffset;
+	UINT NodeCount;
+	UINT NodeOffset;
+	UINT MaterialCount;
+	UINT MaterialOffset;
+	UINT StringBytes;
+	UINT StringOffset;
+	DirectX::XMFLOAT3 BoundsMin;
+	DirectX::XMFLOAT3 BoundsMax;
+};
+
+// depth first, parents always come before their children. Strings are offsets into the string table, 0 is ""
+struct MeshCacheNode
+{
+	UINT Parent;
+	UINT Name;
+	DirectX::XMFLOAT4X4 LocalTransform;
+	DirectX::XMFLOAT4X4 AccumulatedTransform;
+};
+
+// in the order the import processed them, indices are already offset to the shared vertex array. A source mesh used by several
+// nodes is stored once, every use after the first shares its ranges. Meshlet and LOD offsets are relative to the mesh's first index,
+// the simplified levels' indices follow the IndexCount indices of the full mesh, which is LODs[0]
+struct MeshCacheMesh
+{
+	UINT Name;
+	UINT Node;
+	UINT Material;
+	UINT VerticesOffset;
+	UINT IndicesOffset;
+	UINT VertexCount;
+	UINT IndexCount;
+	UINT MeshletOffset;
+	UINT MeshletCount;
+	UINT LODCount;
+	MeshLOD LODs[MAX_MESH_LODS];
+	MeshOptimizeStats OptimizeStats;
+};
+
+// texture paths as the source asset names them, relative to the model's textures path
+struct MeshCacheMaterial
+{
+	UINT Name;
+	UINT DiffuseTexture;
+	UINT SpecularTexture;
+	DirectX::XMFLOAT3 DiffuseColor;
+	DirectX::XMFLOAT3 Specular;
+	UINT bTwoSided;
+	UINT bOpaque;
+};
+
+struct MeshCacheMaterialDesc
+{
+	std::string Name;
+	std::string DiffuseTexture;
+	std::string SpecularTexture;
+	DirectX::XMFLOAT3 DiffuseColor = { 1.f, 1.f, 1.f };
+	DirectX::XMFLOAT3 Specular = { 1.f, 1.f, 1.f };
+	bool bTwoSided = true;
+	bool bOpaque = false;
+};
+
+/*
+*	Baked import result of one model file: the final vertex and index arrays, mesh ranges, meshlets and LODs, node transforms, material parameters and
+*	texture paths and the bounding box, in the exact layout the ModelData builds from. The cache sits beside the source asset and is
+*	keyed by a hash of the source file, the import flags and the vertex layout, anything that does not match is treated as missing.
+*	Open memory maps the file, checks every section and index once and hands the arrays out straight from the mapping, so a warm load
+*	is one copy into the vertex and index buffers. The writer side is what the import fills, the getters also work on the written data
+*	so a model that was just imported builds from the same code path. Only the main source file is hashed, files it references (.bin
+*	buffers, .mtl libraries) do not invalidate the cache. Pure CPU, no device needed.
+*/
+
+class MeshCache
+{
+public:
+	MeshCache();
+	~MeshCache();
+	MeshCache(const MeshCache& Other) = delete;
+
+	// writing
+	void SetSource(unsigned long long SourceHash, UINT ImportFlags);
+	UINT AddNode(UINT Parent, const std::string& Name, const DirectX::XMMATRIX& LocalTransform, const DirectX::XMMATRIX& AccumulatedTransform);
+	UINT AddMaterial(const MeshCacheMaterialDesc& Desc);
+	// LocalIndices and LODIndices index into Vertices, they are offset to the shared array here. LODs as MeshSimplifier::GenerateLODs
+	// makes them, none is just the full mesh
+	UINT AddMesh(const std::string& Name, UINT Node, UINT Material, const std::vector<Vertex>& Vertices, const std::vector<UINT>& LocalIndices,
+		const MeshOptimizeStats& OptimizeStats = {}, const std::vector<Meshlet>& Meshlets = {}, const std::vector<MeshLOD>& LODs = {},
+		const std::vector<UINT>& LODIndices = {});
+	// the same vertex and index ranges as an earlier mesh, under another node
+	UINT AddMeshInstance(UINT Mesh, UINT Node);
+	// AddMesh in two steps for imports that convert meshes on several threads. ReserveMesh appends the record and hands the mesh the
+	// next vertex, index and meshlet ranges, FillMesh copies the arrays into them later. Meshes can be filled from any thread in any
+	// order once every mesh is reserved, as long as nothing is added while they are. Reserve sizes the arrays for what is coming
+	void Reserve(UINT VertexCount, UINT IndexCount, UINT MeshletCount, UINT MeshCount);
+	UINT ReserveMesh(const std::string& Name, UINT Node, UINT Material, UINT VertexCount, UINT IndexCount, const MeshOptimizeStats& OptimizeStats = {},
+		UINT MeshletCount = 0u, const std::vector<MeshLOD>& LODs = {}, UINT LODIndexCount = 0u);
+	void FillMesh(UINT Mesh, const Vertex* Vertices, const UINT* LocalIndices, const Meshlet* Meshlets = nullptr, const UINT* LODIndices = nullptr,
+		UINT LODIndexCount = 0u);
+	void SetBounds(const DirectX::XMFLOAT3& Min, const DirectX::XMFLOAT3& Max);
+	bool Save(const std::string& Filepath) const;
+
+	// reading, fails if the file is not a valid cache for this source hash and these import flags. The arrays stay valid until Close
+	bool Open(const std::string& Filepath, unsigned long long SourceHash, UINT ImportFlags);
+	void Close();
+	bool IsMapped() const { return m_View != nullptr; }
+
+	UINT GetVertexCount() const { return m_VertexCount; }
+	const Vertex* GetVertices() const { return m_Vertices; }
+	UINT GetIndexCount() const { return m_IndexCount; }
+	const UINT* GetIndices() const { return m_Indices; }
+	UINT GetMeshCount() const { return m_MeshCount; }
+	const MeshCacheMesh& GetMesh(UINT Index) const { return m_Meshes[Index]; }
+	UINT GetMeshletCount() const { return m_MeshletCount; }
+	const Meshlet* GetMeshlets() const { return m_Meshlets; }
+	UINT GetNodeCount() const { return m_NodeCount; }
+	const MeshCacheNode& GetNode(UINT Index) const { return m_Nodes[Index]; }
+	UINT GetMaterialCount() const { return m_MaterialCount; }
+	const MeshCacheMaterial& GetMaterial(UINT Index) const { return m_Materials[Index]; }
+	const char* GetString(UINT Offset) const { return m_Strings + Offset; }
+	const DirectX::XMFLOAT3& GetBoundsMin() const { return m_BoundsMin; }
+	const DirectX::XMFLOAT3& GetBoundsMax() const { return m_BoundsMax; }
+
+	// the file beside the asset the cache for it is written to
+	static std::string GetCachePath(const std::string& SourcePath);
+	static bool HashFile(const std::string& Filepath, unsigned long long& OutHash);
+
+private:
+	UINT AddString(const std::string& String);
+	bool Validate(const unsigned char* Data, size_t Size, unsigned long long SourceHash, UINT ImportFlags);
+	// points the getters at the written arrays, after every write since the vectors may have moved
+	void BindWriteData();
+
+private:
+	// what the getters read, either the mapped file or the written arrays
+	const Vertex* m_Vertices = nullptr;
+	const UINT* m_Indices = nullptr;
+	const MeshCacheMesh* m_Meshes = nullptr;
+	const Meshlet* m_Meshlets = nullptr;
+	const MeshCacheNode* m_Nodes = nullptr;
+	const MeshCacheMaterial* m_Materials = nullptr;
+	const char* m_Strings = nullptr;
+	UINT m_VertexCount = 0u;
+	UINT m_IndexCount = 0u;
+	UINT m_MeshCount = 0u;
+	UINT m_MeshletCount = 0u;
+	UINT m_NodeCount = 0u;
+	UINT m_MaterialCount = 0u;
+	DirectX::XMFLOAT3 m_BoundsMin = { 0.f, 0.f, 0.f };
+	DirectX::XMFLOAT3 m_BoundsMax = { 0.f, 0.f, 0.f };
+
+	unsigned long long m_WriteSourceHash = 0ull;
+	UINT m_WriteImportFlags = 0u;
+	std::vector<Vertex> m_WriteVertices;
+	std::vector<UINT> m_WriteIndices;
+	std::vector<MeshCacheMesh> m_WriteMeshes;
+	std::vector<Meshlet> m_WriteMeshlets;
+	std::vector<MeshCacheNode> m_WriteNodes;
+	std::vector<MeshCacheMaterial> m_WriteMaterials;
+	std::vector<char> m_WriteStrings;
+	std::unordered_map<std::string, UINT> m_StringOffsets;
+
+	void* m_FileHandle;
+	void* m_MappingHandle;
+	const void* m_View;
+
+};
+
+#endif
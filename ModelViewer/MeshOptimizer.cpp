@@ -0,0 +1,391 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "MeshOptimizer.h"
+
+static const UINT INVALID_VERTEX = 0xFFFFFFFF;
+
+// FIFO cache simulation: a vertex is resident while fewer than CacheSize misses happened since it was loaded
+struct CacheSimulator
+{
+	std::vector<UINT> LoadTime;
+	UINT Time;
+	UINT CacheSize;
+
+	CacheSimulator(UINT VertexCount, UINT Size) : LoadTime(VertexCount, 0u), Time(Size + 1u), CacheSize(Size) {}
+
+	// returns true on a miss
+	bool Access(UINT v)
+	{
+		if (Time - LoadTime[v] <= CacheSize)
+			return false;
+
+		LoadTime[v] = Time++;
+		return true;
+	}
+
+	UINT AccessTriangle(const UINT* Triangle)
+	{
+		return (Access(Triangle[0]) ? 1u : 0u) + (Access(Triangle[1]) ? 1u : 0u) + (Access(Triangle[2]) ? 1u : 0u);
+	}
+
+	void Flush()
+	{
+		Time += CacheSize + 1u;
+	}
+};
+
+static unsigned long long HashVertex(const Vertex& v)
+{
+	static_assert(sizeof(Vertex) % 4 == 0, "vertices are hashed a 32 bit word at a time");
+
+	UINT Words[sizeof(Vertex) / 4];
+	memcpy(Words, &v, sizeof(Vertex));
+
+	unsigned long long Hash = 0xcbf29ce484222325ull;
+	for (UINT Word : Words)
+	{
+		Hash = (Hash ^ Word) * 0x100000001b3ull;
+	}
+	return Hash ^ (Hash >> 29);
+}
+
+MeshOptimizeStats MeshOptimizer::Optimize(std::vector<Vertex>& Vertices, std::vector<UINT>& Indices)
+{
+	MeshOptimizeStats Stats;
+	Stats.VerticesBefore = (UINT)Vertices.size();
+	Stats.Before = AnalyzeVertexCache(Indices.data(), (UINT)Indices.size(), (UINT)Vertices.size());
+
+	// anything that is not whole triangles is left exactly as imported
+	if (!Indices.empty() && Indices.size() % 3u == 0u)
+	{
+		WeldVertices(Vertices, Indices);
+
+		std::vector<UINT> Clusters;
+		OptimizeVertexCache(Indices, (UINT)Vertices.size(), Clusters);
+		OptimizeOverdraw(Indices, Vertices, Clusters);
+		OptimizeVertexFetch(Vertices, Indices);
+	}
+
+	Stats.VerticesAfter = (UINT)Vertices.size();
+	Stats.After = AnalyzeVertexCache(Indices.data(), (UINT)Indices.size(), (UINT)Vertices.size());
+	return Stats;
+}
+
+UINT MeshOptimizer::WeldVertices(std::vector<Vertex>& Vertices, std::vector<UINT>& Indices)
+{
+	const UINT VertexCount = (UINT)Vertices.size();
+
+	// open addressing over the indices of the first copy of every vertex, bitwise equal counts as the same
+	UINT TableSize = 64u;
+	while (TableSize < VertexCount * 2u)
+	{
+		TableSize *= 2u;
+	}
+	std::vector<UINT> Table(TableSize, INVALID_VERTEX);
+	std::vector<UINT> Remap(VertexCount);
+
+	UINT UniqueCount = 0u;
+	for (UINT i = 0u; i < VertexCount; i++)
+	{
+		UINT Slot = (UINT)HashVertex(Vertices[i]) & (TableSize - 1u);
+		while (Table[Slot] != INVALID_VERTEX && memcmp(&Vertices[Remap[Table[Slot]]], &Vertices[i], sizeof(Vertex)) != 0)
+		{
+			Slot = (Slot + 1u) & (TableSize - 1u);
+		}
+
+		if (Table[Slot] == INVALID_VERTEX)
+		{
+			// survivors are compacted in place, which never overwrites a vertex that is still to be read
+			Table[Slot] = i;
+			Remap[i] = UniqueCount;
+			Vertices[UniqueCount] = Vertices[i];
+			UniqueCount++;
+		}
+		else
+		{
+			Remap[i] = Remap[Table[Slot]];
+		}
+	}
+
+	for (UINT& Index : Indices)
+	{
+		Index = Remap[Index];
+	}
+	Vertices.resize(UniqueCount);
+
+	return VertexCount - UniqueCount;
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<UINT>& Indices, UINT VertexCount, std::vector<UINT>& OutClusters)
+{
+	OutClusters.clear();
+	const UINT IndexCount = (UINT)Indices.size();
+	const UINT TriangleCount = IndexCount / 3u;
+	if (TriangleCount == 0u)
+		return;
+
+	// triangles around every vertex, and how many of them are still to be emitted
+	std::vector<UINT> Live(VertexCount, 0u);
+	for (UINT Index : Indices)
+	{
+		Live[Index]++;
+	}
+	std::vector<UINT> AdjacencyOffsets(VertexCount + 1u, 0u);
+	for (UINT v = 0u; v < VertexCount; v++)
+	{
+		AdjacencyOffsets[v + 1u] = AdjacencyOffsets[v] + Live[v];
+	}
+	std::vector<UINT> Adjacency(IndexCount);
+	std::vector<UINT> Fill(AdjacencyOffsets.begin(), AdjacencyOffsets.end() - 1);
+	for (UINT i = 0u; i < IndexCount; i++)
+	{
+		Adjacency[Fill[Indices[i]]++] = i / 3u;
+	}
+
+	// Tipsify: fan around one vertex at a time, the next fanning vertex is the oldest one whose remaining triangles still fit in the
+	// cache, on a dead end the most recently used vertex with triangles left, and failing that the next one in input order
+	std::vector<UINT> CacheTime(VertexCount, 0u);
+	std::vector<bool> Emitted(TriangleCount, false);
+	std::vector<UINT> DeadEnds;
+	std::vector<UINT> Candidates;
+	std::vector<UINT> Output;
+	Output.reserve(IndexCount);
+	const int CacheSize = (int)VERTEX_CACHE_SIZE;
+	int Time = CacheSize + 1;
+	UINT Cursor = 0u;
+
+	auto NextInInputOrder = [&]()
+		{
+			while (Cursor < VertexCount && Live[Cursor] == 0u)
+			{
+				Cursor++;
+			}
+			return Cursor < VertexCount ? Cursor : INVALID_VERTEX;
+		};
+
+	UINT Fanning = NextInInputOrder();
+	while (Fanning != INVALID_VERTEX)
+	{
+		Candidates.clear();
+		for (UINT a = AdjacencyOffsets[Fanning]; a < AdjacencyOffsets[Fanning + 1u]; a++)
+		{
+			const UINT Triangle = Adjacency[a];
+			if (Emitted[Triangle])
+				continue;
+
+			for (UINT k = 0u; k < 3u; k++)
+			{
+				const UINT v = Indices[Triangle * 3u + k];
+				Output.push_back(v);
+				DeadEnds.push_back(v);
+				Candidates.push_back(v);
+				Live[v]--;
+				if (Time - (int)CacheTime[v] > CacheSize)
+				{
+					CacheTime[v] = (UINT)Time;
+					Time++;
+				}
+			}
+			Emitted[Triangle] = true;
+		}
+
+		UINT Best = INVALID_VERTEX;
+		int BestPriority = -1;
+		for (UINT v : Candidates)
+		{
+			if (Live[v] == 0u)
+				continue;
+
+			int Priority = 0;
+			if (Time - (int)CacheTime[v] + 2 * (int)Live[v] <= CacheSize)
+			{
+				Priority = Time - (int)CacheTime[v];
+			}
+			if (Priority > BestPriority)
+			{
+				Best = v;
+				BestPriority = Priority;
+			}
+		}
+
+		while (Best == INVALID_VERTEX && !DeadEnds.empty())
+		{
+			const UINT v = DeadEnds.back();
+			DeadEnds.pop_back();
+			if (Live[v] > 0u)
+			{
+				Best = v;
+			}
+		}
+
+		Fanning = Best != INVALID_VERTEX ? Best : NextInInputOrder();
+	}
+	Indices.swap(Output);
+
+	// hard boundaries are triangles that share nothing with what is in the cache, every cluster between them is then split again
+	// wherever its running ACMR, started with a cold cache, gets within the threshold of the whole cluster's. Moving the pieces
+	// around afterwards can then cost at most about that much
+	std::vector<UINT> HardBoundaries = { 0u };
+	CacheSimulator Cache(VertexCount, VERTEX_CACHE_SIZE);
+	Cache.AccessTriangle(&Indices[0]);
+	for (UINT t = 1u; t < TriangleCount; t++)
+	{
+		if (Cache.AccessTriangle(&Indices[t * 3u]) == 3u)
+		{
+			HardBoundaries.push_back(t);
+		}
+	}
+	HardBoundaries.push_back(TriangleCount);
+
+	for (size_t c = 0u; c + 1u < HardBoundaries.size(); c++)
+	{
+		const UINT Start = HardBoundaries[c];
+		const UINT End = HardBoundaries[c + 1u];
+
+		Cache.Flush();
+		UINT ClusterMisses = 0u;
+		for (UINT t = Start; t < End; t++)
+		{
+			ClusterMisses += Cache.AccessTriangle(&Indices[t * 3u]);
+		}
+		const float Threshold = OVERDRAW_ACMR_THRESHOLD * (float)ClusterMisses / (float)(End - Start);
+
+		OutClusters.push_back(Start);
+		Cache.Flush();
+		UINT Misses = 0u;
+		UINT Size = 0u;
+		for (UINT t = Start; t < End; t++)
+		{
+			Misses += Cache.AccessTriangle(&Indices[t * 3u]);
+			Size++;
+			if (t + 1u < End && (float)Misses <= Threshold * (float)Size)
+			{
+				OutClusters.push_back(t + 1u);
+				Cache.Flush();
+				Misses = 0u;
+				Size = 0u;
+			}
+		}
+	}
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<UINT>& Indices, const std::vector<Vertex>& Vertices, const std::vector<UINT>& Clusters)
+{
+	const UINT TriangleCount = (UINT)Indices.size() / 3u;
+	if (Clusters.size() < 2u)
+		return;
+
+	// per cluster area weighted centroid and shading normal, the normals are the imported ones so winding does not matter
+	struct ClusterInfo
+	{
+		UINT Start;
+		UINT End;
+		DirectX::XMFLOAT3 Centroid;
+		DirectX::XMFLOAT3 Normal;
+		float Area;
+		float SortKey;
+	};
+	std::vector<ClusterInfo> Infos(Clusters.size());
+
+	DirectX::XMVECTOR MeshCentroid = DirectX::XMVectorZero();
+	float MeshArea = 0.f;
+	for (size_t c = 0u; c < Clusters.size(); c++)
+	{
+		ClusterInfo& Info = Infos[c];
+		Info.Start = Clusters[c];
+		Info.End = c + 1u < Clusters.size() ? Clusters[c + 1u] : TriangleCount;
+
+		DirectX::XMVECTOR Centroid = DirectX::XMVectorZero();
+		DirectX::XMVECTOR Normal = DirectX::XMVectorZero();
+		float Area = 0.f;
+		for (UINT t = Info.Start; t < Info.End; t++)
+		{
+			const Vertex& a = Vertices[Indices[t * 3u]];
+			const Vertex& b = Vertices[Indices[t * 3u + 1u]];
+			const Vertex& c0 = Vertices[Indices[t * 3u + 2u]];
+			const DirectX::XMVECTOR Pa = DirectX::XMLoadFloat3(&a.Pos);
+			const DirectX::XMVECTOR Pb = DirectX::XMLoadFloat3(&b.Pos);
+			const DirectX::XMVECTOR Pc = DirectX::XMLoadFloat3(&c0.Pos);
+
+			const float TriangleArea = 0.5f * DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVector3Cross(DirectX::XMVectorSubtract(Pb, Pa), DirectX::XMVectorSubtract(Pc, Pa))));
+			const DirectX::XMVECTOR TriangleCentroid = DirectX::XMVectorScale(DirectX::XMVectorAdd(DirectX::XMVectorAdd(Pa, Pb), Pc), 1.f / 3.f);
+			const DirectX::XMVECTOR TriangleNormal = DirectX::XMVectorAdd(DirectX::XMVectorAdd(DirectX::XMLoadFloat3(&a.Normal), DirectX::XMLoadFloat3(&b.Normal)), DirectX::XMLoadFloat3(&c0.Normal));
+
+			Centroid = DirectX::XMVectorAdd(Centroid, DirectX::XMVectorScale(TriangleCentroid, TriangleArea));
+			Normal = DirectX::XMVectorAdd(Normal, DirectX::XMVectorScale(TriangleNormal, TriangleArea));
+			Area += TriangleArea;
+		}
+
+		MeshCentroid = DirectX::XMVectorAdd(MeshCentroid, Centroid);
+		MeshArea += Area;
+
+		DirectX::XMStoreFloat3(&Info.Centroid, Area > 0.f ? DirectX::XMVectorScale(Centroid, 1.f / Area) : Centroid);
+		DirectX::XMStoreFloat3(&Info.Normal, DirectX::XMVector3Normalize(Normal));
+		Info.Area = Area;
+	}
+	if (MeshArea > 0.f)
+	{
+		MeshCentroid = DirectX::XMVectorScale(MeshCentroid, 1.f / MeshArea);
+	}
+
+	// clusters facing away from the middle of the mesh are the ones most likely in front, so they draw first and the rest fail depth
+	for (ClusterInfo& Info : Infos)
+	{
+		const DirectX::XMVECTOR Offset = DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&Info.Centroid), MeshCentroid);
+		Info.SortKey = DirectX::XMVectorGetX(DirectX::XMVector3Dot(Offset, DirectX::XMLoadFloat3(&Info.Normal)));
+	}
+	std::stable_sort(Infos.begin(), Infos.end(), [](const ClusterInfo& a, const ClusterInfo& b) { return a.SortKey > b.SortKey; });
+
+	std::vector<UINT> Output;
+	Output.reserve(Indices.size());
+	for (const ClusterInfo& Info : Infos)
+	{
+		Output.insert(Output.end(), Indices.begin() + Info.Start * 3u, Indices.begin() + Info.End * 3u);
+	}
+	Indices.swap(Output);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<Vertex>& Vertices, std::vector<UINT>& Indices)
+{
+	std::vector<UINT> Remap(Vertices.size(), INVALID_VERTEX);
+	std::vector<Vertex> Output;
+	Output.reserve(Vertices.size());
+
+	for (UINT& Index : Indices)
+	{
+		if (Remap[Index] == INVALID_VERTEX)
+		{
+			Remap[Index] = (UINT)Output.size();
+			Output.push_back(Vertices[Index]);
+		}
+		Index = Remap[Index];
+	}
+	Vertices.swap(Output);
+}
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const UINT* Indices, UINT IndexCount, UINT VertexCount, UINT CacheSize)
+{
+	VertexCacheStats Stats;
+	if (IndexCount < 3u)
+		return Stats;
+
+	CacheSimulator Cache(VertexCount, CacheSize);
+	std::vector<bool> Referenced(VertexCount, false);
+	UINT Misses = 0u;
+	UINT ReferencedCount = 0u;
+	for (UINT i = 0u; i < IndexCount; i++)
+	{
+		Misses += Cache.Access(Indices[i]) ? 1u : 0u;
+		if (!Referenced[Indices[i]])
+		{
+			Referenced[Indices[i]] = true;
+			ReferencedCount++;
+		}
+	}
+
+	Stats.ACMR = (float)Misses / (float)(IndexCount / 3u);
+	Stats.ATVR = (float)Misses / (float)ReferencedCount;
+	return Stats;
+}
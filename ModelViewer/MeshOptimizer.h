@@ -0,0 +1,57 @@
+#pragma once
+
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <vector>
+
+#include "DirectXMath.h"
+
+#include "Common.h"
+
+typedef unsigned int UINT;
+
+// FIFO post-transform cache the orderings are tuned for and measured against, about what current GPUs keep per batch
+const UINT VERTEX_CACHE_SIZE = 16u;
+// overdraw ordering may cost at most this much ACMR over the pure vertex cache order
+const float OVERDRAW_ACMR_THRESHOLD = 1.05f;
+
+struct VertexCacheStats
+{
+	float ACMR = 0.f;		// transformed vertices per triangle, 0.5 is the limit for a large regular grid, 3 is no reuse at all
+	float ATVR = 0.f;		// transformed vertices per referenced vertex, 1 is every vertex transformed exactly once
+};
+
+struct MeshOptimizeStats
+{
+	VertexCacheStats Before;
+	VertexCacheStats After;
+	UINT VerticesBefore = 0u;
+	UINT VerticesAfter = 0u;
+};
+
+/*
+*	Import time reordering of one mesh's vertex and index arrays, none of it changes what is drawn. Exact duplicate vertices are
+*	welded, triangles are put in Tipsify order (Sander et al. 2007) for the post-transform vertex cache, the clusters that order
+*	produces are sorted so outward facing ones draw first to cut overdraw, and vertices are renumbered in first use order so vertex
+*	fetch walks memory forwards. Optimize runs every step and measures the cache before and after. Pure CPU, no device needed.
+*/
+
+class MeshOptimizer
+{
+public:
+	static MeshOptimizeStats Optimize(std::vector<Vertex>& Vertices, std::vector<UINT>& Indices);
+
+	// returns the number of vertices removed, indices are remapped to the survivors
+	static UINT WeldVertices(std::vector<Vertex>& Vertices, std::vector<UINT>& Indices);
+	// OutClusters gets the first triangle of every cluster the overdraw pass may move as a whole
+	static void OptimizeVertexCache(std::vector<UINT>& Indices, UINT VertexCount, std::vector<UINT>& OutClusters);
+	static void OptimizeOverdraw(std::vector<UINT>& Indices, const std::vector<Vertex>& Vertices, const std::vector<UINT>& Clusters);
+	// drops vertices no index refers to
+	static void OptimizeVertexFetch(std::vector<Vertex>& Vertices, std::vector<UINT>& Indices);
+
+	static VertexCacheStats AnalyzeVertexCache(const UINT* Indices, UINT IndexCount, UINT VertexCount, UINT CacheSize = VERTEX_CACHE_SIZE);
+
+};
+
+#endif
@@ -0,0 +1,530 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+
+static const UINT INVALID_VERTEX = 0xFFFFFFFF;
+// how much more moving a vertex off a border or seam costs than moving it off the surface by the same distance
+static const double BOUNDARY_WEIGHT = 10.0;
+// a border or seam turning by more than 45 degrees at a vertex has a corner there, which stays where it is
+static const double MIN_CORNER_COS = 0.7071;
+
+enum class VertexKind : unsigned char
+{
+	Manifold,		// one attribute set, no open edges, moves anywhere along its edges
+	Border,			// one attribute set on the mesh's boundary, slides along the boundary
+	Seam,			// two attribute sets split along a seam, slides along the seam with both sets
+	Locked			// anything else, never moves
+};
+
+struct Vector3d
+{
+	double x, y, z;
+
+	Vector3d operator-(const Vector3d& Other) const { return { x - Other.x, y - Other.y, z - Other.z }; }
+	double Dot(const Vector3d& Other) const { return x * Other.x + y * Other.y + z * Other.z; }
+	Vector3d Cross(const Vector3d& Other) const { return { y * Other.z - z * Other.y, z * Other.x - x * Other.z, x * Other.y - y * Other.x }; }
+	double Length() const { return sqrt(Dot(*this)); }
+};
+
+// sum of weighted squared distances to planes, as the symmetric matrix, vector and constant of p'Ap + 2b'p + c
+struct Quadric
+{
+	double a00 = 0.0, a11 = 0.0, a22 = 0.0, a01 = 0.0, a02 = 0.0, a12 = 0.0;
+	double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+	double c = 0.0;
+
+	// Normal has to be unit length
+	void AddPlane(const Vector3d& Normal, double Distance, double Weight)
+	{
+		a00 += Weight * Normal.x * Normal.x;
+		a11 += Weight * Normal.y * Normal.y;
+		a22 += Weight * Normal.z * Normal.z;
+		a01 += Weight * Normal.x * Normal.y;
+		a02 += Weight * Normal.x * Normal.z;
+		a12 += Weight * Normal.y * Normal.z;
+		b0 += Weight * Normal.x * Distance;
+		b1 += Weight * Normal.y * Distance;
+		b2 += Weight * Normal.z * Distance;
+		c += Weight * Distance * Distance;
+	}
+
+	void Add(const Quadric& Other)
+	{
+		a00 += Other.a00; a11 += Other.a11; a22 += Other.a22;
+		a01 += Other.a01; a02 += Other.a02; a12 += Other.a12;
+		b0 += Other.b0; b1 += Other.b1; b2 += Other.b2;
+		c += Other.c;
+	}
+
+	double Evaluate(const Vector3d& p) const
+	{
+		const double Ax = a00 * p.x + a01 * p.y + a02 * p.z;
+		const double Ay = a01 * p.x + a11 * p.y + a12 * p.z;
+		const double Az = a02 * p.x + a12 * p.y + a22 * p.z;
+		const double Result = p.x * Ax + p.y * Ay + p.z * Az + 2.0 * (p.x * b0 + p.y * b1 + p.z * b2) + c;
+		return Result > 0.0 ? Result : 0.0;
+	}
+};
+
+struct Collapse
+{
+	double Cost;
+	UINT From;
+	UINT To;
+
+	bool operator<(const Collapse& Other) const
+	{
+		if (Cost != Other.Cost)
+			return Cost < Other.Cost;
+		return From != Other.From ? From < Other.From : To < Other.To;
+	}
+};
+
+// per vertex lists in one array, Items[Offsets[v]] to Items[Offsets[v + 1]]
+struct Adjacency
+{
+	std::vector<UINT> Offsets;
+	std::vector<UINT> Items;
+
+	// Keys(t, k) is the vertex the k-th item of triangle t is listed under, Values(t, k) what is listed
+	template<typename KeyFn, typename ValueFn>
+	void Build(UINT VertexCount, UINT TriangleCount, KeyFn Key, ValueFn Value)
+	{
+		Offsets.assign(VertexCount + 1u, 0u);
+		for (UINT t = 0u; t < TriangleCount; t++)
+		{
+			for (UINT k = 0u; k < 3u; k++)
+			{
+				Offsets[Key(t, k) + 1u]++;
+			}
+		}
+		for (UINT v = 0u; v < VertexCount; v++)
+		{
+			Offsets[v + 1u] += Offsets[v];
+		}
+
+		Items.resize(Offsets[VertexCount]);
+		std::vector<UINT> Fill(Offsets.begin(), Offsets.end() - 1);
+		for (UINT t = 0u; t < TriangleCount; t++)
+		{
+			for (UINT k = 0u; k < 3u; k++)
+			{
+				Items[Fill[Key(t, k)]++] = Value(t, k);
+			}
+		}
+	}
+};
+
+// state of one Simplify call, Remap maps every vertex to the first vertex with the same position and Wedges links all the vertices
+// of one position in a ring. Quadrics and the lock flags live on the first vertex of a position
+struct SimplifyState
+{
+	const UINT VertexCount;
+	std::vector<UINT> Remap;
+	std::vector<UINT> Wedges;
+	std::vector<VertexKind> Kinds;
+	std::vector<Vector3d> Positions;
+	std::vector<Quadric> Quadrics;
+	std::vector<double> Weights;
+
+	// the other end of the vertex's open half edges, INVALID_VERTEX for none and the vertex itself for more than one
+	std::vector<UINT> OpenOut;
+	std::vector<UINT> OpenIn;
+	Adjacency HalfEdges;
+	Adjacency PositionTriangles;
+
+	explicit SimplifyState(UINT Count) : VertexCount(Count) {}
+
+	bool HasEdge(UINT From, UINT To) const
+	{
+		for (UINT i = HalfEdges.Offsets[From]; i < HalfEdges.Offsets[From + 1u]; i++)
+		{
+			if (HalfEdges.Items[i] == To)
+				return true;
+		}
+		return false;
+	}
+
+	// an edge between the positions, with any of their vertices
+	bool HasPositionEdge(UINT From, UINT To) const
+	{
+		UINT v = From;
+		do
+		{
+			for (UINT i = HalfEdges.Offsets[v]; i < HalfEdges.Offsets[v + 1u]; i++)
+			{
+				if (Remap[HalfEdges.Items[i]] == Remap[To])
+					return true;
+			}
+			v = Wedges[v];
+		} while (v != From);
+		return false;
+	}
+
+	void UpdateTopology(const std::vector<UINT>& Indices)
+	{
+		const UINT TriangleCount = (UINT)Indices.size() / 3u;
+		HalfEdges.Build(VertexCount, TriangleCount, [&](UINT t, UINT k) { return Indices[t * 3u + k]; }, [&](UINT t, UINT k) { return Indices[t * 3u + (k + 1u) % 3u]; });
+		PositionTriangles.Build(VertexCount, TriangleCount, [&](UINT t, UINT k) { return Remap[Indices[t * 3u + k]]; }, [](UINT t, UINT) { return t; });
+
+		OpenOut.assign(VertexCount, INVALID_VERTEX);
+		OpenIn.assign(VertexCount, INVALID_VERTEX);
+		for (UINT v = 0u; v < VertexCount; v++)
+		{
+			for (UINT i = HalfEdges.Offsets[v]; i < HalfEdges.Offsets[v + 1u]; i++)
+			{
+				const UINT w = HalfEdges.Items[i];
+				if (HasEdge(w, v))
+					continue;
+
+				OpenOut[v] = OpenOut[v] == INVALID_VERTEX ? w : v;
+				OpenIn[w] = OpenIn[w] == INVALID_VERTEX ? v : w;
+			}
+		}
+	}
+
+	bool HasSingleOpenEdges(UINT v) const
+	{
+		return OpenOut[v] != INVALID_VERTEX && OpenOut[v] != v && OpenIn[v] != INVALID_VERTEX && OpenIn[v] != v;
+	}
+
+	bool IsCorner(UINT v) const
+	{
+		const Vector3d In = Positions[v] - Positions[OpenIn[v]];
+		const Vector3d Out = Positions[OpenOut[v]] - Positions[v];
+		return In.Dot(Out) < MIN_CORNER_COS * In.Length() * Out.Length();
+	}
+
+	void ClassifyVertices()
+	{
+		Kinds.assign(VertexCount, VertexKind::Locked);
+		for (UINT v = 0u; v < VertexCount; v++)
+		{
+			if (Remap[v] != v)
+				continue;
+
+			const UINT w = Wedges[v];
+			VertexKind Kind = VertexKind::Locked;
+			if (w == v)
+			{
+				// open edges that are open for the position too, not ends of a seam
+				if (OpenOut[v] == INVALID_VERTEX && OpenIn[v] == INVALID_VERTEX)
+				{
+					Kind = VertexKind::Manifold;
+				}
+				else if (HasSingleOpenEdges(v) && !HasPositionEdge(OpenOut[v], v) && !HasPositionEdge(v, OpenIn[v]) && !IsCorner(v))
+				{
+					Kind = VertexKind::Border;
+				}
+			}
+			else if (Wedges[w] == v && HasSingleOpenEdges(v) && HasSingleOpenEdges(w))
+			{
+				// both sides run the same way along the seam, in opposite directions, and the seam is closed for the position
+				if (Remap[OpenOut[v]] == Remap[OpenIn[w]] && Remap[OpenIn[v]] == Remap[OpenOut[w]] && Remap[OpenOut[v]] != Remap[OpenIn[v]] &&
+					HasPositionEdge(OpenOut[v], v) && HasPositionEdge(v, OpenIn[v]) && !IsCorner(v))
+				{
+					Kind = VertexKind::Seam;
+				}
+			}
+
+			UINT u = v;
+			do
+			{
+				Kinds[u] = Kind;
+				u = Wedges[u];
+			} while (u != v);
+		}
+	}
+
+	// the vertex the other vertex of From's position has to go to when From collapses to To, INVALID_VERTEX if From can not collapse to To
+	UINT GetCollapseSibling(UINT From, UINT To) const
+	{
+		if (Remap[From] == Remap[To])
+			return INVALID_VERTEX;
+
+		const VertexKind ToKind = Kinds[To];
+		switch (Kinds[From])
+		{
+		case VertexKind::Manifold:
+			return OpenOut[From] == INVALID_VERTEX && OpenIn[From] == INVALID_VERTEX ? From : INVALID_VERTEX;
+		case VertexKind::Border:
+			return (To == OpenOut[From] || To == OpenIn[From]) && (ToKind == VertexKind::Border || ToKind == VertexKind::Locked) ? From : INVALID_VERTEX;
+		case VertexKind::Seam:
+		{
+			if ((To != OpenOut[From] && To != OpenIn[From]) || (ToKind != VertexKind::Seam && ToKind != VertexKind::Locked))
+				return INVALID_VERTEX;
+
+			// the other side runs the other way, its edge towards the same position is the matching one
+			const UINT Sibling = Wedges[From];
+			const UINT SiblingTo = To == OpenOut[From] ? OpenIn[Sibling] : OpenOut[Sibling];
+			return HasSingleOpenEdges(Sibling) && Remap[SiblingTo] == Remap[To] ? SiblingTo : INVALID_VERTEX;
+		}
+		default:
+			return INVALID_VERTEX;
+		}
+	}
+
+	double GetCost(UINT From, UINT To) const
+	{
+		const UINT a = Remap[From];
+		const UINT b = Remap[To];
+		Quadric Q = Quadrics[a];
+		Q.Add(Quadrics[b]);
+		const double Weight = Weights[a] + Weights[b];
+		return Weight > 0.0 ? Q.Evaluate(Positions[To]) / Weight : Q.Evaluate(Positions[To]);
+	}
+
+	// any triangle around From's position that survives the collapse turning over or becoming degenerate
+	bool HasTriangleFlip(const std::vector<UINT>& Indices, UINT From, UINT To) const
+	{
+		const UINT a = Remap[From];
+		const UINT b = Remap[To];
+		for (UINT i = PositionTriangles.Offsets[a]; i < PositionTriangles.Offsets[a + 1u]; i++)
+		{
+			const UINT* Triangle = &Indices[PositionTriangles.Items[i] * 3u];
+			const UINT r0 = Remap[Triangle[0]], r1 = Remap[Triangle[1]], r2 = Remap[Triangle[2]];
+			if (r0 == b || r1 == b || r2 == b)
+				continue;
+
+			const Vector3d p0 = Positions[r0], p1 = Positions[r1], p2 = Positions[r2];
+			const Vector3d q0 = r0 == a ? Positions[b] : p0;
+			const Vector3d q1 = r1 == a ? Positions[b] : p1;
+			const Vector3d q2 = r2 == a ? Positions[b] : p2;
+			// a triangle that already has no area has no facing to lose
+			const Vector3d Before = (p1 - p0).Cross(p2 - p0);
+			const Vector3d After = (q1 - q0).Cross(q2 - q0);
+			if (Before.Dot(Before) > 0.0 && Before.Dot(After) <= 0.0)
+				return true;
+		}
+		return false;
+	}
+};
+
+float MeshSimplifier::Simplify(const Vertex* Vertices, UINT VertexCount, const UINT* Indices, UINT IndexCount, UINT TargetIndexCount, float TargetError,
+	std::vector<UINT>& OutIndices)
+{
+	OutIndices.assign(Indices, Indices + IndexCount);
+	if (IndexCount % 3u != 0u || IndexCount <= TargetIndexCount || VertexCount == 0u)
+		return 0.f;
+
+	SimplifyState State(VertexCount);
+
+	// sorting by position bits then index makes the first vertex of every position its representative without any hashing
+	std::vector<UINT> Order(VertexCount);
+	for (UINT v = 0u; v < VertexCount; v++)
+	{
+		Order[v] = v;
+	}
+	std::sort(Order.begin(), Order.end(), [Vertices](UINT a, UINT b)
+		{
+			const int Compare = memcmp(&Vertices[a].Pos, &Vertices[b].Pos, sizeof(DirectX::XMFLOAT3));
+			return Compare != 0 ? Compare < 0 : a < b;
+		});
+
+	State.Remap.resize(VertexCount);
+	State.Wedges.resize(VertexCount);
+	for (UINT i = 0u; i < VertexCount; i++)
+	{
+		const UINT v = Order[i];
+		const bool bSame = i > 0u && memcmp(&Vertices[Order[i - 1u]].Pos, &Vertices[v].Pos, sizeof(DirectX::XMFLOAT3)) == 0;
+		State.Remap[v] = bSame ? State.Remap[Order[i - 1u]] : v;
+		State.Wedges[v] = v;
+		if (bSame)
+		{
+			const UINT First = State.Remap[v];
+			State.Wedges[v] = State.Wedges[First];
+			State.Wedges[First] = v;
+		}
+	}
+
+	// quadrics work on positions scaled into the unit cube so the costs do not depend on the model's units
+	DirectX::XMFLOAT3 Min = Vertices[0].Pos;
+	DirectX::XMFLOAT3 Max = Vertices[0].Pos;
+	for (UINT v = 1u; v < VertexCount; v++)
+	{
+		Min = { fminf(Min.x, Vertices[v].Pos.x), fminf(Min.y, Vertices[v].Pos.y), fminf(Min.z, Vertices[v].Pos.z) };
+		Max = { fmaxf(Max.x, Vertices[v].Pos.x), fmaxf(Max.y, Vertices[v].Pos.y), fmaxf(Max.z, Vertices[v].Pos.z) };
+	}
+	const double Extent = fmax(fmax((double)Max.x - Min.x, (double)Max.y - Min.y), fmax((double)Max.z - Min.z, 1e-30));
+	State.Positions.resize(VertexCount);
+	for (UINT v = 0u; v < VertexCount; v++)
+	{
+		State.Positions[v] = { (Vertices[v].Pos.x - Min.x) / Extent, (Vertices[v].Pos.y - Min.y) / Extent, (Vertices[v].Pos.z - Min.z) / Extent };
+	}
+
+	State.UpdateTopology(OutIndices);
+	State.ClassifyVertices();
+
+	// every triangle's plane weighted by its area, and a plane through every open edge at right angles to its triangle
+	State.Quadrics.assign(VertexCount, Quadric());
+	State.Weights.assign(VertexCount, 0.0);
+	for (UINT t = 0u; t < IndexCount / 3u; t++)
+	{
+		const UINT* Triangle = &OutIndices[t * 3u];
+		const Vector3d& p0 = State.Positions[Triangle[0]];
+		const Vector3d Cross = (State.Positions[Triangle[1]] - p0).Cross(State.Positions[Triangle[2]] - p0);
+		const double Length = Cross.Length();
+		if (Length <= 0.0)
+			continue;
+
+		const Vector3d Normal = { Cross.x / Length, Cross.y / Length, Cross.z / Length };
+		for (UINT k = 0u; k < 3u; k++)
+		{
+			State.Quadrics[State.Remap[Triangle[k]]].AddPlane(Normal, -Normal.Dot(p0), Length * 0.5);
+			State.Weights[State.Remap[Triangle[k]]] += Length * 0.5;
+
+			const UINT From = Triangle[k];
+			const UINT To = Triangle[(k + 1u) % 3u];
+			if (State.HasEdge(To, From))
+				continue;
+
+			const Vector3d Edge = State.Positions[To] - State.Positions[From];
+			const Vector3d EdgeNormal = Edge.Cross(Normal);
+			const double EdgeNormalLength = EdgeNormal.Length();
+			if (EdgeNormalLength <= 0.0)
+				continue;
+
+			const Vector3d Plane = { EdgeNormal.x / EdgeNormalLength, EdgeNormal.y / EdgeNormalLength, EdgeNormal.z / EdgeNormalLength };
+			const double Weight = Edge.Dot(Edge) * BOUNDARY_WEIGHT;
+			State.Quadrics[State.Remap[From]].AddPlane(Plane, -Plane.Dot(State.Positions[From]), Weight);
+			State.Quadrics[State.Remap[To]].AddPlane(Plane, -Plane.Dot(State.Positions[From]), Weight);
+		}
+	}
+
+	const double ErrorLimit = (double)TargetError / Extent * ((double)TargetError / Extent);
+	double MaxCost = 0.0;
+
+	std::vector<Collapse> Candidates;
+	std::vector<UINT> Targets(VertexCount);
+	std::vector<unsigned char> Locked(VertexCount);
+	for (UINT v = 0u; v < VertexCount; v++)
+	{
+		Targets[v] = v;
+	}
+
+	// each pass collapses the cheapest edges whose neighbourhoods do not overlap, so every cost it uses is still exact when applied
+	while (OutIndices.size() > TargetIndexCount)
+	{
+		const UINT TriangleCount = (UINT)OutIndices.size() / 3u;
+
+		Candidates.clear();
+		for (UINT t = 0u; t < TriangleCount; t++)
+		{
+			for (UINT k = 0u; k < 3u; k++)
+			{
+				const UINT a = OutIndices[t * 3u + k];
+				const UINT b = OutIndices[t * 3u + (k + 1u) % 3u];
+				if (State.GetCollapseSibling(a, b) != INVALID_VERTEX)
+					Candidates.push_back({ State.GetCost(a, b), a, b });
+				if (State.GetCollapseSibling(b, a) != INVALID_VERTEX)
+					Candidates.push_back({ State.GetCost(b, a), b, a });
+			}
+		}
+		std::sort(Candidates.begin(), Candidates.end());
+
+		std::fill(Locked.begin(), Locked.end(), (unsigned char)0u);
+		const UINT TrianglesToRemove = TriangleCount - TargetIndexCount / 3u;
+		UINT TrianglesRemoved = 0u;
+		UINT CollapseCount = 0u;
+		for (const Collapse& c : Candidates)
+		{
+			if (c.Cost > ErrorLimit || TrianglesRemoved >= TrianglesToRemove)
+				break;
+
+			const UINT a = State.Remap[c.From];
+			const UINT b = State.Remap[c.To];
+			if (Locked[a] || Locked[b] || State.HasTriangleFlip(OutIndices, c.From, c.To))
+				continue;
+
+			const UINT Sibling = State.Wedges[c.From];
+			Targets[c.From] = c.To;
+			if (Sibling != c.From)
+			{
+				Targets[Sibling] = State.GetCollapseSibling(c.From, c.To);
+			}
+
+			// the whole one ring is locked, anything touching it would be costed against positions that just changed
+			for (UINT i = State.PositionTriangles.Offsets[a]; i < State.PositionTriangles.Offsets[a + 1u]; i++)
+			{
+				const UINT* Triangle = &OutIndices[State.PositionTriangles.Items[i] * 3u];
+				bool bRemoved = false;
+				for (UINT k = 0u; k < 3u; k++)
+				{
+					Locked[State.Remap[Triangle[k]]] = 1u;
+					bRemoved |= State.Remap[Triangle[k]] == b;
+				}
+				TrianglesRemoved += bRemoved ? 1u : 0u;
+			}
+
+			State.Quadrics[b].Add(State.Quadrics[a]);
+			State.Weights[b] += State.Weights[a];
+			MaxCost = fmax(MaxCost, c.Cost);
+			CollapseCount++;
+		}
+
+		if (CollapseCount == 0u)
+			break;
+
+		// triangles that lost an edge are dropped, the rest keep their order
+		UINT Write = 0u;
+		for (UINT t = 0u; t < TriangleCount; t++)
+		{
+			const UINT i0 = Targets[OutIndices[t * 3u]];
+			const UINT i1 = Targets[OutIndices[t * 3u + 1u]];
+			const UINT i2 = Targets[OutIndices[t * 3u + 2u]];
+			const UINT r0 = State.Remap[i0], r1 = State.Remap[i1], r2 = State.Remap[i2];
+			if (r0 == r1 || r1 == r2 || r0 == r2)
+				continue;
+
+			OutIndices[Write++] = i0;
+			OutIndices[Write++] = i1;
+			OutIndices[Write++] = i2;
+		}
+		OutIndices.resize(Write);
+
+		for (UINT v = 0u; v < VertexCount; v++)
+		{
+			Targets[v] = v;
+		}
+		State.UpdateTopology(OutIndices);
+	}
+
+	return (float)(sqrt(MaxCost) * Extent);
+}
+
+void MeshSimplifier::GenerateLODs(const std::vector<Vertex>& Vertices, const std::vector<UINT>& Indices, std::vector<MeshLOD>& OutLODs, std::vector<UINT>& OutLODIndices)
+{
+	OutLODs.clear();
+	OutLODIndices.clear();
+	OutLODs.push_back({ 0u, (UINT)Indices.size(), 0.f });
+	if (Indices.empty() || Indices.size() % 3u != 0u || Vertices.empty())
+		return;
+
+	DirectX::XMFLOAT3 Min = Vertices[0].Pos;
+	DirectX::XMFLOAT3 Max = Vertices[0].Pos;
+	for (const Vertex& v : Vertices)
+	{
+		Min = { fminf(Min.x, v.Pos.x), fminf(Min.y, v.Pos.y), fminf(Min.z, v.Pos.z) };
+		Max = { fmaxf(Max.x, v.Pos.x), fmaxf(Max.y, v.Pos.y), fmaxf(Max.z, v.Pos.z) };
+	}
+	const float MaxError = fmaxf(fmaxf(Max.x - Min.x, Max.y - Min.y), Max.z - Min.z) * LOD_MAX_RELATIVE_ERROR;
+
+	// every level starts from the full mesh, simplifying a simplified level would stack the errors of both
+	std::vector<UINT> LevelIndices;
+	std::vector<UINT> Clusters;
+	for (UINT Level = 1u; Level < MAX_MESH_LODS; Level++)
+	{
+		const UINT Previous = OutLODs.back().IndexCount;
+		const UINT Target = (UINT)((float)(Previous / 3u) * LOD_TRIANGLE_RATIO) * 3u;
+		const float Error = Simplify(Vertices.data(), (UINT)Vertices.size(), Indices.data(), (UINT)Indices.size(), Target, MaxError, LevelIndices);
+		if (LevelIndices.empty() || (float)LevelIndices.size() > (float)Previous * LOD_MIN_REDUCTION)
+			break;
+
+		MeshOptimizer::OptimizeVertexCache(LevelIndices, (UINT)Vertices.size(), Clusters);
+		OutLODs.push_back({ (UINT)(Indices.size() + OutLODIndices.size()), (UINT)LevelIndices.size(), fmaxf(Error, OutLODs.back().Error) });
+		OutLODIndices.insert(OutLODIndices.end(), LevelIndices.begin(), LevelIndices.end());
+	}
+}
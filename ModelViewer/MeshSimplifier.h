@@ -0,0 +1,53 @@
+#pragma once
+
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <vector>
+
+#include "DirectXMath.h"
+
+#include "Common.h"
+
+typedef unsigned int UINT;
+
+// every level aims for this fraction of the triangles of the level before it
+const float LOD_TRIANGLE_RATIO = 0.5f;
+// a level that could not get under this fraction of the level before it is not worth the memory and is dropped with every level after it
+const float LOD_MIN_REDUCTION = 0.85f;
+// largest error any level may have, relative to the largest extent of the mesh's bounds
+const float LOD_MAX_RELATIVE_ERROR = 0.05f;
+
+// one level of detail of a mesh, level 0 is the mesh itself. Error is the geometric error of the level in the mesh's local space
+struct MeshLOD
+{
+	UINT IndexOffset;		// relative to the start of the mesh's indices, the levels follow the full mesh's indices
+	UINT IndexCount;
+	float Error;
+};
+
+/*
+*	Import time simplification with quadric error metrics (Garland and Heckbert 1997). Edges are collapsed onto one of their existing
+*	vertices, so every level indexes the mesh's own vertex range and a level costs nothing but its indices. Vertices that share a
+*	position (UV seams, hard normals) move together: a vertex on an open edge of its attributes only slides along that edge, a seam
+*	vertex takes the matching vertex on the other side of the seam with it, and positions where more than two attribute sets meet
+*	or the surface is not manifold never move, and neither do the corners of borders and seams. Open edges also add constraint planes
+*	to the quadrics, so borders and seams keep their shape. Collapses are applied in passes ordered by cost with the vertex numbers
+*	breaking ties, the result only depends on the input. Pure CPU, no device needed.
+*/
+
+class MeshSimplifier
+{
+public:
+	// OutIndices gets a triangle list into the same vertices with at most TargetIndexCount indices where that is possible without
+	// collapsing anything costing more than TargetError. Returns the largest error of any collapse done, in the positions' units
+	static float Simplify(const Vertex* Vertices, UINT VertexCount, const UINT* Indices, UINT IndexCount, UINT TargetIndexCount, float TargetError,
+		std::vector<UINT>& OutIndices);
+
+	// levels 1 and up of the mesh, each simplified from the full mesh and put in vertex cache order. OutLODs[0] is the full mesh,
+	// OutLODIndices holds the indices of every other level back to back, their offsets start right after the full mesh's indices
+	static void GenerateLODs(const std::vector<Vertex>& Vertices, const std::vector<UINT>& Indices, std::vector<MeshLOD>& OutLODs, std::vector<UINT>& OutLODIndices);
+
+};
+
+#endif
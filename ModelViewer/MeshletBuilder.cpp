@@ -0,0 +1,141 @@
+#include <cfloat>
+#include <cmath>
+
+#include "MeshletBuilder.h"
+
+// a cone wider than this many degrees from its axis is barely ever entirely backfacing, not worth testing
+static const float MIN_CONE_DOT = 0.1f;
+// widens every cone a little so triangles that are edge on to the camera within float precision are never rejected
+static const float CONE_DOT_MARGIN = 1e-3f;
+
+void MeshletBuilder::Build(const Vertex* Vertices, UINT VertexCount, const UINT* Indices, UINT IndexCount, std::vector<Meshlet>& OutMeshlets)
+{
+	OutMeshlets.clear();
+
+	// which cluster last counted each vertex, so a vertex shared by several triangles of one cluster is counted once
+	std::vector<UINT> LastMeshlet(VertexCount, 0xFFFFFFFF);
+	const UINT TriangleCount = IndexCount / 3u;
+
+	Meshlet Current = {};
+	UINT MeshletIndex = 0u;
+	for (UINT t = 0u; t < TriangleCount; t++)
+	{
+		const UINT* Triangle = Indices + t * 3u;
+		UINT NewVertices = 0u;
+		for (UINT k = 0u; k < 3u; k++)
+		{
+			// a vertex repeated inside the triangle itself is only new once
+			const bool bRepeated = (k > 0u && Triangle[k] == Triangle[0]) || (k > 1u && Triangle[k] == Triangle[1]);
+			NewVertices += LastMeshlet[Triangle[k]] != MeshletIndex && !bRepeated ? 1u : 0u;
+		}
+
+		if (Current.TriangleCount == MESHLET_MAX_TRIANGLES || Current.VertexCount + NewVertices > MESHLET_MAX_VERTICES)
+		{
+			ComputeBounds(Vertices, Indices, Current);
+			OutMeshlets.push_back(Current);
+
+			Current = {};
+			Current.IndexOffset = t * 3u;
+			MeshletIndex++;
+			NewVertices = 0u;
+			for (UINT k = 0u; k < 3u; k++)
+			{
+				const bool bRepeated = (k > 0u && Triangle[k] == Triangle[0]) || (k > 1u && Triangle[k] == Triangle[1]);
+				NewVertices += bRepeated ? 0u : 1u;
+			}
+		}
+
+		for (UINT k = 0u; k < 3u; k++)
+		{
+			LastMeshlet[Triangle[k]] = MeshletIndex;
+		}
+		Current.VertexCount += NewVertices;
+		Current.TriangleCount++;
+	}
+
+	if (Current.TriangleCount > 0u)
+	{
+		ComputeBounds(Vertices, Indices, Current);
+		OutMeshlets.push_back(Current);
+	}
+}
+
+void MeshletBuilder::ComputeBounds(const Vertex* Vertices, const UINT* Indices, Meshlet& InOutMeshlet)
+{
+	using namespace DirectX;
+
+	const UINT* First = Indices + InOutMeshlet.IndexOffset;
+	const UINT IndexCount = InOutMeshlet.TriangleCount * 3u;
+
+	// sphere around the centre of the cluster's box, a little looser than the minimal sphere and far cheaper
+	XMVECTOR Min = XMVectorReplicate(FLT_MAX);
+	XMVECTOR Max = XMVectorReplicate(-FLT_MAX);
+	for (UINT i = 0u; i < IndexCount; i++)
+	{
+		const XMVECTOR Pos = XMLoadFloat3(&Vertices[First[i]].Pos);
+		Min = XMVectorMin(Min, Pos);
+		Max = XMVectorMax(Max, Pos);
+	}
+	const XMVECTOR Center = XMVectorScale(XMVectorAdd(Min, Max), 0.5f);
+
+	float RadiusSq = 0.f;
+	for (UINT i = 0u; i < IndexCount; i++)
+	{
+		RadiusSq = fmaxf(RadiusSq, XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(XMLoadFloat3(&Vertices[First[i]].Pos), Center))));
+	}
+	XMStoreFloat3(&InOutMeshlet.Center, Center);
+	InOutMeshlet.Radius = sqrtf(RadiusSq);
+
+	// the axis is the area weighted mean face normal, degenerate triangles have no facing and are never rasterized so they are skipped
+	XMVECTOR Normals[MESHLET_MAX_TRIANGLES];
+	bool bValid[MESHLET_MAX_TRIANGLES];
+	XMVECTOR AxisSum = XMVectorZero();
+	for (UINT t = 0u; t < InOutMeshlet.TriangleCount; t++)
+	{
+		const XMVECTOR p0 = XMLoadFloat3(&Vertices[First[t * 3u]].Pos);
+		const XMVECTOR p1 = XMLoadFloat3(&Vertices[First[t * 3u + 1u]].Pos);
+		const XMVECTOR p2 = XMLoadFloat3(&Vertices[First[t * 3u + 2u]].Pos);
+		const XMVECTOR Cross = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+		const float Length = XMVectorGetX(XMVector3Length(Cross));
+
+		bValid[t] = Length > 0.f;
+		Normals[t] = bValid[t] ? XMVectorScale(Cross, 1.f / Length) : XMVectorZero();
+		AxisSum = XMVectorAdd(AxisSum, Cross);
+	}
+
+	InOutMeshlet.ConeAxis = { 0.f, 0.f, 0.f };
+	InOutMeshlet.ConeApex = InOutMeshlet.Center;
+	InOutMeshlet.ConeCutoff = MESHLET_NO_CONE;
+
+	const float AxisLength = XMVectorGetX(XMVector3Length(AxisSum));
+	if (AxisLength <= 0.f)
+		return;
+	const XMVECTOR Axis = XMVectorScale(AxisSum, 1.f / AxisLength);
+
+	float MinDot = 1.f;
+	for (UINT t = 0u; t < InOutMeshlet.TriangleCount; t++)
+	{
+		if (bValid[t])
+			MinDot = fminf(MinDot, XMVectorGetX(XMVector3Dot(Axis, Normals[t])));
+	}
+	MinDot -= CONE_DOT_MARGIN;
+	if (MinDot <= MIN_CONE_DOT)
+		return;
+
+	// slide the apex back along the axis until it is behind every triangle's plane, then any camera inside the cone behind it sees
+	// every triangle from the back
+	float MaxT = 0.f;
+	for (UINT t = 0u; t < InOutMeshlet.TriangleCount; t++)
+	{
+		if (!bValid[t])
+			continue;
+
+		const XMVECTOR p0 = XMLoadFloat3(&Vertices[First[t * 3u]].Pos);
+		const float Distance = XMVectorGetX(XMVector3Dot(XMVectorSubtract(Center, p0), Normals[t]));
+		MaxT = fmaxf(MaxT, Distance / XMVectorGetX(XMVector3Dot(Axis, Normals[t])));
+	}
+
+	XMStoreFloat3(&InOutMeshlet.ConeAxis, Axis);
+	XMStoreFloat3(&InOutMeshlet.ConeApex, XMVectorSubtract(Center, XMVectorScale(Axis, MaxT)));
+	InOutMeshlet.ConeCutoff = sqrtf(1.f - MinDot * MinDot);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#ifndef MESHLET_BUILDER_H
+#define MESHLET_BUILDER_H
+
+#include <vector>
+
+#include "DirectXMath.h"
+
+#include "Common.h"
+
+typedef unsigned int UINT;
+
+// the usual mesh shader sizes, small enough that a cluster's bounds and normals stay tight
+const UINT MESHLET_MAX_VERTICES = 64u;
+const UINT MESHLET_MAX_TRIANGLES = 124u;
+// ConeCutoff of a cluster whose triangles face too many ways for any camera to see only their backs
+const float MESHLET_NO_CONE = 2.f;
+
+// a run of consecutive triangles of one mesh, everything in the mesh's local space. The cluster is backfacing for a camera at P when
+// dot(normalize(ConeApex - P), ConeAxis) >= ConeCutoff
+struct Meshlet
+{
+	DirectX::XMFLOAT3 Center;
+	float Radius;
+	DirectX::XMFLOAT3 ConeApex;
+	float ConeCutoff;
+	DirectX::XMFLOAT3 ConeAxis;
+	UINT IndexOffset;		// relative to the start of the mesh's indices
+	UINT TriangleCount;
+	UINT VertexCount;		// unique vertices the triangles use
+};
+
+/*
+*	Splits a mesh into clusters of at most MESHLET_MAX_VERTICES vertices and MESHLET_MAX_TRIANGLES triangles for ClusterCuller. The
+*	triangles are taken in index order, so the clusters are contiguous index ranges and the vertex cache order MeshOptimizer produced
+*	is kept, its Tipsify clusters are already spatially compact. Every cluster gets a bounding sphere and a normal cone built from the
+*	triangles' face normals, with the apex placed behind every triangle's plane so the cone test never rejects a triangle the
+*	rasterizer would draw. Front faces are clockwise in a left handed space, as the renderer draws them. Pure CPU, no device needed.
+*/
+
+class MeshletBuilder
+{
+public:
+	// Indices index into Vertices and are a triangle list
+	static void Build(const Vertex* Vertices, UINT VertexCount, const UINT* Indices, UINT IndexCount, std::vector<Meshlet>& OutMeshlets);
+
+	// bounds and cone of the triangles Meshlet.IndexOffset and Meshlet.TriangleCount point at, also used by Build
+	static void ComputeBounds(const Vertex* Vertices, const UINT* Indices, Meshlet& InOutMeshlet);
+
+};
+
+#endif
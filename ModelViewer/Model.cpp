@@ -2,6 +2,8 @@
 
 #include "ResourceManager.h"
 #include "ModelData.h"
+#include "Mesh.h"
+#include "ComponentRegistry.h"
 #include "ImGui/imgui.h"
 
 Model::Model(const std::string& ModelPath, const std::string& TexturesPath)
@@ -11,10 +13,12 @@ Model::Model(const std::string& ModelPath, const std::string& TexturesPath)
 
 	m_bShouldRender = true;
 	m_ComponentName = "Model";
+	m_Type = ComponentType::Model;
 }
 
 Model::~Model()
 {
+	UnregisterType();
 	Shutdown();
 }
 
@@ -33,10 +37,76 @@ void Model::RenderControls()
 {
 	ImGui::Text(m_ComponentName.c_str());
 	ImGui::Checkbox("Should Render", &m_bShouldRender);
+
+	// backend is stored on the shared ModelData, so this changes it for every instance of this model type
+	const char* Backends[] = { "GPU", "CPU" };
+	int Backend = (int)m_pModelData->GetCullingBackend();
+	if (ImGui::Combo("Culling Backend", &Backend, Backends, IM_ARRAYSIZE(Backends)))
+	{
+		m_pModelData->SetCullingBackend((CullingBackend)Backend);
+	}
+	ImGui::Checkbox("Use As Occluder", &m_pModelData->GetIsOccluderRef());
+
+	const char* Formats[] = { "Full", "Packed" };
+	int Format = (int)m_pModelData->GetVertexFormat();
+	if (ImGui::Combo("Vertex Format", &Format, Formats, IM_ARRAYSIZE(Formats)))
+	{
+		m_pModelData->SetVertexFormat((VertexFormat)Format);
+	}
+	ImGui::Text("Geometry: %.1f KB, %s indices", (float)m_pModelData->GetGeometryBytes() / 1024.f,
+		m_pModelData->GetIndexFormat() == DXGI_FORMAT_R16_UINT ? "16 bit" : "32 bit");
+
+	// ACMR and ATVR for a 16 entry FIFO cache, as imported and after the import time reordering
+	if (ImGui::TreeNode("Mesh Optimisation"))
+	{
+		auto MeshRow = [](const std::unique_ptr<Mesh>& m)
+			{
+				const MeshOptimizeStats& Stats = m->GetOptimizeStats();
+				ImGui::Text("%s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, Vertices %u -> %u, Clusters %u", m->GetName().c_str(), Stats.Before.ACMR, Stats.After.ACMR,
+					Stats.Before.ATVR, Stats.After.ATVR, Stats.VerticesBefore, Stats.VerticesAfter, m->GetMeshletCount());
+
+				// triangles of every level, full detail first
+				std::string Levels;
+				for (UINT l = 0u; l < m->GetLODCount(); l++)
+				{
+					Levels += (l > 0u ? " / " : "") + std::to_string(m->GetLOD(l).IndexCount / 3u);
+				}
+				ImGui::Text("    LOD Triangles: %s", Levels.c_str());
+			};
+		for (const std::unique_ptr<Mesh>& m : m_pModelData->GetOpaqueMeshes())
+		{
+			MeshRow(m);
+		}
+		for (const std::unique_ptr<Mesh>& m : m_pModelData->GetTransparentMeshes())
+		{
+			MeshRow(m);
+		}
+		ImGui::TreePop();
+	}
+}
+
+std::string Model::GetModelPath() const
+{
+	return m_pModelData->GetModelPath();
+}
+
+std::string Model::GetTexturesPath() const
+{
+	return m_pModelData->GetTexturesPath();
+}
+
+void Model::RegisterType()
+{
+	ComponentRegistry<Model>::Register(this);
+}
+
+void Model::UnregisterType()
+{
+	ComponentRegistry<Model>::Unregister(this);
 }
 
 void Model::SendTransformToModel()
 {
-	DirectX::XMMATRIX Transform = DirectX::XMMatrixTranspose(GetAccumulatedWorldMatrix());
-	m_pModelData->GetTransforms().push_back(Transform);
+	// cached by the TransformStore, only recomputed when this model or one of its owners moved
+	m_pModelData->GetTransforms().push_back(TransformStore::GetSingletonPtr()->GetTransposedWorldMatrix(m_TransformID));
 }
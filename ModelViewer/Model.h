@@ -29,8 +29,14 @@ public:
 	void SetShouldRender(bool bNewShouldRender) { m_bShouldRender = bNewShouldRender; }
 
 	ModelData* GetModelData() const { return m_pModelData; }
+	std::string GetModelPath() const;
+	std::string GetTexturesPath() const;
 	bool GetShouldRender() const { return m_bShouldRender; }
 
+protected:
+	virtual void RegisterType() override;
+	virtual void UnregisterType() override;
+
 private:
 	ModelData* m_pModelData = nullptr;
 
@@ -1,6 +1,8 @@
 #include "ModelData.h"
 
 #include <fstream>
+#include <algorithm>
+#include <cmath>
 
 #include "assimp/Importer.hpp"
 #include "assimp/scene.h"
@@ -15,6 +17,141 @@
 #include "Material.h"
 #include "Common.h"
 #include "FrustumCuller.h"
+#include "OcclusionCuller.h"
+#include "CullingBatch.h"
+#include "TemporalFrustumCuller.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "MeshletBuilder.h"
+#include "MeshSimplifier.h"
+#include "LODSelector.h"
+#include "ClusterCuller.h"
+#include "ThreadPool.h"
+#include "VertexCompression.h"
+
+static const UINT IMPORT_FLAGS =
+	aiProcess_Triangulate |
+	aiProcess_JoinIdenticalVertices |
+	aiProcess_GenSmoothNormals |
+	aiProcess_ConvertToLeftHanded;
+
+static const UINT MESH_NOT_CACHED = 0xFFFFFFFF;
+
+static DirectX::XMMATRIX ConvertToXMMATRIX(const aiMatrix4x4& aiMatrix)
+{
+	return DirectX::XMMATRIX(
+		aiMatrix.a1, aiMatrix.a2, aiMatrix.a3, aiMatrix.a4,
+		aiMatrix.b1, aiMatrix.b2, aiMatrix.b3, aiMatrix.b4,
+		aiMatrix.c1, aiMatrix.c2, aiMatrix.c3, aiMatrix.c4,
+		aiMatrix.d1, aiMatrix.d2, aiMatrix.d3, aiMatrix.d4
+	);
+}
+
+// one source mesh, the first node that uses it owns it. Converted and optimised on whichever thread picks it up
+struct ImportedMesh
+{
+	const aiMesh* SceneMesh = nullptr;
+	UINT CacheMesh = 0u;
+	std::vector<Vertex> Vertices;
+	std::vector<UINT> Indices;
+	MeshOptimizeStats Stats;
+	std::vector<Meshlet> Meshlets;
+	std::vector<MeshLOD> LODs;
+	std::vector<UINT> LODIndices;
+};
+
+// a mesh record in the order the node walk meets them, the first use of an imported mesh or another node sharing its ranges
+struct ImportedMeshUse
+{
+	UINT Mesh;
+	UINT Node;
+	bool bFirstUse;
+};
+
+// depth first with a node's meshes before its children, the same order the meshes were always built in. Only walks the hierarchy,
+// the meshes are converted afterwards
+static void ImportNode(const aiNode* SceneNode, const aiScene* Scene, UINT Parent, const DirectX::XMMATRIX& ParentTransform, MeshCache& Out,
+	std::vector<UINT>& SceneMeshes, std::vector<ImportedMesh>& Meshes, std::vector<ImportedMeshUse>& Uses, AABB& Bounds)
+{
+	const DirectX::XMMATRIX LocalTransform = ConvertToXMMATRIX(SceneNode->mTransformation);
+	const DirectX::XMMATRIX AccumulatedTransform = ParentTransform * LocalTransform;
+	const UINT NodeIndex = Out.AddNode(Parent, SceneNode->mName.C_Str(), LocalTransform, AccumulatedTransform);
+
+	for (UINT i = 0; i < SceneNode->mNumMeshes; i++)
+	{
+		const UINT SceneMeshIndex = SceneNode->mMeshes[i];
+		const aiMesh* SceneMesh = Scene->mMeshes[SceneMeshIndex];
+
+		for (UINT v = 0; v < SceneMesh->mNumVertices; v++)
+		{
+			const DirectX::XMFLOAT3 Pos(SceneMesh->mVertices[v].x, SceneMesh->mVertices[v].y, SceneMesh->mVertices[v].z);
+			DirectX::XMFLOAT3 TransformedPos;
+			DirectX::XMStoreFloat3(&TransformedPos, DirectX::XMVector3Transform(DirectX::XMLoadFloat3(&Pos), AccumulatedTransform));
+			Bounds.Expand(TransformedPos);
+		}
+
+		const bool bFirstUse = SceneMeshes[SceneMeshIndex] == MESH_NOT_CACHED;
+		if (bFirstUse)
+		{
+			SceneMeshes[SceneMeshIndex] = (UINT)Meshes.size();
+			Meshes.emplace_back();
+			Meshes.back().SceneMesh = SceneMesh;
+		}
+		Uses.push_back({ SceneMeshes[SceneMeshIndex], NodeIndex, bFirstUse });
+	}
+
+	for (UINT i = 0; i < SceneNode->mNumChildren; i++)
+	{
+		ImportNode(SceneNode->mChildren[i], Scene, NodeIndex, AccumulatedTransform, Out, SceneMeshes, Meshes, Uses, Bounds);
+	}
+}
+
+// touches nothing but Mesh, so any number of meshes can be converted at once
+static void ConvertMesh(ImportedMesh& Mesh)
+{
+	const aiMesh* SceneMesh = Mesh.SceneMesh;
+
+	// sized from the source counts and written in place
+	Mesh.Vertices.resize(SceneMesh->mNumVertices);
+	for (UINT v = 0; v < SceneMesh->mNumVertices; v++)
+	{
+		Vertex& Vert = Mesh.Vertices[v];
+		Vert.Pos = DirectX::XMFLOAT3(SceneMesh->mVertices[v].x, SceneMesh->mVertices[v].y, SceneMesh->mVertices[v].z);
+		Vert.Normal = DirectX::XMFLOAT3(SceneMesh->mNormals[v].x, SceneMesh->mNormals[v].y, SceneMesh->mNormals[v].z);
+
+		if (SceneMesh->mTextureCoords[0])
+		{
+			Vert.TexCoord = DirectX::XMFLOAT2(SceneMesh->mTextureCoords[0][v].x, SceneMesh->mTextureCoords[0][v].y);
+		}
+		else
+		{
+			Vert.TexCoord = DirectX::XMFLOAT2(0.f, 0.f);
+		}
+	}
+
+	UINT IndexCount = 0u;
+	for (UINT f = 0; f < SceneMesh->mNumFaces; f++)
+	{
+		IndexCount += SceneMesh->mFaces[f].mNumIndices;
+	}
+
+	Mesh.Indices.resize(IndexCount);
+	UINT* Out = Mesh.Indices.data();
+	for (UINT f = 0; f < SceneMesh->mNumFaces; f++)
+	{
+		const aiFace& Face = SceneMesh->mFaces[f];
+		for (UINT j = 0; j < Face.mNumIndices; j++)
+		{
+			*Out++ = Face.mIndices[j];
+		}
+	}
+
+	// clusters are built on the final triangle order, so they follow the vertex cache order. The simplified levels reuse the
+	// optimised vertices and only add indices
+	Mesh.Stats = MeshOptimizer::Optimize(Mesh.Vertices, Mesh.Indices);
+	MeshletBuilder::Build(Mesh.Vertices.data(), (UINT)Mesh.Vertices.size(), Mesh.Indices.data(), (UINT)Mesh.Indices.size(), Mesh.Meshlets);
+	MeshSimplifier::GenerateLODs(Mesh.Vertices, Mesh.Indices, Mesh.LODs, Mesh.LODIndices);
+}
 
 ModelData::ModelData(const std::string& ModelPath, const std::string& TexturesPath)
 {
@@ -45,26 +182,95 @@ void ModelData::Shutdown()
 void ModelData::Render()
 {
 	ID3D11DeviceContext* DeviceContext = Graphics::GetSingletonPtr()->GetDeviceContext();
-	UINT Strides[] = { sizeof(Vertex) };
+	UINT Strides[] = { m_VertexFormat == VertexFormat::Packed ? (UINT)sizeof(PackedVertex) : (UINT)sizeof(Vertex) };
 	UINT Offsets[] = { 0u, };
 
+	Application::GetSingletonPtr()->GetInstancedShader()->SetVertexFormat(DeviceContext, m_VertexFormat);
 	DeviceContext->IASetVertexBuffers(0u, 1u, m_VertexBuffer.GetAddressOf(), Strides, Offsets);
-	DeviceContext->IASetIndexBuffer(m_IndexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0u);
+	DeviceContext->IASetIndexBuffer(m_IndexBuffer.Get(), m_IndexFormat, 0u);
 	DeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-	DeviceContext->VSSetShaderResources(0u, 1u, Application::GetSingletonPtr()->GetFrustumCuller()->GetCulledTransformsSRV().GetAddressOf());
+	std::shared_ptr<FrustumCuller> Culler = Application::GetSingletonPtr()->GetFrustumCuller();
+	if (IsInCullingBatch())
+	{
+		DeviceContext->VSSetShaderResources(0u, 1u, Culler->GetBatchCulledTransformsSRV().GetAddressOf());
+		Culler->SetInstanceOffset(m_BatchInstanceOffset);
+	}
+	else if (m_CullingBackend == CullingBackend::CPU)
+	{
+		DeviceContext->VSSetShaderResources(0u, 1u, Culler->GetCPUCulledTransformsSRV().GetAddressOf());
+		Culler->SetInstanceOffset(0u);
+	}
+	else
+	{
+		DeviceContext->VSSetShaderResources(0u, 1u, Culler->GetCulledTransformsSRV().GetAddressOf());
+		Culler->SetInstanceOffset(0u);
+	}
 
 	Graphics::GetSingletonPtr()->EnableDepthWrite();
 	Graphics::GetSingletonPtr()->DisableBlending();
-	RenderMeshes(m_OpaqueMeshes);
+	RenderMeshes(m_OpaqueMeshes, m_BatchFirstDraw);
 	Graphics::GetSingletonPtr()->DisableDepthWrite();
 	Graphics::GetSingletonPtr()->EnableBlending();
-	RenderMeshes(m_TransparentMeshes);
+	RenderMeshes(m_TransparentMeshes, m_BatchFirstDraw + (UINT)m_OpaqueMeshes.size());
 
 	ID3D11ShaderResourceView* NullSRVs[] = { nullptr };
 	DeviceContext->VSSetShaderResources(0u, 1u, NullSRVs);
 }
 
+void ModelData::AddToCullingBatch(CullingBatch& Batch)
+{
+	m_BatchModelIndex = Batch.AddModel(m_ModelPath, m_Transforms, m_BoundingBox);
+	m_BatchInstanceOffset = Batch.GetModels()[m_BatchModelIndex].InstanceOffset;
+	m_BatchFirstDraw = Batch.GetDrawCount();
+
+	for (const std::unique_ptr<Mesh>& m : m_OpaqueMeshes)
+	{
+		Batch.AddDraw(m_BatchModelIndex, m->m_IndexCount, m->m_IndicesOffset, m->m_VerticesOffset);
+	}
+
+	for (const std::unique_ptr<Mesh>& m : m_TransparentMeshes)
+	{
+		Batch.AddDraw(m_BatchModelIndex, m->m_IndexCount, m->m_IndicesOffset, m->m_VerticesOffset);
+	}
+}
+
+LODSelector& ModelData::GetLODSelector()
+{
+	if (!m_LODSelector)
+	{
+		m_LODSelector = std::make_unique<LODSelector>();
+		m_LODSelector->SetLevels(m_LODErrors, m_LODCount);
+	}
+	return *m_LODSelector;
+}
+
+TemporalFrustumCuller& ModelData::GetTemporalCuller()
+{
+	if (!m_TemporalCuller)
+	{
+		m_TemporalCuller = std::make_unique<TemporalFrustumCuller>();
+	}
+	return *m_TemporalCuller;
+}
+
+void ModelData::SubmitOccluders(OcclusionCuller& Culler)
+{
+	if (!m_bOccluderMeshesSelected)
+	{
+		SelectOccluderMeshes();
+	}
+
+	for (const DirectX::XMMATRIX& Transform : m_Transforms)
+	{
+		DirectX::XMMATRIX World = DirectX::XMMatrixTranspose(Transform);
+		for (Mesh* m : m_OccluderMeshes)
+		{
+			Culler.AddOccluder(&m_Vertices[0].Pos, sizeof(Vertex), &m_Indices[m->m_IndicesOffset], m->m_IndexCount, m->m_pNode->GetAccumulatedTransform() * World);
+		}
+	}
+}
+
 void ModelData::ShutdownBuffers()
 {
 	m_VertexBuffer.Reset();
@@ -75,25 +281,228 @@ bool ModelData::LoadModel()
 {
 	Reset();
 
-	Assimp::Importer Importer;
-	const aiScene* Scene = Importer.ReadFile(m_ModelPath,
-		aiProcess_Triangulate |
-		aiProcess_JoinIdenticalVertices |
-		aiProcess_GenSmoothNormals |
-		aiProcess_ConvertToLeftHanded
-	);
+	// a missing or stale cache is rebuilt from the source, failing to write it only costs the import again next time
+	MeshCache Cache;
+	unsigned long long SourceHash = 0ull;
+	const bool bHashed = MeshCache::HashFile(m_ModelPath, SourceHash);
+	const std::string CachePath = MeshCache::GetCachePath(m_ModelPath);
 
-	assert(Scene);
+	if (!bHashed || !Cache.Open(CachePath, SourceHash, IMPORT_FLAGS))
+	{
+		if (!ImportToCache(m_ModelPath, Cache))
+			return false;
 
-	LoadMaterials(Scene);
-	m_RootNode = std::make_unique<Node>(this, nullptr);
-	m_RootNode->ProcessNode(Scene->mRootNode, Scene, DirectX::XMMatrixIdentity());
+		if (bHashed)
+		{
+			Cache.SetSource(SourceHash, IMPORT_FLAGS);
+			Cache.Save(CachePath);
+		}
+	}
+
+	LoadFromCache(Cache);
 	CreateBuffers();
 	m_BoundingBox.CalcCorners();
 
 	return true;
 }
 
+bool ModelData::ImportToCache(const std::string& ModelPath, MeshCache& Out, UINT ThreadCount)
+{
+	Assimp::Importer Importer;
+	const aiScene* Scene = Importer.ReadFile(ModelPath, IMPORT_FLAGS);
+	if (!Scene || !Scene->mRootNode)
+		return false;
+
+	for (UINT i = 0; i < Scene->mNumMaterials; i++)
+	{
+		const aiMaterial* SceneMat = Scene->mMaterials[i];
+		MeshCacheMaterialDesc Desc;
+		Desc.Name = SceneMat->GetName().C_Str();
+
+		SceneMat->Get(AI_MATKEY_TWOSIDED, Desc.bTwoSided);
+		float Opacity = 0.f;
+		SceneMat->Get(AI_MATKEY_OPACITY, Opacity);
+		Desc.bOpaque = Opacity >= 1.f;
+
+		aiString Path;
+		aiColor3D Color;
+		if (SceneMat->GetTexture(aiTextureType_DIFFUSE, 0, &Path) == AI_SUCCESS)
+		{
+			Desc.DiffuseTexture = Path.C_Str();
+		}
+		else if (SceneMat->Get(AI_MATKEY_COLOR_DIFFUSE, Color) == AI_SUCCESS)
+		{
+			Desc.DiffuseColor = DirectX::XMFLOAT3(Color.r, Color.g, Color.b);
+		}
+
+		if (SceneMat->GetTexture(aiTextureType_SPECULAR, 0, &Path) == AI_SUCCESS)
+		{
+			Desc.SpecularTexture = Path.C_Str();
+		}
+		else if (SceneMat->Get(AI_MATKEY_COLOR_SPECULAR, Color) == AI_SUCCESS)
+		{
+			Desc.Specular = DirectX::XMFLOAT3(Color.r, Color.g, Color.b);
+		}
+
+		Out.AddMaterial(Desc);
+	}
+
+	AABB Bounds;
+	std::vector<UINT> SceneMeshes(Scene->mNumMeshes, MESH_NOT_CACHED);
+	std::vector<ImportedMesh> Meshes;
+	std::vector<ImportedMeshUse> Uses;
+	ImportNode(Scene->mRootNode, Scene, INVALID_MESH_CACHE_NODE, DirectX::XMMatrixIdentity(), Out, SceneMeshes, Meshes, Uses, Bounds);
+	Out.SetBounds(Bounds.Min, Bounds.Max);
+
+	// one mesh per batch, their costs are too uneven to hand out in runs
+	ThreadPool* Pool = ThreadPool::GetSingletonPtr();
+	Pool->ParallelFor((UINT)Meshes.size(), 1u, [&](UINT Begin, UINT End)
+		{
+			for (UINT i = Begin; i < End; i++)
+			{
+				ConvertMesh(Meshes[i]);
+			}
+		}, ThreadCount);
+
+	// welding and the simplified levels decide the final sizes, so the shared arrays are laid out once every mesh is converted. The
+	// records keep the walk's order and every range starts where the one before it ends, the same cache a serial import writes
+	UINT VertexCount = 0u;
+	UINT IndexCount = 0u;
+	UINT MeshletCount = 0u;
+	for (const ImportedMesh& Mesh : Meshes)
+	{
+		VertexCount += (UINT)Mesh.Vertices.size();
+		IndexCount += (UINT)(Mesh.Indices.size() + Mesh.LODIndices.size());
+		MeshletCount += (UINT)Mesh.Meshlets.size();
+	}
+	Out.Reserve(VertexCount, IndexCount, MeshletCount, (UINT)Uses.size());
+
+	for (const ImportedMeshUse& Use : Uses)
+	{
+		ImportedMesh& Mesh = Meshes[Use.Mesh];
+		if (!Use.bFirstUse)
+		{
+			Out.AddMeshInstance(Mesh.CacheMesh, Use.Node);
+			continue;
+		}
+
+		Mesh.CacheMesh = Out.ReserveMesh(Mesh.SceneMesh->mName.C_Str(), Use.Node, Mesh.SceneMesh->mMaterialIndex, (UINT)Mesh.Vertices.size(),
+			(UINT)Mesh.Indices.size(), Mesh.Stats, (UINT)Mesh.Meshlets.size(), Mesh.LODs, (UINT)Mesh.LODIndices.size());
+	}
+
+	Pool->ParallelFor((UINT)Meshes.size(), 1u, [&](UINT Begin, UINT End)
+		{
+			for (UINT i = Begin; i < End; i++)
+			{
+				const ImportedMesh& Mesh = Meshes[i];
+				Out.FillMesh(Mesh.CacheMesh, Mesh.Vertices.data(), Mesh.Indices.data(), Mesh.Meshlets.data(), Mesh.LODIndices.data(),
+					(UINT)Mesh.LODIndices.size());
+			}
+		}, ThreadCount);
+
+	return true;
+}
+
+UINT ModelData::GetImportFlags()
+{
+	return IMPORT_FLAGS;
+}
+
+void ModelData::LoadFromCache(const MeshCache& Cache)
+{
+	// every texture the materials use is loaded up front across the thread pool, in the order the materials would have loaded them
+	// one by one, so they only look their indices up
+	if (!m_TexturesPath.empty())
+	{
+		std::vector<std::string> TexturePaths;
+		for (UINT i = 0; i < Cache.GetMaterialCount(); i++)
+		{
+			const MeshCacheMaterial& Record = Cache.GetMaterial(i);
+			for (UINT Texture : { Record.DiffuseTexture, Record.SpecularTexture })
+			{
+				const std::string Path = m_TexturesPath + Cache.GetString(Texture);
+				if (Texture != 0u && m_TexturePathsSet.insert(Path).second)
+				{
+					TexturePaths.push_back(Path);
+				}
+			}
+		}
+
+		std::vector<ID3D11ShaderResourceView*> Textures;
+		ResourceManager::GetSingletonPtr()->LoadTextures(TexturePaths, Textures);
+		for (UINT i = 0u; i < (UINT)TexturePaths.size(); i++)
+		{
+			m_TextureIndexMap.insert({ TexturePaths[i], (UINT)m_Textures.size() });
+			m_Textures.push_back(Textures[i]);
+		}
+	}
+
+	for (UINT i = 0; i < Cache.GetMaterialCount(); i++)
+	{
+		m_Materials.emplace_back(std::make_shared<Material>(i, this));
+		m_Materials.back()->LoadFromCache(Cache, Cache.GetMaterial(i));
+		m_Materials.back()->CreateConstantBuffer();
+	}
+
+	// parents always come first, so every node's owner already exists when it is created
+	std::vector<Node*> Nodes(Cache.GetNodeCount(), nullptr);
+	for (UINT i = 0; i < Cache.GetNodeCount(); i++)
+	{
+		const MeshCacheNode& Record = Cache.GetNode(i);
+		Node* pNode;
+		if (Record.Parent == INVALID_MESH_CACHE_NODE)
+		{
+			m_RootNode = std::make_unique<Node>(this, nullptr);
+			pNode = m_RootNode.get();
+		}
+		else
+		{
+			Node* pParent = Nodes[Record.Parent];
+			pParent->m_Children.emplace_back(std::make_unique<Node>(this, pParent));
+			pNode = pParent->m_Children.back().get();
+		}
+
+		pNode->Initialise(Cache.GetString(Record.Name), DirectX::XMLoadFloat4x4(&Record.LocalTransform), DirectX::XMLoadFloat4x4(&Record.AccumulatedTransform));
+		Nodes[i] = pNode;
+	}
+
+	m_Vertices.assign(Cache.GetVertices(), Cache.GetVertices() + Cache.GetVertexCount());
+	m_Indices.assign(Cache.GetIndices(), Cache.GetIndices() + Cache.GetIndexCount());
+	m_Meshlets.assign(Cache.GetMeshlets(), Cache.GetMeshlets() + Cache.GetMeshletCount());
+
+	for (UINT i = 0; i < Cache.GetMeshCount(); i++)
+	{
+		const MeshCacheMesh& Record = Cache.GetMesh(i);
+		std::shared_ptr<Material> pMaterial = m_Materials[Record.Material];
+		std::vector<std::unique_ptr<Mesh>>& Meshes = pMaterial->m_bOpaque ? m_OpaqueMeshes : m_TransparentMeshes;
+
+		Meshes.emplace_back(std::make_unique<Mesh>(this, Nodes[Record.Node]));
+		Meshes.back()->Initialise(Cache.GetString(Record.Name), pMaterial, Record.VerticesOffset, Record.IndicesOffset, Record.VertexCount, Record.IndexCount);
+		Meshes.back()->m_OptimizeStats = Record.OptimizeStats;
+		Meshes.back()->m_MeshletOffset = Record.MeshletOffset;
+		Meshes.back()->m_MeshletCount = Record.MeshletCount;
+		Meshes.back()->m_LODCount = Record.LODCount;
+		for (UINT l = 0u; l < Record.LODCount; l++)
+		{
+			Meshes.back()->m_LODs[l] = Record.LODs[l];
+		}
+
+		// the model's error at a level is its worst mesh's in model space, meshes with fewer levels draw their coarsest one
+		const DirectX::XMMATRIX& NodeTransform = Nodes[Record.Node]->GetAccumulatedTransform();
+		const float NodeScale = sqrtf(fmaxf(DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(NodeTransform.r[0])),
+			fmaxf(DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(NodeTransform.r[1])), DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(NodeTransform.r[2])))));
+		m_LODCount = m_LODCount > Record.LODCount ? m_LODCount : Record.LODCount;
+		for (UINT l = 1u; l < MAX_MESH_LODS; l++)
+		{
+			const float Error = Record.LODs[l < Record.LODCount ? l : Record.LODCount - 1u].Error * NodeScale;
+			m_LODErrors[l] = fmaxf(m_LODErrors[l], Error);
+		}
+	}
+
+	m_BoundingBox.Min = Cache.GetBoundsMin();
+	m_BoundingBox.Max = Cache.GetBoundsMax();
+}
+
 void ModelData::ReleaseModel()
 {
 	m_RootNode.reset();
@@ -105,7 +514,14 @@ void ModelData::ReleaseModel()
 	m_TransparentMeshes.clear();
 	m_Vertices.clear();
 	m_Indices.clear();
+	m_Meshlets.clear();
 	m_BoundingBox = {};
+	m_LODCount = 1u;
+	for (float& Error : m_LODErrors)
+	{
+		Error = 0.f;
+	}
+	m_LODSelector.reset();
 
 	for (const std::string& Path : m_TexturePathsSet)
 	{
@@ -119,6 +535,7 @@ void ModelData::ReleaseModel()
 	m_TransparentMeshes.shrink_to_fit();
 	m_Vertices.shrink_to_fit();
 	m_Indices.shrink_to_fit();
+	m_Meshlets.shrink_to_fit();
 }
 
 void ModelData::Reset()
@@ -135,52 +552,175 @@ bool ModelData::CreateBuffers()
 	D3D11_SUBRESOURCE_DATA VertexData = {};
 	ID3D11Device* Device = Graphics::GetSingletonPtr()->GetDevice();
 
+	// every mesh is its own range of both buffers, drawn with its vertices offset as the base vertex. Meshes sharing a range write
+	// the same values into it twice
+	std::vector<const Mesh*> Meshes;
+	UINT LargestMesh = 0u;
+	for (const std::vector<std::unique_ptr<Mesh>>* List : { &m_OpaqueMeshes, &m_TransparentMeshes })
+	{
+		for (const std::unique_ptr<Mesh>& m : *List)
+		{
+			Meshes.push_back(m.get());
+			LargestMesh = LargestMesh > m->m_VertexCount ? LargestMesh : m->m_VertexCount;
+		}
+	}
+
+	std::vector<PackedVertex> PackedVertices;
+	if (m_VertexFormat == VertexFormat::Packed)
+	{
+		PackedVertices.resize(m_Vertices.size());
+		for (const Mesh* m : Meshes)
+		{
+			for (UINT i = m->m_VerticesOffset; i < m->m_VerticesOffset + m->m_VertexCount; i++)
+			{
+				PackedVertices[i] = VertexCompression::Encode(m_Vertices[i], m->m_Quantization);
+			}
+		}
+	}
+
+	const UINT VertexStride = m_VertexFormat == VertexFormat::Packed ? (UINT)sizeof(PackedVertex) : (UINT)sizeof(Vertex);
 	vbDesc.Usage = D3D11_USAGE_IMMUTABLE;
-	vbDesc.ByteWidth = (UINT)(sizeof(Vertex) * m_Vertices.size());
+	vbDesc.ByteWidth = (UINT)(VertexStride * m_Vertices.size());
 	vbDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
 
-	VertexData.pSysMem = m_Vertices.data();
+	VertexData.pSysMem = m_VertexFormat == VertexFormat::Packed ? (const void*)PackedVertices.data() : (const void*)m_Vertices.data();
 
 	HFALSE_IF_FAILED(Device->CreateBuffer(&vbDesc, &VertexData, &m_VertexBuffer));
 	NAME_D3D_RESOURCE(m_VertexBuffer, (m_ModelPath + " vertex buffer").c_str());
 
+	// the CPU indices index the whole vertex array for the occluders, the GPU ones are local to their mesh
+	std::vector<unsigned short> Indices16;
+	std::vector<UINT> Indices32;
+	m_IndexFormat = LargestMesh <= 65536u ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+	if (m_IndexFormat == DXGI_FORMAT_R16_UINT)
+	{
+		Indices16.resize(m_Indices.size());
+	}
+	else
+	{
+		Indices32.resize(m_Indices.size());
+	}
+	for (const Mesh* m : Meshes)
+	{
+		for (UINT l = 0u; l < m->m_LODCount; l++)
+		{
+			const UINT First = m->m_IndicesOffset + m->m_LODs[l].IndexOffset;
+			for (UINT i = First; i < First + m->m_LODs[l].IndexCount; i++)
+			{
+				const UINT Local = m_Indices[i] - m->m_VerticesOffset;
+				if (m_IndexFormat == DXGI_FORMAT_R16_UINT)
+				{
+					Indices16[i] = (unsigned short)Local;
+				}
+				else
+				{
+					Indices32[i] = Local;
+				}
+			}
+		}
+	}
+
 	D3D11_BUFFER_DESC ibDesc = {};
 	D3D11_SUBRESOURCE_DATA IndexData = {};
 
+	const UINT IndexStride = m_IndexFormat == DXGI_FORMAT_R16_UINT ? (UINT)sizeof(unsigned short) : (UINT)sizeof(unsigned int);
 	ibDesc.Usage = D3D11_USAGE_IMMUTABLE;
-	ibDesc.ByteWidth = (UINT)(sizeof(unsigned int) * m_Indices.size());
+	ibDesc.ByteWidth = (UINT)(IndexStride * m_Indices.size());
 	ibDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
 
-	IndexData.pSysMem = m_Indices.data();
+	IndexData.pSysMem = m_IndexFormat == DXGI_FORMAT_R16_UINT ? (const void*)Indices16.data() : (const void*)Indices32.data();
 
 	HFALSE_IF_FAILED(Device->CreateBuffer(&ibDesc, &IndexData, &m_IndexBuffer));
 	NAME_D3D_RESOURCE(m_IndexBuffer, (m_ModelPath + " index buffer").c_str());
 
+	m_GeometryBytes = vbDesc.ByteWidth + ibDesc.ByteWidth;
+
 	return true;
 }
 
-void ModelData::LoadMaterials(const aiScene* Scene)
+void ModelData::SetVertexFormat(VertexFormat Format)
+{
+	if (Format == m_VertexFormat)
+		return;
+
+	m_VertexFormat = Format;
+	ShutdownBuffers();
+	bool bResult = CreateBuffers();
+	assert(bResult);
+}
+
+void ModelData::SelectOccluderMeshes()
 {
-	for (size_t i = 0; i < Scene->mNumMaterials; i++)
+	m_OccluderMeshes.clear();
+	m_bOccluderMeshesSelected = true;
+
+	// meshes are scored by the largest face of their bounds, anything much smaller than the model is unlikely to hide much
+	auto LargestFaceArea = [](const AABB& BBox)
+		{
+			float Extents[3] = { BBox.Max.x - BBox.Min.x, BBox.Max.y - BBox.Min.y, BBox.Max.z - BBox.Min.z };
+			std::sort(Extents, Extents + 3);
+			return Extents[1] * Extents[2];
+		};
+
+	const float MinArea = LargestFaceArea(m_BoundingBox) * OCCLUDER_MIN_AREA_FRACTION;
+
+	std::vector<std::pair<float, Mesh*>> Candidates;
+	for (const std::unique_ptr<Mesh>& m : m_OpaqueMeshes)
 	{
-		m_Materials.emplace_back(std::make_shared<Material>((UINT)i, this));
-		m_Materials.back()->LoadTextures(Scene->mMaterials[i]);
-		m_Materials.back()->CreateConstantBuffer();
+		AABB MeshBounds;
+		for (UINT i = m->m_VerticesOffset; i < m->m_VerticesOffset + m->m_VertexCount; i++)
+		{
+			DirectX::XMVECTOR Pos = DirectX::XMVector3Transform(DirectX::XMLoadFloat3(&m_Vertices[i].Pos), m->m_pNode->GetAccumulatedTransform());
+			DirectX::XMFLOAT3 TransformedPos;
+			DirectX::XMStoreFloat3(&TransformedPos, Pos);
+			MeshBounds.Expand(TransformedPos);
+		}
+
+		float Area = LargestFaceArea(MeshBounds);
+		if (Area >= MinArea)
+		{
+			Candidates.emplace_back(Area, m.get());
+		}
+	}
+
+	std::sort(Candidates.begin(), Candidates.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+	UINT Triangles = 0u;
+	for (const auto& Candidate : Candidates)
+	{
+		UINT MeshTriangles = Candidate.second->m_IndexCount / 3u;
+		if (Triangles + MeshTriangles > OCCLUDER_TRIANGLE_BUDGET)
+			continue;
+
+		Triangles += MeshTriangles;
+		m_OccluderMeshes.push_back(Candidate.second);
 	}
 }
 
-void ModelData::RenderMeshes(const std::vector<std::unique_ptr<Mesh>>& Meshes)
+void ModelData::RenderMeshes(const std::vector<std::unique_ptr<Mesh>>& Meshes, UINT FirstBatchDraw)
 {
 	ID3D11DeviceContext* DeviceContext = Graphics::GetSingletonPtr()->GetDeviceContext();
+	const bool bBatched = IsInCullingBatch();
+	const bool bClusters = m_CullingBackend == CullingBackend::CPU && Application::GetSingletonPtr()->GetUseClusterCullingRef();
+	// the same condition Application hands CullOnCPU the selector on, so the instances are grouped by level
+	const bool bLODs = m_CullingBackend == CullingBackend::CPU && Application::GetSingletonPtr()->GetUseLODsRef() && m_LODCount > 1u;
+	UINT BatchDraw = FirstBatchDraw;
 
 	for (const std::unique_ptr<Mesh>& m : Meshes)
 	{
-		// dispatch to copy instance count into args buffer
-		Application::GetSingletonPtr()->GetFrustumCuller()->SendInstanceCount(m->GetArgsBufferUAV());
+		// dispatch to copy instance count into args buffer, the CPU backend already knows the count and the batch args are already filled
+		if (m_CullingBackend == CullingBackend::GPU && !bBatched)
+		{
+			Application::GetSingletonPtr()->GetFrustumCuller()->SendInstanceCount(m->GetArgsBufferUAV());
+		}
 
 		std::shared_ptr<Material> Mat = m.get()->m_Material;
 
 		DeviceContext->VSSetConstantBuffers(1u, 1u, m->m_pNode->m_ConstantBuffer.GetAddressOf());
+		if (m_VertexFormat == VertexFormat::Packed)
+		{
+			DeviceContext->VSSetConstantBuffers(3u, 1u, m->m_QuantizationBuffer.GetAddressOf());
+		}
 		DeviceContext->PSSetConstantBuffers(1u, 1u, Mat->m_ConstantBuffer.GetAddressOf());
 
 		if (Mat->m_DiffuseSRV >= 0)
@@ -199,7 +739,96 @@ void ModelData::RenderMeshes(const std::vector<std::unique_ptr<Mesh>>& Meshes)
 
 		// ensure the dispatch is finished before drawing
 
-		DeviceContext->DrawIndexedInstancedIndirect(m->GetArgsBuffer().Get(), 0u);
+		if (bBatched)
+		{
+			DeviceContext->DrawIndexedInstancedIndirect(Application::GetSingletonPtr()->GetFrustumCuller()->GetBatchArgsBuffer().Get(), BatchDraw * 5u * sizeof(UINT));
+			BatchDraw++;
+		}
+		else if (bLODs)
+		{
+			// counts its own draws, one per level and one per visible cluster range of the full detail instances with clusters
+			RenderLODs(*m, bClusters);
+			continue;
+		}
+		else if (bClusters)
+		{
+			// counts its own draws, one per visible cluster range
+			RenderClusters(*m, 0u, Application::GetSingletonPtr()->GetFrustumCuller()->GetCPUInstanceCount());
+			continue;
+		}
+		else if (m_CullingBackend == CullingBackend::CPU)
+		{
+			DeviceContext->DrawIndexedInstanced(m->m_IndexCount, Application::GetSingletonPtr()->GetFrustumCuller()->GetCPUInstanceCount(), m->m_IndicesOffset, (INT)m->m_VerticesOffset, 0u);
+		}
+		else
+		{
+			DeviceContext->DrawIndexedInstancedIndirect(m->GetArgsBuffer().Get(), 0u);
+		}
 		Application::GetSingletonPtr()->GetRenderStatsRef().DrawCalls++;
 	}
 }
+
+void ModelData::RenderLODs(const Mesh& m, bool bClusters)
+{
+	ID3D11DeviceContext* DeviceContext = Graphics::GetSingletonPtr()->GetDeviceContext();
+	std::shared_ptr<FrustumCuller> Culler = Application::GetSingletonPtr()->GetFrustumCuller();
+	RenderStats& Stats = Application::GetSingletonPtr()->GetRenderStatsRef();
+	const LODSelector& Selector = GetLODSelector();
+
+	for (UINT l = 0u; l < Selector.GetLevelCount(); l++)
+	{
+		const UINT InstanceCount = Selector.GetLevelInstanceCount(l);
+		if (InstanceCount == 0u)
+			continue;
+
+		if (l == 0u && bClusters)
+		{
+			RenderClusters(m, Selector.GetLevelFirstInstance(l), InstanceCount);
+			continue;
+		}
+
+		const MeshLOD& LOD = m.m_LODs[l < m.m_LODCount ? l : m.m_LODCount - 1u];
+		Culler->SetInstanceOffset(Selector.GetLevelFirstInstance(l));
+		DeviceContext->DrawIndexedInstanced(LOD.IndexCount, InstanceCount, m.m_IndicesOffset + LOD.IndexOffset, (INT)m.m_VerticesOffset, 0u);
+		Stats.DrawCalls++;
+		Stats.LODTrianglesSaved += (UINT64)(m.m_IndexCount - LOD.IndexCount) / 3u * InstanceCount;
+	}
+	Culler->SetInstanceOffset(0u);
+}
+
+void ModelData::RenderClusters(const Mesh& m, UINT FirstInstance, UINT InstanceCount)
+{
+	ID3D11DeviceContext* DeviceContext = Graphics::GetSingletonPtr()->GetDeviceContext();
+	std::shared_ptr<FrustumCuller> Culler = Application::GetSingletonPtr()->GetFrustumCuller();
+	ClusterCuller& Clusters = Culler->GetClusterCuller();
+	RenderStats& Stats = Application::GetSingletonPtr()->GetRenderStatsRef();
+	const std::vector<DirectX::XMMATRIX>& Visible = Culler->GetCPUVisibleTransforms();
+	const UINT LastInstance = std::min<UINT>(FirstInstance + InstanceCount, (UINT)Visible.size());
+	if (FirstInstance >= LastInstance)
+		return;
+
+	// all the instances at once, every surviving range is one draw of the instances that see it
+	m_ClusterInstances.clear();
+	m_ClusterRanges.clear();
+	Stats.ClusterTrianglesRejected += Clusters.CullInstances(m_Meshlets.data() + m.m_MeshletOffset, m.m_MeshletCount, m.m_pNode->GetAccumulatedTransform(),
+		Visible.data() + FirstInstance, LastInstance - FirstInstance, FirstInstance, m.m_IndicesOffset, m_ClusterInstances, m_ClusterRanges);
+	Stats.ClustersOutsideFrustum += Clusters.GetLastClustersOutsideFrustum();
+	Stats.ClustersBackfacing += Clusters.GetLastClustersBackfacing();
+	if (m_ClusterRanges.empty())
+		return;
+
+	// SV_InstanceID restarts at 0 every draw, the instance stream is read from StartInstanceLocation on so no constant buffer is
+	// mapped per range
+	const UINT Uploaded = Culler->SetClusterInstances(m_ClusterInstances);
+	InstancedShader* Shader = Application::GetSingletonPtr()->GetInstancedShader();
+	Shader->SetVertexFormat(DeviceContext, m_VertexFormat, true);
+	for (const ClusterInstancedRange& Range : m_ClusterRanges)
+	{
+		if (Range.FirstInstance + Range.InstanceCount > Uploaded)
+			break;
+
+		DeviceContext->DrawIndexedInstanced(Range.IndexCount, Range.InstanceCount, Range.StartIndex, (INT)m.m_VerticesOffset, Range.FirstInstance);
+		Stats.DrawCalls++;
+	}
+	Shader->SetVertexFormat(DeviceContext, m_VertexFormat);
+}
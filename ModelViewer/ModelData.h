@@ -15,11 +15,17 @@
 
 #include "Common.h"
 #include "AABB.h"
+#include "MeshletBuilder.h"
+#include "ClusterCuller.h"
 
 class Mesh;
 class Material;
 class Node;
-struct aiScene;
+class OcclusionCuller;
+class CullingBatch;
+class TemporalFrustumCuller;
+class MeshCache;
+class LODSelector;
 
 class ModelData
 {
@@ -37,8 +43,12 @@ public:
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer() const { return m_IndexBuffer; }
 	std::vector<Vertex>& GetVertices() { return m_Vertices; }
 	std::vector<UINT>& GetIndices() { return m_Indices; }
+	// every mesh's clusters, a mesh's range of them is Mesh::m_MeshletOffset and Mesh::m_MeshletCount
+	const std::vector<Meshlet>& GetMeshlets() const { return m_Meshlets; }
 	std::vector<std::unique_ptr<Mesh>>& GetOpaqueMeshes() { return m_OpaqueMeshes; }
 	std::vector<std::unique_ptr<Mesh>>& GetTransparentMeshes() { return m_TransparentMeshes; }
+	// the number of draws AddToCullingBatch adds, one per opaque and transparent mesh
+	UINT GetMeshCount() const { return (UINT)(m_OpaqueMeshes.size() + m_TransparentMeshes.size()); }
 	std::vector<std::shared_ptr<Material>>& GetMaterials() { return m_Materials; }
 	std::vector<ID3D11ShaderResourceView*>& GetTextures() { return m_Textures; }
 	std::unordered_map<std::string, UINT>& GetTextureIndexMap() { return m_TextureIndexMap; }
@@ -47,9 +57,42 @@ public:
 	std::vector<DirectX::XMMATRIX>& GetTransforms() { return m_Transforms; }
 	AABB& GetBoundingBox() { return m_BoundingBox; }
 
+	// recreates the vertex and index buffers when the format changes, the CPU side arrays stay full Vertex either way
+	void SetVertexFormat(VertexFormat Format);
+	VertexFormat GetVertexFormat() const { return m_VertexFormat; }
+	DXGI_FORMAT GetIndexFormat() const { return m_IndexFormat; }
+	// bytes of the vertex and index buffers
+	UINT GetGeometryBytes() const { return m_GeometryBytes; }
+
+	void SetCullingBackend(CullingBackend Backend) { m_CullingBackend = Backend; }
+	CullingBackend GetCullingBackend() const { return m_CullingBackend; }
+
+	void SubmitOccluders(OcclusionCuller& Culler);
+	void SetIsOccluder(bool bIsOccluder) { m_bIsOccluder = bIsOccluder; }
+	bool& GetIsOccluderRef() { return m_bIsOccluder; }
+	bool IsOccluder() const { return m_bIsOccluder; }
+
+	// adds the transforms and one draw per mesh (opaque first, then transparent), Render then draws from the batch output
+	void AddToCullingBatch(CullingBatch& Batch);
+	void ClearCullingBatch() { m_BatchModelIndex = INVALID_BATCH_INDEX; }
+	bool IsInCullingBatch() const { return m_BatchModelIndex != INVALID_BATCH_INDEX; }
+
+	// per instance visibility records for the CPU backend, created on first use
+	TemporalFrustumCuller& GetTemporalCuller();
+	// per instance level of detail for the CPU backend, created on first use with the model's levels
+	LODSelector& GetLODSelector();
+	// most levels any mesh has, a mesh with fewer draws its coarsest level for the levels it lacks
+	UINT GetLODCount() const { return m_LODCount; }
+
 	std::string GetModelPath() const { return m_ModelPath; }
 	std::string GetTexturesPath() const { return m_TexturesPath; }
 
+	// runs the Assimp import and bakes the result into Out, the only place Assimp is used. False if the file could not be imported.
+	// Meshes are converted on up to ThreadCount threads, 0 is the whole thread pool, the cache is the same for any count
+	static bool ImportToCache(const std::string& ModelPath, MeshCache& Out, UINT ThreadCount = 0u);
+	// the Assimp post processing the cache was built with, part of the cache key
+	static UINT GetImportFlags();
+
 private:
 	void ShutdownBuffers();
 
@@ -58,15 +101,23 @@ private:
 	void Reset();
 
 	bool CreateBuffers();
-	void LoadMaterials(const aiScene* Scene);
+	// builds materials, nodes and meshes from a cache that was either just imported or mapped from disk
+	void LoadFromCache(const MeshCache& Cache);
 
-	void RenderMeshes(const std::vector<std::unique_ptr<Mesh>>& Meshes);
+	void RenderMeshes(const std::vector<std::unique_ptr<Mesh>>& Meshes, UINT FirstBatchDraw);
+	// CPU backend with cluster culling, the visible ranges of InstanceCount CPU culled instances from FirstInstance on, one instanced
+	// draw per range
+	void RenderClusters(const Mesh& m, UINT FirstInstance, UINT InstanceCount);
+	// CPU backend with LOD selection, one instanced draw per level, level 0 through the clusters when bClusters
+	void RenderLODs(const Mesh& m, bool bClusters);
+	void SelectOccluderMeshes();
 
 private:
 	Microsoft::WRL::ComPtr<ID3D11Buffer> m_VertexBuffer;
 	Microsoft::WRL::ComPtr<ID3D11Buffer> m_IndexBuffer;
 	std::vector<Vertex> m_Vertices;
 	std::vector<UINT> m_Indices;
+	std::vector<Meshlet> m_Meshlets;
 	std::vector<std::unique_ptr<Mesh>> m_OpaqueMeshes;
 	std::vector<std::unique_ptr<Mesh>> m_TransparentMeshes;
 	std::unique_ptr<Node> m_RootNode;
@@ -77,6 +128,28 @@ private:
 
 	std::vector<DirectX::XMMATRIX> m_Transforms;
 	AABB m_BoundingBox;
+	CullingBackend m_CullingBackend = CullingBackend::GPU;
+	VertexFormat m_VertexFormat = VertexFormat::Packed;
+	// 16 bit whenever every mesh has at most 65536 vertices, GPU indices are local to their mesh
+	DXGI_FORMAT m_IndexFormat = DXGI_FORMAT_R32_UINT;
+	UINT m_GeometryBytes = 0u;
+
+	// largest opaque meshes, picked once on first use as an occluder
+	std::vector<Mesh*> m_OccluderMeshes;
+	bool m_bOccluderMeshesSelected = false;
+	bool m_bIsOccluder = false;
+
+	static const UINT INVALID_BATCH_INDEX = 0xFFFFFFFF;
+	UINT m_BatchModelIndex = INVALID_BATCH_INDEX;
+	UINT m_BatchInstanceOffset = 0u;
+	UINT m_BatchFirstDraw = 0u;
+
+	std::unique_ptr<TemporalFrustumCuller> m_TemporalCuller;
+	std::unique_ptr<LODSelector> m_LODSelector;
+	float m_LODErrors[MAX_MESH_LODS] = {};
+	UINT m_LODCount = 1u;
+	std::vector<ClusterInstancedRange> m_ClusterRanges;
+	std::vector<UINT> m_ClusterInstances;
 	
 	std::string m_ModelPath;
 	std::string m_TexturesPath;
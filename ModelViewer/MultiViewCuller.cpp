@@ -0,0 +1,155 @@
+#include <cmath>
+#include <immintrin.h>
+
+#include "MultiViewCuller.h"
+
+MultiViewCuller::MultiViewCuller()
+{
+	m_bUseSIMD = true;
+}
+
+void MultiViewCuller::SetViews(const DirectX::XMMATRIX* ViewProjs, UINT ViewCount)
+{
+	ViewCount = ViewCount < MAX_VIEWS ? ViewCount : MAX_VIEWS;
+
+	m_Frustums.resize(ViewCount);
+	m_ViewPlanes.resize(ViewCount);
+	m_ViewIndices.resize(ViewCount);
+
+	const __m128 SignMask = _mm_set1_ps(-0.f);
+	for (UINT v = 0u; v < ViewCount; v++)
+	{
+		m_Frustums[v].Extract(ViewProjs[v]);
+
+		ViewPlanes& Planes = m_ViewPlanes[v];
+		for (int p = 0; p < Frustum::PlaneCount; p++)
+		{
+			const DirectX::XMFLOAT4& Plane = m_Frustums[v].GetPlane(p);
+			Planes.X[p] = _mm_set1_ps(Plane.x);
+			Planes.Y[p] = _mm_set1_ps(Plane.y);
+			Planes.Z[p] = _mm_set1_ps(Plane.z);
+			Planes.W[p] = _mm_set1_ps(Plane.w);
+			Planes.AbsX[p] = _mm_andnot_ps(SignMask, Planes.X[p]);
+			Planes.AbsY[p] = _mm_andnot_ps(SignMask, Planes.Y[p]);
+			Planes.AbsZ[p] = _mm_andnot_ps(SignMask, Planes.Z[p]);
+		}
+	}
+}
+
+UINT MultiViewCuller::Cull(const DirectX::XMMATRIX* Transforms, UINT Count, const AABB& BBox)
+{
+	for (std::vector<UINT>& Indices : m_ViewIndices)
+	{
+		Indices.clear();
+	}
+
+	// padded the same way as the world bounds so the SIMD path can always store 4 masks
+	m_Masks.assign((Count + 7u) & ~7u, 0u);
+	if (Count == 0u || m_Frustums.empty())
+		return 0u;
+
+	m_BoundsBuilder.BuildWorldBounds(Transforms, Count, BBox);
+
+	if (m_bUseSIMD)
+	{
+		TestViewsSSE(Count);
+	}
+	else
+	{
+		TestViewsScalar(Count);
+	}
+
+	m_Masks.resize(Count);
+	BuildViewLists(Count);
+
+	UINT VisibleCount = 0u;
+	for (UINT i = 0u; i < Count; i++)
+	{
+		VisibleCount += m_Masks[i] != 0u ? 1u : 0u;
+	}
+	return VisibleCount;
+}
+
+void MultiViewCuller::TestViewsScalar(UINT Count)
+{
+	const float* CX = m_BoundsBuilder.GetWorldCenters(0u);
+	const float* CY = m_BoundsBuilder.GetWorldCenters(1u);
+	const float* CZ = m_BoundsBuilder.GetWorldCenters(2u);
+	const float* EX = m_BoundsBuilder.GetWorldExtents(0u);
+	const float* EY = m_BoundsBuilder.GetWorldExtents(1u);
+	const float* EZ = m_BoundsBuilder.GetWorldExtents(2u);
+
+	for (UINT i = 0u; i < Count; i++)
+	{
+		UINT Mask = 0u;
+		for (UINT v = 0u; v < (UINT)m_Frustums.size(); v++)
+		{
+			if (m_Frustums[v].TestAABB({ CX[i], CY[i], CZ[i] }, { EX[i], EY[i], EZ[i] }))
+			{
+				Mask |= 1u << v;
+			}
+		}
+		m_Masks[i] = Mask;
+	}
+}
+
+void MultiViewCuller::TestViewsSSE(UINT Count)
+{
+	const float* CX = m_BoundsBuilder.GetWorldCenters(0u);
+	const float* CY = m_BoundsBuilder.GetWorldCenters(1u);
+	const float* CZ = m_BoundsBuilder.GetWorldCenters(2u);
+	const float* EX = m_BoundsBuilder.GetWorldExtents(0u);
+	const float* EY = m_BoundsBuilder.GetWorldExtents(1u);
+	const float* EZ = m_BoundsBuilder.GetWorldExtents(2u);
+	const UINT ViewCount = (UINT)m_ViewPlanes.size();
+	const __m128 Zero = _mm_setzero_ps();
+
+	for (UINT i = 0u; i < Count; i += 4u)
+	{
+		const __m128 cx = _mm_loadu_ps(CX + i);
+		const __m128 cy = _mm_loadu_ps(CY + i);
+		const __m128 cz = _mm_loadu_ps(CZ + i);
+		const __m128 ex = _mm_loadu_ps(EX + i);
+		const __m128 ey = _mm_loadu_ps(EY + i);
+		const __m128 ez = _mm_loadu_ps(EZ + i);
+
+		__m128i Masks = _mm_setzero_si128();
+		for (UINT v = 0u; v < ViewCount; v++)
+		{
+			const ViewPlanes& Planes = m_ViewPlanes[v];
+
+			__m128 Visible = _mm_cmpeq_ps(Zero, Zero);
+			for (int p = 0; p < Frustum::PlaneCount; p++)
+			{
+				__m128 Dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(Planes.X[p], cx), _mm_mul_ps(Planes.Y[p], cy)), _mm_add_ps(_mm_mul_ps(Planes.Z[p], cz), Planes.W[p]));
+				__m128 Radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(Planes.AbsX[p], ex), _mm_mul_ps(Planes.AbsY[p], ey)), _mm_mul_ps(Planes.AbsZ[p], ez));
+				Visible = _mm_and_ps(Visible, _mm_cmpge_ps(_mm_add_ps(Dist, Radius), Zero));
+
+				// all 4 already culled in this view, the remaining planes can't bring them back
+				if (_mm_movemask_ps(Visible) == 0)
+					break;
+			}
+
+			// compare results are all ones per lane, masking with the view bit sets it only in the visible lanes
+			Masks = _mm_or_si128(Masks, _mm_and_si128(_mm_castps_si128(Visible), _mm_set1_epi32((int)(1u << v))));
+		}
+
+		_mm_storeu_si128((__m128i*)(m_Masks.data() + i), Masks);
+	}
+}
+
+void MultiViewCuller::BuildViewLists(UINT Count)
+{
+	// one pass over the masks, only the 4 bytes per instance are touched
+	for (UINT i = 0u; i < Count; i++)
+	{
+		UINT Mask = m_Masks[i];
+		for (UINT v = 0u; Mask != 0u; v++, Mask >>= 1)
+		{
+			if (Mask & 1u)
+			{
+				m_ViewIndices[v].push_back(i);
+			}
+		}
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#ifndef MULTI_VIEW_CULLER_H
+#define MULTI_VIEW_CULLER_H
+
+#include <vector>
+#include <immintrin.h>
+
+#include "DirectXMath.h"
+
+#include "AABB.h"
+#include "Frustum.h"
+#include "CPUFrustumCuller.h"
+
+typedef unsigned int UINT;
+
+/*
+*	Culls every instance against up to 32 views in a single pass. World bounds are built once, then each block of 4 instances is
+*	tested against the planes of every view while it is still in registers, producing one visibility bitmask per instance with bit v
+*	set when the instance is visible in view v. Per view lists are compacted from the masks afterwards, so adding a view costs six
+*	plane tests per instance instead of another trip through the transforms. Pure CPU, no device needed.
+*/
+
+class MultiViewCuller
+{
+private:
+	// planes broadcast into registers ahead of time, AbsX/Y/Z are the absolute normals used for the box radius
+	struct ViewPlanes
+	{
+		__m128 X[Frustum::PlaneCount];
+		__m128 Y[Frustum::PlaneCount];
+		__m128 Z[Frustum::PlaneCount];
+		__m128 W[Frustum::PlaneCount];
+		__m128 AbsX[Frustum::PlaneCount];
+		__m128 AbsY[Frustum::PlaneCount];
+		__m128 AbsZ[Frustum::PlaneCount];
+	};
+
+public:
+	static const UINT MAX_VIEWS = 32u;
+
+public:
+	MultiViewCuller();
+
+	// views past MAX_VIEWS are ignored
+	void SetViews(const DirectX::XMMATRIX* ViewProjs, UINT ViewCount);
+	UINT GetViewCount() const { return (UINT)m_Frustums.size(); }
+	const Frustum& GetFrustum(UINT View) const { return m_Frustums[View]; }
+
+	// Transforms in the same (transposed) layout as ModelData::m_Transforms. Fills the masks and the per view lists, returns how many
+	// instances are visible in at least one view
+	UINT Cull(const DirectX::XMMATRIX* Transforms, UINT Count, const AABB& BBox);
+
+	void SetUseSIMD(bool bUseSIMD) { m_bUseSIMD = bUseSIMD; }
+
+	const std::vector<UINT>& GetMasks() const { return m_Masks; }
+	const std::vector<UINT>& GetViewIndices(UINT View) const { return m_ViewIndices[View]; }
+
+private:
+	void TestViewsScalar(UINT Count);
+	void TestViewsSSE(UINT Count);
+	void BuildViewLists(UINT Count);
+
+private:
+	CPUFrustumCuller m_BoundsBuilder;
+	std::vector<Frustum> m_Frustums;
+	std::vector<ViewPlanes> m_ViewPlanes;
+
+	std::vector<UINT> m_Masks;
+	std::vector<std::vector<UINT>> m_ViewIndices;
+
+	bool m_bUseSIMD;
+
+};
+
+#endif
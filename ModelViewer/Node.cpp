@@ -1,5 +1,3 @@
-#include "assimp/scene.h"
-
 #include "Node.h"
 #include "ModelData.h"
 #include "Graphics.h"
@@ -10,46 +8,12 @@ Node::Node(ModelData* pModel, Node* pOwner) : m_pModel(pModel), m_pOwner(pOwner)
 {
 }
 
-void Node::ProcessNode(aiNode* ModelNode, const aiScene* Scene, const DirectX::XMMATRIX& AccumulatedTransform)
+void Node::Initialise(const std::string& Name, const DirectX::XMMATRIX& LocalTransform, const DirectX::XMMATRIX& AccumulatedTransform)
 {
-	m_NodeName = ModelNode->mName.C_Str();
-	
-	m_LocalTransform = ConvertToXMMATRIX(ModelNode->mTransformation);
-	m_AccumulatedTransform = AccumulatedTransform * m_LocalTransform;
+	m_NodeName = Name;
+	m_LocalTransform = LocalTransform;
+	m_AccumulatedTransform = AccumulatedTransform;
 	CreateConstantBuffer();
-	
-	for (size_t i = 0; i < ModelNode->mNumMeshes; i++)
-	{
-		aiMesh* SceneMesh = Scene->mMeshes[ModelNode->mMeshes[i]];
-		bool bOpaque = m_pModel->GetMaterials()[SceneMesh->mMaterialIndex]->m_bOpaque;
-
-		if (bOpaque)
-		{
-			m_pModel->GetOpaqueMeshes().emplace_back(std::make_unique<Mesh>(m_pModel, this));
-			m_pModel->GetOpaqueMeshes().back()->ProcessMesh(SceneMesh);
-		}
-		else
-		{
-			m_pModel->GetTransparentMeshes().emplace_back(std::make_unique<Mesh>(m_pModel, this));
-			m_pModel->GetTransparentMeshes().back()->ProcessMesh(SceneMesh);
-		}
-	}
-
-	for (size_t i = 0; i < ModelNode->mNumChildren; i++)
-	{
-		m_Children.emplace_back(std::make_unique<Node>(m_pModel, this));
-		m_Children.back().get()->ProcessNode(ModelNode->mChildren[i], Scene, m_AccumulatedTransform);
-	}
-}
-
-DirectX::XMMATRIX Node::ConvertToXMMATRIX(const aiMatrix4x4& aiMatrix) const
-{
-	return DirectX::XMMATRIX(
-		aiMatrix.a1, aiMatrix.a2, aiMatrix.a3, aiMatrix.a4,
-		aiMatrix.b1, aiMatrix.b2, aiMatrix.b3, aiMatrix.b4,
-		aiMatrix.c1, aiMatrix.c2, aiMatrix.c3, aiMatrix.c4,
-		aiMatrix.d1, aiMatrix.d2, aiMatrix.d3, aiMatrix.d4
-	);
 }
 
 void Node::CreateConstantBuffer()
@@ -13,13 +13,8 @@
 
 #include "wrl.h"
 
-#include "assimp/matrix4x4.h"
-
 #include "Mesh.h"
 
-struct aiNode;
-struct aiScene;
-
 class Node
 {
 	friend class ModelData;
@@ -27,15 +22,14 @@ class Node
 public:
 	Node(ModelData* pModel, Node* pOwner);
 
-	void ProcessNode(aiNode* ModelNode, const aiScene* Scene, const DirectX::XMMATRIX& AccumulatedTransform);
+	// transforms as the import baked them, AccumulatedTransform already includes every parent
+	void Initialise(const std::string& Name, const DirectX::XMMATRIX& LocalTransform, const DirectX::XMMATRIX& AccumulatedTransform);
 
 	const DirectX::XMMATRIX& GetAccumulatedTransform() { return m_AccumulatedTransform; }
 
 private:
 	void CreateConstantBuffer();
 
-	DirectX::XMMATRIX ConvertToXMMATRIX(const aiMatrix4x4& aiMatrix) const;
-
 private:
 	std::vector<std::unique_ptr<Node>> m_Children;
 
@@ -0,0 +1,165 @@
+#pragma once
+
+#ifndef OBJECT_POOL_H
+#define OBJECT_POOL_H
+
+#include <vector>
+#include <memory>
+#include <utility>
+#include <new>
+
+typedef unsigned int UINT;
+
+const UINT INVALID_POOL_INDEX = 0xFFFFFFFF;
+
+// index of the slot plus the generation it was handed out with, goes stale once the object is destroyed
+struct PoolHandle
+{
+	UINT Index = INVALID_POOL_INDEX;
+	UINT Generation = 0u;
+
+	bool IsValid() const { return Index != INVALID_POOL_INDEX; }
+	bool operator==(const PoolHandle& Other) const = default;
+};
+
+/*
+*	Pooled storage for objects of one concrete type. Objects are constructed in place in fixed size blocks, so they never move and
+*	neighbours in memory were usually created together. Create and Destroy are O(1): freed slots go on a free list and are reused
+*	last in first out while their memory is still warm. Every slot counts its generation up on Destroy, a handle to a destroyed
+*	object then no longer resolves instead of pointing at whatever took the slot. The live objects are also kept in a dense list for
+*	iteration, Destroy swaps the last entry into the hole so the order is creation order until something goes. Pure CPU, no device needed.
+*/
+
+template<typename T>
+class ObjectPool
+{
+public:
+	static const UINT BLOCK_SIZE = 256u;
+
+private:
+	struct alignas(T) Storage
+	{
+		unsigned char Bytes[sizeof(T)];
+	};
+
+public:
+	ObjectPool() = default;
+	ObjectPool(const ObjectPool& Other) = delete;
+	ObjectPool& operator=(const ObjectPool& Other) = delete;
+	~ObjectPool() { Clear(); }
+
+	template<typename... Args>
+	PoolHandle Create(Args&&... Arguments)
+	{
+		if (m_FreeSlots.empty())
+		{
+			AddBlock();
+		}
+
+		const UINT Index = m_FreeSlots.back();
+		m_FreeSlots.pop_back();
+
+		T* Object = new (GetStorage(Index)) T(std::forward<Args>(Arguments)...);
+		m_DenseIndices[Index] = (UINT)m_Objects.size();
+		m_Objects.push_back(Object);
+		m_ObjectSlots.push_back(Index);
+
+		return { Index, m_Generations[Index] };
+	}
+
+	// returns false for a stale or invalid handle, destroying twice is harmless
+	bool Destroy(PoolHandle Handle)
+	{
+		T* Object = Get(Handle);
+		if (!Object)
+			return false;
+
+		// unlinked first, the destructor of T may look at the pool
+		const UINT Dense = m_DenseIndices[Handle.Index];
+		const UINT LastSlot = m_ObjectSlots.back();
+		m_Objects[Dense] = m_Objects.back();
+		m_ObjectSlots[Dense] = LastSlot;
+		m_DenseIndices[LastSlot] = Dense;
+		m_Objects.pop_back();
+		m_ObjectSlots.pop_back();
+
+		m_DenseIndices[Handle.Index] = INVALID_POOL_INDEX;
+		m_Generations[Handle.Index]++;
+		Object->~T();
+		m_FreeSlots.push_back(Handle.Index);
+
+		return true;
+	}
+
+	// nullptr once the object behind the handle is gone
+	T* Get(PoolHandle Handle) const
+	{
+		if (Handle.Index >= (UINT)m_Generations.size() || m_Generations[Handle.Index] != Handle.Generation ||
+			m_DenseIndices[Handle.Index] == INVALID_POOL_INDEX)
+			return nullptr;
+
+		return m_Objects[m_DenseIndices[Handle.Index]];
+	}
+
+	// handle of a live object, for code that only has the pointer from GetObjects
+	PoolHandle GetHandle(UINT DenseIndex) const
+	{
+		const UINT Index = m_ObjectSlots[DenseIndex];
+		return { Index, m_Generations[Index] };
+	}
+
+	// blocks for Count live objects up front, for bulk creation
+	void Reserve(UINT Count)
+	{
+		while (GetCapacity() < Count)
+		{
+			AddBlock();
+		}
+		m_Objects.reserve(Count);
+		m_ObjectSlots.reserve(Count);
+	}
+
+	void Clear()
+	{
+		while (!m_Objects.empty())
+		{
+			Destroy(GetHandle((UINT)m_Objects.size() - 1u));
+		}
+	}
+
+	const std::vector<T*>& GetObjects() const { return m_Objects; }
+	UINT GetCount() const { return (UINT)m_Objects.size(); }
+	UINT GetCapacity() const { return (UINT)m_Blocks.size() * BLOCK_SIZE; }
+
+private:
+	void AddBlock()
+	{
+		const UINT First = GetCapacity();
+		m_Blocks.push_back(std::make_unique<Storage[]>(BLOCK_SIZE));
+		m_Generations.resize(First + BLOCK_SIZE, 0u);
+		m_DenseIndices.resize(First + BLOCK_SIZE, INVALID_POOL_INDEX);
+
+		// pushed backwards so the block fills front to back
+		for (UINT i = BLOCK_SIZE; i > 0u; i--)
+		{
+			m_FreeSlots.push_back(First + i - 1u);
+		}
+	}
+
+	void* GetStorage(UINT Index) { return m_Blocks[Index / BLOCK_SIZE][Index % BLOCK_SIZE].Bytes; }
+
+private:
+	std::vector<std::unique_ptr<Storage[]>> m_Blocks;
+
+	// by slot
+	std::vector<UINT> m_Generations;
+	std::vector<UINT> m_DenseIndices;	// position in m_Objects, INVALID_POOL_INDEX for free slots
+	std::vector<UINT> m_FreeSlots;
+
+	// live objects, dense
+	std::vector<T*> m_Objects;
+	std::vector<UINT> m_ObjectSlots;
+
+};
+
+#endif
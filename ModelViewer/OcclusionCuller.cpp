@@ -0,0 +1,375 @@
+#include <cmath>
+#include <algorithm>
+#include <immintrin.h>
+
+#include "OcclusionCuller.h"
+#include "ThreadPool.h"
+
+// anything closer than this in clip space w is treated as crossing the near plane
+static const float NEAR_W = 1e-4f;
+// occluder triangles reaching further than this many screens off to the side are dropped, edge functions lose too much precision
+static const float GUARD_BAND = 16.f;
+// an instance is tested on the first mip level where its rect is at most this many texels across
+static const int HIZ_MAX_TEXELS = 4;
+
+OcclusionCuller::OcclusionCuller()
+{
+	m_ViewProj = DirectX::XMMatrixIdentity();
+	m_TriangleCount = 0u;
+	m_RasterizedTriangleCount = 0u;
+	m_bUseReferenceRasterizer = false;
+	m_TileBins.resize(TILES_X * TILES_Y);
+
+	UINT Width = WIDTH;
+	UINT Height = HEIGHT;
+	while (true)
+	{
+		m_HiZWidths.push_back(Width);
+		m_HiZHeights.push_back(Height);
+		m_HiZ.emplace_back(Width * Height, 1.f);
+
+		if (Width == 1u && Height == 1u)
+			break;
+
+		Width = (Width + 1u) / 2u;
+		Height = (Height + 1u) / 2u;
+	}
+}
+
+void OcclusionCuller::BeginFrame(const DirectX::XMMATRIX& ViewProj)
+{
+	m_ViewProj = ViewProj;
+	m_Batches.clear();
+	m_TriangleCount = 0u;
+	m_RasterizedTriangleCount = 0u;
+
+	std::fill(m_HiZ[0].begin(), m_HiZ[0].end(), 1.f);
+}
+
+void OcclusionCuller::AddOccluder(const void* Positions, UINT PositionStride, const UINT* Indices, UINT IndexCount, const DirectX::XMMATRIX& World)
+{
+	UINT TriangleCount = std::min(IndexCount / 3u, MAX_OCCLUDER_TRIANGLES - m_TriangleCount);
+	if (TriangleCount == 0u)
+		return;
+
+	m_Batches.push_back({ (const unsigned char*)Positions, PositionStride, Indices, TriangleCount, m_TriangleCount, World * m_ViewProj });
+	m_TriangleCount += TriangleCount;
+}
+
+void OcclusionCuller::RasterizeOccluders()
+{
+	ThreadPool* Pool = ThreadPool::GetSingletonPtr();
+
+	m_Triangles.resize(m_TriangleCount);
+	Pool->ParallelFor((UINT)m_Batches.size(), 1u, [this](UINT Begin, UINT End)
+		{
+			for (UINT i = Begin; i < End; i++)
+			{
+				SetupTriangles(m_Batches[i]);
+			}
+		});
+
+	BinTriangles();
+
+	Pool->ParallelFor(TILES_X * TILES_Y, 1u, [this](UINT Begin, UINT End)
+		{
+			for (UINT Tile = Begin; Tile < End; Tile++)
+			{
+				if (m_bUseReferenceRasterizer)
+					RasterizeTileReference(Tile);
+				else
+					RasterizeTile(Tile);
+			}
+		});
+
+	BuildHiZ();
+}
+
+bool OcclusionCuller::IsOccluded(const AABB& LocalBounds, const DirectX::XMMATRIX& Transform) const
+{
+	const DirectX::XMMATRIX WorldViewProj = DirectX::XMMatrixTranspose(Transform) * m_ViewProj;
+
+	float MinX = FLT_MAX, MinY = FLT_MAX, MinZ = FLT_MAX;
+	float MaxX = -FLT_MAX, MaxY = -FLT_MAX;
+	for (int i = 0; i < 8; i++)
+	{
+		DirectX::XMVECTOR Corner = DirectX::XMVectorSet(
+			(i & 1) ? LocalBounds.Max.x : LocalBounds.Min.x,
+			(i & 2) ? LocalBounds.Max.y : LocalBounds.Min.y,
+			(i & 4) ? LocalBounds.Max.z : LocalBounds.Min.z,
+			1.f);
+		DirectX::XMFLOAT4 Clip;
+		DirectX::XMStoreFloat4(&Clip, DirectX::XMVector4Transform(Corner, WorldViewProj));
+
+		if (Clip.w < NEAR_W)
+			return false;
+
+		float InvW = 1.f / Clip.w;
+		MinX = std::min(MinX, Clip.x * InvW);
+		MaxX = std::max(MaxX, Clip.x * InvW);
+		MinY = std::min(MinY, Clip.y * InvW);
+		MaxY = std::max(MaxY, Clip.y * InvW);
+		MinZ = std::min(MinZ, Clip.z * InvW);
+	}
+
+	// off screen is the frustum culler's job
+	if (MaxX < -1.f || MinX > 1.f || MaxY < -1.f || MinY > 1.f)
+		return false;
+
+	// occluders are sampled at pixel centers, so a pixel can read as covered while part of it isn't. Growing the rect by a pixel
+	// means the bounds always sit between covered pixel centers
+	int x0 = std::clamp((int)floorf((MinX * 0.5f + 0.5f) * WIDTH) - 1, 0, (int)WIDTH - 1);
+	int x1 = std::clamp((int)floorf((MaxX * 0.5f + 0.5f) * WIDTH) + 1, 0, (int)WIDTH - 1);
+	int y0 = std::clamp((int)floorf((0.5f - MaxY * 0.5f) * HEIGHT) - 1, 0, (int)HEIGHT - 1);
+	int y1 = std::clamp((int)floorf((0.5f - MinY * 0.5f) * HEIGHT) + 1, 0, (int)HEIGHT - 1);
+
+	UINT Level = 0u;
+	while (Level + 1u < (UINT)m_HiZ.size() && std::max(x1 - x0, y1 - y0) >= HIZ_MAX_TEXELS)
+	{
+		Level++;
+		x0 >>= 1; x1 >>= 1;
+		y0 >>= 1; y1 >>= 1;
+	}
+
+	const std::vector<float>& Mip = m_HiZ[Level];
+	const int MipWidth = (int)m_HiZWidths[Level];
+	for (int y = y0; y <= y1; y++)
+	{
+		for (int x = x0; x <= x1; x++)
+		{
+			if (MinZ <= Mip[y * MipWidth + x])
+				return false;
+		}
+	}
+
+	return true;
+}
+
+UINT OcclusionCuller::CullInstances(const AABB& LocalBounds, std::vector<DirectX::XMMATRIX>& Transforms)
+{
+	const UINT Count = (UINT)Transforms.size();
+	m_VisibleFlags.resize(Count);
+
+	ThreadPool::GetSingletonPtr()->ParallelFor(Count, 256u, [&](UINT Begin, UINT End)
+		{
+			for (UINT i = Begin; i < End; i++)
+			{
+				m_VisibleFlags[i] = IsOccluded(LocalBounds, Transforms[i]) ? 0u : 1u;
+			}
+		});
+
+	UINT Kept = 0u;
+	for (UINT i = 0u; i < Count; i++)
+	{
+		if (m_VisibleFlags[i])
+		{
+			Transforms[Kept++] = Transforms[i];
+		}
+	}
+	Transforms.resize(Kept);
+
+	return Count - Kept;
+}
+
+void OcclusionCuller::SetupTriangles(const OccluderBatch& Batch)
+{
+	for (UINT t = 0u; t < Batch.TriangleCount; t++)
+	{
+		ScreenTriangle& Tri = m_Triangles[Batch.FirstTriangle + t];
+		Tri.MinX = 0;
+		Tri.MaxX = -1;
+
+		float X[3], Y[3], Z[3];
+		bool bClipped = false;
+		for (int v = 0; v < 3; v++)
+		{
+			const DirectX::XMFLOAT3* Pos = (const DirectX::XMFLOAT3*)(Batch.Positions + (size_t)Batch.Indices[t * 3u + v] * Batch.PositionStride);
+			DirectX::XMFLOAT4 Clip;
+			DirectX::XMStoreFloat4(&Clip, DirectX::XMVector4Transform(DirectX::XMVectorSet(Pos->x, Pos->y, Pos->z, 1.f), Batch.WorldViewProj));
+
+			float InvW = 1.f / Clip.w;
+			if (Clip.w < NEAR_W || fabsf(Clip.x * InvW) > GUARD_BAND || fabsf(Clip.y * InvW) > GUARD_BAND)
+			{
+				bClipped = true;
+				break;
+			}
+
+			X[v] = (Clip.x * InvW * 0.5f + 0.5f) * WIDTH;
+			Y[v] = (0.5f - Clip.y * InvW * 0.5f) * HEIGHT;
+			Z[v] = std::clamp(Clip.z * InvW, 0.f, 1.f);
+		}
+
+		if (bClipped)
+			continue;
+
+		// clockwise on screen is front facing, same as the raster state the models are drawn with
+		float Area = (X[1] - X[0]) * (Y[2] - Y[0]) - (X[2] - X[0]) * (Y[1] - Y[0]);
+		if (Area <= 0.f)
+			continue;
+
+		Tri.MinX = std::max(0, (int)floorf(std::min({ X[0], X[1], X[2] })));
+		Tri.MinY = std::max(0, (int)floorf(std::min({ Y[0], Y[1], Y[2] })));
+		Tri.MaxX = std::min((int)WIDTH - 1, (int)ceilf(std::max({ X[0], X[1], X[2] })));
+		Tri.MaxY = std::min((int)HEIGHT - 1, (int)ceilf(std::max({ Y[0], Y[1], Y[2] })));
+		if (Tri.MaxX < Tri.MinX || Tri.MaxY < Tri.MinY)
+		{
+			Tri.MaxX = Tri.MinX - 1;
+			continue;
+		}
+
+		// edge e goes from vertex e to vertex e + 1, positive on the inside
+		for (int e = 0; e < 3; e++)
+		{
+			int n = (e + 1) % 3;
+			Tri.EdgeA[e] = Y[e] - Y[n];
+			Tri.EdgeB[e] = X[n] - X[e];
+			Tri.EdgeC[e] = -(Tri.EdgeA[e] * X[e] + Tri.EdgeB[e] * Y[e]);
+		}
+
+		// barycentric weight of vertex 1 comes from edge 2 (2 -> 0) and vertex 2 from edge 0 (0 -> 1)
+		const float InvArea = 1.f / Area;
+		const float dz1 = (Z[1] - Z[0]) * InvArea;
+		const float dz2 = (Z[2] - Z[0]) * InvArea;
+		Tri.DepthA = Tri.EdgeA[2] * dz1 + Tri.EdgeA[0] * dz2;
+		Tri.DepthB = Tri.EdgeB[2] * dz1 + Tri.EdgeB[0] * dz2;
+		Tri.DepthC = Z[0] + Tri.EdgeC[2] * dz1 + Tri.EdgeC[0] * dz2;
+	}
+}
+
+void OcclusionCuller::BinTriangles()
+{
+	for (std::vector<UINT>& Bin : m_TileBins)
+	{
+		Bin.clear();
+	}
+
+	m_RasterizedTriangleCount = 0u;
+	for (UINT t = 0u; t < m_TriangleCount; t++)
+	{
+		const ScreenTriangle& Tri = m_Triangles[t];
+		if (!Tri.IsValid())
+			continue;
+
+		m_RasterizedTriangleCount++;
+		for (int ty = Tri.MinY / (int)TILE_HEIGHT; ty <= Tri.MaxY / (int)TILE_HEIGHT; ty++)
+		{
+			for (int tx = Tri.MinX / (int)TILE_WIDTH; tx <= Tri.MaxX / (int)TILE_WIDTH; tx++)
+			{
+				m_TileBins[ty * TILES_X + tx].push_back(t);
+			}
+		}
+	}
+}
+
+void OcclusionCuller::RasterizeTile(UINT Tile)
+{
+	const int TileX = (int)((Tile % TILES_X) * TILE_WIDTH);
+	const int TileY = (int)((Tile / TILES_X) * TILE_HEIGHT);
+	float* Depth = m_HiZ[0].data();
+
+	const __m128 Zero = _mm_setzero_ps();
+	const __m128 LaneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+
+	for (UINT t : m_TileBins[Tile])
+	{
+		const ScreenTriangle& Tri = m_Triangles[t];
+
+		// tile width is a multiple of 4, so rounding the start down keeps every group of 4 inside the tile
+		const int x0 = std::max(TileX, Tri.MinX) & ~3;
+		const int x1 = std::min(TileX + (int)TILE_WIDTH - 1, Tri.MaxX);
+		const int y0 = std::max(TileY, Tri.MinY);
+		const int y1 = std::min(TileY + (int)TILE_HEIGHT - 1, Tri.MaxY);
+
+		const __m128 A0 = _mm_set1_ps(Tri.EdgeA[0]), A1 = _mm_set1_ps(Tri.EdgeA[1]), A2 = _mm_set1_ps(Tri.EdgeA[2]);
+		const __m128 B0 = _mm_set1_ps(Tri.EdgeB[0]), B1 = _mm_set1_ps(Tri.EdgeB[1]), B2 = _mm_set1_ps(Tri.EdgeB[2]);
+		const __m128 C0 = _mm_set1_ps(Tri.EdgeC[0]), C1 = _mm_set1_ps(Tri.EdgeC[1]), C2 = _mm_set1_ps(Tri.EdgeC[2]);
+		const __m128 DA = _mm_set1_ps(Tri.DepthA), DB = _mm_set1_ps(Tri.DepthB), DC = _mm_set1_ps(Tri.DepthC);
+
+		for (int y = y0; y <= y1; y++)
+		{
+			const __m128 py = _mm_set1_ps((float)y + 0.5f);
+			const __m128 Row0 = _mm_add_ps(_mm_mul_ps(B0, py), C0);
+			const __m128 Row1 = _mm_add_ps(_mm_mul_ps(B1, py), C1);
+			const __m128 Row2 = _mm_add_ps(_mm_mul_ps(B2, py), C2);
+			const __m128 RowZ = _mm_add_ps(_mm_mul_ps(DB, py), DC);
+			float* DepthRow = Depth + y * WIDTH;
+
+			for (int x = x0; x <= x1; x += 4)
+			{
+				const __m128 px = _mm_add_ps(_mm_set1_ps((float)x), LaneOffsets);
+				__m128 Inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(A0, px), Row0), Zero);
+				Inside = _mm_and_ps(Inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(A1, px), Row1), Zero));
+				Inside = _mm_and_ps(Inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(A2, px), Row2), Zero));
+				if (_mm_movemask_ps(Inside) == 0)
+					continue;
+
+				const __m128 z = _mm_add_ps(_mm_mul_ps(DA, px), RowZ);
+				const __m128 Old = _mm_loadu_ps(DepthRow + x);
+				const __m128 New = _mm_min_ps(Old, z);
+				_mm_storeu_ps(DepthRow + x, _mm_or_ps(_mm_and_ps(Inside, New), _mm_andnot_ps(Inside, Old)));
+			}
+		}
+	}
+}
+
+void OcclusionCuller::RasterizeTileReference(UINT Tile)
+{
+	const int TileX = (int)((Tile % TILES_X) * TILE_WIDTH);
+	const int TileY = (int)((Tile / TILES_X) * TILE_HEIGHT);
+	float* Depth = m_HiZ[0].data();
+
+	for (UINT t : m_TileBins[Tile])
+	{
+		const ScreenTriangle& Tri = m_Triangles[t];
+
+		for (int y = std::max(TileY, Tri.MinY); y <= std::min(TileY + (int)TILE_HEIGHT - 1, Tri.MaxY); y++)
+		{
+			for (int x = std::max(TileX, Tri.MinX); x <= std::min(TileX + (int)TILE_WIDTH - 1, Tri.MaxX); x++)
+			{
+				const float px = (float)x + 0.5f;
+				const float py = (float)y + 0.5f;
+
+				bool bInside = true;
+				for (int e = 0; e < 3 && bInside; e++)
+				{
+					bInside = Tri.EdgeA[e] * px + (Tri.EdgeB[e] * py + Tri.EdgeC[e]) >= 0.f;
+				}
+
+				if (!bInside)
+					continue;
+
+				float z = Tri.DepthA * px + (Tri.DepthB * py + Tri.DepthC);
+				Depth[y * WIDTH + x] = std::min(Depth[y * WIDTH + x], z);
+			}
+		}
+	}
+}
+
+void OcclusionCuller::BuildHiZ()
+{
+	for (UINT Level = 1u; Level < (UINT)m_HiZ.size(); Level++)
+	{
+		const std::vector<float>& Src = m_HiZ[Level - 1u];
+		std::vector<float>& Dst = m_HiZ[Level];
+		const UINT SrcWidth = m_HiZWidths[Level - 1u];
+		const UINT SrcHeight = m_HiZHeights[Level - 1u];
+		const UINT DstWidth = m_HiZWidths[Level];
+
+		ThreadPool::GetSingletonPtr()->ParallelFor(m_HiZHeights[Level], 8u, [&](UINT Begin, UINT End)
+			{
+				for (UINT y = Begin; y < End; y++)
+				{
+					// odd sizes clamp to the last row/column so the edge texels still take the max of everything they cover
+					const UINT sy0 = y * 2u;
+					const UINT sy1 = std::min(sy0 + 1u, SrcHeight - 1u);
+					for (UINT x = 0u; x < DstWidth; x++)
+					{
+						const UINT sx0 = x * 2u;
+						const UINT sx1 = std::min(sx0 + 1u, SrcWidth - 1u);
+						Dst[y * DstWidth + x] = std::max(std::max(Src[sy0 * SrcWidth + sx0], Src[sy0 * SrcWidth + sx1]),
+							std::max(Src[sy1 * SrcWidth + sx0], Src[sy1 * SrcWidth + sx1]));
+					}
+				}
+			});
+	}
+}
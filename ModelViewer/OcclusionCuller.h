@@ -0,0 +1,107 @@
+#pragma once
+
+#ifndef OCCLUSION_CULLER_H
+#define OCCLUSION_CULLER_H
+
+#include <vector>
+
+#include "DirectXMath.h"
+
+#include "AABB.h"
+
+typedef unsigned int UINT;
+
+/*
+*	Software occlusion culling. A handful of large occluder meshes are rasterized into a small depth buffer on the CPU, split into
+*	screen tiles that are rasterized in parallel 4 pixels at a time. A max depth mip chain (HiZ) is built on top and instance bounds
+*	are projected and tested against the mip level where they cover only a few texels. Only occluders fully in front of the near
+*	plane are rasterized and anything crossing it is treated as visible, so the result stays conservative. Pure CPU, no device needed.
+*/
+
+class OcclusionCuller
+{
+private:
+	struct OccluderBatch
+	{
+		const unsigned char* Positions;
+		UINT PositionStride;
+		const UINT* Indices;
+		UINT TriangleCount;
+		UINT FirstTriangle;
+		DirectX::XMMATRIX WorldViewProj;
+	};
+
+	// screen space, pixels with y going down and z in [0, 1]. Edge and depth functions are stored as A * x + B * y + C
+	struct ScreenTriangle
+	{
+		float EdgeA[3];
+		float EdgeB[3];
+		float EdgeC[3];
+		float DepthA;
+		float DepthB;
+		float DepthC;
+		int MinX;
+		int MinY;
+		int MaxX;
+		int MaxY;
+
+		bool IsValid() const { return MaxX >= MinX; }
+	};
+
+public:
+	static const UINT WIDTH = 320u;
+	static const UINT HEIGHT = 192u;
+	static const UINT TILE_WIDTH = 32u;
+	static const UINT TILE_HEIGHT = 16u;
+	static const UINT TILES_X = WIDTH / TILE_WIDTH;
+	static const UINT TILES_Y = HEIGHT / TILE_HEIGHT;
+	static const UINT MAX_OCCLUDER_TRIANGLES = 65536u;
+
+public:
+	OcclusionCuller();
+
+	void BeginFrame(const DirectX::XMMATRIX& ViewProj);
+
+	// Positions are read with PositionStride so a Vertex array can be passed directly. World is the regular (non transposed) matrix
+	void AddOccluder(const void* Positions, UINT PositionStride, const UINT* Indices, UINT IndexCount, const DirectX::XMMATRIX& World);
+	void RasterizeOccluders();
+
+	// Transform in the same (transposed) layout as ModelData::m_Transforms
+	bool IsOccluded(const AABB& LocalBounds, const DirectX::XMMATRIX& Transform) const;
+	// removes occluded transforms in place, keeping the order of the rest. Returns how many were removed
+	UINT CullInstances(const AABB& LocalBounds, std::vector<DirectX::XMMATRIX>& Transforms);
+
+	void SetUseReferenceRasterizer(bool bUseReference) { m_bUseReferenceRasterizer = bUseReference; }
+
+	const std::vector<float>& GetDepthBuffer() const { return m_HiZ[0]; }
+	UINT GetOccluderTriangleCount() const { return m_TriangleCount; }
+	UINT GetRasterizedTriangleCount() const { return m_RasterizedTriangleCount; }
+
+private:
+	void SetupTriangles(const OccluderBatch& Batch);
+	void BinTriangles();
+	void RasterizeTile(UINT Tile);
+	void RasterizeTileReference(UINT Tile);
+	void BuildHiZ();
+
+private:
+	DirectX::XMMATRIX m_ViewProj;
+
+	std::vector<OccluderBatch> m_Batches;
+	std::vector<ScreenTriangle> m_Triangles;
+	std::vector<std::vector<UINT>> m_TileBins;
+	UINT m_TriangleCount;
+	UINT m_RasterizedTriangleCount;
+
+	// level 0 is the depth buffer itself, every level after stores the max of the 2x2 texels below it
+	std::vector<std::vector<float>> m_HiZ;
+	std::vector<UINT> m_HiZWidths;
+	std::vector<UINT> m_HiZHeights;
+
+	std::vector<unsigned char> m_VisibleFlags;
+
+	bool m_bUseReferenceRasterizer;
+
+};
+
+#endif
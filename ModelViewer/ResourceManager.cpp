@@ -9,6 +9,7 @@
 #include "Graphics.h"
 #include "ModelData.h"
 #include "MyMacros.h"
+#include "ThreadPool.h"
 
 ResourceManager* ResourceManager::ms_Instance = nullptr;
 
@@ -58,6 +59,43 @@ ID3D11ShaderResourceView* ResourceManager::LoadTexture(const std::string& Filepa
 	return pData;
 }
 
+void ResourceManager::LoadTextures(const std::vector<std::string>& Filepaths, std::vector<ID3D11ShaderResourceView*>& OutTextures, UINT ThreadCount)
+{
+	OutTextures.assign(Filepaths.size(), nullptr);
+
+	std::vector<UINT> Missing;
+	for (UINT i = 0u; i < (UINT)Filepaths.size(); i++)
+	{
+		auto it = m_TexturesMap.find(Filepaths[i]);
+		if (it != m_TexturesMap.end() && it->second.get())
+		{
+			it->second->AddRef();
+			OutTextures[i] = static_cast<ID3D11ShaderResourceView*>(it->second->m_pData);
+		}
+		else
+		{
+			Missing.push_back(i);
+		}
+	}
+
+	// decoding is most of the cost and the device creates resources from any thread, only the map has to wait for the main thread
+	ThreadPool::GetSingletonPtr()->ParallelFor((UINT)Missing.size(), 1u, [&](UINT Begin, UINT End)
+		{
+			for (UINT i = Begin; i < End; i++)
+			{
+				OutTextures[Missing[i]] = Internal_LoadTexture(Filepaths[Missing[i]].c_str());
+			}
+		}, ThreadCount);
+
+	for (UINT i : Missing)
+	{
+		if (OutTextures[i])
+		{
+			m_TexturesMap[Filepaths[i]] = std::make_unique<Resource>(OutTextures[i]);
+		}
+	}
+}
+
 ModelData* ResourceManager::LoadModel(const std::string& ModelPath, const std::string& TexturesPath)
 {
 	auto it = m_ModelsMap.find(ModelPath);
@@ -77,6 +115,27 @@ ModelData* ResourceManager::LoadModel(const std::string& ModelPath, const std::s
 	return pData;
 }
 
+bool ResourceManager::LoadHeightmapData(const std::string& Filepath, std::vector<float>& OutHeights, UINT& OutWidth, UINT& OutHeight)
+{
+	int Width, Height, Channels;
+	unsigned char* ImageData = stbi_load(Filepath.c_str(), &Width, &Height, &Channels, 0);
+	if (!ImageData)
+	{
+		return false;
+	}
+
+	OutHeights.resize((size_t)Width * Height);
+	for (size_t i = 0; i < OutHeights.size(); i++)
+	{
+		OutHeights[i] = (float)ImageData[i * Channels] / 255.f;
+	}
+	OutWidth = (UINT)Width;
+	OutHeight = (UINT)Height;
+
+	stbi_image_free(ImageData);
+	return true;
+}
+
 UINT ResourceManager::UnloadTexture(const std::string& ModelPath)
 {
 	Resource* ResourceToUnload = m_TexturesMap[ModelPath].get();
@@ -6,6 +6,7 @@
 #include <unordered_map>
 #include <string>
 #include <memory>
+#include <vector>
 
 #include "d3d11.h"
 #include "d3dcompiler.h"
@@ -35,7 +36,12 @@ public:
 
 	// these must NOT be stored with a ComPtr and should be unloaded using UnloadTexture when no longer needed
 	ID3D11ShaderResourceView* LoadTexture(const std::string& Filepath);
+	// LoadTexture for every path at once, the ones not loaded yet are decoded and created on up to ThreadCount threads (0 is all of
+	// them). Paths must not repeat, each one takes one reference like LoadTexture
+	void LoadTextures(const std::vector<std::string>& Filepaths, std::vector<ID3D11ShaderResourceView*>& OutTextures, UINT ThreadCount = 0u);
 	ModelData* LoadModel(const std::string& ModelPath, const std::string& TexturesPath);
+	// decodes the red channel of an image on the CPU as 0 to 1 values, the same thing the shaders sample. Not cached
+	bool LoadHeightmapData(const std::string& Filepath, std::vector<float>& OutHeights, UINT& OutWidth, UINT& OutHeight);
 	template <typename T>
 	T* LoadShader(const std::string& Filepath, const std::string& Entry = "main");
 	template <typename T>
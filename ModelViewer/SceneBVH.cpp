@@ -0,0 +1,415 @@
+#include <cassert>
+#include <cmath>
+#include <numeric>
+#include <algorithm>
+
+#include "SceneBVH.h"
+
+// Traversal cost relative to testing a single item, only used to decide when splitting stops paying off
+static const float SAH_TRAVERSAL_COST = 1.f;
+// SAH is allowed to keep a node as a leaf up to this many items if splitting would not make it cheaper
+static const UINT SAH_MAX_LEAF_ITEMS = 16u;
+
+static float GetAxis(const DirectX::XMFLOAT3& v, int Axis)
+{
+	return Axis == 0 ? v.x : Axis == 1 ? v.y : v.z;
+}
+
+static UINT GetBin(float Centroid, float Min, float Scale)
+{
+	return std::min(SceneBVH::BIN_COUNT - 1u, (UINT)((Centroid - Min) * Scale));
+}
+
+// returns false if the bounds are fully outside one of the planes still in the mask. Planes the bounds are fully inside of are
+// removed from the mask so children don't test them again
+static bool ClassifyBounds(const BVHBounds& Bounds, const DirectX::XMFLOAT4* Planes, UINT& Mask)
+{
+	const float cx = (Bounds.Min.x + Bounds.Max.x) * 0.5f;
+	const float cy = (Bounds.Min.y + Bounds.Max.y) * 0.5f;
+	const float cz = (Bounds.Min.z + Bounds.Max.z) * 0.5f;
+	const float ex = (Bounds.Max.x - Bounds.Min.x) * 0.5f;
+	const float ey = (Bounds.Max.y - Bounds.Min.y) * 0.5f;
+	const float ez = (Bounds.Max.z - Bounds.Min.z) * 0.5f;
+
+	for (UINT p = 0u; p < 6u; p++)
+	{
+		if (!(Mask & (1u << p)))
+			continue;
+
+		const DirectX::XMFLOAT4& Plane = Planes[p];
+		float Dist = Plane.x * cx + Plane.y * cy + Plane.z * cz + Plane.w;
+		float Radius = fabsf(Plane.x) * ex + fabsf(Plane.y) * ey + fabsf(Plane.z) * ez;
+
+		if (Dist + Radius < 0.f)
+			return false;
+
+		if (Dist - Radius >= 0.f)
+			Mask &= ~(1u << p);
+	}
+
+	return true;
+}
+
+void BVHBounds::Expand(const BVHBounds& Other)
+{
+	Min = { std::min(Min.x, Other.Min.x), std::min(Min.y, Other.Min.y), std::min(Min.z, Other.Min.z) };
+	Max = { std::max(Max.x, Other.Max.x), std::max(Max.y, Other.Max.y), std::max(Max.z, Other.Max.z) };
+}
+
+void BVHBounds::Expand(const DirectX::XMFLOAT3& Point)
+{
+	Min = { std::min(Min.x, Point.x), std::min(Min.y, Point.y), std::min(Min.z, Point.z) };
+	Max = { std::max(Max.x, Point.x), std::max(Max.y, Point.y), std::max(Max.z, Point.z) };
+}
+
+float BVHBounds::SurfaceArea() const
+{
+	if (Max.x < Min.x)
+		return 0.f;
+
+	float dx = Max.x - Min.x;
+	float dy = Max.y - Min.y;
+	float dz = Max.z - Min.z;
+	return 2.f * (dx * dy + dy * dz + dz * dx);
+}
+
+DirectX::XMFLOAT3 BVHBounds::Center() const
+{
+	return { (Min.x + Max.x) * 0.5f, (Min.y + Max.y) * 0.5f, (Min.z + Max.z) * 0.5f };
+}
+
+bool BVHBounds::operator==(const BVHBounds& Other) const
+{
+	return Min.x == Other.Min.x && Min.y == Other.Min.y && Min.z == Other.Min.z &&
+		Max.x == Other.Max.x && Max.y == Other.Max.y && Max.z == Other.Max.z;
+}
+
+void SceneBVH::Build(const std::vector<BVHBounds>& ItemBounds)
+{
+	Clear();
+
+	const UINT Count = (UINT)ItemBounds.size();
+	if (Count == 0u)
+		return;
+
+	m_ItemBounds = ItemBounds;
+	m_ItemCenters.resize(Count);
+	for (UINT i = 0u; i < Count; i++)
+	{
+		m_ItemCenters[i] = m_ItemBounds[i].Center();
+	}
+
+	m_ItemIndices.resize(Count);
+	std::iota(m_ItemIndices.begin(), m_ItemIndices.end(), 0u);
+	m_ItemLeaf.resize(Count);
+
+	m_Nodes.reserve(2u * Count);
+	m_Nodes.push_back({ {}, 0u, Count, INVALID_NODE, INVALID_NODE });
+	RecalcNodeBounds(0u);
+
+	std::vector<UINT> Stack = { 0u };
+	while (!Stack.empty())
+	{
+		UINT NodeIndex = Stack.back();
+		Stack.pop_back();
+
+		if (Subdivide(NodeIndex))
+		{
+			Stack.push_back(m_Nodes[NodeIndex].LeftChild);
+			Stack.push_back(m_Nodes[NodeIndex].LeftChild + 1u);
+			continue;
+		}
+
+		const Node& Leaf = m_Nodes[NodeIndex];
+		for (UINT i = Leaf.FirstItem; i < Leaf.FirstItem + Leaf.ItemCount; i++)
+		{
+			m_ItemLeaf[m_ItemIndices[i]] = NodeIndex;
+		}
+	}
+
+	m_LeafDirty.assign(m_Nodes.size(), false);
+}
+
+void SceneBVH::Clear()
+{
+	m_Nodes.clear();
+	m_ItemBounds.clear();
+	m_ItemCenters.clear();
+	m_ItemIndices.clear();
+	m_ItemLeaf.clear();
+	m_DirtyLeaves.clear();
+	m_LeafDirty.clear();
+	m_ItemsMovedSinceBuild = 0u;
+	m_LastNodesVisited = 0u;
+}
+
+bool SceneBVH::UpdateItem(UINT Item, const BVHBounds& Bounds)
+{
+	assert(Item < m_ItemBounds.size());
+
+	if (m_ItemBounds[Item] == Bounds)
+		return false;
+
+	m_ItemBounds[Item] = Bounds;
+	m_ItemCenters[Item] = Bounds.Center();
+	m_ItemsMovedSinceBuild++;
+
+	UINT Leaf = m_ItemLeaf[Item];
+	if (!m_LeafDirty[Leaf])
+	{
+		m_LeafDirty[Leaf] = true;
+		m_DirtyLeaves.push_back(Leaf);
+	}
+
+	return true;
+}
+
+void SceneBVH::Refit()
+{
+	if (m_DirtyLeaves.empty())
+		return;
+
+	// past a certain point walking up from every leaf is more work than just refitting everything.
+	// children are always created after their parent, so going backwards visits them first
+	if (m_DirtyLeaves.size() * 4u > m_Nodes.size())
+	{
+		for (UINT i = (UINT)m_Nodes.size(); i-- > 0u;)
+		{
+			RecalcNodeBounds(i);
+		}
+	}
+	else
+	{
+		for (UINT Leaf : m_DirtyLeaves)
+		{
+			UINT NodeIndex = Leaf;
+			while (NodeIndex != INVALID_NODE)
+			{
+				BVHBounds Old = m_Nodes[NodeIndex].Bounds;
+				RecalcNodeBounds(NodeIndex);
+
+				// nothing above this can change because of this leaf
+				if (Old == m_Nodes[NodeIndex].Bounds)
+					break;
+
+				NodeIndex = m_Nodes[NodeIndex].Parent;
+			}
+		}
+	}
+
+	for (UINT Leaf : m_DirtyLeaves)
+	{
+		m_LeafDirty[Leaf] = false;
+	}
+	m_DirtyLeaves.clear();
+}
+
+void SceneBVH::QueryFrustum(const Frustum& ViewFrustum, std::vector<UINT>& OutItems) const
+{
+	const DirectX::XMFLOAT4* Planes = ViewFrustum.GetPlanes();
+	m_LastNodesVisited = 0u;
+	if (m_Nodes.empty())
+		return;
+
+	struct StackEntry
+	{
+		UINT NodeIndex;
+		UINT PlaneMask;
+	};
+
+	std::vector<StackEntry> Stack;
+	Stack.reserve(64u);
+	Stack.push_back({ 0u, 0x3F });
+
+	while (!Stack.empty())
+	{
+		StackEntry Entry = Stack.back();
+		Stack.pop_back();
+		m_LastNodesVisited++;
+
+		const Node& N = m_Nodes[Entry.NodeIndex];
+		if (!ClassifyBounds(N.Bounds, Planes, Entry.PlaneMask))
+			continue;
+
+		// fully inside, take the whole subtree
+		if (Entry.PlaneMask == 0u)
+		{
+			OutItems.insert(OutItems.end(), m_ItemIndices.begin() + N.FirstItem, m_ItemIndices.begin() + N.FirstItem + N.ItemCount);
+			continue;
+		}
+
+		if (N.IsLeaf())
+		{
+			for (UINT i = N.FirstItem; i < N.FirstItem + N.ItemCount; i++)
+			{
+				UINT Mask = Entry.PlaneMask;
+				if (ClassifyBounds(m_ItemBounds[m_ItemIndices[i]], Planes, Mask))
+				{
+					OutItems.push_back(m_ItemIndices[i]);
+				}
+			}
+			continue;
+		}
+
+		Stack.push_back({ N.LeftChild + 1u, Entry.PlaneMask });
+		Stack.push_back({ N.LeftChild, Entry.PlaneMask });
+	}
+}
+
+float SceneBVH::ComputeSAHCost() const
+{
+	if (m_Nodes.empty() || m_Nodes[0].Bounds.SurfaceArea() <= 0.f)
+		return 0.f;
+
+	float Cost = 0.f;
+	for (const Node& N : m_Nodes)
+	{
+		Cost += N.Bounds.SurfaceArea() * (N.IsLeaf() ? (float)N.ItemCount : SAH_TRAVERSAL_COST);
+	}
+
+	return Cost / m_Nodes[0].Bounds.SurfaceArea();
+}
+
+BVHBounds SceneBVH::TransformBounds(const AABB& LocalBounds, const DirectX::XMMATRIX& World)
+{
+	DirectX::XMVECTOR Min = DirectX::XMLoadFloat3(&LocalBounds.Min);
+	DirectX::XMVECTOR Max = DirectX::XMLoadFloat3(&LocalBounds.Max);
+	DirectX::XMVECTOR Center = DirectX::XMVectorScale(DirectX::XMVectorAdd(Min, Max), 0.5f);
+	DirectX::XMVECTOR Extent = DirectX::XMVectorScale(DirectX::XMVectorSubtract(Max, Min), 0.5f);
+
+	// world space extent of an oriented box is the sum of its axes projected onto each world axis
+	DirectX::XMVECTOR WorldCenter = DirectX::XMVector3TransformCoord(Center, World);
+	DirectX::XMVECTOR WorldExtent = DirectX::XMVectorScale(DirectX::XMVectorAbs(World.r[0]), DirectX::XMVectorGetX(Extent));
+	WorldExtent = DirectX::XMVectorMultiplyAdd(DirectX::XMVectorAbs(World.r[1]), DirectX::XMVectorSplatY(Extent), WorldExtent);
+	WorldExtent = DirectX::XMVectorMultiplyAdd(DirectX::XMVectorAbs(World.r[2]), DirectX::XMVectorSplatZ(Extent), WorldExtent);
+
+	BVHBounds Bounds;
+	DirectX::XMStoreFloat3(&Bounds.Min, DirectX::XMVectorSubtract(WorldCenter, WorldExtent));
+	DirectX::XMStoreFloat3(&Bounds.Max, DirectX::XMVectorAdd(WorldCenter, WorldExtent));
+	return Bounds;
+}
+
+bool SceneBVH::Subdivide(UINT NodeIndex)
+{
+	const UINT First = m_Nodes[NodeIndex].FirstItem;
+	const UINT Count = m_Nodes[NodeIndex].ItemCount;
+
+	if (Count <= MAX_LEAF_ITEMS)
+		return false;
+
+	BVHBounds CentroidBounds;
+	for (UINT i = First; i < First + Count; i++)
+	{
+		CentroidBounds.Expand(m_ItemCenters[m_ItemIndices[i]]);
+	}
+
+	struct Bin
+	{
+		BVHBounds Bounds;
+		UINT Count = 0u;
+	};
+
+	float BestCost = FLT_MAX;
+	int BestAxis = -1;
+	UINT BestSplit = 0u;
+
+	for (int Axis = 0; Axis < 3; Axis++)
+	{
+		const float Min = GetAxis(CentroidBounds.Min, Axis);
+		const float Extent = GetAxis(CentroidBounds.Max, Axis) - Min;
+		if (Extent <= 0.f)
+			continue;
+
+		const float Scale = (float)BIN_COUNT / Extent;
+		Bin Bins[BIN_COUNT];
+		for (UINT i = First; i < First + Count; i++)
+		{
+			UINT Item = m_ItemIndices[i];
+			Bin& B = Bins[GetBin(GetAxis(m_ItemCenters[Item], Axis), Min, Scale)];
+			B.Bounds.Expand(m_ItemBounds[Item]);
+			B.Count++;
+		}
+
+		// sweep from the right first so the left sweep can evaluate every split in one pass
+		float RightArea[BIN_COUNT - 1];
+		UINT RightCount[BIN_COUNT - 1];
+		BVHBounds Accumulated;
+		UINT AccumulatedCount = 0u;
+		for (UINT b = BIN_COUNT - 1u; b > 0u; b--)
+		{
+			Accumulated.Expand(Bins[b].Bounds);
+			AccumulatedCount += Bins[b].Count;
+			RightArea[b - 1u] = Accumulated.SurfaceArea();
+			RightCount[b - 1u] = AccumulatedCount;
+		}
+
+		Accumulated = {};
+		AccumulatedCount = 0u;
+		for (UINT b = 0u; b < BIN_COUNT - 1u; b++)
+		{
+			Accumulated.Expand(Bins[b].Bounds);
+			AccumulatedCount += Bins[b].Count;
+			if (AccumulatedCount == 0u || RightCount[b] == 0u)
+				continue;
+
+			float Cost = Accumulated.SurfaceArea() * (float)AccumulatedCount + RightArea[b] * (float)RightCount[b];
+			if (Cost < BestCost)
+			{
+				BestCost = Cost;
+				BestAxis = Axis;
+				BestSplit = b;
+			}
+		}
+	}
+
+	UINT LeftCount = 0u;
+	const float NodeArea = m_Nodes[NodeIndex].Bounds.SurfaceArea();
+	if (BestAxis >= 0)
+	{
+		const float SplitCost = SAH_TRAVERSAL_COST + (NodeArea > 0.f ? BestCost / NodeArea : 0.f);
+		if (SplitCost >= (float)Count && Count <= SAH_MAX_LEAF_ITEMS)
+			return false;
+
+		const float Min = GetAxis(CentroidBounds.Min, BestAxis);
+		const float Scale = (float)BIN_COUNT / (GetAxis(CentroidBounds.Max, BestAxis) - Min);
+		auto Middle = std::partition(m_ItemIndices.begin() + First, m_ItemIndices.begin() + First + Count, [&](UINT Item)
+			{
+				return GetBin(GetAxis(m_ItemCenters[Item], BestAxis), Min, Scale) <= BestSplit;
+			});
+		LeftCount = (UINT)(Middle - (m_ItemIndices.begin() + First));
+	}
+
+	// every centroid in the same spot (or binning fell apart), split down the middle of the range instead
+	if (LeftCount == 0u || LeftCount == Count)
+	{
+		LeftCount = Count / 2u;
+	}
+
+	const UINT LeftChild = (UINT)m_Nodes.size();
+	m_Nodes.push_back({ {}, First, LeftCount, INVALID_NODE, NodeIndex });
+	m_Nodes.push_back({ {}, First + LeftCount, Count - LeftCount, INVALID_NODE, NodeIndex });
+	m_Nodes[NodeIndex].LeftChild = LeftChild;
+
+	RecalcNodeBounds(LeftChild);
+	RecalcNodeBounds(LeftChild + 1u);
+
+	return true;
+}
+
+void SceneBVH::RecalcNodeBounds(UINT NodeIndex)
+{
+	Node& N = m_Nodes[NodeIndex];
+	N.Bounds = {};
+
+	if (N.IsLeaf())
+	{
+		for (UINT i = N.FirstItem; i < N.FirstItem + N.ItemCount; i++)
+		{
+			N.Bounds.Expand(m_ItemBounds[m_ItemIndices[i]]);
+		}
+		return;
+	}
+
+	N.Bounds.Expand(m_Nodes[N.LeftChild].Bounds);
+	N.Bounds.Expand(m_Nodes[N.LeftChild + 1u].Bounds);
+}
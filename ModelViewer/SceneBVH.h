@@ -0,0 +1,95 @@
+#pragma once
+
+#ifndef SCENE_BVH_H
+#define SCENE_BVH_H
+
+#include <cfloat>
+#include <vector>
+
+#include "DirectXMath.h"
+
+#include "AABB.h"
+#include "Frustum.h"
+
+typedef unsigned int UINT;
+
+struct BVHBounds
+{
+	DirectX::XMFLOAT3 Min = {  FLT_MAX,  FLT_MAX,  FLT_MAX };
+	DirectX::XMFLOAT3 Max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+	void Expand(const BVHBounds& Other);
+	void Expand(const DirectX::XMFLOAT3& Point);
+	float SurfaceArea() const;
+	DirectX::XMFLOAT3 Center() const;
+
+	bool operator==(const BVHBounds& Other) const;
+};
+
+/*
+*	Bounding volume hierarchy over world space item bounds, built top down with binned SAH. Items in a subtree are kept contiguous
+*	so a node that is fully inside the frustum can append its whole item range without visiting children. Moving a few items only
+*	refits the leaves they live in and walks up to the root, a full rebuild is only needed when items are added or removed or the
+*	tree has degraded from too much movement. Pure CPU, no device needed.
+*/
+
+class SceneBVH
+{
+private:
+	struct Node
+	{
+		BVHBounds Bounds;
+		UINT FirstItem;
+		UINT ItemCount;
+		UINT LeftChild;		// right child is always LeftChild + 1, INVALID_NODE for leaves
+		UINT Parent;
+
+		bool IsLeaf() const { return LeftChild == INVALID_NODE; }
+	};
+
+public:
+	static const UINT INVALID_NODE = 0xFFFFFFFF;
+	static const UINT MAX_LEAF_ITEMS = 4u;
+	static const UINT BIN_COUNT = 16u;
+
+public:
+	void Build(const std::vector<BVHBounds>& ItemBounds);
+	void Clear();
+
+	// returns true if the bounds actually changed, the tree is not touched until Refit is called
+	bool UpdateItem(UINT Item, const BVHBounds& Bounds);
+	void Refit();
+
+	// appends visible item indices to OutItems
+	void QueryFrustum(const Frustum& ViewFrustum, std::vector<UINT>& OutItems) const;
+
+	float ComputeSAHCost() const;
+	bool ShouldRebuild() const { return m_ItemsMovedSinceBuild > (UINT)m_ItemBounds.size(); }
+
+	UINT GetItemCount() const { return (UINT)m_ItemBounds.size(); }
+	UINT GetNodeCount() const { return (UINT)m_Nodes.size(); }
+	UINT GetLastNodesVisited() const { return m_LastNodesVisited; }
+	const BVHBounds& GetItemBounds(UINT Item) const { return m_ItemBounds[Item]; }
+
+	// World is the regular (non transposed) world matrix
+	static BVHBounds TransformBounds(const AABB& LocalBounds, const DirectX::XMMATRIX& World);
+
+private:
+	bool Subdivide(UINT NodeIndex);
+	void RecalcNodeBounds(UINT NodeIndex);
+
+private:
+	std::vector<Node> m_Nodes;
+	std::vector<BVHBounds> m_ItemBounds;
+	std::vector<DirectX::XMFLOAT3> m_ItemCenters;
+	std::vector<UINT> m_ItemIndices;		// leaf order, nodes reference ranges of this
+	std::vector<UINT> m_ItemLeaf;
+	std::vector<UINT> m_DirtyLeaves;
+	std::vector<bool> m_LeafDirty;
+
+	UINT m_ItemsMovedSinceBuild = 0u;
+	mutable UINT m_LastNodesVisited = 0u;
+
+};
+
+#endif
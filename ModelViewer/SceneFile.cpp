@@ -0,0 +1,354 @@
+#include <fstream>
+#include <cstring>
+
+#include <Windows.h>
+
+#include "SceneFile.h"
+#include "GameObject.h"
+#include "Model.h"
+#include "Light.h"
+
+static_assert(sizeof(SceneFileHeader) % 4 == 0 && sizeof(SceneNodeRecord) % 4 == 0 && sizeof(ScenePostProcessRecord) % 4 == 0,
+	"scene file records have to keep the sections 4 byte aligned");
+
+static const char SCENE_FILE_MAGIC[4] = { 'M', 'V', 'S', 'C' };
+
+SceneFile::SceneFile()
+{
+	m_FileHandle = INVALID_HANDLE_VALUE;
+	m_MappingHandle = nullptr;
+	m_View = nullptr;
+
+	// offset 0 is the empty string
+	m_WriteStrings.push_back('\0');
+	m_StringOffsets[""] = 0u;
+}
+
+SceneFile::~SceneFile()
+{
+	Close();
+}
+
+UINT SceneFile::AddString(const std::string& String)
+{
+	// model paths repeat for every instance, each one is stored once
+	auto It = m_StringOffsets.find(String);
+	if (It != m_StringOffsets.end())
+		return It->second;
+
+	const UINT Offset = (UINT)m_WriteStrings.size();
+	m_WriteStrings.insert(m_WriteStrings.end(), String.begin(), String.end());
+	m_WriteStrings.push_back('\0');
+	m_StringOffsets.emplace(String, Offset);
+	return Offset;
+}
+
+UINT SceneFile::AddNode(SceneNodeType Type, UINT Parent, const std::string& Name, const Component* Source)
+{
+	SceneNodeRecord Node = {};
+	Node.Type = (UINT)Type;
+	Node.Parent = Parent;
+	Node.Name = AddString(Name);
+	Node.bActive = 1u;
+	Node.Scale = { 1.f, 1.f, 1.f };
+	Node.Color = { 1.f, 1.f, 1.f };
+	Node.SpecularPower = 256.f;
+
+	if (Source)
+	{
+		const Transform T = Source->GetTransform();
+		Node.Position = T.Position;
+		Node.Rotation = T.Rotation;
+		Node.Scale = T.Scale;
+	}
+
+	if (Type == SceneNodeType::Model && Source)
+	{
+		const Model* pModel = static_cast<const Model*>(Source);
+		Node.ModelPath = AddString(pModel->GetModelPath());
+		Node.TexturesPath = AddString(pModel->GetTexturesPath());
+		Node.bActive = pModel->GetShouldRender() ? 1u : 0u;
+	}
+	else if ((Type == SceneNodeType::PointLight || Type == SceneNodeType::DirectionalLight) && Source)
+	{
+		const Light* pLight = static_cast<const Light*>(Source);
+		Node.Color = pLight->GetDiffuseColor();
+		Node.SpecularPower = pLight->GetSpecularPower();
+		Node.bActive = pLight->IsActive() ? 1u : 0u;
+
+		if (Type == SceneNodeType::PointLight)
+			Node.Radius = static_cast<const PointLight*>(Source)->GetRadius();
+		else
+			Node.Direction = static_cast<const DirectionalLight*>(Source)->GetDirection();
+	}
+
+	m_WriteNodes.push_back(Node);
+	return (UINT)m_WriteNodes.size() - 1u;
+}
+
+UINT SceneFile::AddGameObject(const GameObject* Object, SceneNodeType Type)
+{
+	const UINT Node = AddNode(Type, INVALID_SCENE_NODE, Object->GetName(), Object);
+	AddComponents(Object, Node);
+	return Node;
+}
+
+void SceneFile::AddComponents(const Component* Owner, UINT OwnerNode)
+{
+	for (const Component* Comp : Owner->GetComponents())
+	{
+		SceneNodeType Type;
+		switch (Comp->GetType())
+		{
+		case ComponentType::Model:				Type = SceneNodeType::Model; break;
+		case ComponentType::PointLight:			Type = SceneNodeType::PointLight; break;
+		case ComponentType::DirectionalLight:	Type = SceneNodeType::DirectionalLight; break;
+		default:
+			// nothing the loader could construct again
+			continue;
+		}
+
+		const UINT Node = AddNode(Type, OwnerNode, "", Comp);
+		AddComponents(Comp, Node);
+	}
+}
+
+void SceneFile::AddPostProcess(const std::string& Name, bool bActive)
+{
+	m_WritePostProcesses.push_back({ AddString(Name), bActive ? 1u : 0u });
+}
+
+void SceneFile::SetNodeTransform(UINT Node, const DirectX::XMFLOAT3& Position, const DirectX::XMFLOAT3& Rotation, const DirectX::XMFLOAT3& Scale)
+{
+	m_WriteNodes[Node].Position = Position;
+	m_WriteNodes[Node].Rotation = Rotation;
+	m_WriteNodes[Node].Scale = Scale;
+}
+
+void SceneFile::SetNodeModel(UINT Node, const std::string& ModelPath, const std::string& TexturesPath)
+{
+	m_WriteNodes[Node].ModelPath = AddString(ModelPath);
+	m_WriteNodes[Node].TexturesPath = AddString(TexturesPath);
+}
+
+void SceneFile::SetNodeLight(UINT Node, const DirectX::XMFLOAT3& Color, float Radius, const DirectX::XMFLOAT3& Direction)
+{
+	m_WriteNodes[Node].Color = Color;
+	m_WriteNodes[Node].Radius = Radius;
+	m_WriteNodes[Node].Direction = Direction;
+}
+
+bool SceneFile::Save(const std::string& Filepath) const
+{
+	SceneFileHeader Header = {};
+	memcpy(Header.Magic, SCENE_FILE_MAGIC, sizeof(Header.Magic));
+	Header.Version = SCENE_FILE_VERSION;
+	Header.NodeCount = (UINT)m_WriteNodes.size();
+	Header.NodeOffset = (UINT)sizeof(SceneFileHeader);
+	Header.PostProcessCount = (UINT)m_WritePostProcesses.size();
+	Header.PostProcessOffset = Header.NodeOffset + Header.NodeCount * (UINT)sizeof(SceneNodeRecord);
+	Header.StringBytes = (UINT)m_WriteStrings.size();
+	Header.StringOffset = Header.PostProcessOffset + Header.PostProcessCount * (UINT)sizeof(ScenePostProcessRecord);
+
+	std::ofstream File(Filepath, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!File.is_open())
+		return false;
+
+	File.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+	File.write(reinterpret_cast<const char*>(m_WriteNodes.data()), sizeof(SceneNodeRecord) * m_WriteNodes.size());
+	File.write(reinterpret_cast<const char*>(m_WritePostProcesses.data()), sizeof(ScenePostProcessRecord) * m_WritePostProcesses.size());
+	File.write(m_WriteStrings.data(), m_WriteStrings.size());
+
+	return File.good();
+}
+
+bool SceneFile::Open(const std::string& Filepath)
+{
+	Close();
+
+	HANDLE File = CreateFileA(Filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (File == INVALID_HANDLE_VALUE)
+		return false;
+	m_FileHandle = File;
+
+	LARGE_INTEGER Size;
+	if (!GetFileSizeEx(File, &Size) || Size.QuadPart < (LONGLONG)sizeof(SceneFileHeader))
+	{
+		Close();
+		return false;
+	}
+
+	m_MappingHandle = CreateFileMappingA(File, nullptr, PAGE_READONLY, 0u, 0u, nullptr);
+	if (!m_MappingHandle)
+	{
+		Close();
+		return false;
+	}
+
+	m_View = MapViewOfFile(m_MappingHandle, FILE_MAP_READ, 0u, 0u, 0u);
+	if (!m_View || !Validate(static_cast<const unsigned char*>(m_View), (size_t)Size.QuadPart))
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void SceneFile::Close()
+{
+	m_Nodes = nullptr;
+	m_PostProcesses = nullptr;
+	m_Strings = nullptr;
+	m_NodeCount = 0u;
+	m_PostProcessCount = 0u;
+
+	if (m_View)
+	{
+		UnmapViewOfFile(m_View);
+		m_View = nullptr;
+	}
+	if (m_MappingHandle)
+	{
+		CloseHandle(m_MappingHandle);
+		m_MappingHandle = nullptr;
+	}
+	if (m_FileHandle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_FileHandle);
+		m_FileHandle = INVALID_HANDLE_VALUE;
+	}
+}
+
+bool SceneFile::Validate(const unsigned char* Data, size_t Size)
+{
+	// everything is checked here once, the records are used as they are after this
+	const SceneFileHeader* Header = reinterpret_cast<const SceneFileHeader*>(Data);
+	if (memcmp(Header->Magic, SCENE_FILE_MAGIC, sizeof(Header->Magic)) != 0 || Header->Version != SCENE_FILE_VERSION)
+		return false;
+
+	auto SectionFits = [Size](UINT Offset, UINT Count, size_t Stride)
+	{
+		return Offset % 4u == 0u && (unsigned long long)Offset + (unsigned long long)Count * Stride <= (unsigned long long)Size;
+	};
+	if (!SectionFits(Header->NodeOffset, Header->NodeCount, sizeof(SceneNodeRecord)) ||
+		!SectionFits(Header->PostProcessOffset, Header->PostProcessCount, sizeof(ScenePostProcessRecord)) ||
+		!SectionFits(Header->StringOffset, Header->StringBytes, 1u) || Header->StringBytes == 0u)
+		return false;
+
+	const char* Strings = reinterpret_cast<const char*>(Data + Header->StringOffset);
+	if (Strings[Header->StringBytes - 1u] != '\0')
+		return false;
+
+	const SceneNodeRecord* Nodes = reinterpret_cast<const SceneNodeRecord*>(Data + Header->NodeOffset);
+	for (UINT i = 0u; i < Header->NodeCount; i++)
+	{
+		const SceneNodeRecord& N = Nodes[i];
+		if (N.Type > (UINT)SceneNodeType::Camera || (N.Parent != INVALID_SCENE_NODE && N.Parent >= i) ||
+			N.Name >= Header->StringBytes || N.ModelPath >= Header->StringBytes || N.TexturesPath >= Header->StringBytes)
+			return false;
+	}
+
+	const ScenePostProcessRecord* PostProcesses = reinterpret_cast<const ScenePostProcessRecord*>(Data + Header->PostProcessOffset);
+	for (UINT i = 0u; i < Header->PostProcessCount; i++)
+	{
+		if (PostProcesses[i].Name >= Header->StringBytes)
+			return false;
+	}
+
+	m_Nodes = Nodes;
+	m_PostProcesses = PostProcesses;
+	m_Strings = Strings;
+	m_NodeCount = Header->NodeCount;
+	m_PostProcessCount = Header->PostProcessCount;
+	return true;
+}
+
+void SceneFile::Instantiate(ObjectPool<GameObject>& Pool, std::vector<PoolHandle>* OutHandles) const
+{
+	UINT RootCount = 0u;
+	for (UINT i = 0u; i < m_NodeCount; i++)
+	{
+		RootCount += m_Nodes[i].Type == (UINT)SceneNodeType::GameObject ? 1u : 0u;
+	}
+	Pool.Reserve(Pool.GetCount() + RootCount);
+	if (OutHandles)
+	{
+		OutHandles->reserve(OutHandles->size() + RootCount);
+	}
+
+	// null for camera nodes, their subtrees are skipped with them
+	std::vector<Component*> Created(m_NodeCount, nullptr);
+	for (UINT i = 0u; i < m_NodeCount; i++)
+	{
+		const SceneNodeRecord& N = m_Nodes[i];
+		Component* Parent = N.Parent != INVALID_SCENE_NODE ? Created[N.Parent] : nullptr;
+
+		Component* Comp = nullptr;
+		switch ((SceneNodeType)N.Type)
+		{
+		case SceneNodeType::GameObject:
+		{
+			if (N.Parent != INVALID_SCENE_NODE)
+				continue;
+
+			const PoolHandle Handle = Pool.Create();
+			GameObject* Object = Pool.Get(Handle);
+			Object->SetName(GetString(N.Name));
+			Created[i] = Object;
+			if (OutHandles)
+			{
+				OutHandles->push_back(Handle);
+			}
+			break;
+		}
+		case SceneNodeType::Model:
+		{
+			if (!Parent)
+				continue;
+
+			Model* pModel = Parent->AddComponent<Model>(GetString(N.ModelPath), GetString(N.TexturesPath));
+			pModel->SetShouldRender(N.bActive != 0u);
+			Comp = pModel;
+			break;
+		}
+		case SceneNodeType::PointLight:
+		{
+			if (!Parent)
+				continue;
+
+			PointLight* pLight = Parent->AddComponent<PointLight>();
+			pLight->SetRadius(N.Radius);
+			Comp = pLight;
+			break;
+		}
+		case SceneNodeType::DirectionalLight:
+		{
+			if (!Parent)
+				continue;
+
+			DirectionalLight* pLight = Parent->AddComponent<DirectionalLight>();
+			pLight->SetDirection(N.Direction.x, N.Direction.y, N.Direction.z);
+			Comp = pLight;
+			break;
+		}
+		default:
+			continue;
+		}
+
+		if (Comp)
+		{
+			if (N.Type != (UINT)SceneNodeType::Model)
+			{
+				Light* pLight = static_cast<Light*>(Comp);
+				pLight->SetDiffuseColor(N.Color.x, N.Color.y, N.Color.z);
+				pLight->SetSpecularPower(N.SpecularPower);
+				pLight->SetActive(N.bActive != 0u);
+			}
+
+			Created[i] = Comp;
+		}
+
+		Created[i]->SetTransform({ N.Position, N.Rotation, N.Scale });
+	}
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#ifndef SCENE_FILE_H
+#define SCENE_FILE_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "DirectXMath.h"
+
+#include "ObjectPool.h"
+
+typedef unsigned int UINT;
+
+class GameObject;
+class Component;
+
+const UINT SCENE_FILE_VERSION = 1u;
+const UINT INVALID_SCENE_NODE = 0xFFFFFFFF;
+
+enum class SceneNodeType : UINT
+{
+	GameObject,
+	Model,
+	PointLight,
+	DirectionalLight,
+	Camera
+};
+
+// every section starts at its offset from the start of the file, all offsets are 4 byte aligned
+struct SceneFileHeader
+{
+	char Magic[4];
+	UINT Version;
+	UINT NodeCount;
+	UINT NodeOffset;
+	UINT PostProcessCount;
+	UINT PostProcessOffset;
+	UINT StringBytes;
+	UINT StringOffset;
+};
+
+// one record for every node type, the fields a type does not use are left zero. Strings are offsets into the string table, 0 is ""
+struct SceneNodeRecord
+{
+	UINT Type;
+	UINT Parent;			// index of an earlier node, INVALID_SCENE_NODE for roots
+	UINT Name;
+	UINT ModelPath;
+	UINT TexturesPath;
+	UINT bActive;
+	DirectX::XMFLOAT3 Position;
+	DirectX::XMFLOAT3 Rotation;
+	DirectX::XMFLOAT3 Scale;
+	DirectX::XMFLOAT3 Color;
+	DirectX::XMFLOAT3 Direction;
+	float SpecularPower;
+	float Radius;
+};
+
+struct ScenePostProcessRecord
+{
+	UINT Name;
+	UINT bActive;
+};
+
+/*
+*	Versioned binary scene file. The file is a header followed by flat arrays of fixed size records and one string table, written in
+*	the exact layout they are read back in. Open memory maps the file, checks the header and the section bounds once and then hands
+*	out the records straight from the mapping, there is no per field parsing. Instantiate builds the GameObjects, models and lights
+*	in one pass over the node array, parents always come before their children. Cameras and post processes depend on the device so
+*	the Application applies those records itself.
+*/
+
+class SceneFile
+{
+public:
+	SceneFile();
+	~SceneFile();
+	SceneFile(const SceneFile& Other) = delete;
+
+	// writing, nodes are appended in the order they will be instantiated
+	UINT AddNode(SceneNodeType Type, UINT Parent, const std::string& Name, const Component* Source);
+	// the object and its model and light components, recursively
+	UINT AddGameObject(const GameObject* Object, SceneNodeType Type = SceneNodeType::GameObject);
+	void AddPostProcess(const std::string& Name, bool bActive);
+	// for nodes added without a source component, generated content
+	void SetNodeTransform(UINT Node, const DirectX::XMFLOAT3& Position, const DirectX::XMFLOAT3& Rotation, const DirectX::XMFLOAT3& Scale);
+	void SetNodeModel(UINT Node, const std::string& ModelPath, const std::string& TexturesPath);
+	void SetNodeLight(UINT Node, const DirectX::XMFLOAT3& Color, float Radius, const DirectX::XMFLOAT3& Direction);
+	bool Save(const std::string& Filepath) const;
+
+	// reading, the records stay valid until Close or the next Open
+	bool Open(const std::string& Filepath);
+	void Close();
+	void Instantiate(ObjectPool<GameObject>& Pool, std::vector<PoolHandle>* OutHandles = nullptr) const;
+
+	UINT GetNodeCount() const { return m_NodeCount; }
+	const SceneNodeRecord& GetNode(UINT Index) const { return m_Nodes[Index]; }
+	UINT GetPostProcessCount() const { return m_PostProcessCount; }
+	const ScenePostProcessRecord& GetPostProcess(UINT Index) const { return m_PostProcesses[Index]; }
+	const char* GetString(UINT Offset) const { return m_Strings + Offset; }
+
+private:
+	UINT AddString(const std::string& String);
+	void AddComponents(const Component* Owner, UINT OwnerNode);
+	bool Validate(const unsigned char* Data, size_t Size);
+
+private:
+	// what Open points into, either the mapped file or the records added for writing
+	const SceneNodeRecord* m_Nodes = nullptr;
+	const ScenePostProcessRecord* m_PostProcesses = nullptr;
+	const char* m_Strings = nullptr;
+	UINT m_NodeCount = 0u;
+	UINT m_PostProcessCount = 0u;
+
+	std::vector<SceneNodeRecord> m_WriteNodes;
+	std::vector<ScenePostProcessRecord> m_WritePostProcesses;
+	std::vector<char> m_WriteStrings;
+	std::unordered_map<std::string, UINT> m_StringOffsets;
+
+	void* m_FileHandle;
+	void* m_MappingHandle;
+	const void* m_View;
+
+};
+
+#endif
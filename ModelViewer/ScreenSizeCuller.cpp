@@ -0,0 +1,88 @@
+#include <cfloat>
+#include <cmath>
+
+#include "ScreenSizeCuller.h"
+
+ScreenSizeCuller::ScreenSizeCuller()
+{
+	m_CameraPos = { 0.f, 0.f, 0.f };
+	m_PixelScale = 1.f;
+	m_MinPixelRadius = 0.f;
+}
+
+void ScreenSizeCuller::SetView(const DirectX::XMFLOAT3& CameraPos, float PixelScale, float MinPixelRadius)
+{
+	m_CameraPos = CameraPos;
+	m_PixelScale = PixelScale;
+	m_MinPixelRadius = MinPixelRadius;
+}
+
+UINT ScreenSizeCuller::Cull(const DirectX::XMMATRIX* Transforms, const AABB& BBox, const std::vector<UINT>& Indices, std::vector<UINT>& OutIndices)
+{
+	OutIndices.clear();
+	m_ProjectedRadii.clear();
+
+	for (UINT i : Indices)
+	{
+		DirectX::XMFLOAT3 Center;
+		float Radius;
+		GetBoundingSphere(BBox, Transforms[i], Center, Radius);
+
+		const float dx = Center.x - m_CameraPos.x;
+		const float dy = Center.y - m_CameraPos.y;
+		const float dz = Center.z - m_CameraPos.z;
+		const float PixelRadius = ProjectSphereRadius(Radius, sqrtf(dx * dx + dy * dy + dz * dz), m_PixelScale);
+
+		if (PixelRadius >= m_MinPixelRadius)
+		{
+			OutIndices.push_back(i);
+			m_ProjectedRadii.push_back(PixelRadius);
+		}
+	}
+
+	return (UINT)(Indices.size() - OutIndices.size());
+}
+
+float ScreenSizeCuller::ComputePixelScale(const DirectX::XMMATRIX& Proj, float ViewportHeight)
+{
+	DirectX::XMFLOAT4X4 p;
+	DirectX::XMStoreFloat4x4(&p, Proj);
+	return p.m[1][1] * ViewportHeight * 0.5f;
+}
+
+float ScreenSizeCuller::ProjectSphereRadius(float Radius, float Distance, float PixelScale)
+{
+	// the silhouette is the cone tangent to the sphere, its half angle has sin = r / d so tan = r / sqrt(d^2 - r^2)
+	const float Denom = Distance * Distance - Radius * Radius;
+	if (Denom <= 0.f)
+		return FLT_MAX;
+
+	return Radius / sqrtf(Denom) * PixelScale;
+}
+
+void ScreenSizeCuller::GetBoundingSphere(const AABB& BBox, const DirectX::XMMATRIX& Transform, DirectX::XMFLOAT3& OutCenter, float& OutRadius)
+{
+	const float cx = (BBox.Min.x + BBox.Max.x) * 0.5f;
+	const float cy = (BBox.Min.y + BBox.Max.y) * 0.5f;
+	const float cz = (BBox.Min.z + BBox.Max.z) * 0.5f;
+	const float ex = (BBox.Max.x - BBox.Min.x) * 0.5f;
+	const float ey = (BBox.Max.y - BBox.Min.y) * 0.5f;
+	const float ez = (BBox.Max.z - BBox.Min.z) * 0.5f;
+
+	// transposed, so column n is local axis n in world space and its length is the scale along it
+	DirectX::XMFLOAT4X4 m;
+	DirectX::XMStoreFloat4x4(&m, Transform);
+
+	OutCenter.x = m.m[0][0] * cx + m.m[0][1] * cy + m.m[0][2] * cz + m.m[0][3];
+	OutCenter.y = m.m[1][0] * cx + m.m[1][1] * cy + m.m[1][2] * cz + m.m[1][3];
+	OutCenter.z = m.m[2][0] * cx + m.m[2][1] * cy + m.m[2][2] * cz + m.m[2][3];
+
+	float MaxScaleSq = 0.f;
+	for (int Axis = 0; Axis < 3; Axis++)
+	{
+		const float ScaleSq = m.m[0][Axis] * m.m[0][Axis] + m.m[1][Axis] * m.m[1][Axis] + m.m[2][Axis] * m.m[2][Axis];
+		MaxScaleSq = ScaleSq > MaxScaleSq ? ScaleSq : MaxScaleSq;
+	}
+
+	OutRadius = sqrtf((ex * ex + ey * ey + ez * ez) * MaxScaleSq);
+}
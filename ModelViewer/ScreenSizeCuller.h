@@ -0,0 +1,53 @@
+#pragma once
+
+#ifndef SCREEN_SIZE_CULLER_H
+#define SCREEN_SIZE_CULLER_H
+
+#include <vector>
+
+#include "DirectXMath.h"
+
+#include "AABB.h"
+
+typedef unsigned int UINT;
+
+/*
+*	Screen space contribution culling. Every instance gets a bounding sphere from the model's local AABB (center transformed, radius
+*	scaled by the largest axis scale) and its projected radius in pixels is computed from the distance to the camera. Instances below
+*	the pixel threshold are dropped and the radii of the rest are kept so LOD selection can reuse them. Runs after the frustum test on
+*	its visible list, so it works with every CPU culling path. Pure CPU, no device needed.
+*/
+
+class ScreenSizeCuller
+{
+public:
+	ScreenSizeCuller();
+
+	// PixelScale turns radius / distance into pixels, see ComputePixelScale. A MinPixelRadius of 0 keeps everything but still fills the radii
+	void SetView(const DirectX::XMFLOAT3& CameraPos, float PixelScale, float MinPixelRadius);
+
+	// Transforms in the same (transposed) layout as ModelData::m_Transforms, only the instances in Indices are looked at.
+	// OutIndices gets the ones that are large enough, returns how many were dropped
+	UINT Cull(const DirectX::XMMATRIX* Transforms, const AABB& BBox, const std::vector<UINT>& Indices, std::vector<UINT>& OutIndices);
+
+	// projected radius in pixels of every instance kept by the last Cull, parallel to its OutIndices
+	const std::vector<float>& GetProjectedRadii() const { return m_ProjectedRadii; }
+	float GetMinPixelRadius() const { return m_MinPixelRadius; }
+	float GetPixelScale() const { return m_PixelScale; }
+
+	// half the viewport height times the vertical focal length (cot(FovY / 2), the [1][1] entry of a perspective projection)
+	static float ComputePixelScale(const DirectX::XMMATRIX& Proj, float ViewportHeight);
+	// exact for a sphere centered on the view axis and a slight underestimate off axis. FLT_MAX when the camera is inside the sphere
+	static float ProjectSphereRadius(float Radius, float Distance, float PixelScale);
+	static void GetBoundingSphere(const AABB& BBox, const DirectX::XMMATRIX& Transform, DirectX::XMFLOAT3& OutCenter, float& OutRadius);
+
+private:
+	DirectX::XMFLOAT3 m_CameraPos;
+	float m_PixelScale;
+	float m_MinPixelRadius;
+
+	std::vector<float> m_ProjectedRadii;
+
+};
+
+#endif
@@ -5,6 +5,7 @@
 #define MAX_PLANE_CHUNKS 1024
 #define MAX_GRASS_PER_CHUNK 10000
 #define MAX_INSTANCE_COUNT 1024
+#define GRASS_TILE_DIMENSION 8
 
 struct GrassData
 {
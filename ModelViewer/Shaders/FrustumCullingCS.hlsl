@@ -7,12 +7,37 @@ StructuredBuffer<float2> Offsets : register(t1);
 StructuredBuffer<float2> CulledOffsets : register(t2);
 Texture2D Heightmap : register(t3);
 
+struct BatchModelData
+{
+	float4 BoundsCenter;
+	float4 BoundsExtent;
+	uint InstanceOffset;
+	uint InstanceCount;
+	uint2 Padding;
+};
+
+struct BatchDrawData
+{
+	uint ModelIndex;
+	uint IndexCount;
+	uint StartIndex;
+	int BaseVertex;
+};
+
+StructuredBuffer<uint> BatchModelIDs : register(t4);
+StructuredBuffer<BatchModelData> BatchModels : register(t5);
+StructuredBuffer<BatchDrawData> BatchDraws : register(t6);
+// one entry per grass tile to cull, x is the visible chunk, y the first blade, z the blade count and w is set when the whole tile is inside
+StructuredBuffer<uint4> GrassTiles : register(t7);
+
 AppendStructuredBuffer<float4x4> CulledTransforms : register(u0);
 AppendStructuredBuffer<float2> CulledOffsetsAppend : register(u1);
 AppendStructuredBuffer<GrassData> CulledGrassData : register(u2);
 AppendStructuredBuffer<GrassData> CulledGrassLODData : register(u3);
 RWStructuredBuffer<uint> InstanceCounts : register(u4);
 RWByteAddressBuffer ArgsBuffer : register(u5);
+RWStructuredBuffer<float4x4> BatchCulledTransforms : register(u6);
+RWStructuredBuffer<uint> BatchInstanceCounts : register(u7);
 
 cbuffer CullData : register(b0)
 {
@@ -27,6 +52,65 @@ cbuffer CullData : register(b0)
 	float LODDistanceThreshold;
 	float3 CameraPos;
 	float Padding;
+	float4 FrustumPlanes[6];
+	uint BatchDrawCount;
+	uint BaseInstance;	// first instance of this chunk when the work is split over several dispatches
+	float MinPixelRadius;	// 0 when screen size culling is off
+	float PixelScale;
+}
+
+// Corners holds the local bounds in the order of AABB::CalcCorners, so 0 is the min corner and 7 the max
+float3 GetBoundsCenter()
+{
+	return (Corners[0].xyz + Corners[7].xyz) * 0.5f;
+}
+
+float3 GetBoundsExtent()
+{
+	return (Corners[7].xyz - Corners[0].xyz) * 0.5f;
+}
+
+// same conservative test as Frustum::TestAABB, only false when the box is fully behind one of the planes
+bool IsAABBVisible(float3 Center, float3 Extent)
+{
+	for (int i = 0; i < 6; i++)
+	{
+		if (dot(FrustumPlanes[i].xyz, Center) + FrustumPlanes[i].w + dot(abs(FrustumPlanes[i].xyz), Extent) < 0.f)
+			return false;
+	}
+	return true;
+}
+
+// local bounds transformed by the row-vector matrix m, same as Frustum::TestOBB. Row i of m is local axis i in world space
+bool IsOBBVisible(float4x4 m)
+{
+	const float3 Center = mul(float4(GetBoundsCenter(), 1.f), m).xyz;
+	const float3 Extent = GetBoundsExtent();
+	
+	for (int i = 0; i < 6; i++)
+	{
+		const float3 n = FrustumPlanes[i].xyz;
+		const float Radius = abs(dot(n, m[0].xyz)) * Extent.x + abs(dot(n, m[1].xyz)) * Extent.y + abs(dot(n, m[2].xyz)) * Extent.z;
+		if (dot(n, Center) + FrustumPlanes[i].w + Radius < 0.f)
+			return false;
+	}
+	return true;
+}
+
+// same as ScreenSizeCuller, the bounding sphere of the local bounds under the row-vector matrix m projected from its distance to the camera
+bool IsLargeEnough(float3 LocalCenter, float3 LocalExtent, float4x4 m)
+{
+	if (MinPixelRadius <= 0.f)
+		return true;
+	
+	const float3 Center = mul(float4(LocalCenter, 1.f), m).xyz;
+	const float MaxScaleSq = max(dot(m[0].xyz, m[0].xyz), max(dot(m[1].xyz, m[1].xyz), dot(m[2].xyz, m[2].xyz)));
+	const float RadiusSq = dot(LocalExtent, LocalExtent) * MaxScaleSq;
+	const float3 ToCenter = Center - CameraPos;
+	const float Denom = dot(ToCenter, ToCenter) - RadiusSq;
+	
+	// inside the sphere counts as large
+	return Denom <= 0.f || sqrt(RadiusSq) * PixelScale >= MinPixelRadius * sqrt(Denom);
 }
 
 static const uint tx = 32u;
@@ -42,20 +126,13 @@ void FrustumCull( uint3 DTid : SV_DispatchThreadID )
 	if (FlattenedID >= SentInstanceCount)
 		return;
 	
-	const float Bias = 0.01f;
-	const float4x4 t = Transforms[FlattenedID];
+	const float4x4 t = Transforms[BaseInstance + FlattenedID];
 
-	for (int i = 0; i < 8; i++)
+	const float4x4 m = mul(ScaleMatrix, t);
+	if (IsOBBVisible(m) && IsLargeEnough(GetBoundsCenter(), GetBoundsExtent(), m))
 	{
-		float4 TransformedCorner = mul(mul(mul(Corners[i], ScaleMatrix), t), ViewProj);
-
-		if (abs(TransformedCorner.x) <= TransformedCorner.w + Bias && abs(TransformedCorner.y) <= TransformedCorner.w + Bias &&
-			(TransformedCorner.z >= -Bias && TransformedCorner.z <= TransformedCorner.w + Bias))
-		{
-			CulledTransforms.Append(t);
-			InterlockedAdd(InstanceCounts[0], 1u);
-			return;
-		}
+		CulledTransforms.Append(t);
+		InterlockedAdd(InstanceCounts[0], 1u);
 	}
 }
 
@@ -69,20 +146,14 @@ void FrustumCullOffsets(uint3 DTid : SV_DispatchThreadID)
 	if (FlattenedID >= SentInstanceCount)
 		return;
 	
-	const float Bias = 0.01f;
 	const float4 o = float4(Offsets[FlattenedID].x, 0.f, Offsets[FlattenedID].y, 0.f);
 	
-	for (int i = 0; i < 8; i++)
+	float4x4 m = ScaleMatrix;
+	m[3] += o;
+	if (IsOBBVisible(m))
 	{
-		float4 TransformedCorner = mul(mul(Corners[i], ScaleMatrix) + o, ViewProj);
-
-		if (abs(TransformedCorner.x) <= TransformedCorner.w + Bias && abs(TransformedCorner.y) <= TransformedCorner.w + Bias &&
-			(TransformedCorner.z >= -Bias && TransformedCorner.z <= TransformedCorner.w + Bias))
-		{
-			CulledOffsetsAppend.Append(o.xz);
-			InterlockedAdd(InstanceCounts[0], 1u);
-			return;
-		}
+		CulledOffsetsAppend.Append(o.xz);
+		InterlockedAdd(InstanceCounts[0], 1u);
 	}
 }
 
@@ -90,6 +161,43 @@ static const uint grass_tx = 32u;
 static const uint grass_ty = 8u;
 static const uint grass_tz = 1u;
 
+// bTestBounds is false for blades of a tile that is already known to be inside the frustum, those skip the heightmap as well
+void CullGrassBlade(uint GrassID, uint ChunkID, bool bTestBounds)
+{
+	const float3 ChunkOffset = float3(CulledOffsets[ChunkID].x, 0.f, CulledOffsets[ChunkID].y);
+	const float3 GrassOffset = float3(Offsets[GrassID].x, 0.f, Offsets[GrassID].y);
+	const float4 WorldOffset = float4(ChunkOffset + GrassOffset, 0.f);
+	
+	if (bTestBounds)
+	{
+		const float2 UV = GetHeightmapUV(WorldOffset.xz, PlaneDimension);
+		const float4 Height = float4(0.f, Heightmap.SampleLevel(Sampler, UV, 0.f).r * HeightDisplacement, 0.f, 0.f);
+		
+		if (!IsAABBVisible(GetBoundsCenter() + WorldOffset.xyz + Height.xyz, GetBoundsExtent()))
+			return;
+	}
+	
+	float Dist = distance(CameraPos, WorldOffset.xyz);
+	bool bHighLOD = Dist < LODDistanceThreshold;
+	
+	GrassData Grass;
+	Grass.Offset = WorldOffset.xz;
+	Grass.ChunkID = HashFloat2ToUint(CulledOffsets[ChunkID]);
+	
+	if (bHighLOD)
+	{
+		Grass.LOD = 0u;
+		CulledGrassData.Append(Grass);
+		InterlockedAdd(InstanceCounts[0], 1u);
+	}
+	else
+	{
+		Grass.LOD = 1u;
+		CulledGrassLODData.Append(Grass);
+		InterlockedAdd(InstanceCounts[1], 1u);
+	}
+}
+
 [numthreads(grass_tx, grass_ty, grass_tz)]
 void FrustumCullGrass(uint3 DTid : SV_DispatchThreadID)
 {
@@ -99,45 +207,68 @@ void FrustumCullGrass(uint3 DTid : SV_DispatchThreadID)
 	if (GrassID >= GrassPerChunk || ChunkID >= SentInstanceCount)
 		return;
 	
-	const float Bias = 0.f; // this might be a bit too generous
-	const float3 ChunkOffset = float3(CulledOffsets[ChunkID].x, 0.f, CulledOffsets[ChunkID].y);
-	const float3 GrassOffset = float3(Offsets[GrassID].x, 0.f, Offsets[GrassID].y);
-	const float4 WorldOffset = float4(ChunkOffset + GrassOffset, 0.f);
+	CullGrassBlade(GrassID, ChunkID, true);
+}
+
+// one group per tile classified on the CPU, culled tiles never get here and the blades of fully inside tiles are not tested
+[numthreads(GRASS_TILE_DIMENSION * GRASS_TILE_DIMENSION, 1, 1)]
+void FrustumCullGrassTiles(uint3 GroupID : SV_GroupID, uint GroupIndex : SV_GroupIndex)
+{
+	const uint TileID = GroupID.y * ThreadGroupCounts.x + GroupID.x;
+	if (TileID >= SentInstanceCount)
+		return;
 	
-	const float2 UV = GetHeightmapUV(WorldOffset.xz, PlaneDimension);
-	const float4 Height = float4(0.f, Heightmap.SampleLevel(Sampler, UV, 0.f).r * HeightDisplacement, 0.f, 0.f);
+	const uint4 Tile = GrassTiles[TileID];
+	if (GroupIndex >= Tile.z)
+		return;
 	
-	float Dist = distance(CameraPos, WorldOffset.xyz);
-	bool bHighLOD = Dist < LODDistanceThreshold;
+	CullGrassBlade(Tile.y + GroupIndex, Tile.x, Tile.w == 0u);
+}
+
+// every model in one dispatch, visible instances of a model are written into the range its instances were sent in
+[numthreads(tx, ty, tz)]
+void FrustumCullBatch(uint3 DTid : SV_DispatchThreadID)
+{
+	uint FlattenedID = DTid.z * ThreadGroupCounts.x * ThreadGroupCounts.y * tx * ty +
+                       DTid.y * ThreadGroupCounts.x * tx +
+                       DTid.x;
 	
-	// breaks slightly when height displacement > 0
-	for (int i = 0; i < 8; i++)
-	{
-		float4 TransformedCorner = mul(Corners[i] + WorldOffset + Height, ViewProj);
-
-		if (abs(TransformedCorner.x) <= TransformedCorner.w + Bias && abs(TransformedCorner.y) <= TransformedCorner.w + Bias &&
-			(TransformedCorner.z >= -Bias && TransformedCorner.z <= TransformedCorner.w + Bias))
-		{
-			GrassData Grass;
-			Grass.Offset = WorldOffset.xz;
-			Grass.ChunkID = HashFloat2ToUint(CulledOffsets[ChunkID]);
-			
-			if (bHighLOD)
-			{
-				Grass.LOD = 0u;
-				CulledGrassData.Append(Grass);
-				InterlockedAdd(InstanceCounts[0], 1u);
-				return;				
-			}
-			else
-			{
-				Grass.LOD = 1u;
-				CulledGrassLODData.Append(Grass);
-				InterlockedAdd(InstanceCounts[1], 1u);
-				return;
-			}
-		}
-	}
+	if (FlattenedID >= SentInstanceCount)
+		return;
+	
+	const uint InstanceID = BaseInstance + FlattenedID;
+	const uint ModelID = BatchModelIDs[InstanceID];
+	const BatchModelData Model = BatchModels[ModelID];
+	const float4x4 t = Transforms[InstanceID];
+	
+	// world space AABB of the transformed local bounds, same as CPUFrustumCuller
+	const float3 Center = mul(float4(Model.BoundsCenter.xyz, 1.f), t).xyz;
+	const float3 Extent = abs(t[0].xyz) * Model.BoundsExtent.x + abs(t[1].xyz) * Model.BoundsExtent.y + abs(t[2].xyz) * Model.BoundsExtent.z;
+	
+	if (!IsAABBVisible(Center, Extent) || !IsLargeEnough(Model.BoundsCenter.xyz, Model.BoundsExtent.xyz, t))
+		return;
+	
+	uint Slot;
+	InterlockedAdd(BatchInstanceCounts[ModelID], 1u, Slot);
+	BatchCulledTransforms[Model.InstanceOffset + Slot] = t;
+}
+
+// one DrawIndexedInstancedIndirect args entry (5 uints) per draw. The instance offset is not put into StartInstanceLocation as
+// SV_InstanceID does not include it, InstancedPhongVS reads it from a constant buffer instead
+[numthreads(64, 1, 1)]
+void BuildBatchArgs(uint3 DTid : SV_DispatchThreadID)
+{
+	if (DTid.x >= BatchDrawCount)
+		return;
+	
+	const BatchDrawData Draw = BatchDraws[DTid.x];
+	const uint Base = DTid.x * 20u;
+	
+	ArgsBuffer.Store(Base, Draw.IndexCount);
+	ArgsBuffer.Store(Base + 4u, BatchInstanceCounts[Draw.ModelIndex]);
+	ArgsBuffer.Store(Base + 8u, Draw.StartIndex);
+	ArgsBuffer.Store(Base + 12u, asuint(Draw.BaseVertex));
+	ArgsBuffer.Store(Base + 16u, 0u);
 }
 
 [numthreads(1, 1, 1)]
@@ -11,6 +11,22 @@ cbuffer AccumulatedModelTransform : register(b1)
 	matrix AccumulatedModelMatrix;
 }
 
+// start of this model's range in CulledTransforms when all models are culled in one batch, 0 otherwise
+cbuffer InstanceOffsetBuffer : register(b2)
+{
+	uint InstanceOffset;
+	uint3 Padding;
+}
+
+// PackedMain only, positions are stored relative to the mesh bounds
+cbuffer MeshQuantization : register(b3)
+{
+	float3 PositionOffset;
+	float QuantizationPadding0;
+	float3 PositionScale;
+	float QuantizationPadding1;
+}
+
 struct VS_In
 {
 	float3 Pos : POSITION;
@@ -20,6 +36,36 @@ struct VS_In
 	uint InstanceID : SV_InstanceID;
 };
 
+// PackedVertex in Common.h, the input layout has already turned the unorm, snorm and half values into floats
+struct VS_PackedIn
+{
+	float4 Pos : POSITION;
+	float2 Normal : NORMAL;
+	float2 TexCoord : TEXCOORD0;
+	
+	uint InstanceID : SV_InstanceID;
+};
+
+// ClusterMain and PackedClusterMain, Instance is the per instance stream of indices into CulledTransforms that cluster draws read
+// from StartInstanceLocation on, which SV_InstanceID never sees
+struct VS_ClusterIn
+{
+	float3 Pos : POSITION;
+	float2 TexCoord : TEXCOORD0;
+	float3 Normal : NORMAL;
+	
+	uint Instance : INSTANCE;
+};
+
+struct VS_PackedClusterIn
+{
+	float4 Pos : POSITION;
+	float2 Normal : NORMAL;
+	float2 TexCoord : TEXCOORD0;
+	
+	uint Instance : INSTANCE;
+};
+
 struct VS_Out
 {
 	float4 Pos : SV_POSITION;
@@ -28,23 +74,53 @@ struct VS_Out
 	float3 WorldNormal : NORMAL;
 };
 
-VS_Out main(VS_In v)
+// the same as VertexCompression::DecodeOctahedral
+float3 DecodeOctahedral(float2 Encoded)
+{
+	float3 n = float3(Encoded, 1.f - abs(Encoded.x) - abs(Encoded.y));
+	const float t = saturate(-n.z);
+	n.xy += n.xy >= 0.f ? -t : t;
+	return normalize(n);
+}
+
+VS_Out Transform(float3 Pos, float3 Normal, float2 TexCoord, uint TransformIndex)
 {
 	VS_Out o;
 	
 	// mesh vertices have no knowledge whether they are parented to a parent mesh node or not
 	// to solve this, multiply by the AccumulatedModelMatrix BEFORE applying model transform
-	o.Pos = mul(mul(float4(v.Pos, 1.f), AccumulatedModelMatrix), CulledTransforms[v.InstanceID]);
+	const float4x4 InstanceTransform = CulledTransforms[TransformIndex];
+	o.Pos = mul(mul(float4(Pos, 1.f), AccumulatedModelMatrix), InstanceTransform);
 	
 	o.WorldPos = o.Pos.xyz;
 	
 	o.Pos = mul(o.Pos, ViewMatrix);
 	o.Pos = mul(o.Pos, ProjectionMatrix);
 	
-	o.TexCoord = v.TexCoord;
+	o.TexCoord = TexCoord;
 	
-	o.WorldNormal = mul(mul(float4(v.Normal, 0.f), AccumulatedModelMatrix), CulledTransforms[v.InstanceID]).xyz; // TODO: correct as long as I use uniform scaling, come back and fix
+	o.WorldNormal = mul(mul(float4(Normal, 0.f), AccumulatedModelMatrix), InstanceTransform).xyz; // TODO: correct as long as I use uniform scaling, come back and fix
 	o.WorldNormal = normalize(o.WorldNormal);
 	
 	return o;
+}
+
+VS_Out main(VS_In v)
+{
+	return Transform(v.Pos, v.Normal, v.TexCoord, v.InstanceID + InstanceOffset);
+}
+
+VS_Out PackedMain(VS_PackedIn v)
+{
+	return Transform(PositionOffset + v.Pos.xyz * PositionScale, DecodeOctahedral(v.Normal), v.TexCoord, v.InstanceID + InstanceOffset);
+}
+
+VS_Out ClusterMain(VS_ClusterIn v)
+{
+	return Transform(v.Pos, v.Normal, v.TexCoord, v.Instance);
+}
+
+VS_Out PackedClusterMain(VS_PackedClusterIn v)
+{
+	return Transform(PositionOffset + v.Pos.xyz * PositionScale, DecodeOctahedral(v.Normal), v.TexCoord, v.Instance);
 }
\ No newline at end of file
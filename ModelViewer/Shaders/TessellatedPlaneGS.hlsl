@@ -1,6 +1,6 @@
 cbuffer CullingBuffer
 {
-	float4 FrustumPlanes[6];  // left, right, top, bot, near, far // not using right now, but will use when changing to culling my frustum planes rather than clip space coordinates
+	float4 FrustumPlanes[6];  // left, right, bottom, top, near, far. Normalized and pointing inwards
 	float4x4 CullCameraViewProj;
 };
 
@@ -18,21 +18,22 @@ void main(
 	inout TriangleStream<GS_In> output
 )
 {
-	bool bInsideFrustum = false;
+	bool bInsideFrustum = true;
 	const float Bias = 0.5f;
 
-	for (int i = 0; i < 3; ++i)
+	// only drop the triangle when all three vertices are behind the same plane, a large triangle can cover the view with every vertex outside it
+	for (int p = 0; p < 6 && bInsideFrustum; ++p)
 	{
-		float4 Pos = mul(float4(input[i].WorldPos, 1.f), CullCameraViewProj);
-		
-		// check if at least one vertex is inside the clip space
-		if (abs(Pos.x) <= Pos.w + Bias &&
-            abs(Pos.y) <= Pos.w + Bias &&
-            Pos.z >= -Bias && Pos.z <= Pos.w + Bias)
+		bool bAllOutside = true;
+		for (int i = 0; i < 3; ++i)
 		{
-			bInsideFrustum = true;
-			break;
+			if (dot(FrustumPlanes[p].xyz, input[i].WorldPos) + FrustumPlanes[p].w >= -Bias)
+			{
+				bAllOutside = false;
+				break;
+			}
 		}
+		bInsideFrustum = !bAllOutside;
 	}
 
 	if (bInsideFrustum)
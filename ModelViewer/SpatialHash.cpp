@@ -0,0 +1,479 @@
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+
+#include "SpatialHash.h"
+
+static const UINT INVALID_CELL = 0xFFFFFFFF;
+static const UINT OVERSIZED_CELL = 0xFFFFFFFE;
+// cell coordinates are clamped to this so the float to int conversion cannot overflow and stepping to a neighbour cannot wrap
+static const float MAX_CELL_COORD = (float)(1 << 30);
+
+static float GetAxis(const DirectX::XMFLOAT3& v, int Axis)
+{
+	return Axis == 0 ? v.x : Axis == 1 ? v.y : v.z;
+}
+
+static bool Overlaps(const BVHBounds& a, const BVHBounds& b)
+{
+	return a.Min.x <= b.Max.x && a.Max.x >= b.Min.x &&
+		a.Min.y <= b.Max.y && a.Max.y >= b.Min.y &&
+		a.Min.z <= b.Max.z && a.Max.z >= b.Min.z;
+}
+
+static float SquaredDistanceToBounds(const DirectX::XMFLOAT3& Point, const BVHBounds& Bounds)
+{
+	float Distance = 0.f;
+	for (int Axis = 0; Axis < 3; Axis++)
+	{
+		const float p = GetAxis(Point, Axis);
+		const float Min = GetAxis(Bounds.Min, Axis);
+		const float Max = GetAxis(Bounds.Max, Axis);
+		const float d = p < Min ? Min - p : (p > Max ? p - Max : 0.f);
+		Distance += d * d;
+	}
+	return Distance;
+}
+
+// slab test clipped to [TMin, TMax], OutEnter and OutExit are the part of the ray inside the bounds
+static bool IntersectRayBounds(const DirectX::XMFLOAT3& Origin, const DirectX::XMFLOAT3& Direction, const BVHBounds& Bounds,
+	float TMin, float TMax, float& OutEnter, float& OutExit)
+{
+	for (int Axis = 0; Axis < 3; Axis++)
+	{
+		const float o = GetAxis(Origin, Axis);
+		const float d = GetAxis(Direction, Axis);
+		const float Min = GetAxis(Bounds.Min, Axis);
+		const float Max = GetAxis(Bounds.Max, Axis);
+
+		// parallel to the slab, either always inside it or never
+		if (fabsf(d) < 1e-12f)
+		{
+			if (o < Min || o > Max)
+				return false;
+			continue;
+		}
+
+		const float InvD = 1.f / d;
+		float t0 = (Min - o) * InvD;
+		float t1 = (Max - o) * InvD;
+		if (t0 > t1)
+			std::swap(t0, t1);
+
+		TMin = t0 > TMin ? t0 : TMin;
+		TMax = t1 < TMax ? t1 : TMax;
+		if (TMin > TMax)
+			return false;
+	}
+
+	OutEnter = TMin;
+	OutExit = TMax;
+	return true;
+}
+
+SpatialHash::SpatialHash(float CellSize)
+{
+	Clear(CellSize);
+}
+
+template<typename Visitor>
+void SpatialHash::VisitCells(const int* Min, const int* Max, Visitor&& Visit) const
+{
+	m_LastCellsVisited = 0u;
+
+	// a large range has more coordinates than there are cells in use, walking the cell list is cheaper than hashing each of them
+	const double RangeCells = (double)(Max[0] - Min[0] + 1) * (double)(Max[1] - Min[1] + 1) * (double)(Max[2] - Min[2] + 1);
+	if (RangeCells > (double)m_Cells.size())
+	{
+		for (const Cell& C : m_Cells)
+		{
+			if (C.Proxies.empty() || C.X < Min[0] || C.X > Max[0] || C.Y < Min[1] || C.Y > Max[1] || C.Z < Min[2] || C.Z > Max[2])
+				continue;
+
+			m_LastCellsVisited++;
+			Visit(C);
+		}
+		return;
+	}
+
+	for (int z = Min[2]; z <= Max[2]; z++)
+	{
+		for (int y = Min[1]; y <= Max[1]; y++)
+		{
+			for (int x = Min[0]; x <= Max[0]; x++)
+			{
+				const UINT CellIndex = FindCell(x, y, z);
+				if (CellIndex == INVALID_CELL || m_Cells[CellIndex].Proxies.empty())
+					continue;
+
+				m_LastCellsVisited++;
+				Visit(m_Cells[CellIndex]);
+			}
+		}
+	}
+}
+
+UINT SpatialHash::Insert(const BVHBounds& Bounds, UINT UserData)
+{
+	UINT Index;
+	if (!m_FreeProxies.empty())
+	{
+		Index = m_FreeProxies.back();
+		m_FreeProxies.pop_back();
+	}
+	else
+	{
+		Index = (UINT)m_Proxies.size();
+		m_Proxies.emplace_back();
+	}
+
+	m_Proxies[Index] = { Bounds, UserData, INVALID_CELL, 0u };
+	Link(Index);
+	m_WorldBounds.Expand(Bounds);
+	m_Count++;
+
+	return Index;
+}
+
+bool SpatialHash::Update(UINT ProxyIndex, const BVHBounds& Bounds)
+{
+	assert(ProxyIndex < m_Proxies.size() && m_Proxies[ProxyIndex].Cell != INVALID_CELL);
+
+	Proxy& P = m_Proxies[ProxyIndex];
+	m_WorldBounds.Expand(Bounds);
+
+	// still the same home cell, which is by far the common case for something moving a little every frame
+	const DirectX::XMFLOAT3 Extent = { Bounds.Max.x - Bounds.Min.x, Bounds.Max.y - Bounds.Min.y, Bounds.Max.z - Bounds.Min.z };
+	const bool bOversized = std::max(Extent.x, std::max(Extent.y, Extent.z)) > m_CellSize;
+	if (bOversized && P.Cell == OVERSIZED_CELL)
+	{
+		P.Bounds = Bounds;
+		return false;
+	}
+
+	if (!bOversized && P.Cell != OVERSIZED_CELL)
+	{
+		int Coords[3];
+		GetCellCoords(Bounds.Center(), Coords);
+		const Cell& Current = m_Cells[P.Cell];
+		if (Current.X == Coords[0] && Current.Y == Coords[1] && Current.Z == Coords[2])
+		{
+			P.Bounds = Bounds;
+			return false;
+		}
+	}
+
+	Unlink(ProxyIndex);
+	m_Proxies[ProxyIndex].Bounds = Bounds;
+	Link(ProxyIndex);
+
+	return true;
+}
+
+void SpatialHash::Remove(UINT ProxyIndex)
+{
+	assert(ProxyIndex < m_Proxies.size() && m_Proxies[ProxyIndex].Cell != INVALID_CELL);
+
+	Unlink(ProxyIndex);
+	m_Proxies[ProxyIndex].Cell = INVALID_CELL;
+	m_FreeProxies.push_back(ProxyIndex);
+	m_Count--;
+}
+
+void SpatialHash::Clear(float CellSize)
+{
+	m_CellSize = CellSize > 0.f ? CellSize : 1.f;
+	m_InvCellSize = 1.f / m_CellSize;
+
+	m_CellLookup.clear();
+	m_Cells.clear();
+	m_Proxies.clear();
+	m_FreeProxies.clear();
+	m_Oversized.clear();
+	m_Count = 0u;
+	m_WorldBounds = {};
+	m_QueryStamp = 0u;
+	m_LastCellsVisited = 0u;
+}
+
+void SpatialHash::QueryRange(const BVHBounds& Range, std::vector<UINT>& OutUserData) const
+{
+	for (UINT ProxyIndex : m_Oversized)
+	{
+		if (Overlaps(m_Proxies[ProxyIndex].Bounds, Range))
+			OutUserData.push_back(m_Proxies[ProxyIndex].UserData);
+	}
+
+	int Min[3], Max[3];
+	GetLooseCellRange(Range, Min, Max);
+	VisitCells(Min, Max, [&](const Cell& C)
+		{
+			for (UINT ProxyIndex : C.Proxies)
+			{
+				if (Overlaps(m_Proxies[ProxyIndex].Bounds, Range))
+					OutUserData.push_back(m_Proxies[ProxyIndex].UserData);
+			}
+		});
+}
+
+void SpatialHash::QueryRadius(const DirectX::XMFLOAT3& Center, float Radius, std::vector<UINT>& OutUserData) const
+{
+	const float RadiusSq = Radius * Radius;
+	for (UINT ProxyIndex : m_Oversized)
+	{
+		if (SquaredDistanceToBounds(Center, m_Proxies[ProxyIndex].Bounds) <= RadiusSq)
+			OutUserData.push_back(m_Proxies[ProxyIndex].UserData);
+	}
+
+	BVHBounds Range;
+	Range.Min = { Center.x - Radius, Center.y - Radius, Center.z - Radius };
+	Range.Max = { Center.x + Radius, Center.y + Radius, Center.z + Radius };
+
+	int Min[3], Max[3];
+	GetLooseCellRange(Range, Min, Max);
+	VisitCells(Min, Max, [&](const Cell& C)
+		{
+			for (UINT ProxyIndex : C.Proxies)
+			{
+				if (SquaredDistanceToBounds(Center, m_Proxies[ProxyIndex].Bounds) <= RadiusSq)
+					OutUserData.push_back(m_Proxies[ProxyIndex].UserData);
+			}
+		});
+}
+
+void SpatialHash::QueryFrustum(const Frustum& ViewFrustum, std::vector<UINT>& OutUserData) const
+{
+	auto TestBounds = [&](const BVHBounds& Bounds, UINT& PlaneMask)
+		{
+			const DirectX::XMFLOAT3 Center = Bounds.Center();
+			const DirectX::XMFLOAT3 Extent = { (Bounds.Max.x - Bounds.Min.x) * 0.5f, (Bounds.Max.y - Bounds.Min.y) * 0.5f, (Bounds.Max.z - Bounds.Min.z) * 0.5f };
+			return ViewFrustum.TestAABB(Center, Extent, PlaneMask);
+		};
+
+	for (UINT ProxyIndex : m_Oversized)
+	{
+		UINT Mask = 0x3F;
+		if (TestBounds(m_Proxies[ProxyIndex].Bounds, Mask))
+			OutUserData.push_back(m_Proxies[ProxyIndex].UserData);
+	}
+
+	DirectX::XMFLOAT4 Corners[8];
+	ViewFrustum.GetCorners(Corners);
+	BVHBounds Range;
+	for (const DirectX::XMFLOAT4& Corner : Corners)
+	{
+		Range.Expand(DirectX::XMFLOAT3(Corner.x, Corner.y, Corner.z));
+	}
+
+	int Min[3], Max[3];
+	GetLooseCellRange(Range, Min, Max);
+	VisitCells(Min, Max, [&](const Cell& C)
+		{
+			UINT CellMask = 0x3F;
+			if (!TestBounds(GetLooseCellBounds(C), CellMask))
+				return;
+
+			// the loose cell is fully inside, so is everything in it
+			if (CellMask == 0u)
+			{
+				for (UINT ProxyIndex : C.Proxies)
+				{
+					OutUserData.push_back(m_Proxies[ProxyIndex].UserData);
+				}
+				return;
+			}
+
+			for (UINT ProxyIndex : C.Proxies)
+			{
+				UINT Mask = CellMask;
+				if (TestBounds(m_Proxies[ProxyIndex].Bounds, Mask))
+					OutUserData.push_back(m_Proxies[ProxyIndex].UserData);
+			}
+		});
+}
+
+bool SpatialHash::QueryRay(const DirectX::XMFLOAT3& Origin, const DirectX::XMFLOAT3& Direction, float MaxDistance, UINT& OutUserData, float& OutDistance) const
+{
+	m_LastCellsVisited = 0u;
+	float Best = MaxDistance;
+	bool bHit = false;
+	float Enter, Exit;
+
+	for (UINT ProxyIndex : m_Oversized)
+	{
+		if (IntersectRayBounds(Origin, Direction, m_Proxies[ProxyIndex].Bounds, 0.f, Best, Enter, Exit))
+		{
+			Best = Enter;
+			OutUserData = m_Proxies[ProxyIndex].UserData;
+			bHit = true;
+		}
+	}
+
+	if (m_Count == (UINT)m_Oversized.size() || !IntersectRayBounds(Origin, Direction, m_WorldBounds, 0.f, Best, Enter, Exit))
+	{
+		OutDistance = Best;
+		return bHit;
+	}
+
+	// stamps only have to be unique per query, on wrap around every cell is reset once
+	if (++m_QueryStamp == 0u)
+	{
+		for (const Cell& C : m_Cells)
+		{
+			C.QueryStamp = 0u;
+		}
+		m_QueryStamp = 1u;
+	}
+
+	// 3D DDA from where the ray enters the world bounds. An item can only hang half a cell out of its home cell, so any point of it is
+	// in a neighbour of that cell: testing the 27 cells around every cell the ray steps through sees every item it can hit
+	const DirectX::XMFLOAT3 Start = { Origin.x + Direction.x * Enter, Origin.y + Direction.y * Enter, Origin.z + Direction.z * Enter };
+	int Coords[3];
+	GetCellCoords(Start, Coords);
+
+	int Step[3];
+	float NextBoundary[3];
+	float Delta[3];
+	for (int Axis = 0; Axis < 3; Axis++)
+	{
+		const float d = GetAxis(Direction, Axis);
+		if (fabsf(d) < 1e-12f)
+		{
+			Step[Axis] = 0;
+			NextBoundary[Axis] = FLT_MAX;
+			Delta[Axis] = FLT_MAX;
+			continue;
+		}
+
+		Step[Axis] = d > 0.f ? 1 : -1;
+		const float Boundary = (float)(Coords[Axis] + (d > 0.f ? 1 : 0)) * m_CellSize;
+		NextBoundary[Axis] = (Boundary - GetAxis(Origin, Axis)) / d;
+		Delta[Axis] = m_CellSize / fabsf(d);
+	}
+
+	float CellEnter = Enter;
+	while (CellEnter <= Exit && CellEnter <= Best)
+	{
+		for (int z = -1; z <= 1; z++)
+		{
+			for (int y = -1; y <= 1; y++)
+			{
+				for (int x = -1; x <= 1; x++)
+				{
+					const UINT CellIndex = FindCell(Coords[0] + x, Coords[1] + y, Coords[2] + z);
+					if (CellIndex == INVALID_CELL || m_Cells[CellIndex].QueryStamp == m_QueryStamp)
+						continue;
+
+					const Cell& C = m_Cells[CellIndex];
+					C.QueryStamp = m_QueryStamp;
+					m_LastCellsVisited++;
+					for (UINT ProxyIndex : C.Proxies)
+					{
+						float ItemEnter, ItemExit;
+						if (IntersectRayBounds(Origin, Direction, m_Proxies[ProxyIndex].Bounds, 0.f, Best, ItemEnter, ItemExit))
+						{
+							Best = ItemEnter;
+							OutUserData = m_Proxies[ProxyIndex].UserData;
+							bHit = true;
+						}
+					}
+				}
+			}
+		}
+
+		// a hit at Best was found by now if its point lies in any cell entered before Best, so the walk can stop past it
+		int Axis = NextBoundary[0] < NextBoundary[1] ? (NextBoundary[0] < NextBoundary[2] ? 0 : 2) : (NextBoundary[1] < NextBoundary[2] ? 1 : 2);
+		CellEnter = NextBoundary[Axis];
+		NextBoundary[Axis] += Delta[Axis];
+		Coords[Axis] += Step[Axis];
+	}
+
+	OutDistance = Best;
+	return bHit;
+}
+
+void SpatialHash::GetCellCoords(const DirectX::XMFLOAT3& Point, int* OutCoords) const
+{
+	OutCoords[0] = (int)std::clamp(floorf(Point.x * m_InvCellSize), -MAX_CELL_COORD, MAX_CELL_COORD);
+	OutCoords[1] = (int)std::clamp(floorf(Point.y * m_InvCellSize), -MAX_CELL_COORD, MAX_CELL_COORD);
+	OutCoords[2] = (int)std::clamp(floorf(Point.z * m_InvCellSize), -MAX_CELL_COORD, MAX_CELL_COORD);
+}
+
+UINT SpatialHash::FindCell(int X, int Y, int Z) const
+{
+	auto Found = m_CellLookup.find({ X, Y, Z });
+	return Found != m_CellLookup.end() ? Found->second : INVALID_CELL;
+}
+
+UINT SpatialHash::FindOrAddCell(int X, int Y, int Z)
+{
+	auto Inserted = m_CellLookup.try_emplace({ X, Y, Z }, (UINT)m_Cells.size());
+	if (Inserted.second)
+	{
+		Cell& C = m_Cells.emplace_back();
+		C.X = X;
+		C.Y = Y;
+		C.Z = Z;
+	}
+	return Inserted.first->second;
+}
+
+void SpatialHash::Link(UINT ProxyIndex)
+{
+	Proxy& P = m_Proxies[ProxyIndex];
+	const BVHBounds& Bounds = P.Bounds;
+	const float Extent = std::max(Bounds.Max.x - Bounds.Min.x, std::max(Bounds.Max.y - Bounds.Min.y, Bounds.Max.z - Bounds.Min.z));
+
+	// more than half a cell over on some side of whichever cell its center is in
+	if (Extent > m_CellSize)
+	{
+		P.Cell = OVERSIZED_CELL;
+		P.Slot = (UINT)m_Oversized.size();
+		m_Oversized.push_back(ProxyIndex);
+		return;
+	}
+
+	int Coords[3];
+	GetCellCoords(Bounds.Center(), Coords);
+	P.Cell = FindOrAddCell(Coords[0], Coords[1], Coords[2]);
+	std::vector<UINT>& Proxies = m_Cells[P.Cell].Proxies;
+	P.Slot = (UINT)Proxies.size();
+	Proxies.push_back(ProxyIndex);
+}
+
+void SpatialHash::Unlink(UINT ProxyIndex)
+{
+	const Proxy& P = m_Proxies[ProxyIndex];
+	std::vector<UINT>& Proxies = P.Cell == OVERSIZED_CELL ? m_Oversized : m_Cells[P.Cell].Proxies;
+
+	const UINT Last = Proxies.back();
+	Proxies[P.Slot] = Last;
+	m_Proxies[Last].Slot = P.Slot;
+	Proxies.pop_back();
+}
+
+void SpatialHash::GetLooseCellRange(const BVHBounds& Range, int* OutMin, int* OutMax) const
+{
+	// an item in cell k lies strictly inside [k - 0.5, k + 1.5) cells, so cells up to half a cell beyond the range can reach into it
+	const float Margin = m_CellSize * 0.5f;
+	GetCellCoords({ Range.Min.x - Margin, Range.Min.y - Margin, Range.Min.z - Margin }, OutMin);
+	GetCellCoords({ Range.Max.x + Margin, Range.Max.y + Margin, Range.Max.z + Margin }, OutMax);
+}
+
+BVHBounds SpatialHash::GetLooseCellBounds(const Cell& C) const
+{
+	const float Margin = m_CellSize * 0.5f;
+	BVHBounds Bounds;
+	Bounds.Min = { C.X * m_CellSize - Margin, C.Y * m_CellSize - Margin, C.Z * m_CellSize - Margin };
+	Bounds.Max = { (C.X + 1) * m_CellSize + Margin, (C.Y + 1) * m_CellSize + Margin, (C.Z + 1) * m_CellSize + Margin };
+	return Bounds;
+}
+
+size_t SpatialHash::CellKeyHash::operator()(const CellKey& Key) const
+{
+	// large primes per axis mixed into 64 bits, neighbouring cells spread over the buckets instead of landing next to each other
+	const unsigned long long h = (unsigned long long)(unsigned int)Key.X * 73856093ull ^ (unsigned long long)(unsigned int)Key.Y * 19349663ull ^
+		(unsigned long long)(unsigned int)Key.Z * 83492791ull;
+	return (size_t)(h ^ (h >> 29));
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#ifndef SPATIAL_HASH_H
+#define SPATIAL_HASH_H
+
+#include <vector>
+#include <unordered_map>
+
+#include "DirectXMath.h"
+
+#include "SceneBVH.h"
+#include "Frustum.h"
+
+typedef unsigned int UINT;
+
+/*
+*	Loose uniform grid over world space item bounds, stored sparsely in a hash map so the world has no fixed extent. Every item lives
+*	in exactly one cell, the one its center falls in, and is only required to fit inside that cell grown by half a cell on every side.
+*	Moving an item is O(1): if its center stays in the same cell only the bounds are written, otherwise it is swapped out of one cell
+*	list and appended to another. Queries grow their range by the same half cell so nothing hanging over a cell border is missed, then
+*	test the exact item bounds. Items too large for the looseness go in a short list every query checks. Range, radius and frustum
+*	queries append the user data of every item they hit, ray queries return the nearest hit. Pure CPU, no device needed.
+*/
+
+class SpatialHash
+{
+private:
+	struct Cell
+	{
+		int X;
+		int Y;
+		int Z;
+		std::vector<UINT> Proxies;
+		mutable UINT QueryStamp = 0u;	// ray queries visit neighbours of every cell they step through, this keeps them to once
+	};
+
+	// full cell coordinates, so cells far apart can never share a key
+	struct CellKey
+	{
+		int X;
+		int Y;
+		int Z;
+
+		bool operator==(const CellKey& Other) const { return X == Other.X && Y == Other.Y && Z == Other.Z; }
+	};
+
+	struct CellKeyHash
+	{
+		size_t operator()(const CellKey& Key) const;
+	};
+
+	struct Proxy
+	{
+		BVHBounds Bounds;
+		UINT UserData;
+		UINT Cell;		// INVALID_CELL for free proxies, OVERSIZED_CELL for the oversized list
+		UINT Slot;		// position in the cell's list
+	};
+
+public:
+	static const UINT INVALID_PROXY = 0xFFFFFFFF;
+
+public:
+	explicit SpatialHash(float CellSize = 8.f);
+
+	// returns the proxy the item is updated and removed through, UserData is what the queries report
+	UINT Insert(const BVHBounds& Bounds, UINT UserData);
+	// returns true if the item changed cell
+	bool Update(UINT Proxy, const BVHBounds& Bounds);
+	void Remove(UINT Proxy);
+	// also forgets the cell size, empty cells and the world bounds
+	void Clear(float CellSize);
+
+	// all append to OutUserData, every item at most once
+	void QueryRange(const BVHBounds& Range, std::vector<UINT>& OutUserData) const;
+	void QueryRadius(const DirectX::XMFLOAT3& Center, float Radius, std::vector<UINT>& OutUserData) const;
+	void QueryFrustum(const Frustum& ViewFrustum, std::vector<UINT>& OutUserData) const;
+	// nearest item bounds hit within MaxDistance along the normalized Direction, false if there is none
+	bool QueryRay(const DirectX::XMFLOAT3& Origin, const DirectX::XMFLOAT3& Direction, float MaxDistance, UINT& OutUserData, float& OutDistance) const;
+
+	const BVHBounds& GetBounds(UINT Proxy) const { return m_Proxies[Proxy].Bounds; }
+	UINT GetUserData(UINT Proxy) const { return m_Proxies[Proxy].UserData; }
+	float GetCellSize() const { return m_CellSize; }
+	UINT GetCount() const { return m_Count; }
+	// cells that were ever used, empty ones are kept for reuse until Clear
+	UINT GetCellCount() const { return (UINT)m_Cells.size(); }
+	UINT GetOversizedCount() const { return (UINT)m_Oversized.size(); }
+	UINT GetLastCellsVisited() const { return m_LastCellsVisited; }
+
+private:
+	void GetCellCoords(const DirectX::XMFLOAT3& Point, int* OutCoords) const;
+	UINT FindCell(int X, int Y, int Z) const;
+	UINT FindOrAddCell(int X, int Y, int Z);
+	void Link(UINT ProxyIndex);
+	void Unlink(UINT ProxyIndex);
+	// cell coordinate range of every cell whose loose bounds can overlap Range
+	void GetLooseCellRange(const BVHBounds& Range, int* OutMin, int* OutMax) const;
+	BVHBounds GetLooseCellBounds(const Cell& C) const;
+
+	template<typename Visitor>
+	void VisitCells(const int* Min, const int* Max, Visitor&& Visit) const;
+
+private:
+	float m_CellSize;
+	float m_InvCellSize;
+
+	std::unordered_map<CellKey, UINT, CellKeyHash> m_CellLookup;
+	std::vector<Cell> m_Cells;
+	std::vector<Proxy> m_Proxies;
+	std::vector<UINT> m_FreeProxies;
+	std::vector<UINT> m_Oversized;
+	UINT m_Count = 0u;
+
+	// everything that was ever inserted fits inside, only grows until Clear. Rays are clipped to it so they cannot walk forever
+	BVHBounds m_WorldBounds;
+
+	mutable UINT m_QueryStamp = 0u;
+	mutable UINT m_LastCellsVisited = 0u;
+
+};
+
+#endif
@@ -0,0 +1,139 @@
+#include <random>
+
+#include "StressScene.h"
+#include "SceneFile.h"
+
+// cheap integer hash for the per frame moves, seeding a generator per instance would cost more than the move itself
+static UINT HashUINT(UINT x)
+{
+	x ^= x >> 16;
+	x *= 0x7feb352du;
+	x ^= x >> 15;
+	x *= 0x846ca68bu;
+	x ^= x >> 16;
+	return x;
+}
+
+static float HashToUnit(UINT x)
+{
+	return (float)(HashUINT(x) >> 8) / 16777216.f;
+}
+
+void StressScene::Generate(const StressSceneParams& Params)
+{
+	m_Params = Params;
+	m_Instances.clear();
+	m_PointLights.clear();
+	m_DirectionalLights.clear();
+	m_ChunkOffsets.clear();
+	m_GrassOffsets.clear();
+
+	std::mt19937 Generator(Params.Seed);
+	const float HalfWorld = GetWorldSize() * 0.5f;
+	std::uniform_real_distribution<float> Horizontal(-HalfWorld, HalfWorld);
+	std::uniform_real_distribution<float> Vertical(0.f, 20.f);
+	std::uniform_real_distribution<float> Rotation(0.f, 360.f);
+	std::uniform_real_distribution<float> Scale(0.5f, 2.f);
+	std::uniform_real_distribution<float> Unit(0.f, 1.f);
+	const UINT ModelCount = Params.ModelCount > 0u ? Params.ModelCount : 1u;
+
+	m_Instances.reserve(Params.InstanceCount);
+	for (UINT i = 0u; i < Params.InstanceCount; i++)
+	{
+		Instance I;
+		I.Position = { Horizontal(Generator), Vertical(Generator), Horizontal(Generator) };
+		I.Rotation = { 0.f, Rotation(Generator), 0.f };
+		const float s = Scale(Generator);
+		I.Scale = { s, s, s };
+		I.ModelIndex = Generator() % ModelCount;
+		m_Instances.push_back(I);
+	}
+
+	for (UINT i = 0u; i < Params.PointLightCount; i++)
+	{
+		m_PointLights.push_back({ { Horizontal(Generator), 5.f + Vertical(Generator), Horizontal(Generator) },
+			{ Unit(Generator), Unit(Generator), Unit(Generator) }, 5.f + Unit(Generator) * 25.f });
+	}
+
+	for (UINT i = 0u; i < Params.DirectionalLightCount; i++)
+	{
+		m_DirectionalLights.push_back({ Unit(Generator) * 2.f - 1.f, -1.f, Unit(Generator) * 2.f - 1.f });
+	}
+
+	const float HalfCount = (float)Params.ChunkDimension / 2.f;
+	for (UINT z = 0u; z < Params.ChunkDimension; z++)
+	{
+		for (UINT x = 0u; x < Params.ChunkDimension; x++)
+		{
+			m_ChunkOffsets.push_back({ ((int)x - HalfCount) * Params.ChunkSize + Params.ChunkSize * 0.5f, ((int)z - HalfCount) * Params.ChunkSize + Params.ChunkSize * 0.5f });
+		}
+	}
+
+	const UINT Blades = Params.GrassBladesPerAxis;
+	if (Blades <= 1u)
+	{
+		m_GrassOffsets.push_back({ 0.f, 0.f });
+		return;
+	}
+
+	const float Spacing = Params.ChunkSize / (float)Blades;
+	std::uniform_real_distribution<float> Jitter(0.f, Spacing);
+	for (UINT x = 0u; x < Blades; x++)
+	{
+		for (UINT z = 0u; z < Blades; z++)
+		{
+			m_GrassOffsets.push_back({ -Params.ChunkSize * 0.5f + x * Spacing + Jitter(Generator), -Params.ChunkSize * 0.5f + z * Spacing + Jitter(Generator) });
+		}
+	}
+}
+
+void StressScene::BuildSceneFile(SceneFile& Out, const std::vector<std::pair<std::string, std::string>>& Models) const
+{
+	for (UINT i = 0u; i < (UINT)m_Instances.size(); i++)
+	{
+		const Instance& I = m_Instances[i];
+		const UINT Object = Out.AddNode(SceneNodeType::GameObject, INVALID_SCENE_NODE, "Stress_" + std::to_string(i), nullptr);
+		Out.SetNodeTransform(Object, I.Position, I.Rotation, I.Scale);
+
+		if (!Models.empty())
+		{
+			const std::pair<std::string, std::string>& Paths = Models[I.ModelIndex % Models.size()];
+			Out.SetNodeModel(Out.AddNode(SceneNodeType::Model, Object, "", nullptr), Paths.first, Paths.second);
+		}
+	}
+
+	for (UINT i = 0u; i < (UINT)m_PointLights.size(); i++)
+	{
+		const PointLightDesc& L = m_PointLights[i];
+		const UINT Object = Out.AddNode(SceneNodeType::GameObject, INVALID_SCENE_NODE, "Stress_PointLight_" + std::to_string(i), nullptr);
+		Out.SetNodeTransform(Object, L.Position, { 0.f, 0.f, 0.f }, { 1.f, 1.f, 1.f });
+		Out.SetNodeLight(Out.AddNode(SceneNodeType::PointLight, Object, "", nullptr), L.Color, L.Radius, { 0.f, 0.f, 0.f });
+	}
+
+	for (UINT i = 0u; i < (UINT)m_DirectionalLights.size(); i++)
+	{
+		const UINT Object = Out.AddNode(SceneNodeType::GameObject, INVALID_SCENE_NODE, "Stress_DirectionalLight_" + std::to_string(i), nullptr);
+		Out.SetNodeLight(Out.AddNode(SceneNodeType::DirectionalLight, Object, "", nullptr), { 1.f, 1.f, 1.f }, 0.f, m_DirectionalLights[i]);
+	}
+}
+
+void StressScene::GetFrameMoves(UINT Frame, std::vector<std::pair<UINT, DirectX::XMFLOAT3>>& OutMoves) const
+{
+	OutMoves.clear();
+	const UINT Count = (UINT)m_Instances.size();
+	const UINT MoveCount = (UINT)((float)Count * m_Params.MovingFraction);
+	if (Count == 0u)
+		return;
+
+	for (UINT i = 0u; i < MoveCount; i++)
+	{
+		const UINT Hash = HashUINT(m_Params.Seed ^ HashUINT(Frame * MoveCount + i));
+		OutMoves.push_back({ Hash % Count, RandomPosition(Hash) });
+	}
+}
+
+DirectX::XMFLOAT3 StressScene::RandomPosition(UINT Hash) const
+{
+	const float World = GetWorldSize();
+	return { (HashToUnit(Hash + 1u) - 0.5f) * World, HashToUnit(Hash + 2u) * 20.f, (HashToUnit(Hash + 3u) - 0.5f) * World };
+}
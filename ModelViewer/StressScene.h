@@ -0,0 +1,85 @@
+#pragma once
+
+#ifndef STRESS_SCENE_H
+#define STRESS_SCENE_H
+
+#include <string>
+#include <vector>
+
+#include "DirectXMath.h"
+
+typedef unsigned int UINT;
+
+class SceneFile;
+
+struct StressSceneParams
+{
+	UINT InstanceCount = 10000u;
+	UINT ModelCount = 4u;
+	UINT PointLightCount = 16u;
+	UINT DirectionalLightCount = 1u;
+	UINT ChunkDimension = 32u;		// landscape chunks per axis
+	float ChunkSize = 25.f;
+	UINT GrassBladesPerAxis = 32u;	// per chunk
+	float MovingFraction = 0.05f;	// instances moved every frame
+	UINT Seed = 1337u;
+};
+
+/*
+*	Procedural scene for scaling measurements: InstanceCount objects spread over the landscape, each with one of ModelCount models,
+*	plus point and directional lights and the chunk and grass layout of a landscape of the given size. The same parameters and seed
+*	always give the same scene. BuildSceneFile turns it into a scene the application can load, the headless benchmarks use the
+*	arrays directly. Pure CPU, no device needed.
+*/
+
+class StressScene
+{
+public:
+	struct Instance
+	{
+		DirectX::XMFLOAT3 Position;
+		DirectX::XMFLOAT3 Rotation;
+		DirectX::XMFLOAT3 Scale;
+		UINT ModelIndex;
+	};
+
+	struct PointLightDesc
+	{
+		DirectX::XMFLOAT3 Position;
+		DirectX::XMFLOAT3 Color;
+		float Radius;
+	};
+
+public:
+	void Generate(const StressSceneParams& Params);
+
+	// model and textures path pairs, handed out round robin when there are fewer pairs than models
+	void BuildSceneFile(SceneFile& Out, const std::vector<std::pair<std::string, std::string>>& Models) const;
+
+	// a new position for MovingFraction of the instances, the same ones in the same order for a given frame
+	void GetFrameMoves(UINT Frame, std::vector<std::pair<UINT, DirectX::XMFLOAT3>>& OutMoves) const;
+
+	const StressSceneParams& GetParams() const { return m_Params; }
+	const std::vector<Instance>& GetInstances() const { return m_Instances; }
+	const std::vector<PointLightDesc>& GetPointLights() const { return m_PointLights; }
+	const std::vector<DirectX::XMFLOAT3>& GetDirectionalLights() const { return m_DirectionalLights; }
+	// the layouts of Landscape::GenerateChunkOffsets and Landscape::GenerateGrassOffsets
+	const std::vector<DirectX::XMFLOAT2>& GetChunkOffsets() const { return m_ChunkOffsets; }
+	const std::vector<DirectX::XMFLOAT2>& GetGrassOffsets() const { return m_GrassOffsets; }
+	float GetWorldSize() const { return (float)m_Params.ChunkDimension * m_Params.ChunkSize; }
+
+private:
+	DirectX::XMFLOAT3 RandomPosition(UINT Hash) const;
+
+private:
+	StressSceneParams m_Params;
+
+	std::vector<Instance> m_Instances;
+	std::vector<PointLightDesc> m_PointLights;
+	std::vector<DirectX::XMFLOAT3> m_DirectionalLights;
+	std::vector<DirectX::XMFLOAT2> m_ChunkOffsets;
+	std::vector<DirectX::XMFLOAT2> m_GrassOffsets;
+
+};
+
+#endif
@@ -0,0 +1,145 @@
+#include "TemporalFrustumCuller.h"
+
+#include <cmath>
+#include <cstring>
+
+TemporalFrustumCuller::TemporalFrustumCuller()
+{
+	m_bHasPass = false;
+	m_TranslationThreshold = 1.f;
+	m_RotationThreshold = DirectX::XMConvertToRadians(2.f);
+	m_LastTestsRun = 0u;
+	m_LastTestsSkipped = 0u;
+	m_FullPassCount = 0u;
+}
+
+void TemporalFrustumCuller::Reset()
+{
+	m_bHasPass = false;
+}
+
+void TemporalFrustumCuller::SetThresholds(float TranslationThreshold, float RotationThreshold)
+{
+	m_TranslationThreshold = TranslationThreshold;
+	m_RotationThreshold = RotationThreshold;
+}
+
+UINT TemporalFrustumCuller::Cull(const DirectX::XMMATRIX* Transforms, UINT Count, const AABB& BBox, const DirectX::XMMATRIX& View, const DirectX::XMMATRIX& Proj)
+{
+	m_Frustum.Extract(View * Proj);
+	DirectX::XMStoreFloat3(&m_CameraPos, DirectX::XMMatrixInverse(nullptr, View).r[3]);
+
+	const DirectX::XMFLOAT3 Center = { (BBox.Min.x + BBox.Max.x) * 0.5f, (BBox.Min.y + BBox.Max.y) * 0.5f, (BBox.Min.z + BBox.Max.z) * 0.5f };
+	const DirectX::XMFLOAT3 Extent = { (BBox.Max.x - BBox.Min.x) * 0.5f, (BBox.Max.y - BBox.Min.y) * 0.5f, (BBox.Max.z - BBox.Min.z) * 0.5f };
+
+	DirectX::XMFLOAT4X4 ViewF, ProjF;
+	DirectX::XMStoreFloat4x4(&ViewF, View);
+	DirectX::XMStoreFloat4x4(&ProjF, Proj);
+
+	bool bNewPass = !m_bHasPass || Count != (UINT)m_Records.size() || memcmp(&ProjF, &m_PassProj, sizeof(ProjF)) != 0 ||
+		memcmp(&Center, &m_BoundsCenter, sizeof(Center)) != 0 || memcmp(&Extent, &m_BoundsExtent, sizeof(Extent)) != 0;
+
+	float Translation = 0.f;
+	float Rotation = 0.f;
+	if (!bNewPass)
+	{
+		const float dx = m_CameraPos.x - m_PassCameraPos.x;
+		const float dy = m_CameraPos.y - m_PassCameraPos.y;
+		const float dz = m_CameraPos.z - m_PassCameraPos.z;
+		Translation = sqrtf(dx * dx + dy * dy + dz * dz);
+
+		// how far any unit vector, plane normals included, can have turned between the two views. The Frobenius norm of the
+		// difference bounds that and stays accurate for tiny angles where going through the trace and acos does not
+		float Difference = 0.f;
+		for (int r = 0; r < 3; r++)
+			for (int c = 0; c < 3; c++)
+				Difference += (m_PassView.m[r][c] - ViewF.m[r][c]) * (m_PassView.m[r][c] - ViewF.m[r][c]);
+		Rotation = sqrtf(Difference);
+
+		// the norm is 2 * sqrt(2) * sin(angle / 2) for a rotation
+		const float Angle = 2.f * asinf(Rotation / (2.f * sqrtf(2.f)) > 1.f ? 1.f : Rotation / (2.f * sqrtf(2.f)));
+		bNewPass = Translation > m_TranslationThreshold || Angle > m_RotationThreshold;
+	}
+
+	if (bNewPass)
+	{
+		m_PassView = ViewF;
+		m_PassProj = ProjF;
+		m_PassCameraPos = m_CameraPos;
+		m_BoundsCenter = Center;
+		m_BoundsExtent = Extent;
+		m_Records.resize(Count);
+		m_CachedTransforms.assign(Transforms, Transforms + Count);
+		m_bHasPass = true;
+		m_FullPassCount++;
+		Translation = 0.f;
+		Rotation = 0.f;
+	}
+
+	m_VisibleIndices.clear();
+	m_LastTestsRun = 0u;
+	m_LastTestsSkipped = 0u;
+
+	for (UINT i = 0u; i < Count; i++)
+	{
+		InstanceRecord& Record = m_Records[i];
+		const bool bUnchanged = !bNewPass && memcmp(&m_CachedTransforms[i], &Transforms[i], sizeof(DirectX::XMMATRIX)) == 0;
+
+		if (bUnchanged && (Record.bVisible || Record.Margin > Translation + Rotation * Record.Reach))
+		{
+			m_LastTestsSkipped++;
+		}
+		else
+		{
+			if (!bUnchanged)
+				m_CachedTransforms[i] = Transforms[i];
+
+			TestInstance(Transforms[i], Record, Translation, Rotation);
+			m_LastTestsRun++;
+		}
+
+		if (Record.bVisible)
+			m_VisibleIndices.push_back(i);
+	}
+
+	return (UINT)m_VisibleIndices.size();
+}
+
+void TemporalFrustumCuller::TestInstance(const DirectX::XMMATRIX& Transform, InstanceRecord& Record, float Translation, float Rotation) const
+{
+	DirectX::XMFLOAT4X4 t;
+	DirectX::XMStoreFloat4x4(&t, Transform);
+
+	// transforms are stored transposed, row n holds the coefficients for world axis n
+	float Center[3], Extent[3];
+	for (int Axis = 0; Axis < 3; Axis++)
+	{
+		Center[Axis] = t.m[Axis][0] * m_BoundsCenter.x + t.m[Axis][1] * m_BoundsCenter.y + t.m[Axis][2] * m_BoundsCenter.z + t.m[Axis][3];
+		Extent[Axis] = fabsf(t.m[Axis][0]) * m_BoundsExtent.x + fabsf(t.m[Axis][1]) * m_BoundsExtent.y + fabsf(t.m[Axis][2]) * m_BoundsExtent.z;
+	}
+
+	const float dx = Center[0] - m_CameraPos.x;
+	const float dy = Center[1] - m_CameraPos.y;
+	const float dz = Center[2] - m_CameraPos.z;
+	Record.Reach = sqrtf(dx * dx + dy * dy + dz * dz) + sqrtf(Extent[0] * Extent[0] + Extent[1] * Extent[1] + Extent[2] * Extent[2]);
+
+	for (unsigned char k = 0u; k < 6u; k++)
+	{
+		const unsigned char p = (unsigned char)((Record.LastPlane + k) % 6u);
+		const DirectX::XMFLOAT4& Plane = m_Frustum.GetPlane(p);
+
+		const float Distance = Plane.x * Center[0] + Plane.y * Center[1] + Plane.z * Center[2] + Plane.w;
+		const float Radius = fabsf(Plane.x) * Extent[0] + fabsf(Plane.y) * Extent[1] + fabsf(Plane.z) * Extent[2];
+		if (Distance + Radius < 0.f)
+		{
+			// later frames check the margin against the movement since the pass started, taking off the movement made up to
+			// now covers the camera moving back the other way
+			Record.bVisible = 0u;
+			Record.LastPlane = p;
+			Record.Margin = -(Distance + Radius) - (Translation + Rotation * Record.Reach);
+			return;
+		}
+	}
+
+	Record.bVisible = 1u;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#ifndef TEMPORAL_FRUSTUM_CULLER_H
+#define TEMPORAL_FRUSTUM_CULLER_H
+
+#include <vector>
+
+#include "DirectXMath.h"
+
+#include "AABB.h"
+#include "Frustum.h"
+
+typedef unsigned int UINT;
+
+/*
+*	Frustum culling that keeps a record per instance between frames. Each record stores whether the instance was visible, the plane
+*	that rejected it last time (tested first next time, most instances fail the same plane again) and how far outside that plane it
+*	was. While the camera stays within the movement thresholds since the last full pass, instances with unchanged transforms skip
+*	the test: visible ones stay visible and culled ones stay culled as long as their margin is bigger than the distance the camera
+*	movement could have shifted them by. Going over a threshold starts a new full pass. Results only ever err towards visible.
+*	Pure CPU, the non temporal reference is CPUFrustumCuller.
+*/
+
+class TemporalFrustumCuller
+{
+private:
+	struct InstanceRecord
+	{
+		float Margin;		// distance outside LastPlane, already reduced by the camera movement at the time of the test
+		float Reach;		// distance from the camera to the far side of the bounds, scales the rotation bound
+		unsigned char LastPlane;
+		unsigned char bVisible;
+	};
+
+public:
+	TemporalFrustumCuller();
+
+	// Transforms in the same (transposed) layout as ModelData::m_Transforms
+	UINT Cull(const DirectX::XMMATRIX* Transforms, UINT Count, const AABB& BBox, const DirectX::XMMATRIX& View, const DirectX::XMMATRIX& Proj);
+	void Reset();
+
+	// world units and radians of camera movement since the last full pass before everything is tested again
+	void SetThresholds(float TranslationThreshold, float RotationThreshold);
+
+	const std::vector<UINT>& GetVisibleIndices() const { return m_VisibleIndices; }
+	UINT GetLastTestsRun() const { return m_LastTestsRun; }
+	UINT GetLastTestsSkipped() const { return m_LastTestsSkipped; }
+	UINT GetFullPassCount() const { return m_FullPassCount; }
+
+private:
+	void TestInstance(const DirectX::XMMATRIX& Transform, InstanceRecord& Record, float Translation, float Rotation) const;
+
+private:
+	std::vector<InstanceRecord> m_Records;
+	std::vector<DirectX::XMMATRIX> m_CachedTransforms;
+	std::vector<UINT> m_VisibleIndices;
+
+	Frustum m_Frustum;
+	DirectX::XMFLOAT3 m_CameraPos;
+	DirectX::XMFLOAT3 m_BoundsCenter;
+	DirectX::XMFLOAT3 m_BoundsExtent;
+
+	// camera at the start of the current pass, movement is measured against this
+	DirectX::XMFLOAT4X4 m_PassView;
+	DirectX::XMFLOAT4X4 m_PassProj;
+	DirectX::XMFLOAT3 m_PassCameraPos;
+	bool m_bHasPass;
+
+	float m_TranslationThreshold;
+	float m_RotationThreshold;
+
+	UINT m_LastTestsRun;
+	UINT m_LastTestsSkipped;
+	UINT m_FullPassCount;
+
+};
+
+#endif
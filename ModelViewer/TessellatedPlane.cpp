@@ -57,9 +57,6 @@ bool TessellatedPlane::Init(float TessellationScale, Landscape* pLandscape)
 
 void TessellatedPlane::Render()
 {
-	Application* pApp = Application::GetSingletonPtr();
-	pApp->GetFrustumCuller()->SendInstanceCount(m_ArgsBufferUAV);
-
 	Graphics::GetSingletonPtr()->EnableDepthWrite();
 	Graphics::GetSingletonPtr()->DisableBlending();
 	UpdateBuffers();
@@ -74,7 +71,7 @@ void TessellatedPlane::Render()
 	DeviceContext->IASetVertexBuffers(0u, 1u, m_VertexBuffer.GetAddressOf(), Strides, Offsets);
 	DeviceContext->IASetIndexBuffer(m_IndexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0u);
 
-	ID3D11ShaderResourceView* vsSRVs[] = { m_pLandscape->m_HeightmapSRV, pApp->GetFrustumCuller()->GetCulledOffsetsSRV().Get() };
+	ID3D11ShaderResourceView* vsSRVs[] = { m_pLandscape->m_HeightmapSRV, m_pLandscape->m_VisibleOffsetsSRV.Get() };
 	DeviceContext->VSSetShader(m_VertexShader, nullptr, 0u);
 	DeviceContext->VSSetConstantBuffers(0u, 1u, m_pLandscape->m_LandscapeInfoCBuffer.GetAddressOf());
 	DeviceContext->VSSetShaderResources(0u, 2u, vsSRVs);
@@ -98,7 +95,7 @@ void TessellatedPlane::Render()
 	DeviceContext->PSSetSamplers(0u, 1u, pGraphics->GetSamplerState().GetAddressOf());
 
 	DeviceContext->Begin(pGraphics->GetPipelineStatsQuery().Get());
-	DeviceContext->DrawIndexedInstancedIndirect(m_ArgsBuffer.Get(), 0u);
+	DeviceContext->DrawIndexedInstanced(_countof(ChunkIndices), m_pLandscape->m_ChunkInstanceCount, 0u, 0, 0u);
 	DeviceContext->End(pGraphics->GetPipelineStatsQuery().Get());
 	Application::GetSingletonPtr()->GetRenderStatsRef().DrawCalls++;
 
@@ -201,34 +198,6 @@ bool TessellatedPlane::CreateBuffers()
 
 	HFALSE_IF_FAILED(Graphics::GetSingletonPtr()->GetDevice()->CreateBuffer(&Desc, nullptr, &m_HullCBuffer));
 	NAME_D3D_RESOURCE(m_HullCBuffer, "Tessellated plane hull constant buffer");
-
-	Desc = {};
-	Desc.ByteWidth = sizeof(D3D11_DRAW_INDEXED_INSTANCED_INDIRECT_ARGS);
-	Desc.Usage = D3D11_USAGE_DEFAULT;
-	Desc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
-	Desc.MiscFlags = D3D11_RESOURCE_MISC_DRAWINDIRECT_ARGS | D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
-
-	D3D11_DRAW_INDEXED_INSTANCED_INDIRECT_ARGS ArgsData;
-	ArgsData.IndexCountPerInstance = sizeof(ChunkIndices) / sizeof(UINT);
-	ArgsData.InstanceCount = 0u;
-	ArgsData.StartIndexLocation = 0u;
-	ArgsData.BaseVertexLocation = 0;
-	ArgsData.StartInstanceLocation = 0u;
-
-	Data = {};
-	Data.pSysMem = &ArgsData;
-
-	HFALSE_IF_FAILED(Graphics::GetSingletonPtr()->GetDevice()->CreateBuffer(&Desc, &Data, &m_ArgsBuffer));
-	NAME_D3D_RESOURCE(m_ArgsBuffer, "Tessellated plane args buffer");
-
-	D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
-	uavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
-	uavDesc.Format = DXGI_FORMAT_R32_TYPELESS;
-	uavDesc.Buffer.Flags = D3D11_BUFFER_UAV_FLAG_RAW;
-	uavDesc.Buffer.NumElements = sizeof(D3D11_DRAW_INDEXED_INSTANCED_INDIRECT_ARGS) / 4;
-
-	HFALSE_IF_FAILED(Graphics::GetSingletonPtr()->GetDevice()->CreateUnorderedAccessView(m_ArgsBuffer.Get(), &uavDesc, &m_ArgsBufferUAV));
-	NAME_D3D_RESOURCE(m_ArgsBufferUAV, "Tessellated plane args buffer UAV");
 	
 	return true;
 }
@@ -0,0 +1,130 @@
+#include <algorithm>
+
+#include "ThreadPool.h"
+
+ThreadPool* ThreadPool::ms_Instance = nullptr;
+
+ThreadPool* ThreadPool::GetSingletonPtr()
+{
+	if (!ThreadPool::ms_Instance)
+	{
+		ThreadPool::ms_Instance = new ThreadPool();
+	}
+	return ThreadPool::ms_Instance;
+}
+
+ThreadPool::ThreadPool()
+{
+	// calling thread also works on batches, so leave a core for it
+	UINT WorkerCount = std::max(1u, std::thread::hardware_concurrency()) - 1u;
+	for (UINT i = 0u; i < WorkerCount; i++)
+	{
+		m_Workers.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+void ThreadPool::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> Lock(m_WakeMutex);
+		m_bShuttingDown = true;
+	}
+	m_WakeCondition.notify_all();
+
+	for (std::thread& Worker : m_Workers)
+	{
+		if (Worker.joinable())
+			Worker.join();
+	}
+	m_Workers.clear();
+}
+
+void ThreadPool::ParallelFor(UINT Count, UINT BatchSize, const std::function<void(UINT Begin, UINT End)>& Func, UINT MaxThreads)
+{
+	if (Count == 0u)
+		return;
+
+	BatchSize = std::max(1u, BatchSize);
+	const UINT BatchCount = (Count + BatchSize - 1u) / BatchSize;
+
+	// not worth waking anyone up
+	if (BatchCount == 1u || m_Workers.empty() || MaxThreads == 1u)
+	{
+		Func(0u, Count);
+		return;
+	}
+
+	std::lock_guard<std::mutex> JobLock(m_JobMutex);
+
+	Job CurrentJob;
+	CurrentJob.pFunc = &Func;
+	CurrentJob.Count = Count;
+	CurrentJob.BatchSize = BatchSize;
+	CurrentJob.MaxWorkers = MaxThreads == 0u ? (UINT)m_Workers.size() : MaxThreads - 1u;
+	CurrentJob.NextIndex = 0u;
+	CurrentJob.PendingBatches = BatchCount;
+	CurrentJob.ActiveWorkers = 0u;
+	{
+		std::lock_guard<std::mutex> Lock(m_WakeMutex);
+		m_pJob = &CurrentJob;
+		m_JobGeneration++;
+	}
+	m_WakeCondition.notify_all();
+
+	RunBatches(CurrentJob);
+
+	// once the job is cleared under the lock no worker can join it, and every worker that did has left
+	std::unique_lock<std::mutex> Lock(m_WakeMutex);
+	m_DoneCondition.wait(Lock, [&]() { return CurrentJob.PendingBatches == 0u && CurrentJob.ActiveWorkers == 0u; });
+	m_pJob = nullptr;
+}
+
+void ThreadPool::WorkerLoop()
+{
+	UINT SeenGeneration = 0u;
+	while (true)
+	{
+		Job* pJob;
+		{
+			std::unique_lock<std::mutex> Lock(m_WakeMutex);
+			m_WakeCondition.wait(Lock, [&]() { return m_bShuttingDown || SeenGeneration != m_JobGeneration; });
+			if (m_bShuttingDown)
+				return;
+
+			// the job was already finished and cleared, or has all the workers it may have
+			SeenGeneration = m_JobGeneration;
+			pJob = m_pJob;
+			if (!pJob || pJob->ActiveWorkers >= pJob->MaxWorkers)
+				continue;
+
+			pJob->ActiveWorkers++;
+		}
+
+		RunBatches(*pJob);
+
+		{
+			std::lock_guard<std::mutex> Lock(m_WakeMutex);
+			pJob->ActiveWorkers--;
+		}
+		m_DoneCondition.notify_all();
+	}
+}
+
+void ThreadPool::RunBatches(Job& CurrentJob)
+{
+	while (true)
+	{
+		UINT Begin = CurrentJob.NextIndex.fetch_add(CurrentJob.BatchSize);
+		if (Begin >= CurrentJob.Count)
+			return;
+
+		UINT End = std::min(Begin + CurrentJob.BatchSize, CurrentJob.Count);
+		(*CurrentJob.pFunc)(Begin, End);
+
+		if (CurrentJob.PendingBatches.fetch_sub(1u) == 1u)
+		{
+			std::lock_guard<std::mutex> Lock(m_WakeMutex);
+			m_DoneCondition.notify_all();
+		}
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+
+typedef unsigned int UINT;
+
+/*
+*	Fixed set of worker threads for data parallel loops. ParallelFor splits [0, Count) into batches that workers (and the calling
+*	thread) pull from until everything is done, and only returns once every batch has finished. One loop runs at a time. Every loop
+*	has its own job with its own counters, a worker only joins the job current when it takes the lock and a worker waking up late
+*	for a job that has finished leaves without touching anything. A loop can be held to fewer threads than the pool has, the
+*	workers over the limit sit it out.
+*/
+
+class ThreadPool
+{
+private:
+	ThreadPool();
+
+	static ThreadPool* ms_Instance;
+
+public:
+	static ThreadPool* GetSingletonPtr();
+
+	void Shutdown();
+
+	// MaxThreads counts the calling thread, 0 uses every worker
+	void ParallelFor(UINT Count, UINT BatchSize, const std::function<void(UINT Begin, UINT End)>& Func, UINT MaxThreads = 0u);
+
+	UINT GetWorkerCount() const { return (UINT)m_Workers.size(); }
+
+private:
+	// one ParallelFor call, lives on the caller's stack until every worker that joined it has left
+	struct Job
+	{
+		const std::function<void(UINT, UINT)>* pFunc;
+		UINT Count;
+		UINT BatchSize;
+		UINT MaxWorkers;
+		std::atomic<UINT> NextIndex;
+		std::atomic<UINT> PendingBatches;
+		UINT ActiveWorkers;		// guarded by m_WakeMutex, the caller can't return until this is back to 0
+	};
+
+	void WorkerLoop();
+	void RunBatches(Job& CurrentJob);
+
+private:
+	std::vector<std::thread> m_Workers;
+	std::mutex m_JobMutex;		// serialises ParallelFor calls
+	std::mutex m_WakeMutex;
+	std::condition_variable m_WakeCondition;
+	std::condition_variable m_DoneCondition;
+
+	Job* m_pJob = nullptr;		// guarded by m_WakeMutex, null between loops
+	UINT m_JobGeneration = 0u;
+
+	bool m_bShuttingDown = false;
+
+};
+
+#endif
@@ -0,0 +1,426 @@
+#include <cstring>
+
+#include "TransformStore.h"
+#include "ThreadPool.h"
+
+TransformStore* TransformStore::ms_Instance = nullptr;
+
+static DirectX::XMVECTOR LoadFour(const float* p)
+{
+	return DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*>(p));
+}
+
+// element i of the sorted order is element Order[i] of the old one, anything past Order (the padding) stays where it is
+template<typename T>
+static void Permute(std::vector<T>& Values, const std::vector<UINT>& Order)
+{
+	std::vector<T> Sorted(Values.size());
+	for (UINT i = 0u; i < (UINT)Order.size(); i++)
+	{
+		Sorted[i] = Values[Order[i]];
+	}
+	for (UINT i = (UINT)Order.size(); i < (UINT)Values.size(); i++)
+	{
+		Sorted[i] = Values[i];
+	}
+	Values.swap(Sorted);
+}
+
+TransformStore::TransformStore()
+{
+	m_Count = 0u;
+	m_LastRecomputedCount = 0u;
+	m_LastReusedCount = 0u;
+	m_bHierarchyDirty = false;
+	m_bUseThreads = true;
+}
+
+TransformStore* TransformStore::GetSingletonPtr()
+{
+	if (!TransformStore::ms_Instance)
+	{
+		TransformStore::ms_Instance = new TransformStore();
+	}
+	return TransformStore::ms_Instance;
+}
+
+UINT TransformStore::Create()
+{
+	UINT ID;
+	if (!m_FreeIDs.empty())
+	{
+		ID = m_FreeIDs.back();
+		m_FreeIDs.pop_back();
+	}
+	else
+	{
+		ID = (UINT)m_IDToIndex.size();
+		m_IDToIndex.push_back(INVALID_ID);
+		m_ParentIDs.push_back(INVALID_ID);
+		m_FirstChildIDs.push_back(INVALID_ID);
+		m_NextSiblingIDs.push_back(INVALID_ID);
+		m_PrevSiblingIDs.push_back(INVALID_ID);
+	}
+
+	const UINT Index = m_Count;
+	Resize(m_Count + 1u);
+
+	m_PosX[Index] = m_PosY[Index] = m_PosZ[Index] = 0.f;
+	m_RotX[Index] = m_RotY[Index] = m_RotZ[Index] = 0.f;
+	m_ScaleX[Index] = m_ScaleY[Index] = m_ScaleZ[Index] = 1.f;
+	m_Parents[Index] = INVALID_ID;
+	MarkDirty(Index);
+
+	m_IDToIndex[ID] = Index;
+	m_IndexToID[Index] = ID;
+	m_ParentIDs[ID] = INVALID_ID;
+
+	// roots have to stay contiguous for the level by level parent pass
+	m_bHierarchyDirty = true;
+
+	return ID;
+}
+
+void TransformStore::Release(UINT ID)
+{
+	// children left behind become roots where they are, otherwise whatever reuses the id next would adopt them
+	for (UINT Child = m_FirstChildIDs[ID]; Child != INVALID_ID;)
+	{
+		const UINT Next = m_NextSiblingIDs[Child];
+		m_ParentIDs[Child] = INVALID_ID;
+		m_NextSiblingIDs[Child] = m_PrevSiblingIDs[Child] = INVALID_ID;
+		MarkDirty(m_IDToIndex[Child]);
+		Child = Next;
+	}
+	m_FirstChildIDs[ID] = INVALID_ID;
+	if (m_ParentIDs[ID] != INVALID_ID)
+		UnlinkChild(ID);
+
+	const UINT Index = m_IDToIndex[ID];
+	const UINT Last = m_Count - 1u;
+	if (Index != Last)
+	{
+		std::vector<float>* Streams[] = { &m_PosX, &m_PosY, &m_PosZ, &m_RotX, &m_RotY, &m_RotZ, &m_ScaleX, &m_ScaleY, &m_ScaleZ };
+		for (std::vector<float>* Stream : Streams)
+		{
+			(*Stream)[Index] = (*Stream)[Last];
+		}
+		m_Dirty[Index] = m_Dirty[Last];
+		m_LocalMatrices[Index] = m_LocalMatrices[Last];
+		m_WorldMatrices[Index] = m_WorldMatrices[Last];
+		m_TransposedWorldMatrices[Index] = m_TransposedWorldMatrices[Last];
+
+		const UINT MovedID = m_IndexToID[Last];
+		m_IndexToID[Index] = MovedID;
+		m_IDToIndex[MovedID] = Index;
+	}
+
+	Resize(Last);
+	m_IDToIndex[ID] = INVALID_ID;
+	m_ParentIDs[ID] = INVALID_ID;
+	m_FreeIDs.push_back(ID);
+	m_bHierarchyDirty = true;
+}
+
+void TransformStore::SetParent(UINT ID, UINT ParentID)
+{
+	if (m_ParentIDs[ID] == ParentID)
+		return;
+
+	if (m_ParentIDs[ID] != INVALID_ID)
+		UnlinkChild(ID);
+
+	m_ParentIDs[ID] = ParentID;
+	if (ParentID != INVALID_ID)
+	{
+		m_NextSiblingIDs[ID] = m_FirstChildIDs[ParentID];
+		m_PrevSiblingIDs[ID] = INVALID_ID;
+		if (m_FirstChildIDs[ParentID] != INVALID_ID)
+			m_PrevSiblingIDs[m_FirstChildIDs[ParentID]] = ID;
+		m_FirstChildIDs[ParentID] = ID;
+	}
+
+	MarkDirty(m_IDToIndex[ID]);
+	m_bHierarchyDirty = true;
+}
+
+void TransformStore::UnlinkChild(UINT ID)
+{
+	const UINT Prev = m_PrevSiblingIDs[ID];
+	const UINT Next = m_NextSiblingIDs[ID];
+	if (Prev != INVALID_ID)
+		m_NextSiblingIDs[Prev] = Next;
+	else
+		m_FirstChildIDs[m_ParentIDs[ID]] = Next;
+	if (Next != INVALID_ID)
+		m_PrevSiblingIDs[Next] = Prev;
+
+	m_NextSiblingIDs[ID] = m_PrevSiblingIDs[ID] = INVALID_ID;
+}
+
+void TransformStore::SetPosition(UINT ID, const DirectX::XMFLOAT3& Position)
+{
+	const UINT Index = m_IDToIndex[ID];
+	m_PosX[Index] = Position.x;
+	m_PosY[Index] = Position.y;
+	m_PosZ[Index] = Position.z;
+	MarkDirty(Index);
+}
+
+void TransformStore::SetRotation(UINT ID, const DirectX::XMFLOAT3& Rotation)
+{
+	const UINT Index = m_IDToIndex[ID];
+	m_RotX[Index] = Rotation.x;
+	m_RotY[Index] = Rotation.y;
+	m_RotZ[Index] = Rotation.z;
+	MarkDirty(Index);
+}
+
+void TransformStore::SetScale(UINT ID, const DirectX::XMFLOAT3& Scale)
+{
+	const UINT Index = m_IDToIndex[ID];
+	m_ScaleX[Index] = Scale.x;
+	m_ScaleY[Index] = Scale.y;
+	m_ScaleZ[Index] = Scale.z;
+	MarkDirty(Index);
+}
+
+DirectX::XMFLOAT3 TransformStore::GetPosition(UINT ID) const
+{
+	const UINT Index = m_IDToIndex[ID];
+	return { m_PosX[Index], m_PosY[Index], m_PosZ[Index] };
+}
+
+DirectX::XMFLOAT3 TransformStore::GetRotation(UINT ID) const
+{
+	const UINT Index = m_IDToIndex[ID];
+	return { m_RotX[Index], m_RotY[Index], m_RotZ[Index] };
+}
+
+DirectX::XMFLOAT3 TransformStore::GetScale(UINT ID) const
+{
+	const UINT Index = m_IDToIndex[ID];
+	return { m_ScaleX[Index], m_ScaleY[Index], m_ScaleZ[Index] };
+}
+
+void TransformStore::UpdateWorldMatrices()
+{
+	m_LastRecomputedCount = 0u;
+	m_LastReusedCount = 0u;
+	m_ChangedIDs.clear();
+	if (m_Count == 0u)
+		return;
+
+	if (m_bHierarchyDirty)
+	{
+		SortHierarchy();
+	}
+
+	ThreadPool* Pool = ThreadPool::GetSingletonPtr();
+	const UINT GroupCount = (m_Count + 3u) / 4u;
+	if (m_bUseThreads)
+	{
+		Pool->ParallelFor(GroupCount, 256u, [this](UINT Begin, UINT End)
+			{
+				ComputeLocalMatrices(Begin * 4u, End * 4u);
+			});
+	}
+	else
+	{
+		ComputeLocalMatrices(0u, GroupCount * 4u);
+	}
+
+	// every parent is in an earlier level, so its dirty flag already says whether its world matrix changed this update
+	for (UINT Level = 0u; Level < GetDepthCount(); Level++)
+	{
+		const UINT LevelStart = m_LevelStarts[Level];
+		const UINT LevelCount = m_LevelStarts[Level + 1u] - LevelStart;
+		if (m_bUseThreads)
+		{
+			Pool->ParallelFor(LevelCount, 1024u, [this, LevelStart](UINT Begin, UINT End)
+				{
+					std::vector<UINT> Changed;
+					UpdateLevel(LevelStart + Begin, LevelStart + End, Changed);
+					if (Changed.empty())
+						return;
+
+					std::lock_guard<std::mutex> Lock(m_ChangedMutex);
+					m_ChangedIDs.insert(m_ChangedIDs.end(), Changed.begin(), Changed.end());
+				});
+		}
+		else
+		{
+			UpdateLevel(LevelStart, LevelStart + LevelCount, m_ChangedIDs);
+		}
+	}
+
+	m_LastRecomputedCount = (UINT)m_ChangedIDs.size();
+	m_LastReusedCount = m_Count - m_LastRecomputedCount;
+	memset(m_Dirty.data(), 0, m_Dirty.size());
+}
+
+void TransformStore::MarkAllDirty()
+{
+	memset(m_Dirty.data(), 1, m_Count);
+}
+
+void TransformStore::UpdateLevel(UINT Begin, UINT End, std::vector<UINT>& OutChanged)
+{
+	// parent first, the order the recursive Component::GetAccumulatedWorldMatrix always composed them in
+	for (UINT i = Begin; i < End; i++)
+	{
+		const UINT Parent = m_Parents[i];
+		if (!m_Dirty[i] && (Parent == INVALID_ID || !m_Dirty[Parent]))
+			continue;
+
+		m_Dirty[i] = 1u;
+		m_WorldMatrices[i] = Parent == INVALID_ID ? m_LocalMatrices[i] : DirectX::XMMatrixMultiply(m_WorldMatrices[Parent], m_LocalMatrices[i]);
+		m_TransposedWorldMatrices[i] = DirectX::XMMatrixTranspose(m_WorldMatrices[i]);
+		OutChanged.push_back(m_IndexToID[i]);
+	}
+}
+
+DirectX::XMMATRIX TransformStore::ComposeLocalMatrix(const DirectX::XMFLOAT3& Position, const DirectX::XMFLOAT3& Rotation, const DirectX::XMFLOAT3& Scale)
+{
+	DirectX::XMMATRIX Matrix = DirectX::XMMatrixIdentity();
+	Matrix *= DirectX::XMMatrixScaling(Scale.x, Scale.y, Scale.z);
+	Matrix *= DirectX::XMMatrixRotationY(DirectX::XMConvertToRadians(Rotation.y));
+	Matrix *= DirectX::XMMatrixRotationX(DirectX::XMConvertToRadians(Rotation.x));
+	Matrix *= DirectX::XMMatrixRotationZ(DirectX::XMConvertToRadians(Rotation.z));
+	Matrix *= DirectX::XMMatrixTranslation(Position.x, Position.y, Position.z);
+
+	return Matrix;
+}
+
+void TransformStore::SortHierarchy()
+{
+	// counting sort by depth, stable so siblings keep their relative order
+	std::vector<UINT> Depths(m_Count);
+	std::vector<UINT> LevelCounts;
+	for (UINT i = 0u; i < m_Count; i++)
+	{
+		UINT Depth = 0u;
+		for (UINT p = m_ParentIDs[m_IndexToID[i]]; p != INVALID_ID && m_IDToIndex[p] != INVALID_ID; p = m_ParentIDs[p])
+		{
+			Depth++;
+		}
+
+		Depths[i] = Depth;
+		if (Depth >= (UINT)LevelCounts.size())
+		{
+			LevelCounts.resize(Depth + 1u, 0u);
+		}
+		LevelCounts[Depth]++;
+	}
+
+	m_LevelStarts.assign(LevelCounts.size() + 1u, 0u);
+	for (UINT Level = 0u; Level < (UINT)LevelCounts.size(); Level++)
+	{
+		m_LevelStarts[Level + 1u] = m_LevelStarts[Level] + LevelCounts[Level];
+	}
+
+	std::vector<UINT> Order(m_Count);
+	std::vector<UINT> Cursor(m_LevelStarts.begin(), m_LevelStarts.end() - 1);
+	for (UINT i = 0u; i < m_Count; i++)
+	{
+		Order[Cursor[Depths[i]]++] = i;
+	}
+
+	// cached matrices move along, only the transforms marked dirty get recomputed after a re-sort
+	std::vector<float>* Streams[] = { &m_PosX, &m_PosY, &m_PosZ, &m_RotX, &m_RotY, &m_RotZ, &m_ScaleX, &m_ScaleY, &m_ScaleZ };
+	for (std::vector<float>* Stream : Streams)
+	{
+		Permute(*Stream, Order);
+	}
+	Permute(m_Dirty, Order);
+	Permute(m_LocalMatrices, Order);
+	Permute(m_WorldMatrices, Order);
+	Permute(m_TransposedWorldMatrices, Order);
+
+	std::vector<UINT> IndexToID(m_Count);
+	for (UINT i = 0u; i < m_Count; i++)
+	{
+		IndexToID[i] = m_IndexToID[Order[i]];
+		m_IDToIndex[IndexToID[i]] = i;
+	}
+	m_IndexToID.swap(IndexToID);
+
+	for (UINT i = 0u; i < m_Count; i++)
+	{
+		const UINT ParentID = m_ParentIDs[m_IndexToID[i]];
+		m_Parents[i] = ParentID != INVALID_ID ? m_IDToIndex[ParentID] : INVALID_ID;
+	}
+
+	m_bHierarchyDirty = false;
+}
+
+void TransformStore::ComputeLocalMatrices(UINT Begin, UINT End)
+{
+	const DirectX::XMVECTOR DegreesToRadians = DirectX::XMVectorReplicate(DirectX::XM_PI / 180.f);
+	const DirectX::XMVECTOR Zero = DirectX::XMVectorZero();
+	const DirectX::XMVECTOR One = DirectX::XMVectorSplatOne();
+
+	for (UINT i = Begin; i < End; i += 4u)
+	{
+		// nothing in these 4 changed, their local matrices are still right
+		UINT DirtyLanes;
+		memcpy(&DirtyLanes, &m_Dirty[i], sizeof(DirtyLanes));
+		if (DirtyLanes == 0u)
+			continue;
+
+		DirectX::XMVECTOR sx, cx, sy, cy, sz, cz;
+		DirectX::XMVectorSinCos(&sx, &cx, DirectX::XMVectorMultiply(LoadFour(&m_RotX[i]), DegreesToRadians));
+		DirectX::XMVectorSinCos(&sy, &cy, DirectX::XMVectorMultiply(LoadFour(&m_RotY[i]), DegreesToRadians));
+		DirectX::XMVectorSinCos(&sz, &cz, DirectX::XMVectorMultiply(LoadFour(&m_RotZ[i]), DegreesToRadians));
+
+		// rotation y * rotation x * rotation z expanded, one lane per transform
+		const DirectX::XMVECTOR SySx = DirectX::XMVectorMultiply(sy, sx);
+		const DirectX::XMVECTOR CySx = DirectX::XMVectorMultiply(cy, sx);
+		const DirectX::XMVECTOR ScaleX = LoadFour(&m_ScaleX[i]);
+		const DirectX::XMVECTOR ScaleY = LoadFour(&m_ScaleY[i]);
+		const DirectX::XMVECTOR ScaleZ = LoadFour(&m_ScaleZ[i]);
+
+		const DirectX::XMMATRIX Rows0 = DirectX::XMMatrixTranspose(DirectX::XMMATRIX(
+			DirectX::XMVectorMultiply(DirectX::XMVectorNegativeMultiplySubtract(SySx, sz, DirectX::XMVectorMultiply(cy, cz)), ScaleX),
+			DirectX::XMVectorMultiply(DirectX::XMVectorMultiplyAdd(SySx, cz, DirectX::XMVectorMultiply(cy, sz)), ScaleX),
+			DirectX::XMVectorNegate(DirectX::XMVectorMultiply(DirectX::XMVectorMultiply(sy, cx), ScaleX)),
+			Zero));
+		const DirectX::XMMATRIX Rows1 = DirectX::XMMatrixTranspose(DirectX::XMMATRIX(
+			DirectX::XMVectorNegate(DirectX::XMVectorMultiply(DirectX::XMVectorMultiply(cx, sz), ScaleY)),
+			DirectX::XMVectorMultiply(DirectX::XMVectorMultiply(cx, cz), ScaleY),
+			DirectX::XMVectorMultiply(sx, ScaleY),
+			Zero));
+		const DirectX::XMMATRIX Rows2 = DirectX::XMMatrixTranspose(DirectX::XMMATRIX(
+			DirectX::XMVectorMultiply(DirectX::XMVectorMultiplyAdd(CySx, sz, DirectX::XMVectorMultiply(sy, cz)), ScaleZ),
+			DirectX::XMVectorMultiply(DirectX::XMVectorNegativeMultiplySubtract(CySx, cz, DirectX::XMVectorMultiply(sy, sz)), ScaleZ),
+			DirectX::XMVectorMultiply(DirectX::XMVectorMultiply(cy, cx), ScaleZ),
+			Zero));
+		const DirectX::XMMATRIX Rows3 = DirectX::XMMatrixTranspose(DirectX::XMMATRIX(LoadFour(&m_PosX[i]), LoadFour(&m_PosY[i]), LoadFour(&m_PosZ[i]), One));
+
+		for (UINT k = 0u; k < 4u; k++)
+		{
+			m_LocalMatrices[i + k] = DirectX::XMMATRIX(Rows0.r[k], Rows1.r[k], Rows2.r[k], Rows3.r[k]);
+		}
+	}
+}
+
+void TransformStore::Resize(UINT Count)
+{
+	const UINT Padded = (Count + 3u) & ~3u;
+	std::vector<float>* Streams[] = { &m_PosX, &m_PosY, &m_PosZ, &m_RotX, &m_RotY, &m_RotZ };
+	for (std::vector<float>* Stream : Streams)
+	{
+		Stream->resize(Padded, 0.f);
+	}
+	m_ScaleX.resize(Padded, 1.f);
+	m_ScaleY.resize(Padded, 1.f);
+	m_ScaleZ.resize(Padded, 1.f);
+	m_Dirty.resize(Padded, 0u);
+	m_LocalMatrices.resize(Padded);
+	m_WorldMatrices.resize(Padded);
+	m_TransposedWorldMatrices.resize(Padded);
+	m_Parents.resize(Count);
+	m_IndexToID.resize(Count);
+
+	m_Count = Count;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#ifndef TRANSFORM_STORE_H
+#define TRANSFORM_STORE_H
+
+#include <vector>
+#include <mutex>
+
+#include "DirectXMath.h"
+
+typedef unsigned int UINT;
+
+/*
+*	Central structure-of-arrays storage for the transforms of every Component. Position, rotation (degrees) and scale live in one
+*	float array per axis, kept sorted by hierarchy depth so parents always come before their children. Setters only mark the
+*	transform dirty. UpdateWorldMatrices rebuilds the local matrices of dirty transforms 4 at a time straight from those arrays, then
+*	walks the depth levels in order and recomputes a world matrix only when the transform or its parent changed, so an unchanged
+*	subtree costs one flag test per node. Both passes are spread over the ThreadPool. Ids handed out by Create are stable, the sorted
+*	index behind them is not. Pure CPU, no device needed.
+*/
+
+class TransformStore
+{
+public:
+	static const UINT INVALID_ID = 0xFFFFFFFF;
+
+public:
+	TransformStore();
+
+	// the store every Component registers in
+	static TransformStore* GetSingletonPtr();
+
+	// new root with the identity transform
+	UINT Create();
+	void Release(UINT ID);
+	void SetParent(UINT ID, UINT ParentID);
+
+	void SetPosition(UINT ID, const DirectX::XMFLOAT3& Position);
+	void SetRotation(UINT ID, const DirectX::XMFLOAT3& Rotation);
+	void SetScale(UINT ID, const DirectX::XMFLOAT3& Scale);
+
+	DirectX::XMFLOAT3 GetPosition(UINT ID) const;
+	DirectX::XMFLOAT3 GetRotation(UINT ID) const;
+	DirectX::XMFLOAT3 GetScale(UINT ID) const;
+	UINT GetParent(UINT ID) const { return m_ParentIDs[ID]; }
+
+	// re-sorts first if the hierarchy changed since the last update
+	void UpdateWorldMatrices();
+	void MarkAllDirty();
+	// world matrix as of the last UpdateWorldMatrices, not transposed
+	const DirectX::XMMATRIX& GetWorldMatrix(UINT ID) const { return m_WorldMatrices[m_IDToIndex[ID]]; }
+	// the same matrix transposed, the layout ModelData::m_Transforms and the shaders use
+	const DirectX::XMMATRIX& GetTransposedWorldMatrix(UINT ID) const { return m_TransposedWorldMatrices[m_IDToIndex[ID]]; }
+
+	void SetUseThreads(bool bUseThreads) { m_bUseThreads = bUseThreads; }
+	bool GetUseThreads() const { return m_bUseThreads; }
+	UINT GetCount() const { return m_Count; }
+	UINT GetDepthCount() const { return m_LevelStarts.empty() ? 0u : (UINT)m_LevelStarts.size() - 1u; }
+	UINT GetLastRecomputedCount() const { return m_LastRecomputedCount; }
+	UINT GetLastReusedCount() const { return m_LastReusedCount; }
+	// ids whose world matrix the last UpdateWorldMatrices recomputed, in no particular order. What spatial structures over the
+	// transforms refit from instead of looking at everything
+	const std::vector<UINT>& GetChangedIDs() const { return m_ChangedIDs; }
+
+	// scale * rotation y * rotation x * rotation z * translation, the order Component::GetWorldMatrix always used
+	static DirectX::XMMATRIX ComposeLocalMatrix(const DirectX::XMFLOAT3& Position, const DirectX::XMFLOAT3& Rotation, const DirectX::XMFLOAT3& Scale);
+
+private:
+	void SortHierarchy();
+	void ComputeLocalMatrices(UINT Begin, UINT End);
+	// appends the ids of the world matrices it recomputes to OutChanged
+	void UpdateLevel(UINT Begin, UINT End, std::vector<UINT>& OutChanged);
+	void Resize(UINT Count);
+	// takes ID out of the child list of its current parent, m_ParentIDs is left alone
+	void UnlinkChild(UINT ID);
+	void MarkDirty(UINT Index) { m_Dirty[Index] = 1u; }
+
+private:
+	// sorted by depth and padded up to a multiple of 4
+	std::vector<float> m_PosX;
+	std::vector<float> m_PosY;
+	std::vector<float> m_PosZ;
+	std::vector<float> m_RotX;
+	std::vector<float> m_RotY;
+	std::vector<float> m_RotZ;
+	std::vector<float> m_ScaleX;
+	std::vector<float> m_ScaleY;
+	std::vector<float> m_ScaleZ;
+	std::vector<UINT> m_Parents;		// sorted index of the parent, INVALID_ID for roots
+	std::vector<unsigned char> m_Dirty;	// set by the setters, during an update also set on every transform whose world matrix changed
+	std::vector<DirectX::XMMATRIX> m_LocalMatrices;
+	std::vector<DirectX::XMMATRIX> m_WorldMatrices;
+	std::vector<DirectX::XMMATRIX> m_TransposedWorldMatrices;
+	std::vector<UINT> m_LevelStarts;	// first sorted index of every depth, plus the count at the end
+
+	std::vector<UINT> m_IDToIndex;
+	std::vector<UINT> m_IndexToID;
+	std::vector<UINT> m_ParentIDs;		// by id, survives sorting
+	// by id, an intrusive list of the children of every transform so Release can orphan them without a search
+	std::vector<UINT> m_FirstChildIDs;
+	std::vector<UINT> m_NextSiblingIDs;
+	std::vector<UINT> m_PrevSiblingIDs;
+	std::vector<UINT> m_FreeIDs;
+	std::vector<UINT> m_ChangedIDs;
+	std::mutex m_ChangedMutex;		// threaded level batches append to m_ChangedIDs
+
+	UINT m_Count;
+	UINT m_LastRecomputedCount;
+	UINT m_LastReusedCount;
+	bool m_bHierarchyDirty;
+	bool m_bUseThreads;
+
+	static TransformStore* ms_Instance;
+
+};
+
+#endif
@@ -0,0 +1,188 @@
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#include "VertexCompression.h"
+
+static const float UNORM16_MAX = 65535.f;
+static const float SNORM16_MAX = 32767.f;
+
+static float GetAxis(const DirectX::XMFLOAT3& v, int Axis)
+{
+	return Axis == 0 ? v.x : Axis == 1 ? v.y : v.z;
+}
+
+static float SignNotZero(float Value)
+{
+	return Value >= 0.f ? 1.f : -1.f;
+}
+
+VertexQuantization VertexCompression::GetQuantization(const Vertex* Vertices, UINT Count)
+{
+	VertexQuantization Quantization;
+	if (Count == 0u)
+		return Quantization;
+
+	DirectX::XMFLOAT3 Min = { FLT_MAX, FLT_MAX, FLT_MAX };
+	DirectX::XMFLOAT3 Max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (UINT i = 0u; i < Count; i++)
+	{
+		const DirectX::XMFLOAT3& Pos = Vertices[i].Pos;
+		Min = { fminf(Min.x, Pos.x), fminf(Min.y, Pos.y), fminf(Min.z, Pos.z) };
+		Max = { fmaxf(Max.x, Pos.x), fmaxf(Max.y, Pos.y), fmaxf(Max.z, Pos.z) };
+	}
+
+	Quantization.Offset = Min;
+	Quantization.Scale = { Max.x - Min.x, Max.y - Min.y, Max.z - Min.z };
+	return Quantization;
+}
+
+PackedVertex VertexCompression::Encode(const Vertex& v, const VertexQuantization& Quantization)
+{
+	PackedVertex Packed = {};
+
+	for (int Axis = 0; Axis < 3; Axis++)
+	{
+		const float Scale = GetAxis(Quantization.Scale, Axis);
+		float t = Scale > 0.f ? (GetAxis(v.Pos, Axis) - GetAxis(Quantization.Offset, Axis)) / Scale : 0.f;
+		t = t < 0.f ? 0.f : (t > 1.f ? 1.f : t);
+		Packed.Pos[Axis] = (unsigned short)lrintf(t * UNORM16_MAX);
+	}
+	Packed.Pos[3] = 0u;
+
+	EncodeOctahedral(v.Normal, Packed.Normal);
+	Packed.TexCoord[0] = FloatToHalf(v.TexCoord.x);
+	Packed.TexCoord[1] = FloatToHalf(v.TexCoord.y);
+
+	return Packed;
+}
+
+Vertex VertexCompression::Decode(const PackedVertex& v, const VertexQuantization& Quantization)
+{
+	Vertex Decoded;
+	Decoded.Pos.x = Quantization.Offset.x + ((float)v.Pos[0] / UNORM16_MAX) * Quantization.Scale.x;
+	Decoded.Pos.y = Quantization.Offset.y + ((float)v.Pos[1] / UNORM16_MAX) * Quantization.Scale.y;
+	Decoded.Pos.z = Quantization.Offset.z + ((float)v.Pos[2] / UNORM16_MAX) * Quantization.Scale.z;
+	Decoded.Normal = DecodeOctahedral(v.Normal);
+	Decoded.TexCoord.x = HalfToFloat(v.TexCoord[0]);
+	Decoded.TexCoord.y = HalfToFloat(v.TexCoord[1]);
+
+	return Decoded;
+}
+
+void VertexCompression::EncodeOctahedral(const DirectX::XMFLOAT3& Normal, short* Out)
+{
+	// project onto the octahedron, then fold the lower half over the diagonals so the whole sphere fits in the unit square
+	const float L1 = fabsf(Normal.x) + fabsf(Normal.y) + fabsf(Normal.z);
+	float x = L1 > 0.f ? Normal.x / L1 : 0.f;
+	float y = L1 > 0.f ? Normal.y / L1 : 0.f;
+	if (Normal.z < 0.f)
+	{
+		const float FoldedX = (1.f - fabsf(y)) * SignNotZero(x);
+		const float FoldedY = (1.f - fabsf(x)) * SignNotZero(y);
+		x = FoldedX;
+		y = FoldedY;
+	}
+
+	Out[0] = (short)lrintf((x < -1.f ? -1.f : (x > 1.f ? 1.f : x)) * SNORM16_MAX);
+	Out[1] = (short)lrintf((y < -1.f ? -1.f : (y > 1.f ? 1.f : y)) * SNORM16_MAX);
+}
+
+DirectX::XMFLOAT3 VertexCompression::DecodeOctahedral(const short* Encoded)
+{
+	// snorm decode as the input assembler does it, -32768 and -32767 are both -1
+	const float x = fmaxf((float)Encoded[0] / SNORM16_MAX, -1.f);
+	const float y = fmaxf((float)Encoded[1] / SNORM16_MAX, -1.f);
+
+	DirectX::XMFLOAT3 Normal = { x, y, 1.f - fabsf(x) - fabsf(y) };
+	const float t = fmaxf(-Normal.z, 0.f);
+	Normal.x += Normal.x >= 0.f ? -t : t;
+	Normal.y += Normal.y >= 0.f ? -t : t;
+
+	const float Length = sqrtf(Normal.x * Normal.x + Normal.y * Normal.y + Normal.z * Normal.z);
+	return { Normal.x / Length, Normal.y / Length, Normal.z / Length };
+}
+
+unsigned short VertexCompression::FloatToHalf(float Value)
+{
+	UINT Bits;
+	memcpy(&Bits, &Value, sizeof(Bits));
+
+	const UINT Sign = (Bits >> 16u) & 0x8000u;
+	const UINT Abs = Bits & 0x7FFFFFFFu;
+
+	// NaN stays NaN, infinity and everything that would round to it clamps to the largest half, 65504
+	if (Abs > 0x7F800000u)
+		return (unsigned short)(Sign | 0x7E00u);
+	if (Abs >= 0x477FF000u)
+		return (unsigned short)(Sign | 0x7BFFu);
+
+	// below the smallest normal half the result is denormal, half of the smallest denormal and less rounds to zero
+	if (Abs < 0x38800000u)
+	{
+		if (Abs <= 0x33000000u)
+			return (unsigned short)Sign;
+
+		const UINT Exponent = Abs >> 23u;
+		const UINT Mantissa = (Abs & 0x7FFFFFu) | 0x800000u;
+		const UINT Shift = 126u - Exponent;
+		UINT Half = Mantissa >> Shift;
+		const UINT Remainder = Mantissa & ((1u << Shift) - 1u);
+		const UINT HalfWay = 1u << (Shift - 1u);
+		if (Remainder > HalfWay || (Remainder == HalfWay && (Half & 1u)))
+		{
+			Half++;
+		}
+		return (unsigned short)(Sign | Half);
+	}
+
+	// rebias the exponent and round the mantissa to nearest even, a carry out of the mantissa correctly bumps the exponent
+	UINT Half = (Abs - 0x38000000u) >> 13u;
+	const UINT Remainder = Abs & 0x1FFFu;
+	if (Remainder > 0x1000u || (Remainder == 0x1000u && (Half & 1u)))
+	{
+		Half++;
+	}
+	return (unsigned short)(Sign | Half);
+}
+
+float VertexCompression::HalfToFloat(unsigned short Value)
+{
+	const UINT Sign = ((UINT)Value & 0x8000u) << 16u;
+	const UINT Exponent = ((UINT)Value >> 10u) & 0x1Fu;
+	const UINT Mantissa = (UINT)Value & 0x3FFu;
+
+	if (Exponent == 0u)
+	{
+		// zero or denormal, exact in a float
+		const float Magnitude = (float)Mantissa * 5.9604644775390625e-8f;
+		return Sign ? -Magnitude : Magnitude;
+	}
+
+	UINT Bits;
+	if (Exponent == 31u)
+	{
+		Bits = Sign | 0x7F800000u | (Mantissa << 13u);
+	}
+	else
+	{
+		Bits = Sign | ((Exponent + 112u) << 23u) | (Mantissa << 13u);
+	}
+
+	float Result;
+	memcpy(&Result, &Bits, sizeof(Result));
+	return Result;
+}
+
+float VertexCompression::GetPositionErrorBound(const VertexQuantization& Quantization)
+{
+	// half a quantisation step, plus the float rounding of the decode itself at the largest coordinate
+	float Bound = 0.f;
+	for (int Axis = 0; Axis < 3; Axis++)
+	{
+		const float Scale = GetAxis(Quantization.Scale, Axis);
+		const float Largest = fabsf(GetAxis(Quantization.Offset, Axis)) + Scale;
+		Bound = fmaxf(Bound, Scale / (2.f * UNORM16_MAX) + Largest * 4.f * FLT_EPSILON);
+	}
+	return Bound;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#ifndef VERTEX_COMPRESSION_H
+#define VERTEX_COMPRESSION_H
+
+#include "DirectXMath.h"
+
+#include "Common.h"
+
+typedef unsigned int UINT;
+
+// a mesh's positions decode as Offset + Pos / 65535 * Scale, Scale is the extent of the mesh bounds and 0 on flat axes
+struct VertexQuantization
+{
+	DirectX::XMFLOAT3 Offset = { 0.f, 0.f, 0.f };
+	DirectX::XMFLOAT3 Scale = { 0.f, 0.f, 0.f };
+};
+
+/*
+*	Encoding and decoding of PackedVertex. Positions are 16 bit unorm relative to the mesh bounds, so the largest error on an axis
+*	is half a step of that axis' extent. Normals are octahedral (Meyer et al. 2010) in two 16 bit snorms, which keeps them within a
+*	few thousandths of a degree. Texture coordinates are IEEE half floats, exact to 11 significant bits and clamped to the half
+*	range. Decode does exactly what the input assembler and InstancedPhongVS do. Pure CPU, no device needed.
+*/
+
+class VertexCompression
+{
+public:
+	static VertexQuantization GetQuantization(const Vertex* Vertices, UINT Count);
+
+	static PackedVertex Encode(const Vertex& v, const VertexQuantization& Quantization);
+	static Vertex Decode(const PackedVertex& v, const VertexQuantization& Quantization);
+
+	static void EncodeOctahedral(const DirectX::XMFLOAT3& Normal, short* Out);
+	static DirectX::XMFLOAT3 DecodeOctahedral(const short* Encoded);
+
+	static unsigned short FloatToHalf(float Value);
+	static float HalfToFloat(unsigned short Value);
+
+	// largest position error on any axis, what a round trip through Encode and Decode is allowed to be off by
+	static float GetPositionErrorBound(const VertexQuantization& Quantization);
+
+};
+
+#endif
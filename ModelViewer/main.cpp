@@ -1,10 +1,19 @@
+#include <cstring>
+
 #include "SystemClass.h"
+#include "Benchmarks.h"
 
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pScmdline, int iCmdshow)
 {
 	SystemClass* System;
 	bool Result;
 
+	// headless run, no window or device gets created
+	if (pScmdline && strstr(pScmdline, "-benchmark"))
+	{
+		return Benchmarks::Run("BenchmarkResults.csv") ? 0 : 1;
+	}
+
 	System = new SystemClass();
 
 	Result = System->Initialise();
@@ -18,4 +27,4 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pScmdline,
 	System = 0;
 
 	return 0;
-}
\ No newline at end of file
+}